@@ -0,0 +1,402 @@
+/*
+flext - C++ layer for Max and Pure Data externals
+
+Copyright (c) 2001-2015 Thomas Grill (gr@grrrr.org)
+For information on usage and redistribution, and for a DISCLAIMER OF ALL
+WARRANTIES, see the file, "license.txt," in this distribution.
+*/
+
+/*! \file main.cpp
+    \brief Microbenchmarks of the flext hot paths, run in the headless host.
+
+    Covers message dispatch, outlets, the message queue, the SIMD sample functions,
+    the hash maps and atom handling.
+    Every benchmark is run in batches for a given time, the reported latencies
+    (median, 99th percentile, maximum) are those of the batches per operation.
+
+    Usage: flbench flmicro.so [-time seconds] [-json file] [name prefixes...]
+*/
+
+// enable attribute processing
+#define FLEXT_ATTRIBUTES 1
+
+#include <flext.h>
+#include <flhost.h>
+
+#if !defined(FLEXT_VERSION) || (FLEXT_VERSION < 600)
+#error You need at least flext version 0.6.0
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+
+//! target duration of a batch
+#define BATCHTIME 20.e-6
+
+
+class flmicro:
+    public flext_base
+{
+    FLEXT_HEADER_S(flmicro,flext_base,setup)
+
+public:
+    flmicro():
+        value(0),gain(1),count(0)
+    {
+        AddInAnything(2);
+        AddOutAnything();
+    }
+
+    float value,gain;
+    int count;
+
+    static const t_symbol *sym_set;
+
+protected:
+    void m_float(float f) { value = f; }
+    void m_float1(float f) { value = f; }
+    void m_set(int argc,const t_atom *argv) { count += argc; }
+    void m_out(int n) { for(int i = 0; i < n; ++i) ToOutFloat(0,(float)i); }
+    void m_burst(int n) { for(int i = 0; i < n; ++i) ToQueueFloat(0,(float)i); }
+
+    void m_burstany(int n)
+    {
+        t_atom at[3];
+        SetFloat(at[0],1); SetFloat(at[1],2); SetSymbol(at[2],sym_list);
+        for(int i = 0; i < n; ++i) ToQueueAnything(0,sym_set,3,at);
+    }
+
+    static void setup(t_classid c)
+    {
+        sym_set = MakeSymbol("set");
+
+        FLEXT_CADDMETHOD(c,0,m_float);
+        FLEXT_CADDMETHOD(c,1,m_float1);
+        FLEXT_CADDMETHOD_(c,0,"set",m_set);
+        FLEXT_CADDMETHOD_I(c,0,"out",m_out);
+        FLEXT_CADDMETHOD_I(c,0,"burst",m_burst);
+        FLEXT_CADDMETHOD_I(c,0,"burstany",m_burstany);
+        FLEXT_CADDATTR_VAR1(c,"gain",gain);
+    }
+
+private:
+    FLEXT_CALLBACK_F(m_float)
+    FLEXT_CALLBACK_F(m_float1)
+    FLEXT_CALLBACK_V(m_set)
+    FLEXT_CALLBACK_I(m_out)
+    FLEXT_CALLBACK_I(m_burst)
+    FLEXT_CALLBACK_I(m_burstany)
+    FLEXT_ATTRVAR_F(gain)
+};
+
+const t_symbol *flmicro::sym_set = NULL;
+
+FLEXT_NEW("flmicro",flmicro)
+
+
+//! State shared by the benchmarks
+static t_object *obj = NULL;
+static long received = 0;
+static t_atom atoms[16],atoms2[16];
+static t_sample *sig1,*sig2,*sig3;
+static t_sample *fftscratch;
+static const flext::FFT *fftc,*fftr;
+static const t_symbol *keys[1024];
+static TablePtrMap<const t_symbol *,const t_symbol *,16> map16;
+static TablePtrMap<const t_symbol *,const t_symbol *,16> map1024;
+static volatile float sink;
+
+static void count(void *,t_object *,int,t_symbol *,int,t_atom *) { ++received; }
+
+static void b_dispatch_float(int reps)
+{
+    for(int i = 0; i < reps; ++i) pd_float(&obj->ob_pd,(t_float)i);
+}
+
+static void b_dispatch_tagged(int reps)
+{
+    t_symbol *s = const_cast<t_symbol *>(flmicro::sym_set);
+    for(int i = 0; i < reps; ++i) pd_typedmess(&obj->ob_pd,s,4,atoms);
+}
+
+static void b_dispatch_attr(int reps)
+{
+    t_symbol *s = gensym("gain");
+    for(int i = 0; i < reps; ++i) pd_typedmess(&obj->ob_pd,s,1,atoms);
+}
+
+static void b_dispatch_inlet(int reps)
+{
+    for(int i = 0; i < reps; ++i) flhost_send(obj,1,&s_float,1,atoms);
+}
+
+static void b_outlet_float(int reps)
+{
+    t_atom a;
+    flext::SetInt(a,reps);
+    pd_typedmess(&obj->ob_pd,gensym("out"),1,&a);
+}
+
+static void b_queue_float(int reps)
+{
+    t_atom a;
+    flext::SetInt(a,reps);
+    pd_typedmess(&obj->ob_pd,gensym("burst"),1,&a);
+    // the queue is flushed by the clock
+    flhost_tick(1);
+}
+
+static void b_queue_anything(int reps)
+{
+    t_atom a;
+    flext::SetInt(a,reps);
+    pd_typedmess(&obj->ob_pd,gensym("burstany"),1,&a);
+    flhost_tick(1);
+}
+
+static void b_simd_copy64(int reps) { for(int i = 0; i < reps; ++i) flext::CopySamples(sig1,sig2,64); }
+static void b_simd_copy4k(int reps) { for(int i = 0; i < reps; ++i) flext::CopySamples(sig1,sig2,4096); }
+static void b_simd_mul64(int reps) { for(int i = 0; i < reps; ++i) flext::MulSamples(sig1,sig2,0.5f,64); }
+static void b_simd_mul4k(int reps) { for(int i = 0; i < reps; ++i) flext::MulSamples(sig1,sig2,0.5f,4096); }
+static void b_simd_mulv64(int reps) { for(int i = 0; i < reps; ++i) flext::MulSamples(sig1,sig2,sig3,64); }
+static void b_simd_mulv4k(int reps) { for(int i = 0; i < reps; ++i) flext::MulSamples(sig1,sig2,sig3,4096); }
+static void b_simd_add4k(int reps) { for(int i = 0; i < reps; ++i) flext::AddSamples(sig1,sig2,sig3,4096); }
+static void b_simd_scale4k(int reps) { for(int i = 0; i < reps; ++i) flext::ScaleSamples(sig1,sig2,0.5f,0.25f,4096); }
+static void b_simd_dot4k(int reps) { for(int i = 0; i < reps; ++i) sink = flext::DotSamples(sig2,sig3,4096); }
+
+static void b_fft_complex1k(int reps) { for(int i = 0; i < reps; ++i) fftc->Complex(sig1,sig2,fftscratch); }
+static void b_fft_real1k(int reps) { for(int i = 0; i < reps; ++i) fftr->Forward(sig1,sig2,fftscratch); }
+static void b_fft_realinv1k(int reps) { for(int i = 0; i < reps; ++i) fftr->Inverse(sig1,sig2,fftscratch); }
+
+static void b_map_find16(int reps)
+{
+    const t_symbol *r = NULL;
+    for(int i = 0; i < reps; ++i) r = map16.find(keys[i&15]);
+    sink = r?1:0;
+}
+
+static void b_map_find1024(int reps)
+{
+    const t_symbol *r = NULL;
+    for(int i = 0; i < reps; ++i) r = map1024.find(keys[(i*7)&1023]);
+    sink = r?1:0;
+}
+
+static void b_map_miss1024(int reps)
+{
+    const t_symbol *r = NULL;
+    // the keys are aligned pointers, odd ones are never in the map
+    for(int i = 0; i < reps; ++i) r = map1024.find((const t_symbol *)((size_t)keys[i&1023]+1));
+    sink = r?1:0;
+}
+
+static void b_map_insertremove(int reps)
+{
+    for(int i = 0; i < reps; ++i) {
+        const t_symbol *k = keys[i&1023];
+        map16.insert(k,k);
+        map16.remove(k);
+    }
+}
+
+static void b_atoms_copy16(int reps) { for(int i = 0; i < reps; ++i) flext::CopyAtoms(16,atoms2,atoms); }
+
+static void b_atoms_list16(int reps)
+{
+    for(int i = 0; i < reps; ++i) {
+        flext::AtomList l(16,atoms);
+        sink = (float)l.Count();
+    }
+}
+
+static void b_atoms_cmp16(int reps)
+{
+    int r = 0;
+    for(int i = 0; i < reps; ++i) r += flext::CmpAtom(atoms[i&15],atoms2[i&15]);
+    sink = (float)r;
+}
+
+static void b_atoms_hash16(int reps)
+{
+    unsigned long h = 0;
+    for(int i = 0; i < reps; ++i) h += flext::AtomHash(16,atoms);
+    sink = (float)h;
+}
+
+struct Bench {
+    const char *name;
+    const char *unit;  //!< what is processed
+    int items;  //!< number of processed units per operation
+    void (*fun)(int reps);
+};
+
+static const Bench benches[] = {
+    {"dispatch.float","msg",1,b_dispatch_float},
+    {"dispatch.tagged","msg",1,b_dispatch_tagged},
+    {"dispatch.attr","msg",1,b_dispatch_attr},
+    {"dispatch.inlet","msg",1,b_dispatch_inlet},
+    {"outlet.float","msg",1,b_outlet_float},
+    {"queue.float","msg",1,b_queue_float},
+    {"queue.anything","msg",1,b_queue_anything},
+    {"simd.copy.64","sample",64,b_simd_copy64},
+    {"simd.copy.4096","sample",4096,b_simd_copy4k},
+    {"simd.mul.64","sample",64,b_simd_mul64},
+    {"simd.mul.4096","sample",4096,b_simd_mul4k},
+    {"simd.mulv.64","sample",64,b_simd_mulv64},
+    {"simd.mulv.4096","sample",4096,b_simd_mulv4k},
+    {"simd.addv.4096","sample",4096,b_simd_add4k},
+    {"simd.scale.4096","sample",4096,b_simd_scale4k},
+    {"simd.dot.4096","sample",4096,b_simd_dot4k},
+    {"fft.complex.1024","sample",1024,b_fft_complex1k},
+    {"fft.real.1024","sample",1024,b_fft_real1k},
+    {"fft.realinv.1024","sample",1024,b_fft_realinv1k},
+    {"map.find.16","lookup",1,b_map_find16},
+    {"map.find.1024","lookup",1,b_map_find1024},
+    {"map.miss.1024","lookup",1,b_map_miss1024},
+    {"map.insertremove","op",1,b_map_insertremove},
+    {"atoms.copy.16","atom",16,b_atoms_copy16},
+    {"atoms.list.16","atom",16,b_atoms_list16},
+    {"atoms.cmp","op",1,b_atoms_cmp16},
+    {"atoms.hash.16","atom",16,b_atoms_hash16},
+    {NULL,NULL,0,NULL}
+};
+
+struct Result {
+    const Bench *bench;
+    long ops;
+    double nsop,itemsps;
+    double p50,p99,max;  //!< ns per operation
+};
+
+static Result run(const Bench &b,double duration)
+{
+    // find the number of operations filling a batch
+    int reps = 1;
+    for(;;) {
+        const double t = sys_getrealtime();
+        b.fun(reps);
+        if(sys_getrealtime()-t >= BATCHTIME || reps >= (1<<20)) break;
+        reps *= 2;
+    }
+
+    std::vector<double> lat;
+    double total = 0;
+    long ops = 0;
+    while(total < duration || lat.size() < 10) {
+        const double t = sys_getrealtime();
+        b.fun(reps);
+        const double dt = sys_getrealtime()-t;
+        total += dt;
+        ops += reps;
+        lat.push_back(dt*1.e9/reps);
+    }
+
+    std::sort(lat.begin(),lat.end());
+    Result r;
+    r.bench = &b;
+    r.ops = ops;
+    r.nsop = total*1.e9/ops;
+    r.itemsps = ops*(double)b.items/total;
+    r.p50 = lat[lat.size()/2];
+    r.p99 = lat[(lat.size()*99)/100];
+    r.max = lat.back();
+    return r;
+}
+
+static void setupdata()
+{
+    for(int i = 0; i < 16; ++i) {
+        if(i&1) flext::SetFloat(atoms[i],(float)i);
+        else flext::SetSymbol(atoms[i],flext::sym_list);
+    }
+    flext::CopyAtoms(16,atoms2,atoms);
+
+    sig1 = flext::NewAligned<t_sample>(4096);
+    sig2 = flext::NewAligned<t_sample>(4096);
+    sig3 = flext::NewAligned<t_sample>(4096);
+    for(int i = 0; i < 4096; ++i) {
+        sig2[i] = (t_sample)((i%97)*0.01);
+        sig3[i] = (t_sample)((i%89)*0.01);
+    }
+
+    fftc = flext::GetFFT(1024);
+    fftr = flext::GetFFT(1024,true);
+    fftscratch = flext::NewAligned<t_sample>(fftc->ScratchSize());
+
+    char tmp[32];
+    for(int i = 0; i < 1024; ++i) {
+        sprintf(tmp,"key%i",i);
+        keys[i] = flext::MakeSymbol(tmp);
+        if(i < 16) map16.insert(keys[i],keys[i]);
+        map1024.insert(keys[i],keys[i]);
+    }
+}
+
+static bool selected(const char *name,int argc,char *argv[])
+{
+    if(!argc) return true;
+    for(int i = 0; i < argc; ++i)
+        if(!strncmp(name,argv[i],strlen(argv[i]))) return true;
+    return false;
+}
+
+//! Entry point called by flbench
+extern "C" FLEXT_EXT int flbench_run(int argc,char *argv[])
+{
+    double duration = 0.2;
+    const char *json = NULL;
+
+    int a = 0;
+    for(; a < argc && argv[a][0] == '-'; ++a) {
+        if(!strcmp(argv[a],"-time") && a+1 < argc) duration = atof(argv[++a]);
+        else if(!strcmp(argv[a],"-json") && a+1 < argc) json = argv[++a];
+        else {
+            fprintf(stderr,"usage: flbench flmicro [-time seconds] [-json file] [name prefixes...]\n");
+            return 1;
+        }
+    }
+
+    obj = flhost_new("flmicro");
+    if(!obj) {
+        fprintf(stderr,"flmicro: couldn't create object\n");
+        return 1;
+    }
+    flhost_sink(obj,0,count,NULL);
+    setupdata();
+
+    std::vector<Result> res;
+    printf("%-20s %10s %14s %10s %10s %10s\n","benchmark","ns/op","items/s","p50 ns","p99 ns","max ns");
+    for(const Bench *b = benches; b->name; ++b) {
+        if(!selected(b->name,argc-a,argv+a)) continue;
+        // lock as the scheduler would
+        sys_lock();
+        res.push_back(run(*b,duration));
+        sys_unlock();
+        const Result &r = res.back();
+        printf("%-20s %10.2f %14.4g %10.2f %10.2f %10.2f\n",b->name,r.nsop,r.itemsps,r.p50,r.p99,r.max);
+    }
+
+    if(json) {
+        FILE *f = fopen(json,"w");
+        if(!f) {
+            fprintf(stderr,"flmicro: couldn't write %s\n",json);
+            return 1;
+        }
+        fprintf(f,"{\n  \"flext\": \"%s\",\n  \"version\": %i,\n  \"simd\": %lu,\n  \"samplerate\": %g,\n  \"blocksize\": %i,\n  \"results\": [\n",
+            flext::VersionStr(),flext::Version(),flext::GetSIMDCapabilities(),(double)sys_getsr(),sys_getblksize());
+        for(size_t i = 0; i < res.size(); ++i) {
+            const Result &r = res[i];
+            fprintf(f,"    {\"name\": \"%s\", \"unit\": \"%s\", \"ops\": %li, \"ns_per_op\": %.3f, \"items_per_s\": %.6g, \"p50_ns\": %.3f, \"p99_ns\": %.3f, \"max_ns\": %.3f}%s\n",
+                r.bench->name,r.bench->unit,r.ops,r.nsop,r.itemsps,r.p50,r.p99,r.max,i+1 < res.size()?",":"");
+        }
+        fprintf(f,"  ]\n}\n");
+        fclose(f);
+    }
+
+    flhost_free(obj);
+    obj = NULL;
+    return 0;
+}
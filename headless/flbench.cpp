@@ -0,0 +1,152 @@
+/*
+flext - C++ layer for Max and Pure Data externals
+
+Copyright (c) 2001-2015 Thomas Grill (gr@grrrr.org)
+For information on usage and redistribution, and for a DISCLAIMER OF ALL
+WARRANTIES, see the file, "license.txt," in this distribution.
+*/
+
+/*! \file flbench.cpp
+    \brief Benchmark driver for externals running in the headless flext host.
+
+    Loads an external, creates one object, feeds its signal inlets with
+    a fixed noise sequence and measures the time of a number of DSP blocks.
+    The output checksum allows to compare results between runs and builds.
+
+    An external defining flbench_run (a benchmark suite) is run by that
+    function instead, with the arguments following the external.
+*/
+
+#include "flhost.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <dlfcn.h>
+
+//! Entry point of benchmark suites
+typedef int (*t_benchrun)(int argc,char *argv[]);
+
+static void usage()
+{
+    fprintf(stderr,
+        "usage: flbench [options] external object [arguments...]\n"
+        "       flbench [options] suite [suite arguments...]\n"
+        "  -r samplerate   sample rate (default 44100)\n"
+        "  -b blocksize    block size (default 64)\n"
+        "  -n blocks       number of measured blocks (default 10000)\n"
+        "  -w blocks       number of warm-up blocks (default 100)\n"
+        "  -m message      message to the left inlet after creation (repeatable)\n"
+        "  -v              show the console output of the external\n"
+    );
+}
+
+int main(int argc,char *argv[])
+{
+    double sr = 44100;
+    int blksize = 64,blocks = 10000,warmup = 100;
+    bool showpost = false;
+    std::vector<const char *> msgs;
+
+    int a = 1;
+    for(; a < argc && argv[a][0] == '-'; ++a) {
+        const char opt = argv[a][1];
+        if(opt == 'v') { showpost = true; continue; }
+        if(a+1 >= argc) { usage(); return 1; }
+        const char *val = argv[++a];
+        switch(opt) {
+            case 'r': sr = atof(val); break;
+            case 'b': blksize = atoi(val); break;
+            case 'n': blocks = atoi(val); break;
+            case 'w': warmup = atoi(val); break;
+            case 'm': msgs.push_back(val); break;
+            default: usage(); return 1;
+        }
+    }
+    if(a+1 > argc || sr <= 0 || blksize <= 0 || blocks <= 0 || warmup < 0) {
+        usage();
+        return 1;
+    }
+
+    flhost_init(sr,blksize);
+    flhost_quiet(!showpost);
+
+    // the setup function is named after the file (without path and extension)
+    const char *path = argv[a++];
+    std::string name = path;
+    const size_t slash = name.find_last_of('/');
+    if(slash != std::string::npos) name.erase(0,slash+1);
+    const size_t dot = name.find('.');
+    if(dot != std::string::npos) name.erase(dot);
+
+    if(!flhost_load(path,name.c_str())) {
+        fprintf(stderr,"flbench: couldn't load %s\n",path);
+        return 1;
+    }
+
+    // benchmark suites do the rest themselves
+    t_benchrun run = (t_benchrun)dlsym(RTLD_DEFAULT,"flbench_run");
+    if(run) return run(argc-a,argv+a);
+
+    if(a >= argc) {
+        usage();
+        return 1;
+    }
+
+    std::string line;
+    for(; a < argc; ++a) {
+        if(!line.empty()) line += ' ';
+        line += argv[a];
+    }
+
+    t_object *x = flhost_new(line.c_str());
+    if(!x) {
+        fprintf(stderr,"flbench: couldn't create %s\n",line.c_str());
+        return 1;
+    }
+
+    for(size_t i = 0; i < msgs.size(); ++i) flhost_sendtext(x,0,msgs[i]);
+
+    flhost_dsp(1);
+
+    // fixed noise on all signal inlets, the same for every run
+    unsigned int seed = 1;
+    int nin = 0,nout = 0;
+    for(int i = 0; i < obj_ninlets(x); ++i) {
+        t_sample *vec = flhost_signalin(x,i);
+        if(!vec) continue;
+        for(int j = 0; j < blksize; ++j) {
+            seed = seed*1664525+1013904223;
+            vec[j] = (t_sample)((seed>>8)*(2./16777216.)-1.);
+        }
+        ++nin;
+    }
+    std::vector<t_sample *> outs;
+    for(int i = 0; i < obj_noutlets(x); ++i) {
+        t_sample *vec = flhost_signalout(x,i);
+        if(vec) outs.push_back(vec),++nout;
+    }
+
+    flhost_tick(warmup);
+
+    const double start = sys_getrealtime();
+    flhost_tick(blocks);
+    const double elapsed = sys_getrealtime()-start;
+
+    double checksum = 0;
+    for(size_t i = 0; i < outs.size(); ++i)
+        for(int j = 0; j < blksize; ++j) checksum += fabs(outs[i][j]);
+
+    const double audio = (double)blocks*blksize/sr;
+    printf("%s: %i signal in, %i signal out, %i blocks of %i at %g Hz\n",line.c_str(),nin,nout,blocks,blksize,sr);
+    printf("time %.6f s, %.3f us/block, %.1f x realtime, checksum %.9g\n",
+        elapsed,elapsed*1.e6/blocks,elapsed > 0?audio/elapsed:0.,checksum);
+
+    flhost_dsp(0);
+    flhost_free(x);
+    return 0;
+}
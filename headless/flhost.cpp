@@ -0,0 +1,1952 @@
+/*
+flext - C++ layer for Max and Pure Data externals
+
+Copyright (c) 2001-2015 Thomas Grill (gr@grrrr.org)
+For information on usage and redistribution, and for a DISCLAIMER OF ALL
+WARRANTIES, see the file, "license.txt," in this distribution.
+*/
+
+/*! \file flhost.cpp
+    \brief Implementation of the headless flext host.
+
+    Implements the subset of the Pd API declared in m_pd.h and g_canvas.h
+    (message dispatch, inlets/outlets, clocks, arrays, the DSP chain)
+    and the driver functions of flhost.h.
+    The behavior follows Pd where flext depends on it (default methods,
+    inlet selector translation, scheduling of clocks between DSP blocks).
+*/
+
+#define PD_CLASS_DEF
+#include "flhost.h"
+#include "g_canvas.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+#include <string>
+#include <vector>
+#include <map>
+
+#include <pthread.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+//! logical time units per millisecond (as in Pd)
+#define TIMEUNITPERMS (32.*441.)
+
+//! maximum nesting of messages through outlets
+#define STACKLIMIT 1000
+
+//! alignment of signal vectors
+#define SIGALIGN 64
+
+typedef void (*t_bangmethod)(t_pd *x);
+typedef void (*t_floatmethod)(t_pd *x,t_float f);
+typedef void (*t_symbolmethod)(t_pd *x,t_symbol *s);
+typedef void (*t_pointermethod)(t_pd *x,t_gpointer *gp);
+typedef void (*t_listmethod)(t_pd *x,t_symbol *s,int argc,t_atom *argv);
+typedef void (*t_freemethod)(t_pd *x);
+typedef void (*t_dspmethod)(t_pd *x,t_signal **sp);
+typedef void (*t_clockmethod)(void *owner);
+
+// functions called with converted arguments (see pd_typedmess in Pd)
+typedef t_int (*t_fun0)(t_floatarg,t_floatarg,t_floatarg,t_floatarg,t_floatarg);
+typedef t_int (*t_fun1)(t_int,t_floatarg,t_floatarg,t_floatarg,t_floatarg,t_floatarg);
+typedef t_int (*t_fun2)(t_int,t_int,t_floatarg,t_floatarg,t_floatarg,t_floatarg,t_floatarg);
+typedef t_int (*t_fun3)(t_int,t_int,t_int,t_floatarg,t_floatarg,t_floatarg,t_floatarg,t_floatarg);
+typedef t_int (*t_fun4)(t_int,t_int,t_int,t_int,t_floatarg,t_floatarg,t_floatarg,t_floatarg,t_floatarg);
+typedef t_int (*t_fun5)(t_int,t_int,t_int,t_int,t_int,t_floatarg,t_floatarg,t_floatarg,t_floatarg,t_floatarg);
+typedef t_int (*t_fun6)(t_int,t_int,t_int,t_int,t_int,t_int,t_floatarg,t_floatarg,t_floatarg,t_floatarg,t_floatarg);
+typedef void *(*t_gimmenew)(t_symbol *s,int argc,t_atom *argv);
+
+struct t_methodentry
+{
+    t_symbol *me_name;
+    t_method me_fun;
+    t_atomtype me_arg[MAXPDARG+1];
+};
+
+struct _class
+{
+    t_symbol *c_name;
+    t_symbol *c_helpname;
+    size_t c_size;
+    bool c_patchable;
+    bool c_firstin;
+    t_method c_freemethod;
+    std::vector<t_methodentry> c_methods;
+    t_bangmethod c_bangmethod;
+    t_floatmethod c_floatmethod;
+    t_symbolmethod c_symbolmethod;
+    t_pointermethod c_pointermethod;
+    t_listmethod c_listmethod;
+    t_listmethod c_anymethod;
+    int c_floatsignalin;
+};
+
+struct t_creator
+{
+    t_newmethod cr_fun;
+    t_atomtype cr_arg[MAXPDARG+1];
+};
+
+struct _inlet
+{
+    t_object *i_owner;
+    t_pd *i_dest;
+    t_symbol *i_symfrom;
+    t_symbol *i_symto;
+    t_float *i_floatslot;
+    t_symbol **i_symbolslot;
+    t_float i_floatsignal;
+    t_inlet *i_next;
+};
+
+struct _outconnect
+{
+    t_object *oc_to;
+    int oc_inno;
+    flhost_sinkfn oc_fn;
+    void *oc_data;
+    t_outconnect *oc_next;
+};
+
+struct _outlet
+{
+    t_object *o_owner;
+    t_symbol *o_sym;
+    int o_index;
+    t_outconnect *o_connections;
+    t_outlet *o_next;
+};
+
+struct _clock
+{
+    double c_settime;  // < 0 if not set
+    void *c_owner;
+    t_method c_fn;
+    t_clock *c_next;
+};
+
+struct _binbuf
+{
+    std::vector<t_atom> b_vec;
+};
+
+struct _garray
+{
+    t_pd x_pd;
+    t_symbol *x_name;
+    t_word *x_vec;
+    int x_n;
+    bool x_usedindsp;
+};
+
+struct t_bindelem
+{
+    t_pd *e_who;
+    t_bindelem *e_next;
+};
+
+struct t_bindlist
+{
+    t_pd b_pd;
+    t_bindelem *b_list;
+};
+
+//! Signal processing state of an object in the DSP chain
+struct t_dspobj
+{
+    t_object *d_obj;
+    int d_nin,d_nout;
+    std::vector<t_signal> d_sig;
+    std::vector<t_sample *> d_vec;
+    std::vector<bool> d_external;
+    std::vector<t_float *> d_scalar;
+    std::vector<std::vector<t_sample *> > d_src;
+    std::vector<t_dspobj *> d_after;  // objects fed by this one
+    int d_pending;  // number of unscheduled objects feeding this one
+};
+
+t_symbol s_pointer = {"pointer",NULL,NULL};
+t_symbol s_float = {"float",NULL,NULL};
+t_symbol s_symbol = {"symbol",NULL,NULL};
+t_symbol s_bang = {"bang",NULL,NULL};
+t_symbol s_list = {"list",NULL,NULL};
+t_symbol s_anything = {"anything",NULL,NULL};
+t_symbol s_signal = {"signal",NULL,NULL};
+t_symbol s__N = {"#N",NULL,NULL};
+t_symbol s__X = {"#X",NULL,NULL};
+t_symbol s_x = {"x",NULL,NULL};
+t_symbol s_y = {"y",NULL,NULL};
+t_symbol s_ = {"",NULL,NULL};
+
+t_class *garray_class = NULL;
+
+static t_class *bindlist_class = NULL;
+
+static bool hostinited = false;
+static bool hostquiet = false;
+static double hostsr = 44100;
+static int hostblksize = 64;
+
+static pthread_mutex_t hostmutex;
+static pthread_mutex_t symmutex = PTHREAD_MUTEX_INITIALIZER;
+
+static std::map<std::string,t_symbol *> symtab;
+static std::map<t_symbol *,t_creator> creators;
+
+static double systime = 0;
+static t_clock *clocklist = NULL;
+
+static int stackcount = 0;
+
+static t_glist rootcanvas;
+
+static std::vector<t_object *> objects;
+
+static bool dspon = false;
+static std::vector<t_dspobj *> dspobjs;
+static std::vector<t_int> dspchain;
+static t_sample *dspdummy = NULL;
+
+static void host_init();
+static void dsp_build();
+static void dsp_clear();
+
+/* ----------------- symbols and atoms ----------------- */
+
+t_symbol *gensym(const char *s)
+{
+    pthread_mutex_lock(&symmutex);
+    if(symtab.empty()) {
+        t_symbol *const builtin[] = {&s_pointer,&s_float,&s_symbol,&s_bang,&s_list,&s_anything,&s_signal,&s__N,&s__X,&s_x,&s_y,&s_};
+        for(size_t i = 0; i < sizeof(builtin)/sizeof(*builtin); ++i)
+            symtab[builtin[i]->s_name] = builtin[i];
+    }
+
+    t_symbol *&sym = symtab[s];
+    if(!sym) {
+        sym = new t_symbol;
+        char *name = new char[strlen(s)+1];
+        strcpy(name,s);
+        sym->s_name = name;
+        sym->s_thing = NULL;
+        sym->s_next = NULL;
+    }
+    t_symbol *ret = sym;
+    pthread_mutex_unlock(&symmutex);
+    return ret;
+}
+
+t_float atom_getfloat(const t_atom *a) { return a->a_type == A_FLOAT?a->a_w.w_float:0; }
+
+t_int atom_getint(const t_atom *a) { return (t_int)atom_getfloat(a); }
+
+t_symbol *atom_getsymbol(const t_atom *a) { return a->a_type == A_SYMBOL?a->a_w.w_symbol:&s_float; }
+
+t_symbol *atom_gensym(const t_atom *a)
+{
+    if(a->a_type == A_SYMBOL) return a->a_w.w_symbol;
+    char buf[MAXPDSTRING];
+    atom_string(a,buf,sizeof buf);
+    return gensym(buf);
+}
+
+t_float atom_getfloatarg(int which,int argc,const t_atom *argv) { return which < argc?atom_getfloat(argv+which):0; }
+
+t_int atom_getintarg(int which,int argc,const t_atom *argv) { return which < argc?atom_getint(argv+which):0; }
+
+t_symbol *atom_getsymbolarg(int which,int argc,const t_atom *argv) { return which < argc?atom_getsymbol(argv+which):&s_; }
+
+void atom_string(const t_atom *a,char *buf,unsigned int bufsize)
+{
+    if(!bufsize) return;
+    switch(a->a_type) {
+        case A_FLOAT: snprintf(buf,bufsize,"%g",a->a_w.w_float); break;
+        case A_SYMBOL: case A_DOLLSYM: snprintf(buf,bufsize,"%s",a->a_w.w_symbol->s_name); break;
+        case A_SEMI: snprintf(buf,bufsize,";"); break;
+        case A_COMMA: snprintf(buf,bufsize,","); break;
+        case A_POINTER: snprintf(buf,bufsize,"(pointer)"); break;
+        case A_DOLLAR: snprintf(buf,bufsize,"$%d",a->a_w.w_index); break;
+        default: snprintf(buf,bufsize,"?"); break;
+    }
+}
+
+/* ----------------- memory ----------------- */
+
+void *getbytes(size_t nbytes) { return calloc(nbytes?nbytes:1,1); }
+
+void *getzbytes(size_t nbytes) { return getbytes(nbytes); }
+
+void *copybytes(const void *src,size_t nbytes)
+{
+    void *ret = getbytes(nbytes);
+    if(ret) memcpy(ret,src,nbytes);
+    return ret;
+}
+
+void *resizebytes(void *x,size_t oldsize,size_t newsize)
+{
+    void *ret = realloc(x,newsize?newsize:1);
+    if(ret && newsize > oldsize) memset((char *)ret+oldsize,0,newsize-oldsize);
+    return ret;
+}
+
+void freebytes(void *x,size_t) { free(x); }
+
+/* ----------------- printing ----------------- */
+
+static void vpost(const char *prefix,const char *fmt,va_list args,bool newline)
+{
+    if(hostquiet) return;
+    if(prefix) fputs(prefix,stderr);
+    vfprintf(stderr,fmt,args);
+    if(newline) fputc('\n',stderr);
+}
+
+void post(const char *fmt,...) { va_list args; va_start(args,fmt); vpost(NULL,fmt,args,true); va_end(args); }
+
+void startpost(const char *fmt,...) { va_list args; va_start(args,fmt); vpost(NULL,fmt,args,false); va_end(args); }
+
+void poststring(const char *s) { if(!hostquiet) fprintf(stderr," %s",s); }
+
+void postfloat(t_floatarg f) { if(!hostquiet) fprintf(stderr," %g",f); }
+
+void postatom(int argc,const t_atom *argv)
+{
+    char buf[MAXPDSTRING];
+    for(int i = 0; i < argc; ++i) {
+        atom_string(argv+i,buf,sizeof buf);
+        poststring(buf);
+    }
+}
+
+void endpost(void) { if(!hostquiet) fputc('\n',stderr); }
+
+void error(const char *fmt,...) { va_list args; va_start(args,fmt); vpost("error: ",fmt,args,true); va_end(args); }
+
+void verbose(int,const char *,...) {}
+
+void bug(const char *fmt,...) { va_list args; va_start(args,fmt); vpost("consistency check failed: ",fmt,args,true); va_end(args); }
+
+void pd_error(void *,const char *fmt,...) { va_list args; va_start(args,fmt); vpost("error: ",fmt,args,true); va_end(args); }
+
+/* ----------------- system ----------------- */
+
+void sys_lock(void) { pthread_mutex_lock(&hostmutex); }
+
+void sys_unlock(void) { pthread_mutex_unlock(&hostmutex); }
+
+int sys_trylock(void) { return pthread_mutex_trylock(&hostmutex) == 0; }
+
+t_float sys_getsr(void) { return (t_float)hostsr; }
+
+int sys_getblksize(void) { return hostblksize; }
+
+void sys_vgui(const char *,...) {}
+
+void sys_gui(const char *) {}
+
+double sys_getrealtime(void)
+{
+    static double start = -1;
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    double now = ts.tv_sec+ts.tv_nsec*1.e-9;
+    if(start < 0) start = now;
+    return now-start;
+}
+
+int open_via_path(const char *dir,const char *name,const char *ext,char *dirresult,char **nameresult,unsigned int size,int)
+{
+    if(name[0] == '/')
+        snprintf(dirresult,size,"%s%s",name,ext);
+    else
+        snprintf(dirresult,size,"%s/%s%s",dir && *dir?dir:".",name,ext);
+
+    int fd = open(dirresult,O_RDONLY);
+    if(fd < 0) return -1;
+
+    char *slash = strrchr(dirresult,'/');
+    if(slash) {
+        *slash = 0;
+        *nameresult = slash+1;
+    }
+    else
+        *nameresult = dirresult;
+    return fd;
+}
+
+int sys_close(int fd) { return close(fd); }
+
+/* ----------------- binbufs ----------------- */
+
+t_binbuf *binbuf_new(void) { return new t_binbuf; }
+
+void binbuf_free(t_binbuf *x) { delete x; }
+
+t_binbuf *binbuf_duplicate(const t_binbuf *y) { return new t_binbuf(*y); }
+
+void binbuf_clear(t_binbuf *x) { x->b_vec.clear(); }
+
+void binbuf_add(t_binbuf *x,int argc,const t_atom *argv) { x->b_vec.insert(x->b_vec.end(),argv,argv+argc); }
+
+void binbuf_addsemi(t_binbuf *x)
+{
+    t_atom a;
+    SETSEMI(&a);
+    x->b_vec.push_back(a);
+}
+
+void binbuf_addv(t_binbuf *x,const char *fmt,...)
+{
+    va_list args;
+    va_start(args,fmt);
+    for(; *fmt; ++fmt) {
+        t_atom a;
+        switch(*fmt) {
+            case 'i': SETFLOAT(&a,(t_float)va_arg(args,int)); break;
+            case 'f': SETFLOAT(&a,(t_float)va_arg(args,double)); break;
+            case 's': SETSYMBOL(&a,va_arg(args,t_symbol *)); break;
+            case 't': SETSYMBOL(&a,gensym(va_arg(args,const char *))); break;
+            case 'p': SETPOINTER(&a,va_arg(args,t_gpointer *)); break;
+            case ';': SETSEMI(&a); break;
+            case ',': SETCOMMA(&a); break;
+            default: continue;
+        }
+        x->b_vec.push_back(a);
+    }
+    va_end(args);
+}
+
+void binbuf_text(t_binbuf *x,const char *text,size_t size)
+{
+    x->b_vec.clear();
+    const char *end = text+size;
+    std::string tok;
+    while(text < end) {
+        // skip white space
+        while(text < end && (*text == ' ' || *text == '\t' || *text == '\n' || *text == '\r')) ++text;
+        if(text == end) break;
+
+        t_atom a;
+        if(*text == ';' || *text == ',') {
+            if(*text == ';') SETSEMI(&a); else SETCOMMA(&a);
+            x->b_vec.push_back(a);
+            ++text;
+            continue;
+        }
+
+        tok.clear();
+        bool escaped = false;
+        while(text < end && *text != ' ' && *text != '\t' && *text != '\n' && *text != '\r' && *text != ';' && *text != ',') {
+            if(*text == '\\' && text+1 < end) {
+                ++text;
+                escaped = true;
+            }
+            tok += *text++;
+        }
+
+        char *numend;
+        double f = strtod(tok.c_str(),&numend);
+        if(!escaped && !*numend && numend != tok.c_str())
+            SETFLOAT(&a,(t_float)f);
+        else if(!escaped && tok[0] == '$' && tok.size() > 1 && tok.find_first_not_of("0123456789",1) == std::string::npos)
+            SETDOLLAR(&a,atoi(tok.c_str()+1));
+        else
+            SETSYMBOL(&a,gensym(tok.c_str()));
+        x->b_vec.push_back(a);
+    }
+}
+
+int binbuf_getnatom(const t_binbuf *x) { return (int)x->b_vec.size(); }
+
+t_atom *binbuf_getvec(const t_binbuf *x) { return x->b_vec.empty()?NULL:const_cast<t_atom *>(&x->b_vec[0]); }
+
+//! Send a message given as atoms, a leading float makes it a list
+static void sendatoms(t_pd *target,int argc,t_atom *argv)
+{
+    if(!argc) return;
+    if(argv->a_type == A_SYMBOL)
+        pd_typedmess(target,argv->a_w.w_symbol,argc-1,argv+1);
+    else if(argc == 1 && argv->a_type == A_FLOAT)
+        pd_float(target,argv->a_w.w_float);
+    else
+        pd_list(target,&s_list,argc,argv);
+}
+
+void binbuf_eval(const t_binbuf *x,t_pd *target,int argc,const t_atom *argv)
+{
+    std::vector<t_atom> msg;
+    // without a target, the first atom after a semicolon names the receiver
+    t_pd *to = target;
+    bool receiver = !target;
+    const size_t n = x->b_vec.size();
+    for(size_t i = 0; i <= n; ++i) {
+        const bool sep = i == n || x->b_vec[i].a_type == A_SEMI || x->b_vec[i].a_type == A_COMMA;
+        if(!sep) {
+            t_atom a = x->b_vec[i];
+            if(a.a_type == A_DOLLAR) {
+                const int ix = a.a_w.w_index;
+                if(ix > 0 && ix <= argc) a = argv[ix-1];
+                else SETFLOAT(&a,0);
+            }
+            msg.push_back(a);
+            continue;
+        }
+
+        if(!msg.empty()) {
+            t_atom *v = &msg[0];
+            int c = (int)msg.size();
+            if(receiver) {
+                if(v->a_type == A_SYMBOL && v->a_w.w_symbol->s_thing)
+                    to = v->a_w.w_symbol->s_thing;
+                else {
+                    error("%s: no such object",v->a_type == A_SYMBOL?v->a_w.w_symbol->s_name:"?");
+                    to = NULL;
+                }
+                ++v,--c;
+                receiver = false;
+            }
+            if(to) sendatoms(to,c,v);
+            msg.clear();
+        }
+        if(i < n && x->b_vec[i].a_type == A_SEMI && !target) receiver = true;
+    }
+}
+
+/* ----------------- clocks ----------------- */
+
+t_clock *clock_new(void *owner,t_method fn)
+{
+    t_clock *x = new t_clock;
+    x->c_settime = -1;
+    x->c_owner = owner;
+    x->c_fn = fn;
+    x->c_next = NULL;
+    return x;
+}
+
+void clock_unset(t_clock *x)
+{
+    if(x->c_settime < 0) return;
+    if(clocklist == x)
+        clocklist = x->c_next;
+    else {
+        t_clock *c = clocklist;
+        while(c->c_next != x) c = c->c_next;
+        c->c_next = x->c_next;
+    }
+    x->c_settime = -1;
+}
+
+void clock_set(t_clock *x,double settime)
+{
+    if(settime < systime) settime = systime;
+    clock_unset(x);
+    x->c_settime = settime;
+
+    // clocks due at the same time fire in the order they were set
+    if(!clocklist || clocklist->c_settime > settime) {
+        x->c_next = clocklist;
+        clocklist = x;
+    }
+    else {
+        t_clock *c = clocklist;
+        while(c->c_next && c->c_next->c_settime <= settime) c = c->c_next;
+        x->c_next = c->c_next;
+        c->c_next = x;
+    }
+}
+
+void clock_delay(t_clock *x,double delaytime) { clock_set(x,systime+(delaytime > 0?delaytime:0)*TIMEUNITPERMS); }
+
+void clock_free(t_clock *x)
+{
+    clock_unset(x);
+    delete x;
+}
+
+double clock_getlogicaltime(void) { return systime; }
+
+double clock_getsystime(void) { return systime; }
+
+double clock_gettimesince(double prevsystime) { return (systime-prevsystime)/TIMEUNITPERMS; }
+
+double clock_getsystimeafter(double delaytime) { return systime+delaytime*TIMEUNITPERMS; }
+
+/* ----------------- message dispatch ----------------- */
+
+static void pd_defaultanything(t_pd *x,t_symbol *s,int,t_atom *)
+{
+    error("%s: no method for '%s'",(*x)->c_name->s_name,s->s_name);
+}
+
+static void pd_defaultlist(t_pd *x,t_symbol *s,int argc,t_atom *argv);
+
+static void pd_defaultbang(t_pd *x)
+{
+    if((*x)->c_listmethod != pd_defaultlist)
+        (*x)->c_listmethod(x,NULL,0,NULL);
+    else
+        (*x)->c_anymethod(x,&s_bang,0,NULL);
+}
+
+static void pd_defaultfloat(t_pd *x,t_float f)
+{
+    t_atom at;
+    SETFLOAT(&at,f);
+    if((*x)->c_listmethod != pd_defaultlist)
+        (*x)->c_listmethod(x,NULL,1,&at);
+    else
+        (*x)->c_anymethod(x,&s_float,1,&at);
+}
+
+static void pd_defaultsymbol(t_pd *x,t_symbol *s)
+{
+    t_atom at;
+    SETSYMBOL(&at,s);
+    if((*x)->c_listmethod != pd_defaultlist)
+        (*x)->c_listmethod(x,NULL,1,&at);
+    else
+        (*x)->c_anymethod(x,&s_symbol,1,&at);
+}
+
+static void pd_defaultpointer(t_pd *x,t_gpointer *gp)
+{
+    t_atom at;
+    SETPOINTER(&at,gp);
+    if((*x)->c_listmethod != pd_defaultlist)
+        (*x)->c_listmethod(x,NULL,1,&at);
+    else
+        (*x)->c_anymethod(x,&s_pointer,1,&at);
+}
+
+static void obj_sendinlet(t_object *x,int n,t_symbol *s,int argc,t_atom *argv);
+
+static void pd_defaultlist(t_pd *x,t_symbol *,int argc,t_atom *argv)
+{
+    t_class *c = *x;
+    if(argc == 0 && c->c_bangmethod != pd_defaultbang)
+        c->c_bangmethod(x);
+    else if(argc == 1 && argv->a_type == A_FLOAT && c->c_floatmethod != pd_defaultfloat)
+        c->c_floatmethod(x,argv->a_w.w_float);
+    else if(argc == 1 && argv->a_type == A_SYMBOL && c->c_symbolmethod != pd_defaultsymbol)
+        c->c_symbolmethod(x,argv->a_w.w_symbol);
+    else if(c->c_anymethod != pd_defaultanything)
+        c->c_anymethod(x,&s_list,argc,argv);
+    else if(c->c_patchable) {
+        // distribute the list over the inlets, right to left
+        t_object *o = (t_object *)x;
+        const int n = obj_ninlets(o);
+        if(argc > n) argc = n;
+        for(int i = argc-1; i >= 0; --i) {
+            if(argv[i].a_type == A_FLOAT)
+                obj_sendinlet(o,i,&s_float,1,argv+i);
+            else if(argv[i].a_type == A_SYMBOL)
+                obj_sendinlet(o,i,&s_symbol,1,argv+i);
+        }
+    }
+    else
+        pd_defaultanything(x,&s_list,argc,argv);
+}
+
+//! Float into the main signal inlet sets its scalar
+static void pd_floatforsignal(t_pd *x,t_float f)
+{
+    *(t_float *)((char *)x+(*x)->c_floatsignalin) = f;
+}
+
+//! Call a function with arguments converted according to the given types
+static bool callmethod(t_method fn,const t_atomtype *types,t_pd *self,const char *name,t_symbol *s,int argc,t_atom *argv,t_int *result)
+{
+    t_int ai[MAXPDARG+1];
+    t_floatarg ad[MAXPDARG+1];
+    int ni = 0,nd = 0;
+
+    if(self) ai[ni++] = (t_int)self;
+
+    for(const t_atomtype *wp = types; *wp != A_NULL; ++wp) {
+        switch(*wp) {
+            case A_POINTER:
+                if(!argc || argv->a_type != A_POINTER) goto badarg;
+                if(ni > MAXPDARG) goto badarg;
+                ai[ni++] = (t_int)argv->a_w.w_gpointer;
+                --argc,++argv;
+                break;
+            case A_FLOAT:
+                if(!argc) goto badarg;
+                // fall through
+            case A_DEFFLOAT:
+                if(nd >= MAXPDARG) goto badarg;
+                if(!argc) ad[nd++] = 0;
+                else if(argv->a_type == A_FLOAT) {
+                    ad[nd++] = argv->a_w.w_float;
+                    --argc,++argv;
+                }
+                else goto badarg;
+                break;
+            case A_SYMBOL:
+                if(!argc) goto badarg;
+                // fall through
+            case A_DEFSYM:
+                if(ni > MAXPDARG) goto badarg;
+                if(!argc) ai[ni++] = (t_int)&s_;
+                else if(argv->a_type == A_SYMBOL) {
+                    ai[ni++] = (t_int)argv->a_w.w_symbol;
+                    --argc,++argv;
+                }
+                // a zero float is an empty symbol (as in Pd)
+                else if(argv->a_type == A_FLOAT && argv->a_w.w_float == 0) {
+                    ai[ni++] = (t_int)&s_;
+                    --argc,++argv;
+                }
+                else goto badarg;
+                break;
+            default:
+                goto badarg;
+        }
+    }
+
+    for(int i = nd; i < MAXPDARG; ++i) ad[i] = 0;
+
+    t_int r;
+    switch(ni) {
+        case 0: r = ((t_fun0)fn)(ad[0],ad[1],ad[2],ad[3],ad[4]); break;
+        case 1: r = ((t_fun1)fn)(ai[0],ad[0],ad[1],ad[2],ad[3],ad[4]); break;
+        case 2: r = ((t_fun2)fn)(ai[0],ai[1],ad[0],ad[1],ad[2],ad[3],ad[4]); break;
+        case 3: r = ((t_fun3)fn)(ai[0],ai[1],ai[2],ad[0],ad[1],ad[2],ad[3],ad[4]); break;
+        case 4: r = ((t_fun4)fn)(ai[0],ai[1],ai[2],ai[3],ad[0],ad[1],ad[2],ad[3],ad[4]); break;
+        case 5: r = ((t_fun5)fn)(ai[0],ai[1],ai[2],ai[3],ai[4],ad[0],ad[1],ad[2],ad[3],ad[4]); break;
+        default: r = ((t_fun6)fn)(ai[0],ai[1],ai[2],ai[3],ai[4],ai[5],ad[0],ad[1],ad[2],ad[3],ad[4]); break;
+    }
+    if(result) *result = r;
+    return true;
+
+badarg:
+    error("%s: bad arguments for message '%s'",name,s->s_name);
+    return false;
+}
+
+void pd_typedmess(t_pd *x,t_symbol *s,int argc,t_atom *argv)
+{
+    t_class *c = *x;
+
+    if(s == &s_float) {
+        if(!argc) c->c_floatmethod(x,0);
+        else if(argv->a_type == A_FLOAT) c->c_floatmethod(x,argv->a_w.w_float);
+        else error("%s: float: bad argument",c->c_name->s_name);
+        return;
+    }
+    if(s == &s_bang) {
+        c->c_bangmethod(x);
+        return;
+    }
+    if(s == &s_list) {
+        c->c_listmethod(x,s,argc,argv);
+        return;
+    }
+    if(s == &s_symbol) {
+        c->c_symbolmethod(x,argc && argv->a_type == A_SYMBOL?argv->a_w.w_symbol:&s_);
+        return;
+    }
+    if(s == &s_pointer) {
+        if(argc && argv->a_type == A_POINTER) c->c_pointermethod(x,argv->a_w.w_gpointer);
+        else error("%s: pointer: bad argument",c->c_name->s_name);
+        return;
+    }
+
+    for(size_t i = 0; i < c->c_methods.size(); ++i) {
+        const t_methodentry &m = c->c_methods[i];
+        if(m.me_name != s) continue;
+
+        if(m.me_arg[0] == A_GIMME)
+            ((t_listmethod)m.me_fun)(x,s,argc,argv);
+        else if(m.me_arg[0] == A_CANT)
+            error("%s: '%s' can't be sent as a message",c->c_name->s_name,s->s_name);
+        else
+            callmethod(m.me_fun,m.me_arg,x,c->c_name->s_name,s,argc,argv,NULL);
+        return;
+    }
+
+    c->c_anymethod(x,s,argc,argv);
+}
+
+void pd_forwardmess(t_pd *x,int argc,t_atom *argv)
+{
+    if(argc && argv->a_type == A_SYMBOL)
+        pd_typedmess(x,argv->a_w.w_symbol,argc-1,argv+1);
+}
+
+void pd_vmess(t_pd *x,t_symbol *s,const char *fmt,...)
+{
+    std::vector<t_atom> args;
+    va_list ap;
+    va_start(ap,fmt);
+    for(; *fmt; ++fmt) {
+        t_atom a;
+        switch(*fmt) {
+            case 'f': SETFLOAT(&a,(t_float)va_arg(ap,double)); break;
+            case 'i': SETFLOAT(&a,(t_float)va_arg(ap,t_int)); break;
+            case 's': SETSYMBOL(&a,va_arg(ap,t_symbol *)); break;
+            case 'p': SETPOINTER(&a,va_arg(ap,t_gpointer *)); break;
+            default: continue;
+        }
+        args.push_back(a);
+    }
+    va_end(ap);
+    pd_typedmess(x,s,(int)args.size(),args.empty()?NULL:&args[0]);
+}
+
+void pd_bang(t_pd *x) { (*x)->c_bangmethod(x); }
+
+void pd_float(t_pd *x,t_float f) { (*x)->c_floatmethod(x,f); }
+
+void pd_symbol(t_pd *x,t_symbol *s) { (*x)->c_symbolmethod(x,s); }
+
+void pd_list(t_pd *x,t_symbol *s,int argc,t_atom *argv) { (*x)->c_listmethod(x,s,argc,argv); }
+
+static void nullfn(void *,...) {}
+
+t_gotfn zgetfn(const t_pd *x,t_symbol *s)
+{
+    const t_class *c = *x;
+    for(size_t i = 0; i < c->c_methods.size(); ++i)
+        if(c->c_methods[i].me_name == s) return (t_gotfn)c->c_methods[i].me_fun;
+    return NULL;
+}
+
+t_gotfn getfn(const t_pd *x,t_symbol *s)
+{
+    t_gotfn fn = zgetfn(x,s);
+    if(fn) return fn;
+    error("%s: no method for message '%s'",(*x)->c_name->s_name,s->s_name);
+    return nullfn;
+}
+
+t_float pd_getdspstate(void) { return dspon?1:0; }
+
+/* ----------------- classes ----------------- */
+
+static void getargtypes(t_atomtype *dst,t_atomtype first,va_list ap)
+{
+    int n = 0;
+    for(t_atomtype t = first; t != A_NULL && n < MAXPDARG; t = (t_atomtype)va_arg(ap,int))
+        dst[n++] = t;
+    dst[n] = A_NULL;
+}
+
+t_class *class_new(t_symbol *name,t_newmethod newmethod,t_method freemethod,size_t size,int flags,t_atomtype arg1,...)
+{
+    host_init();
+
+    t_class *c = new t_class;
+    c->c_name = c->c_helpname = name?name:&s_;
+    c->c_size = size;
+    // the default type is patchable
+    const int type = (flags&CLASS_TYPEMASK)?(flags&CLASS_TYPEMASK):CLASS_PATCHABLE;
+    c->c_patchable = type == CLASS_PATCHABLE;
+    c->c_firstin = !(flags&CLASS_NOINLET);
+    c->c_freemethod = freemethod;
+    c->c_bangmethod = pd_defaultbang;
+    c->c_floatmethod = pd_defaultfloat;
+    c->c_symbolmethod = pd_defaultsymbol;
+    c->c_pointermethod = pd_defaultpointer;
+    c->c_listmethod = pd_defaultlist;
+    c->c_anymethod = pd_defaultanything;
+    c->c_floatsignalin = 0;
+
+    if(newmethod && name) {
+        t_creator &cr = creators[name];
+        cr.cr_fun = newmethod;
+        va_list ap;
+        va_start(ap,arg1);
+        getargtypes(cr.cr_arg,arg1,ap);
+        va_end(ap);
+    }
+    return c;
+}
+
+void class_addcreator(t_newmethod newmethod,t_symbol *s,t_atomtype type1,...)
+{
+    t_creator &cr = creators[s];
+    cr.cr_fun = newmethod;
+    va_list ap;
+    va_start(ap,type1);
+    getargtypes(cr.cr_arg,type1,ap);
+    va_end(ap);
+}
+
+void class_addbang(t_class *c,t_method fn) { c->c_bangmethod = (t_bangmethod)fn; }
+
+void class_addpointer(t_class *c,t_method fn) { c->c_pointermethod = (t_pointermethod)fn; }
+
+void class_doaddfloat(t_class *c,t_method fn) { c->c_floatmethod = (t_floatmethod)fn; }
+
+void class_addsymbol(t_class *c,t_method fn) { c->c_symbolmethod = (t_symbolmethod)fn; }
+
+void class_addlist(t_class *c,t_method fn) { c->c_listmethod = (t_listmethod)fn; }
+
+void class_addanything(t_class *c,t_method fn) { c->c_anymethod = (t_listmethod)fn; }
+
+void class_addmethod(t_class *c,t_method fn,t_symbol *sel,t_atomtype arg1,...)
+{
+    t_methodentry m;
+    m.me_name = sel;
+    m.me_fun = fn;
+    va_list ap;
+    va_start(ap,arg1);
+    getargtypes(m.me_arg,arg1,ap);
+    va_end(ap);
+
+    // the basic selectors go to the special methods (as in Pd)
+    if(sel == &s_bang && m.me_arg[0] == A_NULL)
+        class_addbang(c,fn);
+    else if(sel == &s_float && m.me_arg[0] == A_FLOAT && m.me_arg[1] == A_NULL)
+        class_doaddfloat(c,fn);
+    else if(sel == &s_symbol && m.me_arg[0] == A_SYMBOL && m.me_arg[1] == A_NULL)
+        class_addsymbol(c,fn);
+    else if(sel == &s_list && m.me_arg[0] == A_GIMME)
+        class_addlist(c,fn);
+    else if(sel == &s_anything && m.me_arg[0] == A_GIMME)
+        class_addanything(c,fn);
+    else {
+        for(size_t i = 0; i < c->c_methods.size(); ++i)
+            if(c->c_methods[i].me_name == sel) {
+                // later definitions replace earlier ones
+                c->c_methods[i] = m;
+                return;
+            }
+        c->c_methods.push_back(m);
+    }
+}
+
+void class_sethelpsymbol(t_class *c,t_symbol *s) { c->c_helpname = s; }
+
+void class_domainsignalin(t_class *c,int onset)
+{
+    c->c_floatsignalin = onset;
+    if(c->c_floatmethod == pd_defaultfloat)
+        c->c_floatmethod = pd_floatforsignal;
+}
+
+const char *class_getname(const t_class *c) { return c->c_name->s_name; }
+
+/* ----------------- objects ----------------- */
+
+t_pd *pd_new(t_class *c)
+{
+    t_pd *x = (t_pd *)getbytes(c->c_size);
+    *x = c;
+    if(c->c_patchable) {
+        t_object *o = (t_object *)x;
+        o->te_inlet = NULL;
+        o->te_outlet = NULL;
+        o->te_binbuf = NULL;
+    }
+    return x;
+}
+
+void pd_free(t_pd *x)
+{
+    t_class *c = *x;
+    if(c->c_freemethod) ((t_freemethod)c->c_freemethod)(x);
+    if(c->c_patchable) {
+        t_object *o = (t_object *)x;
+        while(o->te_outlet) outlet_free(o->te_outlet);
+        while(o->te_inlet) inlet_free(o->te_inlet);
+        if(o->te_binbuf) binbuf_free(o->te_binbuf);
+    }
+    freebytes(x,c->c_size);
+}
+
+static void bindlist_anything(t_pd *x,t_symbol *s,int argc,t_atom *argv)
+{
+    // the receivers may unbind themselves
+    std::vector<t_pd *> who;
+    for(t_bindelem *e = ((t_bindlist *)x)->b_list; e; e = e->e_next) who.push_back(e->e_who);
+    for(size_t i = 0; i < who.size(); ++i) pd_typedmess(who[i],s,argc,argv);
+}
+
+void pd_bind(t_pd *x,t_symbol *s)
+{
+    if(!s->s_thing) {
+        s->s_thing = x;
+        return;
+    }
+
+    t_bindlist *b;
+    if(*s->s_thing == bindlist_class)
+        b = (t_bindlist *)s->s_thing;
+    else {
+        b = (t_bindlist *)pd_new(bindlist_class);
+        b->b_list = new t_bindelem;
+        b->b_list->e_who = s->s_thing;
+        b->b_list->e_next = NULL;
+        s->s_thing = &b->b_pd;
+    }
+
+    t_bindelem *e = new t_bindelem;
+    e->e_who = x;
+    e->e_next = b->b_list;
+    b->b_list = e;
+}
+
+void pd_unbind(t_pd *x,t_symbol *s)
+{
+    if(s->s_thing == x) {
+        s->s_thing = NULL;
+        return;
+    }
+
+    if(s->s_thing && *s->s_thing == bindlist_class) {
+        t_bindlist *b = (t_bindlist *)s->s_thing;
+        for(t_bindelem **e = &b->b_list; *e; e = &(*e)->e_next)
+            if((*e)->e_who == x) {
+                t_bindelem *r = *e;
+                *e = r->e_next;
+                delete r;
+                break;
+            }
+
+        if(b->b_list && !b->b_list->e_next) {
+            // only one left
+            s->s_thing = b->b_list->e_who;
+            delete b->b_list;
+            freebytes(b,sizeof(*b));
+        }
+        return;
+    }
+
+    error("%s: couldn't unbind",s->s_name);
+}
+
+t_pd *pd_findbyclass(t_symbol *s,const t_class *c)
+{
+    if(!s->s_thing) return NULL;
+    if(*s->s_thing == c) return s->s_thing;
+    if(*s->s_thing != bindlist_class) return NULL;
+
+    t_pd *found = NULL;
+    for(t_bindelem *e = ((t_bindlist *)s->s_thing)->b_list; e; e = e->e_next)
+        if(*e->e_who == c) {
+            if(found) post("warning: %s: multiply defined",s->s_name);
+            found = e->e_who;
+        }
+    return found;
+}
+
+/* ----------------- inlets and outlets ----------------- */
+
+static t_inlet *inlet_append(t_object *owner)
+{
+    t_inlet *x = new t_inlet;
+    memset(x,0,sizeof(*x));
+    x->i_owner = owner;
+
+    t_inlet **i = &owner->te_inlet;
+    while(*i) i = &(*i)->i_next;
+    *i = x;
+    return x;
+}
+
+t_inlet *inlet_new(t_object *owner,t_pd *dest,t_symbol *s1,t_symbol *s2)
+{
+    t_inlet *x = inlet_append(owner);
+    x->i_dest = dest;
+    x->i_symfrom = s1;
+    x->i_symto = s2;
+    return x;
+}
+
+t_inlet *floatinlet_new(t_object *owner,t_float *fp)
+{
+    t_inlet *x = inlet_append(owner);
+    x->i_symfrom = &s_float;
+    x->i_floatslot = fp;
+    return x;
+}
+
+t_inlet *symbolinlet_new(t_object *owner,t_symbol **sp)
+{
+    t_inlet *x = inlet_append(owner);
+    x->i_symfrom = &s_symbol;
+    x->i_symbolslot = sp;
+    return x;
+}
+
+void inlet_free(t_inlet *x)
+{
+    t_inlet **i = &x->i_owner->te_inlet;
+    while(*i != x) i = &(*i)->i_next;
+    *i = x->i_next;
+    delete x;
+}
+
+static void inlet_deliver(t_inlet *x,t_symbol *s,int argc,t_atom *argv)
+{
+    // a list with one element counts as that element
+    if(s == &s_list && argc == 1) {
+        if(argv->a_type == A_FLOAT) s = &s_float;
+        else if(argv->a_type == A_SYMBOL) s = &s_symbol;
+    }
+
+    if(x->i_floatslot) {
+        if(s == &s_float && argc) *x->i_floatslot = atom_getfloat(argv);
+        else error("inlet: expected 'float' but got '%s'",s->s_name);
+    }
+    else if(x->i_symbolslot) {
+        if(s == &s_symbol && argc) *x->i_symbolslot = atom_getsymbol(argv);
+        else error("inlet: expected 'symbol' but got '%s'",s->s_name);
+    }
+    else if(x->i_symfrom == &s_signal) {
+        if(s == &s_float && argc) x->i_floatsignal = atom_getfloat(argv);
+        else error("inlet: expected 'signal' but got '%s'",s->s_name);
+    }
+    else if(!x->i_symfrom)
+        pd_typedmess(x->i_dest,s,argc,argv);
+    else if(s == x->i_symfrom)
+        pd_typedmess(x->i_dest,x->i_symto,argc,argv);
+    else if(x->i_symfrom == &s_list && (s == &s_float || s == &s_symbol || s == &s_bang || s == &s_pointer))
+        pd_typedmess(x->i_dest,s,argc,argv);
+    else
+        error("inlet: expected '%s' but got '%s'",x->i_symfrom->s_name,s->s_name);
+}
+
+//! Get the inlet object of a non-leftmost (or a leftmost without main inlet) inlet
+static t_inlet *obj_getinlet(const t_object *x,int n)
+{
+    if((*x->ob_pd).c_firstin) {
+        if(!n) return NULL;
+        --n;
+    }
+    t_inlet *i = x->te_inlet;
+    for(; i && n; i = i->i_next,--n) {}
+    return i;
+}
+
+static void obj_sendinlet(t_object *x,int n,t_symbol *s,int argc,t_atom *argv)
+{
+    if(n == 0 && x->ob_pd->c_firstin)
+        pd_typedmess(&x->ob_pd,s,argc,argv);
+    else {
+        t_inlet *i = obj_getinlet(x,n);
+        if(i) inlet_deliver(i,s,argc,argv);
+        else error("%s: no inlet %i",x->ob_pd->c_name->s_name,n);
+    }
+}
+
+t_outlet *outlet_new(t_object *owner,t_symbol *s)
+{
+    t_outlet *x = new t_outlet;
+    x->o_owner = owner;
+    x->o_sym = s;
+    x->o_connections = NULL;
+    x->o_next = NULL;
+    x->o_index = 0;
+
+    t_outlet **o = &owner->te_outlet;
+    for(; *o; o = &(*o)->o_next) ++x->o_index;
+    *o = x;
+    return x;
+}
+
+void outlet_free(t_outlet *x)
+{
+    while(x->o_connections) {
+        t_outconnect *c = x->o_connections;
+        x->o_connections = c->oc_next;
+        delete c;
+    }
+
+    t_outlet **o = &x->o_owner->te_outlet;
+    while(*o != x) o = &(*o)->o_next;
+    *o = x->o_next;
+    delete x;
+}
+
+t_symbol *outlet_getsymbol(t_outlet *x) { return x->o_sym; }
+
+static void outlet_deliver(t_outlet *x,t_symbol *s,int argc,t_atom *argv)
+{
+    if(++stackcount >= STACKLIMIT)
+        error("%s: stack overflow",x->o_owner->ob_pd->c_name->s_name);
+    else {
+        for(t_outconnect *c = x->o_connections; c; c = c->oc_next) {
+            if(c->oc_fn)
+                c->oc_fn(c->oc_data,x->o_owner,x->o_index,s,argc,argv);
+            else
+                obj_sendinlet(c->oc_to,c->oc_inno,s,argc,argv);
+        }
+    }
+    --stackcount;
+}
+
+void outlet_bang(t_outlet *x) { outlet_deliver(x,&s_bang,0,NULL); }
+
+void outlet_pointer(t_outlet *x,t_gpointer *gp)
+{
+    t_atom a;
+    SETPOINTER(&a,gp);
+    outlet_deliver(x,&s_pointer,1,&a);
+}
+
+void outlet_float(t_outlet *x,t_float f)
+{
+    t_atom a;
+    SETFLOAT(&a,f);
+    outlet_deliver(x,&s_float,1,&a);
+}
+
+void outlet_symbol(t_outlet *x,t_symbol *s)
+{
+    t_atom a;
+    SETSYMBOL(&a,s);
+    outlet_deliver(x,&s_symbol,1,&a);
+}
+
+void outlet_list(t_outlet *x,t_symbol *,int argc,t_atom *argv) { outlet_deliver(x,&s_list,argc,argv); }
+
+void outlet_anything(t_outlet *x,t_symbol *s,int argc,t_atom *argv) { outlet_deliver(x,s,argc,argv); }
+
+static t_outlet *obj_getoutlet(const t_object *x,int n)
+{
+    t_outlet *o = x->te_outlet;
+    for(; o && n; o = o->o_next,--n) {}
+    return o;
+}
+
+int obj_ninlets(const t_object *x)
+{
+    int n = x->ob_pd->c_firstin?1:0;
+    for(t_inlet *i = x->te_inlet; i; i = i->i_next) ++n;
+    return n;
+}
+
+int obj_noutlets(const t_object *x)
+{
+    int n = 0;
+    for(t_outlet *o = x->te_outlet; o; o = o->o_next) ++n;
+    return n;
+}
+
+int obj_issignalinlet(const t_object *x,int m)
+{
+    if(m == 0 && x->ob_pd->c_firstin) return x->ob_pd->c_floatsignalin != 0;
+    t_inlet *i = obj_getinlet(x,m);
+    return i && i->i_symfrom == &s_signal && !i->i_floatslot;
+}
+
+int obj_issignaloutlet(const t_object *x,int m)
+{
+    t_outlet *o = obj_getoutlet(x,m);
+    return o && o->o_sym == &s_signal;
+}
+
+int obj_nsiginlets(const t_object *x)
+{
+    int n = 0;
+    const int cnt = obj_ninlets(x);
+    for(int i = 0; i < cnt; ++i) n += obj_issignalinlet(x,i);
+    return n;
+}
+
+int obj_nsigoutlets(const t_object *x)
+{
+    int n = 0;
+    for(t_outlet *o = x->te_outlet; o; o = o->o_next) n += o->o_sym == &s_signal;
+    return n;
+}
+
+//! Index of an inlet among the signal inlets
+static int obj_siginletindex(const t_object *x,int m)
+{
+    int n = 0;
+    for(int i = 0; i < m; ++i) n += obj_issignalinlet(x,i);
+    return n;
+}
+
+//! Index of an outlet among the signal outlets
+static int obj_sigoutletindex(const t_object *x,int m)
+{
+    int n = 0;
+    for(t_outlet *o = x->te_outlet; o && m; o = o->o_next,--m) n += o->o_sym == &s_signal;
+    return n;
+}
+
+t_outconnect *obj_starttraverseoutlet(const t_object *x,t_outlet **op,int nout)
+{
+    t_outlet *o = obj_getoutlet(x,nout);
+    *op = o;
+    return o?o->o_connections:NULL;
+}
+
+t_outconnect *obj_nexttraverseoutlet(t_outconnect *lastconnect,t_object **destp,t_inlet **inletp,int *whichp)
+{
+    *destp = lastconnect->oc_to;
+    *inletp = lastconnect->oc_to?obj_getinlet(lastconnect->oc_to,lastconnect->oc_inno):NULL;
+    *whichp = lastconnect->oc_inno;
+    return lastconnect->oc_next;
+}
+
+/* ----------------- canvases ----------------- */
+
+t_canvas *canvas_getcurrent(void) { return &rootcanvas; }
+
+void canvas_setcurrent(t_glist *) {}
+
+void canvas_unsetcurrent(t_glist *) {}
+
+void linetraverser_start(t_linetraverser *t,t_canvas *x)
+{
+    memset(t,0,sizeof(*t));
+    t->tr_x = x;
+}
+
+t_outconnect *linetraverser_next(t_linetraverser *t)
+{
+    t_outconnect *c = t->tr_nextoc;
+    while(!c) {
+        if(t->tr_ob && t->tr_outno+1 < t->tr_nout) {
+            c = obj_starttraverseoutlet(t->tr_ob,&t->tr_outlet,++t->tr_outno);
+            continue;
+        }
+
+        // all objects are on the root canvas
+        size_t i = 0;
+        if(t->tr_ob) {
+            while(i < objects.size() && objects[i] != t->tr_ob) ++i;
+            ++i;
+        }
+        if(t->tr_x != &rootcanvas || i >= objects.size()) return NULL;
+        t->tr_ob = objects[i];
+        t->tr_nout = obj_noutlets(t->tr_ob);
+        t->tr_outno = -1;
+    }
+    t->tr_nextoc = obj_nexttraverseoutlet(c,&t->tr_ob2,&t->tr_inlet,&t->tr_inno);
+    t->tr_nin = t->tr_ob2?obj_ninlets(t->tr_ob2):0;
+    return c;
+}
+
+t_symbol *canvas_getcurrentdir(void) { return canvas_getdir(&rootcanvas); }
+
+t_symbol *canvas_getdir(const t_glist *)
+{
+    static t_symbol *dir = NULL;
+    if(!dir) {
+        char buf[MAXPDSTRING];
+        dir = gensym(getcwd(buf,sizeof buf)?buf:".");
+    }
+    return dir;
+}
+
+void canvas_getargs(int *argcp,t_atom **argvp)
+{
+    *argcp = 0;
+    *argvp = NULL;
+}
+
+t_symbol *canvas_realizedollar(t_glist *,t_symbol *s) { return s; }
+
+void canvas_makefilename(const t_glist *c,const char *file,char *result,int resultsize)
+{
+    if(file[0] == '/')
+        snprintf(result,resultsize,"%s",file);
+    else
+        snprintf(result,resultsize,"%s/%s",canvas_getdir(c)->s_name,file);
+}
+
+int canvas_isabstraction(const t_glist *) { return 0; }
+
+int glist_isvisible(t_glist *) { return 0; }
+
+void gfxstub_new(t_pd *,void *,const char *) {}
+
+void gfxstub_deleteforkey(void *) {}
+
+/* ----------------- arrays ----------------- */
+
+int garray_getfloatwords(t_garray *x,int *size,t_word **vec)
+{
+    *size = x->x_n;
+    *vec = x->x_vec;
+    return 1;
+}
+
+int garray_getfloatarray(t_garray *x,int *size,t_float **vec)
+{
+    if(sizeof(t_word) != sizeof(t_float)) {
+        error("%s: t_word is not t_float, use garray_getfloatwords",x->x_name->s_name);
+        return 0;
+    }
+    *size = x->x_n;
+    *vec = (t_float *)x->x_vec;
+    return 1;
+}
+
+int garray_npoints(t_garray *x) { return x->x_n; }
+
+void garray_redraw(t_garray *) {}
+
+void garray_usedindsp(t_garray *x) { x->x_usedindsp = true; }
+
+void garray_resize_long(t_garray *x,long n)
+{
+    if(n < 1) n = 1;
+    x->x_vec = (t_word *)resizebytes(x->x_vec,x->x_n*sizeof(t_word),n*sizeof(t_word));
+    x->x_n = (int)n;
+    // the DSP chain is rebuilt if it uses the array (as in Pd)
+    if(x->x_usedindsp && dspon) dsp_build();
+}
+
+void garray_resize(t_garray *x,t_floatarg f) { garray_resize_long(x,(long)f); }
+
+t_glist *garray_getglist(t_garray *) { return &rootcanvas; }
+
+/* ----------------- signal processing ----------------- */
+
+void dsp_addv(t_perfroutine f,int n,t_int *vec)
+{
+    dspchain.push_back((t_int)f);
+    dspchain.insert(dspchain.end(),vec,vec+n);
+}
+
+void dsp_add(t_perfroutine f,int n,...)
+{
+    va_list ap;
+    va_start(ap,n);
+    dspchain.push_back((t_int)f);
+    for(int i = 0; i < n; ++i) dspchain.push_back(va_arg(ap,t_int));
+    va_end(ap);
+}
+
+t_int *plus_perform(t_int *w)
+{
+    const t_sample *in1 = (const t_sample *)w[1],*in2 = (const t_sample *)w[2];
+    t_sample *out = (t_sample *)w[3];
+    const int n = (int)w[4];
+    for(int i = 0; i < n; ++i) out[i] = in1[i]+in2[i];
+    return w+5;
+}
+
+t_int *zero_perform(t_int *w)
+{
+    memset((t_sample *)w[1],0,(int)w[2]*sizeof(t_sample));
+    return w+3;
+}
+
+t_int *copy_perform(t_int *w)
+{
+    memmove((t_sample *)w[2],(const t_sample *)w[1],(int)w[3]*sizeof(t_sample));
+    return w+4;
+}
+
+void dsp_add_plus(t_sample *in1,t_sample *in2,t_sample *out,int n) { dsp_add(plus_perform,4,in1,in2,out,(t_int)n); }
+
+void dsp_add_copy(t_sample *in,t_sample *out,int n) { dsp_add(copy_perform,3,in,out,(t_int)n); }
+
+void dsp_add_zero(t_sample *out,int n) { dsp_add(zero_perform,2,out,(t_int)n); }
+
+static t_int *dsp_done(t_int *) { return NULL; }
+
+//! Fill the signal inputs of an object before it is processed
+static t_int *gather_perform(t_int *w)
+{
+    const t_dspobj *d = (const t_dspobj *)w[1];
+    const int n = hostblksize;
+    for(int i = 0; i < d->d_nin; ++i) {
+        // read from the source directly
+        if(d->d_external[i] || d->d_sig[i].s_vec != d->d_vec[i]) continue;
+
+        t_sample *vec = d->d_vec[i];
+        const std::vector<t_sample *> &src = d->d_src[i];
+        if(src.empty()) {
+            const t_sample f = *d->d_scalar[i];
+            for(int j = 0; j < n; ++j) vec[j] = f;
+        }
+        else {
+            memcpy(vec,src[0],n*sizeof(t_sample));
+            for(size_t s = 1; s < src.size(); ++s)
+                for(int j = 0; j < n; ++j) vec[j] += src[s][j];
+        }
+    }
+    return w+2;
+}
+
+static t_sample *sig_new()
+{
+    void *ptr;
+    if(posix_memalign(&ptr,SIGALIGN,hostblksize*sizeof(t_sample))) return NULL;
+    memset(ptr,0,hostblksize*sizeof(t_sample));
+    return (t_sample *)ptr;
+}
+
+static void dsp_clear()
+{
+    for(size_t i = 0; i < dspobjs.size(); ++i) {
+        t_dspobj *d = dspobjs[i];
+        for(size_t j = 0; j < d->d_vec.size(); ++j) free(d->d_vec[j]);
+        delete d;
+    }
+    dspobjs.clear();
+    dspchain.clear();
+    free(dspdummy);
+    dspdummy = NULL;
+}
+
+static t_dspobj *dsp_find(const t_object *x)
+{
+    for(size_t i = 0; i < dspobjs.size(); ++i)
+        if(dspobjs[i]->d_obj == x) return dspobjs[i];
+    return NULL;
+}
+
+//! Build the DSP chain, sorting the objects along their signal connections
+static void dsp_build()
+{
+    dsp_clear();
+    if(!dspon) return;
+
+    t_symbol *sym_dsp = gensym("dsp");
+    dspdummy = sig_new();
+
+    for(size_t i = 0; i < objects.size(); ++i) {
+        t_object *x = objects[i];
+        if(!zgetfn(&x->ob_pd,sym_dsp)) continue;
+
+        t_dspobj *d = new t_dspobj;
+        d->d_obj = x;
+        d->d_nin = obj_nsiginlets(x);
+        d->d_nout = obj_nsigoutlets(x);
+        d->d_pending = 0;
+        d->d_external.resize(d->d_nin,false);
+        d->d_src.resize(d->d_nin);
+
+        // scalars of unconnected signal inlets
+        const int nin = obj_ninlets(x);
+        for(int j = 0; j < nin; ++j) {
+            if(!obj_issignalinlet(x,j)) continue;
+            t_inlet *in = obj_getinlet(x,j);
+            d->d_scalar.push_back(in?&in->i_floatsignal:(t_float *)((char *)x+x->ob_pd->c_floatsignalin));
+        }
+
+        // in and out vectors, one more to catch reads past the end
+        const int cnt = d->d_nin+d->d_nout;
+        d->d_sig.resize(cnt+1);
+        d->d_vec.resize(cnt);
+        for(int j = 0; j <= cnt; ++j) {
+            t_signal &s = d->d_sig[j];
+            memset(&s,0,sizeof(s));
+            s.s_n = s.s_vecsize = hostblksize;
+            s.s_sr = (t_float)hostsr;
+            s.s_vec = j < cnt?(d->d_vec[j] = sig_new()):dspdummy;
+        }
+        dspobjs.push_back(d);
+    }
+
+    // resolve signal connections
+    for(size_t i = 0; i < dspobjs.size(); ++i) {
+        t_dspobj *d = dspobjs[i];
+        int k = 0;
+        for(t_outlet *o = d->d_obj->te_outlet; o; o = o->o_next) {
+            if(o->o_sym != &s_signal) continue;
+            for(t_outconnect *c = o->o_connections; c; c = c->oc_next) {
+                t_dspobj *t = c->oc_to?dsp_find(c->oc_to):NULL;
+                if(!t || !obj_issignalinlet(c->oc_to,c->oc_inno)) continue;
+                t->d_src[obj_siginletindex(c->oc_to,c->oc_inno)].push_back(d->d_vec[d->d_nin+k]);
+                d->d_after.push_back(t);
+                ++t->d_pending;
+            }
+            ++k;
+        }
+    }
+
+    // like in Pd, an inlet with a single connection gets the vector of the source
+    for(size_t i = 0; i < dspobjs.size(); ++i) {
+        t_dspobj *d = dspobjs[i];
+        for(int j = 0; j < d->d_nin; ++j)
+            if(d->d_src[j].size() == 1) d->d_sig[j].s_vec = d->d_src[j][0];
+    }
+
+    // schedule the objects in creation order as far as their inputs allow
+    std::vector<t_dspobj *> order;
+    std::vector<bool> done(dspobjs.size(),false);
+    for(bool progress = true; progress; ) {
+        progress = false;
+        for(size_t i = 0; i < dspobjs.size(); ++i) {
+            t_dspobj *d = dspobjs[i];
+            if(done[i] || d->d_pending) continue;
+            done[i] = progress = true;
+            order.push_back(d);
+            for(size_t j = 0; j < d->d_after.size(); ++j) --d->d_after[j]->d_pending;
+        }
+    }
+    if(order.size() < dspobjs.size()) {
+        error("DSP loop detected (some tilde objects not scheduled)");
+        for(size_t i = 0; i < dspobjs.size(); ++i)
+            if(!done[i]) order.push_back(dspobjs[i]);
+    }
+
+    for(size_t i = 0; i < order.size(); ++i) {
+        t_dspobj *d = order[i];
+        if(d->d_nin) dsp_add(gather_perform,1,(t_int)d);
+
+        std::vector<t_signal *> sp(d->d_sig.size());
+        for(size_t j = 0; j < sp.size(); ++j) sp[j] = &d->d_sig[j];
+        ((t_dspmethod)zgetfn(&d->d_obj->ob_pd,sym_dsp))(&d->d_obj->ob_pd,&sp[0]);
+    }
+
+    dsp_add(dsp_done,0);
+}
+
+static void dsp_tick()
+{
+    if(dspchain.empty()) return;
+    for(t_int *ip = &dspchain[0]; ip; )
+        ip = (*(t_perfroutine)*ip)(ip);
+}
+
+//! One scheduler tick: fire the clocks due within the block, then process it
+static void sched_tick()
+{
+    const double next = systime+hostblksize*1000./hostsr*TIMEUNITPERMS;
+    while(clocklist && clocklist->c_settime < next) {
+        t_clock *c = clocklist;
+        systime = c->c_settime;
+        clock_unset(c);
+        stackcount = 0;
+        ((t_clockmethod)c->c_fn)(c->c_owner);
+    }
+    systime = next;
+    dsp_tick();
+}
+
+/* ----------------- driver ----------------- */
+
+static void host_init()
+{
+    if(hostinited) return;
+    hostinited = true;
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    // driver functions may be called from within outlet sinks
+    pthread_mutexattr_settype(&attr,PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&hostmutex,&attr);
+    pthread_mutexattr_destroy(&attr);
+
+    memset(&rootcanvas,0,sizeof(rootcanvas));
+    rootcanvas.gl_name = gensym("headless");
+
+    garray_class = class_new(gensym("array"),NULL,NULL,sizeof(t_garray),CLASS_PD,A_NULL);
+    bindlist_class = class_new(gensym("bindlist"),NULL,NULL,sizeof(t_bindlist),CLASS_PD,A_NULL);
+    class_addanything(bindlist_class,(t_method)bindlist_anything);
+
+    sys_getrealtime();
+}
+
+void flhost_init(double samplerate,int blocksize)
+{
+    host_init();
+    sys_lock();
+    if(dspon)
+        error("flhost_init: DSP is running");
+    else {
+        hostsr = samplerate;
+        hostblksize = blocksize;
+    }
+    sys_unlock();
+}
+
+void flhost_quiet(int quiet) { hostquiet = quiet != 0; }
+
+void flhost_setup(void (*setup)(void))
+{
+    host_init();
+    sys_lock();
+    setup();
+    sys_unlock();
+}
+
+int flhost_load(const char *path,const char *name)
+{
+    host_init();
+
+    void *lib = dlopen(path,RTLD_NOW|RTLD_GLOBAL);
+    if(!lib) {
+        error("%s: %s",path,dlerror());
+        return 0;
+    }
+
+    // ~ is replaced by _tilde in the name of the setup function (as in Pd)
+    std::string base;
+    for(const char *c = name; *c; ++c)
+        if(*c == '~') base += "_tilde";
+        else base += *c;
+
+    void (*setup)(void) = (void (*)(void))dlsym(lib,(base+"_setup").c_str());
+    if(!setup) setup = (void (*)(void))dlsym(lib,("setup_"+base).c_str());
+    if(!setup) {
+        error("%s: no setup function for %s",path,name);
+        return 0;
+    }
+
+    flhost_setup(setup);
+    return 1;
+}
+
+t_object *flhost_new(const char *line)
+{
+    host_init();
+
+    t_binbuf *b = binbuf_new();
+    binbuf_text(b,line,strlen(line));
+    int argc = binbuf_getnatom(b);
+    t_atom *argv = binbuf_getvec(b);
+
+    t_object *x = NULL;
+    if(!argc || argv->a_type != A_SYMBOL)
+        error("flhost_new: no class name in '%s'",line);
+    else {
+        sys_lock();
+
+        t_symbol *s = argv->a_w.w_symbol;
+        std::map<t_symbol *,t_creator>::const_iterator it = creators.find(s);
+        if(it == creators.end())
+            error("%s: couldn't create",s->s_name);
+        else {
+            const t_creator &cr = it->second;
+            t_int r = 0;
+            if(cr.cr_arg[0] == A_GIMME)
+                r = (t_int)((t_gimmenew)cr.cr_fun)(s,argc-1,argv+1);
+            else
+                callmethod((t_method)cr.cr_fun,cr.cr_arg,NULL,s->s_name,s,argc-1,argv+1,&r);
+
+            x = (t_object *)r;
+            if(!x)
+                error("%s: couldn't create",s->s_name);
+            else if(!(*x->ob_pd).c_patchable) {
+                error("%s: not a patchable object",s->s_name);
+                x = NULL;
+            }
+            else {
+                x->te_binbuf = b;
+                b = NULL;
+                objects.push_back(x);
+
+                // objects are created as part of a loaded patch
+                if(zgetfn(&x->ob_pd,gensym("loadbang")))
+                    pd_vmess(&x->ob_pd,gensym("loadbang"),"f",0.);
+                if(dspon) dsp_build();
+            }
+        }
+
+        sys_unlock();
+    }
+
+    if(b) binbuf_free(b);
+    return x;
+}
+
+void flhost_free(t_object *x)
+{
+    sys_lock();
+
+    // remove connections into the object
+    for(size_t i = 0; i < objects.size(); ++i)
+        for(t_outlet *o = objects[i]->te_outlet; o; o = o->o_next)
+            for(t_outconnect **c = &o->o_connections; *c; ) {
+                if((*c)->oc_to == x) {
+                    t_outconnect *r = *c;
+                    *c = r->oc_next;
+                    delete r;
+                }
+                else
+                    c = &(*c)->oc_next;
+            }
+
+    for(size_t i = 0; i < objects.size(); ++i)
+        if(objects[i] == x) {
+            objects.erase(objects.begin()+i);
+            break;
+        }
+
+    // vectors of the object must not be used any more
+    if(dspon) {
+        dspon = false;
+        dsp_clear();
+        pd_free(&x->ob_pd);
+        dspon = true;
+        dsp_build();
+    }
+    else
+        pd_free(&x->ob_pd);
+
+    sys_unlock();
+}
+
+void flhost_send(t_object *x,int inlet,t_symbol *s,int argc,t_atom *argv)
+{
+    sys_lock();
+    stackcount = 0;
+    obj_sendinlet(x,inlet,s,argc,argv);
+    sys_unlock();
+}
+
+void flhost_sendtext(t_object *x,int inlet,const char *text)
+{
+    t_binbuf *b = binbuf_new();
+    binbuf_text(b,text,strlen(text));
+    int argc = binbuf_getnatom(b);
+    t_atom *argv = binbuf_getvec(b);
+
+    if(argc && argv->a_type == A_SYMBOL)
+        flhost_send(x,inlet,argv->a_w.w_symbol,argc-1,argv+1);
+    else if(argc == 1)
+        flhost_send(x,inlet,&s_float,argc,argv);
+    else
+        flhost_send(x,inlet,&s_list,argc,argv);
+    binbuf_free(b);
+}
+
+static void outlet_addconnect(t_outlet *o,t_object *to,int inno,flhost_sinkfn fn,void *data)
+{
+    t_outconnect *c = new t_outconnect;
+    c->oc_to = to;
+    c->oc_inno = inno;
+    c->oc_fn = fn;
+    c->oc_data = data;
+    c->oc_next = NULL;
+
+    // connections are served in the order they were made
+    t_outconnect **l = &o->o_connections;
+    while(*l) l = &(*l)->oc_next;
+    *l = c;
+}
+
+int flhost_connect(t_object *src,int outlet,t_object *dst,int inlet)
+{
+    sys_lock();
+    t_outlet *o = obj_getoutlet(src,outlet);
+    int ok = o && inlet >= 0 && inlet < obj_ninlets(dst);
+    if(!ok)
+        error("flhost_connect: %s %i -> %s %i: no such outlet or inlet",src->ob_pd->c_name->s_name,outlet,dst->ob_pd->c_name->s_name,inlet);
+    else if(o->o_sym == &s_signal && !obj_issignalinlet(dst,inlet)) {
+        error("flhost_connect: can't connect signal outlet to control inlet");
+        ok = 0;
+    }
+    else {
+        outlet_addconnect(o,dst,inlet,NULL,NULL);
+        if(dspon && o->o_sym == &s_signal) dsp_build();
+    }
+    sys_unlock();
+    return ok;
+}
+
+void flhost_disconnect(t_object *src,int outlet,t_object *dst,int inlet)
+{
+    sys_lock();
+    t_outlet *o = obj_getoutlet(src,outlet);
+    if(o)
+        for(t_outconnect **c = &o->o_connections; *c; c = &(*c)->oc_next)
+            if((*c)->oc_to == dst && (*c)->oc_inno == inlet) {
+                t_outconnect *r = *c;
+                *c = r->oc_next;
+                delete r;
+                if(dspon && o->o_sym == &s_signal) dsp_build();
+                break;
+            }
+    sys_unlock();
+}
+
+int flhost_sink(t_object *x,int outlet,flhost_sinkfn fn,void *data)
+{
+    sys_lock();
+    t_outlet *o = obj_getoutlet(x,outlet);
+    if(o)
+        outlet_addconnect(o,NULL,0,fn,data);
+    else
+        error("flhost_sink: %s has no outlet %i",x->ob_pd->c_name->s_name,outlet);
+    sys_unlock();
+    return o != NULL;
+}
+
+t_garray *flhost_array(const char *name,int size)
+{
+    host_init();
+    sys_lock();
+    t_symbol *s = gensym(name);
+    t_garray *x = (t_garray *)pd_findbyclass(s,garray_class);
+    if(x)
+        garray_resize_long(x,size);
+    else {
+        x = (t_garray *)pd_new(garray_class);
+        x->x_name = s;
+        x->x_n = size > 0?size:1;
+        x->x_vec = (t_word *)getbytes(x->x_n*sizeof(t_word));
+        x->x_usedindsp = false;
+        pd_bind(&x->x_pd,s);
+    }
+    sys_unlock();
+    return x;
+}
+
+void flhost_dsp(int on)
+{
+    host_init();
+    sys_lock();
+    dspon = on != 0;
+    if(dspon)
+        dsp_build();
+    else
+        dsp_clear();
+    sys_unlock();
+}
+
+t_sample *flhost_signalin(t_object *x,int inlet)
+{
+    sys_lock();
+    t_dspobj *d = dsp_find(x);
+    t_sample *vec = NULL;
+    if(d && obj_issignalinlet(x,inlet)) {
+        const int k = obj_siginletindex(x,inlet);
+        d->d_external[k] = true;
+        vec = d->d_vec[k];
+    }
+    sys_unlock();
+    return vec;
+}
+
+t_sample *flhost_signalout(t_object *x,int outlet)
+{
+    sys_lock();
+    t_dspobj *d = dsp_find(x);
+    t_sample *vec = NULL;
+    if(d && obj_issignaloutlet(x,outlet))
+        vec = d->d_vec[d->d_nin+obj_sigoutletindex(x,outlet)];
+    sys_unlock();
+    return vec;
+}
+
+void flhost_tick(int blocks)
+{
+    host_init();
+    sys_lock();
+    for(int i = 0; i < blocks; ++i) sched_tick();
+    sys_unlock();
+}
+
+void flhost_advance(double ms)
+{
+    host_init();
+    sys_lock();
+    const double until = systime+ms*TIMEUNITPERMS;
+    while(systime < until) sched_tick();
+    sys_unlock();
+}
+
+double flhost_time(void) { return systime/TIMEUNITPERMS; }
@@ -0,0 +1,118 @@
+/*
+flext - C++ layer for Max and Pure Data externals
+
+Copyright (c) 2001-2015 Thomas Grill (gr@grrrr.org)
+For information on usage and redistribution, and for a DISCLAIMER OF ALL
+WARRANTIES, see the file, "license.txt," in this distribution.
+*/
+
+/*! \file flhost.h
+    \brief Driver interface of the headless flext host.
+
+    The headless host implements the part of the Pd API used by flext (see m_pd.h)
+    without audio devices, GUI or patch files, so that externals can be run,
+    profiled and benchmarked from a plain program.
+
+    Time is purely logical: it only advances with flhost_tick, one DSP block per tick,
+    and clocks fire in between like in the Pd scheduler.
+    All driver functions take the system lock (sys_lock) themselves.
+*/
+
+#ifndef __FLHOST_H
+#define __FLHOST_H
+
+#include "m_pd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! Function receiving the messages of an outlet
+typedef void (*flhost_sinkfn)(void *data,t_object *x,int outlet,t_symbol *s,int argc,t_atom *argv);
+
+/*! \brief Initialize the host
+    \param samplerate sample rate reported by sys_getsr
+    \param blocksize DSP block size reported by sys_getblksize
+    \note Can be called again while DSP is off
+*/
+void flhost_init(double samplerate,int blocksize);
+
+//! Suppress (or show) the output of post and error
+void flhost_quiet(int quiet);
+
+//! Call the setup function of a statically linked external (or library)
+void flhost_setup(void (*setup)(void));
+
+/*! \brief Load an external from a shared library and call its setup function
+    \param path path of the shared library
+    \param name name of the external, name_setup (or setup_name) is called
+    \return true on success
+    \note the external must be built against the headless m_pd.h
+*/
+int flhost_load(const char *path,const char *name);
+
+/*! \brief Create an object
+    \param line class name and creation arguments, e.g. "myobj~ 3 foo"
+    \return the object or NULL if the creation failed
+*/
+t_object *flhost_new(const char *line);
+
+//! Free an object created by flhost_new
+void flhost_free(t_object *x);
+
+//! Send a message to an inlet of an object
+void flhost_send(t_object *x,int inlet,t_symbol *s,int argc,t_atom *argv);
+
+//! Send a message given as text (e.g. "set 1 2 3") to an inlet of an object
+void flhost_sendtext(t_object *x,int inlet,const char *text);
+
+//! Connect an outlet to an inlet (message or signal)
+int flhost_connect(t_object *src,int outlet,t_object *dst,int inlet);
+
+//! Remove a connection made by flhost_connect
+void flhost_disconnect(t_object *src,int outlet,t_object *dst,int inlet);
+
+//! Route the messages of an outlet to a function
+int flhost_sink(t_object *x,int outlet,flhost_sinkfn fn,void *data);
+
+/*! \brief Create an array, found by flext buffers under the given name
+    \param name array name
+    \param size number of frames
+*/
+t_garray *flhost_array(const char *name,int size);
+
+/*! \brief Switch DSP on or off
+    \note Switching on (again) rebuilds the DSP chain, this is also done when objects
+    or signal connections change while DSP is running.
+    The signal vectors returned by flhost_signalin/flhost_signalout are only valid until then.
+*/
+void flhost_dsp(int on);
+
+/*! \brief Get the input vector of a signal inlet
+    The host does not touch a vector obtained by this function anymore,
+    it is filled by the caller before each tick.
+    Unconnected signal inlets are otherwise filled with their scalar value,
+    inlets with a single connection read the vector of the source (like in Pd) and ignore this one.
+    \return the vector of sys_getblksize() samples or NULL if DSP is off or there is no such signal inlet
+*/
+t_sample *flhost_signalin(t_object *x,int inlet);
+
+/*! \brief Get the output vector of a signal outlet
+    \return the vector of sys_getblksize() samples or NULL if DSP is off or there is no such signal outlet
+*/
+t_sample *flhost_signalout(t_object *x,int outlet);
+
+//! Run a number of DSP blocks, firing the clocks that are due before each
+void flhost_tick(int blocks);
+
+//! Advance the logical time by at least the given number of milliseconds
+void flhost_advance(double ms);
+
+//! Get the logical time in milliseconds since flhost_init
+double flhost_time(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __FLHOST_H
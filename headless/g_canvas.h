@@ -0,0 +1,66 @@
+/*
+flext - C++ layer for Max and Pure Data externals
+
+Copyright (c) 2001-2015 Thomas Grill (gr@grrrr.org)
+For information on usage and redistribution, and for a DISCLAIMER OF ALL
+WARRANTIES, see the file, "license.txt," in this distribution.
+*/
+
+/*! \file g_canvas.h
+    \brief Canvas part of the Pd API as implemented by the headless flext host.
+
+    The host has a single root canvas without a window.
+*/
+
+#ifndef __g_canvas_h_
+#define __g_canvas_h_
+
+#include "m_pd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct _glist
+{
+    t_object gl_obj;
+    t_gobj *gl_list;
+    struct _glist *gl_owner;
+    t_symbol *gl_name;
+    int gl_loading;
+    unsigned int gl_havewindow:1;
+    unsigned int gl_isgraph:1;
+    t_float gl_x1,gl_y1;
+    t_float gl_x2,gl_y2;
+};
+
+//! Iterates the connections of a canvas (fields like in Pd, the line coordinates stay 0)
+typedef struct _linetraverser
+{
+    t_canvas *tr_x;
+    t_object *tr_ob;
+    int tr_nout;
+    int tr_outno;
+    t_object *tr_ob2;
+    t_outlet *tr_outlet;
+    t_inlet *tr_inlet;
+    int tr_nin;
+    int tr_inno;
+    int tr_lx1,tr_ly1,tr_lx2,tr_ly2;
+    t_outconnect *tr_nextoc;
+    int tr_nextoutno;
+} t_linetraverser;
+
+EXTERN void linetraverser_start(t_linetraverser *t,t_canvas *x);
+EXTERN t_outconnect *linetraverser_next(t_linetraverser *t);
+
+EXTERN int glist_isvisible(t_glist *x);
+EXTERN t_glist *garray_getglist(t_garray *x);
+EXTERN void canvas_setcurrent(t_glist *x);
+EXTERN void canvas_unsetcurrent(t_glist *x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __g_canvas_h_
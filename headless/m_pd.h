@@ -0,0 +1,357 @@
+/*
+flext - C++ layer for Max and Pure Data externals
+
+Copyright (c) 2001-2015 Thomas Grill (gr@grrrr.org)
+For information on usage and redistribution, and for a DISCLAIMER OF ALL
+WARRANTIES, see the file, "license.txt," in this distribution.
+*/
+
+/*! \file m_pd.h
+    \brief Subset of the Pd API as implemented by the headless flext host.
+
+    Externals (and flext) are compiled as Pd externals against this header,
+    the host library (flhost.cpp) implements the functions declared here.
+    Only the part of the API used by flext is present, the data layout
+    is not binary compatible with a real Pd.
+*/
+
+#ifndef __m_pd_h_
+#define __m_pd_h_
+
+#include <stddef.h>
+
+#define PD_MAJOR_VERSION 0
+#define PD_MINOR_VERSION 47
+#define PD_BUGFIX_VERSION 1
+#define PD_TEST_VERSION ""
+
+//! marks the headless host
+#define PD_HEADLESS 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef EXTERN
+#define EXTERN extern
+#endif
+
+#define EXTERN_STRUCT struct
+
+#define MAXPDSTRING 1000
+#define MAXPDARG 5
+
+#if defined(_WIN64)
+typedef long long t_int;
+#else
+typedef long t_int;
+#endif
+
+typedef float t_float;
+typedef float t_floatarg;
+typedef float t_sample;
+
+struct _class;
+struct _outlet;
+struct _inlet;
+struct _binbuf;
+struct _clock;
+struct _glist;
+struct _garray;
+struct _gpointer;
+struct _outconnect;
+
+typedef struct _class *t_pd;
+typedef struct _outlet t_outlet;
+typedef struct _inlet t_inlet;
+typedef struct _binbuf t_binbuf;
+typedef struct _clock t_clock;
+typedef struct _glist t_glist;
+typedef struct _glist t_canvas;
+typedef struct _garray t_garray;
+typedef struct _gpointer t_gpointer;
+typedef struct _outconnect t_outconnect;
+typedef struct _class t_class;
+
+typedef struct _symbol
+{
+    const char *s_name;
+    t_pd *s_thing;
+    struct _symbol *s_next;
+} t_symbol;
+
+typedef union word
+{
+    t_float w_float;
+    t_symbol *w_symbol;
+    t_gpointer *w_gpointer;
+    void *w_array;
+    t_binbuf *w_binbuf;
+    int w_index;
+} t_word;
+
+typedef enum
+{
+    A_NULL,A_FLOAT,A_SYMBOL,A_POINTER,A_SEMI,A_COMMA,
+    A_DEFFLOAT,A_DEFSYM,A_DOLLAR,A_DOLLSYM,A_GIMME,A_CANT
+} t_atomtype;
+
+#define A_DEFSYMBOL A_DEFSYM
+
+typedef struct _atom
+{
+    t_atomtype a_type;
+    union word a_w;
+} t_atom;
+
+typedef struct _gobj
+{
+    t_pd g_pd;
+    struct _gobj *g_next;
+} t_gobj;
+
+typedef struct _scalar t_scalar;
+
+typedef struct _text
+{
+    t_gobj te_g;
+    t_binbuf *te_binbuf;
+    t_outlet *te_outlet;
+    t_inlet *te_inlet;
+    short te_xpix,te_ypix;
+    short te_width;
+    unsigned int te_type:2;
+} t_text;
+
+typedef t_text t_object;
+
+#define ob_outlet te_outlet
+#define ob_inlet te_inlet
+#define ob_binbuf te_binbuf
+#define ob_pd te_g.g_pd
+#define ob_g te_g
+
+typedef void (*t_method)(void);
+typedef void *(*t_newmethod)(void);
+typedef void (*t_gotfn)(void *x,...);
+
+/* ----------------- symbols and atoms ----------------- */
+
+EXTERN t_symbol s_pointer,s_float,s_symbol,s_bang,s_list,s_anything,s_signal;
+EXTERN t_symbol s__N,s__X,s_x,s_y,s_;
+
+EXTERN t_symbol *gensym(const char *s);
+
+#define SETSEMI(atom) ((atom)->a_type = A_SEMI,(atom)->a_w.w_index = 0)
+#define SETCOMMA(atom) ((atom)->a_type = A_COMMA,(atom)->a_w.w_index = 0)
+#define SETPOINTER(atom,gp) ((atom)->a_type = A_POINTER,(atom)->a_w.w_gpointer = (gp))
+#define SETFLOAT(atom,f) ((atom)->a_type = A_FLOAT,(atom)->a_w.w_float = (f))
+#define SETSYMBOL(atom,s) ((atom)->a_type = A_SYMBOL,(atom)->a_w.w_symbol = (s))
+#define SETDOLLAR(atom,n) ((atom)->a_type = A_DOLLAR,(atom)->a_w.w_index = (n))
+#define SETDOLLSYM(atom,s) ((atom)->a_type = A_DOLLSYM,(atom)->a_w.w_symbol= (s))
+
+EXTERN t_float atom_getfloat(const t_atom *a);
+EXTERN t_int atom_getint(const t_atom *a);
+EXTERN t_symbol *atom_getsymbol(const t_atom *a);
+EXTERN t_symbol *atom_gensym(const t_atom *a);
+EXTERN t_float atom_getfloatarg(int which,int argc,const t_atom *argv);
+EXTERN t_int atom_getintarg(int which,int argc,const t_atom *argv);
+EXTERN t_symbol *atom_getsymbolarg(int which,int argc,const t_atom *argv);
+EXTERN void atom_string(const t_atom *a,char *buf,unsigned int bufsize);
+
+/* ----------------- memory ----------------- */
+
+EXTERN void *getbytes(size_t nbytes);
+EXTERN void *getzbytes(size_t nbytes);
+EXTERN void *copybytes(const void *src,size_t nbytes);
+EXTERN void *resizebytes(void *x,size_t oldsize,size_t newsize);
+EXTERN void freebytes(void *x,size_t nbytes);
+
+/* ----------------- binbufs ----------------- */
+
+EXTERN t_binbuf *binbuf_new(void);
+EXTERN void binbuf_free(t_binbuf *x);
+EXTERN t_binbuf *binbuf_duplicate(const t_binbuf *y);
+EXTERN void binbuf_text(t_binbuf *x,const char *text,size_t size);
+EXTERN void binbuf_clear(t_binbuf *x);
+EXTERN void binbuf_add(t_binbuf *x,int argc,const t_atom *argv);
+EXTERN void binbuf_addv(t_binbuf *x,const char *fmt,...);
+EXTERN void binbuf_addsemi(t_binbuf *x);
+EXTERN int binbuf_getnatom(const t_binbuf *x);
+EXTERN t_atom *binbuf_getvec(const t_binbuf *x);
+EXTERN void binbuf_eval(const t_binbuf *x,t_pd *target,int argc,const t_atom *argv);
+
+/* ----------------- clocks ----------------- */
+
+EXTERN t_clock *clock_new(void *owner,t_method fn);
+EXTERN void clock_set(t_clock *x,double systime);
+EXTERN void clock_delay(t_clock *x,double delaytime);
+EXTERN void clock_unset(t_clock *x);
+EXTERN void clock_free(t_clock *x);
+EXTERN double clock_getlogicaltime(void);
+EXTERN double clock_getsystime(void);
+EXTERN double clock_gettimesince(double prevsystime);
+EXTERN double clock_getsystimeafter(double delaytime);
+
+EXTERN double sys_getrealtime(void);
+
+/* ----------------- system ----------------- */
+
+EXTERN void sys_lock(void);
+EXTERN void sys_unlock(void);
+EXTERN int sys_trylock(void);
+
+EXTERN t_float sys_getsr(void);
+EXTERN int sys_getblksize(void);
+
+EXTERN void sys_vgui(const char *fmt,...);
+EXTERN void sys_gui(const char *s);
+
+EXTERN int open_via_path(const char *dir,const char *name,const char *ext,char *dirresult,char **nameresult,unsigned int size,int bin);
+EXTERN int sys_close(int fd);
+
+/* ----------------- printing ----------------- */
+
+EXTERN void post(const char *fmt,...);
+EXTERN void startpost(const char *fmt,...);
+EXTERN void poststring(const char *s);
+EXTERN void postfloat(t_floatarg f);
+EXTERN void postatom(int argc,const t_atom *argv);
+EXTERN void endpost(void);
+EXTERN void error(const char *fmt,...);
+EXTERN void verbose(int level,const char *fmt,...);
+EXTERN void bug(const char *fmt,...);
+EXTERN void pd_error(void *object,const char *fmt,...);
+
+/* ----------------- classes ----------------- */
+
+#define CLASS_DEFAULT 0
+#define CLASS_PD 1
+#define CLASS_GOBJ 2
+#define CLASS_PATCHABLE 3
+#define CLASS_NOINLET 8
+#define CLASS_TYPEMASK 3
+
+EXTERN t_class *class_new(t_symbol *name,t_newmethod newmethod,t_method freemethod,size_t size,int flags,t_atomtype arg1,...);
+EXTERN void class_addcreator(t_newmethod newmethod,t_symbol *s,t_atomtype type1,...);
+EXTERN void class_addmethod(t_class *c,t_method fn,t_symbol *sel,t_atomtype arg1,...);
+EXTERN void class_addbang(t_class *c,t_method fn);
+EXTERN void class_addpointer(t_class *c,t_method fn);
+EXTERN void class_doaddfloat(t_class *c,t_method fn);
+EXTERN void class_addsymbol(t_class *c,t_method fn);
+EXTERN void class_addlist(t_class *c,t_method fn);
+EXTERN void class_addanything(t_class *c,t_method fn);
+EXTERN void class_sethelpsymbol(t_class *c,t_symbol *s);
+EXTERN void class_domainsignalin(t_class *c,int onset);
+EXTERN const char *class_getname(const t_class *c);
+EXTERN t_gotfn getfn(const t_pd *x,t_symbol *s);
+EXTERN t_gotfn zgetfn(const t_pd *x,t_symbol *s);
+
+#define CLASS_MAINSIGNALIN(c,type,field) class_domainsignalin(c,(int)((char *)(&((type *)0)->field)-(char *)0))
+
+#ifndef PD_CLASS_DEF
+#define class_addbang(x,y) class_addbang((x),(t_method)(y))
+#define class_addpointer(x,y) class_addpointer((x),(t_method)(y))
+#define class_addfloat(x,y) class_doaddfloat((x),(t_method)(y))
+#define class_addsymbol(x,y) class_addsymbol((x),(t_method)(y))
+#define class_addlist(x,y) class_addlist((x),(t_method)(y))
+#define class_addanything(x,y) class_addanything((x),(t_method)(y))
+#endif
+
+/* ----------------- objects ----------------- */
+
+EXTERN t_pd *pd_new(t_class *cls);
+EXTERN void pd_free(t_pd *x);
+EXTERN void pd_bind(t_pd *x,t_symbol *s);
+EXTERN void pd_unbind(t_pd *x,t_symbol *s);
+EXTERN t_pd *pd_findbyclass(t_symbol *s,const t_class *c);
+EXTERN void pd_typedmess(t_pd *x,t_symbol *s,int argc,t_atom *argv);
+EXTERN void pd_forwardmess(t_pd *x,int argc,t_atom *argv);
+EXTERN void pd_vmess(t_pd *x,t_symbol *s,const char *fmt,...);
+EXTERN void pd_bang(t_pd *x);
+EXTERN void pd_float(t_pd *x,t_float f);
+EXTERN void pd_symbol(t_pd *x,t_symbol *s);
+EXTERN void pd_list(t_pd *x,t_symbol *s,int argc,t_atom *argv);
+EXTERN t_float pd_getdspstate(void);
+
+#define pd_class(x) (*(x))
+
+EXTERN t_inlet *inlet_new(t_object *owner,t_pd *dest,t_symbol *s1,t_symbol *s2);
+EXTERN t_inlet *floatinlet_new(t_object *owner,t_float *fp);
+EXTERN t_inlet *symbolinlet_new(t_object *owner,t_symbol **sp);
+EXTERN void inlet_free(t_inlet *x);
+
+EXTERN t_outlet *outlet_new(t_object *owner,t_symbol *s);
+EXTERN void outlet_bang(t_outlet *x);
+EXTERN void outlet_pointer(t_outlet *x,t_gpointer *gp);
+EXTERN void outlet_float(t_outlet *x,t_float f);
+EXTERN void outlet_symbol(t_outlet *x,t_symbol *s);
+EXTERN void outlet_list(t_outlet *x,t_symbol *s,int argc,t_atom *argv);
+EXTERN void outlet_anything(t_outlet *x,t_symbol *s,int argc,t_atom *argv);
+EXTERN t_symbol *outlet_getsymbol(t_outlet *x);
+EXTERN void outlet_free(t_outlet *x);
+
+EXTERN int obj_ninlets(const t_object *x);
+EXTERN int obj_noutlets(const t_object *x);
+EXTERN int obj_nsiginlets(const t_object *x);
+EXTERN int obj_nsigoutlets(const t_object *x);
+EXTERN int obj_issignalinlet(const t_object *x,int m);
+EXTERN int obj_issignaloutlet(const t_object *x,int m);
+EXTERN t_outconnect *obj_starttraverseoutlet(const t_object *x,t_outlet **op,int nout);
+EXTERN t_outconnect *obj_nexttraverseoutlet(t_outconnect *lastconnect,t_object **destp,t_inlet **inletp,int *whichp);
+
+/* ----------------- canvases ----------------- */
+
+EXTERN t_canvas *canvas_getcurrent(void);
+EXTERN t_symbol *canvas_getdir(const t_glist *x);
+EXTERN t_symbol *canvas_getcurrentdir(void);
+EXTERN void canvas_getargs(int *argcp,t_atom **argvp);
+EXTERN t_symbol *canvas_realizedollar(t_glist *x,t_symbol *s);
+EXTERN void canvas_makefilename(const t_glist *c,const char *file,char *result,int resultsize);
+EXTERN int canvas_isabstraction(const t_glist *x);
+
+EXTERN void gfxstub_new(t_pd *owner,void *key,const char *cmd);
+EXTERN void gfxstub_deleteforkey(void *key);
+
+/* ----------------- arrays ----------------- */
+
+EXTERN t_class *garray_class;
+EXTERN int garray_getfloatarray(t_garray *x,int *size,t_float **vec);
+EXTERN int garray_getfloatwords(t_garray *x,int *size,t_word **vec);
+EXTERN int garray_npoints(t_garray *x);
+EXTERN void garray_redraw(t_garray *x);
+EXTERN void garray_usedindsp(t_garray *x);
+EXTERN void garray_resize(t_garray *x,t_floatarg f);
+EXTERN void garray_resize_long(t_garray *x,long n);
+
+/* ----------------- signal processing ----------------- */
+
+typedef t_int *(*t_perfroutine)(t_int *args);
+
+typedef struct _signal
+{
+    int s_n;
+    t_sample *s_vec;
+    t_float s_sr;
+    int s_refcount;
+    int s_isborrowed;
+    struct _signal *s_borrowedfrom;
+    struct _signal *s_nextfree;
+    struct _signal *s_nextused;
+    int s_vecsize;
+} t_signal;
+
+EXTERN void dsp_add(t_perfroutine f,int n,...);
+EXTERN void dsp_addv(t_perfroutine f,int n,t_int *vec);
+EXTERN t_int *plus_perform(t_int *args);
+EXTERN t_int *zero_perform(t_int *args);
+EXTERN t_int *copy_perform(t_int *args);
+EXTERN void dsp_add_plus(t_sample *in1,t_sample *in2,t_sample *out,int n);
+EXTERN void dsp_add_copy(t_sample *in,t_sample *out,int n);
+EXTERN void dsp_add_zero(t_sample *out,int n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __m_pd_h_
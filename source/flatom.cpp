@@ -54,61 +54,145 @@ FLEXT_TEMPIMPL(t_atom *FLEXT_CLASSDEF(flext))::CopyList(int argc,const t_atom *a
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::CopyAtoms(int cnt,t_atom *dst,const t_atom *src)
 {
-    if(dst < src)
-        // forward
-        memcpy(dst,src,cnt*sizeof(t_atom));
-    else
-        // backwards
-        while(cnt--) dst[cnt] = src[cnt];
+    // atoms are plain data, also overlapping ranges
+    if(dst != src) memmove(dst,src,cnt*sizeof(t_atom));
 }
 
-FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::AtomList::Alloc(int sz,int keepix,int keeplen,int keepto)
+/*! \remark The values are converted in one pass while the type tags are counted, without branches.
+    Only if there are non-float atoms they are converted again one by one.
+*/
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::AtomsToFloats(int cnt,float *dst,const t_atom *src)
 {
-    if(lst) {
-        if(cnt == sz) {
-            if(keepix >= 0 && keepix != keepto) {
-                int c = keeplen >= 0?keeplen:cnt;
-                FLEXT_ASSERT(c+keepto <= cnt);
-                FLEXT_ASSERT(c+keepix <= cnt);
-                CopyAtoms(c,lst+keepto,lst+keepix);
-            }
-
-            return; // no change
+    int n = 0;
+    for(int i = 0; i < cnt; ++i) {
+        dst[i] = (float)src[i].a_w.w_float;
+        n += src[i].a_type == A_FLOAT;
+    }
+    if(LIKELY(n == cnt)) return true;
+
+    bool ok = true;
+    for(int i = 0; i < cnt; ++i)
+        if(!IsFloat(src[i])) {
+            if(CanbeFloat(src[i])) 
+                dst[i] = GetAFloat(src[i]);
+            else
+                dst[i] = 0,ok = false;
         }
+    return ok;
+}
 
-        t_atom *l;
-        if(sz) {
-            l = new t_atom[sz];
-            if(keepix >= 0) {
-                // keep contents
-                int c = keeplen >= 0?keeplen:(cnt > sz?sz:cnt);
-                FLEXT_ASSERT(c+keepto <= sz);
-                FLEXT_ASSERT(c+keepix <= cnt);
-                CopyAtoms(c,l+keepto,lst+keepix);
-            }
-        }
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::AtomsToInts(int cnt,int *dst,const t_atom *src)
+{
+    // check the tags first, converting arbitrary data to int is undefined
+    int n = 0;
+#if FLEXT_SYS == FLEXT_SYS_MAX
+    for(int i = 0; i < cnt; ++i) n += src[i].a_type == A_INT;
+#else
+    for(int i = 0; i < cnt; ++i) n += src[i].a_type == A_FLOAT;
+#endif
+    if(LIKELY(n == cnt)) {
+        for(int i = 0; i < cnt; ++i) dst[i] = GetInt(src[i]);
+        return true;
+    }
+
+    bool ok = true;
+    for(int i = 0; i < cnt; ++i)
+        if(CanbeInt(src[i])) 
+            dst[i] = GetAInt(src[i]);
         else
-            l = NULL;
+            dst[i] = 0,ok = false;
+    return ok;
+}
 
-        Free();
-        lst = l,cnt = sz;
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::FloatsToAtoms(int cnt,t_atom *dst,const float *src)
+{
+    for(int i = 0; i < cnt; ++i) SetFloat(dst[i],src[i]);
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::IntsToAtoms(int cnt,t_atom *dst,const int *src)
+{
+    for(int i = 0; i < cnt; ++i) SetInt(dst[i],src[i]);
+}
+
+/*! \remark The capacity only grows (geometrically), the list is moved to allocated memory 
+    when it doesn't fit into the fixed buffer any more.
+*/
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::AtomList::Alloc(int sz,int keepix,int keeplen,int keepto)
+{
+    if(sz <= cap) {
+        // fits, move the contents in place
+        if(keepix >= 0 && keepix != keepto) {
+            int c = keeplen >= 0?keeplen:(cnt > sz?sz:cnt);
+            FLEXT_ASSERT(c+keepto <= sz);
+            FLEXT_ASSERT(c+keepix <= cnt);
+            memmove(lst+keepto,lst+keepix,c*sizeof(t_atom));
+        }
+        cnt = sz;
+        return;
     }
+
+    int ncap;
+    t_atom *l;
+    if(sz <= fixcnt) 
+        l = fix,ncap = fixcnt;
     else {
-        FLEXT_ASSERT(cnt == 0);
-        if(sz) lst = new t_atom[cnt = sz];
+        ncap = cap*2 > sz?cap*2:sz;
+        l = new t_atom[ncap];
     }
+
+    if(keepix >= 0 && lst) {
+        // keep contents
+        int c = keeplen >= 0?keeplen:cnt;
+        FLEXT_ASSERT(c+keepto <= sz);
+        FLEXT_ASSERT(c+keepix <= cnt);
+        CopyAtoms(c,l+keepto,lst+keepix);
+    }
+
+    if(IsAllocated()) delete[] lst;
+    lst = l,cnt = sz,cap = ncap;
 }
 
 FLEXT_TEMPIMPL(FLEXT_CLASSDEF(flext))::AtomList::~AtomList() { Free(); }
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::AtomList::Free()
 {
-    if(lst) { 
-        delete[] lst; lst = NULL; 
-        cnt = 0;
+    if(IsAllocated()) delete[] lst;
+    lst = NULL;
+    cnt = cap = 0;
+}
+
+FLEXT_TEMPIMPL(FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext))::AtomList &FLEXT_CLASSDEF(flext))::AtomList::Take(AtomList &a)
+{
+    if(&a == this) return *this;
+
+    if(a.IsAllocated()) {
+        Free();
+        lst = a.lst,cnt = a.cnt,cap = a.cap;
+        a.lst = NULL,a.cnt = a.cap = 0;
+    }
+    else {
+        // short lists are copied
+        operator =(a);
+        a.Clear();
+    }
+    return *this;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::AtomList::Swap(AtomList &a)
+{
+    if(&a == this) return;
+
+    if(IsAllocated() && a.IsAllocated()) {
+        t_atom *l = lst; lst = a.lst; a.lst = l;
+        int c = cnt; cnt = a.cnt; a.cnt = c;
+        c = cap; cap = a.cap; a.cap = c;
+    }
+    else {
+        AtomList tmp;
+        tmp.Take(a);
+        a.Take(*this);
+        Take(tmp);
     }
-    else
-        FLEXT_ASSERT(cnt == 0);
 }
 
 FLEXT_TEMPIMPL(FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext))::AtomList &FLEXT_CLASSDEF(flext))::AtomList::Set(int argc,const t_atom *argv,int offs,bool resize)
@@ -135,43 +219,7 @@ FLEXT_TEMPIMPL(int FLEXT_CLASSDEF(flext))::AtomList::Compare(const AtomList &a)
 		return Count() < a.Count()?-1:1;
 }
 
-FLEXT_TEMPIMPL(FLEXT_CLASSDEF(flext))::AtomListStaticBase::~AtomListStaticBase() { Free(); }
-
-FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::AtomListStaticBase::Alloc(int sz,int keepix,int keeplen,int keepto)
-{ 
-    if(sz <= precnt) {
-        // small enough for pre-allocated space
-
-        if(AtomList::lst != predata && AtomList::lst) {
-            // currently allocated memory is larger than what we need
-
-            if(keepix >= 0) {
-                // keep contents
-                int c = keeplen >= 0?keeplen:(AtomList::cnt > sz?sz:AtomList::cnt);
-                FLEXT_ASSERT(c+keepto <= precnt);
-                FLEXT_ASSERT(c+keepix <= AtomList::cnt);
-                CopyAtoms(c,predata+keepto,AtomList::lst+keepix);
-            }
-
-            // free allocated memory
-            AtomList::Free();
-        }
-        AtomList::lst = predata;
-        AtomList::cnt = sz;
-    }
-    else 
-        AtomList::Alloc(sz,keepix,keeplen,keepto);
-}
-
-FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::AtomListStaticBase::Free()
-{
-    if(AtomList::lst != predata)
-        AtomList::Free();
-    else {
-        AtomList::lst = NULL;
-        AtomList::cnt = 0;
-    }
-}
+FLEXT_TEMPIMPL(FLEXT_CLASSDEF(flext))::AtomListStaticBase::~AtomListStaticBase() { AtomList::Free(); }
 
 #include "flpopns.h"
 
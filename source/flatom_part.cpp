@@ -35,7 +35,11 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::AtomList::GetPart(int offs,int len,A
         if(len < 0) len = 0;
     }
 
-    ret(len,Atoms()+offs);
+    if(&ret == this)
+        // in place, the list doesn't grow
+        ret.Alloc(len,offs,len);
+    else
+        ret(len,Atoms()+offs);
 }
 
 #include "flpopns.h"
@@ -19,6 +19,7 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 #include <cstdlib>
 #include <cstring>
 #include <cstdio>
+#include <cmath>
 
 #include "flpushns.h"
 
@@ -26,14 +27,155 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 #define snprintf _snprintf
 #endif
 
+//! Power of 10 (for any exponent)
+inline double atom_exp10(int e)
+{
+    static const double tab[23] = {
+        1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,
+        1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22
+    };
+    const bool neg = e < 0;
+    if(neg) e = -e;
+    double r = 1;
+    for(; e > 22; e -= 22) r *= 1e22;
+    r *= tab[e];
+    return neg?1./r:r;
+}
+
+//! Write an unsigned integer, returns the end of the string
+inline char *atom_utoa(char *b,unsigned long v)
+{
+    char tmp[24];
+    int n = 0;
+    do { tmp[n++] = (char)('0'+v%10); v /= 10; } while(v);
+    while(n) *b++ = tmp[--n];
+    return b;
+}
+
+//! Write an integer, returns the end of the string
+inline char *atom_itoa(char *b,long v)
+{
+    if(v < 0) { *b++ = '-'; return atom_utoa(b,0UL-(unsigned long)v); }
+    return atom_utoa(b,(unsigned long)v);
+}
+
+/*! \brief Write a float with the fewest digits which read back to the same value
+    Like %g, but up to 9 integer digits are written without exponent.
+    \return the end of the string, at most 16 characters are written
+*/
+inline char *atom_ftoa(char *b,float f)
+{
+    if(f != f) { memcpy(b,"nan",3); return b+3; }
+    if(f < 0) { *b++ = '-'; f = -f; }
+    if(f == 0) { *b++ = '0'; return b; }
+    if(f > 3.4028235e38f) { memcpy(b,"inf",3); return b+3; }
+
+    const double d = f;
+    // decimal exponent of the first digit
+    int e = (int)floor(log10(d));
+    if(d >= atom_exp10(e+1)) ++e;
+    else if(d < atom_exp10(e)) --e;
+
+    /* find the shortest number of digits (9 are always enough)
+       6 digits are less than float precision, if they suffice the shorter forms 
+       are the same with trailing zeros, which are stripped below 
+       (not for denormals, which have less precision) */
+    unsigned long m = 0;
+    int p;
+    for(p = f < 1.17549435e-38f?1:6; p <= 9; ++p) {
+        m = (unsigned long)(d*atom_exp10(p-1-e)+0.5);
+        int ee = e;
+        if(m >= (unsigned long)atom_exp10(p)) m /= 10,++ee; // rounded up to another digit
+        if((float)(m*atom_exp10(ee-p+1)) == f) { e = ee; break; }
+    }
+    if(p > 9) p = 9;
+    while(p > 1 && m%10 == 0) m /= 10,--p;
+
+    char dig[12];
+    atom_utoa(dig,m);
+
+    if(e >= -4 && e < 9) {
+        if(e >= 0) {
+            // integer part, padded with zeros
+            for(int i = 0; i <= e; ++i) *b++ = i < p?dig[i]:'0';
+            if(p > e+1) {
+                *b++ = '.';
+                for(int i = e+1; i < p; ++i) *b++ = dig[i];
+            }
+        }
+        else {
+            *b++ = '0'; *b++ = '.';
+            for(int i = -1; i > e; --i) *b++ = '0';
+            for(int i = 0; i < p; ++i) *b++ = dig[i];
+        }
+    }
+    else {
+        *b++ = dig[0];
+        if(p > 1) {
+            *b++ = '.';
+            for(int i = 1; i < p; ++i) *b++ = dig[i];
+        }
+        *b++ = 'e';
+        *b++ = e < 0?'-':'+';
+        if(e < 0) e = -e;
+        if(e < 10) *b++ = '0';
+        b = atom_utoa(b,(unsigned long)e);
+    }
+    return b;
+}
+
+/*! \brief Read a decimal number spanning the whole range [c,end)
+    \return false if it's not a number
+*/
+inline bool atom_scannum(const char *c,const char *end,float &v)
+{
+    const bool neg = *c == '-';
+    if(neg || *c == '+') ++c;
+
+    // up to 15 significant digits are exact in a double
+    double m = 0;
+    int nd = 0,e = 0;
+    bool any = false;
+    for(; c < end && *c >= '0' && *c <= '9'; ++c,any = true)
+        if(nd < 15) { m = m*10+(*c-'0'); if(m) ++nd; }
+        else ++e;
+    if(c < end && *c == '.')
+        for(++c; c < end && *c >= '0' && *c <= '9'; ++c,any = true)
+            if(nd < 15) { m = m*10+(*c-'0'); if(m) ++nd; --e; }
+    if(!any) return false;
+
+    if(c < end && (*c == 'e' || *c == 'E')) {
+        ++c;
+        const bool eneg = c < end && *c == '-';
+        if(c < end && (*c == '-' || *c == '+')) ++c;
+        if(c == end) return false;
+        int x = 0;
+        for(; c < end && *c >= '0' && *c <= '9'; ++c)
+            if(x < 1000) x = x*10+(*c-'0');
+        e += eneg?-x:x;
+    }
+    if(c != end) return false;
+
+    if(e > 400) e = 400; 
+    else if(e < -400) e = -400;
+    // exact powers up to 1e22, hence correctly rounded for the common cases
+    const double r = e < 0?m/atom_exp10(-e):m*atom_exp10(e);
+    v = (float)(neg?-r:r);
+    return true;
+}
+
 FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::PrintAtom(const t_atom &a,char *buf,size_t bufsz)
 {
     bool ok = true;
-    if(IsFloat(a)) {
-        ok = STD::snprintf(buf,bufsz,"%g",GetFloat(a)) > 0;
-    }
-    else if(IsInt(a)) {
-        ok = STD::snprintf(buf,bufsz,"%i",GetInt(a)) > 0;
+    if(IsFloat(a) || IsInt(a)) {
+        char tmp[24];
+        const char *e = IsFloat(a)?atom_ftoa(tmp,GetFloat(a)):atom_itoa(tmp,GetInt(a));
+        const size_t len = e-tmp;
+        if(len < bufsz) {
+            memcpy(buf,tmp,len); buf[len] = 0;
+        }
+        else 
+            ok = false;
     }
     else if(IsSymbol(a)) {
 		const char *c = GetString(a);
@@ -95,30 +237,24 @@ FLEXT_TEMPIMPL(const char *FLEXT_CLASSDEF(flext))::ScanAtom(t_atom &a,const char
 	while(*c && isspace(*c)) ++c;
 	if(!*c) return NULL;
 
-    // go to next space and save character
-    char *end = const_cast<char *>(c);
+    // go to next space
+    const char *end = c;
     while(*end && !isspace(*end)) ++end;
-    char sv = *end;
 
     float fres;
-    // first try float
-    char *endp;
-    // see if it's a float - thanks to Frank Barknecht
-    fres = (float)strtod(c,&endp);   
-    if(*c && endp != c) { 
-        int ires = (int)fres; // try a cast
-        if(fres == ires)
-            SetInt(a,ires);
+    // first try a number, the whole token must be one
+    if(atom_scannum(c,end,fres)) { 
+        // try a cast
+        if(fres > -2147483648.f && fres < 2147483648.f && fres == (int)fres)
+            SetInt(a,(int)fres);
         else
             SetFloat(a,fres);
     }
-    // no, it's a symbol
+    // no, it's a symbol (only up to the next space)
     else
-        SetString(a,c);
-
-    *end = sv;
+        SetSymbol(a,MakeSymbolCached(c,(int)(end-c)));
 
-	return end;
+    return end;
 }
 
 FLEXT_TEMPIMPL(int FLEXT_CLASSDEF(flext))::ScanList(int argc,t_atom *argv,const char *buf)
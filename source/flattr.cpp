@@ -112,13 +112,15 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::AddAttrib(t_classid c,const t_s
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ListAttrib(AtomList &la) const
 {
-	typedef TablePtrMap<int,const t_symbol *,32> AttrList;
+	typedef TableTreeMap<int,const t_symbol *,32> AttrList;
 	AttrList list[2];
     ItemCont *clattrhead = ClAttrs(thisClassId());
+    ItemCont *const own = attrhead;
+    FLEXT_TEMP_TYPENAME ItemCont::Reader guard(own);
 
 	int i;
 	for(i = 0; i <= 1; ++i) {
-        ItemCont *a = i?attrhead:clattrhead;
+        ItemCont *a = i?own:clattrhead;
 		if(a && a->Contained(0)) {
             ItemSet &ai = a->GetInlet();
             for(FLEXT_TEMP_TYPENAME ItemSet::iterator as(ai); as; ++as) {
@@ -154,7 +156,7 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::InitAttrib(int argc,const t_ato
 		for(nxt = cur+1; nxt < argc; ++nxt)
 			if(IsString(argv[nxt]) && *GetString(argv[nxt]) == '@') break;
 
-		const t_symbol *tag = MakeSymbol(GetString(argv[cur])+1);
+		const t_symbol *tag = MakeSymbolCached(GetString(argv[cur])+1);
 
 		// find puttable attribute
 		AttrItem *attr = FindAttrib(tag,false,true);
@@ -176,9 +178,9 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::InitAttrib(int argc,const t_ato
 			// pass value to object
 			SetAttrib(tag,attr,a.GetInitValue());
 */
-			AttrData *a = attrdata->find(tag);
+			AttrData *a = FindAttrData(tag);
             if(!a) {
-                AttrData *old = attrdata->insert(tag,a = new AttrData);
+                AttrData *old = ThAttrData()->insert(tag,a = new AttrData);
                 FLEXT_ASSERT(!old);
             }
 
@@ -209,10 +211,12 @@ FLEXT_TEMPIMPL(FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext_base))::AttrItem *FLEXT_CLASSD
 {
     ItemCont *clattrhead = ClAttrs(thisClassId());
 
-    // first search within object scope
+    // first search within object scope (attributes are never removed, the item stays valid)
 	AttrItem *a = NULL;
-    {
-        for(Item *lst = attrhead->FindList(tag); lst; lst = lst->nxt) {
+    ItemCont *const own = attrhead;
+    if(own) {
+        FLEXT_TEMP_TYPENAME ItemCont::Reader guard(own);
+        for(Item *lst = own->FindList(tag); lst; lst = lst->nxt) {
             AttrItem *b = (AttrItem *)lst;
             if(get?b->IsGet():b->IsSet()) { a = b; break; }
         }
@@ -295,6 +299,10 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::SetAttrib(const t_symbol *tag,A
 
 		if(!ok)
 			post("%s - wrong arguments for attribute %s",thisName(),GetString(tag));
+#if FLEXT_SYS == FLEXT_SYS_PD && !defined(FLEXT_NOATTREDIT)
+		else if(UNLIKELY(attrdialog))
+			UpdateAttrDialog(tag,a);
+#endif
 	}
 	else
 		post("%s - attribute %s has no get method",thisName(),GetString(tag));
@@ -362,6 +370,203 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::GetAttrib(const t_symbol *s,Ato
 	return attr && GetAttrib(s,attr,a);
 }
 
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::SetAttribNum(const t_symbol *tag,double v)
+{
+	AttrItem *a = FindAttrib(tag,false,true);
+	if(!a) return false;
+
+	t_any any;
+	switch(a->argtp) {
+	case a_float: any.ft = (float)v; break;
+	case a_int: any.it = (int)v; break;
+	case a_bool: any.bt = v != 0; break;
+	default: {
+		// no direct conversion, take the list path
+		t_atom at;
+		SetFloat(at,(float)v);
+		return SetAttrib(tag,a,1,&at);
+	}
+	}
+
+	if(a->fun)
+		((methfun_1)a->fun)(this,any);
+	else
+		post("%s - attribute %s has no set method",thisName(),GetString(tag));
+	return true;
+}
+
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::SetAttribSymbol(const t_symbol *tag,const t_symbol *v)
+{
+	AttrItem *a = FindAttrib(tag,false,true);
+	if(!a) return false;
+
+	t_atom at;
+	SetSymbol(at,v);
+	return SetAttrib(tag,a,1,&at);
+}
+
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::GetAttribNum(const t_symbol *tag,double &v) const
+{
+	AttrItem *a = FindAttrib(tag,true);
+	if(!a || !a->fun) return false;
+
+	t_any any;
+	switch(a->argtp) {
+	case a_float: ((methfun_1)a->fun)(const_cast<flext_base *>(this),any); v = any.ft; return true;
+	case a_int: ((methfun_1)a->fun)(const_cast<flext_base *>(this),any); v = any.it; return true;
+	case a_bool: ((methfun_1)a->fun)(const_cast<flext_base *>(this),any); v = any.bt?1:0; return true;
+	default: return false;
+	}
+}
+
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::GetAttribSymbol(const t_symbol *tag,const t_symbol *&v) const
+{
+	AttrItem *a = FindAttrib(tag,true);
+	if(!a || !a->fun || a->argtp != a_symbol) return false;
+
+	t_any any;
+	((methfun_1)a->fun)(const_cast<flext_base *>(this),any);
+	v = any.st;
+	return true;
+}
+
+//! Record header of an attribute snapshot, followed by the value
+struct AttrSnapHead
+{
+	const t_symbol *tag;
+	int argtp; // metharg of the attribute
+	int cnt; // bytes of the value
+};
+
+#define ATTRSNAP_ALIGN(n) (((n)+7)&~(size_t)7)
+
+FLEXT_TEMPIMPL(size_t FLEXT_CLASSDEF(flext_base))::SnapshotAttrib(char *buf,size_t pos,size_t size,const t_symbol *tag,AttrItem *a) const
+{
+	if(!a->fun) return pos;
+
+	AttrSnapHead h;
+	h.tag = tag;
+	h.argtp = a->argtp;
+
+	t_any any;
+	AtomListStatic<16> la;
+	const void *val;
+	switch(a->argtp) {
+	case a_float: case a_int: case a_bool: case a_symbol:
+		((methfun_1)a->fun)(const_cast<flext_base *>(this),any);
+		val = &any;
+		h.cnt = sizeof(any);
+		break;
+	case a_LIST:
+		any.vt = &la;
+		((methfun_1)a->fun)(const_cast<flext_base *>(this),any);
+		val = la.Atoms();
+		h.cnt = la.Count()*sizeof(t_atom);
+		break;
+	default:
+		// not supported
+		return pos;
+	}
+
+	const size_t len = ATTRSNAP_ALIGN(sizeof(h))+ATTRSNAP_ALIGN(h.cnt);
+	if(buf && pos+len <= size) {
+		memcpy(buf+pos,&h,sizeof(h));
+		if(h.cnt) memcpy(buf+pos+ATTRSNAP_ALIGN(sizeof(h)),val,h.cnt);
+	}
+	return pos+len;
+}
+
+FLEXT_TEMPIMPL(size_t FLEXT_CLASSDEF(flext_base))::SnapshotAttribs(void *buf,size_t size,bool all) const
+{
+	char *b = (char *)buf;
+	size_t pos = 0;
+
+	if(all) {
+		ItemCont *clattrhead = ClAttrs(thisClassId());
+		ItemCont *const own = attrhead;
+		FLEXT_TEMP_TYPENAME ItemCont::Reader guard(own);
+		for(int i = 0; i <= 1; ++i) {
+			ItemCont *a = i?own:clattrhead;
+			if(a && a->Contained(0)) {
+				ItemSet &ai = a->GetInlet();
+				for(FLEXT_TEMP_TYPENAME ItemSet::iterator as(ai); as; ++as) {
+					for(Item *al = as.data(); al; al = al->nxt) {
+						AttrItem *aa = (AttrItem *)al;
+						if(aa->IsGet() && aa->BothExist()) pos = SnapshotAttrib(b,pos,size,as.key(),aa);
+					}
+				}
+			}
+		}
+	}
+	else if(attrdata) {
+		for(FLEXT_TEMP_TYPENAME AttrDataCont::iterator it(*attrdata); it; ++it) {
+			if(it.data()->IsSaved()) {
+				AttrItem *aa = FindAttrib(it.key(),true);
+				if(aa && aa->BothExist()) pos = SnapshotAttrib(b,pos,size,it.key(),aa);
+			}
+		}
+	}
+	return pos;
+}
+
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::RestoreAttribs(const void *buf,size_t size)
+{
+	const char *b = (const char *)buf;
+	const size_t hlen = ATTRSNAP_ALIGN(sizeof(AttrSnapHead));
+	bool ok = true;
+
+	for(size_t pos = 0; pos+hlen <= size; ) {
+		AttrSnapHead h;
+		memcpy(&h,b+pos,sizeof(h));
+		const char *val = b+pos+hlen;
+		pos += hlen+ATTRSNAP_ALIGN(h.cnt);
+		if(pos > size) { ok = false; break; }
+
+		AttrItem *a = FindAttrib(h.tag,false);
+		if(!a || !a->fun || a->argtp != h.argtp) { ok = false; continue; }
+
+		if(h.argtp == a_LIST)
+			SetAttrib(h.tag,a,h.cnt/(int)sizeof(t_atom),(const t_atom *)val);
+		else {
+			t_any any;
+			memcpy(&any,val,sizeof(any));
+			((methfun_1)a->fun)(this,any);
+		}
+	}
+	return ok;
+}
+
+#undef ATTRSNAP_ALIGN
+
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::SetAttribs(int argc,const t_atom *argv)
+{
+	bool ok = true;
+	int cur,nxt;
+	for(cur = CheckAttrib(argc,argv); cur < argc; cur = nxt) {
+		// find next @symbol
+		for(nxt = cur+1; nxt < argc; ++nxt)
+			if(IsString(argv[nxt]) && *GetString(argv[nxt]) == '@') break;
+
+		const t_symbol *tag = MakeSymbolCached(GetString(argv[cur])+1);
+		AttrItem *attr = FindAttrib(tag,false,true);
+		if(!attr)
+			ok = false;
+		else if(nxt-cur == 2 && attr->fun && attr->argtp != a_symbol && attr->argtp != a_LIST && CanbeFloat(argv[cur+1])) {
+			// single number, no list in between
+			t_any any;
+			switch(attr->argtp) {
+			case a_float: any.ft = GetAFloat(argv[cur+1]); break;
+			case a_int: any.it = GetAInt(argv[cur+1]); break;
+			default: any.bt = GetABool(argv[cur+1]); break;
+			}
+			((methfun_1)attr->fun)(this,any);
+		}
+		else
+			SetAttrib(tag,attr,nxt-cur-1,argv+cur+1);
+	}
+	return ok;
+}
+
 //! \param tag symbol "get[attribute]"
 FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::DumpAttrib(const t_symbol *tag,AttrItem *a) const
 {
@@ -381,13 +586,27 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::DumpAttrib(const t_symbol *attr
 
 FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::BangAttrib(const t_symbol *attr,AttrItem *item)
 {
-	AtomListStatic<16> val;
 	AttrItem *item2;
 	if(!item->IsGet()) 
 		item = item->Counterpart();
 	if(item) {
 		item2 = item->Counterpart();
-		return item2 && GetAttrib(attr,item,val) && SetAttrib(attr,item2,val);
+		if(!item2) return false;
+
+		switch(item->argtp) {
+		case a_float: case a_int: case a_bool: case a_symbol:
+			// scalar values are passed on directly
+			if(item->fun && item2->fun) {
+				t_any any;
+				((methfun_1)item->fun)(this,any);
+				((methfun_1)item2->fun)(this,any);
+				return true;
+			}
+		default: {
+			AtomListStatic<16> val;
+			return GetAttrib(attr,item,val) && SetAttrib(attr,item2,val);
+		}
+		}
 	}
 	else
 		return false;
@@ -402,9 +621,11 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::BangAttrib(const t_symbol *attr
 FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::BangAttribAll()
 {
     ItemCont *clattrhead = ClAttrs(thisClassId());
+    ItemCont *const own = attrhead;
+    FLEXT_TEMP_TYPENAME ItemCont::Reader guard(own);
 
 	for(int i = 0; i <= 1; ++i) {
-        ItemCont *a = i?attrhead:clattrhead;
+        ItemCont *a = i?own:clattrhead;
 		if(a) {
             ItemSet &ai = a->GetInlet(); // \todo need to check for presence of inlet 0?
 /*
@@ -149,7 +149,14 @@ void tclscript()
         "}\n"
 
         "proc flext_cancel {id} {\n"
-            "pd [concat $id cancel \\;]\n"
+            "global flext_dlg flext_dlgobj flext_dlgix\n"
+            "if { [info exists flext_dlgobj($id)] } {\n"
+                "set obj $flext_dlgobj($id)\n"
+                "if { [info exists flext_dlg($obj)] && $flext_dlg($obj) == $id } { unset flext_dlg($obj) }\n"
+                "unset flext_dlgobj($id)\n"
+                "array unset flext_dlgix $id,*\n"
+            "}\n"
+            "pd [concat $id attributedialogclose \\;]\n"
         "}\n"
 
         "proc flext_ok {id alen} {\n"
@@ -157,6 +164,35 @@ void tclscript()
             "flext_cancel $id\n"
         "}\n")
     );
+    sys_vgui(const_cast<char *>(
+        // open the dialog with the attribute layout (names, types and kinds) and the values of an object
+        "proc pdtk_flext_open {id obj layout} {\n"
+            "global flext_title flext_values flext_layout flext_dlg flext_dlgobj flext_dlgix\n"
+            "set attrlist {}\n"
+            "set ix 1\n"
+            "foreach {an atp afl} $flext_layout($layout) {av ai asv} $flext_values($obj) {\n"
+                "lappend attrlist $an $av $ai $atp $asv $afl\n"
+                "set flext_dlgix($id,$an) $ix\n"
+                "incr ix\n"
+            "}\n"
+            "set title $flext_title($obj)\n"
+            "unset flext_title($obj) flext_values($obj)\n"
+            "set flext_dlg($obj) $id\n"
+            "set flext_dlgobj($id) $obj\n"
+            "pdtk_flext_dialog $id $title $attrlist\n"
+        "}\n"
+
+        // set the current value of an attribute in the open dialog of an object
+        "proc flext_dialog_value {obj an av} {\n"
+            "global flext_dlg flext_dlgix\n"
+            "if { ![info exists flext_dlg($obj)] } return\n"
+            "set id $flext_dlg($obj)\n"
+            "if { ![info exists flext_dlgix($id,$an)] } return\n"
+            "set vid [string trimleft $id .]\n"
+            "upvar #0 var_val_$flext_dlgix($id,$an)_$vid val\n"
+            "set val $av\n"
+        "}\n")
+    );
     sys_vgui(const_cast<char *>(
         "proc flext_help {id} {\n"
             "toplevel $id.hw\n"
@@ -523,15 +559,75 @@ size_t escapeit(char *dst,size_t maxlen,const char *src)
     return d-dst;
 }
 
+typedef TablePtrMap<flext_obj::t_classid,flext_obj::t_classid,8> LayoutMap;
+
+FLEXT_TEMPLATE
+struct DialogVars {
+    //! classes whose attribute layout has been sent to the GUI
+    static LayoutMap layouts;
+};
+
+FLEXT_TEMPIMPL(LayoutMap DialogVars)::layouts;
+
+//! Print an atom list escaped for the GUI
+FLEXT_TEMPLATE
+void printlist(char *buf,size_t size,const flext::AtomList &l)
+{
+    char *b = buf; *b = 0;
+    for(int i = 0; i < l.Count(); ++i) {
+        char tmp[256];
+        flext::PrintAtom(l[i],tmp,sizeof(tmp));
+        b += FLEXT_TEMPINST(escapeit)(b,size+buf-b,tmp);
+        if(i < l.Count()-1) { *(b++) = ' '; *b = 0; }
+    }
+}
+
+/*! \brief Open the attribute editor
+    The layout of the attributes (names, types and kinds) is sent once per class,
+    objects with attributes of their own send theirs every time.
+    Then only the values are sent, the dialog is made by the procedures defined in tclscript.
+*/
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::cb_GfxProperties(flext_hdr *c, t_glist *)
 {
+    typedef FLEXT_TEMPINST(DialogVars) Vars;
+
     flext_base *th = thisObject(c);
     char buf[1000];
 
-     // beginning of proc
-    sys_vgui(const_cast<char *>("proc pdtk_flext_dialog_%p {title} {\n"),th);
+    AtomListStatic<32> la;
+    th->ListAttrib(la);
+    int cnt = la.Count();
 
-    sys_vgui(const_cast<char *>("pdtk_flext_dialog $title {\n"));
+    const t_classid cl = th->thisClassId();
+    const void *layout = th->attrhead?(const void *)th:(const void *)cl;
+    if(th->attrhead || !Vars::layouts.find(cl)) {
+        sys_vgui(const_cast<char *>("set flext_layout(%p) {"),layout);
+
+        for(int i = 0; i < cnt; ++i) {
+            const t_symbol *sym = GetSymbol(la[i]); 
+            AttrItem *gattr = th->FindAttrib(sym,true);
+            AttrItem *pattr = gattr?gattr->Counterpart():th->FindAttrib(sym,false);
+
+            // get attribute type
+            int tp;
+            switch((gattr?gattr:pattr)->argtp) {
+                case a_int: tp = 0; break;
+                case a_float: tp = 1; break;
+                case a_bool: tp = 2; break;
+                case a_symbol: tp = 3; break;
+                case a_list: 
+                case a_LIST: tp = 4; break;
+                default: 
+                    tp = 5; 
+                    FLEXT_ASSERT(false);
+            }
+
+            sys_vgui(const_cast<char *>("%s %i %i "),GetString(sym),tp,pattr?(pattr->BothExist()?2:1):0);
+        }
+
+        sys_vgui(const_cast<char *>("}\n"));
+        if(!th->attrhead) Vars::layouts.insert(cl,cl);
+    }
 
     // add title
     t_text *x = (t_text *)c;
@@ -541,11 +637,10 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::cb_GfxProperties(flext_hdr *c,
     t_atom *argv = binbuf_getvec(x->te_binbuf);
 
     PrintList(argc,argv,buf,sizeof(buf));
-    sys_vgui(const_cast<char *>("%s } {\n"),buf);
+    sys_vgui(const_cast<char *>("set flext_title(%p) {%s}\n"),th,buf);
 
-    AtomListStatic<32> la;
-    th->ListAttrib(la);
-    int cnt = la.Count();
+    // current value, init value and save flag of the attributes
+    sys_vgui(const_cast<char *>("set flext_values(%p) {"),th);
 
     for(int i = 0; i < cnt; ++i) {
         const t_symbol *sym = GetSymbol(la[i]); 
@@ -558,13 +653,10 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::cb_GfxProperties(flext_hdr *c,
         // get flags
         int sv;
         const AtomList *initdata;
-        const AttrData *a = th->attrdata->find(sym);
-//        AttrDataCont::iterator it = th->attrdata->find(sym);
-//        if(it == th->attrdata->end())
+        const AttrData *a = th->FindAttrData(sym);
         if(!a)
             sv = 0,initdata = NULL;
         else {
-//            const AttrData &a = *it.data();
             if(a->IsSaved())
                 sv = 2;
             else if(a->IsInit())
@@ -574,68 +666,56 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::cb_GfxProperties(flext_hdr *c,
             initdata = a->IsInitValue()?&a->GetInitValue():NULL;
         }
 
-        // get attribute type
-        int tp;
-        bool list;
-        switch((gattr?gattr:pattr)->argtp) {
-            case a_int: tp = 0; list = false; break;
-            case a_float: tp = 1; list = false; break;
-            case a_bool: tp = 2; list = false; break;
-            case a_symbol: tp = 3; list = true; break;
-            case a_list: 
-            case a_LIST: tp = 4; list = true; break;
-            default: 
-                tp = 5; list = true; 
-                FLEXT_ASSERT(false);
-        }
-
-        sys_vgui(const_cast<char *>(list?"%s {":"%s "),GetString(sym));
-
         AtomListStatic<32> lv;
         if(gattr) { // gettable attribute is present
             // Retrieve attribute value
             th->GetAttrib(sym,gattr,lv);
-
-            char *b = buf; *b = 0;
-            for(int i = 0; i < lv.Count(); ++i) {
-                char tmp[100];
-                PrintAtom(lv[i],tmp,sizeof tmp);
-                b += FLEXT_TEMPINST(escapeit)(b,sizeof(buf)+buf-b,tmp);
-                if(i < lv.Count()-1) { *(b++) = ' '; *b = 0; }
-            }
-            sys_vgui(const_cast<char *>("%s"),buf);
+            FLEXT_TEMPINST(printlist)(buf,sizeof(buf),lv);
+            sys_vgui(const_cast<char *>("{%s} "),buf);
         }
         else
-            sys_vgui(const_cast<char *>("{}"));
-
-        sys_vgui(const_cast<char *>(list?"} {":" "));
+            sys_vgui(const_cast<char *>("{} "));
 
         if(pattr) {
             // if there is initialization data take this, otherwise take the current data
-            const AtomList &lp = initdata?*initdata:static_cast<const AtomList &>(lv);
-
-            char *b = buf; *b = 0;
-            for(int i = 0; i < lp.Count(); ++i) {
-                char tmp[256];
-                PrintAtom(lp[i],tmp,sizeof(tmp)); 
-                b += FLEXT_TEMPINST(escapeit)(b,sizeof(buf)+buf-b,tmp);
-                if(i < lp.Count()-1) { *(b++) = ' '; *b = 0; }
-            }
-            sys_vgui(const_cast<char *>("%s"),buf);
+            FLEXT_TEMPINST(printlist)(buf,sizeof(buf),initdata?*initdata:static_cast<const AtomList &>(lv));
+            sys_vgui(const_cast<char *>("{%s} "),buf);
         }
         else
-            sys_vgui(const_cast<char *>("{}"));
-
+            sys_vgui(const_cast<char *>("{} "));
 
-        sys_vgui(const_cast<char *>(list?"} %i %i %i \n":" %i %i %i \n"),tp,sv,pattr?(pattr->BothExist()?2:1):0);
+        sys_vgui(const_cast<char *>("%i "),sv);
     }
 
-    sys_vgui(const_cast<char *>(" } }\n")); // end of proc
+    sys_vgui(const_cast<char *>("}\n"));
 
-    STD::sprintf(buf,"pdtk_flext_dialog_%p %%s\n",th);
+    STD::sprintf(buf,"pdtk_flext_open %%s %p %p\n",th,layout);
     gfxstub_new((t_pd *)th->thisHdr(), th->thisHdr(),buf);
+    th->attrdialog = true;
+}
 
-    //! \todo delete proc in TCL space
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::cb_AttrDialogClose(flext_base *th)
+{
+    th->attrdialog = false;
+    gfxstub_deleteforkey(th->thisHdr());
+    return true;
+}
+
+//! Send the current value of an attribute to the open editor
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::UpdateAttrDialog(const t_symbol *tag,AttrItem *a)
+{
+#ifdef FLEXT_THREADS
+    // the GUI is only reached from the system thread
+    if(!IsSystemThread()) return;
+#endif
+    AttrItem *gattr = a->IsGet()?a:a->Counterpart();
+    if(!gattr) return;
+
+    AtomListStatic<32> lv;
+    GetAttrib(tag,gattr,lv);
+    char buf[1000];
+    FLEXT_TEMPINST(printlist)(buf,sizeof(buf),lv);
+    sys_vgui(const_cast<char *>("flext_dialog_value %p %s {%s}\n"),this,GetString(tag),buf);
 }
 
 FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::cb_AttrDialog(flext_base *th,int argc,const t_atom *argv)
@@ -671,11 +751,11 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::cb_AttrDialog(flext_base *th,in
             bool ret = th->SetAttrib(aname,attr,ccnt,argv+coffs);
             FLEXT_ASSERT(ret);
 
-            AttrData *a = th->attrdata->find(aname);
+            AttrData *a = th->FindAttrData(aname);
             if(sv >= 1) {
                 // if data not present create it
                 if(!a) {
-                    AttrData *old = th->attrdata->insert(aname,a = new AttrData);
+                    AttrData *old = th->ThAttrData()->insert(aname,a = new AttrData);
                     FLEXT_ASSERT(!old);
                 }
 
@@ -742,7 +822,7 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::BinbufAttr(t_binbuf *b,bool tra
         const t_symbol *sym = GetSymbol(la[i]);
         const AtomList *lref = NULL;
 
-        AttrData *a = attrdata->find(sym);
+        AttrData *a = FindAttrData(sym);
         if(a) {
             if(a->IsInit() && a->IsInitValue()) {
                 lref = &a->GetInitValue();
@@ -18,6 +18,7 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 #include "flext.h"
 
 #include "flinternal.h"
+#include "lockfree/cas.hpp"
 #include <cstring>
 #include <cctype>
 #include <cstdlib>
@@ -34,6 +35,11 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 #endif
 #endif
 
+#if FLEXT_SYS == FLEXT_SYS_MAX && !defined(FLEXT_LOCKSPIN)
+//! Number of attempts to enter a contended object lock before the thread is parked
+#define FLEXT_LOCKSPIN 100
+#endif
+
 #include "flpushns.h"
 
 /////////////////////////////////////////////////////////
@@ -53,6 +59,9 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_obj))::initing = false;
 FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_obj))::exiting = false;
 FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_obj))::init_ok;
 
+FLEXT_TEMPIMPL(FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext_obj))::SharedMap *FLEXT_CLASSDEF(flext_obj))::shareddata = NULL;
+FLEXT_TEMPIMPL(double FLEXT_CLASSDEF(flext_obj))::sharedsr = 0;
+
 //FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_obj))::ProcessAttributes(bool attr) { process_attributes = attr; }
 
 #if FLEXT_SYS == FLEXT_SYS_MAX
@@ -73,9 +82,32 @@ FLEXT_TEMPIMPL(FLEXT_CLASSDEF(flext_obj))::FLEXT_CLASSDEF(flext_obj)()
 #elif FLEXT_SYS == FLEXT_SYS_MAX
     m_canvas = (t_patcher *)sym__shP->s_thing;
     x_obj->curinlet = 0;
+    lock = NULL;
+    locking = false;
 #endif
 }
 
+#if FLEXT_SYS == FLEXT_SYS_MAX
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_obj))::LockObj()
+{
+    t_critical c = lock;
+    if(UNLIKELY(!c)) {
+        // most objects are never locked by two threads, so the region is only created when needed
+        critical_new(&c);
+        if(!lockfree::CAS(&lock,(t_critical)NULL,c)) {
+            // another thread was faster
+            critical_free(c);
+            c = lock;
+        }
+    }
+
+    // the region is usually held only for the duration of a message
+    for(int i = 0; i < FLEXT_LOCKSPIN; ++i)
+        if(!critical_tryenter(c)) return;
+    critical_enter(c);
+}
+#endif
+
 /////////////////////////////////////////////////////////
 // Destructor
 //
@@ -93,6 +125,84 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_obj))::__setup__(t_classid)
     flext::Setup(); 
 }	
 
+FLEXT_TEMPIMPL(FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext_obj))::SharedData *FLEXT_CLASSDEF(flext_obj))::GetShared(const t_symbol *key,SharedData *(*make)(flext_obj *obj),bool srdep)
+{
+    if(!shareddata) shareddata = new SharedMap;
+
+    // all classes using this key
+    SharedData *head = shareddata->find(key),*d;
+    for(d = head; d && d->cls != clss; d = d->nxt) {}
+
+    if(!d) {
+        d = make(this);
+        if(!d) return NULL;
+        d->srdep = srdep;
+        d->valid = true;
+        d->cls = clss;
+        d->key = key;
+        d->nxt = head;
+        shareddata->insert(key,d);
+    }
+
+    ++d->refs;
+    return d;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_obj))::ReleaseShared(SharedData *d)
+{
+    if(!d) return;
+    FLEXT_ASSERT(d->refs > 0);
+    if(--d->refs) return;
+
+    if(d->valid) {
+        // unlink
+        SharedData *head = shareddata->find(d->key);
+        if(head == d) {
+            if(d->nxt) shareddata->insert(d->key,d->nxt);
+            else shareddata->remove(d->key);
+        }
+        else {
+            SharedData *p = head;
+            while(p->nxt != d) p = p->nxt;
+            p->nxt = d->nxt;
+        }
+    }
+    delete d;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_obj))::InvalidateShared(double samplerate)
+{
+    if(samplerate == sharedsr) return;
+    sharedsr = samplerate;
+    if(!shareddata) return;
+
+    // unlink sample rate dependent data, the objects still holding it release it later
+    const t_symbol **empty = new const t_symbol *[shareddata->size()];
+    int nempty = 0;
+    for(FLEXT_TEMP_TYPENAME SharedMap::iterator it(*shareddata); it; ++it) {
+        SharedData *keep = NULL,**last = &keep;
+        for(SharedData *d = it.data(); d; d = d->nxt) {
+            if(d->srdep) 
+                d->valid = false;
+            else {
+                *last = d;
+                last = &d->nxt;
+            }
+        }
+        *last = NULL;
+
+        if(keep) 
+            // just updates the slot
+            shareddata->insert(it.key(),keep);
+        else
+            empty[nempty++] = it.key();
+    }
+
+    // keys are removed after iterating
+    for(int i = 0; i < nempty; ++i) shareddata->remove(empty[i]);
+    delete[] empty;
+}
+
 FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_obj))::Init() { return true; }
 FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_obj))::Finalize() { return true; }
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_obj))::Exit() {}
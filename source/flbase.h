@@ -17,6 +17,7 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 
 #include "flstdc.h"
 #include "flsupport.h"
+#include "flmap.h"
 #include <map>
 
 #include "flpushns.h"
@@ -67,7 +68,8 @@ struct FLEXT_SHARE flext_hdr
 
 FLEXT_TEMPLATE class flext_class;
 
-typedef std::map<const t_symbol *,FLEXT_TEMPINST(flext_class) *> LibMap;
+//! Registered classes by name symbol
+typedef TablePtrMap<const t_symbol *,FLEXT_TEMPINST(flext_class) *,64> LibMap;
 
 class flext_library;
 
@@ -167,6 +169,42 @@ class FLEXT_SHARE FLEXT_CLASSDEF(flext_obj):
         static bool HasDSPIn(t_classid id);
         static bool IsLib(t_classid id);
 
+        /*! \brief Flush denormals to zero (FTZ/DAZ) while the DSP function of a class runs
+            \param id ... class (e.g. in the class setup function), NULL for all classes
+            \note The floating point state of the host is restored afterwards
+        */
+        static void SetFlushDenormals(t_classid id,bool on);
+        //! Check whether denormals are flushed for a class (or all classes with NULL)
+        static bool GetFlushDenormals(t_classid id);
+
+        /*! \brief Accept multichannel signal connections for a DSP class
+            \param id ... class (in the class setup function)
+            The objects get all channels of a connection as contiguous vectors (see flext_dsp::InSigChannels),
+            other classes only get the first channel.
+            \note Pd 0.54 and later (the flext build must use the respective Pd headers)
+        */
+        static void SetMultichannel(t_classid id,bool on);
+        //! Check whether a class accepts multichannel signals
+        static bool GetMultichannel(t_classid id);
+
+        /*! \brief Process the signals of a DSP class in single precision
+            \param id ... class (in the class setup function)
+            The objects implement flext_dsp::CbSignalSingle instead of CbSignal. With double precision hosts (Max 64-bit)
+            flext converts the vectors before and after the call, otherwise the host vectors are passed on.
+        */
+        static void SetSinglePrecision(t_classid id,bool on);
+        //! Check whether a class processes in single precision
+        static bool GetSinglePrecision(t_classid id);
+
+        /*! \brief Set up classes registered from now on only when their first object is created
+            \note Names and aliases are registered with the host right away, the class setup
+            (methods, attributes, proxies) is deferred. Call it in the library setup function, before the classes are added.
+            The default is off, or on if FLEXT_LAZYSETUP is defined. Pd only, Max needs the class set up at load time.
+        */
+        static void SetLazySetup(bool lazy) { lazysetup = lazy; }
+        //! Check whether the setup of classes is deferred
+        static bool GetLazySetup() { return lazysetup; }
+
         bool HasAttributes() const;
         bool IsLib() const;
         bool IsDSP() const;
@@ -197,6 +235,57 @@ class FLEXT_SHARE FLEXT_CLASSDEF(flext_obj):
 
 	//!	@} FLEXT_OBJ_HELP
 
+		/*! \brief Declare that objects of a class don't need the object lock (call at class setup)
+			Message callbacks then don't lock the object, use this for classes which don't use threads.
+			\note Only Max/MSP has object locks, for PD this has no effect
+		*/
+		static void SetNoLock(t_classid c,bool nolock = true);
+
+// --- shared data -------------------------------------------------------	
+
+	/*!	\defgroup FLEXT_OBJ_SHARED Data shared by all objects of a class
+		e.g. wavetables, window functions or filter coefficients
+		@{ 
+	*/
+
+		//! \brief Base of shared data, derive from it (the destructor is called with the last reference)
+		class SharedData:
+			public flext_root
+		{
+		public:
+			SharedData(): refs(0),srdep(false),valid(false),cls(NULL),key(NULL),nxt(NULL) {}
+			virtual ~SharedData() {}
+
+		private:
+			friend class FLEXT_CLASSDEF(flext_obj);
+			int refs;
+			bool srdep,valid;
+			t_classid cls;
+			const t_symbol *key;
+			SharedData *nxt;
+		};
+
+		/*! \brief Get the data shared by the objects of this class under key, with a reference for this object
+			\param make function creating the data, called by the first object that needs it
+			\param srdep true if the data depends on the sample rate. 
+			A change of the sample rate invalidates it, so that objects getting it anew (e.g. in flext_dsp::CbDsp) receive fresh data.
+			\return the data (NULL if make returned NULL), to be released with ReleaseShared (e.g. in the destructor)
+			\note Use it from the system thread only.
+		*/
+		SharedData *GetShared(const t_symbol *key,SharedData *(*make)(flext_obj *obj),bool srdep = false);
+		//! Get the shared data (with key as string)
+		SharedData *GetShared(const char *key,SharedData *(*make)(flext_obj *obj),bool srdep = false) { return GetShared(MakeSymbol(key),make,srdep); }
+
+		//! Release a reference to shared data (it's deleted with the last one), NULL is ignored
+		static void ReleaseShared(SharedData *d);
+
+		/*! \brief Invalidate sample rate dependent shared data, if the sample rate has changed
+			\note This is called by flext_dsp with the DSP setup.
+		*/
+		static void InvalidateShared(double samplerate);
+
+	//!	@} FLEXT_OBJ_SHARED
+
 
 // --- internal stuff -------------------------------------------------------	
 
@@ -216,9 +305,14 @@ class FLEXT_SHARE FLEXT_CLASSDEF(flext_obj):
 //        static bool	process_attributes;
 
 #if FLEXT_SYS == FLEXT_SYS_MAX
+        //! object lock (a Max critical region), created on first use
         t_critical lock;
-        void Lock() { critical_enter(lock); }
-        void Unlock() { critical_exit(lock); }
+        //! object is locked, false before construction has finished or for classes without locking
+        bool locking;
+        void Lock() { if(locking) LockObj(); }
+        void Unlock() { if(locking) critical_exit(lock); }
+        //! Enter the object lock, spinning for a while before the thread is parked
+        void LockObj();
         static void SysLock() { critical_enter(0); }
         static void SysUnlock() { critical_exit(0); }
 #elif FLEXT_SYS == FLEXT_SYS_PD
@@ -311,6 +405,21 @@ class FLEXT_SHARE FLEXT_CLASSDEF(flext_obj):
         // static initialization (with constructor) doesn't work for Codewarrior
         static LibMap *libnames;
 
+        // flush denormals for all classes
+        static bool flushdenormals;
+
+        // defer class setup to the first object
+        static bool lazysetup;
+
+        // shared data of classes, by key
+        typedef TablePtrMap<const t_symbol *,SharedData *,8> SharedMap;
+        static SharedMap *shareddata;
+        // sample rate of the shared data
+        static double sharedsr;
+
+        //! Run the setup function of a class (if it hasn't been run yet)
+        static void obj_setup(FLEXT_TEMPINST(flext_class) *lo);
+
         static FLEXT_TEMPINST(flext_class) *FindName(const t_symbol *s,FLEXT_TEMPINST(flext_class) *o = NULL);
 
 #if FLEXT_SYS == FLEXT_SYS_PD
@@ -338,6 +447,11 @@ class FLEXT_SHARE FLEXT_CLASSDEF(flext_obj):
 #define FLEXT_GET_PRE(F) flext_g_##F
 #define FLEXT_SET_PRE(F) flext_s_##F
 
+/*! \brief Trampoline for a member function with typed arguments (see flext_base::TypedBinder)
+    \note Inside a class template use flext_base::TypedBinder(&CL::F).template Bind<&CL::F>()
+*/
+#define FLEXT_TYPED(CL,F) flext_base::TypedBinder(&CL::F).Bind<&CL::F>()
+
 
 #ifndef FLEXT_ATTRIBUTES
 /*! \brief Switch for global attribute processing
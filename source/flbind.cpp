@@ -19,6 +19,7 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 #include "flpushns.h"
 
 FLEXT_TEMPIMPL(t_class *FLEXT_CLASSDEF(flext_base))::pxbnd_class = NULL;
+FLEXT_TEMPIMPL(FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext_base))::BindMap *FLEXT_CLASSDEF(flext_base))::pxbnd_map = NULL;
 
 #if FLEXT_SYS == FLEXT_SYS_MAX
 FLEXT_TEMPLATE
@@ -60,40 +61,110 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::SetupBindProxy()
 #else
 #pragma warning("Not implemented!")
 #endif
+        pxbnd_map = new BindMap;
     }
 }
 
 
 FLEXT_TEMPIMPL(FLEXT_CLASSDEF(flext_base))::BindItem::BindItem(bool (*f)(flext_base *,t_symbol *s,int,t_atom *,void *data),pxbnd_object *p):
-    Item(NULL),fun(f),px(p)
+    Item(NULL),fun(f),px(p),slot(-1)
 {}
 
 FLEXT_TEMPIMPL(FLEXT_CLASSDEF(flext_base))::BindItem::~BindItem()
 {
-    if(px) {
-        FLEXT_ASSERT(!fun); // check if already unbound
-        object_free(&px->obj);
-    }
+    // still bound (the object has been deleted without unbinding)
+    if(px) px->Remove(slot);
 }
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::BindItem::Unbind(const t_symbol *tag)
 {
     if(px) {
         FLEXT_ASSERT(fun);
+        FLEXT_ASSERT(px->sym == tag);
+
+        px->Remove(slot);
+        px = NULL;
+        fun = NULL;
+    }
+}
+
+FLEXT_TEMPIMPL(int FLEXT_CLASSDEF(flext_base))::pxbnd_object::Add(flext_base *b,BindItem *it,void *d)
+{
+    if(cnt == size) {
+        const int nsz = size?size*2:4;
+        Entry *ne = new Entry[nsz];
+        if(entries) {
+            memcpy(ne,entries,cnt*sizeof(*entries));
+            delete[] entries;
+        }
+        entries = ne;
+        size = nsz;
+    }
+
+    Entry &e = entries[cnt];
+    e.base = b;
+    e.fun = it->fun;
+    e.data = d;
+    e.item = it;
+    return cnt++;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::pxbnd_object::Remove(int slot)
+{
+    FLEXT_ASSERT(slot >= 0 && slot < cnt);
+
+    if(busy) {
+        // dispatching: don't move entries around, compact later
+        entries[slot].fun = NULL;
+        entries[slot].item = NULL;
+        dirty = true;
+    }
+    else {
+        if(slot != --cnt) {
+            // move last entry into the gap
+            entries[slot] = entries[cnt];
+            if(entries[slot].item) entries[slot].item->slot = slot;
+        }
+        if(!cnt) Release();
+    }
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::pxbnd_object::Compact()
+{
+    FLEXT_ASSERT(!busy);
+
+    int j = 0;
+    for(int i = 0; i < cnt; ++i) {
+        if(entries[i].fun) {
+            if(i != j) {
+                entries[j] = entries[i];
+                entries[j].item->slot = j;
+            }
+            ++j;
+        }
+    }
+    cnt = j;
+    dirty = false;
 
+    if(!cnt) Release();
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::pxbnd_object::Release()
+{
 #if FLEXT_SYS == FLEXT_SYS_PD
-        pd_unbind(&px->obj.ob_pd,const_cast<t_symbol *>(tag)); 
+    pd_unbind(&obj.ob_pd,const_cast<t_symbol *>(sym)); 
 #elif FLEXT_SYS == FLEXT_SYS_MAX
-        if(tag->s_thing == (t_object *)px) 
-            const_cast<t_symbol *>(tag)->s_thing = NULL; 
-        else
-            error("flext - Binding to symbol %s not found",tag->s_name);
+    if(sym->s_thing == (t_object *)this) 
+        const_cast<t_symbol *>(sym)->s_thing = NULL; 
+    else
+        error("flext - Binding to symbol %s not found",sym->s_name);
 #else
-#           pragma warning("Not implemented")
+#       pragma warning("Not implemented")
 #endif
 
-        fun = NULL;
-    }
+    pxbnd_map->remove(sym);
+    if(entries) delete[] entries;
+    object_free(&obj);
 }
 
 #if FLEXT_SYS == FLEXT_SYS_PD
@@ -128,38 +199,49 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::BindMethod(const t_symbol *sym,
 
     SetupBindProxy(); 
 
+    // all methods bound to the symbol share one dispatcher
+    pxbnd_object *px = pxbnd_map->find(sym);
+    if(!px) {
 #if FLEXT_SYS == FLEXT_SYS_PD
-    pxbnd_object *px = (pxbnd_object *)object_new(pxbnd_class);
+        px = (pxbnd_object *)object_new(pxbnd_class);
 #elif FLEXT_SYS == FLEXT_SYS_MAX
-    pxbnd_object *px = (pxbnd_object *)newobject(FLEXT_TEMPINST(ProxyVars)::px_messlist);
+        px = (pxbnd_object *)newobject(FLEXT_TEMPINST(ProxyVars)::px_messlist);
 #else
 #pragma warning("Not implemented!")
 #endif
 
-    if(px) {
-        BindItem *mi = new BindItem(fun,px);
-        bindhead->Add(mi,sym);
-
-        px->init(this,mi,data);
+        if(px) {
+            px->init(sym);
 
 #if FLEXT_SYS == FLEXT_SYS_PD
-        pd_bind(&px->obj.ob_pd,const_cast<t_symbol *>(sym)); 
+            pd_bind(&px->obj.ob_pd,const_cast<t_symbol *>(sym)); 
 #elif FLEXT_SYS == FLEXT_SYS_MAX
-        #if 1 // old code
-        if(!sym->s_thing) 
-            const_cast<t_symbol *>(sym)->s_thing = (t_object *)px;
-        else
-            error("%s - Symbol is already bound",thisName());
-        #else
-        void *binding = object_register(gensym("flext"),const_cast<t_symbol *>(sym),(t_object *)px);
-        #endif
+            #if 1 // old code
+            if(!sym->s_thing) 
+                const_cast<t_symbol *>(sym)->s_thing = (t_object *)px;
+            else {
+                error("%s - Symbol is already bound",thisName());
+                object_free(&px->obj);
+                return false;
+            }
+            #else
+            void *binding = object_register(gensym("flext"),const_cast<t_symbol *>(sym),(t_object *)px);
+            #endif
 #else
-#       pragma warning("Not implemented")
+#           pragma warning("Not implemented")
 #endif
+
+            pxbnd_map->insert(sym,px);
+        }
+        else {
+            error("%s - Symbol proxy could not be created",thisName());
+            return false;
+        }
     }
-    else 
-        error("%s - Symbol proxy could not be created",thisName());
 
+    BindItem *mi = new BindItem(fun,px);
+    bindhead->Add(mi,sym);
+    mi->slot = px->Add(this,mi,data);
     return true;
 }
 
@@ -219,7 +301,7 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::UnbindMethod(const t_symbol *sy
         }
 
         if(item) {
-            if(data) *data = item->px->data;
+            if(data) *data = item->px->entries[item->slot].data;
             ok = bindhead->Remove(item,sym,0,false);
             if(ok) {
                 item->Unbind(sym);
@@ -239,7 +321,7 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::GetBoundMethod(const t_symbol *
 
             // go through all items with matching tag
             if(item->fun == fun) {
-                data = item->px->data;
+                data = item->px->entries[item->slot].data;
                 return true;
             }
         }
@@ -269,7 +351,17 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::UnbindAll()
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::pxbnd_object::px_method(pxbnd_object *c,const t_symbol *s,int argc,t_atom *argv)
 {
-    c->item->fun(c->base,(t_symbol *)s,argc,(t_atom *)argv,c->data);
+    ++c->busy;
+
+    // methods bound while dispatching don't receive this message
+    const int n = c->cnt;
+    for(int i = 0; i < n; ++i) {
+        // entries may be reallocated by a method binding to the symbol
+        const Entry e = c->entries[i];
+        if(e.fun) e.fun(e.base,(t_symbol *)s,argc,(t_atom *)argv,e.data);
+    }
+
+    if(!--c->busy && c->dirty) c->Compact();
 }
 
 #include "flpopns.h"
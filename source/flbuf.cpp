@@ -16,6 +16,33 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 #include "flext.h"
 #include "flfeatures.h"
 #include <set>
+#include <map>
+#include <cstring>
+#include <climits>
+#include <cmath>
+#include "lockfree/cas.hpp"
+#include "flshm.h"
+
+#if FLEXT_SYS == FLEXT_SYS_PD
+#ifdef _MSC_VER
+    #pragma warning (push)
+    #pragma warning (disable:4091)
+#endif
+// for the index range of the array graph
+#include <g_canvas.h>
+#ifdef _MSC_VER
+    #pragma warning (pop)
+#endif
+#endif
+
+#if FLEXT_OS == FLEXT_OS_WIN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #include "flpushns.h"
 
@@ -24,6 +51,11 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 #if FLEXT_SYS == FLEXT_SYS_PD
 #define DIRTY_INTERVAL 0   // buffer dirty check in msec
 
+#ifndef FLEXT_BUFFER_REDRAW
+//! minimum time between forced redraws of an array in msec
+#define FLEXT_BUFFER_REDRAW 50
+#endif
+
 FLEXT_TEMPLATE
 class Buffers:
     public std::set<flext::buffer *>
@@ -37,23 +69,87 @@ FLEXT_TEMPIMPL(FLEXT_TEMPINST(Buffers) Buffers)::buffers;
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_obj))::cb_buffer_dsp(void *c,t_signal **sp)
 {
-    for(FLEXT_TEMPINST(Buffers)::iterator it = FLEXT_TEMPINST(Buffers)::buffers.begin(); it != FLEXT_TEMPINST(Buffers)::buffers.end(); ++it)
-		(*it)->Set();
+    buffer::Rescan();
 } 
 #endif
 
+//! Shared state per buffer symbol
+FLEXT_TEMPLATE
+class BufferRefs:
+    public std::map<const t_symbol *,flext::buffer::Shared *>
+{
+public:
+    static flext::buffer::Shared *Acquire(const t_symbol *s)
+    {
+        flext::buffer::Shared *&sh = refs[s];
+        if(!sh) {
+            sh = new flext::buffer::Shared;
+            sh->sym = s;
+            sh->refs = 0;
+            sh->data = NULL;
+            sh->chns = sh->frames = 0;
+            sh->gen = 0;
+#if FLEXT_SYS == FLEXT_SYS_PD
+            sh->arr = NULL;
+            sh->stamp = -1;
+            sh->interval = 0;
+            sh->isdirty = false;
+            sh->dirtyfrom = sh->dirtyto = 0;
+            sh->redrawn = 0;
+            sh->ticking = false;
+            sh->tick = NULL;
+#endif
+            sh->resizefr = 0;
+            sh->resizekeep = false;
+            sh->resizezero = true;
+            sh->resizing = 0;
+            sh->resizeseq = 0;
+            sh->orphan = false;
+            sh->shmbase = NULL;
+            sh->shmsize = 0;
+            sh->shmname = NULL;
+            sh->shmwriters = 0;
+            sh->shmpending = 0;
+#if FLEXT_OS == FLEXT_OS_WIN
+            sh->shmmap = NULL;
+            sh->shmindex = sh->shmindexmap = NULL;
+            sh->shmseg = 0;
+#endif
+        }
+        ++sh->refs;
+        return sh;
+    }
+
+    static void Release(flext::buffer::Shared *sh)
+    {
+        if(!--sh->refs) {
+            refs.erase(sh->sym);
+#if FLEXT_SYS == FLEXT_SYS_PD
+            if(sh->tick) clock_free(sh->tick);
+            sh->tick = NULL;
+#endif
+            if(sh->resizing || sh->shmpending)
+                // the resize or export callback will delete it
+                sh->orphan = true;
+            else
+                delete sh;
+        }
+    }
+
+    static FLEXT_TEMPINST(BufferRefs) refs;
+};
+
+FLEXT_TEMPIMPL(FLEXT_TEMPINST(BufferRefs) BufferRefs)::refs;
+
+
 FLEXT_TEMPIMPL(FLEXT_CLASSDEF(flext))::buffer::buffer(const t_symbol *bn,bool delayed):
+    shared(NULL),gen(0),
     sym(NULL),data(NULL),
     chns(0),frames(0)
 {
 #if FLEXT_SYS == FLEXT_SYS_PD
     arr = NULL;
     interval = DIRTY_INTERVAL;
-    isdirty = false;
-    ticking = false;
-	
-	// we probably should make this global... work on the set of registered buffers
-    tick = clock_new(this,(t_method)cb_tick);
 #endif
 
     if(bn) Set(bn,delayed);
@@ -69,15 +165,17 @@ FLEXT_TEMPIMPL(FLEXT_CLASSDEF(flext))::buffer::buffer(const t_symbol *bn,bool de
 
 FLEXT_TEMPIMPL(FLEXT_CLASSDEF(flext))::buffer::~buffer()
 {
-#if FLEXT_SYS == FLEXT_SYS_PD
-    if(tick) clock_free(tick);
-#endif
-
 #if FLEXT_SYS == FLEXT_SYS_PD
 	// unregister buffer
     FLEXT_ASSERT(FLEXT_TEMPINST(Buffers)::buffers.find(this) != FLEXT_TEMPINST(Buffers)::buffers.end());
     FLEXT_TEMPINST(Buffers)::buffers.erase(this);
 #endif
+
+    if(shared) {
+        // the last one ends the export
+        if(shared->refs == 1) ShmFree(*shared,true);
+        FLEXT_TEMPINST(BufferRefs)::Release(shared);
+    }
 }
 
 FLEXT_TEMPIMPL(int FLEXT_CLASSDEF(flext))::buffer::Set(const t_symbol *s,bool nameonly)
@@ -92,120 +190,149 @@ FLEXT_TEMPIMPL(int FLEXT_CLASSDEF(flext))::buffer::Set(const t_symbol *s,bool na
         chns = 0; 
     }
 
-    if(s && *GetString(s))  sym = s;
+    if(s && *GetString(s)) {
+        if(sym != s) {
+            // switch to the shared state of the new symbol
+            if(shared) {
+                if(shared->refs == 1) ShmFree(*shared,true);
+                FLEXT_TEMPINST(BufferRefs)::Release(shared);
+            }
+            shared = FLEXT_TEMPINST(BufferRefs)::Acquire(s);
+            gen = ~shared->gen; // force Sync
+#if FLEXT_SYS == FLEXT_SYS_PD
+            if(!shared->tick) shared->tick = clock_new(shared,(t_method)cb_tick);
+#endif
+        }
+        sym = s;
+    }
 
     if(!sym) {
         if(valid) ret = -1;
     }   
     else if(!nameonly) {
-#if FLEXT_SYS == FLEXT_SYS_PD   
-        arr = (t_garray *)pd_findbyclass(const_cast<t_symbol *>(sym), garray_class);
-        if(!arr)
-        {
-            if (*GetString(sym)) FLEXT_LOG1("buffer: no such array '%s'",GetString(sym));
-//            sym = NULL;
-            if(valid) ret = -1;
-        }
-        else {
-	        int frames1;
-			FLEXT_ARRAYTYPE *data1;
-	        if(!FLEXT_PD_ARRAYGRAB(arr, &frames1, &data1))
-	        {
-	            error("buffer: bad template '%s'",GetString(sym)); 
-	            data = NULL;
-	            frames = 0;
-	            if(valid) ret = -1;
-	        }
-	        else {
-	            ret = 0;
-	            garray_usedindsp(arr);
-	            if(frames != frames1) { frames = frames1; if(!ret) ret = 1; }
-				Element *data2 = reinterpret_cast<Element *>(data1);
-	            if(data != data2) { data = data2; if(!ret) ret = 1; }
-	            chns = 1;
-	        }
-		}
-#elif FLEXT_SYS == FLEXT_SYS_MAX
-        if(sym->s_thing) {
-            const t_buffer *p = (const t_buffer *)sym->s_thing;
-            
-            FLEXT_ASSERT(!NOGOOD(p));
-            
-            if(ob_sym(p) != sym_buffer) {
-                post("buffer: object '%s' not valid (type %s)",GetString(sym),GetString(ob_sym(p))); 
-                if(valid) ret = -2;
-            }
-            else {
-#ifdef FLEXT_DEBUG
-//              post("flext: buffer object '%s' - valid:%i samples:%i channels:%i frames:%i",GetString(sym),p->b_valid,p->b_frames,p->b_nchans,p->b_frames);
-#endif
-				Element *data1 = reinterpret_cast<Element *>(p->b_samples);
-                if(data != data1) { data = data1; if(!ret) ret = 1; }
-                if(chns != p->b_nchans) { chns = p->b_nchans; if(!ret) ret = 1; }
-                if(frames != p->b_frames) { frames = p->b_frames; if(!ret) ret = 1; }
-            }
-        }
-        else {
-            FLEXT_LOG1("buffer: symbol '%s' not defined", GetString(sym)); 
-            /*if(valid)*/ ret = -1;
-        }
+        const int r = Refresh(*shared,true);
+        const bool chg = Sync();
+        if(r < 0) {
+#if FLEXT_SYS == FLEXT_SYS_MAX
+            // undefined symbols are always reported
+            if(valid || r == -1) ret = r;
 #else
-#error not implemented
+            if(valid) ret = r;
 #endif
+        }
+        else if(chg && !ret) 
+            ret = 1;
     }
 
     return ret;
 }
 
-FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::buffer::Update()
+FLEXT_TEMPIMPL(int FLEXT_CLASSDEF(flext))::buffer::Refresh(Shared &sh,bool lookup)
 {
-    FLEXT_ASSERT(sym);
-
-    bool upd = false;
+    const t_symbol *sym = sh.sym;
 
-#if FLEXT_SYS == FLEXT_SYS_PD
-    if(!arr) return data == NULL;
+    int ret = 0;
+    Element *data1 = NULL;
+    int chns1 = 0,frames1 = 0;
 
-    int frames1;
-    FLEXT_ARRAYTYPE *data1;
-    if(!FLEXT_PD_ARRAYGRAB(arr, &frames1, &data1)) {
-        data = NULL;
-        chns = 0;
-        frames = 0;
-        upd = true;
+#if FLEXT_SYS == FLEXT_SYS_PD   
+    if(lookup) {
+        sh.arr = (t_garray *)pd_findbyclass(const_cast<t_symbol *>(sym), garray_class);
+        if(!sh.arr && *GetString(sym)) FLEXT_LOG1("buffer: no such array '%s'",GetString(sym));
     }
+
+    if(!sh.arr)
+        ret = -1;
     else {
-		Element *data2 = reinterpret_cast<Element *>(data1);
-		if(data != data2 || frames != frames1) {
-	        data = data2;
-	        frames = frames1;
-	        upd = true;
-	    }
-	}
+        FLEXT_ARRAYTYPE *vec;
+        if(!FLEXT_PD_ARRAYGRAB(sh.arr, &frames1, &vec)) {
+            if(lookup) error("buffer: bad template '%s'",GetString(sym)); 
+            frames1 = 0;
+            ret = -1;
+        }
+        else {
+            if(lookup) garray_usedindsp(sh.arr);
+            data1 = reinterpret_cast<Element *>(vec);
+            chns1 = 1;
+        }
+    }
+
+    // the array can't change during the rest of the DSP tick
+    if(InDSP()) sh.stamp = clock_getlogicaltime();
 #elif FLEXT_SYS == FLEXT_SYS_MAX
     const t_buffer *p = (const t_buffer *)sym->s_thing;
     if(p) {
-        FLEXT_ASSERT(!NOGOOD(p) && ob_sym(p) == sym_buffer);
-    
-		Element *data1 = reinterpret_cast<Element *>(p->b_samples);
-        if(data != data1 || chns != p->b_nchans || frames != p->b_frames) {
-            data = data1;
-            chns = p->b_nchans;
-            frames = p->b_frames;
-            upd = true;
+        FLEXT_ASSERT(!NOGOOD(p));
+        
+        if(ob_sym(p) != sym_buffer) {
+            if(lookup) post("buffer: object '%s' not valid (type %s)",GetString(sym),GetString(ob_sym(p))); 
+            ret = -2;
+        }
+        else {
+#ifdef FLEXT_DEBUG
+//          post("flext: buffer object '%s' - valid:%i samples:%i channels:%i frames:%i",GetString(sym),p->b_valid,p->b_frames,p->b_nchans,p->b_frames);
+#endif
+            data1 = reinterpret_cast<Element *>(p->b_samples);
+            chns1 = p->b_nchans;
+            frames1 = p->b_frames;
         }
     }
     else {
         // buffer~ has e.g. been renamed
-        data = NULL;
-        chns = 0;
-        frames = 0;
-        upd = true;
+        if(lookup) FLEXT_LOG1("buffer: symbol '%s' not defined", GetString(sym)); 
+        ret = -1;
     }
 #else
 #error not implemented
 #endif
-    return upd;
+
+    if(sh.data != data1 || sh.chns != chns1 || sh.frames != frames1) {
+        sh.data = data1;
+        sh.chns = chns1;
+        sh.frames = frames1;
+        ++sh.gen;
+        if(sh.shmname) ShmWrite(sh,0,INT_MAX);
+    }
+    return ret;
+}
+
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::buffer::Sync()
+{
+    if(LIKELY(gen == shared->gen)) return false;
+    gen = shared->gen;
+
+#if FLEXT_SYS == FLEXT_SYS_PD
+    arr = shared->arr;
+#endif
+    if(data == shared->data && chns == shared->chns && frames == shared->frames) return false;
+
+    data = shared->data;
+    chns = shared->chns;
+    frames = shared->frames;
+    return true;
+}
+
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::buffer::Update()
+{
+    FLEXT_ASSERT(sym && shared);
+
+#if FLEXT_SYS == FLEXT_SYS_PD
+    // another buffer on the same array may already have looked in this DSP tick
+    if(!InDSP() || shared->stamp != clock_getlogicaltime())
+#endif
+        Refresh(*shared,false);
+    return Sync();
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::buffer::Rescan()
+{
+    for(FLEXT_TEMP_TYPENAME FLEXT_TEMPINST(BufferRefs)::iterator it = FLEXT_TEMPINST(BufferRefs)::refs.begin(); it != FLEXT_TEMPINST(BufferRefs)::refs.end(); ++it)
+        Refresh(*it->second,true);
+
+#if FLEXT_SYS == FLEXT_SYS_PD
+    for(FLEXT_TEMPINST(Buffers)::iterator it = FLEXT_TEMPINST(Buffers)::buffers.begin(); it != FLEXT_TEMPINST(Buffers)::buffers.end(); ++it)
+        if((*it)->shared) (*it)->Sync();
+#endif
 }
 
 FLEXT_TEMPIMPL(FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext))::buffer::lock_t FLEXT_CLASSDEF(flext))::buffer::Lock()
@@ -261,25 +388,210 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::buffer::Unlock(flext::buffer::lock_t
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::buffer::Frames(int fr,bool keep,bool zero)
 {
-    FLEXT_ASSERT(sym);
+    FLEXT_ASSERT(sym && shared);
+    Resize(*shared,fr,keep,zero);
+    Sync();
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::buffer::Deinterleave(int ch,t_sample *dst,int from,int n) const
+{
+    FLEXT_ASSERT(data && ch >= 0 && ch < chns && from >= 0 && from+n <= frames);
+#if !_FLEXT_NEED_SAMPLE_CONV
+    if(sizeof(FLEXT_ARRAYTYPE) == sizeof(t_sample)) {
+        DeinterleaveSamples(dst,reinterpret_cast<const t_sample *>(data)+from*chns,ch,chns,n);
+        return;
+    }
+#endif
+    const Element *s = data+from*chns+ch;
+    for(int i = 0; i < n; ++i,s += chns) dst[i] = *s;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::buffer::Interleave(int ch,const t_sample *src,int from,int n)
+{
+    FLEXT_ASSERT(data && ch >= 0 && ch < chns && from >= 0 && from+n <= frames);
+#if !_FLEXT_NEED_SAMPLE_CONV
+    if(sizeof(FLEXT_ARRAYTYPE) == sizeof(t_sample)) {
+        InterleaveSamples(reinterpret_cast<t_sample *>(data)+from*chns,src,ch,chns,n);
+        return;
+    }
+#endif
+    Element *d = data+from*chns+ch;
+    for(int i = 0; i < n; ++i,d += chns) *d = src[i];
+}
+
+
+//! Samples per pass of buffer::ReadInterp
+#define INTERP_BLOCK 64
+//! Taps and fractional phases of the windowed sinc interpolation
+#define SINC_TAPS 8
+#define SINC_PHASES 256
+
+//! Windowed sinc coefficients, per phase
+FLEXT_TEMPLATE
+struct SincTable {
+    static t_sample w[SINC_PHASES+1][SINC_TAPS];
+    static volatile bool ready;
+
+    static void Make()
+    {
+        // identical values if two threads happen to do this at the same time
+        for(int p = 0; p <= SINC_PHASES; ++p) {
+            double wsum = 0,wk[SINC_TAPS];
+            for(int k = 0; k < SINC_TAPS; ++k) {
+                const double x = k-(SINC_TAPS/2-1)-(double)p/SINC_PHASES;
+                const double px = 3.14159265358979323846*x;
+                // Blackman window over the taps
+                const double win = 0.42+0.5*std::cos(px/(SINC_TAPS/2))+0.08*std::cos(2*px/(SINC_TAPS/2));
+                wsum += wk[k] = (x == 0?1:std::sin(px)/px)*win;
+            }
+            // unity gain for every phase
+            for(int k = 0; k < SINC_TAPS; ++k) w[p][k] = (t_sample)(wk[k]/wsum);
+        }
+        lockfree::memory_barrier();
+        ready = true;
+    }
+};
+
+FLEXT_TEMPIMPL(t_sample SincTable)::w[SINC_PHASES+1][SINC_TAPS];
+FLEXT_TEMPIMPL(volatile bool SincTable)::ready = false;
+
+//! Frame index according to the edge mode
+static inline int EdgeFrame(int i,int frames,bool loop)
+{
+    if(loop) {
+        i %= frames;
+        return i < 0?i+frames:i;
+    }
+    else
+        return i < 0?0:(i >= frames?frames-1:i);
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::buffer::ReadInterp(t_sample *dst,const t_sample *pos,int n,interp_mode mode,edge_mode edge,int ch) const
+{
+    if(UNLIKELY(!data || frames <= 0)) {
+        ZeroSamples(dst,n);
+        return;
+    }
+    FLEXT_ASSERT(ch >= 0 && ch < chns);
+
+    const bool loop = edge == edge_loop;
+
+#if !_FLEXT_NEED_SAMPLE_CONV
+    if(mode == interp_linear && !loop && chns == 1 && sizeof(FLEXT_ARRAYTYPE) == sizeof(t_sample)) {
+        InterpReadSamples(dst,reinterpret_cast<const t_sample *>(data),frames,pos,n);
+        return;
+    }
+#endif
+
+    if(mode == interp_sinc && UNLIKELY(!FLEXT_TEMPINST(SincTable)::ready)) FLEXT_TEMPINST(SincTable)::Make();
+
+    // taps before and after the frame below the position
+    const int before = mode == interp_cubic?1:(mode == interp_sinc?SINC_TAPS/2-1:0);
+    const int after = mode == interp_cubic?2:(mode == interp_sinc?SINC_TAPS/2:(mode == interp_linear?1:0));
+
+    const Element *d = data+ch;
+    const int st = chns;
+    const t_sample len = (t_sample)frames,last = (t_sample)(frames-1);
+
+    int idx[INTERP_BLOCK];
+    t_sample frac[INTERP_BLOCK];
+    t_sample taps[4][INTERP_BLOCK];
+
+    for(; n > 0; n -= INTERP_BLOCK,pos += INTERP_BLOCK,dst += INTERP_BLOCK) {
+        const int cnt = n < INTERP_BLOCK?n:INTERP_BLOCK;
+
+        // frames and fractions
+        for(int i = 0; i < cnt; ++i) {
+            t_sample p = pos[i];
+            if(UNLIKELY(p != p)) p = 0; // NaN
+            if(loop) {
+                if(UNLIKELY(p < 0 || p >= len)) {
+                    p -= std::floor(p/len)*len;
+                    if(UNLIKELY(p >= len)) p = 0; // rounding
+                }
+            }
+            else
+                p = p < 0?0:(p > last?last:p);
+            const int f = (int)p;
+            idx[i] = f;
+            frac[i] = p-f;
+        }
+
+        if(mode == interp_sinc) {
+            const t_sample (*w)[SINC_TAPS] = FLEXT_TEMPINST(SincTable)::w;
+            for(int i = 0; i < cnt; ++i) {
+                const t_sample *wp = w[(int)(frac[i]*SINC_PHASES+(t_sample)0.5)];
+                const int f = idx[i]-before;
+                t_sample s = 0;
+                if(LIKELY(f >= 0 && f+SINC_TAPS <= frames)) {
+                    const Element *e = d+f*st;
+                    for(int k = 0; k < SINC_TAPS; ++k,e += st) s += wp[k]*(t_sample)*e;
+                }
+                else
+                    for(int k = 0; k < SINC_TAPS; ++k) s += wp[k]*(t_sample)d[EdgeFrame(f+k,frames,loop)*st];
+                dst[i] = s;
+            }
+            continue;
+        }
+
+        // gather the taps
+        const int ntaps = before+after+1;
+        for(int i = 0; i < cnt; ++i) {
+            const int f = idx[i]-before;
+            if(LIKELY(f >= 0 && f+ntaps <= frames)) {
+                const Element *e = d+f*st;
+                for(int k = 0; k < ntaps; ++k,e += st) taps[k][i] = *e;
+            }
+            else
+                for(int k = 0; k < ntaps; ++k) taps[k][i] = d[EdgeFrame(f+k,frames,loop)*st];
+        }
+
+        // combine them
+        switch(mode) {
+        case interp_linear:
+            for(int i = 0; i < cnt; ++i) 
+                dst[i] = taps[0][i]+frac[i]*(taps[1][i]-taps[0][i]);
+            break;
+        case interp_cubic:
+            for(int i = 0; i < cnt; ++i) {
+                const t_sample ym = taps[0][i],y0 = taps[1][i],y1 = taps[2][i],y2 = taps[3][i];
+                const t_sample c1 = (t_sample)0.5*(y1-ym);
+                const t_sample c2 = ym-(t_sample)2.5*y0+2*y1-(t_sample)0.5*y2;
+                const t_sample c3 = (t_sample)0.5*(y2-ym)+(t_sample)1.5*(y0-y1);
+                const t_sample x = frac[i];
+                dst[i] = ((c3*x+c2)*x+c1)*x+y0;
+            }
+            break;
+        default:
+            CopySamples(dst,taps[0],cnt);
+        }
+    }
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::buffer::Resize(Shared &sh,int fr,bool keep,bool zero)
+{
 #if FLEXT_SYS == FLEXT_SYS_PD
+    if(!sh.arr) return;
     // is this function guaranteed to keep memory and set rest to zero?
-    ::garray_resize(arr,(float)fr);
-    Update();
+    ::garray_resize(sh.arr,(float)fr);
+    Refresh(sh,false);
 #elif FLEXT_SYS == FLEXT_SYS_MAX
+    if(Refresh(sh,false) < 0) return;
+
     Element *tmp = NULL;
-    int sz = frames;  
+    const int ch = sh.chns;
+    int sz = sh.frames;  
     if(fr < sz) sz = fr;
 
     if(keep) {
         // copy buffer data to tmp storage
-        tmp = (Element *)NewAligned(sz*sizeof(Element));
+        tmp = (Element *)NewAligned(sz*ch*sizeof(Element));
         FLEXT_ASSERT(tmp);
-        CopySamples(tmp,data,sz);
+        CopySamples(tmp,sh.data,sz*ch);
     }
     
     t_atom msg;
-    t_buffer *buf = (t_buffer *)sym->s_thing;
+    t_buffer *buf = (t_buffer *)sh.sym->s_thing;
     // b_msr reflects buffer sample rate... is this what we want?
     // Max bug: adding half a sample to prevent roundoff errors....
     float ms = (fr+0.5)/buf->b_msr;
@@ -287,29 +599,75 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::buffer::Frames(int fr,bool keep,bool
     SetFloat(msg,ms); 
     ::typedmess((object *)buf,(t_symbol *)sym_size,1,&msg);
     
-    Update();
+    Refresh(sh,false);
 
     if(tmp) {
         // copy data back
-        CopySamples(data,tmp,sz);
+        CopySamples(sh.data,tmp,sz*ch);
         FreeAligned(tmp);
-        if(zero && sz < fr) ZeroSamples(data+sz,fr-sz);
+        if(zero && sz < fr) ZeroSamples(sh.data+sz*ch,(fr-sz)*ch);
     }
     else
-        if(zero) ZeroSamples(data,fr);
+        if(zero) ZeroSamples(sh.data,fr*ch);
+
+    // Refresh has exported the data before it was restored
+    if(sh.shmname) ShmWrite(sh,0,INT_MAX);
 #else
 #error
 #endif
 }
 
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::buffer::FramesDeferred(int fr,bool keep,bool zero)
+{
+    FLEXT_ASSERT(sym && shared);
+    Shared &sh = *shared;
+
+    // the latest request wins
+    sh.resizefr = fr;
+    sh.resizekeep = keep;
+    sh.resizezero = zero;
+    lockfree::memory_barrier();
+    ++sh.resizeseq;
+    lockfree::memory_barrier();
+
+    if(lockfree::CAS(&sh.resizing,0L,1L)) {
+        t_atom a;
+        SetPointer(a,reinterpret_cast<t_gpointer *>(&sh));
+        flext_base::AddIdle(cb_resize,1,&a);
+    }
+}
+
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::buffer::cb_resize(int argc,const t_atom *argv)
+{
+    Shared *sh = reinterpret_cast<Shared *>(GetPointer(argv[0]));
+
+    if(sh->orphan) {
+        sh->resizing = 0;
+        // unless the export callback is still queued
+        if(!sh->shmpending) delete sh;
+        return false;
+    }
+
+    const long seq = sh->resizeseq;
+    lockfree::memory_barrier();
+    Resize(*sh,sh->resizefr,sh->resizekeep,sh->resizezero);
+    lockfree::memory_barrier();
+
+    // requested again in the meantime -> call again
+    if(seq != sh->resizeseq) return true;
+    sh->resizing = 0;
+    lockfree::memory_barrier();
+    return seq != sh->resizeseq && lockfree::CAS(&sh->resizing,0L,1L);
+}
+
 
 #if FLEXT_SYS == FLEXT_SYS_PD
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::buffer::SetRefrIntv(float intv)
 { 
     interval = intv; 
-    if(interval == 0 && ticking) {
-        clock_unset(tick);
-        ticking = false;
+    if(interval == 0 && shared && shared->ticking) {
+        clock_unset(shared->tick);
+        shared->ticking = false;
     }
 }
 #elif FLEXT_SYS == FLEXT_SYS_MAX
@@ -320,16 +678,47 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::buffer::SetRefrIntv(float) {}
 
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::buffer::Dirty(bool force)
+{
+    Dirty(0,INT_MAX,force);
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::buffer::Dirty(int from,int to,bool force)
 {
     FLEXT_ASSERT(sym);
+    if(UNLIKELY(shared->shmname)) ShmWrite(*shared,from,to);
 #if FLEXT_SYS == FLEXT_SYS_PD
-    if((!ticking) && (interval || force)) {
-        ticking = true;
-        cb_tick(this); // immediately redraw
+    // all buffers on the array share the redraw clock
+    Shared &sh = *shared;
+
+    // merge with the changes since the last redraw
+    if(sh.dirtyto <= sh.dirtyfrom) {
+        sh.dirtyfrom = from;
+        sh.dirtyto = to;
     }
     else {
-        if(force) clock_delay(tick,0);
-        isdirty = true;
+        if(from < sh.dirtyfrom) sh.dirtyfrom = from;
+        if(to > sh.dirtyto) sh.dirtyto = to;
+    }
+    sh.isdirty = true;
+
+    if(force) {
+        // forced redraws are throttled, too
+        const double wait = FLEXT_BUFFER_REDRAW-clock_gettimesince(sh.redrawn);
+        if(sh.ticking)
+            clock_delay(sh.tick,wait > 0?wait:0);
+        else {
+            sh.ticking = true;
+            sh.interval = interval;
+            if(wait > 0)
+                clock_delay(sh.tick,wait);
+            else
+                cb_tick(&sh); // immediately redraw
+        }
+    }
+    else if(!sh.ticking && interval) {
+        sh.ticking = true;
+        sh.interval = interval;
+        cb_tick(&sh); // immediately redraw
     }
 #elif FLEXT_SYS == FLEXT_SYS_MAX
     t_buffer *p = (t_buffer *)sym->s_thing;
@@ -345,20 +734,38 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::buffer::Dirty(bool force)
 }
 
 #if FLEXT_SYS == FLEXT_SYS_PD
-FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::buffer::cb_tick(buffer *b)
+//! Check whether the changed range of the array is on display
+static bool DirtyShown(const flext::buffer::Shared &sh)
 {
-    if(b->arr) garray_redraw(b->arr);
+    t_glist *gl = garray_getglist(sh.arr);
+    if(!gl || !glist_isvisible(gl)) return false;
+
+    // index range of the graph
+    t_float x1 = gl->gl_x1,x2 = gl->gl_x2;
+    if(x1 > x2) { t_float x = x1; x1 = x2; x2 = x; }
+    return sh.dirtyto > x1 && sh.dirtyfrom <= x2;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::buffer::cb_tick(Shared *sh)
+{
+    if(sh->isdirty) {
+        if(sh->arr) {
+            if(DirtyShown(*sh)) garray_redraw(sh->arr);
+        }
 #ifdef FLEXT_DEBUG
-    else error("buffer: array is NULL");
+        else error("buffer: array is NULL");
 #endif
+        sh->isdirty = false;
+        sh->dirtyfrom = sh->dirtyto = 0;
+        sh->redrawn = clock_getlogicaltime();
 
-    if(b->isdirty && b->interval) {
-            b->isdirty = false;
-            b->ticking = true;
-            clock_delay(b->tick,b->interval);
+        if(sh->interval) {
+            // further changes are collected until the next tick
+            clock_delay(sh->tick,sh->interval);
+            return;
+        }
     }
-    else 
-        b->ticking = false;
+    sh->ticking = false;
 }
 #endif
 
@@ -378,7 +785,7 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::buffer::IsDirty() const
     if(!sym) return false;
 #if FLEXT_SYS == FLEXT_SYS_PD
     #ifdef _FLEXT_HAVE_PD_GARRAYUPDATETIME
-    return arr && (isdirty || garray_updatetime(arr) > cleantime);
+    return arr && (shared->isdirty || garray_updatetime(arr) > cleantime);
     #else
     // Don't know.... (no method in PD judging whether buffer has been changed from outside flext...)
     return true; 
@@ -392,6 +799,465 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::buffer::IsDirty() const
 #endif
 }
 
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::buffer::Export(const char *name)
+{
+    FLEXT_ASSERT(sym && shared);
+    Shared &sh = *shared;
+    if(!name) name = GetString(sym);
+
+    if(sh.shmname && !strcmp(sh.shmname,name)) {
+        // already exported, just take over the current data
+        ShmWrite(sh,0,INT_MAX);
+        return true;
+    }
+
+    ShmFree(sh,true);
+    sh.shmname = new char[strlen(name)+1];
+    strcpy(sh.shmname,name);
+    if(!ShmCreate(sh,sh.frames*sh.chns)) {
+        error("buffer: can't export '%s' as '%s'",GetString(sym),name);
+        ShmFree(sh,true);
+        return false;
+    }
+    ShmWrite(sh,0,INT_MAX);
+    return true;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::buffer::Unexport()
+{
+    if(shared) ShmFree(*shared,true);
+}
+
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::buffer::ShmCreate(Shared &sh,int n)
+{
+    FLEXT_ASSERT(sh.shmname && !sh.shmbase);
+    if(n < 1) n = 1;
+    // the samples start at a cache line
+    const unsigned int offs = (sizeof(flext_shmheader)+63)&~63;
+    const size_t size = offs+n*sizeof(float);
+    char sn[256];
+    flext_shmname(sn,sizeof(sn),sh.shmname);
+
+#if FLEXT_OS == FLEXT_OS_WIN
+    if(!sh.shmindex) {
+        // the index stays for the whole export
+        HANDLE im = CreateFileMappingA(INVALID_HANDLE_VALUE,NULL,PAGE_READWRITE,0,sizeof(flext_shmindex),sn);
+        void *ip = im?MapViewOfFile(im,FILE_MAP_WRITE,0,0,sizeof(flext_shmindex)):NULL;
+        if(!ip) {
+            if(im) CloseHandle(im);
+            return false;
+        }
+        sh.shmindexmap = im;
+        sh.shmindex = ip;
+    }
+
+    // the segments are numbered, as readers may still hold the previous ones
+    HANDLE m;
+    for(int i = 0; ; ++i) {
+        if(!++sh.shmseg) ++sh.shmseg; // 0 is the index
+        flext_shmname(sn,sizeof(sn),sh.shmname,sh.shmseg);
+        m = CreateFileMappingA(INVALID_HANDLE_VALUE,NULL,PAGE_READWRITE,(DWORD)((unsigned long long)size>>32),(DWORD)size,sn);
+        if(!m) return false;
+        if(GetLastError() != ERROR_ALREADY_EXISTS) break;
+        // still there from an earlier export, try the next number
+        CloseHandle(m);
+        if(i == 100) return false;
+    }
+    void *p = MapViewOfFile(m,FILE_MAP_WRITE,0,0,size);
+    if(!p) {
+        CloseHandle(m);
+        return false;
+    }
+    sh.shmmap = m;
+#else
+    // a segment left over (e.g. after a crash) is replaced
+    shm_unlink(sn);
+    const int fd = shm_open(sn,O_CREAT|O_EXCL|O_RDWR,0644);
+    if(fd < 0) return false;
+    void *p = ftruncate(fd,(off_t)size) == 0?mmap(NULL,size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0):MAP_FAILED;
+    // the mapping keeps the segment referenced
+    close(fd);
+    if(p == MAP_FAILED) {
+        shm_unlink(sn);
+        return false;
+    }
+#endif
+
+    flext_shmheader *h = static_cast<flext_shmheader *>(p);
+    memset(h,0,offs);
+    h->channels = h->frames = 0;
+    h->capacity = n;
+    h->offset = offs;
+    h->version = flext_shmheader::version_id;
+    flext_shmfence();
+    // readers check the magic number, so it comes last
+    h->magic = flext_shmheader::magic_id;
+
+#if FLEXT_OS == FLEXT_OS_WIN
+    // point the index to the new segment
+    flext_shmindex *ix = static_cast<flext_shmindex *>(sh.shmindex);
+    ix->segment = sh.shmseg;
+    flext_shmfence();
+    ix->magic = flext_shmheader::magic_id;
+#endif
+
+    sh.shmsize = size;
+    lockfree::memory_barrier();
+    sh.shmbase = p;
+    return true;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::buffer::ShmFree(Shared &sh,bool end)
+{
+    void *base = sh.shmbase;
+    if(base) {
+        // detach the segment, then wait for the writers still using it
+        sh.shmbase = NULL;
+        lockfree::memory_barrier();
+#ifdef FLEXT_THREADS
+        while(sh.shmwriters) ThrYield();
+#endif
+
+        static_cast<flext_shmheader *>(base)->stale = 1;
+        flext_shmfence();
+#if FLEXT_OS == FLEXT_OS_WIN
+        UnmapViewOfFile(base);
+        CloseHandle(sh.shmmap);
+        sh.shmmap = NULL;
+#else
+        munmap(base,sh.shmsize);
+        // readers keep their mappings
+        char sn[256];
+        flext_shmname(sn,sizeof(sn),sh.shmname);
+        shm_unlink(sn);
+#endif
+        sh.shmsize = 0;
+    }
+    if(end) {
+#if FLEXT_OS == FLEXT_OS_WIN
+        if(sh.shmindex) {
+            static_cast<flext_shmindex *>(sh.shmindex)->segment = 0;
+            UnmapViewOfFile(sh.shmindex);
+            CloseHandle(sh.shmindexmap);
+            sh.shmindex = sh.shmindexmap = NULL;
+        }
+#endif
+        delete[] sh.shmname;
+        sh.shmname = NULL;
+    }
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::buffer::ShmWrite(Shared &sh,int from,int to)
+{
+    // keep the segment from being unmapped meanwhile (this may run in the DSP thread)
+    long w;
+    do w = sh.shmwriters; while(!lockfree::CAS(&sh.shmwriters,w,w+1));
+    lockfree::memory_barrier();
+
+    const int chns = sh.data?sh.chns:0,frames = sh.data?sh.frames:0;
+    flext_shmheader *h = static_cast<flext_shmheader *>(sh.shmbase);
+    if(LIKELY(h) && frames*chns <= h->capacity) {
+        if(h->channels != chns || h->frames != frames)
+            // the layout has changed, copy everything
+            from = 0,to = frames;
+        else {
+            if(from < 0) from = 0;
+            if(to > frames) to = frames;
+        }
+
+        ++h->gen;
+        flext_shmfence();
+        h->channels = chns;
+        h->frames = frames;
+#if FLEXT_SYS == FLEXT_SYS_PD
+        h->samplerate = sys_getsr();
+#elif FLEXT_SYS == FLEXT_SYS_MAX
+        const t_buffer *p = (const t_buffer *)sh.sym->s_thing;
+        h->samplerate = p?p->b_sr:0;
+#endif
+        if(from < to) {
+            float *dst = reinterpret_cast<float *>(reinterpret_cast<char *>(h)+h->offset)+from*chns;
+            const Element *src = sh.data+from*chns;
+            for(int i = (to-from)*chns; i--; ) *(dst++) = (float)static_cast<t_sample>(*(src++));
+        }
+        flext_shmfence();
+        ++h->gen;
+    }
+    else if(lockfree::CAS(&sh.shmpending,0L,1L)) {
+        // the system thread makes a larger segment, taking over all the data
+        t_atom a;
+        SetPointer(a,reinterpret_cast<t_gpointer *>(&sh));
+        flext_base::AddIdle(cb_export,1,&a);
+    }
+
+    lockfree::memory_barrier();
+    do w = sh.shmwriters; while(!lockfree::CAS(&sh.shmwriters,w,w-1));
+}
+
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::buffer::cb_export(int argc,const t_atom *argv)
+{
+    Shared *sh = reinterpret_cast<Shared *>(GetPointer(argv[0]));
+    sh->shmpending = 0;
+
+    if(sh->orphan) {
+        // unless the resize callback is still queued
+        if(!sh->resizing) delete sh;
+        return false;
+    }
+
+    if(sh->shmname) {
+        const int n = sh->data?sh->frames*sh->chns:0;
+        const flext_shmheader *h = static_cast<const flext_shmheader *>(sh->shmbase);
+        if(!h || n > h->capacity) {
+            // replace by a larger segment, with room to grow
+            ShmFree(*sh,false);
+            if(!ShmCreate(*sh,n+n/2)) {
+                error("buffer: can't export '%s' any more",sh->shmname);
+                ShmFree(*sh,true);
+                return false;
+            }
+        }
+        ShmWrite(*sh,0,INT_MAX);
+    }
+    return false;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::buffer::View::Read(int ch,t_sample *dst,int cnt,int offs) const
+{
+    FLEXT_ASSERT(offs >= 0 && offs+cnt <= Frames());
+
+    const t_sample *s = Contiguous(ch);
+    if(s)
+        CopySamples(dst,s+offs,cnt);
+    else {
+        // gather, unrolled as the stride isn't known at compile time
+        const int st = Channels();
+        const Element *src = buf.Data()+offs*st+ch;
+        int i = 0;
+        for(; i <= cnt-4; i += 4,src += 4*st) {
+            dst[i] = src[0];
+            dst[i+1] = src[st];
+            dst[i+2] = src[2*st];
+            dst[i+3] = src[3*st];
+        }
+        for(; i < cnt; ++i,src += st) dst[i] = *src;
+    }
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::buffer::View::Write(int ch,const t_sample *src,int cnt,int offs)
+{
+    FLEXT_ASSERT(offs >= 0 && offs+cnt <= Frames());
+
+    t_sample *d = Contiguous(ch);
+    if(d)
+        CopySamples(d+offs,src,cnt);
+    else {
+        const int st = Channels();
+        Element *dst = buf.Data()+offs*st+ch;
+        int i = 0;
+        for(; i <= cnt-4; i += 4,dst += 4*st) {
+            dst[0] = src[i];
+            dst[st] = src[i+1];
+            dst[2*st] = src[i+2];
+            dst[3*st] = src[i+3];
+        }
+        for(; i < cnt; ++i,dst += st) *dst = src[i];
+    }
+}
+
+
+// === filebuffer ==============================================
+
+inline unsigned long wav_u32(const unsigned char *p) { return p[0]|(p[1]<<8)|(p[2]<<16)|((unsigned long)p[3]<<24); }
+inline int wav_u16(const unsigned char *p) { return p[0]|(p[1]<<8); }
+
+/*! \brief Find the samples in a WAV file with 32-bit float samples
+    \param offs ... returns the byte offset of the samples
+    \param len ... returns the byte length of the samples
+*/
+inline bool wav_parse(const unsigned char *b,size_t size,size_t &offs,size_t &len,int &chns,float &srate)
+{
+    if(size < 12 || memcmp(b,"RIFF",4) || memcmp(b+8,"WAVE",4)) return false;
+
+    int code = 0,bits = 0;
+    bool fmt = false;
+    for(size_t p = 12; p+8 <= size; ) {
+        const unsigned long ck = wav_u32(b+p+4);
+        const unsigned char *c = b+p+8;
+        if(!memcmp(b+p,"fmt ",4) && ck >= 16 && p+8+16 <= size) {
+            code = wav_u16(c);
+            chns = wav_u16(c+2);
+            srate = (float)wav_u32(c+4);
+            bits = wav_u16(c+14);
+            // WAVE_FORMAT_EXTENSIBLE: the sub-format GUID starts with the format code
+            if(code == 0xfffe && ck >= 26 && p+8+26 <= size) code = wav_u16(c+24);
+            fmt = true;
+        }
+        else if(!memcmp(b+p,"data",4)) {
+            offs = p+8;
+            // streaming writers may leave the length open
+            len = ck <= size-offs?ck:size-offs;
+            return fmt && code == 3 && bits == 32 && chns > 0;
+        }
+        p += 8+ck+(ck&1);
+    }
+    return false;
+}
+
+FLEXT_TEMPIMPL(FLEXT_CLASSDEF(flext))::filebuffer::filebuffer():
+    base(NULL),size(0),
+#if FLEXT_OS == FLEXT_OS_WIN
+    hfile(NULL),hmap(NULL),
+#endif
+    data(NULL),chns(0),frames(0),srate(0),
+    prefbeg(0),prefend(0)
+{}
+
+FLEXT_TEMPIMPL(FLEXT_CLASSDEF(flext))::filebuffer::~filebuffer() { Close(); }
+
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::filebuffer::Open(const char *path,int channels)
+{
+    Close();
+
+#if FLEXT_OS == FLEXT_OS_WIN
+    HANDLE f = CreateFileA(path,GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+    LARGE_INTEGER sz;
+    if(f == INVALID_HANDLE_VALUE || !GetFileSizeEx(f,&sz) || !sz.QuadPart) {
+        if(f != INVALID_HANDLE_VALUE) CloseHandle(f);
+        error("filebuffer: can't open '%s'",path);
+        return false;
+    }
+    HANDLE m = CreateFileMapping(f,NULL,PAGE_READONLY,0,0,NULL);
+    void *p = m?MapViewOfFile(m,FILE_MAP_READ,0,0,0):NULL;
+    if(!p) {
+        if(m) CloseHandle(m);
+        CloseHandle(f);
+        error("filebuffer: can't map '%s'",path);
+        return false;
+    }
+    hfile = f,hmap = m;
+    size = (size_t)sz.QuadPart;
+#else
+    const int fd = open(path,O_RDONLY);
+    struct stat st;
+    if(fd < 0 || fstat(fd,&st) < 0 || !st.st_size) {
+        if(fd >= 0) close(fd);
+        error("filebuffer: can't open '%s'",path);
+        return false;
+    }
+    void *p = mmap(NULL,(size_t)st.st_size,PROT_READ,MAP_SHARED,fd,0);
+    // the mapping keeps the file referenced
+    close(fd);
+    if(p == MAP_FAILED) {
+        error("filebuffer: can't map '%s'",path);
+        return false;
+    }
+    size = (size_t)st.st_size;
+#endif
+    base = p;
+
+    const unsigned char *b = static_cast<const unsigned char *>(base);
+    size_t offs = 0,len = size;
+    srate = 0;
+    if(channels > 0)
+        chns = channels;
+    else {
+        const unsigned short one = 1;
+        if(!wav_parse(b,size,offs,len,chns,srate)) {
+            error("filebuffer: '%s' is no WAV file with 32-bit float samples",path);
+            Close();
+            return false;
+        }
+        else if(*reinterpret_cast<const unsigned char *>(&one) != 1) {
+            error("filebuffer: WAV files need a little-endian machine");
+            Close();
+            return false;
+        }
+    }
+
+    data = reinterpret_cast<const float *>(b+offs);
+    frames = (int)(len/(sizeof(float)*chns));
+    prefbeg = prefend = 0;
+    return true;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::filebuffer::Close()
+{
+    if(!base) return;
+#if FLEXT_OS == FLEXT_OS_WIN
+    UnmapViewOfFile(base);
+    CloseHandle(hmap);
+    CloseHandle(hfile);
+    hmap = hfile = NULL;
+#else
+    munmap(base,size);
+#endif
+    base = NULL;
+    size = 0;
+    data = NULL;
+    chns = frames = 0;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::filebuffer::Read(int ch,t_sample *dst,int cnt,int offs) const
+{
+    FLEXT_ASSERT(ch >= 0 && ch < chns && offs >= 0 && offs+cnt <= frames);
+
+    const int st = chns;
+    const float *src = data+offs*st+ch;
+    int i = 0;
+    for(; i <= cnt-4; i += 4,src += 4*st) {
+        dst[i] = src[0];
+        dst[i+1] = src[st];
+        dst[i+2] = src[2*st];
+        dst[i+3] = src[3*st];
+    }
+    for(; i < cnt; ++i,src += st) dst[i] = *src;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::filebuffer::Prefetch(int offs,int cnt)
+{
+    if(offs < 0) cnt += offs,offs = 0;
+    if(offs+cnt > frames) cnt = frames-offs;
+    if(cnt <= 0 || (offs >= prefbeg && offs+cnt <= prefend)) return;
+
+    // ask for twice the range, so that a moving window needs a new hint only every cnt frames
+    int end = offs+cnt*2;
+    if(end > frames) end = frames;
+    Advise(offs,end-offs,true);
+    prefbeg = offs,prefend = end;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::filebuffer::Discard(int offs,int cnt)
+{
+    if(offs < 0) cnt += offs,offs = 0;
+    if(offs+cnt > frames) cnt = frames-offs;
+    if(cnt <= 0) return;
+
+    Advise(offs,cnt,false);
+    if(offs < prefend && offs+cnt > prefbeg) prefbeg = prefend = 0;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::filebuffer::Advise(int offs,int cnt,bool need)
+{
+    FLEXT_ASSERT(base);
+#if FLEXT_OS == FLEXT_OS_WIN
+    // PrefetchVirtualMemory needs Windows 8, the pages are loaded on access anyway
+    if(!need) VirtualUnlock(const_cast<float *>(data+offs*chns),cnt*chns*sizeof(float));
+#else
+    static const size_t pagesz = (size_t)sysconf(_SC_PAGESIZE);
+    size_t b = reinterpret_cast<const char *>(data+offs*chns)-static_cast<const char *>(base);
+    size_t e = reinterpret_cast<const char *>(data+(offs+cnt)*chns)-static_cast<const char *>(base);
+    if(need)
+        b = b/pagesz*pagesz;
+    else {
+        // only give back pages entirely within the range
+        b = (b+pagesz-1)/pagesz*pagesz;
+        e = e/pagesz*pagesz;
+    }
+    if(e > b) madvise(static_cast<char *>(base)+b,e-b,need?MADV_WILLNEED:MADV_DONTNEED);
+#endif
+}
+
 #endif // Jmax
 
 #include "flpopns.h"
@@ -91,6 +91,15 @@ public:
 
 	virtual bool CbIdle();
 
+#ifdef FLEXT_THREADS
+	/*! \brief Called when a threaded method (FLEXT_THREAD*) is started
+		\param meth Name of the method
+		\param attr Scheduling attributes to fill in, the name is set to meth unless changed
+		\return True if the thread should run with attr
+	*/
+	virtual bool CbThreadAttr(const char *meth,ThrAttr &attr);
+#endif
+
 //!		@} FLEXT_C_VIRTUAL
 
 
@@ -235,6 +244,89 @@ public:
 	void ToOutAnything(int n,const AtomAnything &any) const { ToOutAnything(n,any.Header(),any.Count(),any.Atoms()); }
 	//! Output anything (index n starts with 0)
 	void ToOutAnything(int n,const t_symbol *s,const AtomList &list) const { ToOutAnything(n,s,list.Count(),list.Atoms()); }
+
+	//! Check whether output can go directly to the system (otherwise it's queued)
+	static bool IsOutputDirect() 
+	{
+#if defined(FLEXT_THREADS)
+		// the system thread is never registered
+		if(LIKELY(flext::IsSystemThread())) return !flext::InDSP();
+    #if FLEXT_QMODE == 2
+		return (!flext::IsThreadRegistered() || flext::IsThread(flext::thrmsgid)) && !flext::InDSP();
+    #else
+		return !flext::IsThreadRegistered() && !flext::InDSP();
+    #endif
+#else
+		return !flext::InDSP();
+#endif
+	}
+
+	/*! \brief Handle for output of type T to an outlet
+		T is float, int, bool, const t_symbol *, AtomList (list) or AtomAnything (anything).
+		The host function for T is called directly, without looking up the outlet or the atom type.
+		With sys = true the caller guarantees to run in the system thread (outside DSP), 
+		so that the thread check is skipped, too.
+		\note Get the handle once the outlets have been created (e.g. in Init), not in the constructor.
+	*/
+	template<typename T,bool sys = false>
+	class Outlet
+	{
+	public:
+		Outlet(): th(NULL),out(NULL),n(-1) {}
+		Outlet(const flext_base *t,int ix): th(t),out((t_outlet *)t->GetOut(ix)),n(ix) {}
+
+		//! Check whether the handle refers to an outlet
+		bool Ok() const { return out != NULL; }
+
+		//! Output value
+		void operator ()(const T &v) const
+		{
+			if(sys || LIKELY(IsOutputDirect())) {
+				FLEXT_ASSERT(IsOutputDirect());
+				if(LIKELY(out)) { CRITON(); OutletSys(out,v); CRITOFF(); }
+			}
+			else
+				OutletQueue(th,n,v);
+		}
+
+		//! Output bang
+		void Bang() const
+		{
+			if(sys || LIKELY(IsOutputDirect())) {
+				FLEXT_ASSERT(IsOutputDirect());
+				if(LIKELY(out)) { CRITON(); outlet_bang(out); CRITOFF(); }
+			}
+			else
+				th->ToQueueBang(n);
+		}
+
+		//! Output list
+		void List(int argc,const t_atom *argv) const
+		{
+			if(sys || LIKELY(IsOutputDirect())) {
+				FLEXT_ASSERT(IsOutputDirect());
+				if(LIKELY(out)) { CRITON(); outlet_list(out,const_cast<t_symbol *>(sym_list),argc,(t_atom *)argv); CRITOFF(); }
+			}
+			else
+				th->ToQueueList(n,argc,argv);
+		}
+
+		//! Output anything
+		void Anything(const t_symbol *s,int argc,const t_atom *argv) const
+		{
+			if(sys || LIKELY(IsOutputDirect())) {
+				FLEXT_ASSERT(IsOutputDirect());
+				if(LIKELY(out)) { CRITON(); outlet_anything(out,const_cast<t_symbol *>(s),argc,(t_atom *)argv); CRITOFF(); }
+			}
+			else
+				th->ToQueueAnything(n,s,argc,argv);
+		}
+
+	private:
+		const flext_base *th;
+		t_outlet *out;
+		int n;
+	};
 	
 	//! @} FLEXT_C_IO_OUT
 
@@ -275,6 +367,43 @@ public:
 	//! Output low priority anything (index n starts with 0)
 	void ToQueueAnything(int n,const AtomAnything &any) const  { ToQueueAnything(n,any.Header(),any.Count(),any.Atoms()); }
 
+	/*! \brief Output low priority list, handing the memory of list over to the queue (index n starts with 0)
+		\note list is empty afterwards. Long lists are queued without copying the atoms.
+	*/
+	void ToQueueListTake(int n,AtomList &list) const { ToQueueAnythingTake(n,sym_list,list); }
+	/*! \brief Output low priority anything, handing the memory of list over to the queue (index n starts with 0)
+		\note list is empty afterwards. Long lists are queued without copying the atoms.
+	*/
+	void ToQueueAnythingTake(int n,const t_symbol *s,AtomList &list) const;
+#if __cplusplus >= 201103L
+	//! Output low priority list, handing the memory of list over to the queue (index n starts with 0)
+	void ToQueueList(int n,AtomList &&list) const { ToQueueListTake(n,list); }
+	//! Output low priority anything, handing the memory of list over to the queue (index n starts with 0)
+	void ToQueueAnything(int n,const t_symbol *s,AtomList &&list) const { ToQueueAnythingTake(n,s,list); }
+#endif
+
+	/*! \brief Set the queue lane used for low priority output of this object
+		\note Objects producing lots of data should use prio_bulk, so that they can't delay control messages of other objects.
+	*/
+	void SetQueuePrio(queue_prio p) { qprio = (unsigned char)p; }
+
+	//! Get the queue lane used for low priority output of this object
+	queue_prio GetQueuePrio() const { return (queue_prio)qprio; }
+
+	/*! \brief Coalesce low priority output to outlet n ("latest value wins")
+		\note While output to that outlet is pending in the queue, further ToQueue* calls replace it instead of adding new messages.
+	*/
+	void SetQueueCoalesce(int n,bool coalesce = true);
+
+	//! Output low priority anything, replacing output to the same outlet which is still pending (index n starts with 0)
+	void ToQueueLatest(int n,const t_symbol *s,int argc,const t_atom *argv) const { QueueLatest(n,s,argc,argv,true); }
+	//! Output low priority float, replacing output to the same outlet which is still pending (index n starts with 0)
+	void ToQueueLatest(int n,float f) const { t_atom at; SetFloat(at,f); ToQueueLatest(n,sym_float,1,&at); }
+	//! Output low priority list, replacing output to the same outlet which is still pending (index n starts with 0)
+	void ToQueueLatest(int n,int argc,const t_atom *argv) const { ToQueueLatest(n,sym_list,argc,argv); }
+	//! Output low priority list, replacing output to the same outlet which is still pending (index n starts with 0)
+	void ToQueueLatest(int n,const AtomList &list) const { ToQueueLatest(n,list.Count(),list.Atoms()); }
+
     //!	@} FLEXT_C_IO_QUEUE
 
 
@@ -403,10 +532,13 @@ public:
 		a_float,a_int,a_bool,
 		a_symbol,a_pointer,
 		a_list,a_any, // (t_symbol *) / int / t_atom *
-		a_LIST,a_ANY // AtomList, AtomAnything
+		a_LIST,a_ANY, // AtomList, AtomAnything
+		a_typed // methfun_T, converts its arguments itself
 	};
 
 	typedef bool (*methfun)(flext_base *c);
+	//! Typed method trampoline: 1 handled, 0 arguments don't match, -1 refused
+	typedef int (*methfun_T)(flext_base *c,int argc,const t_atom *argv);
 
 	/*!	\defgroup FLEXT_C_ADDMETHOD Method handling (object scope)
 		\internal
@@ -451,6 +583,8 @@ public:
 	void AddMethod(int inlet,const char *tag,bool (*m)(flext_base *,const t_symbol *&)) { AddMethod(inlet,MakeSymbol(tag),m); }
 	void AddMethod(int inlet,const char *tag,bool (*m)(flext_base *,float &)) { AddMethod(inlet,MakeSymbol(tag),m); }
 	void AddMethod(int inlet,const char *tag,bool (*m)(flext_base *,int &)) { AddMethod(inlet,MakeSymbol(tag),m); }
+	void AddMethod(int inlet,const t_symbol *tag,methfun_T m) { AddMethod(ThMeths(),inlet,tag,(methfun)m,a_typed,a_null); } // typed method
+	void AddMethod(int inlet,const char *tag,methfun_T m) { AddMethod(inlet,MakeSymbol(tag),m); }
 
 	// ¥schedule call of the CbIdle method during the next idle cycle
 	void AddIdle();
@@ -503,12 +637,239 @@ public:
 	static void AddMethod(t_classid c,int inlet,const char *tag,bool (*m)(flext_base *,const t_symbol *&)) { AddMethod(c,inlet,MakeSymbol(tag),m); }
 	static void AddMethod(t_classid c,int inlet,const char *tag,bool (*m)(flext_base *,float &)) { AddMethod(c,inlet,MakeSymbol(tag),m); }
 	static void AddMethod(t_classid c,int inlet,const char *tag,bool (*m)(flext_base *,int &)) { AddMethod(c,inlet,MakeSymbol(tag),m); }
+	static void AddMethod(t_classid c,int inlet,const t_symbol *tag,methfun_T m) { AddMethod(ClMeths(c),inlet,tag,(methfun)m,a_typed,a_null); } // typed method
+	static void AddMethod(t_classid c,int inlet,const char *tag,methfun_T m) { AddMethod(c,inlet,MakeSymbol(tag),m); }
 
 	// ¥schedule call of the given idlefun during the next idle cycle
 	static void AddIdle(bool (*idlefun)(int argc,const t_atom *argv),int argc,const t_atom *argv);
 
 //!		@} FLEXT_C_CADDMETHOD
 
+// --- typed methods ---------------------------------------
+
+	/*!	\defgroup FLEXT_C_TYPEDMETHOD Typed method binding
+		A member function like void m_set(float f,int n,const t_symbol *s) is registered directly,
+		the atoms are converted into its parameters by a trampoline generated at compile time.
+		Arguments: float, double, int, bool, (const) t_symbol * (and t_gpointer * for PD),
+		by value or const reference. A return type of bool is the handler's result, void means true.
+		\sa FLEXT_CADDMETHOD_TYPED, FLEXT_ADDMETHOD_TYPED
+		@{ 
+	*/
+
+	//! Strip const and reference from a parameter type
+	template<class A> struct TypedVal { typedef A type; };
+	template<class A> struct TypedVal<const A> { typedef A type; };
+	template<class A> struct TypedVal<const A &> { typedef A type; };
+	template<class A> struct TypedVal<A &> { typedef A type; };
+
+	static bool GetTypedArg(const t_atom &a,float &v) { if(IsFloat(a)) v = GetFloat(a); else if(IsInt(a)) v = (float)GetInt(a); else return false; return true; }
+	static bool GetTypedArg(const t_atom &a,double &v) { if(IsFloat(a)) v = GetFloat(a); else if(IsInt(a)) v = GetInt(a); else return false; return true; }
+	static bool GetTypedArg(const t_atom &a,int &v) { if(IsFloat(a)) v = (int)GetFloat(a); else if(IsInt(a)) v = GetInt(a); else return false; return true; }
+	static bool GetTypedArg(const t_atom &a,bool &v) { if(IsFloat(a)) v = GetFloat(a) != 0; else if(IsInt(a)) v = GetInt(a) != 0; else return false; return true; }
+	static bool GetTypedArg(const t_atom &a,const t_symbol *&v) { if(IsSymbol(a)) v = GetSymbol(a); else return false; return true; }
+	static bool GetTypedArg(const t_atom &a,t_symbol *&v) { if(IsSymbol(a)) v = const_cast<t_symbol *>(GetSymbol(a)); else return false; return true; }
+#if FLEXT_SYS == FLEXT_SYS_PD && !defined(FLEXT_COMPATIBLE)
+	static bool GetTypedArg(const t_atom &a,t_gpointer *&v) { if(IsPointer(a)) v = GetPointer(a); else return false; return true; }
+#endif
+
+	//! Result of a typed method call, void methods succeed
+	struct TypedDone
+	{
+		TypedDone(): ok(true) {}
+		friend TypedDone operator ,(bool r,TypedDone d) { d.ok = r; return d; }
+		bool ok;
+	};
+	template<class R,class T>
+	struct TypedMethod0
+	{
+		template<R (T::*F)()>
+		static int Call(flext_base *c,int argc,const t_atom *)
+		{
+			if(argc != 0) return 0;
+			return ((FLEXT_CAST<T *>(c)->*F)(),TypedDone()).ok?1:-1;
+		}
+
+		template<R (T::*F)()>
+		static methfun_T Bind() { return &Call<F>; }
+	};
+
+	template<class R,class T>
+	static TypedMethod0<R,T> TypedBinder(R (T::*)()) { return TypedMethod0<R,T>(); }
+
+	template<class R,class T,class A1>
+	struct TypedMethod1
+	{
+		template<R (T::*F)(A1)>
+		static int Call(flext_base *c,int argc,const t_atom *argv)
+		{
+			if(argc != 1) return 0;
+			typename TypedVal<A1>::type a1; if(!GetTypedArg(argv[0],a1)) return 0;
+			return ((FLEXT_CAST<T *>(c)->*F)(a1),TypedDone()).ok?1:-1;
+		}
+
+		template<R (T::*F)(A1)>
+		static methfun_T Bind() { return &Call<F>; }
+	};
+
+	template<class R,class T,class A1>
+	static TypedMethod1<R,T,A1> TypedBinder(R (T::*)(A1)) { return TypedMethod1<R,T,A1>(); }
+
+	template<class R,class T,class A1,class A2>
+	struct TypedMethod2
+	{
+		template<R (T::*F)(A1,A2)>
+		static int Call(flext_base *c,int argc,const t_atom *argv)
+		{
+			if(argc != 2) return 0;
+			typename TypedVal<A1>::type a1; if(!GetTypedArg(argv[0],a1)) return 0;
+			typename TypedVal<A2>::type a2; if(!GetTypedArg(argv[1],a2)) return 0;
+			return ((FLEXT_CAST<T *>(c)->*F)(a1,a2),TypedDone()).ok?1:-1;
+		}
+
+		template<R (T::*F)(A1,A2)>
+		static methfun_T Bind() { return &Call<F>; }
+	};
+
+	template<class R,class T,class A1,class A2>
+	static TypedMethod2<R,T,A1,A2> TypedBinder(R (T::*)(A1,A2)) { return TypedMethod2<R,T,A1,A2>(); }
+
+	template<class R,class T,class A1,class A2,class A3>
+	struct TypedMethod3
+	{
+		template<R (T::*F)(A1,A2,A3)>
+		static int Call(flext_base *c,int argc,const t_atom *argv)
+		{
+			if(argc != 3) return 0;
+			typename TypedVal<A1>::type a1; if(!GetTypedArg(argv[0],a1)) return 0;
+			typename TypedVal<A2>::type a2; if(!GetTypedArg(argv[1],a2)) return 0;
+			typename TypedVal<A3>::type a3; if(!GetTypedArg(argv[2],a3)) return 0;
+			return ((FLEXT_CAST<T *>(c)->*F)(a1,a2,a3),TypedDone()).ok?1:-1;
+		}
+
+		template<R (T::*F)(A1,A2,A3)>
+		static methfun_T Bind() { return &Call<F>; }
+	};
+
+	template<class R,class T,class A1,class A2,class A3>
+	static TypedMethod3<R,T,A1,A2,A3> TypedBinder(R (T::*)(A1,A2,A3)) { return TypedMethod3<R,T,A1,A2,A3>(); }
+
+	template<class R,class T,class A1,class A2,class A3,class A4>
+	struct TypedMethod4
+	{
+		template<R (T::*F)(A1,A2,A3,A4)>
+		static int Call(flext_base *c,int argc,const t_atom *argv)
+		{
+			if(argc != 4) return 0;
+			typename TypedVal<A1>::type a1; if(!GetTypedArg(argv[0],a1)) return 0;
+			typename TypedVal<A2>::type a2; if(!GetTypedArg(argv[1],a2)) return 0;
+			typename TypedVal<A3>::type a3; if(!GetTypedArg(argv[2],a3)) return 0;
+			typename TypedVal<A4>::type a4; if(!GetTypedArg(argv[3],a4)) return 0;
+			return ((FLEXT_CAST<T *>(c)->*F)(a1,a2,a3,a4),TypedDone()).ok?1:-1;
+		}
+
+		template<R (T::*F)(A1,A2,A3,A4)>
+		static methfun_T Bind() { return &Call<F>; }
+	};
+
+	template<class R,class T,class A1,class A2,class A3,class A4>
+	static TypedMethod4<R,T,A1,A2,A3,A4> TypedBinder(R (T::*)(A1,A2,A3,A4)) { return TypedMethod4<R,T,A1,A2,A3,A4>(); }
+
+	template<class R,class T,class A1,class A2,class A3,class A4,class A5>
+	struct TypedMethod5
+	{
+		template<R (T::*F)(A1,A2,A3,A4,A5)>
+		static int Call(flext_base *c,int argc,const t_atom *argv)
+		{
+			if(argc != 5) return 0;
+			typename TypedVal<A1>::type a1; if(!GetTypedArg(argv[0],a1)) return 0;
+			typename TypedVal<A2>::type a2; if(!GetTypedArg(argv[1],a2)) return 0;
+			typename TypedVal<A3>::type a3; if(!GetTypedArg(argv[2],a3)) return 0;
+			typename TypedVal<A4>::type a4; if(!GetTypedArg(argv[3],a4)) return 0;
+			typename TypedVal<A5>::type a5; if(!GetTypedArg(argv[4],a5)) return 0;
+			return ((FLEXT_CAST<T *>(c)->*F)(a1,a2,a3,a4,a5),TypedDone()).ok?1:-1;
+		}
+
+		template<R (T::*F)(A1,A2,A3,A4,A5)>
+		static methfun_T Bind() { return &Call<F>; }
+	};
+
+	template<class R,class T,class A1,class A2,class A3,class A4,class A5>
+	static TypedMethod5<R,T,A1,A2,A3,A4,A5> TypedBinder(R (T::*)(A1,A2,A3,A4,A5)) { return TypedMethod5<R,T,A1,A2,A3,A4,A5>(); }
+
+	template<class R,class T,class A1,class A2,class A3,class A4,class A5,class A6>
+	struct TypedMethod6
+	{
+		template<R (T::*F)(A1,A2,A3,A4,A5,A6)>
+		static int Call(flext_base *c,int argc,const t_atom *argv)
+		{
+			if(argc != 6) return 0;
+			typename TypedVal<A1>::type a1; if(!GetTypedArg(argv[0],a1)) return 0;
+			typename TypedVal<A2>::type a2; if(!GetTypedArg(argv[1],a2)) return 0;
+			typename TypedVal<A3>::type a3; if(!GetTypedArg(argv[2],a3)) return 0;
+			typename TypedVal<A4>::type a4; if(!GetTypedArg(argv[3],a4)) return 0;
+			typename TypedVal<A5>::type a5; if(!GetTypedArg(argv[4],a5)) return 0;
+			typename TypedVal<A6>::type a6; if(!GetTypedArg(argv[5],a6)) return 0;
+			return ((FLEXT_CAST<T *>(c)->*F)(a1,a2,a3,a4,a5,a6),TypedDone()).ok?1:-1;
+		}
+
+		template<R (T::*F)(A1,A2,A3,A4,A5,A6)>
+		static methfun_T Bind() { return &Call<F>; }
+	};
+
+	template<class R,class T,class A1,class A2,class A3,class A4,class A5,class A6>
+	static TypedMethod6<R,T,A1,A2,A3,A4,A5,A6> TypedBinder(R (T::*)(A1,A2,A3,A4,A5,A6)) { return TypedMethod6<R,T,A1,A2,A3,A4,A5,A6>(); }
+
+	template<class R,class T,class A1,class A2,class A3,class A4,class A5,class A6,class A7>
+	struct TypedMethod7
+	{
+		template<R (T::*F)(A1,A2,A3,A4,A5,A6,A7)>
+		static int Call(flext_base *c,int argc,const t_atom *argv)
+		{
+			if(argc != 7) return 0;
+			typename TypedVal<A1>::type a1; if(!GetTypedArg(argv[0],a1)) return 0;
+			typename TypedVal<A2>::type a2; if(!GetTypedArg(argv[1],a2)) return 0;
+			typename TypedVal<A3>::type a3; if(!GetTypedArg(argv[2],a3)) return 0;
+			typename TypedVal<A4>::type a4; if(!GetTypedArg(argv[3],a4)) return 0;
+			typename TypedVal<A5>::type a5; if(!GetTypedArg(argv[4],a5)) return 0;
+			typename TypedVal<A6>::type a6; if(!GetTypedArg(argv[5],a6)) return 0;
+			typename TypedVal<A7>::type a7; if(!GetTypedArg(argv[6],a7)) return 0;
+			return ((FLEXT_CAST<T *>(c)->*F)(a1,a2,a3,a4,a5,a6,a7),TypedDone()).ok?1:-1;
+		}
+
+		template<R (T::*F)(A1,A2,A3,A4,A5,A6,A7)>
+		static methfun_T Bind() { return &Call<F>; }
+	};
+
+	template<class R,class T,class A1,class A2,class A3,class A4,class A5,class A6,class A7>
+	static TypedMethod7<R,T,A1,A2,A3,A4,A5,A6,A7> TypedBinder(R (T::*)(A1,A2,A3,A4,A5,A6,A7)) { return TypedMethod7<R,T,A1,A2,A3,A4,A5,A6,A7>(); }
+
+	template<class R,class T,class A1,class A2,class A3,class A4,class A5,class A6,class A7,class A8>
+	struct TypedMethod8
+	{
+		template<R (T::*F)(A1,A2,A3,A4,A5,A6,A7,A8)>
+		static int Call(flext_base *c,int argc,const t_atom *argv)
+		{
+			if(argc != 8) return 0;
+			typename TypedVal<A1>::type a1; if(!GetTypedArg(argv[0],a1)) return 0;
+			typename TypedVal<A2>::type a2; if(!GetTypedArg(argv[1],a2)) return 0;
+			typename TypedVal<A3>::type a3; if(!GetTypedArg(argv[2],a3)) return 0;
+			typename TypedVal<A4>::type a4; if(!GetTypedArg(argv[3],a4)) return 0;
+			typename TypedVal<A5>::type a5; if(!GetTypedArg(argv[4],a5)) return 0;
+			typename TypedVal<A6>::type a6; if(!GetTypedArg(argv[5],a6)) return 0;
+			typename TypedVal<A7>::type a7; if(!GetTypedArg(argv[6],a7)) return 0;
+			typename TypedVal<A8>::type a8; if(!GetTypedArg(argv[7],a8)) return 0;
+			return ((FLEXT_CAST<T *>(c)->*F)(a1,a2,a3,a4,a5,a6,a7,a8),TypedDone()).ok?1:-1;
+		}
+
+		template<R (T::*F)(A1,A2,A3,A4,A5,A6,A7,A8)>
+		static methfun_T Bind() { return &Call<F>; }
+	};
+
+	template<class R,class T,class A1,class A2,class A3,class A4,class A5,class A6,class A7,class A8>
+	static TypedMethod8<R,T,A1,A2,A3,A4,A5,A6,A7,A8> TypedBinder(R (T::*)(A1,A2,A3,A4,A5,A6,A7,A8)) { return TypedMethod8<R,T,A1,A2,A3,A4,A5,A6,A7,A8>(); }
+
+//!		@} FLEXT_C_TYPEDMETHOD
+
 // --- bind/unbind ---------------------------------------
 
 	/*!	\defgroup FLEXT_C_BIND Methods for binding a flext class to a symbol
@@ -570,8 +931,10 @@ public:
 		@{ 
 	*/
 
-	//! Start a thread for this object
-	bool StartThread(void (*meth)(thr_params *p),thr_params *p,const char * = NULL) { p->cl = this; return flext::LaunchThread(meth,p); }
+	/*! \brief Start a thread for this object
+		\param name Method name, passed to CbThreadAttr
+	*/
+	bool StartThread(void (*meth)(thr_params *p),thr_params *p,const char *name = NULL);
 
 	//! Terminate all threads of this object
 	bool StopThreads();
@@ -666,6 +1029,46 @@ protected:
 	//! Set an attribute value
 	bool SetAttrib(const t_symbol *s,const AtomList &a) { return SetAttrib(s,a.Count(),a.Atoms()); }
 
+	//! Set a number attribute directly, without list conversion
+	bool SetAttribFloat(const t_symbol *s,float v) { return SetAttribNum(s,v); }
+	//! Set a number attribute directly, without list conversion
+	bool SetAttribInt(const t_symbol *s,int v) { return SetAttribNum(s,v); }
+	//! Set a number attribute directly, without list conversion
+	bool SetAttribBool(const t_symbol *s,bool v) { return SetAttribNum(s,v?1:0); }
+	//! Set a symbol attribute directly, without list conversion
+	bool SetAttribSymbol(const t_symbol *s,const t_symbol *v);
+	//! Get a number attribute directly, without list conversion
+	bool GetAttribFloat(const t_symbol *s,float &v) const { double d; return GetAttribNum(s,d) && ((v = (float)d),true); }
+	//! Get a number attribute directly, without list conversion
+	bool GetAttribInt(const t_symbol *s,int &v) const { double d; return GetAttribNum(s,d) && ((v = (int)d),true); }
+	//! Get a number attribute directly, without list conversion
+	bool GetAttribBool(const t_symbol *s,bool &v) const { double d; return GetAttribNum(s,d) && ((v = d != 0),true); }
+	//! Get a symbol attribute directly, without list conversion
+	bool GetAttribSymbol(const t_symbol *s,const t_symbol *&v) const;
+
+	/*! \brief Set many attributes in one pass
+		\param argc,argv list of \@attribute tags, each followed by its value(s)
+		\return true if all attributes could be set
+	*/
+	bool SetAttribs(int argc,const t_atom *argv);
+	//! Set many attributes in one pass
+	bool SetAttribs(const AtomList &a) { return SetAttribs(a.Count(),a.Atoms()); }
+
+	/*! \brief Store attribute values in a binary snapshot
+		\param buf memory to write to (aligned like malloc), may be NULL to query the size
+		\param size capacity of buf in bytes
+		\param all store all attributes which can be got and set, not only those marked for saving
+		\return number of bytes of the complete snapshot, if this is larger than size only the part fitting into buf has been written
+		\note The snapshot refers to symbols by address, it is only valid within the running application.
+	*/
+	size_t SnapshotAttribs(void *buf,size_t size,bool all = false) const;
+	/*! \brief Restore attribute values from a snapshot
+		\param buf snapshot written by SnapshotAttribs (of an object of the same class)
+		\param size number of bytes of the snapshot
+		\return true if all attributes could be set
+	*/
+	bool RestoreAttribs(const void *buf,size_t size);
+
 	// get and set the attribute
 	bool BangAttrib(const t_symbol *a);
 	// get and set the attribute
@@ -709,6 +1112,13 @@ protected:
 	//! \brief Set the description of an indexed outlet
 	void DescOutlet(int ix,const char *desc);
 
+	/*! \brief Let float (and int) messages into an inlet directly set a variable
+		The variable is written without any method lookup, e.g. for modulation parameters of DSP objects.
+		\param var variable to write to, NULL removes the binding
+		\note Handlers for float messages into this inlet are not called any more
+	*/
+	void BindInletFloat(int inlet,t_float *var);
+
 //!		@} FLEXT_C_INOUT
 
 
@@ -717,6 +1127,7 @@ protected:
 	public:
 
 	class AttrItem;
+	class MethItem;
 
     class Item
     {
@@ -741,7 +1152,11 @@ protected:
     };
 
     /*! This class holds hashed item entries
-		\note not thread-safe!
+		\remark Readers see an immutable snapshot of the item sets, which is replaced as a whole by Add and Remove.
+            The replaced sets (and removed items) are only freed when no reader is inside a Reader guard,
+            so messages can be dispatched while methods are added by other threads.
+            Modifications are serialized by a spin lock.
+		\note Frozen containers (the class methods) are changed in place, that's only done during class setup.
 	*/
     class FLEXT_SHARE ItemCont
     {
@@ -750,9 +1165,9 @@ protected:
 		~ItemCont();
 
 		int Min() const { return -1; }
-		int Max() const { return size-2; }
+		int Max() const { const Table *t = table; return t?t->size-2:-2; }
 
-        bool Contained(int i) const { return i+1 < size; }
+        bool Contained(int i) const { const Table *t = table; return t && i+1 < t->size; }
 
         //! Add an entry
 		void Add(Item *it,const t_symbol *tag,int inlet = 0);
@@ -765,19 +1180,111 @@ protected:
         ItemSet &GetInlet(int inlet = 0)
 		{ 
 			FLEXT_ASSERT(inlet >= Min() && inlet <= Max()); 
-			return *cont[inlet+1]; 
+			return *table->sets[inlet+1]; 
 		}
 
+        /*! \brief Guard for the readers of a container (which may be NULL)
+            Item sets and items retrieved within the guard stay valid until it is left.
+        */
+        class Reader
+        {
+        public:
+            Reader(ItemCont *c): cont(c) { if(cont) cont->Enter(); }
+            ~Reader() { if(cont) cont->Leave(); }
+        private:
+            ItemCont *cont;
+        };
+
         //! Get counter for total members (for index of new item)
         int Members() const { return members; }
 
+        /*! \brief Entry of the dispatch cache
+            A message signature (inlet, tag, argument count and types) resolved to the item which handled it.
+            Entries are never changed once added, the cache is cleared when items are added or removed.
+        */
+        struct Dispatch {
+            Dispatch *nxt;
+            const t_symbol *tag;
+            int inlet;
+            unsigned long sig;
+            //! handling item, the tag it was called with and the kind of call
+            Item *item;
+            const t_symbol *via;
+            int mode;
+            //! for lists distributed over the inlets: the entries of the elements per inlet and atom type, resolved on first use
+            const Dispatch *volatile *dist;
+            int distcnt;
+        };
+
+        //! Find a dispatch cache entry
+        const Dispatch *FindDispatch(int inlet,const t_symbol *tag,unsigned long sig) const;
+        /*! \brief Add a dispatch cache entry (can be called by several threads)
+            \param dist number of inlets to reserve element entries for (see Dispatch::dist)
+        */
+        void AddDispatch(int inlet,const t_symbol *tag,unsigned long sig,Item *item,const t_symbol *via,int mode,int dist = 0);
+
+        /*! \brief Move all items into one contiguous, cache-line aligned block, in list order
+            \note For method containers only, done after class setup. Add and Remove thaw the container again.
+        */
+        void Freeze();
+        //! Move frozen items back into individual heap nodes
+        void Thaw();
+        bool IsFrozen() const { return frozen != NULL; }
+
     protected:
 
+        //! Item sets of the inlets (the first one for all inlets), never changed once published
+        struct Table {
+            int size;
+            ItemSet *sets[1];
+        };
+
+        //! Object waiting for the readers to leave
+        struct Retired {
+            Retired *nxt;
+            int kind;
+            void *ptr;
+        };
+
+        enum { ret_table,ret_set,ret_item,ret_dispatch };
+
+        void Enter();
+        void Leave();
+
+        void Lock();
+        void Unlock();
+
+        //! Publish a larger table
 		void Resize(int nsz);
+        //! Publish a table with the set of an inlet replaced
+        void Replace(int inlet,ItemSet *set);
+        //! Copy the entries (not the items) of a set
+        static ItemSet *CopySet(const ItemSet &set);
+        //! Free an object when the current readers have left
+        void Retire(int kind,void *ptr);
+        //! Free the retired objects if there are no readers (with the lock held)
+        void Reclaim();
+        static void Free(Retired *r);
+
+        void ClearDispatch();
+        //! Destroy the frozen items, the item sets must not refer to them any more
+        void ReleaseFrozen();
+        static MethItem *CopyItem(const MethItem *src,void *mem,metharg *args);
 
         int members;
-		int memsize,size;
-		ItemSet **cont;
+        Table *volatile table;
+
+        volatile long readers,lock;
+        Retired *volatile retired;
+
+        enum { dispatchbuckets = 64,dispatchmax = 256 };
+        Dispatch *volatile *volatile dispatch;
+        volatile long dispatchcnt;
+
+        //! allocation of the frozen block, the items in there and their count
+        char *frozen;
+        MethItem *frozenitems;
+        int frozencnt;
 	};
 
     //! \brief This represents an item of the method list
@@ -869,6 +1376,21 @@ protected:
 	void ToSysAtom(int n,const t_atom &at) const;
 	void ToSysDouble(int n,double d) const { t_atom dbl[2]; ToSysList(n,2,SetDouble(dbl,d)); }
 
+	// typed output for Outlet handles
+	static void OutletSys(t_outlet *o,float f) { outlet_float(o,f); }
+	static void OutletSys(t_outlet *o,int f) { outlet_flint(o,f); }
+	static void OutletSys(t_outlet *o,bool f) { outlet_flint(o,f?1:0); }
+	static void OutletSys(t_outlet *o,const t_symbol *s) { outlet_symbol(o,const_cast<t_symbol *>(s)); }
+	static void OutletSys(t_outlet *o,const AtomList &l) { outlet_list(o,const_cast<t_symbol *>(sym_list),l.Count(),(t_atom *)l.Atoms()); }
+	static void OutletSys(t_outlet *o,const AtomAnything &a) { outlet_anything(o,const_cast<t_symbol *>(a.Header()),a.Count(),(t_atom *)a.Atoms()); }
+
+	static void OutletQueue(const flext_base *th,int n,float f) { th->ToQueueFloat(n,f); }
+	static void OutletQueue(const flext_base *th,int n,int f) { th->ToQueueInt(n,f); }
+	static void OutletQueue(const flext_base *th,int n,bool f) { th->ToQueueBool(n,f); }
+	static void OutletQueue(const flext_base *th,int n,const t_symbol *s) { th->ToQueueSymbol(n,s); }
+	static void OutletQueue(const flext_base *th,int n,const AtomList &l) { th->ToQueueList(n,l); }
+	static void OutletQueue(const flext_base *th,int n,const AtomAnything &a) { th->ToQueueAnything(n,a); }
+
 	static void ToSysMsg(MsgBundle *mb);
 
 	// add class method handlers
@@ -878,6 +1400,9 @@ private:
 	class pxbnd_object;
 public:
 
+	//! \brief Pending coalesced output to one outlet (see SetQueueCoalesce)
+	class QueueSlot;
+
 	//! \brief This represents an item of the symbol-bound method list
     class BindItem:
 		public Item 
@@ -889,17 +1414,22 @@ public:
 		void Unbind(const t_symbol *s);
 
 		bool (*fun)(flext_base *,t_symbol *s,int,t_atom *,void *);
+        //! shared dispatcher of the symbol
         pxbnd_object *px;
+        //! index of the entry in the dispatcher
+        int slot;
 	};
 	
-	ItemCont *ThMeths() { if(!methhead) methhead = new ItemCont; return methhead; }
+	ItemCont *ThMeths() { if(!methhead) NewCont(methhead); return methhead; }
 	static ItemCont *ClMeths(t_classid c);
 
 	//! \brief This is the central function to add message handlers. It is used by all other AddMethod incarnations.
 	static void AddMethod(ItemCont *ma,int inlet,const t_symbol *tag,methfun fun,metharg tp,...); 
 
-	ItemCont *ThAttrs() { return attrhead; }
+	ItemCont *ThAttrs() { if(!attrhead) NewCont(attrhead); return attrhead; }
 	static ItemCont *ClAttrs(t_classid c);
+	//! Make a container for the items of the object (another thread may be faster)
+	static void NewCont(ItemCont *volatile &head);
 
     static void AddAttrib(ItemCont *aa,ItemCont *ma,const t_symbol *attr,metharg tp,methfun gfun,methfun sfun);
     void AddAttrib(const t_symbol *attr,metharg tp,methfun gfun,methfun sfun);
@@ -930,6 +1460,30 @@ private:
 	static const t_symbol *curtag;
     //! number of message and signal inlets/outlets
 	unsigned char incnt,outcnt,insigs,outsigs;
+    //! queue lane for low priority output
+    unsigned char qprio;
+
+    //! list of coalescing slots
+    mutable QueueSlot *volatile qslots;
+
+    //! variables bound to inlets (see BindInletFloat)
+    t_float **inbind;
+    int inbindcnt;
+
+    //! Set a variable bound to the inlet, return false if there is none
+    bool SetInletFloat(int inlet,t_float v) 
+    { 
+        if(LIKELY(!inbind) || inlet >= inbindcnt || !inbind[inlet]) return false;
+        *inbind[inlet] = v;
+        return true;
+    }
+
+    //! Get the coalescing slot for outlet n, create it if necessary
+    QueueSlot *QueueSlotFor(int n) const;
+    //! Coalesce the message with one pending for the same outlet, return false if not coalescing
+    bool QueueLatest(int n,const t_symbol *s,int argc,const t_atom *argv,bool force) const;
+    //! Free coalescing slots (all messages must have been delivered)
+    void FreeQueueSlots();
 
 	outlet **outlets;
 
@@ -953,18 +1507,44 @@ private:
 	typedef bool (*methfun_4)(flext_base *c,t_any &,t_any &,t_any &,t_any &);
 	typedef bool (*methfun_5)(flext_base *c,t_any &,t_any &,t_any &,t_any &,t_any &);
 
-	mutable ItemCont *methhead;
+	mutable ItemCont *volatile methhead;
 	mutable ItemCont *bindhead;
 	
-	bool FindMeth(int inlet,const t_symbol *s,int argc,const t_atom *argv);
-	bool FindMethAny(int inlet,const t_symbol *s,int argc,const t_atom *argv);
-	bool TryMethTag(Item *lst,const t_symbol *tag,int argc,const t_atom *argv);
+	//! Result of a method search, for the dispatch cache
+	struct MethHit {
+		//! the item which handled the message
+		MethItem *item;
+		//! a method refused the message before, the result is not cacheable
+		bool failed;
+	};
+
+	//! Kinds of calls in the dispatch cache
+	enum { disp_tag,disp_int,disp_float,disp_bang,disp_sym,disp_any,disp_dist };
+	//! Atom types of the distributed list elements
+	enum { dist_float,dist_int,dist_symbol,dist_pointer,dist_types };
+
+	bool FindMeth(int inlet,const t_symbol *s,int argc,const t_atom *argv,MethHit *hit = NULL);
+	bool FindMethAny(int inlet,const t_symbol *s,int argc,const t_atom *argv,MethHit *hit = NULL);
+	int TryMethItem(MethItem *m,const t_symbol *tag,int argc,const t_atom *argv,MethHit *hit = NULL);
+	bool TryMethTag(Item *lst,const t_symbol *tag,int argc,const t_atom *argv,MethHit *hit = NULL);
 	bool TryMethSym(Item *lst,const t_symbol *s);
-	bool TryMethAny(Item *lst,const t_symbol *s,int argc,const t_atom *argv);
+	bool TryMethAny(Item *lst,const t_symbol *s,int argc,const t_atom *argv,MethHit *hit = NULL);
+	//! Call a method resolved by the dispatch cache
+	bool CallDispatch(const FLEXT_TEMP_TYPENAME ItemCont::Dispatch &d,const t_symbol *s,int argc,const t_atom *argv);
+	//! Distribute the list elements over the inlets, right to left (d is the cache entry of the list, if any)
+	void DistList(const FLEXT_TEMP_TYPENAME ItemCont::Dispatch *d,int argc,const t_atom *argv);
 
-	mutable ItemCont *attrhead;
+	mutable ItemCont *volatile attrhead;
 	mutable AttrDataCont *attrdata;
 
+#if FLEXT_SYS == FLEXT_SYS_PD && !defined(FLEXT_NOATTREDIT)
+	//! the attribute editor is open
+	bool attrdialog;
+#endif
+
+	AttrDataCont *ThAttrData() { if(!attrdata) attrdata = new AttrDataCont; return attrdata; }
+	AttrData *FindAttrData(const t_symbol *tag) const { return attrdata?attrdata->find(tag):NULL; }
+
 	AttrItem *FindAttrib(const t_symbol *tag,bool get,bool msg = false) const;
 
 	bool InitAttrib(int argc,const t_atom *argv);
@@ -973,6 +1553,9 @@ private:
 	bool GetAttrib(const t_symbol *tag,AttrItem *a,AtomList &l) const;
 	bool SetAttrib(const t_symbol *tag,AttrItem *a,int argc,const t_atom *argv);
 	bool SetAttrib(const t_symbol *tag,AttrItem *a,const AtomList &l) { return SetAttrib(tag,a,l.Count(),l.Atoms()); }
+	size_t SnapshotAttrib(char *buf,size_t pos,size_t size,const t_symbol *tag,AttrItem *a) const;
+	bool SetAttribNum(const t_symbol *tag,double v);
+	bool GetAttribNum(const t_symbol *tag,double &v) const;
 	// get and set the attribute
 	bool BangAttrib(const t_symbol *tag,AttrItem *a);
 	// show/hide the attribute
@@ -981,6 +1564,14 @@ private:
 	static bool cb_ListMethods(flext_base *c,int argc,const t_atom *argv);
 	static bool cb_ListAttrib(flext_base *c) { Locker lock(c); return c->ListAttrib(); }
 
+	//! Output (or post) the statistics of the message queue, optionally resetting them
+	static bool cb_QueueStats(flext_base *c,int argc,const t_atom *argv);
+
+#ifdef FLEXT_TRACE
+	//! Write the trace of all threads to a file
+	static bool cb_TraceDump(flext_base *c,int argc,const t_atom *argv);
+#endif
+
 	// queue stuff
 
 	//! Start message queue
@@ -1001,7 +1592,10 @@ private:
 #ifndef FLEXT_NOATTREDIT
 	// attribute editor
 	static bool cb_AttrDialog(flext_base *c,int argc,const t_atom *argv);
+	static bool cb_AttrDialogClose(flext_base *c);
 	static void cb_GfxProperties(flext_hdr *c, t_glist *);
+	//! Send a changed attribute value to the open editor
+	void UpdateAttrDialog(const t_symbol *tag,AttrItem *a);
 #endif
 
 #ifdef FLEXT_ATTRHIDE
@@ -1080,19 +1674,43 @@ private:
 
 	static t_class *pxbnd_class;
 
+    /*! \brief Dispatcher for all methods bound to one symbol
+        The symbol is bound once, a message is passed on to a compact array of entries.
+    */
     class pxbnd_object:
         public flext_root
         // no virtual table!
 	{ 
     public:
 		t_object obj;			// MUST reside at memory offset 0
-		flext_base *base;
-		BindItem *item;
-        void *data;
+        const t_symbol *sym;
+
+        //! bound method (copied from the BindItem, for a tight dispatch loop)
+        struct Entry {
+            flext_base *base;
+            bool (*fun)(flext_base *,t_symbol *s,int,t_atom *,void *);  // NULL if removed during dispatch
+            void *data;
+            BindItem *item;
+        };
+
+        Entry *entries;
+        int cnt,size;
+        int busy;  // nesting depth of dispatching
+        bool dirty;  // entries have been removed while dispatching
+
+		void init(const t_symbol *s) { sym = s; entries = NULL; cnt = size = busy = 0; dirty = false; }
+        int Add(flext_base *b,BindItem *it,void *d);
+        void Remove(int slot);
+        void Compact();
+        //! unbind and free the dispatcher
+        void Release();
 
-		void init(flext_base *b,BindItem *it,void *d) { base = b; item = it; data = d; }
 		static void px_method(pxbnd_object *c,const t_symbol *s,int argc,t_atom *argv);
 	};
+
+    typedef TablePtrMap<const t_symbol *,pxbnd_object *,8> BindMap;
+    //! dispatchers of all bound symbols
+    static BindMap *pxbnd_map;
 	
     //! create proxy class for symbol binding
 	static void SetupBindProxy();
@@ -17,6 +17,11 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 
 #include "lockfree/stack.hpp"
 #include "lockfree/fifo.hpp"
+#include "lockfree/atomic_int.hpp"
+#include "lockfree/cas.hpp"
+
+#include <new> // for placement new
+#include <cstring> // for memcpy
 
 #include "flpushns.h"
 
@@ -68,35 +73,146 @@ public:
 	}
 };
 
+//! Usage statistics of an object pool
+struct PoolStats
+{
+	size_t hits;   //!< objects served from the pool
+	size_t misses; //!< objects allocated from the heap
+	size_t live;   //!< objects handed out and not yet returned
+	size_t spare;  //!< objects held for reuse
+};
+
+/*! \brief Counters and reuse policy shared by the pooled containers
+	\remark Returned objects are kept for reuse as long as there are less than M*(contained objects)+O spares,
+	or less than a fixed high-water mark if one has been set.
+*/
+template <int M,int O>
+class PoolCounter
+{
+public:
+	PoolCounter(): hiwat(0) {}
+
+	//! Set a fixed limit for spare objects (0 for the M*size+O default)
+	inline void SetHighWater(size_t n) { hiwat = n; }
+
+	PoolStats Stats() const
+	{
+		PoolStats st;
+		st.hits = hits;
+		st.misses = misses;
+		st.live = live;
+		st.spare = spare;
+		return st;
+	}
+
+protected:
+	//! Reserve a place for a spare object, false if the pool is full
+	inline bool Reserve()
+	{
+		const long lim = hiwat?(long)hiwat:(long)sz*M+O;
+		if(++spare <= lim) return true;
+		--spare;
+		return false;
+	}
+
+	lockfree::atomic_int<long> sz,spare,hits,misses,live;
+	size_t hiwat;
+};
+
 template <typename T,int M = 2,int O = 1>
 class PooledLifo
     : public TypedLifo<T>
+	, public PoolCounter<M,O>
 {
 public:
-	PooledLifo(): sz(0),resz(0) {}
+	~PooledLifo() { T *n; while((n = reuse.Pop()) != NULL) delete n; }
+
+	void Push(T *c) { TypedLifo<T>::Push(c); ++this->sz; }
+	T *Pop() { T *r = TypedLifo<T>::Pop(); if(r) --this->sz; return r; }
 
-	void Push(T *c) { TypedLifo<T>::Push(c); ++sz; }
-	T *Pop() { T *r = TypedLifo<T>::Pop(); if(r) --sz; return r; }
+	//! Allocate n spare objects in advance
+	void Prefill(size_t n)
+	{
+		for(; n; --n) { reuse.Push(new T); ++this->spare; }
+	}
 
     T *New() 
 	{ 
+		++this->live;
 		T *n = reuse.Pop(); 
 		if(n) {
-			--resz;
+			--this->spare;
+			++this->hits;
 			return n;
 		}
-		else
+		else {
+			++this->misses;
 			return new T; 
+		}
 	}
 
     inline void Free(T *p) 
 	{ 
-		if(resz < sz*M+O) { reuse.Push(p); ++resz; }
+		--this->live;
+		if(this->Reserve()) reuse.Push(p);
 		else delete p; 
 	}
+
 private:
     TypedLifo<T> reuse;
-	size_t sz,resz;
+};
+
+
+//! Lock-free pool of fixed-size memory blocks carved from one preallocated slab
+class BlockPool
+{
+public:
+	BlockPool(): slab(NULL),mem(NULL),blsz(0),cnt(0) {}
+	~BlockPool() { Reset(); }
+
+	/*! \brief Allocate the slab with n blocks of (at least) sz bytes each
+		\note Not thread-safe, must be called before the pool is used
+	*/
+	void Setup(size_t n,size_t sz)
+	{
+		Reset();
+		if(!n || !sz) return;
+
+		// blocks must be able to hold (and align) a free list cell
+		const size_t al = sizeof(LifoCell);
+		blsz = (sz+al-1)/al*al;
+		cnt = n;
+		mem = new char[blsz*cnt+al];
+		slab = mem+(al-reinterpret_cast<size_t>(mem)%al)%al;
+		for(size_t i = 0; i < cnt; ++i)
+			free.Push(new(slab+i*blsz) LifoCell);
+	}
+
+	//! Free the slab - all blocks must have been returned
+	void Reset()
+	{
+		while(free.Pop()) {}
+		delete[] mem;
+		slab = mem = NULL;
+		blsz = cnt = 0;
+	}
+
+	//! Get a block or NULL if the pool is exhausted
+	inline void *Alloc() { return free.Pop(); }
+
+	//! Return a block obtained by Alloc()
+	inline void Free(void *p) { free.Push(new(p) LifoCell); }
+
+	//! Check whether memory has been obtained from this pool
+	inline bool Owns(const void *p) const { return p >= slab && p < slab+blsz*cnt; }
+
+	inline size_t BlockSize() const { return blsz; }
+	inline size_t Blocks() const { return cnt; }
+
+private:
+	char *slab,*mem;
+	size_t blsz,cnt;
+	Lifo free;
 };
 
 
@@ -109,6 +225,16 @@ public:
 	inline void Put(FifoCell *cl) { this->enqueue(cl); }
 	inline FifoCell *Get() { return this->dequeue(); }
     inline bool Avail() const { return !this->empty(); }
+
+	//! Put an element with a tag (see GetUntagged)
+	inline void Put(FifoCell *cl,unsigned tag) { this->enqueue(cl,tag); }
+	//! Get the first element unless its tag has one of the given bits set
+	inline FifoCell *GetUntagged(unsigned tags) { return this->dequeue_untagged(tags); }
+
+	//! Elements detached by GetAll, to be fetched completely by the consumer
+	typedef lockfree::intrusive_fifo<FifoCell>::chain Chain;
+	//! Detach all present elements at once
+	inline Chain GetAll() { return this->dequeue_all(); }
 };
 
 
@@ -119,6 +245,23 @@ class TypedFifo
 public:
     inline void Put(T *c) { Fifo::Put(static_cast<T *>(c)); }
     inline T *Get() { return static_cast<T *>(Fifo::Get()); }
+
+    inline void Put(T *c,unsigned tag) { Fifo::Put(static_cast<T *>(c),tag); }
+    inline T *GetUntagged(unsigned tags) { return static_cast<T *>(Fifo::GetUntagged(tags)); }
+
+	class Batch
+	{
+	public:
+		Batch() {}
+		Batch(const Fifo::Chain &c): chain(c) {}
+		inline bool Avail() const { return !chain.empty(); }
+		inline T *Get() { return static_cast<T *>(chain.next()); }
+	private:
+		Fifo::Chain chain;
+	};
+
+	//! Detach all present elements at once
+    inline Batch GetAll() { return Batch(Fifo::GetAll()); }
 };
 
 
@@ -154,15 +297,311 @@ public:
 template <typename T,int M = 2,int O = 1>
 class PooledFifo
     : public TypedFifo<T>
+	, public PoolCounter<M,O>
 {
 public:
     ~PooledFifo() { T *n; while((n = reuse.Get()) != NULL) delete n; }
 
-    inline T *New() { T *n = reuse.Get(); return n?n:new T; }
-    inline void Free(T *p) { if(resz < sz*M+O) reuse.Put(p); else delete p; }
+    inline void Put(T *c) { TypedFifo<T>::Put(c); ++this->sz; }
+    inline T *Get() { T *r = TypedFifo<T>::Get(); if(r) --this->sz; return r; }
+
+	//! Allocate n spare objects in advance
+	void Prefill(size_t n)
+	{
+		for(; n; --n) { reuse.Put(new T); ++this->spare; }
+	}
+
+    inline T *New() 
+	{ 
+		++this->live;
+		T *n = reuse.Get(); 
+		if(n) {
+			--this->spare;
+			++this->hits;
+			return n;
+		}
+		else {
+			++this->misses;
+			return new T; 
+		}
+	}
+
+    inline void Free(T *p) 
+	{ 
+		--this->live;
+		if(this->Reserve()) reuse.Put(p);
+		else delete p; 
+	}
+
 private:
     TypedFifo<T> reuse;
-	size_t sz,resz;
+};
+
+
+/*! \brief Wait-free ring buffer for one producer and one consumer thread
+	T must be copyable with memcpy (samples or POD structs).
+	Producer and consumer state are on separate cache lines, 
+	each side caches the position of the other one and only reads the shared one if the cached value doesn't suffice.
+	Besides copying, the regions (at most two) can be accessed in place, e.g. by SIMD kernels.
+	\note Setup is not thread-safe, all other functions are either for the producer or the consumer side.
+*/
+template <typename T>
+class RingBuffer
+{
+public:
+	RingBuffer(size_t n = 0): buf(NULL),mask(0),cap(0),mem(NULL),rd(0),wrcache(0),wr(0),rdcache(0) { if(n) Setup(n); }
+	~RingBuffer() { delete[] mem; }
+
+	//! Allocate room for (at least) n elements and clear the buffer, the storage is aligned to the cache line
+	void Setup(size_t n)
+	{
+		delete[] mem;
+		buf = NULL,mem = NULL;
+		mask = cap = 0;
+		rd = wrcache = wr = rdcache = 0;
+		if(!n) return;
+
+		// power of 2
+		size_t sz = 1;
+		while(sz < n) sz <<= 1;
+		mem = new char[sz*sizeof(T)+LOCKFREE_CACHELINE];
+		buf = reinterpret_cast<T *>(mem+(LOCKFREE_CACHELINE-reinterpret_cast<size_t>(mem)%LOCKFREE_CACHELINE)%LOCKFREE_CACHELINE);
+		mask = sz-1,cap = sz;
+	}
+
+	//! returns the number of elements the buffer can hold
+	inline size_t Capacity() const { return cap; }
+
+	// --- producer side ---
+
+	//! returns the number of elements which can be written
+	inline size_t Space() { return Capacity()-(wr-(rdcache = rd)); }
+
+	//! Write one element, false if the buffer is full
+	inline bool Put(const T &v)
+	{
+		const size_t w = wr;
+		if(UNLIKELY(w-rdcache >= cap)) {
+			rdcache = rd;
+			if(w-rdcache >= cap) return false;
+		}
+		buf[w&mask] = v;
+		lockfree::memory_barrier();
+		wr = w+1;
+		return true;
+	}
+
+	//! Write up to n elements, returns the number written
+	size_t Write(const T *src,size_t n)
+	{
+		T *p1,*p2;
+		size_t n2;
+		const size_t n1 = WriteRegions(p1,p2,n2,n);
+		if(n1) memcpy(p1,src,n1*sizeof(T));
+		if(n2) memcpy(p2,src+n1,n2*sizeof(T));
+		Commit(n1+n2);
+		return n1+n2;
+	}
+
+	/*! \brief Get the free regions for writing in place
+		\param p1,p2 ... start of the first and second region
+		\param n2 ... length of the second region (at the start of the storage)
+		\param n ... maximum number of elements
+		\return length of the first region
+		\note Call Commit with the number of elements actually written
+	*/
+	size_t WriteRegions(T *&p1,T *&p2,size_t &n2,size_t n = (size_t)-1)
+	{
+		size_t sp = cap-(wr-rdcache);
+		if(sp < n) sp = Space();
+		if(sp > n) sp = n;
+		const size_t o = wr&mask;
+		const size_t n1 = sp < cap-o?sp:cap-o;
+		p1 = buf+o,p2 = buf;
+		n2 = sp-n1;
+		return n1;
+	}
+
+	//! Make n elements written in place available to the consumer
+	inline void Commit(size_t n)
+	{
+		lockfree::memory_barrier();
+		wr += n;
+	}
+
+	// --- consumer side ---
+
+	//! returns the number of elements which can be read
+	inline size_t Count() { return (wrcache = wr)-rd; }
+
+	//! Read one element, false if the buffer is empty
+	inline bool Get(T &v)
+	{
+		const size_t r = rd;
+		if(UNLIKELY(r == wrcache)) {
+			wrcache = wr;
+			if(r == wrcache) return false;
+		}
+		lockfree::memory_barrier();
+		v = buf[r&mask];
+		lockfree::memory_barrier();
+		rd = r+1;
+		return true;
+	}
+
+	//! Read up to n elements, returns the number read
+	size_t Read(T *dst,size_t n)
+	{
+		const T *p1,*p2;
+		size_t n2;
+		const size_t n1 = ReadRegions(p1,p2,n2,n);
+		if(n1) memcpy(dst,p1,n1*sizeof(T));
+		if(n2) memcpy(dst+n1,p2,n2*sizeof(T));
+		Release(n1+n2);
+		return n1+n2;
+	}
+
+	/*! \brief Get the filled regions for reading in place
+		\param p1,p2 ... start of the first and second region
+		\param n2 ... length of the second region (at the start of the storage)
+		\param n ... maximum number of elements
+		\return length of the first region
+		\note Call Release with the number of elements actually consumed
+	*/
+	size_t ReadRegions(const T *&p1,const T *&p2,size_t &n2,size_t n = (size_t)-1)
+	{
+		size_t cnt = wrcache-rd;
+		if(cnt < n) cnt = Count();
+		if(cnt > n) cnt = n;
+		lockfree::memory_barrier();
+		const size_t o = rd&mask;
+		const size_t n1 = cnt < cap-o?cnt:cap-o;
+		p1 = buf+o,p2 = buf;
+		n2 = cnt-n1;
+		return n1;
+	}
+
+	//! Give n elements read in place back to the producer
+	inline void Release(size_t n)
+	{
+		lockfree::memory_barrier();
+		rd += n;
+	}
+
+private:
+	// constant after Setup
+	T *buf;
+	size_t mask,cap;
+	char *mem;
+	char pad0[LOCKFREE_CACHELINE-sizeof(T *)-2*sizeof(size_t)-sizeof(char *)];
+
+	// consumer side
+	volatile size_t rd;
+	size_t wrcache;
+	char pad1[LOCKFREE_CACHELINE-2*sizeof(size_t)];
+
+	// producer side
+	volatile size_t wr;
+	size_t rdcache;
+	char pad2[LOCKFREE_CACHELINE-2*sizeof(size_t)];
+};
+
+
+/*! \brief Parameter set passed from the message domain (or any other thread) to the DSP thread
+	Triple buffer: a writer fills a spare copy and exchanges it with the pending one,
+	the DSP thread takes the pending copy with Update. It never waits and never sees a partially written set.
+	Writers are serialized by a spin lock, which they only hold while copying.
+	\code
+	// in a message handler or attribute setter
+	Coefs &c = coefs.Begin(); c.freq = f; Compute(c); coefs.Commit();
+	// once per block in CbSignal
+	coefs.Update(); const Coefs &c = coefs.Get();
+	\endcode
+	\note T must be copy assignable. Only one thread may read (Update, Get).
+*/
+template <typename T>
+class DspParam
+{
+public:
+	DspParam(const T &v = T()): rd(0),wr(1),last(0),lock(0),mid(2) { buf[0] = buf[1] = buf[2] = v; }
+
+	// --- writer side ---
+
+	//! Write a complete parameter set
+	void Set(const T &v)
+	{
+		Lock();
+		buf[wr] = v;
+		Publish();
+	}
+
+	/*! \brief Get a copy of the latest parameter set to modify (e.g. a single field)
+		\note Must be followed by Commit, other writers wait in between
+	*/
+	T &Begin()
+	{
+		Lock();
+		buf[wr] = buf[last];
+		return buf[wr];
+	}
+
+	//! Pass the set modified after Begin to the reader
+	void Commit() { Publish(); }
+
+	//! returns a copy of the latest parameter set (e.g. for an attribute getter)
+	T Latest()
+	{
+		Lock();
+		const T v = buf[last];
+		lockfree::store_release(&lock,0);
+		return v;
+	}
+
+	// --- reader side ---
+
+	//! Take the latest parameter set, returns true if it has changed since the last call
+	bool Update()
+	{
+		if(!(mid&dirty)) return false;
+		int m;
+		// only fails if a writer has published in the meantime
+		do m = mid; while(!lockfree::CAS(&mid,m,rd));
+		rd = m&3;
+		return true;
+	}
+
+	//! returns the parameter set taken with Update (unchanged until the next call)
+	const T &Get() const { return buf[rd]; }
+
+private:
+	// flag of the pending set
+	enum { dirty = 4 };
+
+	void Lock() { while(!lockfree::CAS(&lock,0,1)) {} }
+
+	void Publish()
+	{
+		int m;
+		do m = mid; while(!lockfree::CAS(&mid,m,wr|dirty));
+		last = wr;
+		// the former pending set (or the one released by the reader) is the new spare
+		wr = m&3;
+		lockfree::store_release(&lock,0);
+	}
+
+	T buf[3];
+
+	// reader side
+	int rd;
+	char pad0[LOCKFREE_CACHELINE-sizeof(int)];
+
+	// writer side (under the lock)
+	int wr,last;
+	volatile int lock;
+	char pad1[LOCKFREE_CACHELINE-3*sizeof(int)];
+
+	// index of the pending set
+	volatile int mid;
 };
 
 #include "flpopns.h"
@@ -149,6 +149,16 @@ FLEXT_ATTRGET_(VAR,TP) FLEXT_ATTRSET_(VAR,TP)
 \
 FLEXT_ATTRGET_V(VAR) FLEXT_ATTRSET_V(VAR) 
 
+/*! \brief Declare both implicit get and set functions for a smoothed float attribute
+    VAR is a flext_dsp::Smoothed, setting the attribute starts a ramp to the new value,
+    getting it returns the target. Add it like a float attribute (e.g. with FLEXT_ADDATTR_VAR1).
+*/
+#define FLEXT_ATTRVAR_SMOOTH(VAR) \
+static bool FLEXT_GET_PRE(VAR)(flext_base *c,float &arg) \
+{ arg = FLEXT_CAST<thisType *>(c)->VAR.Get(); return true; } \
+static bool FLEXT_SET_PRE(VAR)(flext_base *c,float &arg) \
+{ FLEXT_CAST<thisType *>(c)->VAR.Set(arg); return true; }
+
 
 //! @} FLEXT_DA_ATTRVAR
 
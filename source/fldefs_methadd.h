@@ -106,6 +106,14 @@ FLEXT_CADDMETHOD_2(CL,IX,flext::MakeSymbol(M_TAG),M_FUN,int,int)
 \
 FLEXT_CADDMETHOD_3(CL,IX,flext::MakeSymbol(M_TAG),M_FUN,int,int,int)
 
+/*! Add a handler for a member function with typed arguments
+    \note No FLEXT_CALLBACK declaration is needed, the arguments are converted at compile time
+    \sa FLEXT_C_TYPEDMETHOD
+*/
+#define FLEXT_CADDMETHOD_TYPED(CL,IX,M_TAG,M_FUN) \
+\
+flext_base::AddMethod(CL,IX,flext::MakeSymbol(M_TAG),FLEXT_TYPED(thisType,M_FUN))
+
 //! @} FLEXT_D_CADDMETHOD
 
 
@@ -225,6 +233,11 @@ FLEXT_ADDMETHOD_2(IX,flext::MakeSymbol(M_TAG),M_FUN,int,int)
 \
 FLEXT_ADDMETHOD_3(IX,flext::MakeSymbol(M_TAG),M_FUN,int,int,int)
 
+//! Add a handler for a member function with typed arguments
+#define FLEXT_ADDMETHOD_TYPED(IX,M_TAG,M_FUN) \
+\
+flext_base::AddMethod(IX,flext::MakeSymbol(M_TAG),FLEXT_TYPED(thisType,M_FUN))
+
 
 //! @} FLEXT_D_ADDMETHOD
 
@@ -25,13 +25,13 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 //! Set up a threaded method callback with no arguments
 #define FLEXT_THREAD(M_FUN) \
 static bool FLEXT_CALL_PRE(M_FUN)(flext_base *c) {  \
-	thr_params *p = new thr_params; \
+	thr_params *p = thr_params::New(); \
 	return c->StartThread(FLEXT_THR_PRE(M_FUN),p,#M_FUN); \
 } \
 static void FLEXT_THR_PRE(M_FUN)(thr_params *p) {  \
 	thisType *th = FLEXT_CAST<thisType *>(p->cl); \
 	bool ok = th->PushThread(); \
-	delete p; \
+	thr_params::Free(p); \
 	if(ok) { \
 		th->M_FUN(); \
 		th->PopThread(); \
@@ -41,14 +41,14 @@ static void FLEXT_THR_PRE(M_FUN)(thr_params *p) {  \
 //! Set up a threaded method callback for an anything argument
 #define FLEXT_THREAD_A(M_FUN) \
 static bool FLEXT_CALL_PRE(M_FUN)(flext_base *c,t_symbol *s,int argc,t_atom *argv) {  \
-	thr_params *p = new thr_params; p->set_any(s,argc,argv); \
+	thr_params *p = thr_params::New(); p->set_any(s,argc,argv); \
 	return c->StartThread(FLEXT_THR_PRE(M_FUN),p,#M_FUN); \
 } \
 static void FLEXT_THR_PRE(M_FUN)(thr_params *p) {  \
 	thisType *th = FLEXT_CAST<thisType *>(p->cl); \
 	bool ok = th->PushThread(); \
 	AtomAnything *args = p->var[0]._any; \
-	delete p; \
+	thr_params::Free(p); \
 	if(ok) { \
 		th->M_FUN(args->Header(),args->Count(),args->Atoms()); \
 		th->PopThread(); \
@@ -59,14 +59,14 @@ static void FLEXT_THR_PRE(M_FUN)(thr_params *p) {  \
 //! Set up a threaded method callback for a variable argument list
 #define FLEXT_THREAD_V(M_FUN) \
 static bool FLEXT_CALL_PRE(M_FUN)(flext_base *c,int argc,t_atom *argv) {  \
-	thr_params *p = new thr_params; p->set_list(argc,argv); \
+	thr_params *p = thr_params::New(); p->set_list(argc,argv); \
 	return c->StartThread(FLEXT_THR_PRE(M_FUN),p,#M_FUN); \
 } \
 static void FLEXT_THR_PRE(M_FUN)(thr_params *p) {  \
 	thisType *th = FLEXT_CAST<thisType *>(p->cl); \
 	bool ok = th->PushThread(); \
 	AtomList *args = p->var[0]._list; \
-	delete p; \
+	thr_params::Free(p); \
 	if(ok) { \
 		th->M_FUN(args->Count(),args->Atoms()); \
 		th->PopThread(); \
@@ -79,14 +79,14 @@ static void FLEXT_THR_PRE(M_FUN)(thr_params *p) {  \
 */
 #define FLEXT_THREAD_X(M_FUN) \
 static bool FLEXT_CALL_PRE(M_FUN)(flext_base *c,void *data) {  \
-	thr_params *p = new thr_params; p->var[0]._ext = data; \
+	thr_params *p = thr_params::New(); p->var[0]._ext = data; \
 	return c->StartThread(FLEXT_THR_PRE(M_FUN),p,#M_FUN); \
 } \
 static void FLEXT_THR_PRE(M_FUN)(thr_params *p) {  \
 	thisType *th = FLEXT_CAST<thisType *>(p->cl); \
 	bool ok = th->PushThread(); \
 	void *data = p->var[0]._ext; \
-	delete p; \
+	thr_params::Free(p); \
 	if(ok) { \
 		th->M_FUN(data); \
 		th->PopThread(); \
@@ -97,14 +97,14 @@ static void FLEXT_THR_PRE(M_FUN)(thr_params *p) {  \
 //! Set up a threaded method callback for a boolean argument
 #define FLEXT_THREAD_B(M_FUN) \
 static bool FLEXT_CALL_PRE(M_FUN)(flext_base *c,int &arg1) {  \
-	thr_params *p = new thr_params; p->var[0]._bool = arg1 != 0; \
+	thr_params *p = thr_params::New(); p->var[0]._bool = arg1 != 0; \
 	return c->StartThread(FLEXT_THR_PRE(M_FUN),p,#M_FUN); \
 } \
 static void FLEXT_THR_PRE(M_FUN)(thr_params *p) {  \
 	thisType *th = FLEXT_CAST<thisType *>(p->cl); \
 	bool ok = th->PushThread(); \
 	bool b = p->var[0]._bool; \
-	delete p; \
+	thr_params::Free(p); \
 	if(ok) { \
 		th->M_FUN(b); \
 		th->PopThread(); \
@@ -114,7 +114,7 @@ static void FLEXT_THR_PRE(M_FUN)(thr_params *p) {  \
 //! Set up a threaded method callback for 1 argument
 #define FLEXT_THREAD_1(M_FUN,TP1) \
 static bool FLEXT_CALL_PRE(M_FUN)(flext_base *c,TP1 &arg1) {  \
-	thr_params *p = new thr_params(1); \
+	thr_params *p = thr_params::New(1); \
 	p->var[0]._ ## TP1 = arg1; \
 	return c->StartThread(FLEXT_THR_PRE(M_FUN),p,#M_FUN); \
 } \
@@ -122,7 +122,7 @@ static void FLEXT_THR_PRE(M_FUN)(thr_params *p) {  \
 	thisType *th = FLEXT_CAST<thisType *>(p->cl); \
 	bool ok = th->PushThread(); \
 	const TP1 v1 = p->var[0]._ ## TP1; \
-	delete p; \
+	thr_params::Free(p); \
 	if(ok) { \
 		th->M_FUN(v1); \
 		th->PopThread(); \
@@ -132,7 +132,7 @@ static void FLEXT_THR_PRE(M_FUN)(thr_params *p) {  \
 //! Set up a threaded method callback for 2 arguments
 #define FLEXT_THREAD_2(M_FUN,TP1,TP2) \
 static bool FLEXT_CALL_PRE(M_FUN)(flext_base *c,TP1 &arg1,TP2 &arg2) {  \
-	thr_params *p = new thr_params(2); \
+	thr_params *p = thr_params::New(2); \
 	p->var[0]._ ## TP1 = arg1; \
 	p->var[1]._ ## TP2 = arg2; \
 	return c->StartThread(FLEXT_THR_PRE(M_FUN),p,#M_FUN); \
@@ -142,7 +142,7 @@ static void FLEXT_THR_PRE(M_FUN)(thr_params *p) {  \
 	bool ok = th->PushThread(); \
 	const TP1 v1 = p->var[0]._ ## TP1; \
 	const TP1 v2 = p->var[1]._ ## TP2; \
-	delete p; \
+	thr_params::Free(p); \
 	if(ok) { \
 		th->M_FUN(v1,v2); \
 		th->PopThread(); \
@@ -152,7 +152,7 @@ static void FLEXT_THR_PRE(M_FUN)(thr_params *p) {  \
 //! Set up a threaded method callback for 3 arguments
 #define FLEXT_THREAD_3(M_FUN,TP1,TP2,TP3) \
 static bool FLEXT_CALL_PRE(M_FUN)(flext_base *c,TP1 &arg1,TP2 &arg2,TP3 &arg3) {  \
-	thr_params *p = new thr_params(3); \
+	thr_params *p = thr_params::New(3); \
 	p->var[0]._ ## TP1 = arg1; \
 	p->var[1]._ ## TP2 = arg2; \
 	p->var[2]._ ## TP3 = arg3; \
@@ -164,7 +164,7 @@ static void FLEXT_THR_PRE(M_FUN)(thr_params *p) {  \
 	const TP1 v1 = p->var[0]._ ## TP1; \
 	const TP2 v2 = p->var[1]._ ## TP2; \
 	const TP3 v3 = p->var[2]._ ## TP3; \
-	delete p; \
+	thr_params::Free(p); \
 	if(ok) { \
 		th->M_FUN(v1,v2,v3); \
 		th->PopThread(); \
@@ -174,7 +174,7 @@ static void FLEXT_THR_PRE(M_FUN)(thr_params *p) {  \
 //! Set up a threaded method callback for 4 arguments
 #define FLEXT_THREAD_4(M_FUN,TP1,TP2,TP3,TP4) \
 static bool FLEXT_CALL_PRE(M_FUN)(flext_base *c,TP1 &arg1,TP2 &arg2,TP3 &arg3,TP4 &arg4) {  \
-	thr_params *p = new thr_params(4); \
+	thr_params *p = thr_params::New(4); \
 	p->var[0]._ ## TP1 = arg1; \
 	p->var[1]._ ## TP2 = arg2; \
 	p->var[2]._ ## TP3 = arg3; \
@@ -188,7 +188,7 @@ static void FLEXT_THR_PRE(M_FUN)(thr_params *p) {  \
 	const TP2 v2 = p->var[1]._ ## TP2; \
 	const TP3 v3 = p->var[2]._ ## TP3; \
 	const TP4 v4 = p->var[3]._ ## TP4; \
-	delete p; \
+	thr_params::Free(p); \
 	if(ok) { \
 		th->M_FUN(v1,v2,v3,v4); \
 		th->PopThread(); \
@@ -198,7 +198,7 @@ static void FLEXT_THR_PRE(M_FUN)(thr_params *p) {  \
 //! Set up a threaded method callback for 5 arguments
 #define FLEXT_THREAD_5(M_FUN,TP1,TP2,TP3,TP4,TP5) \
 static bool FLEXT_CALL_PRE(M_FUN)(flext_base *c,TP1 &arg1,TP2 &arg2,TP3 &arg3,TP4 &arg4,TP5 &arg5) {  \
-	thr_params *p = new thr_params(5); \
+	thr_params *p = thr_params::New(5); \
 	p->var[0]._ ## TP1 = arg1; \
 	p->var[1]._ ## TP2 = arg2; \
 	p->var[2]._ ## TP3 = arg3; \
@@ -214,7 +214,7 @@ static void FLEXT_THR_PRE(M_FUN)(thr_params *p) {  \
 	const TP3 v3 = p->var[2]._ ## TP3; \
 	const TP4 v4 = p->var[3]._ ## TP4; \
 	const TP5 v5 = p->var[4]._ ## TP5; \
-	delete p; \
+	thr_params::Free(p); \
 	if(ok) { \
 		th->M_FUN(v1,v2,v3,v4,v5); \
 		th->PopThread(); \
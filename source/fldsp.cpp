@@ -15,10 +15,667 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 
 #include "flext.h"
 #include "flinternal.h"
+#include "lockfree/cas.hpp"
+#include "lockfree/atomic_int.hpp"
 #include <cstring>
+#include <cmath>
+
+#if FLEXT_SYS == FLEXT_SYS_PD && defined(FLEXT_THREADS)
+#ifdef _MSC_VER
+    #pragma warning (push)
+    #pragma warning (disable:4091)
+#endif
+// for the connections of DSP island members
+#include <g_canvas.h>
+#ifdef _MSC_VER
+    #pragma warning (pop)
+#endif
+#endif
+
+#if defined(FLEXT_THREADS) && !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+#ifdef _MSC_VER
+#include <float.h>
+#endif
 
 #include "flpushns.h"
 
+// === denormal handling ======================================
+
+//! Check whether flushing denormals is possible on this CPU
+inline bool dsp_canflush()
+{
+#if !defined(_MSC_VER) && defined(__GNUC__) && (FLEXT_CPU == FLEXT_CPU_IA32 || FLEXT_CPU == FLEXT_CPU_X86_64)
+    // pre-SSE2 CPUs have no MXCSR (or no DAZ)
+    return (flext::GetSIMDCapabilities()&flext::simd_sse2) != 0;
+#else
+    return true;
+#endif
+}
+
+//! Switch on flush-to-zero/denormals-are-zero, return the previous state
+inline unsigned long dsp_flushon()
+{
+#if defined(_MSC_VER)
+    const unsigned int prv = _controlfp(0,0);
+    _controlfp(_DN_FLUSH,_MCW_DN);
+    return prv;
+#elif defined(__GNUC__) && (FLEXT_CPU == FLEXT_CPU_IA32 || FLEXT_CPU == FLEXT_CPU_X86_64)
+    unsigned int csr;
+    __asm__ __volatile__ ("stmxcsr %0" : "=m" (csr));
+    const unsigned int on = csr|0x8040; // FTZ | DAZ
+    __asm__ __volatile__ ("ldmxcsr %0" : : "m" (on));
+    return csr;
+#elif defined(__GNUC__) && FLEXT_CPU == FLEXT_CPU_ARM64
+    unsigned long fpcr;
+    __asm__ __volatile__ ("mrs %0, fpcr" : "=r" (fpcr));
+    __asm__ __volatile__ ("msr fpcr, %0" : : "r" (fpcr|(1UL<<24))); // FZ
+    return fpcr;
+#elif defined(__GNUC__) && FLEXT_CPU == FLEXT_CPU_ARM && defined(__VFP_FP__) && !defined(__SOFTFP__)
+    unsigned int fpscr;
+    __asm__ __volatile__ ("vmrs %0, fpscr" : "=r" (fpscr));
+    __asm__ __volatile__ ("vmsr fpscr, %0" : : "r" (fpscr|(1U<<24))); // FZ
+    return fpscr;
+#else
+    return 0;
+#endif
+}
+
+//! Restore the floating point state returned by dsp_flushon
+inline void dsp_flushoff(unsigned long prv)
+{
+#if defined(_MSC_VER)
+    _controlfp((unsigned int)prv,_MCW_DN);
+#elif defined(__GNUC__) && (FLEXT_CPU == FLEXT_CPU_IA32 || FLEXT_CPU == FLEXT_CPU_X86_64)
+    const unsigned int csr = (unsigned int)prv;
+    __asm__ __volatile__ ("ldmxcsr %0" : : "m" (csr));
+#elif defined(__GNUC__) && FLEXT_CPU == FLEXT_CPU_ARM64
+    __asm__ __volatile__ ("msr fpcr, %0" : : "r" (prv));
+#elif defined(__GNUC__) && FLEXT_CPU == FLEXT_CPU_ARM && defined(__VFP_FP__) && !defined(__SOFTFP__)
+    __asm__ __volatile__ ("vmsr fpscr, %0" : : "r" ((unsigned int)prv));
+#else
+    (void)prv;
+#endif
+}
+
+#ifdef FLEXT_DSPLOAD
+//! Monotonic time in microseconds for DSP load measurement
+inline double dsp_usecs() { return flext::GetTimeNs()*1.e-3; }
+#endif
+
+// === batches ================================================
+
+FLEXT_TEMPLATE
+struct BatchVars {
+    static DspBatch *batches;
+};
+
+FLEXT_TEMPIMPL(DspBatch *BatchVars)::batches = NULL;
+
+/*! \brief The objects of a class processed together (see flext_dsp::SetBatch)
+    \note Only used by the audio thread (or while DSP is being set up).
+*/
+class DspBatch
+{
+    typedef FLEXT_TEMPINST(BatchVars) Vars;
+
+public:
+    /*! \brief Add an object to the batch of its class and block size
+        \note Called in DSP chain order, the last object added runs the batch
+    */
+    static DspBatch *Attach(flext_dsp *d)
+    {
+        const flext_obj::t_classid c = d->thisClassId();
+        const int n = d->io.frames;
+        DspBatch *b = Vars::batches;
+        while(b && (b->cls != c || b->frames != n)) b = b->nxt;
+        if(!b) {
+            b = new DspBatch(c,n);
+            b->nxt = Vars::batches;
+            Vars::batches = b;
+        }
+
+        if(b->count == b->size) {
+            const int sz = b->size?b->size*2:8;
+            flext_dsp **objs = new flext_dsp *[sz];
+            for(int i = 0; i < b->count; ++i) objs[i] = b->objs[i];
+            if(b->objs) delete[] b->objs;
+            if(b->act) delete[] b->act;
+            b->objs = objs;
+            b->act = new flext_dsp *[b->size = sz];
+        }
+        b->objs[b->count++] = d;
+        return b;
+    }
+
+    //! Remove an object, the batch is deleted with the last one
+    static void Detach(DspBatch *b,flext_dsp *d)
+    {
+        int i = 0;
+        while(i < b->count && b->objs[i] != d) ++i;
+        FLEXT_ASSERT(i < b->count);
+        for(--b->count; i < b->count; ++i) b->objs[i] = b->objs[i+1];
+
+        if(!b->count) {
+            DspBatch **p = &Vars::batches;
+            while(*p != b) p = &(*p)->nxt;
+            *p = b->nxt;
+            delete b;
+        }
+    }
+
+    //! the object running the batch
+    const flext_dsp *Last() const { return objs[count-1]; }
+
+    //! Process the objects which have copied their input in the current block
+    void Run()
+    {
+        int n = 0;
+        for(int i = 0; i < count; ++i) {
+            flext_dsp *d = objs[i];
+            if(d->batchpending) {
+                d->batchpending = false;
+                act[n++] = d;
+            }
+        }
+        if(n) act[0]->BatchRun(act,n);
+    }
+
+private:
+    DspBatch(flext_obj::t_classid c,int n): cls(c),frames(n),objs(NULL),act(NULL),count(0),size(0),nxt(NULL) {}
+    ~DspBatch() { if(objs) delete[] objs; if(act) delete[] act; }
+
+    const flext_obj::t_classid cls;
+    const int frames;
+    //! members in DSP chain order, and those processed in the current block
+    flext_dsp **objs,**act;
+    int count,size;
+    DspBatch *nxt;
+};
+
+// === oversampling ===========================================
+
+/*! \brief Up- and downsampling for oversampled processing (see flext_dsp::SetOversampling)
+    Each factor of two is a stage with a half-band FIR filter (Kaiser window, about 80 dB stopband).
+    In polyphase form every other tap is zero, one branch is the center tap alone, 
+    the other one is computed at the lower rate with vectorized multiply-accumulates.
+    \note Only used by the thread processing the object
+*/
+class DspOver
+{
+public:
+    DspOver(int f,int in,const int *inchns,int out,const int *outchns,int frames)
+        : fac(f),nstages(0),nin(in),nout(out)
+    {
+        while(1<<nstages < f) ++nstages;
+        FLEXT_ASSERT(nstages <= MAXSTAGES);
+
+        // the first stage needs the steepest filter, the following ones only remove images far above the signal band
+        int s,dl = 0;
+        for(s = 0; s < nstages; ++s) {
+            Stage &st = stages[s];
+            st.taps = s?12:32;
+            // delay of up- and downsampling in samples at the highest rate
+            dl += (2*st.taps-2)<<(nstages-1-s);
+        }
+        // delay the downsampling by half a sample in some stages to get an integer latency
+        const int e = -dl&(fac-1);
+        for(s = 0; s < nstages; ++s) stages[s].shift = (e>>(nstages-1-s))&1;
+        latency = (dl+e)>>nstages;
+
+        chns = new int[in+out];
+        int i,cin = 0,cout = 0;
+        for(i = 0; i < in; ++i) cin += chns[i] = inchns?inchns[i]:1;
+        for(i = 0; i < out; ++i) cout += chns[in+i] = outchns?outchns[i]:1;
+
+        // coefficients, filter states per channel and stage, the temporary and the oversampled vectors
+        int sz = 0;
+        for(s = 0; s < nstages; ++s) {
+            const int t = stages[s].taps;
+            sz += 2*t+(cin+2*cout)*(t-1+(frames<<s));
+        }
+        sz += (frames<<nstages)/2+(cin+cout)*(frames<<nstages);
+
+        t_sample *p = buf = flext::NewAligned<t_sample>(sz);
+        flext::ZeroSamples(buf,sz);
+
+        for(s = 0; s < nstages; ++s) {
+            Stage &st = stages[s];
+            st.up = p,p += st.taps;
+            st.down = p,p += st.taps;
+            Design(st.up,st.down,st.taps);
+        }
+
+        states = new t_sample *[(cin+2*cout)*nstages];
+        t_sample **sp = states;
+        for(i = 0; i < cin+2*cout; ++i)
+            for(s = 0; s < nstages; ++s) 
+                *(sp++) = p,p += stages[s].taps-1+(frames<<s);
+        upstates = cin*nstages;
+
+        tmp = p,p += (frames<<nstages)/2;
+        vecs = new flext_dsp::t_signalvec[in+out];
+        for(i = 0; i < in+out; ++i) vecs[i] = p,p += chns[i]*(frames<<nstages);
+    }
+
+    ~DspOver() 
+    { 
+        delete[] vecs;
+        delete[] states;
+        delete[] chns;
+        flext::FreeAligned(buf); 
+    }
+
+    //! Upsample n frames of the input vectors into the oversampled ones
+    void Up(const t_sample *const *in,int n)
+    {
+        t_sample **sp = states;
+        for(int i = 0; i < nin; ++i)
+            for(int c = 0; c < chns[i]; ++c,++sp) {
+                const Stage &st0 = stages[0];
+                flext::CopySamples(sp[0]+st0.taps-1,in[i]+c*n,n);
+                for(int s = 0; s < nstages; ++s) {
+                    // the next stage takes the output after its history
+                    t_sample *dst = s < nstages-1?sp[s+1]+stages[s+1].taps-1:vecs[i]+c*(n<<nstages);
+                    Upsample(stages[s],sp[s],dst,n<<s);
+                }
+                sp += nstages-1;
+            }
+    }
+
+    //! Downsample the oversampled vectors into n frames of the output vectors
+    void Down(t_sample *const *out,int n)
+    {
+        t_sample **sp = states+upstates;
+        for(int i = 0; i < nout; ++i)
+            for(int c = 0; c < chns[nin+i]; ++c,sp += 2*nstages) {
+                const t_sample *src = vecs[nin+i]+c*(n<<nstages);
+                for(int s = nstages-1; s >= 0; --s) {
+                    t_sample *dst = s?tmp:out[i]+c*n;
+                    Downsample(stages[s],sp[s],sp[nstages+s],src,dst,n<<s);
+                    src = dst;
+                }
+            }
+    }
+
+    //! oversampled input and output vectors
+    flext_dsp::t_signalvec *vecs;
+    //! delay of up- and downsampling in samples at the host rate
+    int latency;
+
+private:
+    enum { MAXSTAGES = 4 };
+
+    struct Stage {
+        //! taps of the polyphase branch (even)
+        int taps;
+        //! offset of the center tap in the downsampling (0 or 1)
+        int shift;
+        //! taps of the upsampling (including the gain of 2) and of the downsampling
+        t_sample *up,*down;
+    };
+
+    /*! \brief Half-band lowpass, the taps at odd offsets from the center
+        \note The center tap is 1/2, the others at even offsets are zero
+    */
+    static void Design(t_sample *up,t_sample *down,int t)
+    {
+        const double pi = 3.14159265358979323846,beta = 8;
+        double h[64],sum = 0;
+        FLEXT_ASSERT(t <= 64);
+        int k;
+        for(k = 0; k < t; ++k) {
+            const int d = 2*k+1-t;
+            const double x = (double)d/t;
+            sum += h[k] = sin(pi*d/2)/(pi*d)*Bessel0(beta*sqrt(1-x*x));
+        }
+        // unity gain at DC
+        for(k = 0; k < t; ++k) {
+            down[k] = (t_sample)(h[k]*0.5/sum);
+            up[k] = (t_sample)(h[k]/sum);
+        }
+    }
+
+    //! Modified Bessel function of the first kind, order 0 (for the Kaiser window)
+    static double Bessel0(double x)
+    {
+        double s = 1,u = 1;
+        for(int k = 1; k < 50 && u > s*1.e-12; ++k) {
+            const double v = x/(2*k);
+            s += u *= v*v;
+        }
+        return s;
+    }
+
+    /*! \brief Double the rate of n samples
+        \param b ... taps-1 samples of history followed by the input
+    */
+    void Upsample(const Stage &st,t_sample *b,t_sample *dst,int n)
+    {
+        const int t = st.taps;
+        flext::MulSamples(tmp,b,st.up[0],n);
+        for(int k = 1; k < t; ++k) flext::MacSamples(tmp,b+k,st.up[k],n);
+        // the other phase is the center tap
+        flext::InterleaveSamples(dst,b+t/2-1,0,2,n);
+        flext::InterleaveSamples(dst,tmp,1,2,n);
+        for(int i = 0; i < t-1; ++i) b[i] = b[n+i];
+    }
+
+    /*! \brief Halve the rate, n output samples from 2n input samples (dst may be src)
+        \param a,b ... taps-1 samples of history of the two phases
+    */
+    void Downsample(const Stage &st,t_sample *a,t_sample *b,const t_sample *src,t_sample *dst,int n)
+    {
+        const int t = st.taps,e = st.shift;
+        flext::DeinterleaveSamples(a+t-1,src,1-e,2,n);
+        flext::DeinterleaveSamples(b+t-1,src,e,2,n);
+        flext::MulSamples(dst,b+t/2-e,0.5f,n);
+        for(int k = 0; k < t; ++k) flext::MacSamples(dst,a+k,st.down[k],n);
+        for(int i = 0; i < t-1; ++i) a[i] = a[n+i],b[i] = b[n+i];
+    }
+
+    const int fac;
+    int nstages,nin,nout;
+    Stage stages[MAXSTAGES];
+    //! channels of the input and output vectors
+    int *chns;
+    //! per input channel the stage buffers of the upsampling, per output channel those of the two phases of the downsampling
+    t_sample **states;
+    int upstates;
+    t_sample *tmp,*buf;
+};
+
+#ifdef FLEXT_THREADS
+// === DSP islands ============================================
+
+//! Number of CPUs available
+inline int dsp_cpus()
+{
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (int)si.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+    const long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0?(int)n:1;
+#else
+    return 1;
+#endif
+}
+
+FLEXT_TEMPLATE
+struct IslandVars {
+    //! all islands, only deleted when the workers have stopped
+    static DspIsland *islands;
+    //! number of members of all islands
+    static int members;
+    //! configured number of worker threads (see flext_dsp::SetIslandThreads)
+    static int threads;
+    //! the running workers
+    static int running;
+    static flext::thr_params **params;
+    static flext::ThrCond *cond;
+    //! number of waiting workers
+    static lockfree::atomic_int<int> idle;
+    static volatile bool stop;
+};
+
+FLEXT_TEMPIMPL(DspIsland *IslandVars)::islands = NULL;
+FLEXT_TEMPIMPL(int IslandVars)::members = 0;
+FLEXT_TEMPIMPL(int IslandVars)::threads = 0;
+FLEXT_TEMPIMPL(int IslandVars)::running = 0;
+FLEXT_TEMPIMPL(flext::thr_params **IslandVars)::params = NULL;
+FLEXT_TEMPIMPL(flext::ThrCond *IslandVars)::cond = NULL;
+FLEXT_TEMPIMPL(lockfree::atomic_int<int> IslandVars)::idle;
+FLEXT_TEMPIMPL(volatile bool IslandVars)::stop = false;
+
+/*! \brief A group of flext_dsp objects processed concurrently
+    The members started with the current block have the positions base..wr-1 in jobs, 
+    the workers claim them by advancing rd. The positions are never reset, so that a late claim can't pick up a job of the next block.
+    \note Apart from claiming, islands are only used by the audio thread (or while DSP is being set up).
+*/
+class DspIsland
+{
+    typedef FLEXT_TEMPINST(IslandVars) Vars;
+
+public:
+    const t_symbol *name;
+    //! number of attached objects
+    int members;
+    //! the last member in the DSP chain, it joins the island
+    flext_dsp *last;
+
+    //! Attach an object to the island of the given name
+    static DspIsland *Attach(const t_symbol *n)
+    {
+        DspIsland *is = Vars::islands;
+        while(is && is->name != n) is = is->nxt;
+        if(!is) {
+            is = new DspIsland(n);
+            is->nxt = Vars::islands;
+            // workers may be walking the list
+            lockfree::memory_barrier();
+            Vars::islands = is;
+        }
+        ++is->members;
+        if(!Vars::members++) Start();
+        return is;
+    }
+
+    //! Detach a member, the workers stop with the last one
+    static void Detach(DspIsland *is,flext_dsp *d)
+    {
+        is->Join();
+        if(is->last == d) is->last = NULL;
+        --is->members;
+        if(!--Vars::members) Stop();
+    }
+
+    //! Register a member, called in DSP chain order
+    void Register(flext_dsp *d)
+    {
+        // no member may be running while the jobs are reallocated
+        Join();
+        if(members > jobmask+1) {
+            long sz = 1;
+            while(sz < members) sz <<= 1;
+            if(jobs) delete[] jobs;
+            jobs = new flext_dsp *[sz];
+            jobmask = sz-1;
+        }
+        last = d;
+    }
+
+    //! Start a member on the workers
+    void Post(flext_dsp *d)
+    {
+        // the island hasn't been joined (the last member didn't run)
+        if(UNLIKELY(wr-base > jobmask)) Join();
+        jobs[wr&jobmask] = d;
+        lockfree::memory_barrier();
+        ++wr;
+        Wake();
+    }
+
+    //! Wait for the started members writing to the vectors of d
+    void WaitFor(const flext_dsp *d)
+    {
+        for(long p = base; wr-p > 0; ++p) {
+            flext_dsp *j = jobs[p&jobmask];
+            if(j->islandstate != 2 && Overlaps(j,d)) Wait(j);
+        }
+    }
+
+    //! Wait for all members started with the current block
+    void Join()
+    {
+        long p;
+        for(p = base; wr-p > 0; ++p) Wait(jobs[p&jobmask]);
+        for(p = base; wr-p > 0; ++p) jobs[p&jobmask]->islandstate = 0;
+        base = wr;
+    }
+
+    static void Worker(flext::thr_params *)
+    {
+        while(!Vars::stop && !flext::ShouldExit()) {
+            flext_dsp *j = ClaimAny();
+            if(j) {
+                j->IslandRun();
+                continue;
+            }
+
+            ++Vars::idle;
+            lockfree::memory_barrier();
+            // check again, the audio thread may not have seen us waiting
+#if FLEXT_THREADS == FLEXT_THR_POSIX
+            Vars::cond->Lock();
+            // time out to check for ShouldExit
+            if(!Pending() && !Vars::stop) Vars::cond->TimedWaitLocked(0.01);
+            Vars::cond->Unlock();
+#else
+            if(!Pending() && !Vars::stop) Vars::cond->TimedWait(0.01);
+#endif
+            --Vars::idle;
+        }
+    }
+
+private:
+    DspIsland(const t_symbol *n): name(n),members(0),last(NULL),jobs(NULL),jobmask(-1),wr(0),rd(0),base(0),nxt(NULL) {}
+    ~DspIsland() { if(jobs) delete[] jobs; }
+
+    flext_dsp **jobs;
+    long jobmask;
+    //! positions of posted and claimed jobs
+    volatile long wr,rd;
+    //! first position of the current block
+    long base;
+    DspIsland *nxt;
+
+    //! Claim a started member (in any thread)
+    flext_dsp *Claim()
+    {
+        for(;;) {
+            const long r = rd;
+            if(wr-r <= 0) return NULL;
+            if(lockfree::CAS(&rd,r,r+1)) {
+                lockfree::memory_barrier();
+                return jobs[r&jobmask];
+            }
+        }
+    }
+
+    //! Wait until d has finished, processing other members meanwhile
+    void Wait(flext_dsp *d)
+    {
+        while(d->islandstate != 2) {
+            flext_dsp *j = Claim();
+            if(j)
+                j->IslandRun();
+            else
+                flext::ThrYield();
+        }
+        lockfree::memory_barrier();
+    }
+
+    //! Check whether j writes to a vector d reads or writes
+    static bool Overlaps(const flext_dsp *j,const flext_dsp *d)
+    {
+        for(int o = 0; o < j->islandout; ++o) {
+            const t_sample *v = j->islandhout[o];
+            int i;
+            for(i = 0; i < d->islandin; ++i)
+                if(d->islandhin[i] == v) return true;
+            for(i = 0; i < d->islandout; ++i)
+                if(d->islandhout[i] == v) return true;
+        }
+        return false;
+    }
+
+    static flext_dsp *ClaimAny()
+    {
+        for(DspIsland *is = Vars::islands; is; is = is->nxt) {
+            flext_dsp *j = is->Claim();
+            if(j) return j;
+        }
+        return NULL;
+    }
+
+    static bool Pending()
+    {
+        for(DspIsland *is = Vars::islands; is; is = is->nxt)
+            if(is->wr-is->rd > 0) return true;
+        return false;
+    }
+
+    //! Wake up a worker (if one is waiting)
+    static void Wake()
+    {
+        lockfree::memory_barrier();
+        if(Vars::idle) {
+#if FLEXT_THREADS == FLEXT_THR_POSIX
+            Vars::cond->Lock();
+            Vars::cond->Signal();
+            Vars::cond->Unlock();
+#else
+            // events remember the signal
+            Vars::cond->Signal();
+#endif
+        }
+    }
+
+    //! Launch the workers, the audio thread helps with the processing
+    static void Start()
+    {
+        int n = Vars::threads?Vars::threads:dsp_cpus()-1;
+        if(n < 1) n = 1;
+        Vars::cond = new flext::ThrCond;
+        Vars::stop = false;
+        Vars::params = new flext::thr_params *[n];
+        Vars::running = 0;
+        for(int i = 0; i < n; ++i) {
+            flext::thr_params *p = new flext::thr_params;
+            if(!flext::LaunchThread(Worker,p,flext::GetDSPThreadAttr())) {
+                delete p;
+                break;
+            }
+            Vars::params[Vars::running++] = p;
+        }
+        if(Vars::running < n)
+            error("flext - Could only launch %i of %i DSP island threads",Vars::running,n);
+    }
+
+    //! Stop the workers and delete the islands
+    static void Stop()
+    {
+        Vars::stop = true;
+        for(int i = 0; i < Vars::running; ++i) {
+#if FLEXT_THREADS == FLEXT_THR_POSIX
+            Vars::cond->Lock();
+            Vars::cond->Signal();
+            Vars::cond->Unlock();
+#else
+            Vars::cond->Signal();
+#endif
+        }
+        for(int i = 0; i < Vars::running; ++i) {
+            flext::StopThread(Worker,Vars::params[i],true);
+            delete Vars::params[i];
+        }
+        delete[] Vars::params; Vars::params = NULL;
+        Vars::running = 0;
+        delete Vars::cond; Vars::cond = NULL;
+
+        while(Vars::islands) {
+            DspIsland *is = Vars::islands;
+            Vars::islands = is->nxt;
+            delete is;
+        }
+    }
+};
+#endif
+
 // === flext_dsp ==============================================
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::Setup(t_classid id)
@@ -27,57 +684,452 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::Setup(t_classid id)
 //    add_method1(c,cb_enable,"enable",A_FLOAT);
     AddMethod(id,0,MakeSymbol("enable"),&cb_enable);
 #endif
+#ifdef FLEXT_DSPLOAD
+    AddMethod(id,0,"getdspload",cb_GetDspLoad);
+#endif
+#ifdef FLEXT_MEMSTATS
+    AddMethod(id,0,"getmemstats",cb_GetMemStats);
+#endif
+#ifdef FLEXT_THREADS
+    if(HasAttributes(id))
+        AddAttrib(id,MakeSymbol("island"),&cb_GetIsland,&cb_SetIsland);
+#endif
 }
 
 FLEXT_TEMPIMPL(FLEXT_CLASSDEF(flext_dsp))::FLEXT_CLASSDEF(flext_dsp)()
-    : srate(sys_getsr()),blksz(sys_getblksize())
-#if MSP64
-    , inVec(NULL), outVec(NULL)
-#else
-    , vecs(NULL)
+    :
+#if !MSP64
+    vecs(NULL),chns(NULL),vecsz(0),
 #endif
+    inchns(NULL),outchns(NULL),mcout(0),
 #if FLEXT_SYS != FLEXT_SYS_MAX
-    , dspon(true)
+    dspon(true),
+#endif
+    ftz(false),single(false)
+    , singlevecs(NULL),singlebuf(NULL)
+    , sleeptail(-1),sleepcnt(0),sleeping(false)
+    , subsz(0),hostsz(0),latency(0)
+    , subin(0),subout(0),subpos(0)
+    , subvecs(NULL),subbuf(NULL)
+    , overfac(1),over(NULL)
+    , evbuf(NULL),evmask(0),evwr(0),evrd(0),evwin(0)
+    , asyncblocks(0),asyncunder(0),asyncover(0)
+#ifdef FLEXT_THREADS
+    , async(NULL),asyncvecs(NULL),asyncbuf(NULL)
+    , asyncin(0),asyncout(0),asyncmax(0),asyncseq(0)
+    , asynchin(NULL),asynchout(NULL)
+    , asynccond(NULL),asyncparams(NULL)
+    , asyncwaiting(0),asyncstop(false)
+#endif
+    , batchon(false),batch(NULL)
+    , batchvecs(NULL),batchbuf(NULL)
+    , batchhin(NULL),batchhout(NULL)
+    , batchpending(false)
+    , islandname(NULL)
+#ifdef FLEXT_THREADS
+    , island(NULL)
+    , islandvecs(NULL),islandbuf(NULL)
+    , islandin(0),islandmax(0)
+    , islandhin(NULL),islandhout(NULL)
+    , islandout(0),islandsync(false),islandstate(0)
 #endif
-{}
+#ifdef FLEXT_DSPLOAD
+    , loadpos(0),loadcnt(0)
+#endif
+{
+    io.in = io.out = NULL;
+    io.nin = io.nout = 0;
+#ifdef FLEXT_MEMSTATS
+    memset(&memdsp,0,sizeof memdsp);
+#endif
+    io.frames = sys_getblksize();
+    io.srate = sys_getsr();
+    io.inplace = false;
+
+    // shared data created from now on is for this sample rate
+    InvalidateShared(io.srate);
+}
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::Exit()
 {
     flext_base::Exit();
+#ifdef FLEXT_THREADS
+    FreeAsync();
+    FreeIsland();
+#endif
+    FreeSingle();
 #if !MSP64
     if(vecs) delete[] vecs;
+    if(chns) delete[] chns;
 #endif
+    FreeBatch();
+    FreeOver();
+    FreeSub();
+    SetEvents(0);
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::SetEvents(int n)
+{
+    if(evbuf) { delete[] evbuf; evbuf = NULL; }
+    evmask = 0;
+    evwr = evrd = 0;
+    if(n > 0) {
+        // power of 2
+        long sz = 1;
+        while(sz < n) sz <<= 1;
+        evbuf = new EventSlot[sz];
+        for(long i = 0; i < sz; ++i) evbuf[i].seq = i;
+        evmask = sz-1;
+    }
 }
 
+/*! \remark Every slot carries a sequence number which tells whether it's free for writing (seq == write position)
+    or ready for reading (seq == read position+1), so that producers only need to agree on the write position.
+*/
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_dsp))::PostEventAt(double time,int id,float value,void *data)
+{
+    if(!evbuf) return false;
+
+    EventSlot *slot;
+    long pos;
+    for(;;) {
+        pos = evwr;
+        slot = evbuf+(pos&evmask);
+        const long d = slot->seq-pos;
+        if(d == 0) {
+            if(lockfree::CAS(&evwr,pos,pos+1)) break;
+        }
+        else if(d < 0)
+            // full
+            return false;
+    }
+
+    slot->ev.time = time;
+    slot->ev.offset = 0;
+    slot->ev.id = id;
+    slot->ev.value = value;
+    slot->ev.data = data;
+    lockfree::memory_barrier();
+    slot->seq = pos+1;
+    return true;
+}
+
+//! returns the offset of time in the current signal vector, or -1 if it lies later
+FLEXT_TEMPIMPL(int FLEXT_CLASSDEF(flext_dsp))::EventOffset(double time) const
+{
+    const int n = io.frames;
+    const double o = (time-evwin)*io.srate;
+    if(o >= n) return -1;
+    return o <= 0?0:(o < n-1?(int)o:n-1);
+}
+
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_dsp))::GetEvent(Event &ev)
+{
+    if(!evbuf) return false;
+    EventSlot &slot = evbuf[evrd&evmask];
+    if(slot.seq != evrd+1) return false;
+    lockfree::memory_barrier();
+
+    const int o = EventOffset(slot.ev.time);
+    if(o < 0) return false;
+
+    ev = slot.ev;
+    ev.offset = o;
+    lockfree::memory_barrier();
+    slot.seq = evrd+evmask+1;
+    ++evrd;
+    return true;
+}
+
+FLEXT_TEMPIMPL(int FLEXT_CLASSDEF(flext_dsp))::NextEvent() const
+{
+    if(evbuf) {
+        const EventSlot &slot = evbuf[evrd&evmask];
+        if(slot.seq == evrd+1) {
+            lockfree::memory_barrier();
+            const int o = EventOffset(slot.ev.time);
+            if(o >= 0) return o;
+        }
+    }
+    return io.frames;
+}
+
+//! Set the signal vectors and check whether they alias
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::SetIO(t_signalvec const *in,t_signalvec const *out)
+{
+    io.in = in,io.out = out;
+    bool inplace = false;
+    for(int i = 0; i < io.nin && !inplace; ++i)
+        for(int j = 0; j < io.nout; ++j)
+            if(in[i] == out[j]) { inplace = true; break; }
+    io.inplace = inplace;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::FreeSub()
+{
+    if(subvecs) { delete[] subvecs; subvecs = NULL; }
+    if(subbuf) { FreeAligned(subbuf); subbuf = NULL; }
+}
+
+/*! \brief Prepare block size adaption
+    \param in ... number of input vectors (including Pd's dummy inlet)
+    \param out ... number of output vectors
+    \note io.frames must hold the host block size
+*/
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::SetupSub(int in,int out)
+{
+    FreeSub();
+
+    hostsz = io.frames;
+    // the lookahead of asynchronous processing
+    latency = asyncblocks*hostsz;
+
+    if(!subsz || subsz == hostsz) return;
+
+    subin = in,subout = out;
+    subvecs = new t_signalvec[in+out];
+    subpos = 0;
+
+    if(hostsz%subsz) {
+        // FIFOs for input and output
+        latency += subsz;
+        subbuf = NewAligned<t_sample>((in+out)*subsz);
+        ZeroSamples(subbuf,(in+out)*subsz);
+        for(int i = 0; i < in+out; ++i) subvecs[i] = subbuf+i*subsz;
+    }
+    // else pieces of the host vectors
+
+    io.frames = subsz;
+}
+
+//! Call CbSignal with the fixed block size, n is the current number of host frames
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::SubSignal(int n)
+{
+    // the host vectors
+    const DspIO hio = io;
+    t_signalvec const *const hin = hio.in,*const hout = hio.out;
+    io.in = subvecs,io.out = subvecs+subin;
+    // the buffers are separate
+    if(subbuf) io.inplace = false;
+
+    const int sz = subsz;
+    io.frames = sz;
+    // start time of the host block
+    const double tm = evwin;
+    int i;
+
+    if(!subbuf) {
+        int o = 0;
+        for(; o+sz <= n; o += sz) {
+            for(i = 0; i < subin; ++i) subvecs[i] = hin[i]+o;
+            for(i = 0; i < subout; ++i) subvecs[subin+i] = hout[i]+o;
+            evwin = tm+o/io.srate;
+            CallSignal();
+        }
+        // only happens if the host block size changes (Max)
+        if(UNLIKELY(o < n))
+            for(i = 0; i < subout; ++i) ZeroSamples(hout[i]+o,n-o);
+    }
+    else {
+        for(int o = 0; o < n; ) {
+            const int c = n-o < sz-subpos?n-o:sz-subpos;
+            // input first, Pd may use the same vectors for input and output
+            for(i = 0; i < subin; ++i) CopySamples(subvecs[i]+subpos,hin[i]+o,c);
+            for(i = 0; i < subout; ++i) CopySamples(hout[i]+o,subvecs[subin+i]+subpos,c);
+            o += c;
+            if((subpos += c) == sz) {
+                // the buffered block ends at the current position
+                evwin = tm+(o-sz)/io.srate;
+                CallSignal();
+                subpos = 0;
+            }
+        }
+    }
+
+    io = hio;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::FreeOver()
+{
+    if(over) { delete over; over = NULL; }
+}
+
+/*! \brief Prepare oversampling
+    \note Called after SetupSub, io.frames must hold the block size of CbSignal
+*/
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::SetupOver()
+{
+    FreeOver();
+    if(overfac <= 1) return;
+
+    over = new DspOver(overfac,io.nin,inchns,io.nout,outchns,io.frames);
+    latency += over->latency;
+}
+
+//! CbDsp with the oversampled block size and sample rate
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_dsp))::OverDsp()
+{
+    io.frames *= overfac,io.srate *= overfac;
+    const bool ret = CbDsp();
+    io.frames /= overfac,io.srate /= overfac;
+    return ret;
+}
+
+//! Call CbSignal with the upsampled input, downsample the output
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::OverSignal()
+{
+    const DspIO hio = io;
+    // input first, Pd may use the same vectors for input and output
+    over->Up(hio.in,hio.frames);
+
+    io.in = over->vecs,io.out = over->vecs+io.nin;
+    io.inplace = false;
+    io.frames *= overfac,io.srate *= overfac;
+    CbSignal();
+    io = hio;
+
+    over->Down(hio.out,hio.frames);
+}
+
+
+/*! \brief Join the batch of the class, if requested by SetBatch
+    \note Called in DSP chain order, after SetIO and SetupSub
+*/
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::SetupBatch()
+{
+    FreeBatch();
+    if(!batchon || subvecs || over || asyncblocks || islandname || inchns) return;
+
+    const int ch = io.nin+io.nout,n = io.frames;
+    batchvecs = new t_signalvec[ch];
+    batchbuf = ch?NewAligned<t_sample>(ch*n):NULL;
+    // the first block outputs silence
+    if(batchbuf) ZeroSamples(batchbuf,ch*n);
+    for(int i = 0; i < ch; ++i) batchvecs[i] = batchbuf+i*n;
+
+    batchhin = io.in,batchhout = io.out;
+    io.in = batchvecs,io.out = batchvecs+io.nin;
+    io.inplace = false;
+    latency += n;
+
+    batchpending = false;
+    batch = DspBatch::Attach(this);
+}
+
+//! Leave the batch
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::FreeBatch()
+{
+    if(!batch) return;
+
+    DspBatch::Detach(batch,this);
+    batch = NULL;
+    batchpending = false;
+
+    if(batchvecs) { delete[] batchvecs; batchvecs = NULL; }
+    if(batchbuf) { FreeAligned(batchbuf); batchbuf = NULL; }
+}
+
+//! Exchange the vectors with the host, the batch is processed later
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::BatchSignal()
+{
+    const int n = io.frames;
+    int i;
+    // input first, Pd may use the same vectors for input and output
+    for(i = 0; i < io.nin; ++i) CopySamples(batchvecs[i],batchhin[i],n);
+    for(i = 0; i < io.nout; ++i) CopySamples(batchhout[i],batchvecs[io.nin+i],n);
+    batchpending = true;
+}
+
+//! Process the batch members (called for the first of them)
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::BatchRun(FLEXT_CLASSDEF(flext_dsp) *const *objs,int n)
+{
+    FLEXT_TRACE_SCOPE("dsp","batch",thisName());
+    const unsigned long fp = ftz?dsp_flushon():0;
+    flext_base::indsp = true;
+    CbSignalBatch(objs,n);
+    flext_base::indsp = false;
+    if(ftz) dsp_flushoff(fp);
+    for(int i = 0; i < n; ++i) objs[i]->scratch.Reset();
+}
 
 #if MSP64
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::dspmeth64(flext_hdr *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam)
 {
     flext_dsp *obj = (flext_dsp *)userparam;
     
-    obj->blksz = sampleframes;
-    obj->inVec = ins;
-    obj->outVec = outs;
-
-    if(!obj->thisHdr()->z_disabled) {
-        flext_base::indsp = true;
-        obj->CbSignal();
-        flext_base::indsp = false;
+#ifdef FLEXT_THREADS
+    if(obj->async) {
+        // io belongs to the worker thread
+        obj->hostsz = sampleframes;
+        obj->asynchin = ins;
+        obj->asynchout = outs;
     }
+    else
+#endif
+    {
+        if(obj->subvecs)
+            obj->hostsz = sampleframes;
+        else
+            obj->io.frames = sampleframes;
+        obj->SetIO(ins,outs);
+#ifdef FLEXT_THREADS
+        if(obj->island) {
+            // the island member processes copies of the input
+            obj->islandhin = ins;
+            obj->islandhout = outs;
+            obj->io.in = obj->islandvecs;
+            obj->io.inplace = false;
+        }
+#endif
+    }
+
+    if(!obj->thisHdr()->z_disabled)
+        obj->DoSignal();
+#ifdef FLEXT_THREADS
+    if(UNLIKELY(obj->island) && obj->island->last == obj)
+        obj->island->Join();
+#endif
 }
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::SetupDsp64(flext_hdr *x, t_object *dsp64, short *count, double samplerate, long maxvectorsize, long flags)
 {
+#ifdef FLEXT_THREADS
+    // the worker thread must not use io any more
+    FreeAsync();
+#endif
+
     // store current dsp parameters
-    srate = samplerate;
-    // overlap = sp[0]->s_sr/srate;  // currently not used/exposed
-    blksz = maxvectorsize; // will be overwritten in dspmeth64 anyway...
+    io.srate = samplerate;
+    // overlap = sp[0]->s_sr/io.srate;  // currently not used/exposed
+    InvalidateShared(io.srate);
+    io.frames = maxvectorsize; // will be overwritten in dspmeth64 anyway...
+    io.nin = CntInSig();
+    io.nout = CntOutSig();
+
+    ftz = GetFlushDenormals(thisClassId()) && dsp_canflush();
+    single = GetSinglePrecision(thisClassId());
+
+    SetupSub(CntInSig(),CntOutSig());
+    SetupOver();
+    SetupSingle();
+    sleepcnt = 0,sleeping = false;
+
+    // grow the scratch memory to what the last blocks needed
+    scratch.Reserve();
 
     // with the following call derived classes can do their eventual DSP setup
-    if(CbDsp()) {
+    if(OverDsp()) {
+#ifdef FLEXT_THREADS
+        SetupAsync(CntInSig(),CntOutSig());
+        SetupIsland(CntInSig(),CntOutSig());
+#endif
         // set the DSP function
         dsp_add64(dsp64, (t_object *)&x->obj, (t_dspmethod)dspmeth64, 0, this);
     }
+#ifdef FLEXT_THREADS
+    else
+        FreeIsland();
+#endif
 }
 
 #else
@@ -91,16 +1143,25 @@ FLEXT_TEMPIMPL(t_int *FLEXT_CLASSDEF(flext_dsp))::dspmeth(t_int *w)
 #else
     if(LIKELY(obj->dspon))
 #endif
-    {
-        flext_base::indsp = true;
-        obj->CbSignal(); 
-        flext_base::indsp = false;
-    }
+        obj->DoSignal();
+#ifdef FLEXT_THREADS
+    if(UNLIKELY(obj->island) && obj->island->last == obj)
+        // all members of the island have been started
+        obj->island->Join();
+#endif
+    if(UNLIKELY(obj->batch) && obj->batch->Last() == obj)
+        // all members of the batch have copied their input
+        obj->batch->Run();
     return w+2;
 }
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::SetupDsp(t_signal **sp)
 { 
+#ifdef FLEXT_THREADS
+    // the worker thread must not use io any more
+    FreeAsync();
+#endif
+
     int i;
     int in = CntInSig();
     int out = CntOutSig();
@@ -110,29 +1171,593 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::SetupDsp(t_signal **sp)
 #endif
 
     // store current dsp parameters
-    srate = sys_getsr();
-    // overlap = sp[0]->s_sr/srate;  // currently not used/exposed
+    io.srate = sys_getsr();
+    // overlap = sp[0]->s_sr/io.srate;  // currently not used/exposed
+    InvalidateShared(io.srate);
     
-    blksz = sp[0]->s_n;  // is this guaranteed to be the same as sys_getblksize() ?
+    io.frames = sp[0]->s_n;  // is this guaranteed to be the same as sys_getblksize() ?
+
+    ftz = GetFlushDenormals(thisClassId()) && dsp_canflush();
+    single = GetSinglePrecision(thisClassId());
 
     // store in and out signal vectors
 
-    if((in+out) && !vecs)
-        vecs = new t_signalvec[in+out];
+    if(in+out > vecsz) {
+        // number of signals has changed
+        if(vecs) delete[] vecs;
+        if(chns) delete[] chns;
+        vecs = new t_signalvec[vecsz = in+out];
+        chns = new int[vecsz];
+    }
+
+    for(i = 0; i < in+out; ++i) chns[i] = 1;
+
+#ifdef CLASS_MULTICHANNEL
+    // block size adaption, asynchronous and island processing handle single channels
+    const bool mc = GetMultichannel(thisClassId()) && !subsz && !asyncblocks && !islandname;
+    int mcn = 1;
+    if(mc) {
+        for(i = 0; i < in; ++i)
+            if((chns[i] = sp[i]->s_nchans) > mcn) mcn = chns[i];
+        if(mcout) mcn = mcout;
+    }
+    // the outputs of a multichannel class are allocated by the object
+    for(i = 0; i < out; ++i)
+        signal_setmultiout(&sp[in+i],chns[in+i] = mcn);
+#else
+    const bool mc = false;
+#endif
+    inchns = mc?chns:NULL;
+    outchns = mc?chns+in:NULL;
 
+    // multichannel inputs start with the first channel
     for(i = 0; i < in; ++i) 
         vecs[i] = sp[i]->s_vec;
     for(i = 0; i < out; ++i) 
         vecs[in+i] = sp[in+i]->s_vec;
 
+    io.nin = CntInSig();
+    io.nout = out;
+    SetIO(vecs,vecs+in);
+
+    SetupSub(in,out);
+    SetupOver();
+    SetupSingle();
+    sleepcnt = 0,sleeping = false;
+
+    // grow the scratch memory to what the last blocks needed
+    scratch.Reserve();
+
     // with the following call derived classes can do their eventual DSP setup
-    if(CbDsp()) {
+    if(OverDsp()) {
+#ifdef FLEXT_THREADS
+        SetupAsync(in,out);
+        SetupIsland(in,out);
+#endif
+        SetupBatch();
         // set the DSP function
         dsp_add((t_dspmethod)dspmeth, 1, this);
     }
+    else {
+#ifdef FLEXT_THREADS
+        FreeIsland();
+#endif
+        FreeBatch();
+    }
+}
+#endif
+
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::DoSignal()
+{
+    flext_base::indsp = true;
+    if(evbuf
+#ifdef FLEXT_THREADS
+        // with async the worker thread takes the time from the block
+        && !async
+#endif
+    ) 
+        // the host block ends at the current time
+        evwin = GetTime()-(subvecs?hostsz:io.frames)/io.srate;
+#ifdef FLEXT_DSPLOAD
+    const double t0 = dsp_usecs();
+#endif
+#ifdef FLEXT_THREADS
+    if(UNLIKELY(async))
+        // processing is done by the worker thread
+        AsyncSignal();
+    else if(UNLIKELY(island))
+        IslandSignal();
+    else
+#endif
+    if(UNLIKELY(batch))
+        // processed by the last member
+        BatchSignal();
+    else if(UNLIKELY(sleeptail >= 0) && Silent(subvecs?hostsz:io.frames)) {
+        // asleep, CbSignal would only produce silence
+        for(int i = 0; i < io.nout; ++i) ZeroSamples(io.out[i],(subvecs?hostsz:io.frames)*OutSigChannels(i));
+    }
+    else if(UNLIKELY(ftz)) {
+        const unsigned long fp = dsp_flushon();
+        if(UNLIKELY(subvecs)) SubSignal(hostsz); else CallSignal();
+        dsp_flushoff(fp);
+    }
+    else if(UNLIKELY(subvecs))
+        SubSignal(hostsz);
+    else
+        CallSignal();
+#ifdef FLEXT_DSPLOAD
+    loadtimes[loadpos] = (float)(dsp_usecs()-t0);
+    if(++loadpos == FLEXT_DSPLOAD) loadpos = 0;
+    if(loadcnt < FLEXT_DSPLOAD) ++loadcnt;
+#endif
+    flext_base::indsp = false;
+}
+
+/*! \brief Check the signal inputs for silence (see SetSleep)
+    \param n ... number of host frames
+    \return true if processing can be skipped
+*/
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_dsp))::Silent(int n)
+{
+    // pending events need processing
+    bool silent = io.nin > 0 && !(evbuf && evbuf[evrd&evmask].seq == evrd+1);
+    for(int i = 0; silent && i < io.nin; ++i) {
+        t_sample mn,mx;
+        MinMaxSamples(io.in[i],n*InSigChannels(i),mn,mx);
+        silent = mn == 0 && mx == 0;
+    }
+
+    if(!silent)
+        sleepcnt = 0;
+    else if(sleepcnt < (long)sleeptail+latency)
+        // still in the tail
+        sleepcnt += n;
+    else
+        return sleeping = true;
+    return sleeping = false;
+}
+
+#ifdef FLEXT_THREADS
+/*! \brief Start asynchronous processing, if requested by SetAsync
+    \param in ... number of input vectors (including Pd's dummy inlet)
+    \param out ... number of output vectors
+    \note hostsz must hold the (maximum) host block size
+*/
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::SetupAsync(int in,int out)
+{
+    FreeAsync();
+    if(!asyncblocks) return;
+
+    // one more block than the lookahead, the audio thread writes to the free one
+    const int k = asyncblocks+1,ch = in+out;
+    asyncin = in,asyncout = out;
+    asyncmax = hostsz;
+    asyncseq = 0;
+
+    async = new AsyncBlock[k];
+    asyncvecs = new t_signalvec[k*ch];
+    asyncbuf = NewAligned<t_sample>(k*ch*asyncmax);
+    ZeroSamples(asyncbuf,k*ch*asyncmax);
+    for(int b = 0; b < k; ++b) {
+        AsyncBlock &blk = async[b];
+        blk.vecs = asyncvecs+b*ch;
+        for(int i = 0; i < ch; ++i) blk.vecs[i] = asyncbuf+(b*ch+i)*asyncmax;
+        blk.frames = 0;
+        blk.seq = -1;
+        blk.state = 0;
+    }
+
+#if !MSP64
+    // the worker uses io for the blocks
+    asynchin = io.in,asynchout = io.out;
+#endif
+
+    asynccond = new ThrCond;
+    asyncwaiting = 0;
+    asyncstop = false;
+    asyncparams = new thr_params;
+    asyncparams->cl = this;
+
+    if(!LaunchThread(AsyncWorker,asyncparams,GetDSPThreadAttr())) {
+        error("%s - Could not launch DSP thread, processing synchronously",thisName());
+        FreeAsync();
+        latency -= asyncblocks*hostsz;
+    }
+}
+
+//! Stop the worker thread and free the blocks
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::FreeAsync()
+{
+    if(!async) return;
+
+    asyncstop = true;
+    AsyncWake();
+    StopThread(AsyncWorker,asyncparams,true);
+
+    delete asyncparams; asyncparams = NULL;
+    delete asynccond; asynccond = NULL;
+    delete[] async; async = NULL;
+    delete[] asyncvecs; asyncvecs = NULL;
+    FreeAligned(asyncbuf); asyncbuf = NULL;
+}
+
+//! Wake up the worker thread (if it's waiting)
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::AsyncWake()
+{
+    lockfree::memory_barrier();
+    if(asyncwaiting) {
+#if FLEXT_THREADS == FLEXT_THR_POSIX
+        asynccond->Lock();
+        asyncwaiting = 0;
+        asynccond->Signal();
+        asynccond->Unlock();
+#else
+        // events remember the signal
+        asyncwaiting = 0;
+        asynccond->Signal();
+#endif
+    }
+}
+
+/*! \brief Hand over the input to the worker thread and collect the output of asyncblocks blocks before
+    \note Called in the audio thread, with the host vectors in asynchin/asynchout and the frames in hostsz
+*/
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::AsyncSignal()
+{
+    const int k = asyncblocks+1,n = hostsz;
+    const long s = asyncseq++;
+    int i;
+
+    // input first, Pd may use the same vectors for input and output
+    AsyncBlock &bi = async[s%k];
+    if(bi.state == 2 || (bi.state == 1 && !lockfree::CAS(&bi.state,1L,0L)))
+        // the worker is still busy with that block
+        ++asyncover;
+    else {
+        const int c = n < asyncmax?n:asyncmax;
+        for(i = 0; i < asyncin; ++i) CopySamples(bi.vecs[i],asynchin[i],c);
+        bi.frames = c;
+        bi.seq = s;
+        if(evbuf) bi.time = GetTime()-n/io.srate;
+        lockfree::memory_barrier();
+        bi.state = 1;
+        AsyncWake();
+    }
+
+    // this is the block following the one just written
+    AsyncBlock &bo = async[(s+1)%k];
+    const long so = s-asyncblocks;
+    if(bo.state == 3 && bo.seq == so) {
+        lockfree::memory_barrier();
+        const int c = bo.frames;
+        for(i = 0; i < asyncout; ++i) {
+            CopySamples(asynchout[i],bo.vecs[asyncin+i],c);
+            if(UNLIKELY(c < n)) ZeroSamples(asynchout[i]+c,n-c);
+        }
+        bo.state = 0;
+    }
+    else {
+        // not ready in time (or not even started)
+        if(so >= 0) ++asyncunder;
+        if(bo.state == 1) lockfree::CAS(&bo.state,1L,0L);
+        for(i = 0; i < asyncout; ++i) ZeroSamples(asynchout[i],n);
+    }
+}
+
+//! Get the oldest block with input ready
+FLEXT_TEMPIMPL(FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext_dsp))::AsyncBlock *FLEXT_CLASSDEF(flext_dsp))::AsyncNext() const
+{
+    AsyncBlock *nxt = NULL;
+    for(int b = 0; b <= asyncblocks; ++b) {
+        AsyncBlock &blk = async[b];
+        if(blk.state == 1 && (!nxt || blk.seq < nxt->seq)) nxt = &blk;
+    }
+    return nxt;
+}
+
+//! The worker thread loop
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::AsyncWork()
+{
+    // the floating point state is per thread
+    const unsigned long fp = ftz?dsp_flushon():0;
+
+    while(!asyncstop && !ShouldExit()) {
+        AsyncBlock *blk = AsyncNext();
+        if(!blk) {
+            asyncwaiting = 1;
+            lockfree::memory_barrier();
+            // check again, the audio thread may not have seen us waiting
+            if(!AsyncNext() && !asyncstop) {
+#if FLEXT_THREADS == FLEXT_THR_POSIX
+                asynccond->Lock();
+                // time out to check for ShouldExit
+                if(asyncwaiting) asynccond->TimedWaitLocked(0.01);
+                asynccond->Unlock();
+#else
+                asynccond->TimedWait(0.01);
+#endif
+            }
+            asyncwaiting = 0;
+            continue;
+        }
+
+        // the audio thread may have taken the block back
+        if(!lockfree::CAS(&blk->state,1L,2L)) continue;
+
+        io.in = blk->vecs,io.out = blk->vecs+asyncin;
+        io.inplace = false;
+        evwin = blk->time;
+        flext_base::indsp = true;
+        if(subvecs)
+            SubSignal(blk->frames);
+        else {
+            io.frames = blk->frames;
+            CallSignal();
+        }
+        flext_base::indsp = false;
+
+        lockfree::memory_barrier();
+        blk->state = 3;
+    }
+
+    if(ftz) dsp_flushoff(fp);
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::AsyncWorker(thr_params *p)
+{
+    static_cast<flext_dsp *>(p->cl)->AsyncWork();
+}
+
+/*! \brief Join the DSP island set with SetIsland
+    \param in ... number of input vectors (including Pd's dummy inlet)
+    \param out ... number of output vectors
+    \note Called in DSP chain order, hostsz must hold the (maximum) host block size
+*/
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::SetupIsland(int in,int out)
+{
+    if(!islandname || async) {
+        FreeIsland();
+        return;
+    }
+
+    if(island && island->name != islandname) FreeIsland();
+    if(!island) island = DspIsland::Attach(islandname);
+
+    // the input is copied, Pd reuses the vectors while the member may still be running
+    if(in != islandin || hostsz != islandmax) {
+        if(islandvecs) delete[] islandvecs;
+        if(islandbuf) FreeAligned(islandbuf);
+        islandin = in,islandmax = hostsz;
+        islandvecs = new t_signalvec[in];
+        islandbuf = in?NewAligned<t_sample>(in*islandmax):NULL;
+        for(int i = 0; i < in; ++i) islandvecs[i] = islandbuf+i*islandmax;
+    }
+    islandout = out;
+    islandstate = 0;
+
+#if !MSP64
+    islandhin = io.in,islandhout = io.out;
+    io.in = islandvecs;
+    io.inplace = false;
+#endif
+
+#if FLEXT_SYS == FLEXT_SYS_PD
+    /* The island is only joined by its last member, so the outputs of a running member
+       must only be read by other members (which wait for it).
+       The vectors of unconnected outlets are reused right away.
+    */
+    islandsync = false;
+    t_object *o = thisHdr();
+    const int n = obj_noutlets(o);
+    for(int i = 0; i < n && !islandsync; ++i) {
+        if(!obj_issignaloutlet(o,i)) continue;
+        t_outlet *op;
+        t_outconnect *c = obj_starttraverseoutlet(o,&op,i);
+        if(!c) islandsync = true;
+        while(c && !islandsync) {
+            t_object *dst;
+            t_inlet *ip;
+            int which;
+            c = obj_nexttraverseoutlet(c,&dst,&ip,&which);
+            if(!IslandPeer(dst,which)) islandsync = true;
+        }
+    }
+#else
+    // the connections can't be checked, the objects reading the outputs may run right after us
+    islandsync = true;
+#endif
+
+    island->Register(this);
+}
+
+#if FLEXT_SYS == FLEXT_SYS_PD
+/*! \brief Check whether inlet n of o is only fed by us and o is a (synchronous) member of our island
+    \note Pd sums the signals of an inlet with several connections in between the members
+*/
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_dsp))::IslandPeer(t_object *o,int n) const
+{
+    if(!o) return false;
+    const t_class *cl = *(t_pd *)o;
+    t_classid id = FindName(MakeSymbol(class_getname(cl)));
+    // classes of other flext instances are not found
+    if(!id || getClass(id) != cl || !IsDSP(id)) return false;
+    const flext_dsp *d = static_cast<const flext_dsp *>(((flext_hdr *)o)->data);
+    if(!d || d->islandname != islandname || d->asyncblocks) return false;
+
+    int src = 0;
+    t_linetraverser t;
+    linetraverser_start(&t,thisCanvas());
+    while(linetraverser_next(&t))
+        if(t.tr_ob2 == o && t.tr_inno == n && obj_issignaloutlet(t.tr_ob,t.tr_outno)) ++src;
+    return src == 1;
 }
 #endif
 
+//! Leave the DSP island
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::FreeIsland()
+{
+    if(!island) return;
+
+    DspIsland::Detach(island,this);
+    island = NULL;
+    islandstate = 0;
+
+    if(islandvecs) { delete[] islandvecs; islandvecs = NULL; }
+    if(islandbuf) { FreeAligned(islandbuf); islandbuf = NULL; }
+    islandin = islandmax = 0;
+}
+
+/*! \brief Start processing of the island member
+    \note Called in the audio thread, with the host vectors in islandhin/islandhout
+*/
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::IslandSignal()
+{
+    DspIsland *is = island;
+    // the island hasn't been joined since our last block
+    if(UNLIKELY(islandstate)) is->Join();
+
+    // members still writing to our vectors
+    is->WaitFor(this);
+
+    const int n = subvecs?hostsz:io.frames;
+    const int c = n < islandmax?n:islandmax;
+    for(int i = 0; i < islandin; ++i) CopySamples(islandvecs[i],islandhin[i],c);
+
+    if(islandsync || is->last == this) {
+        // in place, the last member joins the island afterwards
+        const unsigned long fp = ftz?dsp_flushon():0;
+        if(subvecs) SubSignal(hostsz); else CallSignal();
+        if(ftz) dsp_flushoff(fp);
+    }
+    else {
+        islandstate = 1;
+        is->Post(this);
+    }
+}
+
+//! Process the island member (in a worker or the audio thread)
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::IslandRun()
+{
+    // the floating point state is per thread, as is the DSP flag
+    const unsigned long fp = ftz?dsp_flushon():0;
+    const bool dsp = flext_base::indsp;
+    flext_base::indsp = true;
+    if(subvecs) SubSignal(hostsz); else CallSignal();
+    flext_base::indsp = dsp;
+    if(ftz) dsp_flushoff(fp);
+
+    lockfree::memory_barrier();
+    islandstate = 2;
+}
+
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_dsp))::cb_GetIsland(flext_base *c,const t_symbol *&s)
+{
+    const t_symbol *n = static_cast<flext_dsp *>(c)->islandname;
+    s = n?n:sym__;
+    return true;
+}
+
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_dsp))::cb_SetIsland(flext_base *c,const t_symbol *&s)
+{
+    static_cast<flext_dsp *>(c)->SetIsland(s);
+    return true;
+}
+#endif
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::SetIslandThreads(int n)
+{
+#ifdef FLEXT_THREADS
+    FLEXT_TEMPINST(IslandVars)::threads = n > 0?n:0;
+#endif
+}
+
+#ifdef FLEXT_DSPLOAD
+/*! \brief Report the DSP load of the object
+    Outputs "dspload min mean max load h0 ... h11" to the attribute outlet (or the console):
+    durations in microseconds over the measured window, load in % of the block period,
+    and a histogram of the durations in the bins [0,1),[1,2),[2,4),...,[1024,inf) microseconds
+*/
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_dsp))::cb_GetDspLoad(flext_base *c,int argc,const t_atom *argv)
+{
+    if(argc) return false;
+
+    const flext_dsp *d = static_cast<const flext_dsp *>(c);
+    const int n = d->loadcnt;
+
+    float mn = 0,mx = 0;
+    double sum = 0;
+    int hist[12];
+    for(int i = 0; i < 12; ++i) hist[i] = 0;
+
+    for(int i = 0; i < n; ++i) {
+        const float t = d->loadtimes[i];
+        if(!i || t < mn) mn = t;
+        if(t > mx) mx = t;
+        sum += t;
+
+        int b = 0;
+        for(float l = 1; b < 11 && t >= l; l *= 2) ++b;
+        ++hist[b];
+    }
+
+    const double mean = n?sum/n:0;
+    // block period in microseconds
+    const double period = d->io.srate?d->io.frames*1.e6/d->io.srate:0;
+
+    AtomListStatic<16> la(16);
+    SetFloat(la[0],mn);
+    SetFloat(la[1],(float)mean);
+    SetFloat(la[2],mx);
+    SetFloat(la[3],period?(float)(mean*100./period):0);
+    for(int i = 0; i < 12; ++i) SetInt(la[4+i],hist[i]);
+
+    static const t_symbol *sym_dspload = MakeSymbol("dspload");
+    if(c->HasAttributes())
+        c->ToOutAnything(c->GetOutAttr(),sym_dspload,la.Count(),la.Atoms());
+    else
+        post("%s - dspload: min=%g mean=%g max=%g us, load=%g%%",c->thisName(),mn,mean,mx,GetFloat(la[3]));
+    return true;
+}
+#endif
+
+#ifdef FLEXT_MEMSTATS
+/*! \brief Report the allocations in DSP time
+    Outputs "memstats allocs frees allocbytes freebytes live dspallocs" to the attribute outlet (or the console):
+    the allocations in the CbSignal of the object, the bytes currently allocated
+    and the number of DSP time allocations of all objects.
+    Posted to the console, the statistics of each thread are listed as well.
+*/
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_dsp))::cb_GetMemStats(flext_base *c,int argc,const t_atom *argv)
+{
+    if(argc) return false;
+
+    const MemCounter &m = static_cast<const flext_dsp *>(c)->memdsp;
+    MemStats st;
+    GetMemStats(st);
+
+    t_atom at[6];
+    SetInt(at[0],(int)m.allocs);
+    SetInt(at[1],(int)m.frees);
+    SetFloat(at[2],(float)m.allocbytes);
+    SetFloat(at[3],(float)m.freebytes);
+    SetFloat(at[4],(float)st.live);
+    SetInt(at[5],(int)st.dsp.allocs);
+
+    static const t_symbol *sym_memstats = MakeSymbol("memstats");
+    if(c->HasAttributes())
+        c->ToOutAnything(c->GetOutAttr(),sym_memstats,6,at);
+    else {
+        post("%s - memstats: %lu allocs (%lu bytes), %lu frees (%lu bytes) in DSP, %lu bytes live",c->thisName(),
+            m.allocs,(unsigned long)m.allocbytes,m.frees,(unsigned long)m.freebytes,(unsigned long)st.live);
+        MemStats ts;
+        for(int i = 0; GetMemStats(ts,i); ++i)
+            post("  thread %i%s: %lu allocs, %lu frees, %lu allocs in DSP",i,ts.system?" (system)":"",
+                ts.all.allocs,ts.all.frees,ts.dsp.allocs);
+    }
+    return true;
+}
+#endif
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::m_dsp(int /*n*/,t_signalvec const * /*insigs*/,t_signalvec const * /*outsigs*/) {}
 
@@ -152,8 +1777,71 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::m_signal(int n,t_sample *const *
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::CbSignal()
 { 
-	// invoke legacy method
-	m_signal(Blocksize(),InSig(),OutSig()); 
+    if(UNLIKELY(single))
+        SingleSignal();
+    else
+        // invoke legacy method
+        m_signal(Blocksize(),InSig(),OutSig()); 
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::FreeSingle()
+{
+    if(singlevecs) { delete[] singlevecs; singlevecs = NULL; }
+    if(singlebuf) { FreeAligned(singlebuf); singlebuf = NULL; }
+}
+
+/*! \brief Prepare the vectors of single precision processing
+    \note Called after SetupSub and SetupOver, io.frames must hold the block size of CbSignal
+*/
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::SetupSingle()
+{
+    FreeSingle();
+#if !MSP64
+    // Pd in single precision: CbSignalSingle works on the host vectors
+    if(sizeof(t_sample) == sizeof(float)) return;
+#endif
+    if(!single) return;
+
+    const int frames = io.frames*overfac;
+    int ch = 0,i;
+    for(i = 0; i < io.nin; ++i) ch += InSigChannels(i);
+    for(i = 0; i < io.nout; ++i) ch += OutSigChannels(i);
+
+    singlevecs = new float *[io.nin+io.nout];
+    singlebuf = ch?NewAligned<float>(ch*frames):NULL;
+    float *p = singlebuf;
+    for(i = 0; i < io.nin; ++i) singlevecs[i] = p,p += InSigChannels(i)*frames;
+    for(i = 0; i < io.nout; ++i) singlevecs[io.nin+i] = p,p += OutSigChannels(i)*frames;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::CbSignalSingle()
+{
+    for(int i = 0; i < CntOutSig(); ++i) ZeroSamples(OutSigSingle(i),io.frames*OutSigChannels(i));
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::SingleSignal()
+{
+#if MSP64
+    // input first, Max may use the same vectors for input and output
+    for(int i = 0; i < io.nin; ++i) NarrowSamples(singlevecs[i],io.in[i],io.frames*InSigChannels(i));
+    CbSignalSingle();
+    for(int i = 0; i < io.nout; ++i) WidenSamples(io.out[i],singlevecs[io.nin+i],io.frames*OutSigChannels(i));
+#else
+    if(sizeof(t_sample) == sizeof(float))
+        // the host vectors are single precision already
+        CbSignalSingle();
+    else {
+        // the casts only serve compilation, t_sample is double here
+        for(int i = 0; i < io.nin; ++i) NarrowSamples(singlevecs[i],reinterpret_cast<const double *>(io.in[i]),io.frames*InSigChannels(i));
+        CbSignalSingle();
+        for(int i = 0; i < io.nout; ++i) WidenSamples(reinterpret_cast<double *>(io.out[i]),singlevecs[io.nin+i],io.frames*OutSigChannels(i));
+    }
+#endif
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_dsp))::CbSignalBatch(FLEXT_CLASSDEF(flext_dsp) *const *objs,int n)
+{
+    for(int i = 0; i < n; ++i) objs[i]->CallSignal();
 }
 
 #if FLEXT_SYS == FLEXT_SYS_PD
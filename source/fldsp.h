@@ -17,11 +17,22 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 // include the header file declaring the base classes
 #include "flext.h"
 
+#ifdef FLEXT_DSPLOAD
+    #if FLEXT_DSPLOAD <= 1
+        // window of measured DSP calls, compile with -DFLEXT_DSPLOAD=n to set the size
+        #undef FLEXT_DSPLOAD
+        #define FLEXT_DSPLOAD 256
+    #endif
+#endif
+
 #include "flpushns.h"
 
 // === flext_dsp ==================================================
 
 FLEXT_TEMPLATE class FLEXT_SHARE FLEXT_CLASSDEF(flext_dsp);
+class DspIsland;
+class DspBatch;
+class DspOver;
 typedef FLEXT_SHARE FLEXT_TEMPINST(FLEXT_CLASSDEF(flext_dsp)) flext_dsp;
 
 
@@ -48,49 +59,338 @@ public:
 */
 
 	//! returns current sample rate
-	float Samplerate() const { return srate; }
+	float Samplerate() const { return io.srate; }
 	
 	//! returns current block (aka vector) size
-	int Blocksize() const { return blksz; }
+	int Blocksize() const { return io.frames; }
+
+	/*! \brief Call CbSignal with a fixed block size
+		\param n ... block size, 0 (default) for the host block size
+		If the host block size is a multiple of n, CbSignal is called several times per host block.
+		Otherwise input and output are buffered, which delays the output by n samples.
+		\note Call this in the constructor, it takes effect when DSP is (re)started
+	*/
+	void SetBlocksize(int n) { subsz = n > 0?n:0; }
+
+	/*! \brief Call CbSignal at a multiple of the sample rate (e.g. for nonlinear processing without aliasing)
+		\param factor ... 2, 4, 8 or 16 (other values are rounded up), 1 (default) for the host sample rate
+		The inputs are upsampled and the outputs downsampled with polyphase half-band filters.
+		Blocksize() and Samplerate() return the oversampled values in CbDsp and CbSignal,
+		the delay of the filters is included in Latency().
+		\note Call this in the constructor, it takes effect when DSP is (re)started.
+		Oversampled objects don't join a batch (SetBatch).
+	*/
+	void SetOversampling(int factor) 
+	{ 
+		int f = 1;
+		while(f < factor && f < 16) f *= 2;
+		overfac = f;
+	}
+
+	//! returns the oversampling factor (see SetOversampling)
+	int GetOversampling() const { return overfac; }
+
+	/*! \brief Call CbSignal in a separate worker thread
+		\param blocks ... lookahead in host blocks, 0 (default) for processing in the audio thread
+		The audio thread only hands over the input and collects the output computed blocks earlier.
+		If the worker hasn't finished in time, the output is silent for that block.
+		\note Call this in the constructor, it takes effect when DSP is (re)started.
+		Without thread support in flext the processing stays synchronous.
+	*/
+	void SetAsync(int blocks)
+	{
+#ifdef FLEXT_THREADS
+		asyncblocks = blocks > 0?blocks:0;
+#endif
+	}
+
+	/*! \brief Process CbSignal concurrently with the other members of a DSP island
+		\param name ... island name, NULL (default) for processing in place
+		Members of an island are started at their place in the DSP chain and run on a pool of worker threads,
+		the last member in the chain waits for all of them.
+		A member reading the output of a running member waits until that one has finished.
+		The island can also be set with the "island" attribute.
+		\note Only members whose signal outlets all connect to other members (as the only source of the inlet)
+		are run by the workers, so that no other object reads from a running member.
+		The others (and all members in Max) are processed in place, after waiting for the members they read from.
+		Asynchronous members (SetAsync) don't join the island.
+		It takes effect when DSP is (re)started. Without thread support in flext the processing stays synchronous.
+	*/
+	void SetIsland(const t_symbol *name) { islandname = name == sym__?NULL:name; }
+
+	//! returns the name of the DSP island, or NULL
+	const t_symbol *GetIsland() const { return islandname; }
+
+	/*! \brief Set the number of worker threads for DSP islands
+		\param n ... number of threads, 0 (default) for one less than the number of CPUs
+		\note Takes effect when the workers are started with the first island
+	*/
+	static void SetIslandThreads(int n);
+
+	/*! \brief Process the objects of this class together (see CbSignalBatch)
+		\param on ... true to join the batch of the class, false (default) to be processed on its own
+		Each member copies its input at its place in the DSP chain and outputs the result of the block before,
+		the last member in the chain calls CbSignalBatch for all members. This adds a latency of one block.
+		\note The members must run in the same block context (block size, switched subpatches).
+		Objects with adapted block size (SetBlocksize), asynchronous objects (SetAsync), island members (SetIsland)
+		oversampled objects (SetOversampling) and multichannel objects are processed on their own, as are all objects in Max with the 64-bit DSP interface.
+		It takes effect when DSP is (re)started.
+	*/
+	void SetBatch(bool on) { batchon = on; }
+
+	/*! \brief Skip CbSignal while the signal inputs are silent
+		\param tail ... samples the output takes to decay after the input has become all-zero, -1 (default) to always process
+		After the tail (and the latency of the block size adaption) has been processed, 
+		CbSignal isn't called and the outputs are zeroed until an input vector is non-zero again 
+		or there is a pending event (see PostEvent).
+		\note Objects without signal inputs, asynchronous objects (SetAsync) and island members (SetIsland) are always processed.
+		Objects producing output without input (e.g. triggered by a message) must call Wake.
+	*/
+	void SetSleep(int tail) { sleeptail = tail >= 0?tail:-1; }
+
+	//! Resume processing (and the tail) if the object is asleep (see SetSleep)
+	void Wake() { sleepcnt = 0; }
+
+	//! returns true if processing is skipped because of silent inputs (see SetSleep)
+	bool Asleep() const { return sleeping; }
+
+	//! returns the delay (in samples at the host rate) introduced by adapting the block size, oversampling and asynchronous processing
+	int Latency() const { return latency; }
+
+	//! returns the number of blocks the worker thread didn't finish in time (output was silent)
+	unsigned long AsyncUnderruns() const { return asyncunder; }
+
+	//! returns the number of blocks dropped because the worker thread was still busy
+	unsigned long AsyncOverruns() const { return asyncover; }
     
 	//! returns array of input vectors (CntInSig() vectors)
-    t_sample *const *InSig() const {
-#if MSP64
-        return inVec;
-#else
-        
-        return vecs;
-#endif
-    }
+    t_sample *const *InSig() const { return io.in; }
 
 	//! returns input vector
     t_sample *InSig(int i) const { return InSig()[i]; }
 
+	/*! \brief returns the number of channels of an input vector
+		With a multichannel connection (see flext_obj::SetMultichannel) the channels are stored 
+		one after the other in InSig(i), each with Blocksize() frames.
+	*/
+	int InSigChannels(int i) const { return inchns?inchns[i]:1; }
+
+	//! returns the number of channels of an output vector (see InSigChannels)
+	int OutSigChannels(int i) const { return outchns?outchns[i]:1; }
+
+	/*! \brief Set the number of channels of the signal outlets of a multichannel object
+		\param n ... number of channels, 0 (default) for the largest number of input channels
+		\note It takes effect when DSP is (re)started
+	*/
+	void SetOutChannels(int n) { mcout = n > 0?n:0; }
+
+	/*! \brief Check if an input vector holds the same value in all samples
+		Inlets fed by sig~ or by floats promoted to signals are constant, CbSignal can then
+		use scalar forms of the sample functions (e.g. MulSamples with a t_sample factor).
+		\note Each call scans the vector (all channels), call it once per CbSignal and before writing the outputs
+		(Pd may use the same vectors for input and output).
+	*/
+	bool InSigIsConst(int i) const
+	{
+		t_sample mn,mx;
+		MinMaxSamples(io.in[i],io.frames*InSigChannels(i),mn,mx);
+		return mn == mx;
+	}
+
+	//! returns the value of a constant input vector (see InSigIsConst)
+	t_sample InSigValue(int i) const { return io.in[i][0]; }
+
 	//! returns array of output vectors (CntOutSig() vectors)
-    // \todo cache that returned pointer
-    t_sample *const *OutSig() const 
-    { 
-        int i = CntInSig();
+    t_sample *const *OutSig() const { return io.out; }
+
+	//! returns output vector
+    t_sample *OutSig(int i) const { return OutSig()[i]; }
+
+	/*! \brief returns array of single precision input vectors (see flext_obj::SetSinglePrecision)
+		The vectors are laid out like InSig(), in CbSignalSingle they hold the converted input.
+	*/
 #if MSP64
-        return outVec;
+    float *const *InSigSingle() const { return singlevecs; }
 #else
-        // in PD we have at least one actual dsp in vector
-#if FLEXT_SYS == FLEXT_SYS_PD
-        return vecs+(i?i:1); 
-#elif FLEXT_SYS == FLEXT_SYS_MAX
-        return vecs+i; 
-#else
-#error
+    float *const *InSigSingle() const { return sizeof(t_sample) == sizeof(float)?reinterpret_cast<float *const *>(io.in):singlevecs; }
 #endif
+
+	//! returns single precision input vector
+    float *InSigSingle(int i) const { return InSigSingle()[i]; }
+
+	//! returns array of single precision output vectors, converted to the host vectors after CbSignalSingle
+#if MSP64
+    float *const *OutSigSingle() const { return singlevecs+io.nin; }
+#else
+    float *const *OutSigSingle() const { return sizeof(t_sample) == sizeof(float)?reinterpret_cast<float *const *>(io.out):singlevecs+io.nin; }
 #endif
-    }
 
-	//! returns output vector
-    t_sample *OutSig(int i) const { return OutSig()[i]; }
+	//! returns single precision output vector
+    float *OutSigSingle(int i) const { return OutSigSingle()[i]; }
 
 	//! typedef describing a signal vector
 	typedef t_sample *t_signalvec;
 
+	/*! \brief Signal vectors and parameters of the current DSP call
+		Set up with the DSP chain, CbSignal can read it directly instead of the single accessors.
+	*/
+	struct DspIO {
+		//! input vectors (nin vectors)
+		t_sample *const *in;
+		//! output vectors (nout vectors)
+		t_sample *const *out;
+		int nin,nout;
+		//! frames (aka samples) in one signal vector
+		int frames;
+		float srate;
+		/*! \brief true if an output vector is the same as an input vector
+			Pd reuses buffers, the output must then be written after the respective input has been read.
+			Kernels can also work in place instead of using intermediate buffers.
+		*/
+		bool inplace;
+	};
+
+	//! returns the signal vectors and parameters
+	const DspIO &IO() const { return io; }
+
+	/*! \brief Scratch memory for CbSignal
+		Memory obtained with Scratch().Alloc is released after each CbSignal call.
+		The arena grows to the largest demand seen when DSP is (re)started, 
+		call Scratch().Reserve in CbDsp to have memory available for the first blocks.
+	*/
+	ScratchArena &Scratch() { return scratch; }
+
+	/*! \brief Parameter ramped linearly to its target (against zipper noise)
+		The target is set in the message domain, e.g. by an attribute declared with FLEXT_ATTRVAR_SMOOTH.
+		CbSignal takes the values with Ramp, Mul or Next, which fall back to the constant value 
+		without generating a ramp once the target is reached.
+		\note Until the first block has been processed, Set jumps to the target (e.g. for creation attributes)
+	*/
+	class Smoothed
+	{
+	public:
+		Smoothed(float v = 0,int time = 0): target(v),dest(v),value(v),inc(0),remain(0),time(time > 0?time:0),started(false) {}
+
+		//! Set the ramp time in samples (e.g. in CbDsp), 0 to jump to the target
+		void SetTime(int n) { time = n > 0?n:0; }
+
+		//! returns the ramp time in samples
+		int GetTime() const { return time; }
+
+		//! Set the target, the ramp starts with the next block
+		void Set(float v) { target = v; if(!started) dest = value = v; }
+
+		//! Jump to a value (call it in CbDsp or CbSignal)
+		void Reset(float v) { target = dest = v,value = v,remain = 0; }
+
+		//! returns the target
+		float Get() const { return target; }
+
+		//! returns the current value
+		t_sample Value() const { return value; }
+
+		//! returns true if the target hasn't been reached yet
+		bool Ramping() const { return remain || target != dest; }
+
+		/*! \brief Get the values of the next n samples
+			\return false if the value is constant, dst isn't written then (see Value)
+		*/
+		bool Ramp(t_sample *dst,int n)
+		{
+			const int r = Step(n);
+			if(!r) return false;
+			RampSamples(dst,value,inc,r);
+			Advance(r);
+			if(r < n) SetSamples(dst+r,n-r,value);
+			return true;
+		}
+
+		//! Multiply n samples with the values: dst = src*value (dst may be src)
+		void Mul(t_sample *dst,const t_sample *src,int n)
+		{
+			const int r = Step(n);
+			if(r) {
+				RampMulSamples(dst,src,value,inc,r);
+				Advance(r);
+			}
+			if(r < n) MulSamples(dst+r,src+r,value,n-r);
+		}
+
+		//! Advance by n samples (e.g. once per block for control rate parameters), returns the value at the end
+		t_sample Next(int n)
+		{
+			const int r = Step(n);
+			if(r) Advance(r);
+			return value;
+		}
+
+	protected:
+		//! Start a ramp to a new target, returns the samples of the ramp within the next n
+		int Step(int n)
+		{
+			started = true;
+			const float t = target;
+			if(t != dest) {
+				dest = t;
+				if(time) remain = time,inc = (dest-value)/time;
+				else value = dest,remain = 0;
+			}
+			return remain < n?remain:n;
+		}
+
+		void Advance(int r)
+		{
+			if((remain -= r) > 0) value += inc*r;
+			else value = dest;
+		}
+
+		// written in the message domain
+		volatile float target;
+		float dest;
+		t_sample value,inc;
+		int remain,time;
+		bool started;
+	};
+
+	//! Event passed from the message domain to CbSignal
+	struct Event {
+		//! logical time (see GetTime)
+		double time;
+		//! sample offset in the current signal vector (set by GetEvent)
+		int offset;
+		//! user defined contents
+		int id;
+		float value;
+		void *data;
+	};
+
+	/*! \brief Set the capacity of the event queue (see PostEvent)
+		\param n ... maximum number of pending events, 0 for no queue (default)
+		\note Call this in the constructor
+	*/
+	void SetEvents(int n);
+
+	/*! \brief Queue an event for CbSignal, stamped with the current logical time
+		Call this in a message handler, CbSignal gets the event at the respective sample offset with GetEvent.
+		The queue is lock-free, it can be used from any thread.
+		\return false if there is no queue or it is full
+	*/
+	bool PostEvent(int id,float value = 0,void *data = NULL) { return PostEventAt(GetTime(),id,value,data); }
+
+	//! Queue an event for CbSignal at a logical time (see PostEvent)
+	bool PostEventAt(double time,int id,float value = 0,void *data = NULL);
+
+	/*! \brief Get the next event lying in the current signal vector
+		Call this in CbSignal, e.g. to split processing at the event offsets.
+		Events of earlier vectors get offset 0, the following ones stay queued.
+		\note The events arrive with the latency of one host block, messages of the block before are placed sample-accurately.
+		\return false if there are no more events for this vector
+	*/
+	bool GetEvent(Event &ev);
+
+	//! returns the sample offset of the next event in the current signal vector, or Blocksize() if there is none
+	int NextEvent() const;
+
 //!	@} 
 
 // --- inheritable virtual methods --------------------------------
@@ -112,6 +412,21 @@ public:
     */
 	virtual void CbSignal();    
 
+	/*! \brief Called instead of CbSignal by classes processing in single precision (see flext_obj::SetSinglePrecision)
+		Use InSigSingle and OutSigSingle for the signal vectors.
+        flext_dsp::CbSignalSingle fills all output vectors with silence
+	*/
+	virtual void CbSignalSingle();
+
+	/*! \brief Called once per block for all members of a batch (see SetBatch)
+		\param objs ... the members processed in this block, objects of the same class including this one
+		\param n ... number of members
+		The signal vectors of the members are separate buffers, so that state kept as structure-of-arrays
+		can be processed across the members (e.g. filters vectorized across voices instead of time).
+		flext_dsp::CbSignalBatch calls CbSignal of each member
+	*/
+	virtual void CbSignalBatch(FLEXT_CLASSDEF(flext_dsp) *const *objs,int n);
+
 
     /*! \brief Deprecated method for CbSignal
         \deprecated
@@ -172,17 +487,23 @@ protected:
 private:
 
 	// not static, could be different in different patchers..
-	float srate; 
-	int blksz;
-	
-    
-#if MSP64
-    t_signalvec *inVec;
-    t_signalvec *outVec;
-#else
-    t_signalvec *vecs;
+	DspIO io;
+
+#if !MSP64
+	// the host vectors (in+out)
+	t_signalvec *vecs;
+	// and their channels
+	int *chns;
+	int vecsz;
 #endif
 
+	// channels of the vectors, NULL for single channels
+	const int *inchns,*outchns;
+	// requested output channels
+	int mcout;
+
+	void SetIO(t_signalvec const *in,t_signalvec const *out);
+
 	// setup function
 	static void Setup(t_classid c);
 
@@ -191,6 +512,182 @@ private:
 	bool dspon;
 #endif
 
+	// flush denormals in CbSignal (cached at DSP setup)
+	bool ftz;
+
+	// single precision processing (cached at DSP setup)
+	bool single;
+	// converted vectors for CbSignalSingle (in+out), unused if the host vectors are single precision
+	float **singlevecs;
+	float *singlebuf;
+
+	void SetupSingle();
+	void FreeSingle();
+	// CbSignalSingle with the converted vectors
+	void SingleSignal();
+
+	ScratchArena scratch;
+
+	void DoSignal();
+	// CbSignal and release the scratch memory
+#ifdef FLEXT_MEMSTATS
+	void CallSignal()
+	{
+		FLEXT_TRACE_SCOPE("dsp","signal",thisName());
+		// attribute the allocations to this object
+		MemCounter *o = SetMemOwner(&memdsp);
+		if(UNLIKELY(over)) OverSignal(); else CbSignal();
+		scratch.Reset();
+		SetMemOwner(o);
+	}
+
+	// allocations in CbSignal
+	MemCounter memdsp;
+
+	static bool cb_GetMemStats(flext_base *c,int argc,const t_atom *argv);
+#else
+	void CallSignal() 
+	{ 
+		FLEXT_TRACE_SCOPE("dsp","signal",thisName()); 
+		if(UNLIKELY(over)) OverSignal(); else CbSignal(); 
+		scratch.Reset(); 
+	}
+#endif
+
+	// silence detection (see SetSleep)
+	int sleeptail;
+	// samples of silent input processed
+	volatile long sleepcnt;
+	bool sleeping;
+
+	bool Silent(int n);
+
+	// block size adaption
+	int subsz,hostsz,latency;
+	int subin,subout,subpos;
+	t_signalvec *subvecs;
+	t_sample *subbuf;
+
+	void SetupSub(int in,int out);
+	void FreeSub();
+	void SubSignal(int n);
+
+	// oversampling
+	int overfac;
+	DspOver *over;
+
+	void SetupOver();
+	void FreeOver();
+	void OverSignal();
+	bool OverDsp();
+
+	// event queue (bounded, multiple producers, one consumer)
+	struct EventSlot {
+		volatile long seq;
+		Event ev;
+	};
+	EventSlot *evbuf;
+	long evmask;
+	volatile long evwr;
+	long evrd;
+	// logical time of the start of the current signal vector
+	double evwin;
+
+	int EventOffset(double time) const;
+
+	// asynchronous processing
+	int asyncblocks;
+	unsigned long asyncunder,asyncover;
+
+#ifdef FLEXT_THREADS
+	struct AsyncBlock {
+		t_signalvec *vecs; // input and output vectors
+		int frames;
+		long seq;
+		double time; // logical time of the block
+		volatile long state; // 0 free, 1 input ready, 2 processing, 3 output ready
+	};
+
+	AsyncBlock *async;
+	t_signalvec *asyncvecs;
+	t_sample *asyncbuf;
+	int asyncin,asyncout,asyncmax;
+	long asyncseq;
+	// the host vectors
+	t_signalvec const *asynchin,*asynchout;
+
+	ThrCond *asynccond;
+	thr_params *asyncparams;
+	volatile int asyncwaiting;
+	volatile bool asyncstop;
+
+	void SetupAsync(int in,int out);
+	void FreeAsync();
+	void AsyncSignal();
+	void AsyncWake();
+	AsyncBlock *AsyncNext() const;
+	void AsyncWork();
+
+	static void AsyncWorker(thr_params *p);
+#endif
+
+	// batch processing (see SetBatch)
+	friend class DspBatch;
+
+	bool batchon;
+	DspBatch *batch;
+	// the separate vectors
+	t_signalvec *batchvecs;
+	t_sample *batchbuf;
+	// the host vectors
+	t_signalvec const *batchhin,*batchhout;
+	// copied in with the current block
+	bool batchpending;
+
+	void SetupBatch();
+	void FreeBatch();
+	void BatchSignal();
+	void BatchRun(FLEXT_CLASSDEF(flext_dsp) *const *objs,int n);
+
+	// DSP island
+	const t_symbol *islandname;
+
+#ifdef FLEXT_THREADS
+	friend class DspIsland;
+
+	DspIsland *island;
+	// copies of the input vectors
+	t_signalvec *islandvecs;
+	t_sample *islandbuf;
+	int islandin,islandmax;
+	// the host vectors
+	t_signalvec const *islandhin,*islandhout;
+	int islandout;
+	// processed in place instead of by the workers
+	bool islandsync;
+	// 0 idle, 1 started, 2 finished
+	volatile long islandstate;
+
+	void SetupIsland(int in,int out);
+	void FreeIsland();
+#if FLEXT_SYS == FLEXT_SYS_PD
+	bool IslandPeer(t_object *o,int n) const;
+#endif
+	void IslandSignal();
+	void IslandRun();
+
+	static bool cb_GetIsland(flext_base *c,const t_symbol *&s);
+	static bool cb_SetIsland(flext_base *c,const t_symbol *&s);
+#endif
+
+#ifdef FLEXT_DSPLOAD
+	// durations of the last CbSignal calls (microseconds)
+	float loadtimes[FLEXT_DSPLOAD];
+	int loadpos,loadcnt;
+
+	static bool cb_GetDspLoad(flext_base *c,int argc,const t_atom *argv);
+#endif
+
 	static inline flext_dsp *thisObject(flext_hdr *c) { return FLEXT_CAST<flext_dsp *>(c->data); } 
 
 	// dsp stuff
@@ -27,6 +27,9 @@ FLEXT_TEMPIMPL(const t_symbol *FLEXT_CLASSDEF(flext_base))::curtag = NULL;
 FLEXT_TEMPIMPL(FLEXT_CLASSDEF(flext_base))::FLEXT_CLASSDEF(flext_base)()
     : incnt(0),outcnt(0)
     , insigs(0),outsigs(0)
+    , qprio(prio_control)
+    , qslots(NULL)
+    , inbind(NULL),inbindcnt(0)
 #if FLEXT_SYS == FLEXT_SYS_PD || FLEXT_SYS == FLEXT_SYS_MAX
     ,outlets(NULL),inlets(NULL)
 #endif
@@ -36,18 +39,14 @@ FLEXT_TEMPIMPL(FLEXT_CLASSDEF(flext_base))::FLEXT_CLASSDEF(flext_base)()
 {
     FLEXT_LOG1("%s - flext logging is on",thisName());
 
+    // per-object tables are made on first use, most objects have none
     methhead = NULL;
     bindhead = NULL;
-
-    if(HasAttributes()) {
-        // initialize when attribute processing is enabled
-        attrhead = new ItemCont;
-        attrdata = new AttrDataCont;
-    }
-    else {
-        attrhead = NULL;
-        attrdata = NULL;
-    }
+    attrhead = NULL;
+    attrdata = NULL;
+#if FLEXT_SYS == FLEXT_SYS_PD && !defined(FLEXT_NOATTREDIT)
+    attrdialog = false;
+#endif
 }
 
 /*! This virtual function is called after the object has been created, that is, 
@@ -103,12 +102,14 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::Exit()
 
     // send remaining pending messages for this object
     QFlush(this);
+    FreeQueueSlots();
 
     // delete message lists
     if(bindhead) delete bindhead;  // ATTENTION: the object must free all memory associated to bindings itself
     if(methhead) delete methhead;
     if(attrhead) delete attrhead;
     if(attrdata) delete attrdata;
+    if(inbind) delete[] inbind;
     
 #if FLEXT_SYS == FLEXT_SYS_PD || FLEXT_SYS == FLEXT_SYS_MAX
     if(outlets) delete[] outlets;
@@ -194,9 +195,15 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::Setup(t_classid id)
 
 #if FLEXT_SYS == FLEXT_SYS_PD && !defined(FLEXT_NOATTREDIT)
         AddMethod(id,0,"attributedialog",cb_AttrDialog);
+        AddMethod(id,0,"attributedialogclose",cb_AttrDialogClose);
 #endif
     }
 
+    AddMethod(id,0,"getqueuestats",cb_QueueStats);
+#ifdef FLEXT_TRACE
+    AddMethod(id,0,"tracedump",cb_TraceDump);
+#endif
+
 #if FLEXT_SYS == FLEXT_SYS_PD
     SetGfx(id);
 #endif
@@ -310,6 +317,10 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::cb_dsp(flext_hdr *c,t_signal **
 
 FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::CbIdle() { return 0; }
 
+#ifdef FLEXT_THREADS
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::CbThreadAttr(const char *,ThrAttr &) { return false; }
+#endif
+
 #include "flpopns.h"
 
 #endif // __FLEXT_CPP
@@ -74,6 +74,7 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 #   include "flbuf.cpp"
 #   include "fldsp.cpp"
 #   include "flext.cpp"
+#   include "flfft.cpp"
 #   include "flitem.cpp"
 #   include "fllib.cpp"
 #   include "flmap.cpp"
@@ -86,6 +87,7 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 #   include "flsupport.cpp"
 #   include "flthr.cpp"
 #   include "fltimer.cpp"
+#   include "fltrace.cpp"
 #   include "flutil.cpp"
 #   include "flxlet.cpp"
 #endif
@@ -0,0 +1,340 @@
+/*
+flext - C++ layer for Max and Pure Data externals
+
+Copyright (c) 2001-2015 Thomas Grill (gr@grrrr.org)
+For information on usage and redistribution, and for a DISCLAIMER OF ALL
+WARRANTIES, see the file, "license.txt," in this distribution.
+*/
+
+/*! \file flfft.cpp
+    \brief Mixed radix FFT with plans shared by all objects.
+*/
+
+#ifndef __FLEXT_FFT_CPP
+#define __FLEXT_FFT_CPP
+
+#include "flext.h"
+#include "lockfree/cas.hpp"
+#include <cmath>
+
+#include "flpushns.h"
+
+FLEXT_TEMPLATE
+struct FFTVars {
+    static flext::FFT *volatile plans;
+};
+
+FLEXT_TEMPIMPL(flext::FFT *volatile FFTVars)::plans = NULL;
+
+static const double fft_2pi = 6.28318530717958647692;
+
+/*! \brief Stages of the Stockham autosort FFT (decimation in frequency)
+    A stage of radix p transforms len = p*m values at stride s: input j+r*m goes to output p*j+k,
+    multiplied by the twiddle factor w^(j*k). The output of the last stage is in natural order.
+    The innermost loops run over the stride, where the data is contiguous, so that the compiler can vectorize them.
+    Complex values are interleaved, INV conjugates the roots of unity.
+*/
+
+template<bool INV>
+static void fft_radix2(int m,int s,const t_sample *w,const t_sample *x,t_sample *y)
+{
+    for(int j = 0; j < m; ++j) {
+        const t_sample wr = w[2*j],wi = INV?-w[2*j+1]:w[2*j+1];
+        const t_sample *a0 = x+2*s*j,*a1 = x+2*s*(j+m);
+        t_sample *y0 = y+2*s*(2*j),*y1 = y0+2*s;
+        for(int q = 0; q < 2*s; q += 2) {
+            const t_sample dr = a0[q]-a1[q],di = a0[q+1]-a1[q+1];
+            y0[q] = a0[q]+a1[q],y0[q+1] = a0[q+1]+a1[q+1];
+            y1[q] = dr*wr-di*wi,y1[q+1] = dr*wi+di*wr;
+        }
+    }
+}
+
+template<bool INV>
+static void fft_radix3(int m,int s,const t_sample *w,const t_sample *x,t_sample *y)
+{
+    // sin(2pi/3), negative for the forward transform
+    const t_sample c = -0.5f,sn = INV?0.86602540378443865f:-0.86602540378443865f;
+    for(int j = 0; j < m; ++j) {
+        const t_sample *tw = w+4*j;
+        const t_sample w1r = tw[0],w1i = INV?-tw[1]:tw[1];
+        const t_sample w2r = tw[2],w2i = INV?-tw[3]:tw[3];
+        const t_sample *a0 = x+2*s*j,*a1 = x+2*s*(j+m),*a2 = x+2*s*(j+2*m);
+        t_sample *y0 = y+2*s*(3*j),*y1 = y0+2*s,*y2 = y1+2*s;
+        for(int q = 0; q < 2*s; q += 2) {
+            const t_sample tr = a1[q]+a2[q],ti = a1[q+1]+a2[q+1];
+            const t_sample dr = a1[q]-a2[q],di = a1[q+1]-a2[q+1];
+            const t_sample br = a0[q]+c*tr,bi = a0[q+1]+c*ti;
+            // b +- i*sn*d
+            const t_sample x1r = br-sn*di,x1i = bi+sn*dr;
+            const t_sample x2r = br+sn*di,x2i = bi-sn*dr;
+            y0[q] = a0[q]+tr,y0[q+1] = a0[q+1]+ti;
+            y1[q] = x1r*w1r-x1i*w1i,y1[q+1] = x1r*w1i+x1i*w1r;
+            y2[q] = x2r*w2r-x2i*w2i,y2[q+1] = x2r*w2i+x2i*w2r;
+        }
+    }
+}
+
+template<bool INV>
+static void fft_radix4(int m,int s,const t_sample *w,const t_sample *x,t_sample *y)
+{
+    for(int j = 0; j < m; ++j) {
+        const t_sample *tw = w+6*j;
+        const t_sample w1r = tw[0],w1i = INV?-tw[1]:tw[1];
+        const t_sample w2r = tw[2],w2i = INV?-tw[3]:tw[3];
+        const t_sample w3r = tw[4],w3i = INV?-tw[5]:tw[5];
+        const t_sample *a0 = x+2*s*j,*a1 = x+2*s*(j+m),*a2 = x+2*s*(j+2*m),*a3 = x+2*s*(j+3*m);
+        t_sample *y0 = y+2*s*(4*j),*y1 = y0+2*s,*y2 = y1+2*s,*y3 = y2+2*s;
+        for(int q = 0; q < 2*s; q += 2) {
+            const t_sample t0r = a0[q]+a2[q],t0i = a0[q+1]+a2[q+1];
+            const t_sample t1r = a0[q]-a2[q],t1i = a0[q+1]-a2[q+1];
+            const t_sample t2r = a1[q]+a3[q],t2i = a1[q+1]+a3[q+1];
+            // (a1-a3)*-i, or *i for the inverse
+            const t_sample t3r = INV?a3[q+1]-a1[q+1]:a1[q+1]-a3[q+1];
+            const t_sample t3i = INV?a1[q]-a3[q]:a3[q]-a1[q];
+            const t_sample x1r = t1r+t3r,x1i = t1i+t3i;
+            const t_sample x2r = t0r-t2r,x2i = t0i-t2i;
+            const t_sample x3r = t1r-t3r,x3i = t1i-t3i;
+            y0[q] = t0r+t2r,y0[q+1] = t0i+t2i;
+            y1[q] = x1r*w1r-x1i*w1i,y1[q+1] = x1r*w1i+x1i*w1r;
+            y2[q] = x2r*w2r-x2i*w2i,y2[q+1] = x2r*w2i+x2i*w2r;
+            y3[q] = x3r*w3r-x3i*w3i,y3[q+1] = x3r*w3i+x3i*w3r;
+        }
+    }
+}
+
+template<bool INV>
+static void fft_radix5(int m,int s,const t_sample *w,const t_sample *x,t_sample *y)
+{
+    // cos and sin of 2pi/5 and 4pi/5, the sines negative for the forward transform
+    const t_sample c1 = 0.30901699437494742f,c2 = -0.80901699437494742f;
+    const t_sample s1 = INV?0.95105651629515357f:-0.95105651629515357f;
+    const t_sample s2 = INV?0.58778525229247313f:-0.58778525229247313f;
+    for(int j = 0; j < m; ++j) {
+        const t_sample *tw = w+8*j;
+        const t_sample *a0 = x+2*s*j,*a1 = x+2*s*(j+m),*a2 = x+2*s*(j+2*m),*a3 = x+2*s*(j+3*m),*a4 = x+2*s*(j+4*m);
+        t_sample *yo[5];
+        yo[0] = y+2*s*(5*j);
+        for(int k = 1; k < 5; ++k) yo[k] = yo[k-1]+2*s;
+        for(int q = 0; q < 2*s; q += 2) {
+            const t_sample t1r = a1[q]+a4[q],t1i = a1[q+1]+a4[q+1];
+            const t_sample t2r = a2[q]+a3[q],t2i = a2[q+1]+a3[q+1];
+            const t_sample d1r = a1[q]-a4[q],d1i = a1[q+1]-a4[q+1];
+            const t_sample d2r = a2[q]-a3[q],d2i = a2[q+1]-a3[q+1];
+            const t_sample b1r = a0[q]+c1*t1r+c2*t2r,b1i = a0[q+1]+c1*t1i+c2*t2i;
+            const t_sample b2r = a0[q]+c2*t1r+c1*t2r,b2i = a0[q+1]+c2*t1i+c1*t2i;
+            const t_sample e1r = s1*d1r+s2*d2r,e1i = s1*d1i+s2*d2i;
+            const t_sample e2r = s2*d1r-s1*d2r,e2i = s2*d1i-s1*d2i;
+            // b +- i*e
+            const t_sample xr[4] = { b1r-e1i,b2r-e2i,b2r+e2i,b1r+e1i };
+            const t_sample xi[4] = { b1i+e1r,b2i+e2r,b2i-e2r,b1i-e1r };
+            yo[0][q] = a0[q]+t1r+t2r,yo[0][q+1] = a0[q+1]+t1i+t2i;
+            for(int k = 0; k < 4; ++k) {
+                const t_sample wr = tw[2*k],wi = INV?-tw[2*k+1]:tw[2*k+1];
+                yo[k+1][q] = xr[k]*wr-xi[k]*wi,yo[k+1][q+1] = xr[k]*wi+xi[k]*wr;
+            }
+        }
+    }
+}
+
+//! Any radix, the p roots of unity follow the twiddle factors
+template<bool INV>
+static void fft_radixn(int p,int m,int s,const t_sample *w,const t_sample *x,t_sample *y)
+{
+    const t_sample *root = w+2*m*(p-1);
+    for(int j = 0; j < m; ++j) {
+        const t_sample *tw = w+2*(p-1)*j;
+        for(int q = 0; q < 2*s; q += 2)
+            for(int k = 0; k < p; ++k) {
+                t_sample sr = 0,si = 0;
+                for(int r = 0,rk = 0; r < p; ++r,rk = (rk+k)%p) {
+                    const t_sample *a = x+2*s*(j+r*m)+q;
+                    const t_sample ur = root[2*rk],ui = INV?-root[2*rk+1]:root[2*rk+1];
+                    sr += a[0]*ur-a[1]*ui,si += a[0]*ui+a[1]*ur;
+                }
+                t_sample *o = y+2*s*(p*j+k)+q;
+                if(k) {
+                    const t_sample wr = tw[2*(k-1)],wi = INV?-tw[2*(k-1)+1]:tw[2*(k-1)+1];
+                    o[0] = sr*wr-si*wi,o[1] = sr*wi+si*wr;
+                }
+                else
+                    o[0] = sr,o[1] = si;
+            }
+    }
+}
+
+FLEXT_TEMPIMPL(FLEXT_CLASSDEF(flext))::FFT::FFT(int sz,bool r)
+    : n(sz),real(r),stages(0),twiddle(NULL),half(NULL),nxt(NULL)
+{
+    if(real) {
+        // a complex transform of the even and odd samples, then the twiddle factors e^(-2pi*i*k/n) for k = 0..n/2
+        half = GetFFT(n/2);
+        const int h = n/2;
+        twiddle = (t_sample *)NewAligned(2*(h+1)*sizeof(t_sample));
+        for(int k = 0; k <= h; ++k) {
+            const double a = -fft_2pi*k/n;
+            twiddle[2*k] = (t_sample)cos(a),twiddle[2*k+1] = (t_sample)sin(a);
+        }
+        return;
+    }
+
+    // radix 4 first, it has the fewest operations per value
+    int rest = n,size = 0;
+    while(rest > 1) {
+        int p;
+        if(rest%4 == 0) p = 4;
+        else if(rest%2 == 0) p = 2;
+        else for(p = 3; rest%p; p += 2) {}
+        radix[stages++] = p;
+        rest /= p;
+    }
+
+    // twiddle factors, and roots of unity for the generic radices
+    int len = n;
+    for(int i = 0; i < stages; ++i) {
+        const int p = radix[i],m = len/p;
+        offset[i] = size;
+        size += 2*m*(p-1)+(p > 5?2*p:0);
+        len = m;
+    }
+
+    twiddle = size?(t_sample *)NewAligned(size*sizeof(t_sample)):NULL;
+    len = n;
+    for(int i = 0; i < stages; ++i) {
+        const int p = radix[i],m = len/p;
+        t_sample *t = twiddle+offset[i];
+        for(int j = 0; j < m; ++j)
+            for(int k = 1; k < p; ++k,t += 2) {
+                const double a = -fft_2pi*j*k/len;
+                t[0] = (t_sample)cos(a),t[1] = (t_sample)sin(a);
+            }
+        if(p > 5)
+            for(int k = 0; k < p; ++k,t += 2) {
+                const double a = -fft_2pi*k/p;
+                t[0] = (t_sample)cos(a),t[1] = (t_sample)sin(a);
+            }
+        len = m;
+    }
+}
+
+FLEXT_TEMPIMPL(FLEXT_CLASSDEF(flext))::FFT::~FFT()
+{
+    if(twiddle) FreeAligned(twiddle);
+}
+
+//! Run the stages from src to dst, src is not modified unless it is dst
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::FFT::Stages(t_sample *dst,const t_sample *src,t_sample *scratch,bool inverse) const
+{
+    if(!stages) {
+        if(dst != src) CopySamples(dst,src,2*n);
+        return;
+    }
+
+    // the stages alternate between dst and scratch, so that the last one writes to dst
+    t_sample *y = stages&1?dst:scratch;
+    if(y == src) {
+        CopySamples(scratch,src,2*n);
+        src = scratch;
+    }
+
+    const t_sample *x = src;
+    int len = n,s = 1;
+    for(int i = 0; i < stages; ++i) {
+        const int p = radix[i],m = len/p;
+        const t_sample *w = twiddle+offset[i];
+        switch(p) {
+            case 2: if(inverse) fft_radix2<true>(m,s,w,x,y); else fft_radix2<false>(m,s,w,x,y); break;
+            case 3: if(inverse) fft_radix3<true>(m,s,w,x,y); else fft_radix3<false>(m,s,w,x,y); break;
+            case 4: if(inverse) fft_radix4<true>(m,s,w,x,y); else fft_radix4<false>(m,s,w,x,y); break;
+            case 5: if(inverse) fft_radix5<true>(m,s,w,x,y); else fft_radix5<false>(m,s,w,x,y); break;
+            default: if(inverse) fft_radixn<true>(p,m,s,w,x,y); else fft_radixn<false>(p,m,s,w,x,y);
+        }
+        len = m,s *= p;
+        x = y;
+        y = y == dst?scratch:dst;
+    }
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::FFT::Complex(t_sample *dst,const t_sample *src,t_sample *scratch,bool inverse) const
+{
+    FLEXT_ASSERT(!real);
+    Stages(dst,src,scratch,inverse);
+}
+
+/*! The n real samples are transformed as n/2 complex values z = x[2k]+i*x[2k+1] with Z = FFT(z).
+    With the transforms E and O of the even and odd samples, Z[k] = E[k]+i*O[k] and
+    X[k] = E[k]+w^k*O[k], where E[k] = (Z[k]+conj(Z[h-k]))/2 and O[k] = -i*(Z[k]-conj(Z[h-k]))/2
+*/
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::FFT::Forward(t_sample *dst,const t_sample *src,t_sample *scratch) const
+{
+    FLEXT_ASSERT(real);
+    const int h = n/2;
+    t_sample *z = scratch;
+    half->Stages(z,src,scratch+n,false);
+
+    const t_sample *w = twiddle;
+    for(int k = 0; k <= h/2; ++k) {
+        // k and h-k are computed together, dst may be src
+        const int l = h-k;
+        const int ki = k%h,li = l%h;
+        const t_sample zkr = z[2*ki],zki = z[2*ki+1],zlr = z[2*li],zli = z[2*li+1];
+
+        // E[k], O[k] and E[l] = conj(E[k]), O[l] = conj(O[k])
+        const t_sample er = (zkr+zlr)*0.5f,ei = (zki-zli)*0.5f;
+        const t_sample or_ = (zki+zli)*0.5f,oi = (zlr-zkr)*0.5f;
+
+        const t_sample wkr = w[2*k],wki = w[2*k+1];
+        dst[2*k] = er+wkr*or_-wki*oi,dst[2*k+1] = ei+wkr*oi+wki*or_;
+
+        const t_sample wlr = w[2*l],wli = w[2*l+1];
+        dst[2*l] = er+wlr*or_+wli*oi,dst[2*l+1] = -ei-wlr*oi+wli*or_;
+    }
+}
+
+/*! The inverse of Forward: Z[k] = E[k]+i*O[k] with E[k] = X[k]+conj(X[h-k]) and O[k] = (X[k]-conj(X[h-k]))*conj(w^k),
+    omitting the factor 1/2 so that the result is scaled by n as for complex transforms
+*/
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::FFT::Inverse(t_sample *dst,const t_sample *src,t_sample *scratch) const
+{
+    FLEXT_ASSERT(real);
+    const int h = n/2;
+    t_sample *z = scratch;
+
+    const t_sample *w = twiddle;
+    for(int k = 0; k < h; ++k) {
+        const int l = h-k;
+        const t_sample xkr = src[2*k],xki = src[2*k+1],xlr = src[2*l],xli = src[2*l+1];
+        const t_sample er = xkr+xlr,ei = xki-xli;
+        const t_sample dr = xkr-xlr,di = xki+xli;
+        // d*conj(w^k)
+        const t_sample wr = w[2*k],wi = w[2*k+1];
+        const t_sample or_ = dr*wr+di*wi,oi = di*wr-dr*wi;
+        z[2*k] = er-oi,z[2*k+1] = ei+or_;
+    }
+
+    half->Stages(dst,z,scratch+n,true);
+}
+
+FLEXT_TEMPIMPL(const FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext))::FFT *FLEXT_CLASSDEF(flext))::GetFFT(int n,bool real)
+{
+    if(n < 1 || (real && (n&1))) return NULL;
+
+    FFT *plan = NULL;
+    for(;;) {
+        FFT *head = FLEXT_TEMPINST(FFTVars)::plans;
+        for(FFT *p = head; p; p = p->nxt)
+            if(p->n == n && p->real == real) {
+                // another thread has been faster
+                if(plan) delete plan;
+                return p;
+            }
+
+        if(!plan) plan = new FFT(n,real);
+        plan->nxt = head;
+        if(lockfree::CAS(&FLEXT_TEMPINST(FFTVars)::plans,head,plan)) return plan;
+    }
+}
+
+#include "flpopns.h"
+
+#endif // __FLEXT_FFT_CPP
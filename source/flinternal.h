@@ -19,6 +19,11 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 
 #include "flstdc.h"
 
+#if !defined(FLEXT_USE_CMEM) && !defined(FLEXT_NOALLOCCACHE) && (FLEXT_THREADS == FLEXT_THR_POSIX || FLEXT_THREADS == FLEXT_THR_WIN32)
+//! flext_root::operator new takes small blocks from per-thread caches
+#define FLEXT_ALLOCCACHE
+#endif
+
 
 #if FLEXT_SYS == FLEXT_SYS_PD
 
@@ -14,7 +14,9 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 #define __FLEXT_ITEM_CPP
 
 #include "flext.h"
+#include "lockfree/cas.hpp"
 #include <cstring>
+#include <new>
 
 #include "flpushns.h"
 
@@ -33,78 +35,253 @@ FLEXT_TEMPIMPL(FLEXT_CLASSDEF(flext_base))::Item::~Item()
 }
 
 FLEXT_TEMPIMPL(FLEXT_CLASSDEF(flext_base))::ItemCont::ItemCont():
-    members(0),memsize(0),size(0),cont(NULL)
+    members(0),table(NULL),
+    readers(0),lock(0),retired(NULL),
+    dispatch(NULL),dispatchcnt(0),
+    frozen(NULL),frozenitems(NULL),frozencnt(0)
 {}
 
 FLEXT_TEMPIMPL(FLEXT_CLASSDEF(flext_base))::ItemCont::~ItemCont()
 {
-    if(cont) {
-        for(int i = 0; i < size; ++i) delete cont[i];
-        delete[] cont;
+    ClearDispatch();
+    // there are no readers any more
+    for(Retired *r = retired; r; ) {
+        Retired *n = r->nxt;
+        Free(r);
+        r = n;
+    }
+    if(table) {
+        if(frozen) {
+            // the frozen items are not individually allocated
+            for(int i = 0; i < table->size; ++i) table->sets[i]->TablePtrMapDef::clear();
+            ReleaseFrozen();
+        }
+        for(int i = 0; i < table->size; ++i) delete table->sets[i];
+        delete[] (char *)table;
     }
 }
 
-FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ItemCont::Resize(int nsz)
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::NewCont(ItemCont *volatile &head)
 {
-    if(nsz > memsize) {
-        int nmemsz = nsz+10;  // increment maximum allocation size
-        ItemSet **ncont = new ItemSet *[nmemsz]; // make new array
-        if(cont) {
-            memcpy(ncont,cont,size*sizeof(*cont)); // copy existing entries
-            delete[] cont; 
-        }
-        cont = ncont;  // set current array
-        memsize = nmemsz;  // set new allocation size
+    ItemCont *c = new ItemCont;
+    if(!lockfree::CAS(&head,(ItemCont *)NULL,c))
+        // another thread was faster
+        delete c;
+}
+
+// --- readers and writers --------------------------------------
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ItemCont::Enter()
+{
+    long r;
+    do r = readers; while(!lockfree::CAS(&readers,r,r+1));
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ItemCont::Leave()
+{
+    long r;
+    do r = readers; while(!lockfree::CAS(&readers,r,r-1));
+    // the last reader frees what has been retired meanwhile, unless a writer is busy (it will do it)
+    if(r == 1 && retired && lockfree::CAS(&lock,0L,1L)) {
+        Reclaim();
+        Unlock();
+    }
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ItemCont::Lock()
+{
+    while(!lockfree::CAS(&lock,0L,1L)) {}
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ItemCont::Unlock()
+{
+    lockfree::store_release(&lock,0L);
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ItemCont::Retire(int kind,void *ptr)
+{
+    Retired *r = new Retired;
+    r->kind = kind;
+    r->ptr = ptr;
+    r->nxt = retired;
+    retired = r;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ItemCont::Reclaim()
+{
+    if(!retired) return;
+    // the new table must be visible before the readers are counted
+    lockfree::memory_barrier();
+    // readers entering from now on can't see the retired objects
+    if(readers) return;
+
+    Retired *r = retired;
+    retired = NULL;
+    while(r) {
+        Retired *n = r->nxt;
+        Free(r);
+        r = n;
+    }
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ItemCont::Free(Retired *r)
+{
+    switch(r->kind) {
+    case ret_table:
+        delete[] (char *)r->ptr;
+        break;
+    case ret_set: {
+        // the items now belong to the new set
+        ItemSet *set = (ItemSet *)r->ptr;
+        set->TablePtrMapDef::clear();
+        delete set;
+        break;
+    }
+    case ret_item: {
+        Item *it = (Item *)r->ptr;
+        it->nxt = NULL;
+        delete it;
+        break;
+    }
+    case ret_dispatch: {
+        Dispatch *volatile *b = (Dispatch *volatile *)r->ptr;
+        for(int i = 0; i < dispatchbuckets; ++i)
+            for(Dispatch *d = b[i]; d; ) {
+                Dispatch *n = d->nxt;
+                if(d->dist) delete[] d->dist;
+                delete d;
+                d = n;
+            }
+        delete[] b;
+        break;
+    }
+    default:
+        FLEXT_ASSERT(false);
     }
+    delete r;
+}
+
+FLEXT_TEMPIMPL(FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext_base))::ItemSet *FLEXT_CLASSDEF(flext_base))::ItemCont::CopySet(const ItemSet &set)
+{
+    ItemSet *nset = new ItemSet;
+    for(FLEXT_TEMP_TYPENAME TablePtrMapDef::iterator it(set); it; ++it)
+        nset->insert(it.key(),it.data());
+    return nset;
+}
+
+// --- modification ---------------------------------------------
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ItemCont::Resize(int nsz)
+{
+    Table *old = table;
+    const int size = old?old->size:0;
+    if(nsz <= size) return;
 
-    // make new items
-    while(size < nsz) cont[size++] = new ItemSet;
+    Table *t = (Table *)new char[sizeof(Table)+(nsz-1)*sizeof(ItemSet *)];
+    t->size = nsz;
+    // the existing sets are shared with the new table
+    int i = 0;
+    for(; i < size; ++i) t->sets[i] = old->sets[i];
+    // make new sets
+    for(; i < nsz; ++i) t->sets[i] = new ItemSet;
+
+    lockfree::store_release(&table,t);
+    if(old) Retire(ret_table,old);
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ItemCont::Replace(int inlet,ItemSet *set)
+{
+    Table *old = table;
+    FLEXT_ASSERT(old && inlet+1 < old->size);
+
+    Table *t = (Table *)new char[sizeof(Table)+(old->size-1)*sizeof(ItemSet *)];
+    t->size = old->size;
+    for(int i = 0; i < t->size; ++i) t->sets[i] = old->sets[i];
+    t->sets[inlet+1] = set;
+
+    lockfree::store_release(&table,t);
+    Retire(ret_set,old->sets[inlet+1]);
+    Retire(ret_table,old);
 }
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ItemCont::Add(Item *item,const t_symbol *tag,int inlet)
 {
     FLEXT_ASSERT(tag);
 
+    Lock();
+    ClearDispatch();
+    Thaw();
     if(!Contained(inlet)) Resize(inlet+2);
     ItemSet &set = GetInlet(inlet);
     Item *lst = set.find(tag);
     if(!lst) { 
-        Item *old = set.insert(tag,lst = item);
+        // readers may be in the set, insert into a copy
+        ItemSet *nset = CopySet(set);
+        Item *old = nset->insert(tag,item);
         FLEXT_ASSERT(!old);
+        Replace(inlet,nset);
+    }
+    else {
+        while(lst->nxt) lst = lst->nxt;
+        // append, the item is complete before readers can see it
+        lockfree::store_release(&lst->nxt,item);
     }
-    else
-        for(;;)
-            if(!lst->nxt) { lst->nxt = item; break; }
-            else lst = lst->nxt;
     members++;
+    Reclaim();
+    Unlock();
 }
 
 FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::ItemCont::Remove(Item *item,const t_symbol *tag,int inlet,bool free)
 {
     FLEXT_ASSERT(tag);
 
+    Lock();
+    ClearDispatch();
+    if(frozen && Contained(inlet)) {
+        // thawing makes new items, find the one at the same position in the list
+        int pos = 0;
+        Item *lit = GetInlet(inlet).find(tag);
+        for(; lit && lit != item; lit = lit->nxt) ++pos;
+        if(!lit) { Unlock(); return false; }
+        Thaw();
+        for(item = GetInlet(inlet).find(tag); pos--; item = item->nxt) {}
+    }
+
+    bool ok = false;
     if(Contained(inlet)) {
         ItemSet &set = GetInlet(inlet);
         Item *lit = set.find(tag);
         for(Item *prv = NULL; lit; prv = lit,lit = lit->nxt) {
             if(lit == item) {
-                if(prv) prv->nxt = lit->nxt;
-                else if(lit->nxt) {
-                    Item *old = set.insert(tag,lit->nxt);
-                    FLEXT_ASSERT(!old);
-                }
+                if(prv) 
+                    // readers on the item still find its successor
+                    lockfree::store_release(&prv->nxt,lit->nxt);
                 else {
-                    Item *l = set.remove(tag);
-                    FLEXT_ASSERT(l == lit);
+                    ItemSet *nset = CopySet(set);
+                    if(lit->nxt) {
+                        Item *old = nset->insert(tag,lit->nxt);
+                        FLEXT_ASSERT(old == lit);
+                    }
+                    else {
+                        Item *l = nset->remove(tag);
+                        FLEXT_ASSERT(l == lit);
+                    }
+                    Replace(inlet,nset);
                 }
 
-                lit->nxt = NULL; 
-                if(free) delete lit;
-                return true;
+                if(free) 
+                    Retire(ret_item,lit);
+                else
+                    // the caller takes the item
+                    lit->nxt = NULL; 
+                ok = true;
+                break;
             }
         }
     }
-    return false;
+    Reclaim();
+    Unlock();
+    return ok;
 }
 
 FLEXT_TEMPIMPL(FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext_base))::Item *FLEXT_CLASSDEF(flext_base))::ItemCont::FindList(const t_symbol *tag,int inlet)
@@ -113,6 +290,184 @@ FLEXT_TEMPIMPL(FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext_base))::Item *FLEXT_CLASSDEF(f
     return Contained(inlet)?GetInlet(inlet).find(tag):NULL;
 }
 
+// --- frozen containers ----------------------------------------
+
+//! Copy a method item (without its successor) to mem, or the heap if mem is NULL
+FLEXT_TEMPIMPL(FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext_base))::MethItem *FLEXT_CLASSDEF(flext_base))::ItemCont::CopyItem(const MethItem *src,void *mem,metharg *args)
+{
+    MethItem *dst = mem?new(mem) MethItem(src->attr):new MethItem(src->attr);
+    dst->index = src->index;
+    dst->fun = src->fun;
+    dst->argc = src->argc;
+    if(src->argc) {
+        if(!args) args = new metharg[src->argc];
+        memcpy(args,src->args,src->argc*sizeof(*args));
+        dst->args = args;
+    }
+    return dst;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ItemCont::Freeze()
+{
+    if(frozen) return;
+
+    ItemSet *const *sets = table?table->sets:NULL;
+    const int size = table?table->size:0;
+    int cnt = 0,nargs = 0;
+    int i;
+    for(i = 0; i < size; ++i)
+        for(FLEXT_TEMP_TYPENAME TablePtrMapDef::iterator it(*sets[i]); it; ++it)
+            for(Item *l = it.data(); l; l = l->nxt) {
+                ++cnt;
+                nargs += ((MethItem *)l)->argc;
+            }
+    if(!cnt) return;
+
+    ClearDispatch();
+
+    // one block, aligned to the cache line
+    frozen = new char[cnt*sizeof(MethItem)+nargs*sizeof(metharg)+63];
+    MethItem *items = (MethItem *)(((size_t)frozen+63)&~(size_t)63);
+    metharg *args = (metharg *)(items+cnt);
+
+    int ix = 0;
+    for(i = 0; i < size; ++i)
+        for(FLEXT_TEMP_TYPENAME TablePtrMapDef::iterator it(*sets[i]); it; ++it) {
+            Item *first = NULL,*prv = NULL;
+            for(Item *l = it.data(); l; ) {
+                MethItem *src = (MethItem *)l;
+                MethItem *dst = CopyItem(src,items+ix++,args);
+                args += src->argc;
+                if(prv) prv->nxt = dst; else first = dst;
+                prv = dst;
+
+                l = src->nxt;
+                src->nxt = NULL;
+                delete src;
+            }
+            // replaces the value, the set itself doesn't change
+            sets[i]->insert(it.key(),first);
+        }
+    FLEXT_ASSERT(ix == cnt);
+
+    frozenitems = items;
+    frozencnt = cnt;
+    Reclaim();
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ItemCont::Thaw()
+{
+    if(!frozen) return;
+
+    ClearDispatch();
+
+    ItemSet *const *sets = table->sets;
+    for(int i = 0; i < table->size; ++i)
+        for(FLEXT_TEMP_TYPENAME TablePtrMapDef::iterator it(*sets[i]); it; ++it) {
+            Item *first = NULL,*prv = NULL;
+            for(Item *l = it.data(); l; l = l->nxt) {
+                MethItem *dst = CopyItem((MethItem *)l,NULL,NULL);
+                if(prv) prv->nxt = dst; else first = dst;
+                prv = dst;
+            }
+            sets[i]->insert(it.key(),first);
+        }
+
+    ReleaseFrozen();
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ItemCont::ReleaseFrozen()
+{
+    for(int i = 0; i < frozencnt; ++i) {
+        MethItem &m = frozenitems[i];
+        // successors and arguments belong to the block
+        m.nxt = NULL;
+        m.args = NULL;
+        m.~MethItem();
+    }
+    delete[] frozen;
+    frozen = NULL;
+    frozenitems = NULL;
+    frozencnt = 0;
+}
+
+// --- dispatch cache -------------------------------------------
+
+inline int dispatchbucket(int inlet,const t_symbol *tag,unsigned long sig,int n)
+{
+    const size_t h = (reinterpret_cast<size_t>(tag)>>3)^(sig*31)^(inlet*101);
+    return (int)((h^(h>>7))&(n-1));
+}
+
+FLEXT_TEMPIMPL(const FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext_base))::ItemCont::Dispatch *FLEXT_CLASSDEF(flext_base))::ItemCont::FindDispatch(int inlet,const t_symbol *tag,unsigned long sig) const
+{
+    Dispatch *const volatile *b = dispatch;
+    if(b)
+        for(const Dispatch *d = b[dispatchbucket(inlet,tag,sig,dispatchbuckets)]; d; d = d->nxt)
+            if(d->tag == tag && d->sig == sig && d->inlet == inlet) return d;
+    return NULL;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ItemCont::AddDispatch(int inlet,const t_symbol *tag,unsigned long sig,Item *item,const t_symbol *via,int mode,int dist)
+{
+    // limit the size, e.g. for messages with many different selectors
+    if(dispatchcnt >= dispatchmax) return;
+
+    Dispatch *volatile *b = dispatch;
+    if(!b) {
+        b = new Dispatch *volatile[dispatchbuckets];
+        for(int i = 0; i < dispatchbuckets; ++i) b[i] = NULL;
+        if(!lockfree::CAS(&dispatch,(Dispatch *volatile *)NULL,b)) {
+            // another thread was faster
+            delete[] b;
+            b = dispatch;
+        }
+    }
+
+    Dispatch *d = new Dispatch;
+    d->tag = tag;
+    d->inlet = inlet;
+    d->sig = sig;
+    d->item = item;
+    d->via = via;
+    d->mode = mode;
+    d->distcnt = dist;
+    if(dist) {
+        const int n = dist*dist_types;
+        d->dist = new const Dispatch *volatile[n];
+        for(int i = 0; i < n; ++i) d->dist[i] = NULL;
+    }
+    else
+        d->dist = NULL;
+
+    Dispatch *volatile &head = b[dispatchbucket(inlet,tag,sig,dispatchbuckets)];
+    for(;;) {
+        Dispatch *h = head;
+        // entry may have just been added by another thread
+        for(const Dispatch *e = h; e; e = e->nxt)
+            if(e->tag == tag && e->sig == sig && e->inlet == inlet) { 
+                if(d->dist) delete[] d->dist;
+                delete d; 
+                return; 
+            }
+        d->nxt = h;
+        lockfree::memory_barrier();
+        if(lockfree::CAS(&head,h,d)) break;
+    }
+    ++dispatchcnt;
+}
+
+//! \note The cache of the class methods is read without a Reader guard, they are only changed during class setup
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ItemCont::ClearDispatch()
+{
+    Dispatch *volatile *b = dispatch;
+    if(b) {
+        dispatch = NULL;
+        dispatchcnt = 0;
+        Retire(ret_dispatch,(void *)b);
+    }
+}
+
 // --- class item lists (methods and attributes) ----------------
 
 /*
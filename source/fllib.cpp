@@ -147,10 +147,17 @@ public:
 	void (*freefun)(flext_hdr *c);
 
 	int argc;
-	int *argv;
+    //! creation plan: default values (and so the expected types) of the creation arguments
+	t_atom *defargs;
+    //! number of leading arguments without default
+    int argreq;
 
 	flext_library *lib;
-    bool dsp:1,noi:1,attr:1,dist:1;
+    bool dsp:1,noi:1,attr:1,dist:1,ftz:1,nolock:1,mc:1,single:1;
+
+    //! class setup function, NULL once it has been run
+    void (*setupfun)(FLEXT_TEMPINST(flext_class) *);
+    const char *idname;
 
     flext_base::ItemCont meths,attrs;
 };
@@ -158,8 +165,9 @@ public:
 FLEXT_TEMPIMPL(flext_class)::flext_class(t_class *&cl,flext_obj *(*newf)(int,t_atom *),void (*freef)(flext_hdr *)):
 	clss(cl),
 	newfun(newf),freefun(freef),
-	argc(0),argv(NULL) 
-    , dist(false)
+	argc(0),defargs(NULL),argreq(0) 
+    , dist(false),ftz(false),nolock(false),mc(false),single(false)
+    , setupfun(NULL),idname(NULL)
 {}
 
 FLEXT_TEMPIMPL(LibMap *FLEXT_CLASSDEF(flext_obj))::libnames = NULL;
@@ -168,15 +176,12 @@ FLEXT_TEMPIMPL(LibMap *FLEXT_CLASSDEF(flext_obj))::libnames = NULL;
 FLEXT_TEMPIMPL(FLEXT_TEMPINST(flext_class) *FLEXT_CLASSDEF(flext_obj))::FindName(const t_symbol *s,FLEXT_TEMPINST(flext_class) *o)
 {
 	if(!libnames) libnames = new LibMap;
-	LibMap::iterator it = libnames->find(s);
-	if(it != libnames->end())
-		return it->second;
-	else if(o) {
-		(*libnames)[s] = o;
-		return o;
+	FLEXT_TEMPINST(flext_class) *c = libnames->find(s);
+	if(!c && o) {
+		libnames->insert(s,o);
+		c = o;
 	}
-	else
-		return NULL;
+	return c;
 }
 
 
@@ -186,6 +191,28 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_obj))::IsDSP(t_classid cl) { return cl-
 FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_obj))::HasDSPIn(t_classid cl) { return !cl->noi; }
 FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_obj))::IsLib(t_classid cl) { return cl->lib != NULL; }
 
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_obj))::flushdenormals = false;
+
+#ifdef FLEXT_LAZYSETUP
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_obj))::lazysetup = true;
+#else
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_obj))::lazysetup = false;
+#endif
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_obj))::SetFlushDenormals(t_classid cl,bool on)
+{
+    if(cl) cl->ftz = on;
+    else flushdenormals = on;
+}
+
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_obj))::GetFlushDenormals(t_classid cl) { return flushdenormals || (cl && cl->ftz); }
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_obj))::SetMultichannel(t_classid cl,bool on) { cl->mc = on; }
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_obj))::GetMultichannel(t_classid cl) { return cl->mc; }
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_obj))::SetSinglePrecision(t_classid cl,bool on) { cl->single = on; }
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_obj))::GetSinglePrecision(t_classid cl) { return cl->single; }
+
 FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_obj))::HasAttributes() const { return clss->attr; }
 FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_obj))::IsDSP() const { return clss->dsp; }
 FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_obj))::HasDSPIn() const { return !clss->noi; }
@@ -287,7 +314,14 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_obj))::obj_add(bool lib,bool dsp,bool n
     *cl = ::class_new(
 		(t_symbol *)nsym,
     	(t_newmethod)obj_new,(t_method)obj_free,
-     	sizeof(flext_hdr),CLASS_DEFAULT,A_GIMME,A_NULL);
+     	sizeof(flext_hdr),
+#ifdef CLASS_MULTICHANNEL
+        // the class setup (which may opt in) comes later, flext passes the first channel to the others
+        dsp?CLASS_DEFAULT|CLASS_MULTICHANNEL:CLASS_DEFAULT,
+#else
+        CLASS_DEFAULT,
+#endif
+        A_GIMME,A_NULL);
 #elif FLEXT_SYS == FLEXT_SYS_MAX
 	if(!lib) {
 		::setup(
@@ -322,12 +356,22 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_obj))::obj_add(bool lib,bool dsp,bool n
 		for(argtp = argtp1; argtp != FLEXTTPN_NULL; ++lo->argc) argtp = (int)va_arg(marker,int); 
 		va_end(marker);
 
-		lo->argv = new int[lo->argc];
+		lo->defargs = new t_atom[lo->argc];
 	
-		// now parse and store
+		// now parse and store the creation plan
 		va_start(marker,argtp1);
 		for(argtp = argtp1,i = 0; i < lo->argc; ++i) {
-			lo->argv[i] = argtp;
+			switch(argtp) {
+#if FLEXT_SYS != FLEXT_SYS_PD
+			case FLEXTTPN_INT: lo->argreq = i+1; // fall through
+			case FLEXTTPN_DEFINT: SetInt(lo->defargs[i],0); break;
+#endif
+			case FLEXTTPN_FLOAT: lo->argreq = i+1; // fall through
+			case FLEXTTPN_DEFFLOAT: SetFloat(lo->defargs[i],0); break;
+			case FLEXTTPN_SYM: lo->argreq = i+1; // fall through
+			case FLEXTTPN_DEFSYM: SetSymbol(lo->defargs[i],sym__); break;
+			default: ERRINTERNAL(); SetSymbol(lo->defargs[i],sym__);
+			}
 			argtp = (int)va_arg(marker,int); 
 		}
 		va_end(marker);
@@ -372,18 +416,37 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_obj))::obj_add(bool lib,bool dsp,bool n
 #endif	
 	}
 
+    lo->setupfun = setupfun;
+    lo->idname = idname;
+
+#if FLEXT_SYS == FLEXT_SYS_PD
+    // with lazy setup the class is completed with its first object (see obj_new)
+    if(!lazysetup)
+#endif
+        obj_setup(lo);
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_obj))::obj_setup(FLEXT_TEMPINST(flext_class) *lo)
+{
+    void (*setupfun)(t_classid) = lo->setupfun;
+    if(!setupfun) return;
+    // only once, even if it fails
+    lo->setupfun = NULL;
+
     try {
 	    // call class setup function
-        setupfun(clid);
+        setupfun(lo);
+        // methods are usually not added later on, compact the class table
+        flext_base::ClMeths(lo)->Freeze();
     }
     catch(std::exception &x) {
-        error("%s: %s",idname,x.what());
+        error("%s: %s",lo->idname,x.what());
     }
     catch(char *txt) {
-        error("%s: %s",idname,txt);
+        error("%s: %s",lo->idname,txt);
     }
     catch(...) {
-    	error("%s - Unknown exception while initializing class",idname);
+    	error("%s - Unknown exception while initializing class",lo->idname);
     }
 }
 	
@@ -406,6 +469,9 @@ FLEXT_TEMPIMPL(flext_hdr *FLEXT_CLASSDEF(flext_obj))::obj_new(const t_symbol *s,
 	if(lo) {
 //		post("NEWOBJ %s = %p -> %p",GetString(s),lo,lo->clss);
 
+        // complete a lazily registered class
+        if(UNLIKELY(lo->setupfun)) obj_setup(lo);
+
 		bool ok = true;
 		t_atom args[NEWARGS]; 
 
@@ -421,41 +487,21 @@ FLEXT_TEMPIMPL(flext_hdr *FLEXT_CLASSDEF(flext_obj))::obj_new(const t_symbol *s,
 
 			int misnum = 0;
 			if(argc > lo->argc) { ok = false; misnum = 1; }
-
-			for(int i = 0; ok && i < lo->argc; ++i) {
-				switch(lo->argv[i]) {
+			else if(argc < lo->argreq) { ok = false; misnum = -1; }
+			else {
+				// missing arguments take the defaults of the plan
+				CopyAtoms(lo->argc-argc,args+argc,lo->defargs+argc);
+
+				// \todo shall we analyze the patcher args????... should already be done!
+				for(int i = 0; ok && i < argc; ++i) {
+					const t_atom &def = lo->defargs[i];
+					if(GetType(argv[i]) == GetType(def)) args[i] = argv[i];
 #if FLEXT_SYS != FLEXT_SYS_PD
-				case FLEXTTPN_INT:
-				case FLEXTTPN_DEFINT:
-					if(i >= argc)
-						if(lo->argv[i] == FLEXTTPN_DEFINT) SetInt(args[i],0);
-						else { misnum = -1,ok = false; break; }
-					else if(IsInt(argv[i])) args[i] = argv[i];
-					else if(IsFloat(argv[i])) SetInt(args[i],(int)GetFloat(argv[i]));
-					else ok = false;
-					break;
+					else if(IsInt(def) && IsFloat(argv[i])) SetInt(args[i],(int)GetFloat(argv[i]));
+					else if(IsFloat(def) && IsInt(argv[i])) SetFloat(args[i],(float)GetInt(argv[i]));
 #endif
-				case FLEXTTPN_FLOAT:
-				case FLEXTTPN_DEFFLOAT:
-					if(i >= argc)
-						if(lo->argv[i] == FLEXTTPN_DEFFLOAT) SetFloat(args[i],0);
-						else { misnum = -1,ok = false; break; }
-					else if(IsInt(argv[i])) SetFloat(args[i],(float)GetInt(argv[i]));
-					else if(IsFloat(argv[i])) args[i] = argv[i];
-					else ok = false;
-					break;
-				case FLEXTTPN_SYM:
-				case FLEXTTPN_DEFSYM:
-					// \todo shall we analyze the patcher args????... should already be done!
-					if(i >= argc)
-						if(lo->argv[i] == FLEXTTPN_DEFSYM) SetSymbol(args[i],sym__);
-						else { misnum = -1,ok = false; break; }
-					else if(IsSymbol(argv[i]))
-//							SetSymbol(args[i],GetParamSym(GetSymbol(argv[i]),NULL));
-						args[i] = argv[i];
 					else ok = false;
-					break;
-				}	
+				}
 			}
 
 			if(!ok) {
@@ -542,8 +588,8 @@ FLEXT_TEMPIMPL(flext_hdr *FLEXT_CLASSDEF(flext_obj))::obj_new(const t_symbol *s,
 
             if(ok) {
 #if FLEXT_SYS == FLEXT_SYS_MAX
-                // create object-specific thread lock
-                critical_new(&obj->data->lock);
+                // enable the object-specific thread lock (created on first use)
+                if(!lo->nolock) obj->data->locking = true;
 #endif
             }
             else { 
@@ -582,7 +628,7 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_obj))::obj_free(flext_hdr *h)
 
 #if FLEXT_SYS == FLEXT_SYS_MAX
             // free object-specific thread lock
-            critical_free(hdr->data->lock);
+            if(hdr->data->lock) critical_free(hdr->data->lock);
 #endif
 
 		    // now call object destructor and deallocate
@@ -618,6 +664,7 @@ FLEXT_TEMPIMPL(t_class *FLEXT_CLASSDEF(flext_obj))::thisClass() const
 }
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::SetDist(t_classid c,bool d) { c->dist = d; }
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_obj))::SetNoLock(t_classid c,bool nolock) { c->nolock = nolock; }
 FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::DoDist() const { return thisClassId()->dist; }
 
 FLEXT_TEMPIMPL(FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext_base))::ItemCont *FLEXT_CLASSDEF(flext_base))::ClMeths(t_classid c) { return &c->meths; }
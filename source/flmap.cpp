@@ -250,6 +250,107 @@ FLEXT_TEMPIMPL(void TableAnyMap)::iterator::forward()
 	}
 }
 
+FLEXT_TEMPIMPL(TableHashMap)::~TableHashMap() { if(data != fixed) delete[] data; }
+
+FLEXT_TEMPIMPL(void TableHashMap)::clear()
+{
+    if(data != fixed) {
+        // back to the initial slots
+        delete[] data;
+        data = fixed;
+        mask = fixedmask;
+        _setshift();
+    }
+    for(size_t i = 0; i <= mask; ++i) data[i].value = NULL;
+    n = 0;
+}
+
+FLEXT_TEMPIMPL(void TableHashMap)::_place(Data c,size_t i,size_t d)
+{
+    for(;; i = (i+1)&mask,++d) {
+        Data &s = data[i];
+        if(!s.value) { 
+            s = c; 
+            return; 
+        }
+        const size_t sd = _dist(s.key,i);
+        if(sd < d) {
+            // take the slot from the richer entry and carry that one on
+            const Data x = s; s = c; c = x;
+            d = sd;
+        }
+    }
+}
+
+FLEXT_TEMPIMPL(void TableHashMap)::_grow()
+{
+    Data *old = data;
+    const size_t oldsz = mask+1;
+
+    data = new Data[oldsz*2];
+    mask = oldsz*2-1;
+    _setshift();
+    for(size_t i = 0; i <= mask; ++i) data[i].value = NULL;
+
+    for(size_t i = 0; i < oldsz; ++i)
+        if(old[i].value) _place(old[i],_home(old[i].key),0);
+
+    if(old != fixed) delete[] old;
+}
+
+FLEXT_TEMPIMPL(void *TableHashMap)::insert(size_t k,void *t)
+{
+    FLEXT_ASSERT(t);
+
+    size_t i = _home(k),d = 0;
+    for(;; i = (i+1)&mask,++d) {
+        Data &s = data[i];
+        if(!s.value || _dist(s.key,i) < d) break;
+        if(s.key == k) {
+            // update data in existing slot (same key)
+            void *a = s.value;
+            s.value = t;
+            return a;
+        }
+    }
+
+    // new key: keep the load below 3/4
+    if(UNLIKELY((size_t)(n+1)*4 > (mask+1)*3)) {
+        _grow();
+        i = _home(k),d = 0;
+    }
+
+    Data c;
+    c.key = k,c.value = t;
+    _place(c,i,d);
+    ++n;
+    return NULL;
+}
+
+FLEXT_TEMPIMPL(void *TableHashMap)::remove(size_t k)
+{
+    size_t i = _home(k),d = 0;
+    for(;; i = (i+1)&mask,++d) {
+        const Data &s = data[i];
+        if(!s.value || _dist(s.key,i) < d) return NULL;
+        if(s.key == k) break;
+    }
+
+    void *r = data[i].value;
+
+    // shift the following entries of the cluster back by one
+    for(;;) {
+        const size_t j = (i+1)&mask;
+        const Data &s = data[j];
+        if(!s.value || !_dist(s.key,j)) break;
+        data[i] = s;
+        i = j;
+    }
+    data[i].value = NULL;
+    --n;
+    return r;
+}
+
 #include "flpopns.h"
 
 #endif // __FLEXT_MAP_CPP
@@ -7,7 +7,7 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 */
 
 /*! \file flmap.h
-	\brief special map class (faster and less memory-consuming than std::map)   
+	\brief special map classes (faster and less memory-consuming than std::map)   
 */
 
 #ifndef __FLMAP_H
@@ -186,8 +186,9 @@ private:
     TableAnyMap &operator =(const TableAnyMap &) { return *this; }
 };
 
+//! Ordered map (binary tree of sorted arrays of N slots), iterates in ascending key order
 template <typename K,typename T,int N = 8>
-class TablePtrMap
+class TableTreeMap
     : 
 #if (defined(_MSC_VER) && _MSC_VER < 1300) || defined(__BORLANDC__) || defined(__MWERKS__)
     public  // necessary for VC6
@@ -195,8 +196,8 @@ class TablePtrMap
     FLEXT_TEMPINST(TableAnyMap)
 {
 public:
-    TablePtrMap(): TableAnyMap(0,slots),count(0) {}
-    virtual ~TablePtrMap() { clear(); }
+    TableTreeMap(): TableAnyMap(0,slots),count(0) {}
+    virtual ~TableTreeMap() { clear(); }
 
     virtual void clear() { TableAnyMap::clear(); count = 0; }
 
@@ -204,16 +205,16 @@ public:
 
     inline T insert(K k,T t) 
     { 
-        void *d = TableAnyMap::insert(N,*(size_t *)&k,(void *)t); 
+        void *d = TableAnyMap::insert(N,(size_t)k,(void *)t); 
         if(!d) ++count;
         return (T)d;
     }
 
-    inline T find(K k) const { return (T)TableAnyMap::find(N,*(size_t *)&k); }
+    inline T find(K k) const { return (T)TableAnyMap::find(N,(size_t)k); }
 
     inline T remove(K k) 
     { 
-        void *d = TableAnyMap::remove(N,*(size_t *)&k); 
+        void *d = TableAnyMap::remove(N,(size_t)k); 
         if(LIKELY(d)) --count;
         return (T)d;
     }
@@ -224,7 +225,7 @@ public:
     {
     public:
         iterator() {}
-        iterator(const TablePtrMap &m): TableAnyMap::iterator(m) {}
+        iterator(const TableTreeMap &m): TableAnyMap::iterator(m) {}
         iterator(const iterator &it): TableAnyMap::iterator(it) {}
 
         // this ugly syntax (cast to parent class) is needed for MSVC6 
@@ -239,16 +240,167 @@ public:
     };
 
 protected:
-    TablePtrMap(TableAnyMap *p): TableAnyMap(p,slots),count(0) {}
+    TableTreeMap(TableAnyMap *p): TableAnyMap(p,slots),count(0) {}
 
-    virtual TableAnyMap *_newmap(TableAnyMap *parent) { return new TablePtrMap(parent); }
-    virtual void _delmap(TableAnyMap *map) { delete (TablePtrMap *)map; }
+    virtual TableAnyMap *_newmap(TableAnyMap *parent) { return new TableTreeMap(parent); }
+    virtual void _delmap(TableAnyMap *map) { delete (TableTreeMap *)map; }
 
     int count;
     Data slots[N];
 
 private:
-    explicit TablePtrMap(const TableAnyMap &p) {}
+    explicit TableTreeMap(const TableAnyMap &p) {}
+};
+            
+FLEXT_TEMPLATE
+class FLEXT_SHARE TableHashMap
+{
+public:
+
+    struct Data {
+        size_t key;
+        void *value; // NULL for an empty slot
+    };
+
+protected:
+    // constructor and destructor are protected so that they can't be directly instantiated 
+
+    //! dt is the initial slot array of size sz (a power of 2), owned by the derived class
+    TableHashMap(Data *dt,int sz)
+        : fixed(dt),data(dt)
+        , fixedmask(sz-1),mask(sz-1)
+        , n(0)
+    {
+        FLEXT_ASSERT(sz >= 2 && !(sz&(sz-1)));
+        _setshift();
+        for(int i = 0; i < sz; ++i) data[i].value = NULL;
+    }
+
+    virtual ~TableHashMap();
+
+public:
+
+    void *insert(size_t k,void *t);
+
+    void *find(size_t k) const
+    {
+        // robin hood: stop as soon as the slots are closer to their home than k would be
+        for(size_t i = _home(k),d = 0;; i = (i+1)&mask,++d) {
+            const Data &s = data[i];
+            if(!s.value || _dist(s.key,i) < d) return NULL;
+            if(s.key == k) return s.value;
+        }
+    }
+
+    void *remove(size_t k);
+
+    virtual void clear();
+
+    class FLEXT_SHARE iterator
+    {
+    public:
+        iterator(): map(0) {}
+        iterator(const TableHashMap &m): map(&m),ix(0) { skip(); }
+        iterator(const iterator &it): map(it.map),ix(it.ix) {}
+    
+        iterator &operator =(const iterator &it) { map = it.map,ix = it.ix; return *this; }
+
+        operator bool() const { return map && ix <= map->mask; }
+
+        // no checking here!
+        void *data() const { return map->data[ix].value; }
+        size_t key() const { return map->data[ix].key; }
+
+        iterator &operator ++() { ++ix; skip(); return *this; }  
+
+    protected:
+        void skip() { while(ix <= map->mask && !map->data[ix].value) ++ix; }
+
+        const TableHashMap *map;
+        size_t ix;
+    };
+
+protected:
+
+    //! Fibonacci hashing, the top bits of the product are the slot index
+    static size_t _mul() { return sizeof(size_t) > 4?(((size_t)0x9E3779B9UL << 16) << 16)|0x7F4A7C15UL:(size_t)0x9E3779B9UL; }
+
+    size_t _home(size_t k) const { return (k*_mul()) >> shift; }
+    size_t _dist(size_t k,size_t i) const { return (i-_home(k))&mask; }
+
+    void _setshift() 
+    { 
+        int b = 0;
+        while(((size_t)1 << b) <= mask) ++b;
+        shift = (int)sizeof(size_t)*8-b;
+    }
+
+    //! put a new entry in, starting at slot i with probe distance d
+    void _place(Data c,size_t i,size_t d);
+    void _grow();
+
+    Data *fixed,*data;
+    size_t fixedmask,mask;
+    int shift;
+    int n;
+
+private:
+    // hide, so that it can't be used.....
+    explicit TableHashMap(const TableHashMap &): fixed(NULL),data(NULL) {}
+    TableHashMap &operator =(const TableHashMap &) { return *this; }
+};
+
+/*! \brief Hash map for pointer or integer keys (open addressing with robin hood probing)
+    \param N initial number of slots, held in the object (a power of 2)
+    \note Values must not be NULL, iteration order is unspecified
+*/
+template <typename K,typename T,int N = 8>
+class TablePtrMap
+    : 
+#if (defined(_MSC_VER) && _MSC_VER < 1300) || defined(__BORLANDC__) || defined(__MWERKS__)
+    public  // necessary for VC6
+#endif
+    FLEXT_TEMPINST(TableHashMap)
+{
+public:
+    TablePtrMap(): TableHashMap(slots,N) {}
+    virtual ~TablePtrMap() { clear(); }
+
+    virtual void clear() { TableHashMap::clear(); }
+
+    inline int size() const { return n; }
+
+    inline T insert(K k,T t) { return (T)TableHashMap::insert((size_t)k,(void *)t); }
+
+    inline T find(K k) const { return (T)TableHashMap::find((size_t)k); }
+
+    inline T remove(K k) { return (T)TableHashMap::remove((size_t)k); }
+
+
+    class iterator
+        : TableHashMap::iterator
+    {
+    public:
+        iterator() {}
+        iterator(const TablePtrMap &m): TableHashMap::iterator(m) {}
+        iterator(const iterator &it): TableHashMap::iterator(it) {}
+
+        // this ugly syntax (cast to parent class) is needed for MSVC6 
+
+        inline iterator &operator =(const iterator &it) { ((TableHashMap::iterator &)*this) = it; return *this; }
+
+        inline operator bool() const { return (bool)((TableHashMap::iterator &)*this); } 
+        inline T data() const { return (T)(((TableHashMap::iterator &)*this).data()); }
+        inline K key() const { return (K)(((TableHashMap::iterator &)*this).key()); }
+
+        inline iterator &operator ++() { ++((TableHashMap::iterator &)*this); return *this; }  
+    };
+
+protected:
+    Data slots[N];
+
+private:
+    explicit TablePtrMap(const TablePtrMap &p): TableHashMap(slots,N) {}
 };
             
 #include "flpopns.h"
@@ -88,15 +88,33 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::AddMethod(ItemCont *ma,int inle
     ma->Add(mi,tag,inlet);
 }
 
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::BindInletFloat(int inlet,t_float *var)
+{
+    FLEXT_ASSERT(inlet >= 0);
+    if(inlet >= inbindcnt) {
+        if(!var) return;
+        t_float **nb = new t_float *[inlet+1];
+        int i;
+        for(i = 0; i < inbindcnt; ++i) nb[i] = inbind[i];
+        for(; i <= inlet; ++i) nb[i] = NULL;
+        if(inbind) delete[] inbind;
+        inbind = nb;
+        inbindcnt = inlet+1;
+    }
+    inbind[inlet] = var;
+}
+
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ListMethods(AtomList &la,int inlet) const
 {
-	typedef TablePtrMap<int,const t_symbol *,32> MethList;
+	typedef TableTreeMap<int,const t_symbol *,32> MethList;
     MethList list[2];
     ItemCont *clmethhead = ClMeths(thisClassId());
+    ItemCont *const own = methhead;
+    FLEXT_TEMP_TYPENAME ItemCont::Reader guard(own);
 
     int i;
     for(i = 0; i <= 1; ++i) {
-        ItemCont *a = i?methhead:clmethhead;
+        ItemCont *a = i?own:clmethhead;
         if(a && a->Contained(inlet)) {
             ItemSet &ai = a->GetInlet(inlet);
             for(FLEXT_TEMP_TYPENAME ItemSet::iterator as(ai); as; ++as) {
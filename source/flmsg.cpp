@@ -17,96 +17,122 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 
 #include "flpushns.h"
 
-FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::TryMethTag(Item *lst,const t_symbol *tag,int argc,const t_atom *argv)
+/*! \brief Try to call one method item
+    \return 1 if the message has been handled, 0 if not, -1 if the method refused it and no other method of the list should be tried
+    \param hit ... if given, refusing methods are recorded there
+*/
+FLEXT_TEMPIMPL(int FLEXT_CLASSDEF(flext_base))::TryMethItem(MethItem *m,const t_symbol *tag,int argc,const t_atom *argv,MethHit *hit)
 {
-    for(; lst; lst = lst->nxt) {
-        MethItem *m = (MethItem *)lst;
+//    FLEXT_LOG3("found method tag %s: inlet=%i, argc=%i",GetString(tag),m->inlet,argc);
 
-//        FLEXT_LOG3("found method tag %s: inlet=%i, argc=%i",GetString(tag),m->inlet,argc);
+    bool ret;
     
-        if(m->attr) {
-            // attributes are treated differently
+    if(m->attr) {
+        // attributes are treated differently
+
+        if(m->attr->IsGet())
+            ret = DumpAttrib(tag,m->attr);
+        else
+            ret = SetAttrib(tag,m->attr,argc,argv);
+        if(!ret && hit) hit->failed = true;
+        return ret?1:-1;
+    }
 
-            if(m->attr->IsGet())
-                return DumpAttrib(tag,m->attr);
-            else
-                return SetAttrib(tag,m->attr,argc,argv);
+    if(m->argc == 1) {
+        if(m->args[0] == a_typed) {
+            // the trampoline checks and converts the arguments
+            const int r = ((methfun_T)m->fun)(this,argc,argv);
+            if(r < 0 && hit) hit->failed = true;
+            return r;
         }
-        else {
-            if(m->argc == 1) {
-                if(m->args[0] == a_list) {
-                    // try list
-                    if(((methfun_V)m->fun)(this,argc,const_cast<t_atom *>(argv))) return true;
-                }
-                else if(m->args[0] == a_any) {
-                    // try anything
-                    if(((methfun_A)m->fun)(this,tag,argc,const_cast<t_atom *>(argv))) return true;
-                }
-            }
+        else if(m->args[0] == a_list) {
+            // try list
+            if(((methfun_V)m->fun)(this,argc,const_cast<t_atom *>(argv))) return 1;
+            if(hit) hit->failed = true;
+        }
+        else if(m->args[0] == a_any) {
+            // try anything
+            if(((methfun_A)m->fun)(this,tag,argc,const_cast<t_atom *>(argv))) return 1;
+            if(hit) hit->failed = true;
+        }
+    }
 
-            // try matching number of args
-            if(m->argc == argc) {
-                int ix;
-                t_any aargs[FLEXT_MAXMETHARGS];
-                bool ok = true;
-                for(ix = 0; ix < argc && ok; ++ix) {
-                    switch(m->args[ix]) {
-                    case a_float: {
-                        if(IsFloat(argv[ix])) aargs[ix].ft = GetFloat(argv[ix]);
-                        else if(IsInt(argv[ix])) aargs[ix].ft = (float)GetInt(argv[ix]);
-                        else ok = false;
-                        
-                        if(ok) FLEXT_LOG2("int arg %i = %f",ix,aargs[ix].ft);
-                        break;
-                    }
-                    case a_int: {
-                        if(IsFloat(argv[ix])) aargs[ix].it = (int)GetFloat(argv[ix]);
-                        else if(IsInt(argv[ix])) aargs[ix].it = GetInt(argv[ix]);
-                        else ok = false;
-                        
-                        if(ok) FLEXT_LOG2("float arg %i = %i",ix,aargs[ix].it);
-                        break;
-                    }
-                    case a_symbol: {
-                        if(IsSymbol(argv[ix])) aargs[ix].st = GetSymbol(argv[ix]);
-                        else ok = false;
-                        
-                        if(ok) FLEXT_LOG2("symbol arg %i = %s",ix,GetString(aargs[ix].st));
-                        break;
-                    }
+    // try matching number of args
+    if(m->argc != argc) return 0;
+
+    int ix;
+    t_any aargs[FLEXT_MAXMETHARGS];
+    bool ok = true;
+    for(ix = 0; ix < argc && ok; ++ix) {
+        switch(m->args[ix]) {
+        case a_float: {
+            if(IsFloat(argv[ix])) aargs[ix].ft = GetFloat(argv[ix]);
+            else if(IsInt(argv[ix])) aargs[ix].ft = (float)GetInt(argv[ix]);
+            else ok = false;
+            
+            if(ok) FLEXT_LOG2("int arg %i = %f",ix,aargs[ix].ft);
+            break;
+        }
+        case a_int: {
+            if(IsFloat(argv[ix])) aargs[ix].it = (int)GetFloat(argv[ix]);
+            else if(IsInt(argv[ix])) aargs[ix].it = GetInt(argv[ix]);
+            else ok = false;
+            
+            if(ok) FLEXT_LOG2("float arg %i = %i",ix,aargs[ix].it);
+            break;
+        }
+        case a_symbol: {
+            if(IsSymbol(argv[ix])) aargs[ix].st = GetSymbol(argv[ix]);
+            else ok = false;
+            
+            if(ok) FLEXT_LOG2("symbol arg %i = %s",ix,GetString(aargs[ix].st));
+            break;
+        }
 #if FLEXT_SYS == FLEXT_SYS_PD
-                    case a_pointer: {
-                        if(IsPointer(argv[ix])) aargs[ix].pt = (t_gpointer *)GetPointer(argv[ix]);
-                        else ok = false;
-                        break;
-                    }
+        case a_pointer: {
+            if(IsPointer(argv[ix])) aargs[ix].pt = (t_gpointer *)GetPointer(argv[ix]);
+            else ok = false;
+            break;
+        }
 #endif
-                    default:
-                        error("Argument type illegal");
-                        ok = false;
-                    }
-                }
+        default:
+            error("Argument type illegal");
+            ok = false;
+        }
+    }
 
-                if(ok && ix == argc) {
-                    switch(argc) {
-                    case 0: return ((methfun_0)m->fun)(this); 
-                    case 1: return ((methfun_1)m->fun)(this,aargs[0]); 
-                    case 2: return ((methfun_2)m->fun)(this,aargs[0],aargs[1]); 
-                    case 3: return ((methfun_3)m->fun)(this,aargs[0],aargs[1],aargs[2]); 
-                    case 4: return ((methfun_4)m->fun)(this,aargs[0],aargs[1],aargs[2],aargs[3]); 
-                    case 5: return ((methfun_5)m->fun)(this,aargs[0],aargs[1],aargs[2],aargs[3],aargs[4]); 
-                    default:
-                        FLEXT_ASSERT(false);
-                    }
-                }
-            }
+    if(!ok || ix != argc) return 0;
+
+    switch(argc) {
+    case 0: ret = ((methfun_0)m->fun)(this); break;
+    case 1: ret = ((methfun_1)m->fun)(this,aargs[0]); break;
+    case 2: ret = ((methfun_2)m->fun)(this,aargs[0],aargs[1]); break;
+    case 3: ret = ((methfun_3)m->fun)(this,aargs[0],aargs[1],aargs[2]); break;
+    case 4: ret = ((methfun_4)m->fun)(this,aargs[0],aargs[1],aargs[2],aargs[3]); break;
+    case 5: ret = ((methfun_5)m->fun)(this,aargs[0],aargs[1],aargs[2],aargs[3],aargs[4]); break;
+    default:
+        FLEXT_ASSERT(false);
+        ret = false;
+    }
+    if(!ret && hit) hit->failed = true;
+    return ret?1:-1;
+}
+
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::TryMethTag(Item *lst,const t_symbol *tag,int argc,const t_atom *argv,MethHit *hit)
+{
+    for(; lst; lst = lst->nxt) {
+        MethItem *m = (MethItem *)lst;
+        const int r = TryMethItem(m,tag,argc,argv,hit);
+        if(r) {
+            if(r > 0 && hit) hit->item = m;
+            return r > 0;
         }
     }
     return false;
 }
 
 
-FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::TryMethAny(Item *lst,const t_symbol *s,int argc,const t_atom *argv)
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::TryMethAny(Item *lst,const t_symbol *s,int argc,const t_atom *argv,MethHit *hit)
 {
     for(; lst; lst = lst->nxt) {
         MethItem *m = (MethItem *)lst;
@@ -114,7 +140,11 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::TryMethAny(Item *lst,const t_sy
         if(!m->IsAttr() && m->argc == 1 && m->args[0] == a_any) {
 //          FLEXT_LOG4("found any method for %s: inlet=%i, symbol=%s, argc=%i",GetString(m->tag),m->inlet,GetString(s),argc);
 
-            if(((methfun_A)m->fun)(this,s,argc,const_cast<t_atom *>(argv))) return true;
+            if(((methfun_A)m->fun)(this,s,argc,const_cast<t_atom *>(argv))) {
+                if(hit) hit->item = m;
+                return true;
+            }
+            if(hit) hit->failed = true;
         }
     }
     return false;
@@ -123,37 +153,131 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::TryMethAny(Item *lst,const t_sy
 /*! \brief Find a method item for a specific tag and arguments
     \remark All attributes are also stored in the method list and retrieved by a member of the method item
 */
-FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::FindMeth(int inlet,const t_symbol *s,int argc,const t_atom *argv)
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::FindMeth(int inlet,const t_symbol *s,int argc,const t_atom *argv,MethHit *hit)
 {
     Item *lst;
     ItemCont *clmethhead = ClMeths(thisClassId());
+    // methods of the object may be added by other threads meanwhile
+    ItemCont *const own = methhead;
+    FLEXT_TEMP_TYPENAME ItemCont::Reader guard(own);
 
     // search for exactly matching tag
-    if(UNLIKELY(methhead) && (lst = methhead->FindList(s,inlet)) != NULL && TryMethTag(lst,s,argc,argv)) return true;
-    if((lst = clmethhead->FindList(s,inlet)) != NULL && TryMethTag(lst,s,argc,argv)) return true;
+    if(UNLIKELY(own) && (lst = own->FindList(s,inlet)) != NULL && TryMethTag(lst,s,argc,argv,hit)) return true;
+    if((lst = clmethhead->FindList(s,inlet)) != NULL && TryMethTag(lst,s,argc,argv,hit)) return true;
 
     // if nothing found try any inlet
-    if(UNLIKELY(methhead) && (lst = methhead->FindList(s,-1)) != NULL && TryMethTag(lst,s,argc,argv)) return true;
-    if((lst = clmethhead->FindList(s,-1)) != NULL && TryMethTag(lst,s,argc,argv)) return true;
+    if(UNLIKELY(own) && (lst = own->FindList(s,-1)) != NULL && TryMethTag(lst,s,argc,argv,hit)) return true;
+    if((lst = clmethhead->FindList(s,-1)) != NULL && TryMethTag(lst,s,argc,argv,hit)) return true;
 
     return false;
 }
 
-FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::FindMethAny(int inlet,const t_symbol *s,int argc,const t_atom *argv)
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::FindMethAny(int inlet,const t_symbol *s,int argc,const t_atom *argv,MethHit *hit)
 {
     Item *lst;
     ItemCont *clmethhead = ClMeths(thisClassId());
+    ItemCont *const own = methhead;
+    FLEXT_TEMP_TYPENAME ItemCont::Reader guard(own);
 
-    if(UNLIKELY(methhead) && (lst = methhead->FindList(sym_anything,inlet)) != NULL && TryMethAny(lst,s,argc,argv)) return true;
-    if((lst = clmethhead->FindList(sym_anything,inlet)) != NULL && TryMethAny(lst,s,argc,argv)) return true;
+    if(UNLIKELY(own) && (lst = own->FindList(sym_anything,inlet)) != NULL && TryMethAny(lst,s,argc,argv,hit)) return true;
+    if((lst = clmethhead->FindList(sym_anything,inlet)) != NULL && TryMethAny(lst,s,argc,argv,hit)) return true;
 
     // if nothing found try any inlet
-    if(UNLIKELY(methhead) && (lst = methhead->FindList(sym_anything,-1)) != NULL && TryMethAny(lst,s,argc,argv)) return true;
-    if((lst = clmethhead->FindList(sym_anything,-1)) != NULL && TryMethAny(lst,s,argc,argv)) return true;
+    if(UNLIKELY(own) && (lst = own->FindList(sym_anything,-1)) != NULL && TryMethAny(lst,s,argc,argv,hit)) return true;
+    if((lst = clmethhead->FindList(sym_anything,-1)) != NULL && TryMethAny(lst,s,argc,argv,hit)) return true;
 
     return false;
 }
 
+//! Signature of a message for the dispatch cache: argument count and types of the first arguments
+inline unsigned long dispatchsig(int argc,const t_atom *argv)
+{
+    unsigned long sig = argc < 255?argc:255;
+    const int n = argc < FLEXT_MAXMETHARGS?argc:FLEXT_MAXMETHARGS;
+    for(int i = 0; i < n; ++i) {
+        unsigned long t;
+        if(flext::IsFloat(argv[i])) t = 1;
+        else if(flext::IsInt(argv[i])) t = 2;
+        else if(flext::IsSymbol(argv[i])) t = 3;
+#if FLEXT_SYS == FLEXT_SYS_PD && !defined(FLEXT_COMPATIBLE)
+        else if(flext::IsPointer(argv[i])) t = 4;
+#endif
+        else t = 5;
+        sig |= t<<(8+i*3);
+    }
+    return sig;
+}
+
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::CallDispatch(const FLEXT_TEMP_TYPENAME ItemCont::Dispatch &d,const t_symbol *s,int argc,const t_atom *argv)
+{
+    MethItem *m = (MethItem *)d.item;
+    t_atom at;
+    switch(d.mode) {
+    case disp_tag:
+        return TryMethItem(m,d.via,argc,argv) > 0;
+#if FLEXT_SYS == FLEXT_SYS_MAX
+    case disp_int:
+        SetInt(at,(int)GetFloat(argv[0]));
+        return TryMethItem(m,d.via,1,&at) > 0;
+    case disp_float:
+        SetFloat(at,(float)GetInt(argv[0]));
+        return TryMethItem(m,d.via,1,&at) > 0;
+#endif
+    case disp_bang:
+        return TryMethItem(m,d.via,0,NULL) > 0;
+    case disp_sym:
+        SetSymbol(at,s);
+        return TryMethItem(m,d.via,1,&at) > 0;
+    case disp_any:
+        return ((methfun_A)m->fun)(this,s,argc,const_cast<t_atom *>(argv));
+    default:
+        FLEXT_ASSERT(false);
+        return false;
+    }
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::DistList(const FLEXT_TEMP_TYPENAME ItemCont::Dispatch *d,int argc,const t_atom *argv)
+{
+    ItemCont *const cache = d?ClMeths(thisClassId()):NULL;
+
+    int i = incnt;
+    if(i > argc) i = argc;
+    for(--i; i >= 0; --i) { // right to left distribution
+        const t_atom &a = argv[i];
+        const t_symbol *sym;
+        int tp;
+        if(IsFloat(a)) {
+            // variables bound to the inlet take floats (like messages to the inlet)
+            if(SetInletFloat(i,GetFloat(a))) continue;
+            sym = sym_float,tp = dist_float;
+        }
+        else if(IsInt(a)) {
+            if(SetInletFloat(i,(t_float)GetInt(a))) continue;
+            sym = sym_int,tp = dist_int;
+        }
+        else if(IsSymbol(a)) 
+            sym = sym_symbol,tp = dist_symbol;
+#if FLEXT_SYS == FLEXT_SYS_PD && !defined(FLEXT_COMPATIBLE)
+        else if(IsPointer(a)) 
+            sym = sym_pointer,tp = dist_pointer;  // can pointer atoms occur here?
+#endif
+        else 
+            continue;
+
+        if(d && i < d->distcnt) {
+            // the element entry is looked up once, then called directly
+            const FLEXT_TEMP_TYPENAME ItemCont::Dispatch *volatile &slot = d->dist[i*dist_types+tp];
+            const FLEXT_TEMP_TYPENAME ItemCont::Dispatch *e = slot;
+            if(!e && (e = cache->FindDispatch(i,sym,dispatchsig(1,&a))) != NULL) slot = e;
+            curtag = sym;
+            if(e && CallDispatch(*e,sym,1,&a)) continue;
+        }
+
+        // full dispatch, this makes the element entry
+        CbMethodHandler(i,sym,1,&a);
+    }
+}
+
 /*! \brief All the message processing
     The messages of all the inlets go here and are promoted to the registered callback functions
 */
@@ -162,14 +286,41 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::CbMethodHandler(int inlet,const
     static bool trap = false;
     bool ret;
 
+    FLEXT_TRACE_SCOPE("msg",s?GetString(s):"",thisName());
     curtag = s;
 
 #ifdef FLEXT_LOG_MSGS
 	post("methodmain inlet:%i args:%i symbol:%s",inlet,argc,s?GetString(s):"");
 #endif
 
+    // the resolved methods are cached per class, objects with own methods use the full search
+    ItemCont *const cache = UNLIKELY(methhead)?NULL:ClMeths(thisClassId());
+    unsigned long sig = 0;
+    MethHit hit = { NULL,false };
+    // how the method has been found
+    const t_symbol *via = s;
+    int mode = disp_tag;
+
     try {
-        ret = FindMeth(inlet,s,argc,argv);
+        if(LIKELY(cache)) {
+            sig = dispatchsig(argc,argv);
+            const FLEXT_TEMP_TYPENAME ItemCont::Dispatch *d = cache->FindDispatch(inlet,s,sig);
+            if(LIKELY(d)) {
+                if(LIKELY(d->mode != disp_dist))
+                    ret = CallDispatch(*d,s,argc,argv);
+                // the signal inlets may differ between the objects of the class
+                else if((ret = !trap && insigs <= 1) != false) {
+                    trap = true;
+                    DistList(d,argc,argv);
+                    trap = false;
+                }
+                if(LIKELY(ret)) goto end;
+                // the method refused this time, do the full search but don't cache
+                hit.failed = true;
+            }
+        }
+
+        ret = FindMeth(inlet,s,argc,argv,&hit);
 #ifdef FLEXT_LOG_MSGS
 		if(ret) post("found %s message in %s,%i",GetString(s),__FILE__,__LINE__);
 #endif
@@ -179,14 +330,14 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::CbMethodHandler(int inlet,const
             if(s == sym_list) {
                 // for 1-element lists try the single atom (this is the format output by [route])
                 if(IsFloat(argv[0]))
-                    ret = FindMeth(inlet,sym_float,1,argv);
+                    ret = FindMeth(inlet,via = sym_float,1,argv,&hit);
                 else if(IsInt(argv[0]))
-                    ret = FindMeth(inlet,sym_int,1,argv);
+                    ret = FindMeth(inlet,via = sym_int,1,argv,&hit);
                 else if(IsSymbol(argv[0]))
-                    ret = FindMeth(inlet,sym_symbol,1,argv);
+                    ret = FindMeth(inlet,via = sym_symbol,1,argv,&hit);
     #if FLEXT_SYS == FLEXT_SYS_PD && !defined(FLEXT_COMPATIBLE)
                 else if(IsPointer(argv[0]))
-                    ret = FindMeth(inlet,sym_pointer,1,argv);
+                    ret = FindMeth(inlet,via = sym_pointer,1,argv,&hit);
     #endif
                 if(ret) goto end;
             }
@@ -196,11 +347,13 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::CbMethodHandler(int inlet,const
                     t_atom at;
                     // If float message is not explicitly handled: try int handler instead
                     SetInt(at,(int)GetFloat(argv[0]));
-                    ret = FindMeth(inlet,sym_int,1,&at);
+                    ret = FindMeth(inlet,via = sym_int,1,&at,&hit);
+                    mode = disp_int;
                     if(ret) goto end;
+                    mode = disp_tag;
     #endif
                     // If not explicitly handled: try list handler instead
-                    ret = FindMeth(inlet,sym_list,1,argv);
+                    ret = FindMeth(inlet,via = sym_list,1,argv,&hit);
                     if(ret) goto end;
                 }
     #if FLEXT_SYS == FLEXT_SYS_MAX
@@ -208,20 +361,22 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::CbMethodHandler(int inlet,const
                     t_atom at;
                     // If int message is not explicitly handled: try float handler instead
                     SetFloat(at,(float)GetInt(argv[0]));
-                    ret = FindMeth(inlet,sym_float,1,&at);
+                    ret = FindMeth(inlet,via = sym_float,1,&at,&hit);
+                    mode = disp_float;
                     if(ret) goto end;
+                    mode = disp_tag;
                     // If not explicitly handled: try list handler instead
-                    ret = FindMeth(inlet,sym_list,1,argv);
+                    ret = FindMeth(inlet,via = sym_list,1,argv,&hit);
                     if(ret) goto end;
                 }
     #endif
                 else if(s == sym_symbol) {
-                    ret = FindMeth(inlet,sym_list,1,argv);
+                    ret = FindMeth(inlet,via = sym_list,1,argv,&hit);
                     if(ret) goto end;
                 }
     #if FLEXT_SYS == FLEXT_SYS_PD && !defined(FLEXT_COMPATIBLE)
                 else if(s == sym_pointer) {
-                    ret = FindMeth(inlet,sym_list,1,argv);
+                    ret = FindMeth(inlet,via = sym_list,1,argv,&hit);
                     if(ret) goto end;
                 }
     #endif
@@ -229,44 +384,38 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::CbMethodHandler(int inlet,const
         }
         else if(argc == 0) {
             // If symbol message (pure anything without args) is not explicitly handled: try list handler instead
-            if(s == sym_bang)
+            if(s == sym_bang) {
                 // bang is equal to an empty list
-                ret = FindMeth(inlet,sym_list,0,NULL);
+                ret = FindMeth(inlet,via = sym_list,0,NULL,&hit);
+                mode = disp_bang;
+            }
             else {
                 t_atom at;
                 SetSymbol(at,s);
-                ret = FindMeth(inlet,sym_list,1,&at);
+                ret = FindMeth(inlet,via = sym_list,1,&at,&hit);
+                mode = disp_sym;
             }
 #ifdef FLEXT_LOG_MSGS
 			if(ret) post("found %s message in %s,%i",GetString(sym_list),__FILE__,__LINE__);
 #endif
             if(ret) goto end;
+            mode = disp_tag;
         }
 
         // if distmsgs is switched on then distribute list elements over inlets (Max/MSP behavior)
         if(DoDist() && inlet == 0 && s == sym_list && insigs <= 1 && !trap) {
-            int i = incnt;
-            if(i > argc) i = argc;
-            for(--i; i >= 0; --i) { // right to left distribution
-                const t_symbol *sym = NULL;
-                if(IsFloat(argv[i])) sym = sym_float;
-                else if(IsInt(argv[i])) sym = sym_int;
-                else if(IsSymbol(argv[i])) sym = sym_symbol;
-    #if FLEXT_SYS == FLEXT_SYS_PD && !defined(FLEXT_COMPATIBLE)
-                else if(IsPointer(argv[i])) sym = sym_pointer;  // can pointer atoms occur here?
-    #endif
+            trap = true;
+            DistList(NULL,argc,argv);
+            trap = false;
 
-                if(sym) {
-                    trap = true;
-                    CbMethodHandler(i,sym,1,argv+i);
-                    trap = false;
-                }
-            }
-            
+            // cached without an item, the elements are resolved by the next distribution
+            ret = true;
+            mode = disp_dist;
             goto end;
         }
         
-        ret = FindMethAny(inlet,s,argc,argv);
+        ret = FindMethAny(inlet,s,argc,argv,&hit);
+        mode = disp_any;
 
         if(!ret) ret = CbMethodResort(inlet,s,argc,argv);
     }
@@ -284,6 +433,9 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::CbMethodHandler(int inlet,const
     }
 
 end:
+    if(ret && (hit.item || mode == disp_dist) && !hit.failed && cache)
+        cache->AddDispatch(inlet,s,sig,hit.item,via,mode,mode == disp_dist?argc:0);
+
     curtag = NULL;
 
     return ret; // true if appropriate handler was found and called
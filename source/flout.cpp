@@ -46,15 +46,7 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ToSysAtom(int n,const t_atom &a
 #error Not implemented
 #endif
 
-#if defined(FLEXT_THREADS)
-    #if FLEXT_QMODE == 2
-        #define CHKTHR() (LIKELY((!IsThreadRegistered() || IsThread(flext::thrmsgid)) && !InDSP()))
-    #else
-        #define CHKTHR() (LIKELY(!IsThreadRegistered() && !InDSP()))
-    #endif
-#else
-    #define CHKTHR() (LIKELY(!InDSP()))
-#endif
+#define CHKTHR() (LIKELY(flext_base::IsOutputDirect()))
 
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ToOutBang(int n) const
@@ -103,6 +95,11 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::Forward(const t_symbol *recv,const t
     return CHKTHR()?SysForward(recv,s,argc,argv):QueueForward(recv,s,argc,argv); 
 }
 
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::RingForward(ForwardRing *r,const t_symbol *recv,const t_symbol *s,int argc,const t_atom *argv)
+{
+    return CHKTHR()?SysForward(recv,s,argc,argv):QueueForward(r,recv,s,argc,argv); 
+}
+
 
 FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::InitInlets()
 {
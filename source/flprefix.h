@@ -72,6 +72,8 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 #define FLEXT_CPU_IA64   5 // Itanium
 #define FLEXT_CPU_X86_64 6 // AMD-K8, EMT64
 #define FLEXT_CPU_PPC64  7 // G5 in 64 bit mode
+#define FLEXT_CPU_ARM    8
+#define FLEXT_CPU_ARM64  9 // AArch64, e.g. Apple Silicon
 
 // compatibility
 #define FLEXT_CPU_INTEL FLEXT_CPU_IA32
@@ -125,6 +127,10 @@ WARRANTIES, see the file, "license.txt," in this distribution.
             #define FLEXT_CPU FLEXT_CPU_MIPS
         #elif defined(_M_ALPHA)
             #define FLEXT_CPU FLEXT_CPU_ALPHA
+        #elif defined(_M_ARM64)
+            #define FLEXT_CPU FLEXT_CPU_ARM64
+        #elif defined(_M_ARM)
+            #define FLEXT_CPU FLEXT_CPU_ARM
         #else
             #define FLEXT_CPU FLEXT_CPU_UNKNOWN
         #endif
@@ -244,6 +250,10 @@ WARRANTIES, see the file, "license.txt," in this distribution.
             #define FLEXT_CPU FLEXT_CPU_PPC
         #elif defined(__MIPS__)
             #define FLEXT_CPU FLEXT_CPU_MIPS
+        #elif defined(__aarch64__)
+            #define FLEXT_CPU FLEXT_CPU_ARM64
+        #elif defined(__arm__)
+            #define FLEXT_CPU FLEXT_CPU_ARM
         #else
             #define FLEXT_CPU FLEXT_CPU_UNKNOWN
         #endif
@@ -451,6 +461,24 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 #	endif
 #endif
 
+// thread-local storage class (left undefined if not available)
+#if defined(FLEXT_THREADS) && !defined(FLEXT_THREADLOCAL)
+#   if defined(_MSC_VER)
+        // data with thread storage duration can't have a DLL interface
+#       ifndef FLEXT_SHARED
+#           define FLEXT_THREADLOCAL __declspec(thread)
+#       endif
+#   elif defined(__APPLE__) && defined(__clang__)
+        // __has_feature is only known to clang, it must not share the line with the check
+#       if __has_feature(cxx_thread_local) // Xcode 8 and later
+#           define FLEXT_THREADLOCAL __thread
+#       endif
+#   elif defined(__GNUC__)
+        // also Apple GCC, with emulated TLS
+#       define FLEXT_THREADLOCAL __thread
+#   endif
+#endif
+
 // macro definitions for inline flext usage
 #ifdef FLEXT_INLINE
 #   define FLEXT_TEMPLATE template<typename flext_T>
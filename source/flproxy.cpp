@@ -32,6 +32,7 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::px_object::px_bang(px_object *o
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::px_object::px_float(px_object *obj,t_float f)
 {
+    if(obj->base->SetInletFloat(obj->index,f)) return;
     t_atom a; SetFloat(a,f);
     Locker lock(obj->base);
     obj->base->CbMethodHandler(obj->index,sym_float,1,&a);
@@ -67,6 +68,7 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::cb_bang(flext_hdr *c)
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::cb_float(flext_hdr *c,t_float f)
 {
+    if(thisObject(c)->SetInletFloat(0,f)) return;
     t_atom a; SetFloat(a,f);
     Locker lock(c);
     thisObject(c)->CbMethodHandler(0,sym_float,1,&a);
@@ -115,7 +117,7 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::cb_anything(flext_hdr *c,const
 }
 
 #define DEF_PROXYMSG(IX) \
-FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::cb_px_ft ## IX(flext_hdr *c,t_float v) { t_atom atom; SetFloat(atom,v); Locker lock(c); thisObject(c)->CbMethodHandler(IX,sym_float,1,&atom); }
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::cb_px_ft ## IX(flext_hdr *c,t_float v) { if(thisObject(c)->SetInletFloat(IX,v)) return; t_atom atom; SetFloat(atom,v); Locker lock(c); thisObject(c)->CbMethodHandler(IX,sym_float,1,&atom); }
 
 #define ADD_PROXYMSG(c,IX) \
 add_method1(c,cb_px_ft ## IX," ft " #IX,A_FLOAT)
@@ -135,17 +137,20 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::cb_anything(flext_hdr *c,const
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::cb_int(flext_hdr *c,long v)
 {
+    int const ci = proxy_getinlet((t_object *)&c->obj);
+    if(thisObject(c)->SetInletFloat(ci,(t_float)v)) return;
     t_atom atom; SetInt(atom,v);
     Locker lock(c);
-    int const ci = proxy_getinlet((t_object *)&c->obj);
     thisObject(c)->CbMethodHandler(ci,sym_int,1,&atom);
 }
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::cb_float(flext_hdr *c,double v)
 {
+    // floats into signal inlets of MSP objects arrive here
+    int const ci = proxy_getinlet((t_object *)&c->obj);
+    if(thisObject(c)->SetInletFloat(ci,(t_float)v)) return;
     t_atom atom; SetFloat(atom,v);
     Locker lock(c);
-    int const ci = proxy_getinlet((t_object *)&c->obj);
     thisObject(c)->CbMethodHandler(ci,sym_float,1,&atom);
 }
 
@@ -158,8 +163,8 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::cb_bang(flext_hdr *c)
 
 
 #define DEF_PROXYMSG(IX) \
-FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::cb_px_in ## IX(flext_hdr *c,long v) { t_atom atom; SetInt(atom,v); Locker lock(c); thisObject(c)->CbMethodHandler(IX,sym_int,1,&atom); } \
-FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::cb_px_ft ## IX(flext_hdr *c,double v) { t_atom atom; SetFloat(atom,v); Locker lock(c); thisObject(c)->CbMethodHandler(IX,sym_float,1,&atom); }
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::cb_px_in ## IX(flext_hdr *c,long v) { if(thisObject(c)->SetInletFloat(IX,(t_float)v)) return; t_atom atom; SetInt(atom,v); Locker lock(c); thisObject(c)->CbMethodHandler(IX,sym_int,1,&atom); } \
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::cb_px_ft ## IX(flext_hdr *c,double v) { if(thisObject(c)->SetInletFloat(IX,(t_float)v)) return; t_atom atom; SetFloat(atom,v); Locker lock(c); thisObject(c)->CbMethodHandler(IX,sym_float,1,&atom); }
 
 /*
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::cb_px_in ## IX(flext_hdr *c,long v) { t_atom atom; SetInt(atom,v); Locker lock(c); thisObject(c)->CbMethodHandler(IX,sym_int,1,&atom); } \
@@ -20,7 +20,9 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 #include "flext.h"
 #include "flinternal.h"
 #include "flcontainers.h"
+#include "lockfree/atomic_int.hpp"
 #include <cstring> // for memcpy
+#include <cstdio> // for sprintf
 
 #include "flpushns.h"
 
@@ -39,6 +41,21 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::qustarted = false;
 #define PERMANENTIDLE
 #endif
 
+#ifndef FLEXT_QUEUE_BUNDLES
+//! Default number of preallocated message bundles
+#define FLEXT_QUEUE_BUNDLES 256
+#endif
+
+#ifndef FLEXT_QUEUE_BLOCKS
+//! Default number of preallocated atom blocks
+#define FLEXT_QUEUE_BLOCKS 64
+#endif
+
+#ifndef FLEXT_QUEUE_BLOCKSIZE
+//! Default number of atoms per atom block
+#define FLEXT_QUEUE_BLOCKSIZE 64
+#endif
+
 FLEXT_TEMPLATE void Trigger();
 
 FLEXT_TEMPLATE
@@ -49,60 +66,475 @@ public:
     ~QueueFifo();
 };
 
+/*! \brief The message queue, consisting of one lane per priority
+    \note The inherited pooled fifo is only used for recycling heap-allocated bundles.
+*/
 FLEXT_TEMPLATE
 class Queue:
     public flext,
     public FLEXT_TEMPINST(QueueFifo)
 {
 public:
+    inline bool Avail() const { return Avail(prio_control) || Avail(prio_bulk); }
+    inline bool Avail(queue_prio p) const { return lanes[p].Avail() || batch[p].Avail(); }
     inline bool Empty() const { return !Avail(); }
     
-    void Push(MsgBundle *m); // defined after MsgBundle (gcc 3.3. won't take it otherwise...)
+    void Push(MsgBundle *m,queue_prio p = prio_control); // defined after MsgBundle (gcc 3.3. won't take it otherwise...)
+
+    //! Put back a message without triggering the queue
+    void Put(MsgBundle *m,queue_prio p); // defined after MsgBundle
+
+    inline MsgBundle *Get(queue_prio p) { return lanes[p].Get(); }
+
+    //! Get the first message of a lane if it may be dropped, NULL otherwise
+    inline MsgBundle *GetDroppable(queue_prio p) { return lanes[p].GetUntagged(tag_keep); }
+
+    //! Get the next message, control messages first
+    inline MsgBundle *Get()
+    {
+        MsgBundle *m = lanes[prio_control].Get();
+        return m?m:lanes[prio_bulk].Get();
+    }
+
+    /*! \brief Detach all messages of a lane at once, unless there are detached ones left
+        \note Batches belong to the consumer, which is serialized by the system lock
+    */
+    inline void Fetch(queue_prio p) { if(!batch[p].Avail()) batch[p] = lanes[p].GetAll(); }
+
+    //! Get the next message of the detached batch
+    inline MsgBundle *Next(queue_prio p) { return batch[p].Get(); }
+
+private:
+    //! lane tag of messages that must not be dropped
+    enum { tag_keep = 1 };
+
+    TypedFifo<MsgBundle> lanes[prio_count];
+    TypedFifo<MsgBundle>::Batch batch[prio_count];
+};
+
+/*! \brief Preallocated storage for queued messages
+    \note Bundles, bundle parts and atom blocks are recycled lock-free,
+    so that queuing doesn't touch the system allocator as long as the arena suffices.
+*/
+FLEXT_TEMPLATE
+class QArena:
+    public flext
+{
+public:
+    QArena(int bundles,int blocks,int blocksize);
+    ~QArena();
+
+    //! Get a preallocated bundle or NULL if the arena is exhausted
+    inline MsgBundle *NewBundle() { return avail.Get(); }
+
+    //! Return a bundle, false if it hasn't been taken from the arena
+    bool FreeBundle(MsgBundle *m);
+
+    inline void *NewPart() { return parts.Alloc(); }
+
+    inline bool FreePart(void *p)
+    {
+        if(parts.Owns(p)) {
+            parts.Free(p);
+            return true;
+        }
+        else
+            return false;
+    }
+
+    inline t_atom *NewAtoms(int cnt)
+    {
+        return cnt*sizeof(t_atom) <= atoms.BlockSize()?static_cast<t_atom *>(atoms.Alloc()):NULL;
+    }
+
+    inline bool FreeAtoms(t_atom *a)
+    {
+        if(atoms.Owns(a)) {
+            atoms.Free(a);
+            return true;
+        }
+        else
+            return false;
+    }
+
+    //! number of times the arena didn't suffice
+    lockfree::atomic_int<unsigned long> overflows;
+
+private:
+    MsgBundle *bundles;
+    int nbundles;
+    TypedFifo<MsgBundle> avail;
+    BlockPool parts,atoms;
+};
+
+/*! \brief Round-robin scheduler for idle processing
+    \note Tasks can be added from any thread, they are run by the queue consumer only.
+*/
+FLEXT_TEMPLATE
+class IdleSched:
+    public flext
+{
+public:
+    //! Add an idle task
+    inline void Push(MsgBundle *m) { ++count; added.Put(m); }
+
+    inline bool Avail() const { return count > 0; }
+
+    /*! \brief Run the tasks in turn, starting with the one after the last run
+        \param slice time slice per turn in seconds, 0 for a single call
+        \param budget time budget of the pass in seconds, 0 for one turn per task
+        \return true if tasks are left
+    */
+    bool Run(double slice,double budget);
+
+    //! Remove the tasks of an object
+    void Remove(flext_base *t);
+
+private:
+    //! Take over the newly added tasks at the end of the round
+    inline void Collect() { MsgBundle *m; while((m = added.Get()) != NULL) ready.Put(m); }
+
+    TypedFifo<MsgBundle> added,ready;
+    lockfree::atomic_int<int> count;
+};
+
+//! Every n-th queued message is time stamped for the latency histogram (power of 2)
+#define STATSAMPLING 16
+
+/*! \brief Counters of the message queue, see flext::GetQueueStats
+    \note The counters of the producers are atomic and shared by all of them, each padded to a cache line,
+    so that they don't share lines with each other or with the consumer's counters.
+    The rest is maintained by the queue consumer (serialized by the system lock).
+*/
+FLEXT_TEMPLATE
+class QStats:
+    public flext
+{
+public:
+    QStats()
+        : delivered(0),requeued(0),forwarded(0),peak(0)
+        , lastcount(0),lasttime(GetOSTime())
+    {
+        for(int i = 0; i < QueueStats::LatBins; ++i) latency[i] = 0;
+    }
+
+    //! Count a queued message, return its time stamp (0 if not sampled)
+    inline double Pushed()
+    {
+        return UNLIKELY(!(++pushed&(STATSAMPLING-1)))?GetOSTime():0;
+    }
+
+    //! Number of queued messages
+    inline unsigned long Depth() const { return pushed-delivered-dropped; }
+
+    //! Update the peak depth, called by the consumer before a pass
+    inline void Pass()
+    {
+        const unsigned long d = Depth();
+        if(d > peak) peak = d;
+    }
+
+    //! Count a delivery, taking the latency of a time stamped message
+    inline void Sent(double &stamp)
+    {
+        if(UNLIKELY(stamp)) {
+            const double us = (GetOSTime()-stamp)*1.e6;
+            int b = 0;
+            for(double lim = 1; b < QueueStats::LatBins-1 && us >= lim; lim *= 2) ++b;
+            ++latency[b];
+            // re-enqueued messages are only taken once
+            stamp = 0;
+        }
+    }
+
+    void Get(QueueStats &st,bool reset);
+
+    // incremented by all producers
+    lockfree::padded_atomic_int<unsigned long> pushed,dropped,poolhits,poolmisses;
+
+    // maintained by the consumer
+    unsigned long delivered,requeued,forwarded,peak;
+
+private:
+    unsigned long latency[QueueStats::LatBins];
+    unsigned long lastcount;
+    double lasttime;
 };
 
+#if FLEXT_QMODE == 2
+/*! \brief Wake-up of the queue thread
+    \note Triggering only needs the mutex when the queue thread is actually waiting.
+*/
+class QWakeup:
+    public flext::ThrCond
+{
+public:
+    QWakeup(): triggers(0),waiting(0) {}
+
+    //! Number of triggers so far, to be taken before working the queue
+    inline unsigned long Triggers() const { return triggers; }
+
+    //! Wake up the queue thread (with the queue already filled)
+    void Signal()
+    {
+        ++triggers;
+        lockfree::memory_barrier();
+        if(waiting) {
+#if FLEXT_THREADS == FLEXT_THR_POSIX
+            this->Lock(); // use this-> to avoid wrong function invocation (global Lock)
+            waiting = 0;
+            ThrCond::Signal();
+            this->Unlock();
+#else
+            // events remember the signal
+            waiting = 0;
+            ThrCond::Signal();
+#endif
+        }
+    }
+
+    /*! \brief Wait unless triggered since seen
+        \param tmo timeout in seconds, 0 for infinite
+    */
+    void Wait(unsigned long seen,double tmo)
+    {
+        waiting = 1;
+        lockfree::memory_barrier();
+        if(triggers == seen) {
+#if FLEXT_THREADS == FLEXT_THR_POSIX
+            this->Lock();
+            while(waiting && triggers == seen) {
+                if(tmo > 0) {
+                    if(!TimedWaitLocked(tmo)) break; // timed out
+                }
+                else
+                    WaitLocked();
+            }
+            this->Unlock();
+#else
+            if(tmo > 0)
+                ThrCond::TimedWait(tmo);
+            else
+                ThrCond::Wait();
+#endif
+        }
+        waiting = 0;
+    }
+
+private:
+    // incremented by the producers, apart from the consumer's state
+    lockfree::padded_atomic_int<unsigned long> triggers;
+    volatile int waiting;
+};
+#endif
+
 FLEXT_TEMPLATE
 struct QVars {
 #if FLEXT_QMODE == 2
-    static flext::ThrCond *qthrcond;
+    static QWakeup *qthrcond;
+    //! period of idle processing in seconds
+    static double idleperiod;
 #elif FLEXT_QMODE == 0
     static t_clock *qclk;
 #endif
     static FLEXT_TEMPINST(Queue) *queue;
+    static FLEXT_TEMPINST(QArena) *arena;
+    static FLEXT_TEMPINST(IdleSched) *idle;
+    static FLEXT_TEMPINST(QStats) *stats;
+
+    //! forwarding rings of the producer threads (see flext::RingNew), never unlinked
+    static flext::ForwardRing *volatile rings;
+    //! the rings are being drained (by one consumer at a time)
+    static volatile long draining;
+
+    // arena configuration, see flext::SetupQueue
+    static int bundles,blocks,blocksize;
+    static flext::queue_overflow policy;
+
+    // bulk budget per queue pass, see flext::SetQueueBudget
+    static int budgetmsgs;
+    static double budgettime;
+
+    // idle processing budget per queue pass, see flext::SetIdleBudget
+    static double idleslice,idlebudget;
+#if FLEXT_QMODE == 0
+    //! true while the queue clock has been deferred to the next tick
+    static bool deferred;
+#endif
 };
 
 #if FLEXT_QMODE == 2
-FLEXT_TEMPIMPL(flext::ThrCond *QVars)::qthrcond = NULL;
+FLEXT_TEMPIMPL(QWakeup *QVars)::qthrcond = NULL;
+FLEXT_TEMPIMPL(double QVars)::idleperiod = 0.001;
 #elif FLEXT_QMODE == 0
 FLEXT_TEMPIMPL(t_clock *QVars)::qclk = NULL;
 #endif
 FLEXT_TEMPIMPL(FLEXT_TEMPINST(Queue) *QVars)::queue = NULL;
+FLEXT_TEMPIMPL(FLEXT_TEMPINST(QArena) *QVars)::arena = NULL;
+FLEXT_TEMPIMPL(FLEXT_TEMPINST(IdleSched) *QVars)::idle = NULL;
+FLEXT_TEMPIMPL(FLEXT_TEMPINST(QStats) *QVars)::stats = NULL;
+FLEXT_TEMPIMPL(flext::ForwardRing *volatile QVars)::rings = NULL;
+FLEXT_TEMPIMPL(volatile long QVars)::draining = 0;
+FLEXT_TEMPIMPL(int QVars)::bundles = FLEXT_QUEUE_BUNDLES;
+FLEXT_TEMPIMPL(int QVars)::blocks = FLEXT_QUEUE_BLOCKS;
+FLEXT_TEMPIMPL(int QVars)::blocksize = FLEXT_QUEUE_BLOCKSIZE;
+FLEXT_TEMPIMPL(flext::queue_overflow QVars)::policy = flext::queue_heap;
+FLEXT_TEMPIMPL(int QVars)::budgetmsgs = 0;
+FLEXT_TEMPIMPL(double QVars)::budgettime = 0;
+FLEXT_TEMPIMPL(double QVars)::idleslice = 0;
+FLEXT_TEMPIMPL(double QVars)::idlebudget = 0;
+#if FLEXT_QMODE == 0
+FLEXT_TEMPIMPL(bool QVars)::deferred = false;
+#endif
 
 
 
 #define STATSIZE 8
 
+#ifndef FLEXT_SLOTSPIN
+//! Number of polls of a locked coalescing slot before yielding
+#define FLEXT_SLOTSPIN 100
+#endif
+
+/*! \brief Coalescing slot, holding the latest message for an outlet
+    \note The producer writes to the front buffer, while the queue delivers the back buffer
+*/
+FLEXT_TEMPIMPL(class FLEXT_CLASSDEF(flext_base))::QueueSlot:
+    public flext
+{
+public:
+    QueueSlot(flext_base *t,int o,QueueSlot *n)
+        : th(t),out(o),enabled(false),nxt(n)
+        , front(vals),back(vals+1)
+        , queued(false),lck(0)
+    {}
+
+    //! Store the message, return true if the slot must be queued
+    bool Set(const t_symbol *s,int argc,const t_atom *argv)
+    {
+        t_atom *mem = NULL;
+        for(;;) {
+            Lock();
+            if(LIKELY(argc <= front->cap) || mem) break;
+            // a long list: allocate outside of the lock, then try again
+            Unlock();
+            mem = new t_atom[argc];
+        }
+        t_atom *old = front->Set(s,argc,argv,mem);
+        bool q = !queued;
+        queued = true;
+        Unlock();
+        if(old) delete[] old;
+        return q;
+    }
+
+    //! Deliver the latest message (PD sys lock must already be held by caller)
+    void Send()
+    {
+        Lock();
+        Value *v = front;
+        front = back;
+        back = v;
+        queued = false;
+        Unlock();
+
+        if(UNLIKELY(out < 0))
+            // message to self
+            th->CbMethodHandler(-1-out,v->sym,v->argc,v->argv); 
+        else
+            // message to outlet
+            th->ToSysAnything(out,v->sym,v->argc,v->argv);
+    }
+
+    flext_base *th;
+    int out;
+    bool enabled;
+    QueueSlot *nxt;
+
+private:
+    class Value {
+    public:
+        Value(): sym(NULL),argc(0),cap(STATSIZE),argv(argl) {}
+        ~Value() { if(argv != argl) delete[] argv; }
+
+        /*! \brief Store the message
+            \param mem storage for cnt atoms if needed (NULL otherwise), it's taken over
+            \return storage to be freed by the caller
+        */
+        t_atom *Set(const t_symbol *s,int cnt,const t_atom *lst,t_atom *mem)
+        {
+            t_atom *old = mem;
+            if(UNLIKELY(cnt > cap)) {
+                FLEXT_ASSERT(mem);
+                old = argv != argl?argv:NULL;
+                argv = mem;
+                cap = cnt;
+            }
+            sym = s;
+            argc = cnt;
+            flext::CopyAtoms(cnt,argv,lst);
+            return old;
+        }
+
+        const t_symbol *sym;
+        int argc,cap;
+        t_atom *argv;
+        t_atom argl[STATSIZE];
+    };
+
+#ifdef FLEXT_THREADS
+    inline void Lock() 
+    { 
+        for(int spins = 0; UNLIKELY(!lockfree::CAS(&lck,0,1)); )
+            // the holder may have been preempted
+            if(++spins == FLEXT_SLOTSPIN) ThrYield(),spins = 0;
+    }
+#else
+    inline void Lock() { while(UNLIKELY(!lockfree::CAS(&lck,0,1))) {} }
+#endif
+    inline void Unlock() { lockfree::memory_barrier(); lck = 0; }
+
+    Value vals[2];
+    Value *front,*back;
+    volatile bool queued;
+    volatile int lck;
+};
+
 FLEXT_TEMPIMPL(class FLEXT_CLASSDEF(flext))::MsgBundle:
     public flext,
     public FifoCell
 {
 public:
+    MsgBundle(): stamp(0),block(NULL),blockmsgs(0),blockatoms(0) { msg.Init(); Rewind(); }
+    ~MsgBundle() { delete[] block; }
+
     static MsgBundle *New()
     {
-        MsgBundle *m = FLEXT_TEMPINST(QVars)::queue->New();
+        MsgBundle *m = FLEXT_TEMPINST(QVars)::arena->NewBundle();
+        if(LIKELY(m))
+            ++FLEXT_TEMPINST(QVars)::stats->poolhits;
+        else {
+            ++FLEXT_TEMPINST(QVars)::stats->poolmisses;
+            m = Overflow();
+        }
         m->msg.Init();
+        m->stamp = 0;
+        return m;
+    }
+
+    //! Get a bundle with contiguous storage for msgs messages and atoms atoms of long lists
+    static MsgBundle *New(int msgs,int atoms)
+    {
+        MsgBundle *m = New();
+        m->Reserve(msgs-1,atoms);
         return m;
     }
 
     static void Free(MsgBundle *m)
     {       
-        for(Msg *mi = m->msg.nxt; mi; ) {
-            Msg *mn = mi->nxt;
-            mi->Free();
-            delete mi;
-            mi = mn;
-        }
-        m->msg.Free();
-        FLEXT_TEMPINST(QVars)::queue->Free(m);
+        m->Clear();
+        if(!FLEXT_TEMPINST(QVars)::arena->FreeBundle(m))
+            FLEXT_TEMPINST(QVars)::queue->Free(m);
     }
 
     bool BelongsTo(flext_base *t) const
@@ -122,13 +554,22 @@ public:
 
     inline MsgBundle &Add(flext_base *t,int o,const t_symbol *s,int ac,const t_atom *av)
     {
-        Get()->Set(t,o,s,ac,av);
+        Msg *m = Get();
+        m->Set(t,o,s,ac,av,BlockAtoms(ac));
+        return *this;
+    }
+
+    //! Add a message, taking over the memory of the list
+    inline MsgBundle &Take(flext_base *t,int o,const t_symbol *s,AtomList &l)
+    {
+        Get()->Take(t,o,s,l);
         return *this;
     }
 
     inline MsgBundle &Add(const t_symbol *r,const t_symbol *s,int ac,const t_atom *av)
     {
-        Get()->Set(r,s,ac,av);
+        Msg *m = Get();
+        m->Set(r,s,ac,av,BlockAtoms(ac));
         return *this;
     }
 
@@ -193,6 +634,13 @@ public:
         return Add(th,o,sym_list,argc,argv);
     }
 
+    //! Add delivery of a coalescing slot
+    inline MsgBundle &Latest(flext_base::QueueSlot *sl)
+    {
+        Get()->Latest(sl);
+        return *this;
+    }
+
     // \note PD sys lock must already be held by caller
     inline bool Send() const
     {
@@ -210,12 +658,118 @@ public:
         return false;
     }
 
+private:
+
+    //! Get a bundle when the arena is exhausted, according to the overflow policy
+    static MsgBundle *Overflow()
+    {
+        ++FLEXT_TEMPINST(QVars)::arena->overflows;
+
+        MsgBundle *m;
+        switch(FLEXT_TEMPINST(QVars)::policy) {
+#ifdef FLEXT_THREADS
+        case queue_block:
+            // the threads draining the queue must not wait for it
+            if(!IsSystemThread() && !IsThread(thrmsgid)) {
+                for(;;) {
+                    FLEXT_TEMPINST(Trigger)();
+                    Sleep(0.0001);
+                    if((m = FLEXT_TEMPINST(QVars)::arena->NewBundle()) != NULL)
+                        return m;
+                }
+            }
+            break;
+#endif
+        case queue_dropoldest:
+            /* recycle the oldest bulk (or control) message, 
+               a coalesced message at the head of a lane stays in place to keep the order of delivery
+            */
+            if((m = FLEXT_TEMPINST(QVars)::queue->GetDroppable(prio_bulk)) != NULL || (m = FLEXT_TEMPINST(QVars)::queue->GetDroppable(prio_control)) != NULL) {
+                ++FLEXT_TEMPINST(QVars)::stats->dropped;
+                m->Clear();
+                return m;
+            }
+            break;
+        default:
+            break;
+        }
+        // fall back to the heap
+        return FLEXT_TEMPINST(QVars)::queue->New();
+    }
+
+    //! Free the additional parts and atoms of a bundle (the reserved block is kept for reuse)
+    void Clear()
+    {
+        for(Msg *mi = msg.nxt; mi; ) {
+            Msg *mn = mi->nxt;
+            mi->Free(*this);
+            if(!InBlock(mi) && !FLEXT_TEMPINST(QVars)::arena->FreePart(mi))
+                delete mi;
+            mi = mn;
+        }
+        msg.Free(*this);
+        msg.Init();
+        Rewind();
+    }
+
+    /*! \brief Make sure that the reserved block holds parts additional parts and atoms atoms 
+        \note The block is allocated only if the bundle hasn't got a large enough one from its previous use.
+    */
+    void Reserve(int parts,int atoms)
+    {
+        FLEXT_ASSERT(!msg.Ok());
+        if(parts < blockmsgs) parts = blockmsgs;
+        if(atoms < blockatoms) atoms = blockatoms;
+        if(parts > blockmsgs || atoms > blockatoms) {
+            delete[] block;
+            // parts first, so that the atoms are aligned, too
+            block = new char[parts*sizeof(Msg)+atoms*sizeof(t_atom)];
+            blockmsgs = parts;
+            blockatoms = atoms;
+        }
+    }
+
+    inline void Rewind() { last = &msg; usedmsgs = usedatoms = 0; }
+
+    inline bool InBlock(const void *p) const 
+    { 
+        return block && static_cast<const char *>(p) >= block && static_cast<const char *>(p) < block+blockmsgs*sizeof(Msg)+blockatoms*sizeof(t_atom); 
+    }
+
+    //! Get atoms of the reserved block for a long list, NULL if there are none left
+    inline t_atom *BlockAtoms(int cnt)
+    {
+        if(LIKELY(cnt <= STATSIZE) || usedatoms+cnt > blockatoms) return NULL;
+        t_atom *a = reinterpret_cast<t_atom *>(block+blockmsgs*sizeof(Msg))+usedatoms;
+        usedatoms += cnt;
+        return a;
+    }
+
+    inline bool IsIdle() const { return !msg.nxt && msg.IsIdle(); }
+
+public:
+    //! idle processing and coalesced messages must not be dropped
+    inline bool Droppable() const { return msg.nxt || !msg.IsSpecial(); }
+
+    //! storage size of an additional bundle part
+    static size_t PartSize() { return sizeof(Msg); }
+
+    //! time of queuing, for the latency statistics (0 if not sampled)
+    double stamp;
+    //! for a bundle spilled from a forwarding ring: number of ring messages before it
+    unsigned int ringpos;
+
 private:
 
     class Msg {
     public:
         inline bool Ok() const { return th || recv; }
 
+        //! idle processing or coalesced message
+        inline bool IsSpecial() const { return Ok() && !sym; }
+
+        inline bool IsIdle() const { return IsSpecial() && argc >= 0; }
+
         void Init()
         {
             th = NULL;
@@ -224,11 +778,12 @@ private:
             argc = 0;
         }
 
-        void Free()
+        void Free(const MsgBundle &b)
         {
             if(argc > STATSIZE) {
                 FLEXT_ASSERT(argv);
-                delete[] argv;
+                if(!b.InBlock(argv) && !FLEXT_TEMPINST(QVars)::arena->FreeAtoms(argv))
+                    delete[] argv;
             }
         }
 
@@ -239,20 +794,39 @@ private:
             return th == t; 
         }
 
-        void Set(flext_base *t,int o,const t_symbol *s,int ac,const t_atom *av)
+        void Set(flext_base *t,int o,const t_symbol *s,int ac,const t_atom *av,t_atom *buf = NULL)
         {
             FLEXT_ASSERT(t);
             th = t;
             out = o;
-            SetMsg(s,ac,av);
+            SetMsg(s,ac,av,buf);
         }
 
-        void Set(const t_symbol *r,const t_symbol *s,int ac,const t_atom *av)
+        void Take(flext_base *t,int o,const t_symbol *s,AtomList &l)
+        {
+            FLEXT_ASSERT(t);
+            th = t;
+            out = o;
+            const int cnt = l.Count();
+            t_atom *a = cnt > STATSIZE?l.Detach():NULL;
+            if(a) {
+                // allocated with new[], just like the atoms freed in Free()
+                sym = s;
+                argc = cnt;
+                argv = a;
+            }
+            else {
+                SetMsg(s,cnt,l.Atoms());
+                l.Clear();
+            }
+        }
+
+        void Set(const t_symbol *r,const t_symbol *s,int ac,const t_atom *av,t_atom *buf = NULL)
         {
             FLEXT_ASSERT(r);
             th = NULL;
             recv = r;
-            SetMsg(s,ac,av);
+            SetMsg(s,ac,av,buf);
         }
 
         void Idle(flext_base *t)
@@ -270,6 +844,16 @@ private:
             SetMsg(NULL,argc,argv);
         }
 
+        //! coalesced message, marked by a negative argument count
+        void Latest(flext_base::QueueSlot *sl)
+        {
+            FLEXT_ASSERT(sl);
+            th = sl->th;
+            slot = sl;
+            sym = NULL;
+            argc = -1;
+        }
+
         bool Send() const
         {
             if(LIKELY(sym)) {
@@ -286,6 +870,11 @@ private:
                     flext::SysForward(recv,sym,argc,argc > STATSIZE?argv:argl);
                 return false;
             }
+            else if(UNLIKELY(argc < 0)) {
+                // coalesced message
+                slot->Send();
+                return false;
+            }
             else {
                 // idle processing
                 if(th)
@@ -305,6 +894,7 @@ private:
             int out;
             const t_symbol *recv;
             bool (*fun)(int argc,const t_atom *argv);
+            flext_base::QueueSlot *slot;
         };
         const t_symbol *sym;
         int argc;
@@ -313,12 +903,17 @@ private:
             t_atom argl[STATSIZE];
         };
 
-        void SetMsg(const t_symbol *s,int cnt,const t_atom *lst)
+        //! buf is storage for a long list, if NULL it's taken from the arena 
+        void SetMsg(const t_symbol *s,int cnt,const t_atom *lst,t_atom *buf = NULL)
         {
             sym = s;
             argc = cnt;
             if(UNLIKELY(cnt > STATSIZE)) {
-                argv = new t_atom[cnt];
+                argv = buf?buf:FLEXT_TEMPINST(QVars)::arena->NewAtoms(cnt);
+                if(UNLIKELY(!argv)) {
+                    ++FLEXT_TEMPINST(QVars)::arena->overflows;
+                    argv = new t_atom[cnt];
+                }
                 flext::CopyAtoms(cnt,argv,lst);
             }
             else
@@ -327,60 +922,318 @@ private:
 
     } msg;
 
+    //! the last message of the chain
+    Msg *last;
+
+    //! reserved storage: blockmsgs parts, followed by blockatoms atoms
+    char *block;
+    int blockmsgs,blockatoms;
+    int usedmsgs,usedatoms;
+
     Msg *Get()
     {
-        Msg *m = &msg;
+        Msg *m = last;
         if(LIKELY(m->Ok())) {
-            for(; m->nxt; m = m->nxt) {}
-            m = m->nxt = new Msg;
+            void *p;
+            if(usedmsgs < blockmsgs)
+                p = block+(usedmsgs++)*sizeof(Msg);
+            else 
+                p = FLEXT_TEMPINST(QVars)::arena->NewPart();
+            if(LIKELY(p))
+                m = m->nxt = new(p) Msg;
+            else {
+                ++FLEXT_TEMPINST(QVars)::arena->overflows;
+                m = m->nxt = new Msg;
+            }
             m->Init();
+            last = m;
         }
         return m;
     }
 };
 
+/*! \brief Single producer, single consumer ring of forwarded messages
+    \note The producer is the thread owning the ring, the consumer is the queue (guarded by QVars::draining).
+    The slots are preallocated, long lists and messages not fitting into a full ring are spilled 
+    as bundles from the message pool (like QueueForward), which are delivered in order with the slots.
+*/
+FLEXT_TEMPIMPL(class FLEXT_CLASSDEF(flext))::ForwardRing:
+    public flext
+{
+public:
+    ForwardRing(int n)
+        : nxt(NULL),owned(1),head(0),tail(0),spilled(NULL)
+    {
+        int sz = 1;
+        while(sz < n) sz <<= 1;
+        slots = new Slot[sz];
+        mask = sz-1;
+    }
+
+    ~ForwardRing() 
+    { 
+        if(spilled) MsgBundle::Free(spilled);
+        MsgBundle *m;
+        while((m = overflow.Get()) != NULL) MsgBundle::Free(m);
+        delete[] slots;
+    }
+
+    inline int Capacity() const { return mask+1; }
+
+    inline bool Avail() const { return head != tail || spilled || overflow.Avail(); }
+
+    /*! \brief Store a message (producer)
+        \return true if the consumer has to be triggered
+    */
+    bool Put(const t_symbol *r,const t_symbol *s,int argc,const t_atom *argv)
+    {
+        const unsigned int h = head;
+        if(LIKELY(argc <= STATSIZE && h-tail <= mask)) {
+            slots[h&mask].Set(r,s,argc,argv);
+            lockfree::memory_barrier();
+            head = h+1;
+            lockfree::memory_barrier();
+            // only if the consumer had caught up it may have missed the message
+            return tail == h;
+        }
+        else {
+            // spill, the bundle is delivered after the h messages stored so far
+            MsgBundle *m = MsgBundle::New();
+            m->Add(r,s,argc,argv);
+            m->ringpos = h;
+            overflow.Put(m);
+            return true;
+        }
+    }
+
+    /*! \brief Deliver messages (consumer)
+        \param max maximum number of messages, 0 for all
+        \return number of delivered messages
+    */
+    int Drain(int max)
+    {
+        int cnt = 0;
+        while(!max || cnt < max) {
+            if(!spilled) spilled = overflow.Get();
+            const unsigned int h = head;
+            lockfree::memory_barrier();
+            unsigned int t = tail;
+            // slots up to the next spilled bundle
+            const unsigned int e = spilled && spilled->ringpos-t <= h-t?spilled->ringpos:h;
+            for(; t != e && (!max || cnt < max); ++t,++cnt)
+                slots[t&mask].Send();
+            lockfree::memory_barrier();
+            tail = t;
+            lockfree::memory_barrier();
+
+            if(t != e || !spilled) break; // budget used up or nothing spilled
+
+            spilled->Send();
+            MsgBundle::Free(spilled);
+            spilled = NULL;
+            ++cnt;
+        }
+        return cnt;
+    }
+
+    ForwardRing *nxt;
+    //! taken by a producer thread (0 if released)
+    volatile long owned;
+
+private:
+    class Slot {
+    public:
+        void Set(const t_symbol *r,const t_symbol *s,int ac,const t_atom *av)
+        {
+            FLEXT_ASSERT(ac <= STATSIZE);
+            recv = r;
+            sym = s;
+            argc = ac;
+            CopyAtoms(ac,argl,av);
+        }
+
+        void Send() { SysForward(recv,sym,argc,argl); }
+
+    private:
+        const t_symbol *recv,*sym;
+        int argc;
+        t_atom argl[STATSIZE];
+    };
+
+    Slot *slots;
+    unsigned int mask;
+    // written by the producer and the consumer, on separate cache lines
+    volatile unsigned int head;
+    char pad1[LOCKFREE_CACHELINE];
+    volatile unsigned int tail;
+    char pad2[LOCKFREE_CACHELINE];
+
+    //! spilled bundles (producer) and the next one to deliver (consumer)
+    TypedFifo<MsgBundle> overflow;
+    MsgBundle *spilled;
+};
+
 FLEXT_TEMPIMPL(QueueFifo)::~QueueFifo()
 { 
     flext::MsgBundle *n; 
     while((n = Get()) != NULL) delete n; 
 }
 
-FLEXT_TEMPIMPL(void Queue)::Push(MsgBundle *m)
+FLEXT_TEMPIMPL(QArena)::QArena(int nb,int blocks,int blocksize)
+    : bundles(nb > 0?new MsgBundle[nb]:NULL)
+    , nbundles(nb > 0?nb:0)
+{
+    for(int i = 0; i < nbundles; ++i) avail.Put(bundles+i);
+    parts.Setup(nbundles,MsgBundle::PartSize());
+    if(blocksize > STATSIZE) atoms.Setup(blocks > 0?blocks:0,blocksize*sizeof(t_atom));
+}
+
+FLEXT_TEMPIMPL(QArena)::~QArena()
+{
+    while(avail.Get()) {}
+    delete[] bundles;
+}
+
+FLEXT_TEMPIMPL(bool QArena)::FreeBundle(MsgBundle *m)
+{
+    if(m >= bundles && m < bundles+nbundles) {
+        avail.Put(m);
+        return true;
+    }
+    else
+        return false;
+}
+
+FLEXT_TEMPIMPL(bool IdleSched)::Run(double slice,double budget)
+{
+    Collect();
+
+    const double end = budget > 0?GetOSTime()+budget:0;
+    // without a budget every task present gets one turn
+    int turns = end?-1:count;
+    MsgBundle *m;
+    while(turns-- && (m = ready.Get()) != NULL) {
+        bool again = m->Send();
+        if(again && slice > 0) {
+            double stop = GetOSTime()+slice;
+            if(end && stop > end) stop = end;
+            while(GetOSTime() < stop && (again = m->Send()) != false) {}
+        }
+
+        if(again)
+            // to the end of the round
+            ready.Put(m);
+        else {
+            MsgBundle::Free(m);
+            --count;
+        }
+
+        if(end && GetOSTime() >= end) break;
+    }
+    return Avail();
+}
+
+FLEXT_TEMPIMPL(void IdleSched)::Remove(flext_base *t)
+{
+    Collect();
+
+    MsgBundle *m;
+    for(int n = count; n-- && (m = ready.Get()) != NULL; )
+        if(m->BelongsTo(t)) {
+            MsgBundle::Free(m);
+            --count;
+        }
+        else
+            ready.Put(m);
+}
+
+FLEXT_TEMPIMPL(void Queue)::Push(MsgBundle *m,queue_prio p)
 {
     if(LIKELY(m)) {
-        Put(m);
+        m->stamp = FLEXT_TEMPINST(QVars)::stats->Pushed();
+        Put(m,p);
         FLEXT_TEMPINST(Trigger)();
     }
 }
 
+FLEXT_TEMPIMPL(void Queue)::Put(MsgBundle *m,queue_prio p)
+{
+    lanes[p].Put(m,m->Droppable()?0:tag_keep);
+}
+
 #define CHUNK 10
 
+/*! \brief Deliver the messages of the forwarding rings
+    \param max maximum number of messages, 0 for all
+    \return number of delivered messages
+*/
+FLEXT_TEMPLATE int QRings(int max)
+{
+    if(LIKELY(!FLEXT_TEMPINST(QVars)::rings) || !lockfree::CAS(&FLEXT_TEMPINST(QVars)::draining,0L,1L))
+        return 0;
+
+    int cnt = 0;
+    for(flext::ForwardRing *r = FLEXT_TEMPINST(QVars)::rings; r && (!max || cnt < max); r = r->nxt)
+        if(r->Avail()) cnt += r->Drain(max?max-cnt:0);
+
+    lockfree::memory_barrier();
+    FLEXT_TEMPINST(QVars)::draining = 0;
+    return cnt;
+}
+
+//! Check whether any forwarding ring holds messages
+FLEXT_TEMPLATE bool QRingsAvail()
+{
+    for(flext::ForwardRing *r = FLEXT_TEMPINST(QVars)::rings; r; r = r->nxt)
+        if(r->Avail()) return true;
+    return false;
+}
+
 #if FLEXT_QMODE == 1
 FLEXT_TEMPLATE bool QWork(bool syslock,flext_base *flushobj = NULL)
 {
+    FLEXT_TRACE_SCOPE("queue","drain",NULL);
+
     // Since qcnt can only be increased from any other function than QWork
     // qc will be a minimum guaranteed number of present queue elements.
     // On the other hand, if new queue elements are added by the methods called
     // in the loop, these will be sent in the next tick to avoid recursion overflow.
+    FLEXT_TEMPINST(QStats) *stats = FLEXT_TEMPINST(QVars)::stats;
+    stats->forwarded += FLEXT_TEMPINST(QRings)(0);
+    stats->Pass();
+
     flext::MsgBundle *q;
-    if((q = queue.Get()) == NULL) 
+    if((q = FLEXT_TEMPINST(QVars)::queue->Get()) == NULL) 
         return false;
-    else if(q->Send()) {
-        if(!flushobj || !q->BelongsTo(flushobj))
-            queue.Push(q);  // remember messages to be processed again
-        else
-            flext::MsgBundle::Free(q);
-        return true;
+
+    const bool again = q->Send();
+    stats->Sent(q->stamp);
+    if(again && (!flushobj || !q->BelongsTo(flushobj))) {
+        // remember messages to be processed again
+        ++stats->requeued;
+        FLEXT_TEMPINST(QVars)::queue->Put(q,flext::prio_bulk);
+        FLEXT_TEMPINST(Trigger)();
     }
     else {
+        ++stats->delivered;
         flext::MsgBundle::Free(q);
-        return false;
     }
+    return again;
 }
 #else
+//! Check whether the bulk budget of a queue pass is used up
+static inline bool QExhausted(int cnt,int maxmsgs,double endtime)
+{
+    return (maxmsgs && cnt >= maxmsgs) || (endtime && flext::GetOSTime() >= endtime);
+}
+
+/*! \brief Deliver queued messages
+    \return true if the bulk budget was exhausted and messages are left for the next pass
+*/
 FLEXT_TEMPLATE bool QWork(bool syslock,flext_base *flushobj = NULL)
 {
-    FLEXT_TEMPINST(Queue) newmsgs;
+    FLEXT_TRACE_SCOPE("queue","drain",NULL);
+    TypedFifo<flext::MsgBundle> newmsgs;
     flext::MsgBundle *q;
 
 #if 0
@@ -388,41 +1241,105 @@ FLEXT_TEMPLATE bool QWork(bool syslock,flext_base *flushobj = NULL)
     fprintf(stderr,"QWORK %i\n",counter++);
 #endif
 
+    const int maxmsgs = FLEXT_TEMPINST(QVars)::budgetmsgs;
+    const double maxtime = FLEXT_TEMPINST(QVars)::budgettime;
+    const double endtime = maxtime > 0?flext::GetOSTime()+maxtime:0;
+    int cnt = 0;
+    bool exhausted = false;
+
+    FLEXT_TEMPINST(Queue) *queue = FLEXT_TEMPINST(QVars)::queue;
+    FLEXT_TEMPINST(QStats) *stats = FLEXT_TEMPINST(QVars)::stats;
+
     for(;;) {
-        // Since qcnt can only be increased from any other function than QWork
-        // qc will be a minimum guaranteed number of present queue elements.
-        // On the other hand, if new queue elements are added by the methods called
-        // in the loop, these will be sent in the next tick to avoid recursion overflow.
-        if(!FLEXT_TEMPINST(QVars)::queue->Avail()) break;
+        // Messages are detached in batches (one atomic operation each) and
+        // delivered holding the system lock once per batch.
+        // If new queue elements are added by the methods called
+        // in the loop, these will be sent with the next batch to avoid recursion overflow.
+        if(!queue->Avail() && !FLEXT_TEMPINST(QRingsAvail)()) break;
 
     #if FLEXT_QMODE == 2
-        if(syslock) flext::Lock();
+        if(syslock) {
+            // waiting for the system lock, e.g. while DSP is running
+            FLEXT_TRACE_SCOPE("lock","syslock",NULL);
+            flext::Lock();
+        }
     #endif
 
-        while((q = FLEXT_TEMPINST(QVars)::queue->Get()) != NULL) {
-            if(q->Send())
-                newmsgs.Push(q);  // remember messages to be processed again
-            else
+        stats->Pass();
+
+        // control messages are always delivered completely
+        queue->Fetch(flext::prio_control);
+        while((q = queue->Next(flext::prio_control)) != NULL) {
+            const bool again = q->Send();
+            stats->Sent(q->stamp);
+            if(again)
+                newmsgs.Put(q);  // remember messages to be processed again
+            else {
+                ++stats->delivered;
                 flext::MsgBundle::Free(q);
+            }
+        }
+
+        // forwarded messages of the producer threads' rings count as bulk
+        const int fwd = FLEXT_TEMPINST(QRings)(maxmsgs?maxmsgs-cnt:0);
+        stats->forwarded += fwd;
+        cnt += fwd;
+
+        // bulk messages as far as the budget allows (the rest of the batch is kept for the next pass)
+        queue->Fetch(flext::prio_bulk);
+        while(!(exhausted = QExhausted(cnt,maxmsgs,endtime)) && (q = queue->Next(flext::prio_bulk)) != NULL) {
+            ++cnt;
+            const bool again = q->Send();
+            stats->Sent(q->stamp);
+            if(again)
+                newmsgs.Put(q);  // remember messages to be processed again
+            else {
+                ++stats->delivered;
+                flext::MsgBundle::Free(q);
+            }
         }
 
     #if FLEXT_QMODE == 2
         if(syslock) flext::Unlock();
     #endif
 
+        if(exhausted) break;
     }
 
     // enqueue messages that have to be processed again
     while((q = newmsgs.Get()) != NULL)
-        if(!flushobj || !q->BelongsTo(flushobj))
-            FLEXT_TEMPINST(QVars)::queue->Push(q);
-        else
+        if(!flushobj || !q->BelongsTo(flushobj)) {
+            ++stats->requeued;
+            queue->Put(q,flext::prio_bulk);
+        }
+        else {
+            ++stats->delivered;
             flext::MsgBundle::Free(q);
+        }
 
-    return FLEXT_TEMPINST(QVars)::queue->Avail();
+    return exhausted && (queue->Avail() || FLEXT_TEMPINST(QRingsAvail)());
 }
 #endif
 
+/*! \brief Run a pass of idle processing, within the idle budget
+    \return true if idle tasks are left
+*/
+FLEXT_TEMPLATE bool QIdle(bool syslock)
+{
+    if(LIKELY(!FLEXT_TEMPINST(QVars)::idle->Avail())) return false;
+
+    FLEXT_TRACE_SCOPE("queue","idle",NULL);
+
+#if FLEXT_QMODE == 2
+    if(syslock) flext::Lock();
+#endif
+    const bool left = FLEXT_TEMPINST(QVars)::idle->Run(FLEXT_TEMPINST(QVars)::idleslice,FLEXT_TEMPINST(QVars)::idlebudget);
+#if FLEXT_QMODE == 2
+    if(syslock) flext::Unlock();
+#endif
+    return left;
+}
+
 #if FLEXT_QMODE == 0
 #if FLEXT_SYS == FLEXT_SYS_JMAX
 FLEXT_TEMPLATE void QTick(fts_object_t *c,int winlet, fts_symbol_t s, int ac, const fts_atom_t *at)
@@ -431,7 +1348,18 @@ FLEXT_TEMPLATE void QTick(fts_object_t *c,int winlet, fts_symbol_t s, int ac, co
 FLEXT_TEMPLATE void QTick(flext_base *c)
 {
 #endif
-    FLEXT_TEMPINST(QWork)(false);
+    FLEXT_TEMPINST(QVars)::deferred = false;
+    bool more = FLEXT_TEMPINST(QWork)(false);
+    if(FLEXT_TEMPINST(QIdle)(false)) more = true;
+    if(more) {
+        // budget exhausted or idle tasks left: continue after the next DSP tick
+        FLEXT_TEMPINST(QVars)::deferred = true;
+#if FLEXT_SYS == FLEXT_SYS_PD
+        clock_delay(FLEXT_TEMPINST(QVars)::qclk,sys_getblksize()*1000./sys_getsr());
+#else
+        clock_delay(FLEXT_TEMPINST(QVars)::qclk,1);
+#endif
+    }
 }
 
 #elif FLEXT_QMODE == 1
@@ -444,7 +1372,9 @@ FLEXT_TEMPLATE t_int QTick(t_int *)
     qtickactive = false;
 #endif
 
-    if(QWork(false))
+    bool more = FLEXT_TEMPINST(QWork)(false);
+    if(FLEXT_TEMPINST(QIdle)(false)) more = true;
+    if(more)
         return 1;
     else {
 #       ifdef PERMANENTIDLE
@@ -468,6 +1398,8 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::QFlush(flext_base *th)
 {
     FLEXT_ASSERT(!IsThreadRegistered());
     while(!FLEXT_TEMPINST(QVars)::queue->Empty()) FLEXT_TEMPINST(QWork)(false,th);
+    // idle processing of the object ends here
+    if(th) FLEXT_TEMPINST(QVars)::idle->Remove(th);
 }
 
 FLEXT_TEMPLATE void Trigger()
@@ -483,18 +1415,21 @@ FLEXT_TEMPLATE void Trigger()
         }
 #   elif FLEXT_QMODE == 0
 #   ifdef FLEXT_THREADS
-        bool sys = flext::IsThread(flext::GetSysThreadId());
+        bool sys = flext::IsSystemThread();
 #   else
         bool sys = true;
 #   endif
         if(!sys) flext::Lock();
-        clock_delay(FLEXT_TEMPINST(QVars)::qclk,0);
+        // a deferred queue must not be brought forward again
+        if(!FLEXT_TEMPINST(QVars)::deferred)
+            clock_delay(FLEXT_TEMPINST(QVars)::qclk,0);
         if(!sys) flext::Unlock();
 #   endif
 #elif FLEXT_SYS == FLEXT_SYS_MAX
 #   if FLEXT_QMODE == 0
 //        qelem_front(FLEXT_TEMPINST(QVars)::qclk);
-        clock_delay(FLEXT_TEMPINST(QVars)::qclk,0);
+        if(!FLEXT_TEMPINST(QVars)::deferred)
+            clock_delay(FLEXT_TEMPINST(QVars)::qclk,0);
 #   endif
 #else
 #   error Not implemented
@@ -505,21 +1440,49 @@ FLEXT_TEMPLATE void Trigger()
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::QWorker(thr_params *)
 {
     thrmsgid = GetThreadId();
+#ifdef FLEXT_TRACE
+    TraceThread("flext queue");
+#endif
     qustarted = true;
+    double idledue = 0;
     for(;;) {
-        // we need a timed wait so that idle processing can take place
-        FLEXT_TEMPINST(QVars)::qthrcond->TimedWait(0.001);
-        FLEXT_TEMPINST(QWork)(true);
+        const unsigned long seen = FLEXT_TEMPINST(QVars)::qthrcond->Triggers();
+        // with the budget exhausted give the system a chance to grab the lock
+        while(FLEXT_TEMPINST(QWork)(true)) ThrYield();
+
+        // idle processing at most once per period, however busy the queue is
+        double tmo = 0;
+        if(FLEXT_TEMPINST(QVars)::idle->Avail()) {
+            double now = GetOSTime();
+            if(now >= idledue) {
+                FLEXT_TEMPINST(QIdle)(true);
+                idledue = now+FLEXT_TEMPINST(QVars)::idleperiod;
+                now = GetOSTime();
+            }
+            if(FLEXT_TEMPINST(QVars)::idle->Avail())
+                tmo = idledue > now?idledue-now:FLEXT_TEMPINST(QVars)::idleperiod;
+        }
+
+        // sleep until triggered, or until idle processing is due
+        FLEXT_TEMPINST(QVars)::qthrcond->Wait(seen,tmo);
     }
 }
 #endif
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::StartQueue()
 {
+    // called for every class, but there's only one queue
+    if(FLEXT_TEMPINST(QVars)::queue) return;
+
 #if FLEXT_QMODE == 2
-    FLEXT_TEMPINST(QVars)::qthrcond = new FLEXT_CLASSDEF(flext)::ThrCond;
+    FLEXT_TEMPINST(QVars)::qthrcond = new QWakeup;
 #endif
+    FLEXT_TEMPINST(QVars)::arena = new FLEXT_TEMPINST(QArena)(FLEXT_TEMPINST(QVars)::bundles,FLEXT_TEMPINST(QVars)::blocks,FLEXT_TEMPINST(QVars)::blocksize);
     FLEXT_TEMPINST(QVars)::queue = new FLEXT_TEMPINST(Queue);
+    FLEXT_TEMPINST(QVars)::idle = new FLEXT_TEMPINST(IdleSched);
+    FLEXT_TEMPINST(QVars)::stats = new FLEXT_TEMPINST(QStats);
+    // keep bundles from heap overflows up to the arena size, the base fifo itself is empty
+    FLEXT_TEMPINST(QVars)::queue->SetHighWater(FLEXT_TEMPINST(QVars)::bundles);
 
     if(qustarted) return;
 #if FLEXT_QMODE == 1
@@ -545,6 +1508,11 @@ FLEXT_TEMPIMPL(FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext))::MsgBundle *FLEXT_CLASSDEF(f
     return MsgBundle::New(); 
 }
 
+FLEXT_TEMPIMPL(FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext))::MsgBundle *FLEXT_CLASSDEF(flext))::MsgNew(int msgs,int atoms)
+{ 
+    return MsgBundle::New(msgs,atoms); 
+}
+
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::MsgFree(MsgBundle *m)
 { 
     MsgBundle::Free(m); 
@@ -553,7 +1521,7 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::MsgFree(MsgBundle *m)
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::ToSysMsg(MsgBundle *m)
 {
     m->Send();
-    FLEXT_TEMPINST(QVars)::queue->Free(m);
+    MsgBundle::Free(m);
 }
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::ToQueueMsg(MsgBundle *m)
@@ -561,57 +1529,237 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::ToQueueMsg(MsgBundle *m)
     FLEXT_TEMPINST(QVars)::queue->Push(m);
 }
 
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::SetupQueue(int bundles,int blocks,int blocksize,queue_overflow policy)
+{
+    if(FLEXT_TEMPINST(QVars)::arena) {
+        error("flext - queue arena must be set up before the first class");
+        return false;
+    }
+    FLEXT_TEMPINST(QVars)::bundles = bundles;
+    FLEXT_TEMPINST(QVars)::blocks = blocks;
+    FLEXT_TEMPINST(QVars)::blocksize = blocksize;
+    FLEXT_TEMPINST(QVars)::policy = policy;
+    return true;
+}
+
+FLEXT_TEMPIMPL(unsigned long FLEXT_CLASSDEF(flext))::QueueOverflows()
+{
+    return FLEXT_TEMPINST(QVars)::arena?(unsigned long)FLEXT_TEMPINST(QVars)::arena->overflows:0;
+}
+
+FLEXT_TEMPIMPL(void QStats)::Get(QueueStats &st,bool reset)
+{
+    st.pushed = pushed;
+    st.delivered = delivered;
+    st.dropped = dropped;
+    st.depth = st.pushed-st.delivered-st.dropped;
+    st.peak = peak > st.depth?peak:st.depth;
+    st.requeued = requeued;
+    st.forwarded = forwarded;
+    st.poolhits = poolhits;
+    st.poolmisses = poolmisses;
+    st.overflows = FLEXT_TEMPINST(QVars)::arena->overflows;
+    for(int i = 0; i < QueueStats::LatBins; ++i) st.latency[i] = latency[i];
+
+    const double now = GetOSTime();
+    st.rate = now > lasttime?(st.delivered-lastcount)/(now-lasttime):0;
+    lastcount = st.delivered;
+    lasttime = now;
+
+    if(reset) {
+        peak = 0;
+        for(int i = 0; i < QueueStats::LatBins; ++i) latency[i] = 0;
+    }
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::GetQueueStats(QueueStats &st,bool reset)
+{
+    if(FLEXT_TEMPINST(QVars)::stats)
+        FLEXT_TEMPINST(QVars)::stats->Get(st,reset);
+    else
+        memset(&st,0,sizeof st);
+}
+
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::cb_QueueStats(flext_base *c,int argc,const t_atom *argv)
+{
+    QueueStats st;
+    GetQueueStats(st,argc >= 1 && CanbeBool(argv[0]) && GetABool(argv[0]));
+
+    if(c->HasAttributes()) {
+        t_atom lst[32+QueueStats::LatBins];
+        int i = 0;
+        SetSymbol(lst[i++],MakeSymbol("depth")); SetInt(lst[i++],(int)st.depth);
+        SetSymbol(lst[i++],MakeSymbol("peak")); SetInt(lst[i++],(int)st.peak);
+        SetSymbol(lst[i++],MakeSymbol("pushed")); SetFloat(lst[i++],(float)st.pushed);
+        SetSymbol(lst[i++],MakeSymbol("delivered")); SetFloat(lst[i++],(float)st.delivered);
+        SetSymbol(lst[i++],MakeSymbol("requeued")); SetFloat(lst[i++],(float)st.requeued);
+        SetSymbol(lst[i++],MakeSymbol("dropped")); SetFloat(lst[i++],(float)st.dropped);
+        SetSymbol(lst[i++],MakeSymbol("forwarded")); SetFloat(lst[i++],(float)st.forwarded);
+        SetSymbol(lst[i++],MakeSymbol("poolhits")); SetFloat(lst[i++],(float)st.poolhits);
+        SetSymbol(lst[i++],MakeSymbol("poolmisses")); SetFloat(lst[i++],(float)st.poolmisses);
+        SetSymbol(lst[i++],MakeSymbol("overflows")); SetFloat(lst[i++],(float)st.overflows);
+        SetSymbol(lst[i++],MakeSymbol("rate")); SetFloat(lst[i++],(float)st.rate);
+        SetSymbol(lst[i++],MakeSymbol("latency"));
+        for(int b = 0; b < QueueStats::LatBins; ++b) SetFloat(lst[i++],(float)st.latency[b]);
+        c->ToOutAnything(c->GetOutAttr(),MakeSymbol("queuestats"),i,lst);
+    }
+    else {
+        post("%s - queue: depth %lu (peak %lu), %lu pushed, %lu delivered, %lu requeued, %lu dropped, %lu forwarded, %.1f msgs/s",
+            c->thisName(),st.depth,st.peak,st.pushed,st.delivered,st.requeued,st.dropped,st.forwarded,st.rate);
+        post("%s - queue arena: %lu hits, %lu misses, %lu overflows",c->thisName(),st.poolhits,st.poolmisses,st.overflows);
+
+        char tmp[256];
+        int n = 0;
+        for(int b = 0; b < QueueStats::LatBins && n < (int)sizeof tmp-16; ++b)
+            n += sprintf(tmp+n," %lu",st.latency[b]);
+        post("%s - queue latency histogram (<1,<2,<4... us):%s",c->thisName(),tmp);
+    }
+    return true;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::SetQueueBudget(int msgs,double secs)
+{
+    FLEXT_TEMPINST(QVars)::budgetmsgs = msgs > 0?msgs:0;
+    FLEXT_TEMPINST(QVars)::budgettime = secs > 0?secs:0;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::SetIdleBudget(double slice,double budget)
+{
+    FLEXT_TEMPINST(QVars)::idleslice = slice > 0?slice:0;
+    FLEXT_TEMPINST(QVars)::idlebudget = budget > 0?budget:0;
+}
+
 
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ToQueueBang(int o) const
 {
+    if(UNLIKELY(qslots) && QueueLatest(o,sym_bang,0,NULL,false)) return;
     MsgBundle *m = MsgBundle::New();
     m->Add(const_cast<flext_base *>(this),o);
-    FLEXT_TEMPINST(QVars)::queue->Push(m);
+    FLEXT_TEMPINST(QVars)::queue->Push(m,GetQueuePrio());
 }
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ToQueueFloat(int o,float f) const
 {
+    if(UNLIKELY(qslots)) {
+        t_atom at;
+        SetFloat(at,f);
+        if(QueueLatest(o,sym_float,1,&at,false)) return;
+    }
     MsgBundle *m = MsgBundle::New();
     m->Add(const_cast<flext_base *>(this),o,f);
-    FLEXT_TEMPINST(QVars)::queue->Push(m);
+    FLEXT_TEMPINST(QVars)::queue->Push(m,GetQueuePrio());
 }
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ToQueueInt(int o,int f) const
 {
+    if(UNLIKELY(qslots)) {
+        t_atom at;
+        SetInt(at,f);
+#if FLEXT_SYS == FLEXT_SYS_PD
+        if(QueueLatest(o,sym_float,1,&at,false)) return;
+#else
+        if(QueueLatest(o,sym_int,1,&at,false)) return;
+#endif
+    }
     MsgBundle *m = MsgBundle::New();
     m->Add(const_cast<flext_base *>(this),o,f);
-    FLEXT_TEMPINST(QVars)::queue->Push(m);
+    FLEXT_TEMPINST(QVars)::queue->Push(m,GetQueuePrio());
 }
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ToQueueSymbol(int o,const t_symbol *s) const
 {
+    if(UNLIKELY(qslots)) {
+        t_atom at;
+        SetSymbol(at,s);
+        if(QueueLatest(o,sym_symbol,1,&at,false)) return;
+    }
     MsgBundle *m = MsgBundle::New();
     m->Add(const_cast<flext_base *>(this),o,s);
-    FLEXT_TEMPINST(QVars)::queue->Push(m);
+    FLEXT_TEMPINST(QVars)::queue->Push(m,GetQueuePrio());
 }
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ToQueueAtom(int o,const t_atom &at) const
 {
     MsgBundle *m = MsgBundle::New();
     m->Add(const_cast<flext_base *>(this),o,at);
-    FLEXT_TEMPINST(QVars)::queue->Push(m);
+    FLEXT_TEMPINST(QVars)::queue->Push(m,GetQueuePrio());
 }
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ToQueueList(int o,int argc,const t_atom *argv) const
 {
+    if(UNLIKELY(qslots) && QueueLatest(o,sym_list,argc,argv,false)) return;
     MsgBundle *m = MsgBundle::New();
     m->Add(const_cast<flext_base *>(this),o,argc,argv);
-    FLEXT_TEMPINST(QVars)::queue->Push(m);
+    FLEXT_TEMPINST(QVars)::queue->Push(m,GetQueuePrio());
 }
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ToQueueAnything(int o,const t_symbol *s,int argc,const t_atom *argv) const
 {
+    if(UNLIKELY(qslots) && QueueLatest(o,s,argc,argv,false)) return;
     MsgBundle *m = MsgBundle::New();
     m->Add(const_cast<flext_base *>(this),o,s,argc,argv);
-    FLEXT_TEMPINST(QVars)::queue->Push(m);
+    FLEXT_TEMPINST(QVars)::queue->Push(m,GetQueuePrio());
 }
 
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::ToQueueAnythingTake(int o,const t_symbol *s,AtomList &list) const
+{
+    if(UNLIKELY(qslots) && QueueLatest(o,s,list.Count(),list.Atoms(),false)) {
+        list.Clear();
+        return;
+    }
+    MsgBundle *m = MsgBundle::New();
+    m->Take(const_cast<flext_base *>(this),o,s,list);
+    FLEXT_TEMPINST(QVars)::queue->Push(m,GetQueuePrio());
+}
+
+
+FLEXT_TEMPIMPL(FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext_base))::QueueSlot *FLEXT_CLASSDEF(flext_base))::QueueSlotFor(int o) const
+{
+    for(;;) {
+        QueueSlot *head = qslots;
+        for(QueueSlot *sl = head; sl; sl = sl->nxt)
+            if(sl->out == o) return sl;
+
+        QueueSlot *sl = new QueueSlot(const_cast<flext_base *>(this),o,head);
+        if(LIKELY(lockfree::CAS(&qslots,head,sl))) return sl;
+        // another thread has added a slot meanwhile
+        delete sl;
+    }
+}
+
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::QueueLatest(int o,const t_symbol *s,int argc,const t_atom *argv,bool force) const
+{
+    QueueSlot *sl;
+    if(force)
+        sl = QueueSlotFor(o);
+    else {
+        for(sl = qslots; sl && sl->out != o; sl = sl->nxt) {}
+        if(!sl || !sl->enabled) return false;
+    }
+
+    if(sl->Set(s,argc,argv)) {
+        // not pending yet
+        MsgBundle *m = MsgBundle::New();
+        m->Latest(sl);
+        FLEXT_TEMPINST(QVars)::queue->Push(m,GetQueuePrio());
+    }
+    return true;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::SetQueueCoalesce(int o,bool coalesce)
+{
+    QueueSlotFor(o)->enabled = coalesce;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::FreeQueueSlots()
+{
+    while(qslots) {
+        QueueSlot *n = qslots->nxt;
+        delete qslots;
+        qslots = n;
+    }
+}
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::MsgAddBang(MsgBundle *m,int n) const
 { 
@@ -675,6 +1823,32 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::QueueForward(const t_symbol *recv,co
     return true;
 }
 
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::QueueForward(ForwardRing *r,const t_symbol *recv,const t_symbol *s,int argc,const t_atom *argv)
+{
+    if(r->Put(recv,s,argc,argv)) FLEXT_TEMPINST(Trigger)();
+    return true;
+}
+
+FLEXT_TEMPIMPL(FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext))::ForwardRing *FLEXT_CLASSDEF(flext))::RingNew(int slots)
+{
+    // reuse a released and drained ring
+    for(ForwardRing *r = FLEXT_TEMPINST(QVars)::rings; r; r = r->nxt)
+        if(!r->owned && !r->Avail() && r->Capacity() >= slots && lockfree::CAS(&r->owned,0L,1L))
+            return r;
+
+    ForwardRing *r = new ForwardRing(slots);
+    do r->nxt = FLEXT_TEMPINST(QVars)::rings;
+    while(!lockfree::CAS(&FLEXT_TEMPINST(QVars)::rings,r->nxt,r));
+    return r;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::RingFree(ForwardRing *r)
+{
+    FLEXT_ASSERT(r->owned);
+    lockfree::memory_barrier();
+    r->owned = 0;
+}
+
 FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::MsgForward(MsgBundle *m,const t_symbol *recv,const t_symbol *s,int argc,const t_atom *argv)
 {
     m->Add(recv,s,argc,argv);
@@ -685,16 +1859,16 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::AddIdle()
 {
     MsgBundle *m = MsgBundle::New();
     m->Idle(const_cast<flext_base *>(this));
-    // send over queue
-    FLEXT_TEMPINST(QVars)::queue->Push(m);
+    FLEXT_TEMPINST(QVars)::idle->Push(m);
+    FLEXT_TEMPINST(Trigger)();
 }
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_base))::AddIdle(bool (*idlefun)(int argc,const t_atom *argv),int argc,const t_atom *argv)
 {
     MsgBundle *m = MsgBundle::New();
     m->Idle(idlefun,argc,argv);
-    // send over queue
-    FLEXT_TEMPINST(QVars)::queue->Push(m);
+    FLEXT_TEMPINST(QVars)::idle->Push(m);
+    FLEXT_TEMPINST(Trigger)();
 }
 
 #include "flpopns.h"
@@ -0,0 +1,211 @@
+/*
+flext - C++ layer for Max and Pure Data externals
+
+Copyright (c) 2001-2017 Thomas Grill (gr@grrrr.org)
+For information on usage and redistribution, and for a DISCLAIMER OF ALL
+WARRANTIES, see the file, "license.txt," in this distribution.
+*/
+
+/*! \file flsamples.h
+    \brief Fused sample expressions
+
+    An expression like
+        flext::Samples(out,n) = (flext::Samples(in0)*gain+flext::Samples(in1))*mix;
+    is evaluated in one loop over the block, without intermediate arrays.
+    The loop uses the SIMD instructions the compiler has been enabled for (SSE2, AVX, NEON).
+*/
+
+#ifndef __FLSAMPLES_H
+#define __FLSAMPLES_H
+
+#include "flstdc.h"
+
+#ifdef FLEXT_USE_SIMD
+    #if defined(__AVX__)
+        #include <immintrin.h>
+        #define FLEXT_SAMPLEPACKET_AVX
+    #elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #include <emmintrin.h>
+        #define FLEXT_SAMPLEPACKET_SSE2
+    #elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+        #include <arm_neon.h>
+        #define FLEXT_SAMPLEPACKET_NEON
+        #if defined(__aarch64__) || defined(_M_ARM64)
+            #define FLEXT_SAMPLEPACKET_NEON64
+        #endif
+    #endif
+#endif
+
+#include "flpushns.h"
+
+/*! \defgroup FLEXT_S_SIMD Cross platform SIMD support for modern CPUs
+        @{
+*/
+
+/*! \brief A vector of samples as used in expression evaluation
+    \internal
+    The generic version holds one sample, the specializations a SIMD register.
+*/
+template<typename T>
+struct SamplePacket
+{
+    enum { size = 1 };
+
+    static SamplePacket Load(const T *p) { SamplePacket r; r.v = *p; return r; }
+    static SamplePacket Set(T s) { SamplePacket r; r.v = s; return r; }
+    void Store(T *p) const { *p = v; }
+
+    SamplePacket operator +(const SamplePacket &b) const { return Set(v+b.v); }
+    SamplePacket operator -(const SamplePacket &b) const { return Set(v-b.v); }
+    SamplePacket operator *(const SamplePacket &b) const { return Set(v*b.v); }
+
+    T v;
+};
+
+#define FLEXT_SAMPLEPACKET(T,N,V,LOAD,SET,STORE,ADD,SUB,MUL) \
+template<> \
+struct SamplePacket<T> \
+{ \
+    enum { size = N }; \
+    static SamplePacket Load(const T *p) { SamplePacket r; r.v = LOAD(p); return r; } \
+    static SamplePacket Set(T s) { SamplePacket r; r.v = SET(s); return r; } \
+    void Store(T *p) const { STORE(p,v); } \
+    SamplePacket operator +(const SamplePacket &b) const { SamplePacket r; r.v = ADD(v,b.v); return r; } \
+    SamplePacket operator -(const SamplePacket &b) const { SamplePacket r; r.v = SUB(v,b.v); return r; } \
+    SamplePacket operator *(const SamplePacket &b) const { SamplePacket r; r.v = MUL(v,b.v); return r; } \
+    V v; \
+};
+
+#if defined(FLEXT_SAMPLEPACKET_AVX)
+FLEXT_SAMPLEPACKET(float,8,__m256,_mm256_loadu_ps,_mm256_set1_ps,_mm256_storeu_ps,_mm256_add_ps,_mm256_sub_ps,_mm256_mul_ps)
+FLEXT_SAMPLEPACKET(double,4,__m256d,_mm256_loadu_pd,_mm256_set1_pd,_mm256_storeu_pd,_mm256_add_pd,_mm256_sub_pd,_mm256_mul_pd)
+#elif defined(FLEXT_SAMPLEPACKET_SSE2)
+FLEXT_SAMPLEPACKET(float,4,__m128,_mm_loadu_ps,_mm_set1_ps,_mm_storeu_ps,_mm_add_ps,_mm_sub_ps,_mm_mul_ps)
+FLEXT_SAMPLEPACKET(double,2,__m128d,_mm_loadu_pd,_mm_set1_pd,_mm_storeu_pd,_mm_add_pd,_mm_sub_pd,_mm_mul_pd)
+#elif defined(FLEXT_SAMPLEPACKET_NEON)
+FLEXT_SAMPLEPACKET(float,4,float32x4_t,vld1q_f32,vdupq_n_f32,vst1q_f32,vaddq_f32,vsubq_f32,vmulq_f32)
+#ifdef FLEXT_SAMPLEPACKET_NEON64
+FLEXT_SAMPLEPACKET(double,2,float64x2_t,vld1q_f64,vdupq_n_f64,vst1q_f64,vaddq_f64,vsubq_f64,vmulq_f64)
+#endif
+#endif
+
+#undef FLEXT_SAMPLEPACKET
+
+
+/*! \brief Base of all sample expressions
+    E is the actual expression type, it must provide
+        t_sample At(int i) const
+        SamplePacket<t_sample> Packet(int i) const
+*/
+template<class E>
+struct SampleExpr
+{
+    const E &Self() const { return static_cast<const E &>(*this); }
+};
+
+//! Sample array in an expression
+class SampleSrc
+    : public SampleExpr<SampleSrc>
+{
+public:
+    explicit SampleSrc(const t_sample *s): src(s) {}
+
+    t_sample At(int i) const { return src[i]; }
+    SamplePacket<t_sample> Packet(int i) const { return SamplePacket<t_sample>::Load(src+i); }
+
+protected:
+    const t_sample *src;
+};
+
+//! Constant value in an expression
+class SampleVal
+    : public SampleExpr<SampleVal>
+{
+public:
+    explicit SampleVal(t_sample v): val(v) {}
+
+    t_sample At(int) const { return val; }
+    SamplePacket<t_sample> Packet(int) const { return SamplePacket<t_sample>::Set(val); }
+
+protected:
+    t_sample val;
+};
+
+struct SampleAdd { template<typename T> static T Apply(const T &a,const T &b) { return a+b; } };
+struct SampleSub { template<typename T> static T Apply(const T &a,const T &b) { return a-b; } };
+struct SampleMul { template<typename T> static T Apply(const T &a,const T &b) { return a*b; } };
+
+//! Binary operation in an expression
+template<class L,class R,class O>
+class SampleBin
+    : public SampleExpr<SampleBin<L,R,O> >
+{
+public:
+    SampleBin(const L &l,const R &r): lhs(l),rhs(r) {}
+
+    t_sample At(int i) const { return O::Apply(lhs.At(i),rhs.At(i)); }
+    SamplePacket<t_sample> Packet(int i) const { return O::Apply(lhs.Packet(i),rhs.Packet(i)); }
+
+protected:
+    // sub-expressions are small, hold them by value
+    L lhs;
+    R rhs;
+};
+
+//! Evaluate an expression into dst
+template<class E>
+inline void SampleEval(t_sample *dst,int n,const E &e)
+{
+    typedef SamplePacket<t_sample> P;
+    int i = 0;
+    for(; i <= n-P::size; i += P::size) e.Packet(i).Store(dst+i);
+    for(; i < n; ++i) dst[i] = e.At(i);
+}
+
+//! Destination of an expression, with the block length
+class SampleDst
+{
+public:
+    SampleDst(t_sample *d,int n): dst(d),cnt(n) {}
+
+    template<class E>
+    SampleDst &operator =(const SampleExpr<E> &e) { SampleEval(dst,cnt,e.Self()); return *this; }
+    SampleDst &operator =(t_sample v) { SampleEval(dst,cnt,SampleVal(v)); return *this; }
+    //! copy samples (not the destination)
+    SampleDst &operator =(const SampleDst &d) { SampleEval(dst,cnt,SampleSrc(d.dst)); return *this; }
+
+    template<class E>
+    SampleDst &operator +=(const SampleExpr<E> &e) { SampleEval(dst,cnt,SampleBin<SampleSrc,E,SampleAdd>(SampleSrc(dst),e.Self())); return *this; }
+    template<class E>
+    SampleDst &operator -=(const SampleExpr<E> &e) { SampleEval(dst,cnt,SampleBin<SampleSrc,E,SampleSub>(SampleSrc(dst),e.Self())); return *this; }
+    template<class E>
+    SampleDst &operator *=(const SampleExpr<E> &e) { SampleEval(dst,cnt,SampleBin<SampleSrc,E,SampleMul>(SampleSrc(dst),e.Self())); return *this; }
+
+    SampleDst &operator +=(t_sample v) { return *this += SampleVal(v); }
+    SampleDst &operator -=(t_sample v) { return *this -= SampleVal(v); }
+    SampleDst &operator *=(t_sample v) { return *this *= SampleVal(v); }
+
+protected:
+    t_sample *dst;
+    int cnt;
+};
+
+#define FLEXT_SAMPLEOP(OP,O) \
+template<class L,class R> \
+inline SampleBin<L,R,O> operator OP(const SampleExpr<L> &l,const SampleExpr<R> &r) { return SampleBin<L,R,O>(l.Self(),r.Self()); } \
+template<class L> \
+inline SampleBin<L,SampleVal,O> operator OP(const SampleExpr<L> &l,t_sample r) { return SampleBin<L,SampleVal,O>(l.Self(),SampleVal(r)); } \
+template<class R> \
+inline SampleBin<SampleVal,R,O> operator OP(t_sample l,const SampleExpr<R> &r) { return SampleBin<SampleVal,R,O>(SampleVal(l),r.Self()); }
+
+FLEXT_SAMPLEOP(+,SampleAdd)
+FLEXT_SAMPLEOP(-,SampleSub)
+FLEXT_SAMPLEOP(*,SampleMul)
+
+#undef FLEXT_SAMPLEOP
+
+//!     @} FLEXT_S_SIMD
+
+#include "flpopns.h"
+
+#endif
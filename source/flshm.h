@@ -0,0 +1,258 @@
+/*
+flext - C++ layer for Max and Pure Data externals
+
+Copyright (c) 2001-2017 Thomas Grill (gr@grrrr.org)
+For information on usage and redistribution, and for a DISCLAIMER OF ALL
+WARRANTIES, see the file, "license.txt," in this distribution.
+*/
+
+/*! \file flshm.h
+    \brief Buffers exported to shared memory (see flext::buffer::Export)
+
+    The segment starts with a flext_shmheader, followed by the interleaved samples as 32-bit floats.
+    On Windows a mapping lives as long as any process has it open, so the segments are numbered 
+    and a small index segment (flext_shmindex) under the export name holds the number of the current one.
+    This header doesn't depend on the rest of flext, so that other processes can include it
+    and read the samples with flext_shmreader:
+
+        flext_shmreader rd;
+        if(rd.Open("mytable")) {
+            rd.Update(); // reopens the segment if it has been replaced
+            rd.Read(0,dst,rd.Frames());
+        }
+*/
+
+#ifndef __FLSHM_H
+#define __FLSHM_H
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#if defined(_WIN32)
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sched.h>
+#endif
+
+//! Header at the start of an exported buffer segment
+struct flext_shmheader
+{
+    enum { magic_id = 0x62786c66 /* "flxb" */, version_id = 1 };
+
+    unsigned int magic,version;
+    //! incremented before and after each change of the data, odd while the data is written
+    volatile unsigned int gen;
+    //! set if the segment has been replaced (after a resize) or the export has ended
+    volatile unsigned int stale;
+    //! current layout of the samples
+    volatile int channels,frames;
+    //! number of samples the segment can hold
+    int capacity;
+    //! sample rate of the buffer (the system sample rate with Pd)
+    volatile float samplerate;
+    //! byte offset of the samples from the start of the segment
+    unsigned int offset;
+};
+
+//! Index segment (Windows only), telling the number of the current segment
+struct flext_shmindex
+{
+    unsigned int magic;
+    volatile unsigned int segment;
+};
+
+//! Memory barrier for the generation counter
+inline void flext_shmfence()
+{
+#if defined(_MSC_VER)
+    MemoryBarrier();
+#else
+    __sync_synchronize();
+#endif
+}
+
+/*! \brief Make the system name of a segment
+    \param seg ... number of the segment (Windows only), 0 for the index segment
+*/
+inline void flext_shmname(char *dst,size_t sz,const char *name,unsigned int seg = 0)
+{
+#if defined(_WIN32)
+    if(seg)
+        snprintf(dst,sz,"flext-%s-%u",name,seg);
+    else
+        snprintf(dst,sz,"flext-%s",name);
+#else
+    // POSIX names must start with a slash and contain no other
+    snprintf(dst,sz,"/flext-%s",name);
+    for(char *c = dst+1; *c; ++c) if(*c == '/') *c = '_';
+#endif
+}
+
+/*! \brief Read access to an exported buffer from any process
+    \remark Data() gives the samples in place, Read copies them consistently while flext may write.
+*/
+class flext_shmreader
+{
+public:
+    flext_shmreader(): hdr(NULL),size(0)
+#if defined(_WIN32)
+        ,hmap(NULL)
+#endif
+    { name[0] = 0; }
+
+    ~flext_shmreader() { Close(); }
+
+    /*! \brief Map the segment of an exported buffer
+        \param nm ... export name (see flext::buffer::Export)
+        \return false if there is no such export (yet)
+    */
+    bool Open(const char *nm)
+    {
+        Close();
+        if(nm != name) {
+            strncpy(name,nm,sizeof(name)-1);
+            name[sizeof(name)-1] = 0;
+        }
+        char sn[sizeof(name)+20];
+        flext_shmname(sn,sizeof(sn),name);
+
+#if defined(_WIN32)
+        // look up the current segment
+        unsigned int seg = 0;
+        hmap = OpenFileMappingA(FILE_MAP_READ,FALSE,sn);
+        if(!hmap) return false;
+        const flext_shmindex *ix = static_cast<const flext_shmindex *>(MapViewOfFile(hmap,FILE_MAP_READ,0,0,sizeof(flext_shmindex)));
+        if(ix) {
+            if(ix->magic == flext_shmheader::magic_id) seg = ix->segment;
+            UnmapViewOfFile((void *)ix);
+        }
+        CloseHandle(hmap);
+        if(!seg) {
+            hmap = NULL;
+            return false;
+        }
+
+        flext_shmname(sn,sizeof(sn),name,seg);
+        hmap = OpenFileMappingA(FILE_MAP_READ,FALSE,sn);
+        if(!hmap) return false;
+        void *p = MapViewOfFile(hmap,FILE_MAP_READ,0,0,0);
+        MEMORY_BASIC_INFORMATION mi;
+        if(!p || !VirtualQuery(p,&mi,sizeof(mi))) {
+            if(p) UnmapViewOfFile(p);
+            CloseHandle(hmap); hmap = NULL;
+            return false;
+        }
+        size = mi.RegionSize;
+#else
+        const int fd = shm_open(sn,O_RDONLY,0);
+        struct stat st;
+        if(fd < 0 || fstat(fd,&st) < 0 || (size_t)st.st_size < sizeof(flext_shmheader)) {
+            if(fd >= 0) close(fd);
+            return false;
+        }
+        void *p = mmap(NULL,(size_t)st.st_size,PROT_READ,MAP_SHARED,fd,0);
+        close(fd);
+        if(p == MAP_FAILED) return false;
+        size = (size_t)st.st_size;
+#endif
+        hdr = static_cast<const flext_shmheader *>(p);
+        if(hdr->magic != flext_shmheader::magic_id || hdr->version != flext_shmheader::version_id ||
+            hdr->offset+hdr->capacity*sizeof(float) > size) {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    //! Unmap the segment
+    void Close()
+    {
+        if(!hdr) return;
+#if defined(_WIN32)
+        UnmapViewOfFile((void *)hdr);
+        CloseHandle(hmap); hmap = NULL;
+#else
+        munmap((void *)hdr,size);
+#endif
+        hdr = NULL;
+        size = 0;
+    }
+
+    /*! \brief Follow a replaced segment
+        \return true if the segment has been (re)opened
+        \remark Call it from time to time (e.g. before reading), after a resize the old segment isn't written any more.
+        If the new segment isn't there yet (or the first Open failed), it's tried again with the next call.
+    */
+    bool Update() { return *name && (!hdr || hdr->stale) && Open(name); }
+
+    //! Check if a segment is mapped
+    bool Ok() const { return hdr != NULL; }
+
+    //! Get channel count
+    int Channels() const { return hdr?hdr->channels:0; }
+    //! Get frame count
+    int Frames() const { return hdr?hdr->frames:0; }
+    //! Get sample rate
+    float Samplerate() const { return hdr?hdr->samplerate:0; }
+    //! Get the change counter, it's odd while the data is being written
+    unsigned int Generation() const { return hdr?hdr->gen:0; }
+
+    //! Get pointer to the interleaved samples
+    const float *Data() const { return hdr?reinterpret_cast<const float *>(reinterpret_cast<const char *>(hdr)+hdr->offset):NULL; }
+
+    /*! \brief Copy frames of a channel into dst, consistent with respect to changes by flext
+        \param offs ... first frame
+        \param cnt ... number of frames
+        \return false if the channel or frames are out of range
+    */
+    bool Read(int ch,float *dst,int cnt,int offs = 0) const
+    {
+        if(!hdr) return false;
+        for(;;) {
+            const unsigned int g = hdr->gen;
+            flext_shmfence();
+            if(g&1) {
+                // being written
+#if defined(_WIN32)
+                SwitchToThread();
+#else
+                sched_yield();
+#endif
+                continue;
+            }
+
+            const int st = hdr->channels;
+            if(ch < 0 || ch >= st || offs < 0 || cnt < 0 || offs+cnt > hdr->frames) return false;
+            const float *src = Data()+offs*st+ch;
+            if(st == 1)
+                memcpy(dst,src,cnt*sizeof(float));
+            else
+                for(int i = 0; i < cnt; ++i,src += st) dst[i] = *src;
+
+            flext_shmfence();
+            if(hdr->gen == g) return true;
+        }
+    }
+
+private:
+    const flext_shmheader *hdr;
+    size_t size;
+#if defined(_WIN32)
+    HANDLE hmap;
+#endif
+    char name[64];
+
+    // not copyable
+    flext_shmreader(const flext_shmreader &);
+    flext_shmreader &operator =(const flext_shmreader &);
+};
+
+#endif
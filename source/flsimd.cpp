@@ -55,6 +55,34 @@ WARRANTIES, see the file, "license.txt," in this distribution.
         #endif
     #endif
 
+    #if (FLEXT_CPU == FLEXT_CPU_IA32 || FLEXT_CPU == FLEXT_CPU_X86_64) && ( \
+            (defined(_MSC_VER) && _MSC_VER >= 1910) || defined(__clang__) || \
+            (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))) \
+        )
+        // AVX kernels are compiled for their own target, they are only called if the CPU supports them
+        #define FLEXT_SIMD_AVX 1
+        #ifndef FLEXT_NOAVX512
+            #define FLEXT_SIMD_AVX512 1
+        #endif
+
+        #include <immintrin.h>
+
+        #ifdef __GNUC__
+            #include <cpuid.h>
+            #define FLEXT_TARGET_SSE2 __attribute__((target("sse2")))
+            #define FLEXT_TARGET_AVX __attribute__((target("avx")))
+            #define FLEXT_TARGET_AVX512 __attribute__((target("avx512f")))
+        #else
+            #define FLEXT_TARGET_SSE2
+            #define FLEXT_TARGET_AVX
+            #define FLEXT_TARGET_AVX512
+        #endif
+    #elif FLEXT_CPU == FLEXT_CPU_ARM64 || (FLEXT_CPU == FLEXT_CPU_ARM && (defined(__ARM_NEON) || defined(__ARM_NEON__)))
+        // NEON is always there on AArch64, on 32-bit ARM it must be enabled for the compiler
+        #define FLEXT_SIMD_NEON 1
+        #include <arm_neon.h>
+    #endif
+
 #endif // FLEXT_USE_SIMD
 
 #include "flpushns.h"
@@ -68,6 +96,33 @@ FLEXT_TEMPIMPL(unsigned long FLEXT_CLASSDEF(flext))::simdcaps = FLEXT_TEMPINST(s
 
 FLEXT_TEMPIMPL(unsigned long FLEXT_CLASSDEF(flext))::GetSIMDCapabilities() { return simdcaps; }
 
+/*! \brief Sample functions in use
+    \internal
+    This is initialized statically, so that the functions can also be used before flext::Setup.
+*/
+FLEXT_TEMPIMPL(FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext))::simd_kernels FLEXT_CLASSDEF(flext))::kernels = {
+    &CopySamplesGeneric,
+    &SetSamplesGeneric,
+    &MulSamplesGeneric,
+    &MulSamplesGeneric,
+    &AddSamplesGeneric,
+    &AddSamplesGeneric,
+    &ScaleSamplesGeneric,
+    &ScaleSamplesGeneric,
+    &ScaleSamplesGeneric,
+    &MacSamplesGeneric,
+    &MacSamplesGeneric,
+    &DotSamplesGeneric,
+    &ClipSamplesGeneric,
+    &MinMaxSamplesGeneric,
+    &RampMulSamplesGeneric,
+    &RampSamplesGeneric,
+    &DeinterleaveSamplesGeneric,
+    &InterleaveSamplesGeneric,
+    &NarrowSamplesGeneric,
+    &WidenSamplesGeneric
+};
+
 
 #ifdef FLEXT_USE_SIMD
 
@@ -281,6 +336,31 @@ inline bool VectorsAligned(const void *v1,const void *v2,const void *v3,const vo
     ) == 0; 
 }
 
+#elif defined(__GNUC__) && FLEXT_SIMD_AVX
+// GCC and clang
+inline int _cpuid (_p_info *pinfo)
+{
+    unsigned int eax,ebx,ecx,edx;
+    int feature = 0;
+
+    if(__get_cpuid(1,&eax,&ebx,&ecx,&edx)) {
+        if(edx&_MMX_FEATURE_BIT) feature |= _CPU_FEATURE_MMX;
+        if(edx&_SSE_FEATURE_BIT) feature |= _CPU_FEATURE_SSE;
+        if(edx&_SSE2_FEATURE_BIT) feature |= _CPU_FEATURE_SSE2;
+    }
+    // __get_cpuid checks for the extended leaf itself
+    if(__get_cpuid(0x80000001,&eax,&ebx,&ecx,&edx) && (edx&_3DNOW_FEATURE_BIT))
+        feature |= _CPU_FEATURE_3DNOW;
+
+    if(pinfo) {
+        memset(pinfo,0,sizeof *pinfo);
+        pinfo->feature = feature;
+        // any OS this compiler runs on saves the SSE state
+        pinfo->os_support = feature;
+        pinfo->checks = _CPU_FEATURE_MMX|_CPU_FEATURE_SSE|_CPU_FEATURE_SSE2|_CPU_FEATURE_3DNOW;
+    }
+    return feature;
+}
 #else
 // not MSVC
 inline int _cpuid (_p_info *pinfo)
@@ -290,139 +370,2520 @@ inline int _cpuid (_p_info *pinfo)
 }
 #endif
 
+#if FLEXT_SIMD_AVX
+
+inline void _cpuidcount(unsigned int reg[4],unsigned int leaf,unsigned int sub)
+{
+#ifdef _MSC_VER
+    int r[4];
+    __cpuidex(r,leaf,sub);
+    for(int i = 0; i < 4; ++i) reg[i] = r[i];
+#else
+    reg[0] = reg[1] = reg[2] = reg[3] = 0;
+    if(__get_cpuid_max(leaf&0x80000000,NULL) >= leaf)
+        __cpuid_count(leaf,sub,reg[0],reg[1],reg[2],reg[3]);
+#endif
+}
+
+//! Get the register state the OS saves on context switches
+inline unsigned long long _getxcr0()
+{
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned int lo,hi;
+    // xgetbv, spelled out for older assemblers
+    __asm__ __volatile__ (".byte 0x0f,0x01,0xd0" : "=a" (lo), "=d" (hi) : "c" (0));
+    return ((unsigned long long)hi<<32)|lo;
+#endif
+}
+
+/*! \brief Determine AVX capabilities, including OS support
+    \internal
+*/
+inline unsigned long _avxcaps()
+{
+    unsigned int reg[4];
+    _cpuidcount(reg,1,0);
+    // AVX and OSXSAVE
+    if((reg[2]&0x18000000) != 0x18000000) return 0;
+
+    const unsigned long long xcr0 = _getxcr0();
+    // XMM and YMM state
+    if((xcr0&6) != 6) return 0;
+
+    unsigned long flags = flext::simd_avx;
+    _cpuidcount(reg,7,0);
+    if(reg[1]&(1<<5)) flags += flext::simd_avx2;
+    // AVX-512F and opmask/ZMM state
+    if((reg[1]&(1<<16)) && (xcr0&0xe0) == 0xe0) flags += flext::simd_avx512;
+    return flags;
+}
+
+#endif // FLEXT_SIMD_AVX
+
+#endif
+
+
+/*! \brief Determine SIMD capabilities
+    \internal
+*/
+inline unsigned long setsimdcaps()
+{
+    unsigned long simdflags = flext::simd_none;
+#if FLEXT_CPU == FLEXT_CPU_IA32 || FLEXT_CPU == FLEXT_CPU_X86_64
+    _p_info cpuinfo;
+    _cpuid(&cpuinfo);
+    if(cpuinfo.os_support&_CPU_FEATURE_MMX) simdflags += flext::simd_mmx;
+    if(cpuinfo.os_support&_CPU_FEATURE_3DNOW) simdflags += flext::simd_3dnow;
+    if(cpuinfo.os_support&_CPU_FEATURE_SSE) simdflags += flext::simd_sse;
+    if(cpuinfo.os_support&_CPU_FEATURE_SSE2) simdflags += flext::simd_sse2;
+#if FLEXT_SIMD_AVX
+    simdflags += _avxcaps();
+#endif
+#elif FLEXT_SIMD_NEON
+    simdflags += flext::simd_neon;
+#elif defined(__APPLE__) && defined(__VEC__) 
+    #if FLEXT_OSAPI == FLEXT_OSAPI_MAC_MACH
+
+    int selectors[2] = { CTL_HW, HW_VECTORUNIT }; 
+    int hasVectorUnit = 0; 
+    size_t length = sizeof(hasVectorUnit); 
+    int error = sysctl(selectors, 2, &hasVectorUnit, &length, NULL, 0); 
+
+    if(!error && hasVectorUnit != 0) simdflags += flext::simd_altivec; 
+        
+    #else
+
+    long cpuAttributes; 
+    Boolean hasAltiVec = false; 
+    OSErr err = Gestalt( gestaltPowerPCProcessorFeatures, &cpuAttributes ); 
+
+    if( noErr == err ) 
+    if(( 1 << gestaltPowerPCHasVectorInstructions) & cpuAttributes) simdflags += flext::simd_altivec; 
+
+    #endif
+#endif
+    return simdflags;
+}
+
+
+#if (FLEXT_CPU == FLEXT_CPU_PPC || FLEXT_CPU == FLEXT_CPU_PPC64)  && defined(__VEC__)
+
+/* functions for misaligned vector data - taken from the Altivec tutorial of Ian Ollmann, Ph.D. */
+
+//! Load a vector from an unaligned location in memory
+inline vector unsigned char LoadUnaligned( vector unsigned char *v )
+{
+    vector unsigned char permuteVector = vec_lvsl( 0, (int*) v );
+    vector unsigned char low = vec_ld( 0, v );
+    vector unsigned char high = vec_ld( 15, v );
+    return vec_perm( low, high, permuteVector );
+}
+
+/*
+//! Store a vector to an unaligned location in memory
+inline void StoreUnaligned( vector unsigned char v, vector unsigned char *where)
+{
+    // Load the surrounding area
+    vector unsigned char low = vec_ld( 0, where );
+    vector unsigned char high = vec_ld( 16, where );
+    // Prepare the constants that we need
+    vector unsigned char permuteVector = vec_lvsr( 0, (int*) where );
+
+    vector unsigned char oxFF = (vector unsigned char)vec_splat_s8( -1 );
+    vector unsigned char ox00 = (vector unsigned char)vec_splat_s8( 0 );
+    // Make a mask for which parts of the vectors to swap out
+    vector unsigned char mask = vec_perm( ox00, oxFF, permuteVector );
+    // Right rotate our input data
+    v = vec_perm( v, v, permuteVector );
+    // Insert our data into the low and high vectors
+    low = vec_sel( v, low, mask );
+    high = vec_sel( high, v, mask );
+    // Store the two aligned result vectors
+    vec_st( low, 0, where );
+    vec_st( high, 16, where );
+}
+*/
+
+inline vector float LoadUnaligned(const float *v )
+{
+    return (vector float)LoadUnaligned((vector unsigned char *)v);
+}
+
+/*
+inline void StoreUnaligned( vector float v,float *where)
+{
+    return StoreUnaligned((vector unsigned char)v,(vector unsigned char *)where);
+}
+*/
+
+inline bool IsVectorAligned(const void *where) 
+{
+    return (reinterpret_cast<size_t>(where)&(sizeof(vector float)-1)) == 0; 
+}
+
+inline bool VectorsAligned(const void *v1,const void *v2) 
+{
+    return (
+        (reinterpret_cast<size_t>(v1)|reinterpret_cast<size_t>(v2))
+        &(sizeof(vector float)-1)
+    ) == 0; 
+}
+
+inline bool VectorsAligned(const void *v1,const void *v2,const void *v3) 
+{
+    return (
+        (reinterpret_cast<size_t>(v1)|reinterpret_cast<size_t>(v2)|reinterpret_cast<size_t>(v3))
+        &(sizeof(vector float)-1)
+    ) == 0; 
+}
+
+inline bool VectorsAligned(const void *v1,const void *v2,const void *v3,const void *v4)
+{
+    return (
+        (reinterpret_cast<size_t>(v1)|reinterpret_cast<size_t>(v2)|reinterpret_cast<size_t>(v3)|reinterpret_cast<size_t>(v4))
+        &(sizeof(vector float)-1)
+    ) == 0; 
+}
+
+inline vector float LoadValue(const float &f)
+{
+    return vec_splat(IsVectorAligned(&f)?vec_ld(0,(vector float *)&f):LoadUnaligned(&f),0);
+}
+#endif
+
+
+#if FLEXT_SIMD_AVX || FLEXT_SIMD_NEON
+//! Lane offsets for ramps
+static const float ramp_lanes[16] = { 0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15 };
+static const double ramp_lanesd[8] = { 0,1,2,3,4,5,6,7 };
+
 #endif
 
+#if FLEXT_SIMD_AVX
+/* Unaligned AVX kernels for single precision samples
+   Plain multiply and add, so that results don't differ from the SSE and scalar code
+*/
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void CopyAVX(float *dst,const float *src,int cnt)
+{
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,dst += 16) {
+        _mm256_storeu_ps(dst,_mm256_loadu_ps(src));
+        _mm256_storeu_ps(dst+8,_mm256_loadu_ps(src+8));
+    }
+
+    while(cnt--) *(dst++) = *(src++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void SetAVX(float *dst,int cnt,float s)
+{
+    const __m256 a = _mm256_set1_ps(s);
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; dst += 16) {
+        _mm256_storeu_ps(dst,a);
+        _mm256_storeu_ps(dst+8,a);
+    }
+
+    while(cnt--) *(dst++) = s;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void MulAVX(float *dst,const float *src,float op,int cnt)
+{
+    const __m256 a = _mm256_set1_ps(op);
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,dst += 16) {
+        _mm256_storeu_ps(dst,_mm256_mul_ps(_mm256_loadu_ps(src),a));
+        _mm256_storeu_ps(dst+8,_mm256_mul_ps(_mm256_loadu_ps(src+8),a));
+    }
+
+    while(cnt--) *(dst++) = *(src++)*op;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void MulAVX(float *dst,const float *src,const float *op,int cnt)
+{
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,op += 16,dst += 16) {
+        _mm256_storeu_ps(dst,_mm256_mul_ps(_mm256_loadu_ps(src),_mm256_loadu_ps(op)));
+        _mm256_storeu_ps(dst+8,_mm256_mul_ps(_mm256_loadu_ps(src+8),_mm256_loadu_ps(op+8)));
+    }
+
+    while(cnt--) *(dst++) = *(src++) * *(op++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void AddAVX(float *dst,const float *src,float op,int cnt)
+{
+    const __m256 a = _mm256_set1_ps(op);
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,dst += 16) {
+        _mm256_storeu_ps(dst,_mm256_add_ps(_mm256_loadu_ps(src),a));
+        _mm256_storeu_ps(dst+8,_mm256_add_ps(_mm256_loadu_ps(src+8),a));
+    }
+
+    while(cnt--) *(dst++) = *(src++)+op;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void AddAVX(float *dst,const float *src,const float *op,int cnt)
+{
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,op += 16,dst += 16) {
+        _mm256_storeu_ps(dst,_mm256_add_ps(_mm256_loadu_ps(src),_mm256_loadu_ps(op)));
+        _mm256_storeu_ps(dst+8,_mm256_add_ps(_mm256_loadu_ps(src+8),_mm256_loadu_ps(op+8)));
+    }
+
+    while(cnt--) *(dst++) = *(src++) + *(op++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void ScaleAVX(float *dst,const float *src,float opmul,float opadd,int cnt)
+{
+    const __m256 m = _mm256_set1_ps(opmul);
+    const __m256 a = _mm256_set1_ps(opadd);
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,dst += 16) {
+        _mm256_storeu_ps(dst,_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(src),m),a));
+        _mm256_storeu_ps(dst+8,_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(src+8),m),a));
+    }
+
+    while(cnt--) *(dst++) = *(src++)*opmul+opadd;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void ScaleAVX(float *dst,const float *src,float opmul,const float *opadd,int cnt)
+{
+    const __m256 m = _mm256_set1_ps(opmul);
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,opadd += 16,dst += 16) {
+        _mm256_storeu_ps(dst,_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(src),m),_mm256_loadu_ps(opadd)));
+        _mm256_storeu_ps(dst+8,_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(src+8),m),_mm256_loadu_ps(opadd+8)));
+    }
+
+    while(cnt--) *(dst++) = *(src++)*opmul + *(opadd++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void ScaleAVX(float *dst,const float *src,const float *opmul,const float *opadd,int cnt)
+{
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,opmul += 16,opadd += 16,dst += 16) {
+        _mm256_storeu_ps(dst,_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(src),_mm256_loadu_ps(opmul)),_mm256_loadu_ps(opadd)));
+        _mm256_storeu_ps(dst+8,_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(src+8),_mm256_loadu_ps(opmul+8)),_mm256_loadu_ps(opadd+8)));
+    }
+
+    while(cnt--) *(dst++) = *(src++) * *(opmul++) + *(opadd++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void MacAVX(float *dst,const float *src,float op,int cnt)
+{
+    const __m256 a = _mm256_set1_ps(op);
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,dst += 16) {
+        _mm256_storeu_ps(dst,_mm256_add_ps(_mm256_loadu_ps(dst),_mm256_mul_ps(_mm256_loadu_ps(src),a)));
+        _mm256_storeu_ps(dst+8,_mm256_add_ps(_mm256_loadu_ps(dst+8),_mm256_mul_ps(_mm256_loadu_ps(src+8),a)));
+    }
+
+    while(cnt--) *(dst++) += *(src++)*op;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void MacAVX(float *dst,const float *src,const float *op,int cnt)
+{
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,op += 16,dst += 16) {
+        _mm256_storeu_ps(dst,_mm256_add_ps(_mm256_loadu_ps(dst),_mm256_mul_ps(_mm256_loadu_ps(src),_mm256_loadu_ps(op))));
+        _mm256_storeu_ps(dst+8,_mm256_add_ps(_mm256_loadu_ps(dst+8),_mm256_mul_ps(_mm256_loadu_ps(src+8),_mm256_loadu_ps(op+8))));
+    }
+
+    while(cnt--) *(dst++) += *(src++) * *(op++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX float DotAVX(const float *a,const float *b,int cnt)
+{
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    float r = 0;
+    if(n) {
+        __m256 acc0 = _mm256_set1_ps(0);
+        __m256 acc1 = _mm256_set1_ps(0);
+        for(; n--; a += 16,b += 16) {
+            acc0 = _mm256_add_ps(acc0,_mm256_mul_ps(_mm256_loadu_ps(a),_mm256_loadu_ps(b)));
+            acc1 = _mm256_add_ps(acc1,_mm256_mul_ps(_mm256_loadu_ps(a+8),_mm256_loadu_ps(b+8)));
+        }
+
+        float t[8];
+        _mm256_storeu_ps(t,_mm256_add_ps(acc0,acc1));
+        for(int i = 0; i < 8; ++i) r += t[i];
+    }
+
+    while(cnt--) r += *(a++) * *(b++);
+    return r;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void ClipAVX(float *dst,const float *src,float lo,float hi,int cnt)
+{
+    const __m256 l = _mm256_set1_ps(lo),h = _mm256_set1_ps(hi);
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,dst += 16) {
+        _mm256_storeu_ps(dst,_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src),l),h));
+        _mm256_storeu_ps(dst+8,_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src+8),l),h));
+    }
+
+    while(cnt--) {
+        const float v = *(src++);
+        *(dst++) = v < lo?lo:(v > hi?hi:v);
+    }
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void MinMaxAVX(const float *src,int cnt,float &mn,float &mx)
+{
+    if(cnt <= 0) {
+        mn = mx = 0;
+        return;
+    }
+
+    float l = *src,h = l;
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    if(n) {
+        __m256 vl = _mm256_set1_ps(l),vh = vl;
+        for(; n--; src += 16) {
+            const __m256 v0 = _mm256_loadu_ps(src);
+            const __m256 v1 = _mm256_loadu_ps(src+8);
+            vl = _mm256_min_ps(vl,v0); vh = _mm256_max_ps(vh,v0);
+            vl = _mm256_min_ps(vl,v1); vh = _mm256_max_ps(vh,v1);
+        }
+
+        float tl[8],th[8];
+        _mm256_storeu_ps(tl,vl);
+        _mm256_storeu_ps(th,vh);
+        for(int i = 0; i < 8; ++i) {
+            if(tl[i] < l) l = tl[i];
+            if(th[i] > h) h = th[i];
+        }
+    }
+
+    while(cnt--) {
+        const float v = *(src++);
+        if(v < l) l = v;
+        if(v > h) h = v;
+    }
+    mn = l,mx = h;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void RampMulAVX(float *dst,const float *src,float start,float inc,int cnt)
+{
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    if(n) {
+        const __m256 d = _mm256_set1_ps(inc*16);
+        __m256 g0 = _mm256_add_ps(_mm256_set1_ps(start),_mm256_mul_ps(_mm256_loadu_ps(ramp_lanes),_mm256_set1_ps(inc)));
+        __m256 g1 = _mm256_add_ps(g0,_mm256_set1_ps(inc*8));
+        for(int i = n; i--; src += 16,dst += 16) {
+            _mm256_storeu_ps(dst,_mm256_mul_ps(_mm256_loadu_ps(src),g0)); g0 = _mm256_add_ps(g0,d);
+            _mm256_storeu_ps(dst+8,_mm256_mul_ps(_mm256_loadu_ps(src+8),g1)); g1 = _mm256_add_ps(g1,d);
+        }
+        start += inc*(n*16);
+    }
+
+    for(int i = 0; i < cnt; ++i) dst[i] = src[i]*(start+i*inc);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void RampAVX(float *dst,float start,float inc,int cnt)
+{
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    if(n) {
+        const __m256 d = _mm256_set1_ps(inc*16);
+        __m256 g0 = _mm256_add_ps(_mm256_set1_ps(start),_mm256_mul_ps(_mm256_loadu_ps(ramp_lanes),_mm256_set1_ps(inc)));
+        __m256 g1 = _mm256_add_ps(g0,_mm256_set1_ps(inc*8));
+        for(int i = n; i--; dst += 16) {
+            _mm256_storeu_ps(dst,g0); g0 = _mm256_add_ps(g0,d);
+            _mm256_storeu_ps(dst+8,g1); g1 = _mm256_add_ps(g1,d);
+        }
+        start += inc*(n*16);
+    }
+
+    for(int i = 0; i < cnt; ++i) dst[i] = start+i*inc;
+}
+
+/* Channel access of interleaved frames for 2 and 4 channels (other channel counts are done in plain C)
+   Only the frames' own samples are loaded, the other channels are kept when writing
+*/
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void DeinterleaveAVX(float *dst,const float *src,int ch,int chns,int cnt)
+{
+    int n = 0;
+    if(chns == 2) {
+        // picks the channel of both frames in a 128-bit lane
+        const __m256i ctl = _mm256_setr_epi32(ch,2+ch,ch,2+ch,ch,2+ch,ch,2+ch);
+        for(; n+8 <= cnt; n += 8,src += 16,dst += 8) {
+            const __m256 a = _mm256_loadu_ps(src),b = _mm256_loadu_ps(src+8);
+            // frames 0,1,4,5 and 2,3,6,7
+            const __m256 lo = _mm256_permutevar_ps(_mm256_permute2f128_ps(a,b,0x20),ctl);
+            const __m256 hi = _mm256_permutevar_ps(_mm256_permute2f128_ps(a,b,0x31),ctl);
+            _mm256_storeu_ps(dst,_mm256_shuffle_ps(lo,hi,_MM_SHUFFLE(1,0,1,0)));
+        }
+    }
+    else if(chns == 4) {
+        // broadcasts the channel of the frame in a 128-bit lane
+        const __m256i ctl = _mm256_set1_epi32(ch);
+        for(; n+8 <= cnt; n += 8,src += 32,dst += 8) {
+            const __m256 a = _mm256_loadu_ps(src),b = _mm256_loadu_ps(src+8);
+            const __m256 c = _mm256_loadu_ps(src+16),d = _mm256_loadu_ps(src+24);
+            // frames 0,4 / 1,5 / 2,6 / 3,7
+            const __m256 x = _mm256_permutevar_ps(_mm256_permute2f128_ps(a,c,0x20),ctl);
+            const __m256 y = _mm256_permutevar_ps(_mm256_permute2f128_ps(a,c,0x31),ctl);
+            const __m256 z = _mm256_permutevar_ps(_mm256_permute2f128_ps(b,d,0x20),ctl);
+            const __m256 w = _mm256_permutevar_ps(_mm256_permute2f128_ps(b,d,0x31),ctl);
+            _mm256_storeu_ps(dst,_mm256_shuffle_ps(_mm256_unpacklo_ps(x,y),_mm256_unpacklo_ps(z,w),_MM_SHUFFLE(1,0,1,0)));
+        }
+    }
+
+    for(src += ch; n < cnt; ++n,src += chns) *(dst++) = *src;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void InterleaveAVX(float *dst,const float *src,int ch,int chns,int cnt)
+{
+    int n = 0;
+    if(chns == 2 || chns == 4) {
+        // positions of the channel in 8 samples
+        int msk[8];
+        for(int i = 0; i < 8; ++i) msk[i] = i%chns == ch?-1:0;
+        const __m256 m = _mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(msk)));
+
+        if(chns == 2) {
+            for(; n+8 <= cnt; n += 8,src += 8,dst += 16) {
+                const __m256 v = _mm256_loadu_ps(src);
+                const __m256 vl = _mm256_permute2f128_ps(v,v,0x00),vh = _mm256_permute2f128_ps(v,v,0x11);
+                // every sample twice, for frames 0-3 and 4-7
+                const __m256 l = _mm256_blend_ps(_mm256_unpacklo_ps(vl,vl),_mm256_unpackhi_ps(vl,vl),0xf0);
+                const __m256 h = _mm256_blend_ps(_mm256_unpacklo_ps(vh,vh),_mm256_unpackhi_ps(vh,vh),0xf0);
+                _mm256_storeu_ps(dst,_mm256_blendv_ps(_mm256_loadu_ps(dst),l,m));
+                _mm256_storeu_ps(dst+8,_mm256_blendv_ps(_mm256_loadu_ps(dst+8),h,m));
+            }
+        }
+        else {
+            // every sample four times, for two frames
+            const __m256i c0 = _mm256_setr_epi32(0,0,0,0,1,1,1,1),c1 = _mm256_setr_epi32(2,2,2,2,3,3,3,3);
+            for(; n+8 <= cnt; n += 8,src += 8,dst += 32) {
+                const __m256 v = _mm256_loadu_ps(src);
+                const __m256 vl = _mm256_permute2f128_ps(v,v,0x00),vh = _mm256_permute2f128_ps(v,v,0x11);
+                _mm256_storeu_ps(dst,_mm256_blendv_ps(_mm256_loadu_ps(dst),_mm256_permutevar_ps(vl,c0),m));
+                _mm256_storeu_ps(dst+8,_mm256_blendv_ps(_mm256_loadu_ps(dst+8),_mm256_permutevar_ps(vl,c1),m));
+                _mm256_storeu_ps(dst+16,_mm256_blendv_ps(_mm256_loadu_ps(dst+16),_mm256_permutevar_ps(vh,c0),m));
+                _mm256_storeu_ps(dst+24,_mm256_blendv_ps(_mm256_loadu_ps(dst+24),_mm256_permutevar_ps(vh,c1),m));
+            }
+        }
+    }
+
+    for(dst += ch; n < cnt; ++n,dst += chns) *dst = *(src++);
+}
+
+#if FLEXT_SIMD_AVX512
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void CopyAVX512(float *dst,const float *src,int cnt)
+{
+    int n = cnt>>5;
+    cnt -= n<<5;
+
+    for(; n--; src += 32,dst += 32) {
+        _mm512_storeu_ps(dst,_mm512_loadu_ps(src));
+        _mm512_storeu_ps(dst+16,_mm512_loadu_ps(src+16));
+    }
+
+    while(cnt--) *(dst++) = *(src++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void SetAVX512(float *dst,int cnt,float s)
+{
+    const __m512 a = _mm512_set1_ps(s);
+    int n = cnt>>5;
+    cnt -= n<<5;
+
+    for(; n--; dst += 32) {
+        _mm512_storeu_ps(dst,a);
+        _mm512_storeu_ps(dst+16,a);
+    }
+
+    while(cnt--) *(dst++) = s;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void MulAVX512(float *dst,const float *src,float op,int cnt)
+{
+    const __m512 a = _mm512_set1_ps(op);
+    int n = cnt>>5;
+    cnt -= n<<5;
+
+    for(; n--; src += 32,dst += 32) {
+        _mm512_storeu_ps(dst,_mm512_mul_ps(_mm512_loadu_ps(src),a));
+        _mm512_storeu_ps(dst+16,_mm512_mul_ps(_mm512_loadu_ps(src+16),a));
+    }
+
+    while(cnt--) *(dst++) = *(src++)*op;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void MulAVX512(float *dst,const float *src,const float *op,int cnt)
+{
+    int n = cnt>>5;
+    cnt -= n<<5;
+
+    for(; n--; src += 32,op += 32,dst += 32) {
+        _mm512_storeu_ps(dst,_mm512_mul_ps(_mm512_loadu_ps(src),_mm512_loadu_ps(op)));
+        _mm512_storeu_ps(dst+16,_mm512_mul_ps(_mm512_loadu_ps(src+16),_mm512_loadu_ps(op+16)));
+    }
+
+    while(cnt--) *(dst++) = *(src++) * *(op++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void AddAVX512(float *dst,const float *src,float op,int cnt)
+{
+    const __m512 a = _mm512_set1_ps(op);
+    int n = cnt>>5;
+    cnt -= n<<5;
+
+    for(; n--; src += 32,dst += 32) {
+        _mm512_storeu_ps(dst,_mm512_add_ps(_mm512_loadu_ps(src),a));
+        _mm512_storeu_ps(dst+16,_mm512_add_ps(_mm512_loadu_ps(src+16),a));
+    }
+
+    while(cnt--) *(dst++) = *(src++)+op;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void AddAVX512(float *dst,const float *src,const float *op,int cnt)
+{
+    int n = cnt>>5;
+    cnt -= n<<5;
+
+    for(; n--; src += 32,op += 32,dst += 32) {
+        _mm512_storeu_ps(dst,_mm512_add_ps(_mm512_loadu_ps(src),_mm512_loadu_ps(op)));
+        _mm512_storeu_ps(dst+16,_mm512_add_ps(_mm512_loadu_ps(src+16),_mm512_loadu_ps(op+16)));
+    }
+
+    while(cnt--) *(dst++) = *(src++) + *(op++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void ScaleAVX512(float *dst,const float *src,float opmul,float opadd,int cnt)
+{
+    const __m512 m = _mm512_set1_ps(opmul);
+    const __m512 a = _mm512_set1_ps(opadd);
+    int n = cnt>>5;
+    cnt -= n<<5;
+
+    for(; n--; src += 32,dst += 32) {
+        _mm512_storeu_ps(dst,_mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(src),m),a));
+        _mm512_storeu_ps(dst+16,_mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(src+16),m),a));
+    }
+
+    while(cnt--) *(dst++) = *(src++)*opmul+opadd;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void ScaleAVX512(float *dst,const float *src,float opmul,const float *opadd,int cnt)
+{
+    const __m512 m = _mm512_set1_ps(opmul);
+    int n = cnt>>5;
+    cnt -= n<<5;
+
+    for(; n--; src += 32,opadd += 32,dst += 32) {
+        _mm512_storeu_ps(dst,_mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(src),m),_mm512_loadu_ps(opadd)));
+        _mm512_storeu_ps(dst+16,_mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(src+16),m),_mm512_loadu_ps(opadd+16)));
+    }
+
+    while(cnt--) *(dst++) = *(src++)*opmul + *(opadd++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void ScaleAVX512(float *dst,const float *src,const float *opmul,const float *opadd,int cnt)
+{
+    int n = cnt>>5;
+    cnt -= n<<5;
+
+    for(; n--; src += 32,opmul += 32,opadd += 32,dst += 32) {
+        _mm512_storeu_ps(dst,_mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(src),_mm512_loadu_ps(opmul)),_mm512_loadu_ps(opadd)));
+        _mm512_storeu_ps(dst+16,_mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(src+16),_mm512_loadu_ps(opmul+16)),_mm512_loadu_ps(opadd+16)));
+    }
+
+    while(cnt--) *(dst++) = *(src++) * *(opmul++) + *(opadd++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void MacAVX512(float *dst,const float *src,float op,int cnt)
+{
+    const __m512 a = _mm512_set1_ps(op);
+    int n = cnt>>5;
+    cnt -= n<<5;
+
+    for(; n--; src += 32,dst += 32) {
+        _mm512_storeu_ps(dst,_mm512_add_ps(_mm512_loadu_ps(dst),_mm512_mul_ps(_mm512_loadu_ps(src),a)));
+        _mm512_storeu_ps(dst+16,_mm512_add_ps(_mm512_loadu_ps(dst+16),_mm512_mul_ps(_mm512_loadu_ps(src+16),a)));
+    }
+
+    while(cnt--) *(dst++) += *(src++)*op;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void MacAVX512(float *dst,const float *src,const float *op,int cnt)
+{
+    int n = cnt>>5;
+    cnt -= n<<5;
+
+    for(; n--; src += 32,op += 32,dst += 32) {
+        _mm512_storeu_ps(dst,_mm512_add_ps(_mm512_loadu_ps(dst),_mm512_mul_ps(_mm512_loadu_ps(src),_mm512_loadu_ps(op))));
+        _mm512_storeu_ps(dst+16,_mm512_add_ps(_mm512_loadu_ps(dst+16),_mm512_mul_ps(_mm512_loadu_ps(src+16),_mm512_loadu_ps(op+16))));
+    }
+
+    while(cnt--) *(dst++) += *(src++) * *(op++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 float DotAVX512(const float *a,const float *b,int cnt)
+{
+    int n = cnt>>5;
+    cnt -= n<<5;
+
+    float r = 0;
+    if(n) {
+        __m512 acc0 = _mm512_set1_ps(0);
+        __m512 acc1 = _mm512_set1_ps(0);
+        for(; n--; a += 32,b += 32) {
+            acc0 = _mm512_add_ps(acc0,_mm512_mul_ps(_mm512_loadu_ps(a),_mm512_loadu_ps(b)));
+            acc1 = _mm512_add_ps(acc1,_mm512_mul_ps(_mm512_loadu_ps(a+16),_mm512_loadu_ps(b+16)));
+        }
+
+        float t[16];
+        _mm512_storeu_ps(t,_mm512_add_ps(acc0,acc1));
+        for(int i = 0; i < 16; ++i) r += t[i];
+    }
+
+    while(cnt--) r += *(a++) * *(b++);
+    return r;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void ClipAVX512(float *dst,const float *src,float lo,float hi,int cnt)
+{
+    const __m512 l = _mm512_set1_ps(lo),h = _mm512_set1_ps(hi);
+    int n = cnt>>5;
+    cnt -= n<<5;
+
+    for(; n--; src += 32,dst += 32) {
+        _mm512_storeu_ps(dst,_mm512_min_ps(_mm512_max_ps(_mm512_loadu_ps(src),l),h));
+        _mm512_storeu_ps(dst+16,_mm512_min_ps(_mm512_max_ps(_mm512_loadu_ps(src+16),l),h));
+    }
+
+    while(cnt--) {
+        const float v = *(src++);
+        *(dst++) = v < lo?lo:(v > hi?hi:v);
+    }
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void MinMaxAVX512(const float *src,int cnt,float &mn,float &mx)
+{
+    if(cnt <= 0) {
+        mn = mx = 0;
+        return;
+    }
+
+    float l = *src,h = l;
+    int n = cnt>>5;
+    cnt -= n<<5;
+
+    if(n) {
+        __m512 vl = _mm512_set1_ps(l),vh = vl;
+        for(; n--; src += 32) {
+            const __m512 v0 = _mm512_loadu_ps(src);
+            const __m512 v1 = _mm512_loadu_ps(src+16);
+            vl = _mm512_min_ps(vl,v0); vh = _mm512_max_ps(vh,v0);
+            vl = _mm512_min_ps(vl,v1); vh = _mm512_max_ps(vh,v1);
+        }
+
+        float tl[16],th[16];
+        _mm512_storeu_ps(tl,vl);
+        _mm512_storeu_ps(th,vh);
+        for(int i = 0; i < 16; ++i) {
+            if(tl[i] < l) l = tl[i];
+            if(th[i] > h) h = th[i];
+        }
+    }
+
+    while(cnt--) {
+        const float v = *(src++);
+        if(v < l) l = v;
+        if(v > h) h = v;
+    }
+    mn = l,mx = h;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void RampMulAVX512(float *dst,const float *src,float start,float inc,int cnt)
+{
+    int n = cnt>>5;
+    cnt -= n<<5;
+
+    if(n) {
+        const __m512 d = _mm512_set1_ps(inc*32);
+        __m512 g0 = _mm512_add_ps(_mm512_set1_ps(start),_mm512_mul_ps(_mm512_loadu_ps(ramp_lanes),_mm512_set1_ps(inc)));
+        __m512 g1 = _mm512_add_ps(g0,_mm512_set1_ps(inc*16));
+        for(int i = n; i--; src += 32,dst += 32) {
+            _mm512_storeu_ps(dst,_mm512_mul_ps(_mm512_loadu_ps(src),g0)); g0 = _mm512_add_ps(g0,d);
+            _mm512_storeu_ps(dst+16,_mm512_mul_ps(_mm512_loadu_ps(src+16),g1)); g1 = _mm512_add_ps(g1,d);
+        }
+        start += inc*(n*32);
+    }
+
+    for(int i = 0; i < cnt; ++i) dst[i] = src[i]*(start+i*inc);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void RampAVX512(float *dst,float start,float inc,int cnt)
+{
+    int n = cnt>>5;
+    cnt -= n<<5;
+
+    if(n) {
+        const __m512 d = _mm512_set1_ps(inc*32);
+        __m512 g0 = _mm512_add_ps(_mm512_set1_ps(start),_mm512_mul_ps(_mm512_loadu_ps(ramp_lanes),_mm512_set1_ps(inc)));
+        __m512 g1 = _mm512_add_ps(g0,_mm512_set1_ps(inc*16));
+        for(int i = n; i--; dst += 32) {
+            _mm512_storeu_ps(dst,g0); g0 = _mm512_add_ps(g0,d);
+            _mm512_storeu_ps(dst+16,g1); g1 = _mm512_add_ps(g1,d);
+        }
+        start += inc*(n*32);
+    }
+
+    for(int i = 0; i < cnt; ++i) dst[i] = start+i*inc;
+}
+
+#endif // FLEXT_SIMD_AVX512
+#endif // FLEXT_SIMD_AVX
+
+#if FLEXT_SIMD_NEON
+/* NEON kernels for single precision samples
+   NEON has no alignment restrictions for vld1q/vst1q
+*/
+
+FLEXT_TEMPLATE void CopyNEON(float *dst,const float *src,int cnt)
+{
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,dst += 16) {
+        vst1q_f32(dst,vld1q_f32(src));
+        vst1q_f32(dst+4,vld1q_f32(src+4));
+        vst1q_f32(dst+8,vld1q_f32(src+8));
+        vst1q_f32(dst+12,vld1q_f32(src+12));
+    }
+
+    while(cnt--) *(dst++) = *(src++);
+}
+
+FLEXT_TEMPLATE void SetNEON(float *dst,int cnt,float s)
+{
+    const float32x4_t a = vdupq_n_f32(s);
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; dst += 16) {
+        vst1q_f32(dst,a);
+        vst1q_f32(dst+4,a);
+        vst1q_f32(dst+8,a);
+        vst1q_f32(dst+12,a);
+    }
+
+    while(cnt--) *(dst++) = s;
+}
+
+FLEXT_TEMPLATE void MulNEON(float *dst,const float *src,float op,int cnt)
+{
+    const float32x4_t a = vdupq_n_f32(op);
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,dst += 16) {
+        vst1q_f32(dst,vmulq_f32(vld1q_f32(src),a));
+        vst1q_f32(dst+4,vmulq_f32(vld1q_f32(src+4),a));
+        vst1q_f32(dst+8,vmulq_f32(vld1q_f32(src+8),a));
+        vst1q_f32(dst+12,vmulq_f32(vld1q_f32(src+12),a));
+    }
+
+    while(cnt--) *(dst++) = *(src++)*op;
+}
+
+FLEXT_TEMPLATE void MulNEON(float *dst,const float *src,const float *op,int cnt)
+{
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,op += 16,dst += 16) {
+        vst1q_f32(dst,vmulq_f32(vld1q_f32(src),vld1q_f32(op)));
+        vst1q_f32(dst+4,vmulq_f32(vld1q_f32(src+4),vld1q_f32(op+4)));
+        vst1q_f32(dst+8,vmulq_f32(vld1q_f32(src+8),vld1q_f32(op+8)));
+        vst1q_f32(dst+12,vmulq_f32(vld1q_f32(src+12),vld1q_f32(op+12)));
+    }
+
+    while(cnt--) *(dst++) = *(src++) * *(op++);
+}
+
+FLEXT_TEMPLATE void AddNEON(float *dst,const float *src,float op,int cnt)
+{
+    const float32x4_t a = vdupq_n_f32(op);
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,dst += 16) {
+        vst1q_f32(dst,vaddq_f32(vld1q_f32(src),a));
+        vst1q_f32(dst+4,vaddq_f32(vld1q_f32(src+4),a));
+        vst1q_f32(dst+8,vaddq_f32(vld1q_f32(src+8),a));
+        vst1q_f32(dst+12,vaddq_f32(vld1q_f32(src+12),a));
+    }
+
+    while(cnt--) *(dst++) = *(src++)+op;
+}
+
+FLEXT_TEMPLATE void AddNEON(float *dst,const float *src,const float *op,int cnt)
+{
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,op += 16,dst += 16) {
+        vst1q_f32(dst,vaddq_f32(vld1q_f32(src),vld1q_f32(op)));
+        vst1q_f32(dst+4,vaddq_f32(vld1q_f32(src+4),vld1q_f32(op+4)));
+        vst1q_f32(dst+8,vaddq_f32(vld1q_f32(src+8),vld1q_f32(op+8)));
+        vst1q_f32(dst+12,vaddq_f32(vld1q_f32(src+12),vld1q_f32(op+12)));
+    }
+
+    while(cnt--) *(dst++) = *(src++) + *(op++);
+}
+
+FLEXT_TEMPLATE void ScaleNEON(float *dst,const float *src,float opmul,float opadd,int cnt)
+{
+    const float32x4_t m = vdupq_n_f32(opmul);
+    const float32x4_t a = vdupq_n_f32(opadd);
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,dst += 16) {
+        vst1q_f32(dst,vaddq_f32(vmulq_f32(vld1q_f32(src),m),a));
+        vst1q_f32(dst+4,vaddq_f32(vmulq_f32(vld1q_f32(src+4),m),a));
+        vst1q_f32(dst+8,vaddq_f32(vmulq_f32(vld1q_f32(src+8),m),a));
+        vst1q_f32(dst+12,vaddq_f32(vmulq_f32(vld1q_f32(src+12),m),a));
+    }
+
+    while(cnt--) *(dst++) = *(src++)*opmul+opadd;
+}
+
+FLEXT_TEMPLATE void ScaleNEON(float *dst,const float *src,float opmul,const float *opadd,int cnt)
+{
+    const float32x4_t m = vdupq_n_f32(opmul);
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,opadd += 16,dst += 16) {
+        vst1q_f32(dst,vaddq_f32(vmulq_f32(vld1q_f32(src),m),vld1q_f32(opadd)));
+        vst1q_f32(dst+4,vaddq_f32(vmulq_f32(vld1q_f32(src+4),m),vld1q_f32(opadd+4)));
+        vst1q_f32(dst+8,vaddq_f32(vmulq_f32(vld1q_f32(src+8),m),vld1q_f32(opadd+8)));
+        vst1q_f32(dst+12,vaddq_f32(vmulq_f32(vld1q_f32(src+12),m),vld1q_f32(opadd+12)));
+    }
+
+    while(cnt--) *(dst++) = *(src++)*opmul + *(opadd++);
+}
+
+FLEXT_TEMPLATE void ScaleNEON(float *dst,const float *src,const float *opmul,const float *opadd,int cnt)
+{
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,opmul += 16,opadd += 16,dst += 16) {
+        vst1q_f32(dst,vaddq_f32(vmulq_f32(vld1q_f32(src),vld1q_f32(opmul)),vld1q_f32(opadd)));
+        vst1q_f32(dst+4,vaddq_f32(vmulq_f32(vld1q_f32(src+4),vld1q_f32(opmul+4)),vld1q_f32(opadd+4)));
+        vst1q_f32(dst+8,vaddq_f32(vmulq_f32(vld1q_f32(src+8),vld1q_f32(opmul+8)),vld1q_f32(opadd+8)));
+        vst1q_f32(dst+12,vaddq_f32(vmulq_f32(vld1q_f32(src+12),vld1q_f32(opmul+12)),vld1q_f32(opadd+12)));
+    }
+
+    while(cnt--) *(dst++) = *(src++) * *(opmul++) + *(opadd++);
+}
+
+FLEXT_TEMPLATE void MacNEON(float *dst,const float *src,float op,int cnt)
+{
+    const float32x4_t a = vdupq_n_f32(op);
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,dst += 16) {
+        vst1q_f32(dst,vaddq_f32(vld1q_f32(dst),vmulq_f32(vld1q_f32(src),a)));
+        vst1q_f32(dst+4,vaddq_f32(vld1q_f32(dst+4),vmulq_f32(vld1q_f32(src+4),a)));
+        vst1q_f32(dst+8,vaddq_f32(vld1q_f32(dst+8),vmulq_f32(vld1q_f32(src+8),a)));
+        vst1q_f32(dst+12,vaddq_f32(vld1q_f32(dst+12),vmulq_f32(vld1q_f32(src+12),a)));
+    }
+
+    while(cnt--) *(dst++) += *(src++)*op;
+}
+
+FLEXT_TEMPLATE void MacNEON(float *dst,const float *src,const float *op,int cnt)
+{
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,op += 16,dst += 16) {
+        vst1q_f32(dst,vaddq_f32(vld1q_f32(dst),vmulq_f32(vld1q_f32(src),vld1q_f32(op))));
+        vst1q_f32(dst+4,vaddq_f32(vld1q_f32(dst+4),vmulq_f32(vld1q_f32(src+4),vld1q_f32(op+4))));
+        vst1q_f32(dst+8,vaddq_f32(vld1q_f32(dst+8),vmulq_f32(vld1q_f32(src+8),vld1q_f32(op+8))));
+        vst1q_f32(dst+12,vaddq_f32(vld1q_f32(dst+12),vmulq_f32(vld1q_f32(src+12),vld1q_f32(op+12))));
+    }
+
+    while(cnt--) *(dst++) += *(src++) * *(op++);
+}
+
+FLEXT_TEMPLATE float DotNEON(const float *a,const float *b,int cnt)
+{
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    float r = 0;
+    if(n) {
+        float32x4_t acc0 = vdupq_n_f32(0);
+        float32x4_t acc1 = vdupq_n_f32(0);
+        float32x4_t acc2 = vdupq_n_f32(0);
+        float32x4_t acc3 = vdupq_n_f32(0);
+        for(; n--; a += 16,b += 16) {
+            acc0 = vaddq_f32(acc0,vmulq_f32(vld1q_f32(a),vld1q_f32(b)));
+            acc1 = vaddq_f32(acc1,vmulq_f32(vld1q_f32(a+4),vld1q_f32(b+4)));
+            acc2 = vaddq_f32(acc2,vmulq_f32(vld1q_f32(a+8),vld1q_f32(b+8)));
+            acc3 = vaddq_f32(acc3,vmulq_f32(vld1q_f32(a+12),vld1q_f32(b+12)));
+        }
+
+        float t[4];
+        vst1q_f32(t,vaddq_f32(vaddq_f32(vaddq_f32(acc0,acc1),acc2),acc3));
+        for(int i = 0; i < 4; ++i) r += t[i];
+    }
+
+    while(cnt--) r += *(a++) * *(b++);
+    return r;
+}
+
+FLEXT_TEMPLATE void ClipNEON(float *dst,const float *src,float lo,float hi,int cnt)
+{
+    const float32x4_t l = vdupq_n_f32(lo),h = vdupq_n_f32(hi);
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,dst += 16) {
+        vst1q_f32(dst,vminq_f32(vmaxq_f32(vld1q_f32(src),l),h));
+        vst1q_f32(dst+4,vminq_f32(vmaxq_f32(vld1q_f32(src+4),l),h));
+        vst1q_f32(dst+8,vminq_f32(vmaxq_f32(vld1q_f32(src+8),l),h));
+        vst1q_f32(dst+12,vminq_f32(vmaxq_f32(vld1q_f32(src+12),l),h));
+    }
+
+    while(cnt--) {
+        const float v = *(src++);
+        *(dst++) = v < lo?lo:(v > hi?hi:v);
+    }
+}
+
+FLEXT_TEMPLATE void MinMaxNEON(const float *src,int cnt,float &mn,float &mx)
+{
+    if(cnt <= 0) {
+        mn = mx = 0;
+        return;
+    }
+
+    float l = *src,h = l;
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    if(n) {
+        float32x4_t vl = vdupq_n_f32(l),vh = vl;
+        for(; n--; src += 16) {
+            const float32x4_t v0 = vld1q_f32(src);
+            const float32x4_t v1 = vld1q_f32(src+4);
+            const float32x4_t v2 = vld1q_f32(src+8);
+            const float32x4_t v3 = vld1q_f32(src+12);
+            vl = vminq_f32(vl,v0); vh = vmaxq_f32(vh,v0);
+            vl = vminq_f32(vl,v1); vh = vmaxq_f32(vh,v1);
+            vl = vminq_f32(vl,v2); vh = vmaxq_f32(vh,v2);
+            vl = vminq_f32(vl,v3); vh = vmaxq_f32(vh,v3);
+        }
+
+        float tl[4],th[4];
+        vst1q_f32(tl,vl);
+        vst1q_f32(th,vh);
+        for(int i = 0; i < 4; ++i) {
+            if(tl[i] < l) l = tl[i];
+            if(th[i] > h) h = th[i];
+        }
+    }
+
+    while(cnt--) {
+        const float v = *(src++);
+        if(v < l) l = v;
+        if(v > h) h = v;
+    }
+    mn = l,mx = h;
+}
+
+FLEXT_TEMPLATE void RampMulNEON(float *dst,const float *src,float start,float inc,int cnt)
+{
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    if(n) {
+        const float32x4_t d = vdupq_n_f32(inc*16);
+        float32x4_t g0 = vaddq_f32(vdupq_n_f32(start),vmulq_f32(vld1q_f32(ramp_lanes),vdupq_n_f32(inc)));
+        float32x4_t g1 = vaddq_f32(g0,vdupq_n_f32(inc*4));
+        float32x4_t g2 = vaddq_f32(g1,vdupq_n_f32(inc*4));
+        float32x4_t g3 = vaddq_f32(g2,vdupq_n_f32(inc*4));
+        for(int i = n; i--; src += 16,dst += 16) {
+            vst1q_f32(dst,vmulq_f32(vld1q_f32(src),g0)); g0 = vaddq_f32(g0,d);
+            vst1q_f32(dst+4,vmulq_f32(vld1q_f32(src+4),g1)); g1 = vaddq_f32(g1,d);
+            vst1q_f32(dst+8,vmulq_f32(vld1q_f32(src+8),g2)); g2 = vaddq_f32(g2,d);
+            vst1q_f32(dst+12,vmulq_f32(vld1q_f32(src+12),g3)); g3 = vaddq_f32(g3,d);
+        }
+        start += inc*(n*16);
+    }
+
+    for(int i = 0; i < cnt; ++i) dst[i] = src[i]*(start+i*inc);
+}
+
+FLEXT_TEMPLATE void RampNEON(float *dst,float start,float inc,int cnt)
+{
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    if(n) {
+        const float32x4_t d = vdupq_n_f32(inc*16);
+        float32x4_t g0 = vaddq_f32(vdupq_n_f32(start),vmulq_f32(vld1q_f32(ramp_lanes),vdupq_n_f32(inc)));
+        float32x4_t g1 = vaddq_f32(g0,vdupq_n_f32(inc*4));
+        float32x4_t g2 = vaddq_f32(g1,vdupq_n_f32(inc*4));
+        float32x4_t g3 = vaddq_f32(g2,vdupq_n_f32(inc*4));
+        for(int i = n; i--; dst += 16) {
+            vst1q_f32(dst,g0); g0 = vaddq_f32(g0,d);
+            vst1q_f32(dst+4,g1); g1 = vaddq_f32(g1,d);
+            vst1q_f32(dst+8,g2); g2 = vaddq_f32(g2,d);
+            vst1q_f32(dst+12,g3); g3 = vaddq_f32(g3,d);
+        }
+        start += inc*(n*16);
+    }
+
+    for(int i = 0; i < cnt; ++i) dst[i] = start+i*inc;
+}
+
+/* Channel access of interleaved frames for 2 and 4 channels (other channel counts are done in plain C) */
+
+FLEXT_TEMPLATE void DeinterleaveNEON(float *dst,const float *src,int ch,int chns,int cnt)
+{
+    int n = 0;
+    if(chns == 2)
+        for(; n+4 <= cnt; n += 4,src += 8,dst += 4) vst1q_f32(dst,vld2q_f32(src).val[ch]);
+    else if(chns == 4)
+        for(; n+4 <= cnt; n += 4,src += 16,dst += 4) vst1q_f32(dst,vld4q_f32(src).val[ch]);
+
+    for(src += ch; n < cnt; ++n,src += chns) *(dst++) = *src;
+}
+
+FLEXT_TEMPLATE void InterleaveNEON(float *dst,const float *src,int ch,int chns,int cnt)
+{
+    int n = 0;
+    if(chns == 2)
+        for(; n+4 <= cnt; n += 4,src += 4,dst += 8) {
+            float32x4x2_t f = vld2q_f32(dst);
+            f.val[ch] = vld1q_f32(src);
+            vst2q_f32(dst,f);
+        }
+    else if(chns == 4)
+        for(; n+4 <= cnt; n += 4,src += 4,dst += 16) {
+            float32x4x4_t f = vld4q_f32(dst);
+            f.val[ch] = vld1q_f32(src);
+            vst4q_f32(dst,f);
+        }
+
+    for(dst += ch; n < cnt; ++n,dst += chns) *dst = *(src++);
+}
+
+#endif // FLEXT_SIMD_NEON
+
+#if FLEXT_SIMD_AVX
+/* Double precision kernels (Max 64-bit, Pd double builds)
+   SSE2 is there on every x86_64 CPU, the others are selected at run-time
+*/
+
+FLEXT_TEMPLATE FLEXT_TARGET_SSE2 void CopySSE2d(double *dst,const double *src,int cnt)
+{
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,dst += 8) {
+        _mm_storeu_pd(dst,_mm_loadu_pd(src));
+        _mm_storeu_pd(dst+2,_mm_loadu_pd(src+2));
+        _mm_storeu_pd(dst+4,_mm_loadu_pd(src+4));
+        _mm_storeu_pd(dst+6,_mm_loadu_pd(src+6));
+    }
+
+    while(cnt--) *(dst++) = *(src++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_SSE2 void SetSSE2d(double *dst,int cnt,double s)
+{
+    const __m128d a = _mm_set1_pd(s);
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; dst += 8) {
+        _mm_storeu_pd(dst,a);
+        _mm_storeu_pd(dst+2,a);
+        _mm_storeu_pd(dst+4,a);
+        _mm_storeu_pd(dst+6,a);
+    }
+
+    while(cnt--) *(dst++) = s;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_SSE2 void MulSSE2d(double *dst,const double *src,double op,int cnt)
+{
+    const __m128d a = _mm_set1_pd(op);
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,dst += 8) {
+        _mm_storeu_pd(dst,_mm_mul_pd(_mm_loadu_pd(src),a));
+        _mm_storeu_pd(dst+2,_mm_mul_pd(_mm_loadu_pd(src+2),a));
+        _mm_storeu_pd(dst+4,_mm_mul_pd(_mm_loadu_pd(src+4),a));
+        _mm_storeu_pd(dst+6,_mm_mul_pd(_mm_loadu_pd(src+6),a));
+    }
+
+    while(cnt--) *(dst++) = *(src++)*op;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_SSE2 void MulSSE2d(double *dst,const double *src,const double *op,int cnt)
+{
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,op += 8,dst += 8) {
+        _mm_storeu_pd(dst,_mm_mul_pd(_mm_loadu_pd(src),_mm_loadu_pd(op)));
+        _mm_storeu_pd(dst+2,_mm_mul_pd(_mm_loadu_pd(src+2),_mm_loadu_pd(op+2)));
+        _mm_storeu_pd(dst+4,_mm_mul_pd(_mm_loadu_pd(src+4),_mm_loadu_pd(op+4)));
+        _mm_storeu_pd(dst+6,_mm_mul_pd(_mm_loadu_pd(src+6),_mm_loadu_pd(op+6)));
+    }
+
+    while(cnt--) *(dst++) = *(src++) * *(op++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_SSE2 void AddSSE2d(double *dst,const double *src,double op,int cnt)
+{
+    const __m128d a = _mm_set1_pd(op);
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,dst += 8) {
+        _mm_storeu_pd(dst,_mm_add_pd(_mm_loadu_pd(src),a));
+        _mm_storeu_pd(dst+2,_mm_add_pd(_mm_loadu_pd(src+2),a));
+        _mm_storeu_pd(dst+4,_mm_add_pd(_mm_loadu_pd(src+4),a));
+        _mm_storeu_pd(dst+6,_mm_add_pd(_mm_loadu_pd(src+6),a));
+    }
+
+    while(cnt--) *(dst++) = *(src++)+op;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_SSE2 void AddSSE2d(double *dst,const double *src,const double *op,int cnt)
+{
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,op += 8,dst += 8) {
+        _mm_storeu_pd(dst,_mm_add_pd(_mm_loadu_pd(src),_mm_loadu_pd(op)));
+        _mm_storeu_pd(dst+2,_mm_add_pd(_mm_loadu_pd(src+2),_mm_loadu_pd(op+2)));
+        _mm_storeu_pd(dst+4,_mm_add_pd(_mm_loadu_pd(src+4),_mm_loadu_pd(op+4)));
+        _mm_storeu_pd(dst+6,_mm_add_pd(_mm_loadu_pd(src+6),_mm_loadu_pd(op+6)));
+    }
+
+    while(cnt--) *(dst++) = *(src++) + *(op++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_SSE2 void ScaleSSE2d(double *dst,const double *src,double opmul,double opadd,int cnt)
+{
+    const __m128d m = _mm_set1_pd(opmul);
+    const __m128d a = _mm_set1_pd(opadd);
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,dst += 8) {
+        _mm_storeu_pd(dst,_mm_add_pd(_mm_mul_pd(_mm_loadu_pd(src),m),a));
+        _mm_storeu_pd(dst+2,_mm_add_pd(_mm_mul_pd(_mm_loadu_pd(src+2),m),a));
+        _mm_storeu_pd(dst+4,_mm_add_pd(_mm_mul_pd(_mm_loadu_pd(src+4),m),a));
+        _mm_storeu_pd(dst+6,_mm_add_pd(_mm_mul_pd(_mm_loadu_pd(src+6),m),a));
+    }
+
+    while(cnt--) *(dst++) = *(src++)*opmul+opadd;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_SSE2 void ScaleSSE2d(double *dst,const double *src,double opmul,const double *opadd,int cnt)
+{
+    const __m128d m = _mm_set1_pd(opmul);
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,opadd += 8,dst += 8) {
+        _mm_storeu_pd(dst,_mm_add_pd(_mm_mul_pd(_mm_loadu_pd(src),m),_mm_loadu_pd(opadd)));
+        _mm_storeu_pd(dst+2,_mm_add_pd(_mm_mul_pd(_mm_loadu_pd(src+2),m),_mm_loadu_pd(opadd+2)));
+        _mm_storeu_pd(dst+4,_mm_add_pd(_mm_mul_pd(_mm_loadu_pd(src+4),m),_mm_loadu_pd(opadd+4)));
+        _mm_storeu_pd(dst+6,_mm_add_pd(_mm_mul_pd(_mm_loadu_pd(src+6),m),_mm_loadu_pd(opadd+6)));
+    }
+
+    while(cnt--) *(dst++) = *(src++)*opmul + *(opadd++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_SSE2 void ScaleSSE2d(double *dst,const double *src,const double *opmul,const double *opadd,int cnt)
+{
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,opmul += 8,opadd += 8,dst += 8) {
+        _mm_storeu_pd(dst,_mm_add_pd(_mm_mul_pd(_mm_loadu_pd(src),_mm_loadu_pd(opmul)),_mm_loadu_pd(opadd)));
+        _mm_storeu_pd(dst+2,_mm_add_pd(_mm_mul_pd(_mm_loadu_pd(src+2),_mm_loadu_pd(opmul+2)),_mm_loadu_pd(opadd+2)));
+        _mm_storeu_pd(dst+4,_mm_add_pd(_mm_mul_pd(_mm_loadu_pd(src+4),_mm_loadu_pd(opmul+4)),_mm_loadu_pd(opadd+4)));
+        _mm_storeu_pd(dst+6,_mm_add_pd(_mm_mul_pd(_mm_loadu_pd(src+6),_mm_loadu_pd(opmul+6)),_mm_loadu_pd(opadd+6)));
+    }
+
+    while(cnt--) *(dst++) = *(src++) * *(opmul++) + *(opadd++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_SSE2 void MacSSE2d(double *dst,const double *src,double op,int cnt)
+{
+    const __m128d a = _mm_set1_pd(op);
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,dst += 8) {
+        _mm_storeu_pd(dst,_mm_add_pd(_mm_loadu_pd(dst),_mm_mul_pd(_mm_loadu_pd(src),a)));
+        _mm_storeu_pd(dst+2,_mm_add_pd(_mm_loadu_pd(dst+2),_mm_mul_pd(_mm_loadu_pd(src+2),a)));
+        _mm_storeu_pd(dst+4,_mm_add_pd(_mm_loadu_pd(dst+4),_mm_mul_pd(_mm_loadu_pd(src+4),a)));
+        _mm_storeu_pd(dst+6,_mm_add_pd(_mm_loadu_pd(dst+6),_mm_mul_pd(_mm_loadu_pd(src+6),a)));
+    }
+
+    while(cnt--) *(dst++) += *(src++)*op;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_SSE2 void MacSSE2d(double *dst,const double *src,const double *op,int cnt)
+{
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,op += 8,dst += 8) {
+        _mm_storeu_pd(dst,_mm_add_pd(_mm_loadu_pd(dst),_mm_mul_pd(_mm_loadu_pd(src),_mm_loadu_pd(op))));
+        _mm_storeu_pd(dst+2,_mm_add_pd(_mm_loadu_pd(dst+2),_mm_mul_pd(_mm_loadu_pd(src+2),_mm_loadu_pd(op+2))));
+        _mm_storeu_pd(dst+4,_mm_add_pd(_mm_loadu_pd(dst+4),_mm_mul_pd(_mm_loadu_pd(src+4),_mm_loadu_pd(op+4))));
+        _mm_storeu_pd(dst+6,_mm_add_pd(_mm_loadu_pd(dst+6),_mm_mul_pd(_mm_loadu_pd(src+6),_mm_loadu_pd(op+6))));
+    }
+
+    while(cnt--) *(dst++) += *(src++) * *(op++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_SSE2 double DotSSE2d(const double *a,const double *b,int cnt)
+{
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    double r = 0;
+    if(n) {
+        __m128d acc0 = _mm_set1_pd(0);
+        __m128d acc1 = _mm_set1_pd(0);
+        __m128d acc2 = _mm_set1_pd(0);
+        __m128d acc3 = _mm_set1_pd(0);
+        for(; n--; a += 8,b += 8) {
+            acc0 = _mm_add_pd(acc0,_mm_mul_pd(_mm_loadu_pd(a),_mm_loadu_pd(b)));
+            acc1 = _mm_add_pd(acc1,_mm_mul_pd(_mm_loadu_pd(a+2),_mm_loadu_pd(b+2)));
+            acc2 = _mm_add_pd(acc2,_mm_mul_pd(_mm_loadu_pd(a+4),_mm_loadu_pd(b+4)));
+            acc3 = _mm_add_pd(acc3,_mm_mul_pd(_mm_loadu_pd(a+6),_mm_loadu_pd(b+6)));
+        }
+
+        double t[2];
+        _mm_storeu_pd(t,_mm_add_pd(_mm_add_pd(_mm_add_pd(acc0,acc1),acc2),acc3));
+        for(int i = 0; i < 2; ++i) r += t[i];
+    }
+
+    while(cnt--) r += *(a++) * *(b++);
+    return r;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_SSE2 void ClipSSE2d(double *dst,const double *src,double lo,double hi,int cnt)
+{
+    const __m128d l = _mm_set1_pd(lo),h = _mm_set1_pd(hi);
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,dst += 8) {
+        _mm_storeu_pd(dst,_mm_min_pd(_mm_max_pd(_mm_loadu_pd(src),l),h));
+        _mm_storeu_pd(dst+2,_mm_min_pd(_mm_max_pd(_mm_loadu_pd(src+2),l),h));
+        _mm_storeu_pd(dst+4,_mm_min_pd(_mm_max_pd(_mm_loadu_pd(src+4),l),h));
+        _mm_storeu_pd(dst+6,_mm_min_pd(_mm_max_pd(_mm_loadu_pd(src+6),l),h));
+    }
+
+    while(cnt--) {
+        const double v = *(src++);
+        *(dst++) = v < lo?lo:(v > hi?hi:v);
+    }
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_SSE2 void MinMaxSSE2d(const double *src,int cnt,double &mn,double &mx)
+{
+    if(cnt <= 0) {
+        mn = mx = 0;
+        return;
+    }
+
+    double l = *src,h = l;
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    if(n) {
+        __m128d vl = _mm_set1_pd(l),vh = vl;
+        for(; n--; src += 8) {
+            const __m128d v0 = _mm_loadu_pd(src);
+            const __m128d v1 = _mm_loadu_pd(src+2);
+            const __m128d v2 = _mm_loadu_pd(src+4);
+            const __m128d v3 = _mm_loadu_pd(src+6);
+            vl = _mm_min_pd(vl,v0); vh = _mm_max_pd(vh,v0);
+            vl = _mm_min_pd(vl,v1); vh = _mm_max_pd(vh,v1);
+            vl = _mm_min_pd(vl,v2); vh = _mm_max_pd(vh,v2);
+            vl = _mm_min_pd(vl,v3); vh = _mm_max_pd(vh,v3);
+        }
+
+        double tl[2],th[2];
+        _mm_storeu_pd(tl,vl);
+        _mm_storeu_pd(th,vh);
+        for(int i = 0; i < 2; ++i) {
+            if(tl[i] < l) l = tl[i];
+            if(th[i] > h) h = th[i];
+        }
+    }
+
+    while(cnt--) {
+        const double v = *(src++);
+        if(v < l) l = v;
+        if(v > h) h = v;
+    }
+    mn = l,mx = h;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_SSE2 void RampMulSSE2d(double *dst,const double *src,double start,double inc,int cnt)
+{
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    if(n) {
+        const __m128d d = _mm_set1_pd(inc*8);
+        __m128d g0 = _mm_add_pd(_mm_set1_pd(start),_mm_mul_pd(_mm_loadu_pd(ramp_lanesd),_mm_set1_pd(inc)));
+        __m128d g1 = _mm_add_pd(g0,_mm_set1_pd(inc*2));
+        __m128d g2 = _mm_add_pd(g1,_mm_set1_pd(inc*2));
+        __m128d g3 = _mm_add_pd(g2,_mm_set1_pd(inc*2));
+        for(int i = n; i--; src += 8,dst += 8) {
+            _mm_storeu_pd(dst,_mm_mul_pd(_mm_loadu_pd(src),g0)); g0 = _mm_add_pd(g0,d);
+            _mm_storeu_pd(dst+2,_mm_mul_pd(_mm_loadu_pd(src+2),g1)); g1 = _mm_add_pd(g1,d);
+            _mm_storeu_pd(dst+4,_mm_mul_pd(_mm_loadu_pd(src+4),g2)); g2 = _mm_add_pd(g2,d);
+            _mm_storeu_pd(dst+6,_mm_mul_pd(_mm_loadu_pd(src+6),g3)); g3 = _mm_add_pd(g3,d);
+        }
+        start += inc*(n*8);
+    }
+
+    for(int i = 0; i < cnt; ++i) dst[i] = src[i]*(start+i*inc);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_SSE2 void RampSSE2d(double *dst,double start,double inc,int cnt)
+{
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    if(n) {
+        const __m128d d = _mm_set1_pd(inc*8);
+        __m128d g0 = _mm_add_pd(_mm_set1_pd(start),_mm_mul_pd(_mm_loadu_pd(ramp_lanesd),_mm_set1_pd(inc)));
+        __m128d g1 = _mm_add_pd(g0,_mm_set1_pd(inc*2));
+        __m128d g2 = _mm_add_pd(g1,_mm_set1_pd(inc*2));
+        __m128d g3 = _mm_add_pd(g2,_mm_set1_pd(inc*2));
+        for(int i = n; i--; dst += 8) {
+            _mm_storeu_pd(dst,g0); g0 = _mm_add_pd(g0,d);
+            _mm_storeu_pd(dst+2,g1); g1 = _mm_add_pd(g1,d);
+            _mm_storeu_pd(dst+4,g2); g2 = _mm_add_pd(g2,d);
+            _mm_storeu_pd(dst+6,g3); g3 = _mm_add_pd(g3,d);
+        }
+        start += inc*(n*8);
+    }
+
+    for(int i = 0; i < cnt; ++i) dst[i] = start+i*inc;
+}
+
+/* Conversion between double and single precision
+   The rounding is the same as with a plain cast
+*/
+
+FLEXT_TEMPLATE FLEXT_TARGET_SSE2 void NarrowSSE2(float *dst,const double *src,int cnt)
+{
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,dst += 8) {
+        _mm_storeu_ps(dst,_mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(src)),_mm_cvtpd_ps(_mm_loadu_pd(src+2))));
+        _mm_storeu_ps(dst+4,_mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(src+4)),_mm_cvtpd_ps(_mm_loadu_pd(src+6))));
+    }
+
+    while(cnt--) *(dst++) = (float)*(src++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_SSE2 void WidenSSE2(double *dst,const float *src,int cnt)
+{
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,dst += 8) {
+        const __m128 a = _mm_loadu_ps(src),b = _mm_loadu_ps(src+4);
+        _mm_storeu_pd(dst,_mm_cvtps_pd(a));
+        _mm_storeu_pd(dst+2,_mm_cvtps_pd(_mm_movehl_ps(a,a)));
+        _mm_storeu_pd(dst+4,_mm_cvtps_pd(b));
+        _mm_storeu_pd(dst+6,_mm_cvtps_pd(_mm_movehl_ps(b,b)));
+    }
+
+    while(cnt--) *(dst++) = *(src++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void NarrowAVX(float *dst,const double *src,int cnt)
+{
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,dst += 8) {
+        _mm_storeu_ps(dst,_mm256_cvtpd_ps(_mm256_loadu_pd(src)));
+        _mm_storeu_ps(dst+4,_mm256_cvtpd_ps(_mm256_loadu_pd(src+4)));
+    }
+
+    while(cnt--) *(dst++) = (float)*(src++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void WidenAVX(double *dst,const float *src,int cnt)
+{
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,dst += 8) {
+        _mm256_storeu_pd(dst,_mm256_cvtps_pd(_mm_loadu_ps(src)));
+        _mm256_storeu_pd(dst+4,_mm256_cvtps_pd(_mm_loadu_ps(src+4)));
+    }
+
+    while(cnt--) *(dst++) = *(src++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void CopyAVXd(double *dst,const double *src,int cnt)
+{
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,dst += 8) {
+        _mm256_storeu_pd(dst,_mm256_loadu_pd(src));
+        _mm256_storeu_pd(dst+4,_mm256_loadu_pd(src+4));
+    }
+
+    while(cnt--) *(dst++) = *(src++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void SetAVXd(double *dst,int cnt,double s)
+{
+    const __m256d a = _mm256_set1_pd(s);
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; dst += 8) {
+        _mm256_storeu_pd(dst,a);
+        _mm256_storeu_pd(dst+4,a);
+    }
+
+    while(cnt--) *(dst++) = s;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void MulAVXd(double *dst,const double *src,double op,int cnt)
+{
+    const __m256d a = _mm256_set1_pd(op);
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,dst += 8) {
+        _mm256_storeu_pd(dst,_mm256_mul_pd(_mm256_loadu_pd(src),a));
+        _mm256_storeu_pd(dst+4,_mm256_mul_pd(_mm256_loadu_pd(src+4),a));
+    }
+
+    while(cnt--) *(dst++) = *(src++)*op;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void MulAVXd(double *dst,const double *src,const double *op,int cnt)
+{
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,op += 8,dst += 8) {
+        _mm256_storeu_pd(dst,_mm256_mul_pd(_mm256_loadu_pd(src),_mm256_loadu_pd(op)));
+        _mm256_storeu_pd(dst+4,_mm256_mul_pd(_mm256_loadu_pd(src+4),_mm256_loadu_pd(op+4)));
+    }
+
+    while(cnt--) *(dst++) = *(src++) * *(op++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void AddAVXd(double *dst,const double *src,double op,int cnt)
+{
+    const __m256d a = _mm256_set1_pd(op);
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,dst += 8) {
+        _mm256_storeu_pd(dst,_mm256_add_pd(_mm256_loadu_pd(src),a));
+        _mm256_storeu_pd(dst+4,_mm256_add_pd(_mm256_loadu_pd(src+4),a));
+    }
+
+    while(cnt--) *(dst++) = *(src++)+op;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void AddAVXd(double *dst,const double *src,const double *op,int cnt)
+{
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,op += 8,dst += 8) {
+        _mm256_storeu_pd(dst,_mm256_add_pd(_mm256_loadu_pd(src),_mm256_loadu_pd(op)));
+        _mm256_storeu_pd(dst+4,_mm256_add_pd(_mm256_loadu_pd(src+4),_mm256_loadu_pd(op+4)));
+    }
+
+    while(cnt--) *(dst++) = *(src++) + *(op++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void ScaleAVXd(double *dst,const double *src,double opmul,double opadd,int cnt)
+{
+    const __m256d m = _mm256_set1_pd(opmul);
+    const __m256d a = _mm256_set1_pd(opadd);
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,dst += 8) {
+        _mm256_storeu_pd(dst,_mm256_add_pd(_mm256_mul_pd(_mm256_loadu_pd(src),m),a));
+        _mm256_storeu_pd(dst+4,_mm256_add_pd(_mm256_mul_pd(_mm256_loadu_pd(src+4),m),a));
+    }
+
+    while(cnt--) *(dst++) = *(src++)*opmul+opadd;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void ScaleAVXd(double *dst,const double *src,double opmul,const double *opadd,int cnt)
+{
+    const __m256d m = _mm256_set1_pd(opmul);
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,opadd += 8,dst += 8) {
+        _mm256_storeu_pd(dst,_mm256_add_pd(_mm256_mul_pd(_mm256_loadu_pd(src),m),_mm256_loadu_pd(opadd)));
+        _mm256_storeu_pd(dst+4,_mm256_add_pd(_mm256_mul_pd(_mm256_loadu_pd(src+4),m),_mm256_loadu_pd(opadd+4)));
+    }
+
+    while(cnt--) *(dst++) = *(src++)*opmul + *(opadd++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void ScaleAVXd(double *dst,const double *src,const double *opmul,const double *opadd,int cnt)
+{
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,opmul += 8,opadd += 8,dst += 8) {
+        _mm256_storeu_pd(dst,_mm256_add_pd(_mm256_mul_pd(_mm256_loadu_pd(src),_mm256_loadu_pd(opmul)),_mm256_loadu_pd(opadd)));
+        _mm256_storeu_pd(dst+4,_mm256_add_pd(_mm256_mul_pd(_mm256_loadu_pd(src+4),_mm256_loadu_pd(opmul+4)),_mm256_loadu_pd(opadd+4)));
+    }
+
+    while(cnt--) *(dst++) = *(src++) * *(opmul++) + *(opadd++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void MacAVXd(double *dst,const double *src,double op,int cnt)
+{
+    const __m256d a = _mm256_set1_pd(op);
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,dst += 8) {
+        _mm256_storeu_pd(dst,_mm256_add_pd(_mm256_loadu_pd(dst),_mm256_mul_pd(_mm256_loadu_pd(src),a)));
+        _mm256_storeu_pd(dst+4,_mm256_add_pd(_mm256_loadu_pd(dst+4),_mm256_mul_pd(_mm256_loadu_pd(src+4),a)));
+    }
+
+    while(cnt--) *(dst++) += *(src++)*op;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void MacAVXd(double *dst,const double *src,const double *op,int cnt)
+{
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,op += 8,dst += 8) {
+        _mm256_storeu_pd(dst,_mm256_add_pd(_mm256_loadu_pd(dst),_mm256_mul_pd(_mm256_loadu_pd(src),_mm256_loadu_pd(op))));
+        _mm256_storeu_pd(dst+4,_mm256_add_pd(_mm256_loadu_pd(dst+4),_mm256_mul_pd(_mm256_loadu_pd(src+4),_mm256_loadu_pd(op+4))));
+    }
+
+    while(cnt--) *(dst++) += *(src++) * *(op++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX double DotAVXd(const double *a,const double *b,int cnt)
+{
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    double r = 0;
+    if(n) {
+        __m256d acc0 = _mm256_set1_pd(0);
+        __m256d acc1 = _mm256_set1_pd(0);
+        for(; n--; a += 8,b += 8) {
+            acc0 = _mm256_add_pd(acc0,_mm256_mul_pd(_mm256_loadu_pd(a),_mm256_loadu_pd(b)));
+            acc1 = _mm256_add_pd(acc1,_mm256_mul_pd(_mm256_loadu_pd(a+4),_mm256_loadu_pd(b+4)));
+        }
+
+        double t[4];
+        _mm256_storeu_pd(t,_mm256_add_pd(acc0,acc1));
+        for(int i = 0; i < 4; ++i) r += t[i];
+    }
+
+    while(cnt--) r += *(a++) * *(b++);
+    return r;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void ClipAVXd(double *dst,const double *src,double lo,double hi,int cnt)
+{
+    const __m256d l = _mm256_set1_pd(lo),h = _mm256_set1_pd(hi);
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,dst += 8) {
+        _mm256_storeu_pd(dst,_mm256_min_pd(_mm256_max_pd(_mm256_loadu_pd(src),l),h));
+        _mm256_storeu_pd(dst+4,_mm256_min_pd(_mm256_max_pd(_mm256_loadu_pd(src+4),l),h));
+    }
+
+    while(cnt--) {
+        const double v = *(src++);
+        *(dst++) = v < lo?lo:(v > hi?hi:v);
+    }
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void MinMaxAVXd(const double *src,int cnt,double &mn,double &mx)
+{
+    if(cnt <= 0) {
+        mn = mx = 0;
+        return;
+    }
+
+    double l = *src,h = l;
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    if(n) {
+        __m256d vl = _mm256_set1_pd(l),vh = vl;
+        for(; n--; src += 8) {
+            const __m256d v0 = _mm256_loadu_pd(src);
+            const __m256d v1 = _mm256_loadu_pd(src+4);
+            vl = _mm256_min_pd(vl,v0); vh = _mm256_max_pd(vh,v0);
+            vl = _mm256_min_pd(vl,v1); vh = _mm256_max_pd(vh,v1);
+        }
+
+        double tl[4],th[4];
+        _mm256_storeu_pd(tl,vl);
+        _mm256_storeu_pd(th,vh);
+        for(int i = 0; i < 4; ++i) {
+            if(tl[i] < l) l = tl[i];
+            if(th[i] > h) h = th[i];
+        }
+    }
+
+    while(cnt--) {
+        const double v = *(src++);
+        if(v < l) l = v;
+        if(v > h) h = v;
+    }
+    mn = l,mx = h;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void RampMulAVXd(double *dst,const double *src,double start,double inc,int cnt)
+{
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    if(n) {
+        const __m256d d = _mm256_set1_pd(inc*8);
+        __m256d g0 = _mm256_add_pd(_mm256_set1_pd(start),_mm256_mul_pd(_mm256_loadu_pd(ramp_lanesd),_mm256_set1_pd(inc)));
+        __m256d g1 = _mm256_add_pd(g0,_mm256_set1_pd(inc*4));
+        for(int i = n; i--; src += 8,dst += 8) {
+            _mm256_storeu_pd(dst,_mm256_mul_pd(_mm256_loadu_pd(src),g0)); g0 = _mm256_add_pd(g0,d);
+            _mm256_storeu_pd(dst+4,_mm256_mul_pd(_mm256_loadu_pd(src+4),g1)); g1 = _mm256_add_pd(g1,d);
+        }
+        start += inc*(n*8);
+    }
+
+    for(int i = 0; i < cnt; ++i) dst[i] = src[i]*(start+i*inc);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX void RampAVXd(double *dst,double start,double inc,int cnt)
+{
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    if(n) {
+        const __m256d d = _mm256_set1_pd(inc*8);
+        __m256d g0 = _mm256_add_pd(_mm256_set1_pd(start),_mm256_mul_pd(_mm256_loadu_pd(ramp_lanesd),_mm256_set1_pd(inc)));
+        __m256d g1 = _mm256_add_pd(g0,_mm256_set1_pd(inc*4));
+        for(int i = n; i--; dst += 8) {
+            _mm256_storeu_pd(dst,g0); g0 = _mm256_add_pd(g0,d);
+            _mm256_storeu_pd(dst+4,g1); g1 = _mm256_add_pd(g1,d);
+        }
+        start += inc*(n*8);
+    }
+
+    for(int i = 0; i < cnt; ++i) dst[i] = start+i*inc;
+}
+
+#if FLEXT_SIMD_AVX512
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void CopyAVX512d(double *dst,const double *src,int cnt)
+{
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,dst += 16) {
+        _mm512_storeu_pd(dst,_mm512_loadu_pd(src));
+        _mm512_storeu_pd(dst+8,_mm512_loadu_pd(src+8));
+    }
+
+    while(cnt--) *(dst++) = *(src++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void SetAVX512d(double *dst,int cnt,double s)
+{
+    const __m512d a = _mm512_set1_pd(s);
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; dst += 16) {
+        _mm512_storeu_pd(dst,a);
+        _mm512_storeu_pd(dst+8,a);
+    }
+
+    while(cnt--) *(dst++) = s;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void MulAVX512d(double *dst,const double *src,double op,int cnt)
+{
+    const __m512d a = _mm512_set1_pd(op);
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,dst += 16) {
+        _mm512_storeu_pd(dst,_mm512_mul_pd(_mm512_loadu_pd(src),a));
+        _mm512_storeu_pd(dst+8,_mm512_mul_pd(_mm512_loadu_pd(src+8),a));
+    }
+
+    while(cnt--) *(dst++) = *(src++)*op;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void MulAVX512d(double *dst,const double *src,const double *op,int cnt)
+{
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,op += 16,dst += 16) {
+        _mm512_storeu_pd(dst,_mm512_mul_pd(_mm512_loadu_pd(src),_mm512_loadu_pd(op)));
+        _mm512_storeu_pd(dst+8,_mm512_mul_pd(_mm512_loadu_pd(src+8),_mm512_loadu_pd(op+8)));
+    }
+
+    while(cnt--) *(dst++) = *(src++) * *(op++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void AddAVX512d(double *dst,const double *src,double op,int cnt)
+{
+    const __m512d a = _mm512_set1_pd(op);
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,dst += 16) {
+        _mm512_storeu_pd(dst,_mm512_add_pd(_mm512_loadu_pd(src),a));
+        _mm512_storeu_pd(dst+8,_mm512_add_pd(_mm512_loadu_pd(src+8),a));
+    }
+
+    while(cnt--) *(dst++) = *(src++)+op;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void AddAVX512d(double *dst,const double *src,const double *op,int cnt)
+{
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,op += 16,dst += 16) {
+        _mm512_storeu_pd(dst,_mm512_add_pd(_mm512_loadu_pd(src),_mm512_loadu_pd(op)));
+        _mm512_storeu_pd(dst+8,_mm512_add_pd(_mm512_loadu_pd(src+8),_mm512_loadu_pd(op+8)));
+    }
+
+    while(cnt--) *(dst++) = *(src++) + *(op++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void ScaleAVX512d(double *dst,const double *src,double opmul,double opadd,int cnt)
+{
+    const __m512d m = _mm512_set1_pd(opmul);
+    const __m512d a = _mm512_set1_pd(opadd);
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,dst += 16) {
+        _mm512_storeu_pd(dst,_mm512_add_pd(_mm512_mul_pd(_mm512_loadu_pd(src),m),a));
+        _mm512_storeu_pd(dst+8,_mm512_add_pd(_mm512_mul_pd(_mm512_loadu_pd(src+8),m),a));
+    }
+
+    while(cnt--) *(dst++) = *(src++)*opmul+opadd;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void ScaleAVX512d(double *dst,const double *src,double opmul,const double *opadd,int cnt)
+{
+    const __m512d m = _mm512_set1_pd(opmul);
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,opadd += 16,dst += 16) {
+        _mm512_storeu_pd(dst,_mm512_add_pd(_mm512_mul_pd(_mm512_loadu_pd(src),m),_mm512_loadu_pd(opadd)));
+        _mm512_storeu_pd(dst+8,_mm512_add_pd(_mm512_mul_pd(_mm512_loadu_pd(src+8),m),_mm512_loadu_pd(opadd+8)));
+    }
+
+    while(cnt--) *(dst++) = *(src++)*opmul + *(opadd++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void ScaleAVX512d(double *dst,const double *src,const double *opmul,const double *opadd,int cnt)
+{
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,opmul += 16,opadd += 16,dst += 16) {
+        _mm512_storeu_pd(dst,_mm512_add_pd(_mm512_mul_pd(_mm512_loadu_pd(src),_mm512_loadu_pd(opmul)),_mm512_loadu_pd(opadd)));
+        _mm512_storeu_pd(dst+8,_mm512_add_pd(_mm512_mul_pd(_mm512_loadu_pd(src+8),_mm512_loadu_pd(opmul+8)),_mm512_loadu_pd(opadd+8)));
+    }
+
+    while(cnt--) *(dst++) = *(src++) * *(opmul++) + *(opadd++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void MacAVX512d(double *dst,const double *src,double op,int cnt)
+{
+    const __m512d a = _mm512_set1_pd(op);
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,dst += 16) {
+        _mm512_storeu_pd(dst,_mm512_add_pd(_mm512_loadu_pd(dst),_mm512_mul_pd(_mm512_loadu_pd(src),a)));
+        _mm512_storeu_pd(dst+8,_mm512_add_pd(_mm512_loadu_pd(dst+8),_mm512_mul_pd(_mm512_loadu_pd(src+8),a)));
+    }
+
+    while(cnt--) *(dst++) += *(src++)*op;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void MacAVX512d(double *dst,const double *src,const double *op,int cnt)
+{
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,op += 16,dst += 16) {
+        _mm512_storeu_pd(dst,_mm512_add_pd(_mm512_loadu_pd(dst),_mm512_mul_pd(_mm512_loadu_pd(src),_mm512_loadu_pd(op))));
+        _mm512_storeu_pd(dst+8,_mm512_add_pd(_mm512_loadu_pd(dst+8),_mm512_mul_pd(_mm512_loadu_pd(src+8),_mm512_loadu_pd(op+8))));
+    }
+
+    while(cnt--) *(dst++) += *(src++) * *(op++);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 double DotAVX512d(const double *a,const double *b,int cnt)
+{
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    double r = 0;
+    if(n) {
+        __m512d acc0 = _mm512_set1_pd(0);
+        __m512d acc1 = _mm512_set1_pd(0);
+        for(; n--; a += 16,b += 16) {
+            acc0 = _mm512_add_pd(acc0,_mm512_mul_pd(_mm512_loadu_pd(a),_mm512_loadu_pd(b)));
+            acc1 = _mm512_add_pd(acc1,_mm512_mul_pd(_mm512_loadu_pd(a+8),_mm512_loadu_pd(b+8)));
+        }
+
+        double t[8];
+        _mm512_storeu_pd(t,_mm512_add_pd(acc0,acc1));
+        for(int i = 0; i < 8; ++i) r += t[i];
+    }
+
+    while(cnt--) r += *(a++) * *(b++);
+    return r;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void ClipAVX512d(double *dst,const double *src,double lo,double hi,int cnt)
+{
+    const __m512d l = _mm512_set1_pd(lo),h = _mm512_set1_pd(hi);
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    for(; n--; src += 16,dst += 16) {
+        _mm512_storeu_pd(dst,_mm512_min_pd(_mm512_max_pd(_mm512_loadu_pd(src),l),h));
+        _mm512_storeu_pd(dst+8,_mm512_min_pd(_mm512_max_pd(_mm512_loadu_pd(src+8),l),h));
+    }
+
+    while(cnt--) {
+        const double v = *(src++);
+        *(dst++) = v < lo?lo:(v > hi?hi:v);
+    }
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void MinMaxAVX512d(const double *src,int cnt,double &mn,double &mx)
+{
+    if(cnt <= 0) {
+        mn = mx = 0;
+        return;
+    }
+
+    double l = *src,h = l;
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    if(n) {
+        __m512d vl = _mm512_set1_pd(l),vh = vl;
+        for(; n--; src += 16) {
+            const __m512d v0 = _mm512_loadu_pd(src);
+            const __m512d v1 = _mm512_loadu_pd(src+8);
+            vl = _mm512_min_pd(vl,v0); vh = _mm512_max_pd(vh,v0);
+            vl = _mm512_min_pd(vl,v1); vh = _mm512_max_pd(vh,v1);
+        }
+
+        double tl[8],th[8];
+        _mm512_storeu_pd(tl,vl);
+        _mm512_storeu_pd(th,vh);
+        for(int i = 0; i < 8; ++i) {
+            if(tl[i] < l) l = tl[i];
+            if(th[i] > h) h = th[i];
+        }
+    }
+
+    while(cnt--) {
+        const double v = *(src++);
+        if(v < l) l = v;
+        if(v > h) h = v;
+    }
+    mn = l,mx = h;
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void RampMulAVX512d(double *dst,const double *src,double start,double inc,int cnt)
+{
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    if(n) {
+        const __m512d d = _mm512_set1_pd(inc*16);
+        __m512d g0 = _mm512_add_pd(_mm512_set1_pd(start),_mm512_mul_pd(_mm512_loadu_pd(ramp_lanesd),_mm512_set1_pd(inc)));
+        __m512d g1 = _mm512_add_pd(g0,_mm512_set1_pd(inc*8));
+        for(int i = n; i--; src += 16,dst += 16) {
+            _mm512_storeu_pd(dst,_mm512_mul_pd(_mm512_loadu_pd(src),g0)); g0 = _mm512_add_pd(g0,d);
+            _mm512_storeu_pd(dst+8,_mm512_mul_pd(_mm512_loadu_pd(src+8),g1)); g1 = _mm512_add_pd(g1,d);
+        }
+        start += inc*(n*16);
+    }
+
+    for(int i = 0; i < cnt; ++i) dst[i] = src[i]*(start+i*inc);
+}
+
+FLEXT_TEMPLATE FLEXT_TARGET_AVX512 void RampAVX512d(double *dst,double start,double inc,int cnt)
+{
+    int n = cnt>>4;
+    cnt -= n<<4;
+
+    if(n) {
+        const __m512d d = _mm512_set1_pd(inc*16);
+        __m512d g0 = _mm512_add_pd(_mm512_set1_pd(start),_mm512_mul_pd(_mm512_loadu_pd(ramp_lanesd),_mm512_set1_pd(inc)));
+        __m512d g1 = _mm512_add_pd(g0,_mm512_set1_pd(inc*8));
+        for(int i = n; i--; dst += 16) {
+            _mm512_storeu_pd(dst,g0); g0 = _mm512_add_pd(g0,d);
+            _mm512_storeu_pd(dst+8,g1); g1 = _mm512_add_pd(g1,d);
+        }
+        start += inc*(n*16);
+    }
+
+    for(int i = 0; i < cnt; ++i) dst[i] = start+i*inc;
+}
+
+#endif // FLEXT_SIMD_AVX512
+#endif // FLEXT_SIMD_AVX
+
+#if FLEXT_SIMD_NEON && FLEXT_CPU == FLEXT_CPU_ARM64
+// NEON double precision is only available on AArch64
+#define FLEXT_SIMD_NEONd 1
+
+FLEXT_TEMPLATE void CopyNEONd(double *dst,const double *src,int cnt)
+{
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,dst += 8) {
+        vst1q_f64(dst,vld1q_f64(src));
+        vst1q_f64(dst+2,vld1q_f64(src+2));
+        vst1q_f64(dst+4,vld1q_f64(src+4));
+        vst1q_f64(dst+6,vld1q_f64(src+6));
+    }
+
+    while(cnt--) *(dst++) = *(src++);
+}
+
+FLEXT_TEMPLATE void SetNEONd(double *dst,int cnt,double s)
+{
+    const float64x2_t a = vdupq_n_f64(s);
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; dst += 8) {
+        vst1q_f64(dst,a);
+        vst1q_f64(dst+2,a);
+        vst1q_f64(dst+4,a);
+        vst1q_f64(dst+6,a);
+    }
+
+    while(cnt--) *(dst++) = s;
+}
+
+FLEXT_TEMPLATE void MulNEONd(double *dst,const double *src,double op,int cnt)
+{
+    const float64x2_t a = vdupq_n_f64(op);
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,dst += 8) {
+        vst1q_f64(dst,vmulq_f64(vld1q_f64(src),a));
+        vst1q_f64(dst+2,vmulq_f64(vld1q_f64(src+2),a));
+        vst1q_f64(dst+4,vmulq_f64(vld1q_f64(src+4),a));
+        vst1q_f64(dst+6,vmulq_f64(vld1q_f64(src+6),a));
+    }
+
+    while(cnt--) *(dst++) = *(src++)*op;
+}
+
+FLEXT_TEMPLATE void MulNEONd(double *dst,const double *src,const double *op,int cnt)
+{
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,op += 8,dst += 8) {
+        vst1q_f64(dst,vmulq_f64(vld1q_f64(src),vld1q_f64(op)));
+        vst1q_f64(dst+2,vmulq_f64(vld1q_f64(src+2),vld1q_f64(op+2)));
+        vst1q_f64(dst+4,vmulq_f64(vld1q_f64(src+4),vld1q_f64(op+4)));
+        vst1q_f64(dst+6,vmulq_f64(vld1q_f64(src+6),vld1q_f64(op+6)));
+    }
+
+    while(cnt--) *(dst++) = *(src++) * *(op++);
+}
 
-/*! \brief Determine SIMD capabilities
-    \internal
-*/
-inline unsigned long setsimdcaps()
+FLEXT_TEMPLATE void AddNEONd(double *dst,const double *src,double op,int cnt)
 {
-    unsigned long simdflags = flext::simd_none;
-#if FLEXT_CPU == FLEXT_CPU_IA32 || FLEXT_CPU == FLEXT_CPU_X86_64
-    _p_info cpuinfo;
-    _cpuid(&cpuinfo);
-    if(cpuinfo.os_support&_CPU_FEATURE_MMX) simdflags += flext::simd_mmx;
-    if(cpuinfo.os_support&_CPU_FEATURE_3DNOW) simdflags += flext::simd_3dnow;
-    if(cpuinfo.os_support&_CPU_FEATURE_SSE) simdflags += flext::simd_sse;
-    if(cpuinfo.os_support&_CPU_FEATURE_SSE2) simdflags += flext::simd_sse2;
-#elif defined(__APPLE__) && defined(__VEC__) 
-    #if FLEXT_OSAPI == FLEXT_OSAPI_MAC_MACH
+    const float64x2_t a = vdupq_n_f64(op);
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,dst += 8) {
+        vst1q_f64(dst,vaddq_f64(vld1q_f64(src),a));
+        vst1q_f64(dst+2,vaddq_f64(vld1q_f64(src+2),a));
+        vst1q_f64(dst+4,vaddq_f64(vld1q_f64(src+4),a));
+        vst1q_f64(dst+6,vaddq_f64(vld1q_f64(src+6),a));
+    }
 
-    int selectors[2] = { CTL_HW, HW_VECTORUNIT }; 
-    int hasVectorUnit = 0; 
-    size_t length = sizeof(hasVectorUnit); 
-    int error = sysctl(selectors, 2, &hasVectorUnit, &length, NULL, 0); 
+    while(cnt--) *(dst++) = *(src++)+op;
+}
 
-    if(!error && hasVectorUnit != 0) simdflags += flext::simd_altivec; 
-        
-    #else
+FLEXT_TEMPLATE void AddNEONd(double *dst,const double *src,const double *op,int cnt)
+{
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,op += 8,dst += 8) {
+        vst1q_f64(dst,vaddq_f64(vld1q_f64(src),vld1q_f64(op)));
+        vst1q_f64(dst+2,vaddq_f64(vld1q_f64(src+2),vld1q_f64(op+2)));
+        vst1q_f64(dst+4,vaddq_f64(vld1q_f64(src+4),vld1q_f64(op+4)));
+        vst1q_f64(dst+6,vaddq_f64(vld1q_f64(src+6),vld1q_f64(op+6)));
+    }
 
-    long cpuAttributes; 
-    Boolean hasAltiVec = false; 
-    OSErr err = Gestalt( gestaltPowerPCProcessorFeatures, &cpuAttributes ); 
+    while(cnt--) *(dst++) = *(src++) + *(op++);
+}
 
-    if( noErr == err ) 
-    if(( 1 << gestaltPowerPCHasVectorInstructions) & cpuAttributes) simdflags += flext::simd_altivec; 
+FLEXT_TEMPLATE void ScaleNEONd(double *dst,const double *src,double opmul,double opadd,int cnt)
+{
+    const float64x2_t m = vdupq_n_f64(opmul);
+    const float64x2_t a = vdupq_n_f64(opadd);
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,dst += 8) {
+        vst1q_f64(dst,vaddq_f64(vmulq_f64(vld1q_f64(src),m),a));
+        vst1q_f64(dst+2,vaddq_f64(vmulq_f64(vld1q_f64(src+2),m),a));
+        vst1q_f64(dst+4,vaddq_f64(vmulq_f64(vld1q_f64(src+4),m),a));
+        vst1q_f64(dst+6,vaddq_f64(vmulq_f64(vld1q_f64(src+6),m),a));
+    }
 
-    #endif
-#endif
-    return simdflags;
+    while(cnt--) *(dst++) = *(src++)*opmul+opadd;
 }
 
+FLEXT_TEMPLATE void ScaleNEONd(double *dst,const double *src,double opmul,const double *opadd,int cnt)
+{
+    const float64x2_t m = vdupq_n_f64(opmul);
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,opadd += 8,dst += 8) {
+        vst1q_f64(dst,vaddq_f64(vmulq_f64(vld1q_f64(src),m),vld1q_f64(opadd)));
+        vst1q_f64(dst+2,vaddq_f64(vmulq_f64(vld1q_f64(src+2),m),vld1q_f64(opadd+2)));
+        vst1q_f64(dst+4,vaddq_f64(vmulq_f64(vld1q_f64(src+4),m),vld1q_f64(opadd+4)));
+        vst1q_f64(dst+6,vaddq_f64(vmulq_f64(vld1q_f64(src+6),m),vld1q_f64(opadd+6)));
+    }
 
-#if (FLEXT_CPU == FLEXT_CPU_PPC || FLEXT_CPU == FLEXT_CPU_PPC64)  && defined(__VEC__)
+    while(cnt--) *(dst++) = *(src++)*opmul + *(opadd++);
+}
 
-/* functions for misaligned vector data - taken from the Altivec tutorial of Ian Ollmann, Ph.D. */
+FLEXT_TEMPLATE void ScaleNEONd(double *dst,const double *src,const double *opmul,const double *opadd,int cnt)
+{
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,opmul += 8,opadd += 8,dst += 8) {
+        vst1q_f64(dst,vaddq_f64(vmulq_f64(vld1q_f64(src),vld1q_f64(opmul)),vld1q_f64(opadd)));
+        vst1q_f64(dst+2,vaddq_f64(vmulq_f64(vld1q_f64(src+2),vld1q_f64(opmul+2)),vld1q_f64(opadd+2)));
+        vst1q_f64(dst+4,vaddq_f64(vmulq_f64(vld1q_f64(src+4),vld1q_f64(opmul+4)),vld1q_f64(opadd+4)));
+        vst1q_f64(dst+6,vaddq_f64(vmulq_f64(vld1q_f64(src+6),vld1q_f64(opmul+6)),vld1q_f64(opadd+6)));
+    }
 
-//! Load a vector from an unaligned location in memory
-inline vector unsigned char LoadUnaligned( vector unsigned char *v )
+    while(cnt--) *(dst++) = *(src++) * *(opmul++) + *(opadd++);
+}
+
+FLEXT_TEMPLATE void MacNEONd(double *dst,const double *src,double op,int cnt)
 {
-    vector unsigned char permuteVector = vec_lvsl( 0, (int*) v );
-    vector unsigned char low = vec_ld( 0, v );
-    vector unsigned char high = vec_ld( 15, v );
-    return vec_perm( low, high, permuteVector );
+    const float64x2_t a = vdupq_n_f64(op);
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,dst += 8) {
+        vst1q_f64(dst,vaddq_f64(vld1q_f64(dst),vmulq_f64(vld1q_f64(src),a)));
+        vst1q_f64(dst+2,vaddq_f64(vld1q_f64(dst+2),vmulq_f64(vld1q_f64(src+2),a)));
+        vst1q_f64(dst+4,vaddq_f64(vld1q_f64(dst+4),vmulq_f64(vld1q_f64(src+4),a)));
+        vst1q_f64(dst+6,vaddq_f64(vld1q_f64(dst+6),vmulq_f64(vld1q_f64(src+6),a)));
+    }
+
+    while(cnt--) *(dst++) += *(src++)*op;
 }
 
-/*
-//! Store a vector to an unaligned location in memory
-inline void StoreUnaligned( vector unsigned char v, vector unsigned char *where)
+FLEXT_TEMPLATE void MacNEONd(double *dst,const double *src,const double *op,int cnt)
 {
-    // Load the surrounding area
-    vector unsigned char low = vec_ld( 0, where );
-    vector unsigned char high = vec_ld( 16, where );
-    // Prepare the constants that we need
-    vector unsigned char permuteVector = vec_lvsr( 0, (int*) where );
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,op += 8,dst += 8) {
+        vst1q_f64(dst,vaddq_f64(vld1q_f64(dst),vmulq_f64(vld1q_f64(src),vld1q_f64(op))));
+        vst1q_f64(dst+2,vaddq_f64(vld1q_f64(dst+2),vmulq_f64(vld1q_f64(src+2),vld1q_f64(op+2))));
+        vst1q_f64(dst+4,vaddq_f64(vld1q_f64(dst+4),vmulq_f64(vld1q_f64(src+4),vld1q_f64(op+4))));
+        vst1q_f64(dst+6,vaddq_f64(vld1q_f64(dst+6),vmulq_f64(vld1q_f64(src+6),vld1q_f64(op+6))));
+    }
 
-    vector unsigned char oxFF = (vector unsigned char)vec_splat_s8( -1 );
-    vector unsigned char ox00 = (vector unsigned char)vec_splat_s8( 0 );
-    // Make a mask for which parts of the vectors to swap out
-    vector unsigned char mask = vec_perm( ox00, oxFF, permuteVector );
-    // Right rotate our input data
-    v = vec_perm( v, v, permuteVector );
-    // Insert our data into the low and high vectors
-    low = vec_sel( v, low, mask );
-    high = vec_sel( high, v, mask );
-    // Store the two aligned result vectors
-    vec_st( low, 0, where );
-    vec_st( high, 16, where );
+    while(cnt--) *(dst++) += *(src++) * *(op++);
 }
-*/
 
-inline vector float LoadUnaligned(const float *v )
+FLEXT_TEMPLATE double DotNEONd(const double *a,const double *b,int cnt)
 {
-    return (vector float)LoadUnaligned((vector unsigned char *)v);
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    double r = 0;
+    if(n) {
+        float64x2_t acc0 = vdupq_n_f64(0);
+        float64x2_t acc1 = vdupq_n_f64(0);
+        float64x2_t acc2 = vdupq_n_f64(0);
+        float64x2_t acc3 = vdupq_n_f64(0);
+        for(; n--; a += 8,b += 8) {
+            acc0 = vaddq_f64(acc0,vmulq_f64(vld1q_f64(a),vld1q_f64(b)));
+            acc1 = vaddq_f64(acc1,vmulq_f64(vld1q_f64(a+2),vld1q_f64(b+2)));
+            acc2 = vaddq_f64(acc2,vmulq_f64(vld1q_f64(a+4),vld1q_f64(b+4)));
+            acc3 = vaddq_f64(acc3,vmulq_f64(vld1q_f64(a+6),vld1q_f64(b+6)));
+        }
+
+        double t[2];
+        vst1q_f64(t,vaddq_f64(vaddq_f64(vaddq_f64(acc0,acc1),acc2),acc3));
+        for(int i = 0; i < 2; ++i) r += t[i];
+    }
+
+    while(cnt--) r += *(a++) * *(b++);
+    return r;
 }
 
-/*
-inline void StoreUnaligned( vector float v,float *where)
+FLEXT_TEMPLATE void ClipNEONd(double *dst,const double *src,double lo,double hi,int cnt)
 {
-    return StoreUnaligned((vector unsigned char)v,(vector unsigned char *)where);
+    const float64x2_t l = vdupq_n_f64(lo),h = vdupq_n_f64(hi);
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,dst += 8) {
+        vst1q_f64(dst,vminq_f64(vmaxq_f64(vld1q_f64(src),l),h));
+        vst1q_f64(dst+2,vminq_f64(vmaxq_f64(vld1q_f64(src+2),l),h));
+        vst1q_f64(dst+4,vminq_f64(vmaxq_f64(vld1q_f64(src+4),l),h));
+        vst1q_f64(dst+6,vminq_f64(vmaxq_f64(vld1q_f64(src+6),l),h));
+    }
+
+    while(cnt--) {
+        const double v = *(src++);
+        *(dst++) = v < lo?lo:(v > hi?hi:v);
+    }
 }
-*/
 
-inline bool IsVectorAligned(const void *where) 
+FLEXT_TEMPLATE void MinMaxNEONd(const double *src,int cnt,double &mn,double &mx)
 {
-    return (reinterpret_cast<size_t>(where)&(sizeof(vector float)-1)) == 0; 
+    if(cnt <= 0) {
+        mn = mx = 0;
+        return;
+    }
+
+    double l = *src,h = l;
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    if(n) {
+        float64x2_t vl = vdupq_n_f64(l),vh = vl;
+        for(; n--; src += 8) {
+            const float64x2_t v0 = vld1q_f64(src);
+            const float64x2_t v1 = vld1q_f64(src+2);
+            const float64x2_t v2 = vld1q_f64(src+4);
+            const float64x2_t v3 = vld1q_f64(src+6);
+            vl = vminq_f64(vl,v0); vh = vmaxq_f64(vh,v0);
+            vl = vminq_f64(vl,v1); vh = vmaxq_f64(vh,v1);
+            vl = vminq_f64(vl,v2); vh = vmaxq_f64(vh,v2);
+            vl = vminq_f64(vl,v3); vh = vmaxq_f64(vh,v3);
+        }
+
+        double tl[2],th[2];
+        vst1q_f64(tl,vl);
+        vst1q_f64(th,vh);
+        for(int i = 0; i < 2; ++i) {
+            if(tl[i] < l) l = tl[i];
+            if(th[i] > h) h = th[i];
+        }
+    }
+
+    while(cnt--) {
+        const double v = *(src++);
+        if(v < l) l = v;
+        if(v > h) h = v;
+    }
+    mn = l,mx = h;
 }
 
-inline bool VectorsAligned(const void *v1,const void *v2) 
+FLEXT_TEMPLATE void RampMulNEONd(double *dst,const double *src,double start,double inc,int cnt)
 {
-    return (
-        (reinterpret_cast<size_t>(v1)|reinterpret_cast<size_t>(v2))
-        &(sizeof(vector float)-1)
-    ) == 0; 
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    if(n) {
+        const float64x2_t d = vdupq_n_f64(inc*8);
+        float64x2_t g0 = vaddq_f64(vdupq_n_f64(start),vmulq_f64(vld1q_f64(ramp_lanesd),vdupq_n_f64(inc)));
+        float64x2_t g1 = vaddq_f64(g0,vdupq_n_f64(inc*2));
+        float64x2_t g2 = vaddq_f64(g1,vdupq_n_f64(inc*2));
+        float64x2_t g3 = vaddq_f64(g2,vdupq_n_f64(inc*2));
+        for(int i = n; i--; src += 8,dst += 8) {
+            vst1q_f64(dst,vmulq_f64(vld1q_f64(src),g0)); g0 = vaddq_f64(g0,d);
+            vst1q_f64(dst+2,vmulq_f64(vld1q_f64(src+2),g1)); g1 = vaddq_f64(g1,d);
+            vst1q_f64(dst+4,vmulq_f64(vld1q_f64(src+4),g2)); g2 = vaddq_f64(g2,d);
+            vst1q_f64(dst+6,vmulq_f64(vld1q_f64(src+6),g3)); g3 = vaddq_f64(g3,d);
+        }
+        start += inc*(n*8);
+    }
+
+    for(int i = 0; i < cnt; ++i) dst[i] = src[i]*(start+i*inc);
 }
 
-inline bool VectorsAligned(const void *v1,const void *v2,const void *v3) 
+FLEXT_TEMPLATE void RampNEONd(double *dst,double start,double inc,int cnt)
 {
-    return (
-        (reinterpret_cast<size_t>(v1)|reinterpret_cast<size_t>(v2)|reinterpret_cast<size_t>(v3))
-        &(sizeof(vector float)-1)
-    ) == 0; 
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    if(n) {
+        const float64x2_t d = vdupq_n_f64(inc*8);
+        float64x2_t g0 = vaddq_f64(vdupq_n_f64(start),vmulq_f64(vld1q_f64(ramp_lanesd),vdupq_n_f64(inc)));
+        float64x2_t g1 = vaddq_f64(g0,vdupq_n_f64(inc*2));
+        float64x2_t g2 = vaddq_f64(g1,vdupq_n_f64(inc*2));
+        float64x2_t g3 = vaddq_f64(g2,vdupq_n_f64(inc*2));
+        for(int i = n; i--; dst += 8) {
+            vst1q_f64(dst,g0); g0 = vaddq_f64(g0,d);
+            vst1q_f64(dst+2,g1); g1 = vaddq_f64(g1,d);
+            vst1q_f64(dst+4,g2); g2 = vaddq_f64(g2,d);
+            vst1q_f64(dst+6,g3); g3 = vaddq_f64(g3,d);
+        }
+        start += inc*(n*8);
+    }
+
+    for(int i = 0; i < cnt; ++i) dst[i] = start+i*inc;
 }
 
-inline bool VectorsAligned(const void *v1,const void *v2,const void *v3,const void *v4)
+FLEXT_TEMPLATE void NarrowNEON(float *dst,const double *src,int cnt)
 {
-    return (
-        (reinterpret_cast<size_t>(v1)|reinterpret_cast<size_t>(v2)|reinterpret_cast<size_t>(v3)|reinterpret_cast<size_t>(v4))
-        &(sizeof(vector float)-1)
-    ) == 0; 
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,dst += 8) {
+        vst1q_f32(dst,vcvt_high_f32_f64(vcvt_f32_f64(vld1q_f64(src)),vld1q_f64(src+2)));
+        vst1q_f32(dst+4,vcvt_high_f32_f64(vcvt_f32_f64(vld1q_f64(src+4)),vld1q_f64(src+6)));
+    }
+
+    while(cnt--) *(dst++) = (float)*(src++);
 }
 
-inline vector float LoadValue(const float &f)
+FLEXT_TEMPLATE void WidenNEON(double *dst,const float *src,int cnt)
 {
-    return vec_splat(IsVectorAligned(&f)?vec_ld(0,(vector float *)&f):LoadUnaligned(&f),0);
+    int n = cnt>>3;
+    cnt -= n<<3;
+
+    for(; n--; src += 8,dst += 8) {
+        const float32x4_t a = vld1q_f32(src),b = vld1q_f32(src+4);
+        vst1q_f64(dst,vcvt_f64_f32(vget_low_f32(a)));
+        vst1q_f64(dst+2,vcvt_high_f64_f32(a));
+        vst1q_f64(dst+4,vcvt_f64_f32(vget_low_f32(b)));
+        vst1q_f64(dst+6,vcvt_high_f64_f32(b));
+    }
+
+    while(cnt--) *(dst++) = *(src++);
 }
-#endif
 
+#endif // FLEXT_SIMD_NEONd
 
 #else // FLEXT_USE_SIMD
 inline unsigned long setsimdcaps() { return 0; }
 #endif // FLEXT_USE_SIMD
 
+#if defined(FLEXT_USE_SIMD) && (FLEXT_SIMD_AVX || FLEXT_SIMD_NEON)
+//! Convert a kernel to the t_sample signature (only used if the sample types match)
+template<typename F,typename T> inline void kernel_set(T &dst,F f) { dst = reinterpret_cast<T>(f); }
+
+#define FLEXT_SIMD_SETKERNELS(k,sfx,T) { \
+    kernel_set<void (*)(T *,const T *,int)>(k.copy,&FLEXT_TEMPINST(Copy##sfx)); \
+    kernel_set<void (*)(T *,int,T)>(k.set,&FLEXT_TEMPINST(Set##sfx)); \
+    kernel_set<void (*)(T *,const T *,T,int)>(k.mul,&FLEXT_TEMPINST(Mul##sfx)); \
+    kernel_set<void (*)(T *,const T *,const T *,int)>(k.mulv,&FLEXT_TEMPINST(Mul##sfx)); \
+    kernel_set<void (*)(T *,const T *,T,int)>(k.add,&FLEXT_TEMPINST(Add##sfx)); \
+    kernel_set<void (*)(T *,const T *,const T *,int)>(k.addv,&FLEXT_TEMPINST(Add##sfx)); \
+    kernel_set<void (*)(T *,const T *,T,T,int)>(k.scale,&FLEXT_TEMPINST(Scale##sfx)); \
+    kernel_set<void (*)(T *,const T *,T,const T *,int)>(k.scalev,&FLEXT_TEMPINST(Scale##sfx)); \
+    kernel_set<void (*)(T *,const T *,const T *,const T *,int)>(k.scalevv,&FLEXT_TEMPINST(Scale##sfx)); \
+    kernel_set<void (*)(T *,const T *,T,int)>(k.mac,&FLEXT_TEMPINST(Mac##sfx)); \
+    kernel_set<void (*)(T *,const T *,const T *,int)>(k.macv,&FLEXT_TEMPINST(Mac##sfx)); \
+    kernel_set<T (*)(const T *,const T *,int)>(k.dot,&FLEXT_TEMPINST(Dot##sfx)); \
+    kernel_set<void (*)(T *,const T *,T,T,int)>(k.clip,&FLEXT_TEMPINST(Clip##sfx)); \
+    kernel_set<void (*)(const T *,int,T &,T &)>(k.minmax,&FLEXT_TEMPINST(MinMax##sfx)); \
+    kernel_set<void (*)(T *,const T *,T,T,int)>(k.rampmul,&FLEXT_TEMPINST(RampMul##sfx)); \
+    kernel_set<void (*)(T *,T,T,int)>(k.ramp,&FLEXT_TEMPINST(Ramp##sfx)); \
+}
+#endif
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::SetSIMDKernels(const simd_kernels *k)
+{
+    if(k) {
+        kernels = *k;
+        return;
+    }
+
+    simd_kernels d;
+    d.copy = &CopySamplesGeneric;
+    d.set = &SetSamplesGeneric;
+    d.mul = &MulSamplesGeneric;
+    d.mulv = &MulSamplesGeneric;
+    d.add = &AddSamplesGeneric;
+    d.addv = &AddSamplesGeneric;
+    d.scale = &ScaleSamplesGeneric;
+    d.scalev = &ScaleSamplesGeneric;
+    d.scalevv = &ScaleSamplesGeneric;
+    d.mac = &MacSamplesGeneric;
+    d.macv = &MacSamplesGeneric;
+    d.dot = &DotSamplesGeneric;
+    d.clip = &ClipSamplesGeneric;
+    d.minmax = &MinMaxSamplesGeneric;
+    d.rampmul = &RampMulSamplesGeneric;
+    d.ramp = &RampSamplesGeneric;
+    d.deinterleave = &DeinterleaveSamplesGeneric;
+    d.interleave = &InterleaveSamplesGeneric;
+    d.narrow = &NarrowSamplesGeneric;
+    d.widen = &WidenSamplesGeneric;
+
+    // IPP does its own dispatching
+#if defined(FLEXT_USE_SIMD) && !defined(FLEXT_USE_IPP)
+    if(sizeof(t_sample) == 4) {
+#if FLEXT_SIMD_AVX512
+        if(simdcaps&simd_avx512)
+            FLEXT_SIMD_SETKERNELS(d,AVX512,float)
+        else
+#endif
+#if FLEXT_SIMD_AVX
+        if(simdcaps&simd_avx)
+            FLEXT_SIMD_SETKERNELS(d,AVX,float)
+#elif FLEXT_SIMD_NEON
+        FLEXT_SIMD_SETKERNELS(d,NEON,float)
+#endif
+        ;
+
+        // the shuffles don't gain from wider vectors
+#if FLEXT_SIMD_AVX
+        if(simdcaps&simd_avx) {
+            kernel_set<void (*)(float *,const float *,int,int,int)>(d.deinterleave,&FLEXT_TEMPINST(DeinterleaveAVX));
+            kernel_set<void (*)(float *,const float *,int,int,int)>(d.interleave,&FLEXT_TEMPINST(InterleaveAVX));
+        }
+#elif FLEXT_SIMD_NEON
+        kernel_set<void (*)(float *,const float *,int,int,int)>(d.deinterleave,&FLEXT_TEMPINST(DeinterleaveNEON));
+        kernel_set<void (*)(float *,const float *,int,int,int)>(d.interleave,&FLEXT_TEMPINST(InterleaveNEON));
+#endif
+    }
+    else if(sizeof(t_sample) == 8) {
+#if FLEXT_SIMD_AVX512
+        if(simdcaps&simd_avx512)
+            FLEXT_SIMD_SETKERNELS(d,AVX512d,double)
+        else
+#endif
+#if FLEXT_SIMD_AVX
+        if(simdcaps&simd_avx)
+            FLEXT_SIMD_SETKERNELS(d,AVXd,double)
+        else if(simdcaps&simd_sse2)
+            FLEXT_SIMD_SETKERNELS(d,SSE2d,double)
+#elif FLEXT_SIMD_NEONd
+        FLEXT_SIMD_SETKERNELS(d,NEONd,double)
+#endif
+        ;
+    }
+
+    // the conversions don't depend on the sample type
+#if FLEXT_SIMD_AVX
+    if(simdcaps&simd_avx) {
+        d.narrow = &FLEXT_TEMPINST(NarrowAVX);
+        d.widen = &FLEXT_TEMPINST(WidenAVX);
+    }
+    else if(simdcaps&simd_sse2) {
+        d.narrow = &FLEXT_TEMPINST(NarrowSSE2);
+        d.widen = &FLEXT_TEMPINST(WidenSSE2);
+    }
+#elif FLEXT_SIMD_NEONd
+    d.narrow = &FLEXT_TEMPINST(NarrowNEON);
+    d.widen = &FLEXT_TEMPINST(WidenNEON);
+#endif
+#endif
+
+    kernels = d;
+}
+
 
-FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::CopySamples(t_sample *dst,const t_sample *src,int cnt)
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::CopySamplesGeneric(t_sample *dst,const t_sample *src,int cnt)
 {
 #ifdef FLEXT_USE_IPP
     if(sizeof(t_sample) == 4)
@@ -743,7 +3204,7 @@ FLEXT_TEMPLATE void ScaleAltivec(t_sample *dst,const t_sample *src,const t_sampl
 }
 #endif
 
-FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::SetSamples(t_sample *dst,int cnt,t_sample s)
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::SetSamplesGeneric(t_sample *dst,int cnt,t_sample s)
 {
 #ifdef FLEXT_USE_IPP
     if(sizeof(t_sample) == 4)
@@ -823,7 +3284,7 @@ zero:
 }
 
 
-FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::MulSamples(t_sample *dst,const t_sample *src,t_sample op,int cnt)
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::MulSamplesGeneric(t_sample *dst,const t_sample *src,t_sample op,int cnt)
 {
 #ifdef FLEXT_USE_IPP
     if(sizeof(t_sample) == 4) {
@@ -960,14 +3421,14 @@ zero:
 }
 
 
-FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::MulSamples(t_sample *dst,const t_sample *src,const t_sample *op,int cnt)
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::MulSamplesGeneric(t_sample *dst,const t_sample *src,const t_sample *op,int cnt)
 {
 #ifdef FLEXT_USE_IPP
     if(sizeof(t_sample) == 4) {
         ippsMul_32f((const float *)src,(const float *)op,(float *)dst,cnt); 
     }
     else if(sizeof(t_sample) == 8) {
-        ippsMul_32f((const double *)src,(const double *)op,(double *)dst,cnt); 
+        ippsMul_64f((const double *)src,(const double *)op,(double *)dst,cnt); 
     }
     else
         ERRINTERNAL();
@@ -1191,14 +3652,14 @@ zero:
 }
 
 
-FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::AddSamples(t_sample *dst,const t_sample *src,t_sample op,int cnt)
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::AddSamplesGeneric(t_sample *dst,const t_sample *src,t_sample op,int cnt)
 {
 #ifdef FLEXT_USE_IPP
     if(sizeof(t_sample) == 4) {
         ippsAddC_32f((const float *)src,(float)op,(float *)dst,cnt); 
     }
     else if(sizeof(t_sample) == 8) {
-        ippsAddC_64f_I((const double *)src,(double)op,(double *)dst,cnt); 
+        ippsAddC_64f((const double *)src,(double)op,(double *)dst,cnt); 
     }
     else
         ERRINTERNAL();
@@ -1320,7 +3781,7 @@ zero:
 }
 
 
-FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::AddSamples(t_sample *dst,const t_sample *src,const t_sample *op,int cnt)
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::AddSamplesGeneric(t_sample *dst,const t_sample *src,const t_sample *op,int cnt)
 {
 #ifdef FLEXT_USE_IPP
     if(sizeof(t_sample) == 4) {
@@ -1552,7 +4013,7 @@ zero:
 }
 
 
-FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::ScaleSamples(t_sample *dst,const t_sample *src,t_sample opmul,t_sample opadd,int cnt)
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::ScaleSamplesGeneric(t_sample *dst,const t_sample *src,t_sample opmul,t_sample opadd,int cnt)
 {
 #ifdef FLEXT_USE_IPP
     if(sizeof(t_sample) == 4) {
@@ -1682,16 +4143,16 @@ zero:
 #endif
 }
 
-FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::ScaleSamples(t_sample *dst,const t_sample *src,t_sample opmul,const t_sample *opadd,int cnt)
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::ScaleSamplesGeneric(t_sample *dst,const t_sample *src,t_sample opmul,const t_sample *opadd,int cnt)
 {
 #ifdef FLEXT_USE_IPP
     if(sizeof(t_sample) == 4) {
         ippsMulC_32f((const float *)src,(float)opmul,(float *)dst,cnt); 
-        ippsAdd_32f_I((float *)opadd,(float *)dst,cnt); 
+        ippsAdd_32f_I((const float *)opadd,(float *)dst,cnt); 
     }
     else if(sizeof(t_sample) == 8) {
         ippsMulC_64f((const double *)src,(double)opmul,(double *)dst,cnt); 
-        ippsAdd_64f_I((double *)opadd,(double *)dst,cnt); 
+        ippsAdd_64f_I((const double *)opadd,(double *)dst,cnt); 
     }
     else
         ERRINTERNAL();
@@ -1838,7 +4299,7 @@ zero:
 #endif
 }
 
-FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::ScaleSamples(t_sample *dst,const t_sample *src,const t_sample *opmul,const t_sample *opadd,int cnt)
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::ScaleSamplesGeneric(t_sample *dst,const t_sample *src,const t_sample *opmul,const t_sample *opadd,int cnt)
 {
 #ifdef FLEXT_USE_IPP
     if(sizeof(t_sample) == 4) {
@@ -2006,6 +4467,189 @@ zero:
 #endif
 }
 
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::MacSamplesGeneric(t_sample *dst,const t_sample *src,t_sample op,int cnt)
+{
+#ifdef FLEXT_USE_IPP
+    if(sizeof(t_sample) == 4)
+        ippsAddProductC_32f((const float *)src,(float)op,(float *)dst,cnt); 
+    else
+#endif
+    {
+        int n = cnt>>3;
+        cnt -= n<<3;
+        while(n--) {
+            dst[0] += src[0]*op; dst[1] += src[1]*op; dst[2] += src[2]*op; dst[3] += src[3]*op;
+            dst[4] += src[4]*op; dst[5] += src[5]*op; dst[6] += src[6]*op; dst[7] += src[7]*op;
+            src += 8,dst += 8;
+        }
+        while(cnt--) *(dst++) += *(src++)*op; 
+    }
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::MacSamplesGeneric(t_sample *dst,const t_sample *src,const t_sample *op,int cnt)
+{
+#ifdef FLEXT_USE_IPP
+    if(sizeof(t_sample) == 4)
+        ippsAddProduct_32f((const float *)src,(const float *)op,(float *)dst,cnt); 
+    else if(sizeof(t_sample) == 8)
+        ippsAddProduct_64f((const double *)src,(const double *)op,(double *)dst,cnt); 
+    else
+        ERRINTERNAL();
+#else
+    int n = cnt>>3;
+    cnt -= n<<3;
+    while(n--) {
+        dst[0] += src[0]*op[0]; dst[1] += src[1]*op[1]; 
+        dst[2] += src[2]*op[2]; dst[3] += src[3]*op[3]; 
+        dst[4] += src[4]*op[4]; dst[5] += src[5]*op[5]; 
+        dst[6] += src[6]*op[6]; dst[7] += src[7]*op[7]; 
+        src += 8,dst += 8,op += 8;
+    }
+    while(cnt--) *(dst++) += *(src++) * *(op++); 
+#endif
+}
+
+FLEXT_TEMPIMPL(t_sample FLEXT_CLASSDEF(flext))::DotSamplesGeneric(const t_sample *a,const t_sample *b,int cnt)
+{
+#ifdef FLEXT_USE_IPP
+    if(sizeof(t_sample) == 4) {
+        Ipp32f r;
+        ippsDotProd_32f((const float *)a,(const float *)b,cnt,&r); 
+        return r;
+    }
+    else if(sizeof(t_sample) == 8) {
+        Ipp64f r;
+        ippsDotProd_64f((const double *)a,(const double *)b,cnt,&r); 
+        return (t_sample)r;
+    }
+    else {
+        ERRINTERNAL();
+        return 0;
+    }
+#else
+    // four partial sums, which can be pipelined
+    t_sample r0 = 0,r1 = 0,r2 = 0,r3 = 0;
+    int n = cnt>>2;
+    cnt -= n<<2;
+    while(n--) {
+        r0 += a[0]*b[0]; r1 += a[1]*b[1]; r2 += a[2]*b[2]; r3 += a[3]*b[3];
+        a += 4,b += 4;
+    }
+    while(cnt--) r0 += *(a++) * *(b++);
+    return (r0+r1)+(r2+r3);
+#endif
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::ClipSamplesGeneric(t_sample *dst,const t_sample *src,t_sample lo,t_sample hi,int cnt)
+{
+#ifdef FLEXT_USE_IPP
+    if(sizeof(t_sample) == 4)
+        ippsThreshold_LTValGTVal_32f((const float *)src,(float *)dst,cnt,(float)lo,(float)lo,(float)hi,(float)hi); 
+    else if(sizeof(t_sample) == 8)
+        ippsThreshold_LTValGTVal_64f((const double *)src,(double *)dst,cnt,(double)lo,(double)lo,(double)hi,(double)hi); 
+    else
+        ERRINTERNAL();
+#else
+    while(cnt--) {
+        const t_sample v = *(src++);
+        *(dst++) = v < lo?lo:(v > hi?hi:v);
+    }
+#endif
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::MinMaxSamplesGeneric(const t_sample *src,int cnt,t_sample &mn,t_sample &mx)
+{
+    if(cnt <= 0) {
+        mn = mx = 0;
+        return;
+    }
+
+#ifdef FLEXT_USE_IPP
+    if(sizeof(t_sample) == 4)
+        ippsMinMax_32f((const float *)src,cnt,(float *)&mn,(float *)&mx); 
+    else if(sizeof(t_sample) == 8)
+        ippsMinMax_64f((const double *)src,cnt,(double *)&mn,(double *)&mx); 
+    else
+        ERRINTERNAL();
+#else
+    t_sample l = *(src++),h = l;
+    while(--cnt) {
+        const t_sample v = *(src++);
+        if(v < l) l = v;
+        else if(v > h) h = v;
+    }
+    mn = l,mx = h;
+#endif
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::RampMulSamplesGeneric(t_sample *dst,const t_sample *src,t_sample start,t_sample inc,int cnt)
+{
+    for(int i = 0; i < cnt; ++i) dst[i] = src[i]*(start+i*inc);
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::RampSamplesGeneric(t_sample *dst,t_sample start,t_sample inc,int cnt)
+{
+#ifdef FLEXT_USE_IPP
+    if(sizeof(t_sample) == 4)
+        ippsVectorSlope_32f((float *)dst,cnt,start,inc);
+    else if(sizeof(t_sample) == 8)
+        ippsVectorSlope_64f((double *)dst,cnt,start,inc);
+    else
+        ERRINTERNAL();
+#else
+    for(int i = 0; i < cnt; ++i) dst[i] = start+i*inc;
+#endif
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::DeinterleaveSamplesGeneric(t_sample *dst,const t_sample *src,int ch,int chns,int cnt)
+{
+    for(src += ch; cnt--; src += chns) *(dst++) = *src;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::InterleaveSamplesGeneric(t_sample *dst,const t_sample *src,int ch,int chns,int cnt)
+{
+    for(dst += ch; cnt--; dst += chns) *dst = *(src++);
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::NarrowSamplesGeneric(float *dst,const double *src,int cnt)
+{
+#ifdef FLEXT_USE_IPP
+    ippsConvert_64f32f(src,dst,cnt);
+#else
+    while(cnt--) *(dst++) = (float)*(src++);
+#endif
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::WidenSamplesGeneric(double *dst,const float *src,int cnt)
+{
+#ifdef FLEXT_USE_IPP
+    ippsConvert_32f64f(src,dst,cnt);
+#else
+    while(cnt--) *(dst++) = *(src++);
+#endif
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::InterpReadSamples(t_sample *dst,const t_sample *table,int frames,const t_sample *pos,int cnt)
+{
+    if(UNLIKELY(frames <= 0)) {
+        ZeroSamples(dst,cnt);
+        return;
+    }
+
+    const t_sample last = (t_sample)(frames-1);
+    while(cnt--) {
+        t_sample p = *(pos++);
+        if(UNLIKELY(!(p > 0))) p = 0; // also catches NaN
+        else if(UNLIKELY(p > last)) p = last;
+
+        const int i = (int)p;
+        const t_sample a = table[i];
+        // the last frame has no successor
+        const t_sample b = LIKELY(i < frames-1)?table[i+1]:a;
+        *(dst++) = a+(p-i)*(b-a);
+    }
+}
+
 #include "flpopns.h"
 
 #endif // __FLEXT_SIMD_CPP
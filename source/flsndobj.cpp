@@ -17,6 +17,7 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 flext_sndobj::flext_sndobj():
     inobjs(0),outobjs(0),
     inobj(NULL),tmpobj(NULL),outobj(NULL),
+    objs(false),
     smprt(0),blsz(0)
 {}
 
@@ -37,6 +38,7 @@ void flext_sndobj::Exit()
 void flext_sndobj::ClearObjs()
 {
     FreeObjs();
+    objs = false;
 
     if(inobj) {
         for(int i = 0; i < inobjs; ++i) delete inobj[i]; 
@@ -58,28 +60,43 @@ bool flext_sndobj::CbDsp()
     
     int i;
     if(Blocksize() != blsz || Samplerate() != smprt) {
-        // block size or sample rate has changed... rebuild all objects
-
-        ClearObjs();
+        // block size or sample rate has changed
 
         blsz = Blocksize();
         smprt = Samplerate();
 
-        // set up sndobjs for inlets and outlets
+        // set up sndobjs for inlets and outlets only once, the signal layout doesn't change
         if(inobjs) {
-            inobj = new Inlet *[inobjs];
-            tmpobj = new SndObj *[inobjs];
-            for(i = 0; i < inobjs; ++i) {
-                inobj[i] = new Inlet(InSig(i),blsz,smprt);
-                tmpobj[i] = new SndObj(NULL,blsz,smprt);
+            if(!inobj) {
+                inobj = new Inlet *[inobjs];
+                tmpobj = new SndObj *[inobjs];
+                for(i = 0; i < inobjs; ++i) {
+                    inobj[i] = new Inlet(InSig(i),blsz,smprt);
+                    tmpobj[i] = new SndObj(NULL,blsz,smprt);
+                }
             }
+            else
+                for(i = 0; i < inobjs; ++i) {
+                    inobj[i]->Setup(InSig(i),blsz,smprt);
+                    tmpobj[i]->SetVectorSize(blsz);
+                    tmpobj[i]->SetSr(smprt);
+                }
         }
         if(outobjs) {
-            outobj = new Outlet *[outobjs];
-            for(i = 0; i < outobjs; ++i) outobj[i] = new Outlet(OutSig(i),blsz,smprt);
+            if(!outobj) {
+                outobj = new Outlet *[outobjs];
+                for(i = 0; i < outobjs; ++i) outobj[i] = new Outlet(OutSig(i),blsz,smprt);
+            }
+            else
+                for(i = 0; i < outobjs; ++i) outobj[i]->Setup(OutSig(i),blsz,smprt);
         }
 
-        if(!NewObjs()) ClearObjs();
+        // let the SndObjs adapt, or rebuild them
+        if(!objs || !ResetObjs()) {
+            if(objs) FreeObjs();
+            objs = NewObjs();
+            if(!objs) FreeObjs();
+        }
     }
     else {
         // assign changed input/output vectors
@@ -92,6 +109,7 @@ bool flext_sndobj::CbDsp()
 
 void flext_sndobj::CbSignal()
 {
+    if(!objs) return;
     for(int i = 0; i < inobjs; ++i) *tmpobj[i] << *inobj[i];
     ProcessObjs();
 }
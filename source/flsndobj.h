@@ -45,6 +45,12 @@ public:
     virtual void FreeObjs() {}
     virtual void ProcessObjs() {}
 
+    /*! \brief Adapt the objects to a changed block size or sample rate
+        \return false to have them recreated with FreeObjs and NewObjs (default)
+        \note InObj and OutObj objects are already reconfigured when this is called.
+    */
+    virtual bool ResetObjs() { return false; }
+
     // inputs and outputs
     SndObj &InObj(int i) { return *tmpobj[i]; }
     SndIO &OutObj(int i) { return *outobj[i]; }
@@ -64,6 +70,7 @@ private:
         virtual short Write();
 
         void SetBuf(const t_sample *b) { buf = b; }
+        void Setup(const t_sample *b,int vecsz,float sr) { buf = b; SetVectorSize(vecsz); SetSr(sr); }
 
     private:
         const t_sample *buf;
@@ -79,6 +86,7 @@ private:
         virtual short Write();
 
         void SetBuf(t_sample *b) { buf = b; }
+        void Setup(t_sample *b,int vecsz,float sr) { buf = b; SetVectorSize(vecsz); SetSr(sr); }
 
     private:
         t_sample *buf;
@@ -93,6 +101,8 @@ private:
     SndObj **tmpobj;
     Inlet **inobj;
     Outlet **outobj;
+    //! NewObjs has succeeded
+    bool objs;
 
     float smprt;
     int blsz;
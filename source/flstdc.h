@@ -290,7 +290,7 @@ typedef t_symbol *t_symptr;
 
 
 // ----- disable attribute editor for PD version < devel_0_36 or 0.37
-#ifndef PD_MAJOR_VERSION
+#if !defined(PD_MAJOR_VERSION) || defined(PD_HEADLESS)
 #	undef FLEXT_NOATTREDIT
 #	define FLEXT_NOATTREDIT
 #endif
@@ -304,7 +304,10 @@ typedef t_symbol *t_symptr;
 #endif
 
 #ifndef FLEXT_QMODE
-#	if FLEXT_SYS == FLEXT_SYS_PD && PD_MINOR_VERSION >= 38 && defined(PD_DEVEL_VERSION)
+#	if FLEXT_SYS == FLEXT_SYS_PD && defined(PD_HEADLESS)
+//		headless host: queue is flushed by the clock for deterministic timing
+#		define FLEXT_QMODE 0
+#	elif FLEXT_SYS == FLEXT_SYS_PD && PD_MINOR_VERSION >= 38 && defined(PD_DEVEL_VERSION)
 //		use idle callback
 #		define FLEXT_QMODE 1
 #	elif defined(FLEXT_PDLOCK)
@@ -328,6 +331,11 @@ typedef t_symbol *t_symptr;
 #	error Internal error: Queueing mode not defined
 #endif
 
+// ----- atoms stored within an AtomList object -----
+#ifndef FLEXT_ATOMLIST_INLINE
+#	define FLEXT_ATOMLIST_INLINE 4
+#endif
+
 #include "flpopns.h"
 
 #endif
@@ -17,6 +17,7 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 flext_stk::flext_stk():
     inobjs(0),outobjs(0),
     inobj(NULL),outobj(NULL),
+    objs(false),
     smprt(0),blsz(0)
 {}
 
@@ -37,6 +38,7 @@ void flext_stk::Exit()
 void flext_stk::ClearObjs()
 {
     FreeObjs();
+    objs = false;
 
     if(inobj) {
         for(int i = 0; i < inobjs; ++i) delete inobj[i]; 
@@ -55,27 +57,38 @@ bool flext_stk::CbDsp()
     int i;
     
     if(Blocksize() != blsz || Samplerate() != smprt) {
-        // block size or sample rate has changed... rebuild all objects
-
-        ClearObjs();
+        // block size or sample rate has changed
 
         smprt = Samplerate();
         blsz = Blocksize();
         Stk::setSampleRate(smprt); 
 
-        // set up sndobjs for inlets and outlets
+        // set up objects for inlets and outlets only once, the signal layout doesn't change
         if(inobjs) {
-            inobj = new Input *[inobjs];
-            for(i = 0; i < inobjs; ++i)
-                inobj[i] = new Input(InSig(i),blsz);
+            if(!inobj) {
+                inobj = new Input *[inobjs];
+                for(i = 0; i < inobjs; ++i)
+                    inobj[i] = new Input(InSig(i),blsz);
+            }
+            else
+                for(i = 0; i < inobjs; ++i) inobj[i]->Setup(InSig(i),blsz);
         }
         if(outobjs) {
-            outobj = new Output *[outobjs];
-            for(i = 0; i < outobjs; ++i) 
-                outobj[i] = new Output(OutSig(i),blsz);
+            if(!outobj) {
+                outobj = new Output *[outobjs];
+                for(i = 0; i < outobjs; ++i) 
+                    outobj[i] = new Output(OutSig(i),blsz);
+            }
+            else
+                for(i = 0; i < outobjs; ++i) outobj[i]->Setup(OutSig(i),blsz);
         }
 
-        if(!NewObjs()) ClearObjs();
+        // let the STK objects adapt, or rebuild them
+        if(!objs || !ResetObjs()) {
+            if(objs) FreeObjs();
+            objs = NewObjs();
+            if(!objs) FreeObjs();
+        }
     }
     else {
         // assign changed input/output vectors
@@ -88,16 +101,68 @@ bool flext_stk::CbDsp()
 
 void flext_stk::CbSignal()
 {
-    if(inobjs || outobjs) ProcessObjs(blsz);
+    if(objs && (inobjs || outobjs)) ProcessObjs(blsz);
+}
+
+
+// sample conversion
+
+template<typename D,typename S>
+inline void stkconvert(D *dst,const S *src,int cnt) 
+{ 
+    for(int i = 0; i < cnt; ++i) dst[i] = (D)src[i]; 
+}
+
+#if defined(FLEXT_SAMPLEPACKET_SSE2) || defined(FLEXT_SAMPLEPACKET_AVX)
+template<>
+inline void stkconvert<double,float>(double *dst,const float *src,int cnt) 
+{ 
+    int i = 0;
+    for(; i <= cnt-4; i += 4) {
+        const __m128 s = _mm_loadu_ps(src+i);
+        _mm_storeu_pd(dst+i,_mm_cvtps_pd(s));
+        _mm_storeu_pd(dst+i+2,_mm_cvtps_pd(_mm_movehl_ps(s,s)));
+    }
+    for(; i < cnt; ++i) dst[i] = src[i]; 
+}
+
+template<>
+inline void stkconvert<float,double>(float *dst,const double *src,int cnt) 
+{ 
+    int i = 0;
+    for(; i <= cnt-4; i += 4) {
+        const __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(src+i));
+        const __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(src+i+2));
+        _mm_storeu_ps(dst+i,_mm_movelh_ps(lo,hi));
+    }
+    for(; i < cnt; ++i) dst[i] = (float)src[i]; 
 }
+#endif
+
+void flext_stk::CopyStk(StkFloat *dst,const t_sample *src,int cnt) { stkconvert(dst,src,cnt); }
+
+void flext_stk::CopyStk(t_sample *dst,const StkFloat *src,int cnt) { stkconvert(dst,src,cnt); }
 
 
 // inlet class
 
 StkFloat *flext_stk::Input::tick(StkFloat *vector,unsigned int vectorSize)
 {
-    FLEXT_ASSERT(vectorSize == vecsz);
-    for(unsigned int i = 0; i < vectorSize; i++) vector[i] = tick();
+    // convert in runs up to the end of the signal vector
+    for(unsigned int i = 0; i < vectorSize; ) {
+        int pos = index+1;
+        if(pos >= vecsz) pos = 0;
+        const int n = (int)(vectorSize-i) < vecsz-pos?(int)(vectorSize-i):vecsz-pos;
+        CopyStk(vector+i,buf+pos,n);
+        index = pos+n-1;
+        i += n;
+    }
+    return vector;
+}
+
+StkFloat *flext_stk::Input::tick(StkFloat *vector,unsigned int vectorSize,unsigned int stride)
+{
+    for(unsigned int i = 0; i < vectorSize; i++) vector[i*stride] = tick();
     return vector;
 }
 
@@ -106,8 +171,18 @@ StkFloat *flext_stk::Input::tick(StkFloat *vector,unsigned int vectorSize)
 
 void flext_stk::Output::tick(const StkFloat *vector,unsigned int vectorSize)
 {
-    FLEXT_ASSERT(vectorSize == vecsz);
-    for(unsigned int i = 0; i < vectorSize; i++) tick(vector[i]);
+    // convert in runs up to the end of the signal vector
+    for(unsigned int i = 0; i < vectorSize; ) {
+        const int n = (int)(vectorSize-i) < vecsz-index?(int)(vectorSize-i):vecsz-index;
+        CopyStk(buf+index,vector+i,n);
+        if((index += n) >= vecsz) index = 0;
+        i += n;
+    }
+}
+
+void flext_stk::Output::tick(const StkFloat *vector,unsigned int vectorSize,unsigned int stride)
+{
+    for(unsigned int i = 0; i < vectorSize; i++) tick(vector[i*stride]);
 }
 
 #include "flpopns.h"
@@ -37,6 +37,12 @@ public:
     virtual void FreeObjs() {}
     virtual void ProcessObjs(int blocksize) {}
 
+    /*! \brief Adapt the objects to a changed block size or sample rate
+        \return false to have them recreated with FreeObjs and NewObjs (default)
+        \note Inlet and Outlet objects are already reconfigured when this is called.
+    */
+    virtual bool ResetObjs() { return false; }
+
 protected:
     virtual bool Init();
     virtual void Exit();
@@ -51,6 +57,9 @@ protected:
 		    index(v-1)
 		{}
 
+        //! Reconfigure for another signal vector
+        inline void Setup(const t_sample *b,int v) { buf = b,vecsz = v,index = v-1; }
+
         inline StkFloat lastOut() const { return (StkFloat)buf[index]; }
 
         inline StkFloat tick() 
@@ -60,12 +69,19 @@ protected:
         }
 
         StkFloat *tick(StkFloat *vector,unsigned int vectorSize);
+
+        //! Read into every stride-th element of vector
+        StkFloat *tick(StkFloat *vector,unsigned int vectorSize,unsigned int stride);
         
-        inline StkFrames &tick(StkFrames &vector)
+        //! Read into one channel of frames
+        inline StkFrames &tick(StkFrames &frames,unsigned int channel = 0)
         {
-            FLEXT_ASSERT(vector.channels() == 1);
-            tick(&vector[0],vector.frames());
-            return vector;
+            FLEXT_ASSERT(channel < frames.channels());
+            if(frames.channels() == 1)
+                tick(&frames[0],frames.frames());
+            else
+                tick(&frames[channel],frames.frames(),frames.channels());
+            return frames;
         }
 
         inline void SetBuf(const t_sample *b) { buf = b; }
@@ -85,6 +101,9 @@ protected:
 		    index(0)
 		{}
 
+        //! Reconfigure for another signal vector
+        inline void Setup(t_sample *b,int v) { buf = b,vecsz = v,index = 0; }
+
         inline void tick(StkFloat s) 
         { 
             buf[index] = (t_sample)s; 
@@ -92,12 +111,20 @@ protected:
         }
 
         void tick(const StkFloat *vector,unsigned int vectorSize);
+
+        //! Write every stride-th element of vector
+        void tick(const StkFloat *vector,unsigned int vectorSize,unsigned int stride);
         
-        inline void tick(const StkFrames &vector)
+        //! Write one channel of frames
+        inline void tick(const StkFrames &frames,unsigned int channel = 0)
         {
-            FLEXT_ASSERT(vector.channels() == 1);
+            FLEXT_ASSERT(channel < frames.channels());
             // dirty casting due to bug in STK api... operator[] _should_ return const StkFloat &
-            tick(&const_cast<StkFrames &>(vector)[0],vector.frames());
+            const StkFloat *v = &const_cast<StkFrames &>(frames)[channel];
+            if(frames.channels() == 1)
+                tick(v,frames.frames());
+            else
+                tick(v,frames.frames(),frames.channels());
         }
 
         inline void SetBuf(t_sample *b) { buf = b; }
@@ -110,6 +137,11 @@ protected:
     Input &Inlet(int ix) { return *inobj[ix]; }
     Output &Outlet(int ix) { return *outobj[ix]; }
 
+    //! Convert a signal vector to STK samples
+    static void CopyStk(StkFloat *dst,const t_sample *src,int cnt);
+    //! Convert STK samples to a signal vector
+    static void CopyStk(t_sample *dst,const StkFloat *src,int cnt);
+
 private:
     virtual bool CbDsp(); 
     virtual void CbSignal(); 
@@ -119,6 +151,8 @@ private:
     int inobjs,outobjs;
     Input **inobj;
     Output **outobj;
+    //! NewObjs has succeeded
+    bool objs;
 
     float smprt;
     int blsz;
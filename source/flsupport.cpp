@@ -14,6 +14,7 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 #define __FLEXT_SUPPORT_CPP
 
 #include "flext.h"
+#include "flinternal.h"
 
 #include <cstdio>
 #include <cstdarg>
@@ -21,6 +22,8 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 #include <cstring>
 #include <new>
 
+#include "flcontainers.h"
+
 #include "flpushns.h"
 
 #ifdef _MSC_VER
@@ -48,8 +51,68 @@ FLEXT_TEMPIMPL(const t_symbol *FLEXT_CLASSDEF(flext))::sym_dirty = NULL;
 FLEXT_TEMPIMPL(const t_symbol *FLEXT_CLASSDEF(flext))::sym_attributes = NULL;
 FLEXT_TEMPIMPL(const t_symbol *FLEXT_CLASSDEF(flext))::sym_methods = NULL;
 
+#ifdef FLEXT_THREADLOCAL
+FLEXT_TEMPIMPL(FLEXT_THREADLOCAL bool FLEXT_CLASSDEF(flext))::indsp = false;
+#else
 FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::indsp = false;
+#endif
+
+
+FLEXT_TEMPIMPL(FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext))::StaticSymbol *FLEXT_CLASSDEF(flext))::StaticSymbol::statics = NULL;
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::StaticSymbol::MakeAll()
+{
+    for(StaticSymbol *s = statics; s; s = s->nxt)
+        if(!s->sym) s->Make();
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::ScratchArena::Reserve(size_t n)
+{
+    if(n < hiwat) n = hiwat;
+    n = (n+align-1)&~(size_t)(align-1);
+    if(n > size) {
+        if(mem) FreeAligned(mem);
+        mem = (char *)NewAligned(n,align*8);
+        size = n;
+    }
+    Reset();
+}
+
+/*! The cache only holds symbol pointers, a hit is verified against the name of the symbol.
+    Symbols are never freed and pointers are written atomically, so no locking is needed.
+*/
+FLEXT_TEMPIMPL(const t_symbol *FLEXT_CLASSDEF(flext))::MakeSymbolCached(const char *s,int n)
+{
+    static const t_symbol *volatile cache[256];
 
+    // FNV-1a
+    unsigned long h = 2166136261UL;
+    for(int i = 0; i < n; ++i) h = (h^(unsigned char)s[i])*16777619UL;
+    const t_symbol *volatile &slot = cache[(h^(h>>8))&255];
+
+    const t_symbol *sym = slot;
+    if(sym) {
+        const char *c = GetString(sym);
+        if(!strncmp(c,s,n) && !c[n]) return sym;
+    }
+
+    if(s[n])
+        // not terminated at n
+        if(n < 256) {
+            char tmp[256];
+            memcpy(tmp,s,n); tmp[n] = 0;
+            sym = MakeSymbol(tmp);
+        }
+        else {
+            char *tmp = new char[n+1];
+            memcpy(tmp,s,n); tmp[n] = 0;
+            sym = MakeSymbol(tmp);
+            delete[] tmp;
+        }
+    else
+        sym = MakeSymbol(s);
+    return slot = sym;
+}
 
 FLEXT_TEMPIMPL(int FLEXT_CLASSDEF(flext))::Version() { return FLEXT_VERSION; }
 FLEXT_TEMPIMPL(const char *FLEXT_CLASSDEF(flext))::VersionStr() { return FLEXT_VERSTR; }
@@ -86,6 +149,11 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::Setup()
     sym_attributes = flext::MakeSymbol("attributes");
     sym_methods = flext::MakeSymbol("methods");
 
+    StaticSymbol::MakeAll();
+
+    // select the sample functions for this CPU
+    SetSIMDKernels();
+
 #ifdef FLEXT_THREADS
 	thrid = GetThreadId();
     StartHelper();
@@ -109,19 +177,313 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::Setup()
 
 #define LARGEALLOC 32000
 
+#ifdef FLEXT_MEMSTATS
+//! Allocation counters of a thread
+struct MemThread {
+    flext_root::MemCounter all,dsp;
+#ifdef FLEXT_THREADS
+    flext::thrid_t thrid;
+#endif
+    //! list of all threads, never unlinked
+    MemThread *nxt;
+};
+
+FLEXT_TEMPLATE
+struct MemVars {
+    static MemThread *volatile threads;
+#ifdef FLEXT_THREADLOCAL
+    static FLEXT_THREADLOCAL MemThread *thread;
+    static FLEXT_THREADLOCAL flext_root::MemCounter *owner;
+#else
+    static MemThread *thread;
+    static flext_root::MemCounter *owner;
+#endif
+};
+
+// constant initialization, allocations may happen before static initialization
+FLEXT_TEMPIMPL(MemThread *volatile MemVars)::threads = NULL;
+#ifdef FLEXT_THREADLOCAL
+FLEXT_TEMPIMPL(FLEXT_THREADLOCAL MemThread *MemVars)::thread = NULL;
+FLEXT_TEMPIMPL(FLEXT_THREADLOCAL flext_root::MemCounter *MemVars)::owner = NULL;
+#else
+FLEXT_TEMPIMPL(MemThread *MemVars)::thread = NULL;
+FLEXT_TEMPIMPL(flext_root::MemCounter *MemVars)::owner = NULL;
+#endif
+
+static inline void MemAdd(flext_root::MemCounter &c,size_t bytes,bool alloc)
+{
+    if(alloc) ++c.allocs,c.allocbytes += bytes;
+    else ++c.frees,c.freebytes += bytes;
+}
+
+//! Count an allocation or release of the current thread
+FLEXT_TEMPLATE void MemCount(size_t bytes,bool alloc)
+{
+    MemThread *t = FLEXT_TEMPINST(MemVars)::thread;
+    if(UNLIKELY(!t)) {
+        // not with operator new, which is being counted
+        t = (MemThread *)calloc(1,sizeof(MemThread));
+        FLEXT_ASSERT(t);
+#ifdef FLEXT_THREADS
+        // not IsSystemThread, the system thread may not be known yet
+        t->thrid = flext::GetThreadId();
+#endif
+        do t->nxt = FLEXT_TEMPINST(MemVars)::threads;
+        while(!lockfree::CAS(&FLEXT_TEMPINST(MemVars)::threads,t->nxt,t));
+        FLEXT_TEMPINST(MemVars)::thread = t;
+    }
+
+    MemAdd(t->all,bytes,alloc);
+    if(UNLIKELY(flext::InDSP())) {
+        MemAdd(t->dsp,bytes,alloc);
+        flext_root::MemCounter *o = FLEXT_TEMPINST(MemVars)::owner;
+        if(o) MemAdd(*o,bytes,alloc);
+    }
+}
+
+static inline void MemSum(flext_root::MemCounter &d,const flext_root::MemCounter &s)
+{
+    d.allocs += s.allocs,d.frees += s.frees;
+    d.allocbytes += s.allocbytes,d.freebytes += s.freebytes;
+}
+
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_root))::GetMemStats(MemStats &st,int thread)
+{
+    memset(&st,0,sizeof st);
+    size_t allocated = 0,freed = 0;
+    int i = 0;
+    for(const MemThread *t = FLEXT_TEMPINST(MemVars)::threads; t; t = t->nxt,++i) {
+        allocated += t->all.allocbytes;
+        freed += t->all.freebytes;
+        if(thread < 0 || thread == i) {
+            MemSum(st.all,t->all);
+            MemSum(st.dsp,t->dsp);
+#ifdef FLEXT_THREADS
+            st.system = flext::IsThread(t->thrid,flext::GetSysThreadId());
+#else
+            st.system = true;
+#endif
+        }
+    }
+    // blocks may be freed by other threads than those which allocated them
+    st.live = allocated-freed;
+    st.threads = i;
+    if(thread >= 0) return thread < i;
+    st.system = false;
+    return true;
+}
+
+FLEXT_TEMPIMPL(FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext_root))::MemCounter *FLEXT_CLASSDEF(flext_root))::SetMemOwner(MemCounter *c)
+{
+    MemCounter *o = FLEXT_TEMPINST(MemVars)::owner;
+    FLEXT_TEMPINST(MemVars)::owner = c;
+    return o;
+}
+#endif
+
+#ifdef FLEXT_ALLOCCACHE
+
+/*! \brief Size class allocator for small blocks
+    Every thread keeps free lists per size class, exchanging blocks in batches with lock-free central free lists.
+    New blocks are carved from large chunks obtained from the C library, hence no allocation takes the system lock.
+    \note Chunks are only returned to the system when the application exits.
+*/
+FLEXT_TEMPLATE
+class AllocCache
+{
+public:
+    enum { 
+        minshift = 4, classes = 9, // 16 ... 4096 bytes
+        maxsize = 1<<(minshift+classes-1),
+        chunksize = 65536,
+        batch = 32, // blocks moved between thread and central lists
+        keep = 2*batch // blocks kept per thread and class
+    };
+
+    static inline int Class(size_t bytes) 
+    { 
+        int c = 0;
+        for(size_t sz = (size_t)1<<minshift; sz < bytes; sz <<= 1) ++c;
+        return c;
+    }
+
+    static inline size_t Size(int c) { return (size_t)1<<(c+minshift); }
+
+    static void *Alloc(int c)
+    {
+        Local *l = Get();
+        void *blk = l->head[c];
+        if(UNLIKELY(!blk)) {
+            Refill(l,c);
+            blk = l->head[c];
+        }
+        l->head[c] = *(void **)blk;
+        --l->cnt[c];
+        return blk;
+    }
+
+    static void Free(void *blk,int c)
+    {
+        Local *l = Get();
+        *(void **)blk = l->head[c];
+        l->head[c] = blk;
+        if(UNLIKELY(++l->cnt[c] > keep)) Drain(l,c,batch);
+    }
+
+private:
+    struct Local
+    {
+        void *head[classes];
+        int cnt[classes];
+    };
+
+    static Lifo *Central(int c) { return reinterpret_cast<Lifo *>(central.mem)+c; }
+
+    static void Refill(Local *l,int c)
+    {
+        Lifo *cl = Central(c);
+        for(int i = 0; i < batch; ++i) {
+            void *blk = cl->Pop();
+            if(!blk) break;
+            *(void **)blk = l->head[c];
+            l->head[c] = blk;
+            ++l->cnt[c];
+        }
+
+        if(!l->head[c]) {
+            // carve a new chunk, the first batch is for this thread
+            const size_t sz = Size(c);
+            char *chunk = (char *)malloc(chunksize);
+            FLEXT_ASSERT(chunk);
+            int n = (int)(chunksize/sz);
+            for(int i = 0; i < n; ++i) {
+                void *blk = chunk+i*sz;
+                if(i < batch) {
+                    *(void **)blk = l->head[c];
+                    l->head[c] = blk;
+                    ++l->cnt[c];
+                }
+                else
+                    cl->Push(new(blk) LifoCell);
+            }
+        }
+    }
+
+    static void Drain(Local *l,int c,int n)
+    {
+        Lifo *cl = Central(c);
+        for(; n && l->head[c]; --n) {
+            void *blk = l->head[c];
+            l->head[c] = *(void **)blk;
+            --l->cnt[c];
+            cl->Push(new(blk) LifoCell);
+        }
+    }
+
+    static void Init()
+    {
+        for(int c = 0; c < classes; ++c) new(Central(c)) Lifo;
+#if FLEXT_THREADS == FLEXT_THR_POSIX
+        pthread_key_create(&key,Release);
+#else
+        key = TlsAlloc();
+#endif
+    }
+
+    static Local *Create()
+    {
+        Local *l = (Local *)malloc(sizeof(Local));
+        FLEXT_ASSERT(l);
+        memset(l,0,sizeof(*l));
+#if FLEXT_THREADS == FLEXT_THR_POSIX
+        pthread_setspecific(key,l);
+#else
+        TlsSetValue(key,l);
+#endif
+        return l;
+    }
+
+#if FLEXT_THREADS == FLEXT_THR_POSIX
+    static inline Local *Get()
+    {
+        pthread_once(&once,Init);
+        Local *l = (Local *)pthread_getspecific(key);
+        return LIKELY(l)?l:Create();
+    }
+
+    //! Pass the blocks of an exiting thread on to the central lists
+    static void Release(void *p)
+    {
+        Local *l = (Local *)p;
+        for(int c = 0; c < classes; ++c) Drain(l,c,l->cnt[c]);
+        free(l);
+    }
+
+    static pthread_once_t once;
+    static pthread_key_t key;
+#else
+    // the blocks of exiting threads stay with their (bounded) thread lists
+    static inline Local *Get()
+    {
+        if(UNLIKELY(initstate != 2)) {
+            if(lockfree::CAS(&initstate,0L,1L)) {
+                Init();
+                lockfree::memory_barrier();
+                initstate = 2;
+            }
+            else
+                while(initstate != 2) Sleep(0);
+        }
+        Local *l = (Local *)TlsGetValue(key);
+        return LIKELY(l)?l:Create();
+    }
+
+    static volatile long initstate;
+    static DWORD key;
+#endif
+
+    // constructed on first use, allocations may happen before static initialization
+    static union LOCKFREE_PTR_ALIGNED Mem { char mem[sizeof(Lifo)*classes]; void *align; } central;
+};
+
+FLEXT_TEMPIMPL(FLEXT_TEMPSUB(AllocCache)::Mem AllocCache)::central;
+
+#if FLEXT_THREADS == FLEXT_THR_POSIX
+FLEXT_TEMPIMPL(pthread_once_t AllocCache)::once = PTHREAD_ONCE_INIT;
+FLEXT_TEMPIMPL(pthread_key_t AllocCache)::key;
+#else
+FLEXT_TEMPIMPL(volatile long AllocCache)::initstate = 0;
+FLEXT_TEMPIMPL(DWORD AllocCache)::key;
+#endif
+
+#endif // FLEXT_ALLOCCACHE
+
 #ifndef FLEXT_USE_CMEM
 
 #ifdef FLEXT_DEBUGMEM
 static const size_t memtest = 0x12345678L;
+static const size_t memhdr = sizeof(size_t)+sizeof(memtest);
+#else
+//! Header in front of the block, keeping the alignment of lock-free pointer/tag pairs
+static const size_t memhdr = sizeof(size_t) < LOCKFREE_PTR_ALIGN?LOCKFREE_PTR_ALIGN:sizeof(size_t);
 #endif
 
 FLEXT_TEMPIMPL(void *FLEXT_CLASSDEF(flext_root))::operator new(size_t bytes)
 {
-	bytes += sizeof(size_t);
+	bytes += memhdr;
 #ifdef FLEXT_DEBUGMEM
-    bytes += sizeof(memtest)*2;
+    bytes += sizeof(memtest);
 #endif
     char *blk;
+#ifdef FLEXT_ALLOCCACHE
+    if(LIKELY(bytes <= FLEXT_TEMPINST(AllocCache)::maxsize)) {
+        // the size class is derived from the stored size
+        const int c = FLEXT_TEMPINST(AllocCache)::Class(bytes);
+        bytes = FLEXT_TEMPINST(AllocCache)::Size(c);
+        blk = (char *)FLEXT_TEMPINST(AllocCache)::Alloc(c);
+    }
+    else
+#endif
     if(UNLIKELY(bytes >= LARGEALLOC)) {
 #if FLEXT_SYS == FLEXT_SYS_MAX && defined(_SYSMEM_H_)
         blk = (char *)sysmem_newptr(bytes);
@@ -139,14 +501,16 @@ FLEXT_TEMPIMPL(void *FLEXT_CLASSDEF(flext_root))::operator new(size_t bytes)
 
 	FLEXT_ASSERT(blk);
 
+#ifdef FLEXT_MEMSTATS
+    FLEXT_TEMPINST(MemCount)(bytes,true);
+#endif
+
 	*(size_t *)blk = bytes;
 #ifdef FLEXT_DEBUGMEM
     *(size_t *)(blk+sizeof(size_t)) = memtest;
     *(size_t *)(blk+bytes-sizeof(memtest)) = memtest;
-	return blk+sizeof(size_t)+sizeof(memtest);
-#else
-	return blk+sizeof(size_t);
 #endif
+	return blk+memhdr;
 }
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_root))::operator delete(void *blk)
@@ -155,13 +519,18 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_root))::operator delete(void *blk)
 
     FLEXT_ASSERT(MemCheck(blk));
 
-#ifdef FLEXT_DEBUGMEM
-	char *ori = (char *)blk-sizeof(size_t)-sizeof(memtest);
-#else
-    char *ori = (char *)blk-sizeof(size_t);
-#endif
+	char *ori = (char *)blk-memhdr;
 	size_t bytes = *(size_t *)ori;
 
+#ifdef FLEXT_MEMSTATS
+    FLEXT_TEMPINST(MemCount)(bytes,false);
+#endif
+
+#ifdef FLEXT_ALLOCCACHE
+    if(LIKELY(bytes <= FLEXT_TEMPINST(AllocCache)::maxsize))
+        FLEXT_TEMPINST(AllocCache)::Free(ori,FLEXT_TEMPINST(AllocCache)::Class(bytes));
+    else
+#endif
     if(UNLIKELY(bytes >= LARGEALLOC)) {
 #if FLEXT_SYS == FLEXT_SYS_MAX && defined(_SYSMEM_H_)
         sysmem_freeptr(ori);
@@ -181,7 +550,7 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_root))::operator delete(void *blk)
 #ifdef FLEXT_DEBUGMEM
 FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_root))::MemCheck(void *blk)
 {
-	char *ori = (char *)blk-sizeof(size_t)-sizeof(memtest);
+	char *ori = (char *)blk-memhdr;
 	size_t bytes = *(size_t *)ori;
 
     return 
@@ -220,6 +589,10 @@ FLEXT_TEMPIMPL(void *FLEXT_CLASSDEF(flext_root))::NewAligned(size_t bytes,int bi
     }
 	FLEXT_ASSERT(blk);
 
+#ifdef FLEXT_MEMSTATS
+    FLEXT_TEMPINST(MemCount)(bytes,true);
+#endif
+
 	char *ablk = reinterpret_cast<char *>((reinterpret_cast<size_t>(blk)+ovh+alignovh) & ~alignovh);
 	*(char **)(ablk-sizeof(size_t)-sizeof(char *)) = blk;
 	*(size_t *)(ablk-sizeof(size_t)) = bytes;
@@ -233,6 +606,10 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_root))::FreeAligned(void *blk)
 	char *ori = *(char **)((char *)blk-sizeof(size_t)-sizeof(char *));
 	size_t bytes = *(size_t *)((char *)blk-sizeof(size_t));
 
+#ifdef FLEXT_MEMSTATS
+    FLEXT_TEMPINST(MemCount)(bytes,false);
+#endif
+
     if(UNLIKELY(bytes >= LARGEALLOC)) {
 #if FLEXT_SYS == FLEXT_SYS_MAX && defined(_SYSMEM_H_)
         sysmem_freeptr(ori);
@@ -271,15 +648,46 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::GetAString(const t_atom &a,char *buf
 #endif
 }  
 
+/*! \remark Only the part of the atom word belonging to the type is hashed, 
+    a float doesn't fill the whole word on 64-bit systems.
+    0 and -0 compare equal, so they must hash equally, too.
+*/
 FLEXT_TEMPIMPL(unsigned long FLEXT_CLASSDEF(flext))::AtomHash(const t_atom &a)
 {
 #if FLEXT_SYS == FLEXT_SYS_MAX || FLEXT_SYS == FLEXT_SYS_PD
-	return ((unsigned long)a.a_type<<28)^*(unsigned long *)&a.a_w;
+    unsigned long h;
+    switch(GetType(a)) {
+        case A_FLOAT: {
+            float f = GetFloat(a);
+            if(f == 0) f = 0;
+            unsigned int b;
+            memcpy(&b,&f,sizeof b);
+            h = b;
+            break;
+        }
+#if FLEXT_SYS == FLEXT_SYS_MAX
+        case A_INT: h = (unsigned long)GetInt(a); break;
+#endif
+        case A_SYMBOL: h = (unsigned long)(size_t)GetSymbol(a); break;
+#if FLEXT_SYS == FLEXT_SYS_PD
+        case A_POINTER: h = (unsigned long)(size_t)GetPointer(a); break;
+#endif
+        default: h = 0;
+    }
+	return ((unsigned long)GetType(a)<<28)^h;
 #else
 #error Not implemented
 #endif
 }
 
+FLEXT_TEMPIMPL(unsigned long FLEXT_CLASSDEF(flext))::AtomHash(int argc,const t_atom *argv)
+{
+    // FNV-1a over the atom hashes
+    unsigned long h = 2166136261UL^(unsigned long)argc;
+    for(int i = 0; i < argc; ++i) h = (h^AtomHash(argv[i]))*16777619UL;
+    return h;
+}
+
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext_root))::post(const char *fmt, ...)
 {
 	va_list ap;
@@ -14,6 +14,7 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 #define __FLSUPPORT_H
 
 #include "flstdc.h"
+#include "flsamples.h"
 #include <new>
 #include <cstring>
 
@@ -107,10 +108,46 @@ public:
     //! Free an aligned memory block
     static void FreeAligned(void *blk);
     //! Test for alignment
-    static bool IsAligned(void *ptr,int bitalign = 128) { 
-        return (reinterpret_cast<size_t>(ptr)&(bitalign-1)) == 0; 
+    static bool IsAligned(void *ptr,int bitalign = 128) {
+        return (reinterpret_cast<size_t>(ptr)&(bitalign-1)) == 0;
     }
-    //! @}  FLEXT_S_MEMORY      
+
+#ifdef FLEXT_MEMSTATS
+    /*! \brief Allocation counters
+        \note Compile flext with FLEXT_MEMSTATS to count the allocations of operator new/delete
+        (unless FLEXT_USE_CMEM is defined) and NewAligned/FreeAligned.
+        The sizes include the allocation overhead.
+    */
+    struct MemCounter {
+        unsigned long allocs,frees;
+        size_t allocbytes,freebytes;
+    };
+
+    //! Allocation statistics of a thread or of all threads
+    struct MemStats {
+        MemCounter all; //!< all allocations
+        MemCounter dsp; //!< allocations in DSP time (see flext::InDSP)
+        size_t live; //!< currently allocated bytes (of all threads)
+        int threads; //!< number of threads which have allocated
+        bool system; //!< it's the system thread (for the statistics of a single thread)
+    };
+
+    /*! \brief Get allocation statistics
+        \param thread -1 for the sum of all threads, else the index of a thread (0 to threads-1)
+        \return false if there is no such thread
+        \remark The counters are kept per thread, without compiler support for thread-local storage
+        they are shared by all threads and may miss counts.
+    */
+    static bool GetMemStats(MemStats &st,int thread = -1);
+
+    /*! \brief Attribute the allocations of the current thread in DSP time to the given counters
+        \return the counters set before (to be restored)
+        \note Used for the DSP allocations of objects (see flext_dsp getmemstats)
+    */
+    static MemCounter *SetMemOwner(MemCounter *c);
+#endif
+
+    //! @}  FLEXT_S_MEMORY
 };
 
 #ifndef FLEXT_USE_CMEM
@@ -189,6 +226,61 @@ public:
     typedef t_atom Atom;
 #endif
 
+// --- scratch memory ----------------------------------------- 
+
+    /*! \brief Bump allocator for scratch memory in real-time code
+        Memory is handed out from one aligned block and released all at once with Reset.
+        The block only grows in Reserve, which is not real-time safe.
+        If it's exhausted Alloc returns NULL and notes the demand, so that the next Reserve makes room for it.
+    */
+    class FLEXT_SHARE ScratchArena:
+        public flext_root
+    {
+    public:
+        ScratchArena(): mem(NULL),size(0),pos(0),demand(0),hiwat(0) {}
+        ~ScratchArena() { if(mem) FreeAligned(mem); }
+
+        //! Get n bytes, aligned for the SIMD functions, or NULL if the arena is exhausted
+        void *Alloc(size_t n)
+        {
+            n = (n+align-1)&~(size_t)(align-1);
+            if((demand += n) > hiwat) hiwat = demand;
+            if(UNLIKELY(pos+n > size)) return NULL;
+            void *r = mem+pos;
+            pos += n;
+            return r;
+        }
+
+        //! Get n elements of type T
+        template<typename T>
+        T *Alloc(size_t n) { return static_cast<T *>(Alloc(n*sizeof(T))); }
+
+        //! Release all memory obtained with Alloc
+        void Reset() { pos = demand = 0; }
+
+        /*! \brief Make room for n bytes, or for the largest demand seen so far if that is more
+            \note Resets the arena, not real-time safe
+        */
+        void Reserve(size_t n = 0);
+
+        //! Capacity in bytes
+        size_t Size() const { return size; }
+        //! Bytes in use
+        size_t Used() const { return pos; }
+        //! Largest demand since construction
+        size_t HighWater() const { return hiwat; }
+
+    protected:
+        enum { align = 32 }; // enough for AVX
+
+        char *mem;
+        size_t size,pos,demand,hiwat;
+
+    private:
+        ScratchArena(const ScratchArena &);
+        ScratchArena &operator =(const ScratchArena &);
+    };
+
 // --- buffer/array stuff ----------------------------------------- 
 
     /*! \defgroup FLEXT_S_BUFFER Buffer handling
@@ -288,8 +380,15 @@ public:
         
         /*! \brief Check and update if the buffer has been changed (e.g. resized)
             \note buffer must be Ok()
+            \remark The state is shared by all buffers referring to the same symbol.
+            In Pd, during DSP it is only looked at once per tick, after that Update just compares the generation.
         */
         bool Update();
+
+        /*! \brief Get the generation of the buffer state 
+            It changes whenever a change of data, frames or channels has been detected
+        */
+        unsigned long Generation() const { return gen; }
         
         /*! \brief Lock buffer
             \return previous state (needed for Unlock)
@@ -314,6 +413,14 @@ public:
         */
         void Dirty(bool refr = false);
 
+        /*! \brief Declare a range of the buffer content as dirty.
+            \param from first changed frame
+            \param to frame after the last changed one
+            \param refr: if true forces graphics refresh (in Pd not more often than every FLEXT_BUFFER_REDRAW ms)
+            \note In Pd the ranges are merged until the next redraw, which is skipped if the range is not on display.
+        */
+        void Dirty(int from,int to,bool refr = false);
+
         //! Clear the dirty flag.
         void ClearDirty();
 
@@ -342,15 +449,68 @@ public:
         //! Set frame count
         void Frames(int fr,bool keep = false,bool zero = true);
 
+        /*! \brief Set frame count, outside of the audio thread
+            Can be called in CbSignal, the resize is done later by the main thread (with idle processing).
+            Until Update() returns true, the previous data stays in use.
+            \note Objects using the buffer in DSP must call Update() at the beginning of each block.
+        */
+        void FramesDeferred(int fr,bool keep = false,bool zero = true);
+
         //! Get data value in a platform-independent way
         inline Element operator [](int index) const { return data[index]; }
 
         //! Reference data value in a platform-independent way
         inline Element &operator [](int index) { return data[index]; }
+
+        /*! \brief Copy channel ch of n frames, starting at frame from, to dst
+            \note Vectorized for 2 and 4 channels, if the buffer holds t_sample values
+        */
+        void Deinterleave(int ch,t_sample *dst,int from,int n) const;
+
+        /*! \brief Copy n samples of src to channel ch, starting at frame from
+            \note The other channels are left untouched, call Dirty afterwards
+        */
+        void Interleave(int ch,const t_sample *src,int from,int n);
+
+        //! Interpolation of ReadInterp
+        enum interp_mode {
+            interp_none = 0, //!< sample at the frame below the position
+            interp_linear, //!< linear between two frames
+            interp_cubic, //!< 4-point cubic (Hermite)
+            interp_sinc //!< 8-point windowed sinc
+        };
+
+        //! Frames outside of the buffer for ReadInterp
+        enum edge_mode {
+            edge_clip = 0, //!< positions and frames are clipped to the buffer
+            edge_loop //!< positions and frames wrap around
+        };
+
+        /*! \brief Read a channel at fractional frame positions
+            \param pos positions in frames (NaN is taken as 0)
+            \note The buffer must hold frames, i.e. Ok() and Frames() > 0, otherwise dst is zeroed
+        */
+        void ReadInterp(t_sample *dst,const t_sample *pos,int n,interp_mode mode = interp_linear,edge_mode edge = edge_clip,int ch = 0) const;
         
         //! Graphic auto refresh interval
         void SetRefrIntv(float intv);
 
+        /*! \brief Publish the buffer as a named shared memory segment, to be read by other processes (see flshm.h)
+            \param name ... export name, NULL for the buffer name
+            \return true on success
+            \note buffer must be Ok()
+            \remark The samples are copied to the segment as 32-bit floats, then the range passed to Dirty
+            and the whole buffer after a change of frames or channels. Changes made by others than flext buffers are taken over with Dirty or Export.
+            The export is shared by all buffers referring to the same symbol and ends with the last of them (or Unexport).
+        */
+        bool Export(const char *name = NULL);
+
+        //! End the shared memory export
+        void Unexport();
+
+        //! Check whether the buffer is exported
+        bool Exported() const { return shared && shared->shmname; }
+
         //! Buffer locking class
         class Locker
         {
@@ -362,7 +522,146 @@ public:
             lock_t lock;
         };
 
+        //! Strided iterator over the frames of one channel
+        class Iterator
+        {
+        public:
+            Iterator(Element *p,int s): ptr(p),stride(s) {}
+
+            Element &operator *() const { return *ptr; }
+            Element &operator [](int i) const { return ptr[i*stride]; }
+
+            Iterator &operator ++() { ptr += stride; return *this; }
+            Iterator operator ++(int) { Iterator r(*this); ptr += stride; return r; }
+            Iterator &operator --() { ptr -= stride; return *this; }
+            Iterator operator --(int) { Iterator r(*this); ptr -= stride; return r; }
+            Iterator &operator +=(int n) { ptr += n*stride; return *this; }
+            Iterator &operator -=(int n) { ptr -= n*stride; return *this; }
+            Iterator operator +(int n) const { return Iterator(ptr+n*stride,stride); }
+            Iterator operator -(int n) const { return Iterator(ptr-n*stride,stride); }
+            int operator -(const Iterator &i) const { return (int)(ptr-i.ptr)/stride; }
+
+            bool operator ==(const Iterator &i) const { return ptr == i.ptr; }
+            bool operator !=(const Iterator &i) const { return ptr != i.ptr; }
+            bool operator <(const Iterator &i) const { return ptr < i.ptr; }
+
+            //! Distance of consecutive frames in Elements
+            int Stride() const { return stride; }
+
+        private:
+            Element *ptr;
+            int stride;
+        };
+
+        /*! \brief Locked view of the buffer data
+            The buffer is locked for the lifetime of the view, like with Locker.
+            \note buffer must be Ok()
+        */
+        class View
+        {
+        public:
+            View(buffer &b): buf(b),lock(b.Lock()) {}
+            ~View() { buf.Unlock(lock); }
+
+            int Channels() const { return buf.Channels(); }
+            int Frames() const { return buf.Frames(); }
+
+            //! Iterator at the first frame of a channel
+            Iterator Begin(int ch) const { FLEXT_ASSERT(ch >= 0 && ch < Channels()); return Iterator(buf.Data()+ch,Channels()); }
+            //! Iterator past the last frame of a channel
+            Iterator End(int ch) const { return Begin(ch)+Frames(); }
+
+            /*! \brief Get a channel as a contiguous sample array
+                \return NULL if the channel is interleaved or the buffer stores a different format (like Pd's t_word)
+            */
+            t_sample *Contiguous(int ch) const
+            {
+                FLEXT_ASSERT(ch >= 0 && ch < Channels());
+                return Channels() == 1 && sizeof(Element) == sizeof(t_sample)?reinterpret_cast<t_sample *>(buf.Data()+ch):NULL;
+            }
+
+            /*! \brief Copy frames of a channel into dst
+                \param offs ... first frame
+                \param cnt ... number of frames, offs+cnt must not exceed Frames()
+            */
+            void Read(int ch,t_sample *dst,int cnt,int offs = 0) const;
+
+            /*! \brief Copy src into frames of a channel
+                \param offs ... first frame
+                \param cnt ... number of frames, offs+cnt must not exceed Frames()
+                \note Call buffer::Dirty afterwards
+            */
+            void Write(int ch,const t_sample *src,int cnt,int offs = 0);
+
+        private:
+            buffer &buf;
+            lock_t lock;
+        };
+
+        /*! \brief State shared by all buffers referring to the same symbol
+            \internal
+        */
+        struct Shared {
+            const t_symbol *sym;
+            int refs;
+            Element *data;
+            int chns,frames;
+            //! incremented with every change of data, chns or frames
+            unsigned long gen;
+#if FLEXT_SYS == FLEXT_SYS_PD
+            t_garray *arr;
+            //! logical time of the last refresh during DSP
+            double stamp;
+            //! redraw interval of the buffer which started the clock
+            float interval;
+            //! flag signaling that the data has been changed
+            bool isdirty;
+            //! frame range changed since the last redraw (empty if dirtyto <= dirtyfrom)
+            int dirtyfrom,dirtyto;
+            //! logical time of the last redraw
+            double redrawn;
+            //! flag showing that the update clock is active
+            bool ticking;
+            //! update clock, one per array
+            t_clock *tick;
+#endif
+            //! deferred resize (see FramesDeferred)
+            int resizefr;
+            bool resizekeep,resizezero;
+            //! set while the resize is queued
+            volatile long resizing;
+            //! incremented with every request
+            volatile long resizeseq;
+            //! all buffers are gone while the resize was queued
+            bool orphan;
+            //! shared memory segment of the export, NULL if not exported
+            void *shmbase;
+            size_t shmsize;
+            char *shmname;
+            //! number of ShmWrite calls using the segment, it's only unmapped without them
+            volatile long shmwriters;
+            //! set while a larger segment is queued to be made (see cb_export)
+            volatile long shmpending;
+#if FLEXT_OS == FLEXT_OS_WIN
+            void *shmmap;
+            //! index segment (see flshm.h) and number of the current segment
+            void *shmindex,*shmindexmap;
+            unsigned int shmseg;
+#endif
+        };
+
+        /*! \brief Look up all arrays referred to and update the buffers
+            \internal
+            Each array is only looked up once, no matter how many buffers refer to it.
+        */
+        static void Rescan();
+
     protected:
+        //! shared state of the symbol
+        Shared *shared;
+        //! generation of the shared state our members correspond to
+        unsigned long gen;
+
         //! buffer name
         const t_symbol *sym;
         //! array holding audio data
@@ -376,22 +675,113 @@ public:
         t_garray *arr;
         //! update interval
         float interval;
-        //! flag signaling that the data has been changed
-        bool isdirty;
-        //! flag showing that the update clock is active
-        bool ticking;
-        //! update clock
-        t_clock *tick;
         //! last time the dirty flag was cleared (using the clock_getlogicaltime function)
         double cleantime;
 
     private:
         //! update clock callback
-        static void cb_tick(buffer *b);
+        static void cb_tick(Shared *sh);
 #elif FLEXT_SYS == FLEXT_SYS_MAX
         //! last time the dirty flag was cleared (using the gettime function)
         long cleantime;
 #endif
+
+    private:
+        /*! \brief Look at the host buffer and update the shared state
+            \param lookup ... also search for the array object (Pd)
+            \return 0 on success, -1 if not found or invalid, -2 if the object isn't a buffer~ (Max)
+        */
+        static int Refresh(Shared &sh,bool lookup);
+
+        //! Take over the shared state, return true if it has changed
+        bool Sync();
+
+        //! Resize the buffer of the shared state
+        static void Resize(Shared &sh,int fr,bool keep,bool zero);
+
+        //! Idle callback for FramesDeferred
+        static bool cb_resize(int argc,const t_atom *argv);
+
+        //! Create the export segment for n samples
+        static bool ShmCreate(Shared &sh,int n);
+        //! Remove the export segment, readers see it as stale
+        static void ShmFree(Shared &sh,bool end);
+        //! Copy frames to the export segment, a larger one is queued with cb_export if it's too small
+        static void ShmWrite(Shared &sh,int from,int to);
+        //! Idle callback making a larger export segment
+        static bool cb_export(int argc,const t_atom *argv);
+    };
+
+
+    /*! \brief Read-only sample file mapped into memory
+        Pages are only loaded from disk when they are accessed, 
+        so startup time and memory use depend on the part of the file actually played.
+        Supported are WAV files with 32-bit float samples and raw (headerless) 32-bit float files 
+        in the byte order of the machine.
+        \remark Channels are interleaved, just like buffer data in Max.
+    */
+    class FLEXT_SHARE filebuffer:
+        public flext_root
+    {
+    public:
+        filebuffer();
+        ~filebuffer();
+
+        /*! \brief Map a sample file
+            \param path ... file name
+            \param channels ... 0 for a WAV file, otherwise the channel count of a raw file
+            \return true on success
+        */
+        bool Open(const char *path,int channels = 0);
+
+        //! Unmap the file
+        void Close();
+
+        //! Check if a file is mapped
+        bool Ok() const { return data != NULL; }
+
+        //! Get pointer to the interleaved samples
+        const float *Data() const { return data; }
+
+        //! Get channel count
+        int Channels() const { return chns; }
+        //! Get frame count
+        int Frames() const { return frames; }
+        //! Get sample rate (0 for raw files)
+        float Samplerate() const { return srate; }
+
+        //! Get data value
+        float operator [](int index) const { return data[index]; }
+
+        /*! \brief Copy frames of a channel into dst
+            \param offs ... first frame
+            \param cnt ... number of frames, offs+cnt must not exceed Frames()
+        */
+        void Read(int ch,t_sample *dst,int cnt,int offs = 0) const;
+
+        /*! \brief Announce that frames will be read soon, e.g. ahead of the playback position
+            \remark Cheap when called every block, the system is only asked again if the range has moved on.
+        */
+        void Prefetch(int offs,int cnt);
+
+        //! Announce that frames will not be needed for a while (their memory can be reclaimed)
+        void Discard(int offs,int cnt);
+
+    protected:
+        //! Give an access hint for a range of frames
+        void Advise(int offs,int cnt,bool need);
+
+        //! mapped file
+        void *base;
+        size_t size;
+#if FLEXT_OS == FLEXT_OS_WIN
+        void *hfile,*hmap;
+#endif
+        const float *data;
+        int chns,frames;
+        float srate;
+        //! frames most recently prefetched
+        int prefbeg,prefend;
     };
 
 
@@ -419,6 +809,19 @@ public:
 
     //! Copy a list of atoms
     static t_atom *CopyList(int argc,const t_atom *argv);
+
+    /*! \brief Convert atoms to floats
+        \return true if all atoms are numbers, other atoms are converted to 0
+    */
+    static bool AtomsToFloats(int cnt,float *dst,const t_atom *src);
+    /*! \brief Convert atoms to integers
+        \return true if all atoms are numbers, other atoms are converted to 0
+    */
+    static bool AtomsToInts(int cnt,int *dst,const t_atom *src);
+    //! Set atoms to floats
+    static void FloatsToAtoms(int cnt,t_atom *dst,const float *src);
+    //! Set atoms to integers
+    static void IntsToAtoms(int cnt,t_atom *dst,const int *src);
     
     //! Print an atom list
     static bool PrintList(int argc,const t_atom *argv,char *buf,size_t bufsz);
@@ -433,20 +836,26 @@ public:
     //! Copy a memory region
     static void CopyMem(void *dst,const void *src,int bytes);
     //! Copy a sample array
-    static void CopySamples(t_sample *dst,const t_sample *src,int cnt);
+    static void CopySamples(t_sample *dst,const t_sample *src,int cnt) { kernels.copy(dst,src,cnt); }
     template<typename T> static void CopySamples(T *dst,const T *src,int cnt) { CopyMem(dst,src,sizeof(*src)*cnt); }
     //! Set a memory region
     static void ZeroMem(void *dst,int bytes);
     //! Set a sample array to a fixed value
-    static void SetSamples(t_sample *dst,int cnt,t_sample s);
+    static void SetSamples(t_sample *dst,int cnt,t_sample s) { kernels.set(dst,cnt,s); }
     template<typename T> static void SetSamples(T *dst,int cnt,t_sample s) { for(int i = 0; i < cnt; ++i) dst[i] = s; }
     //! Set a sample array to 0
     static void ZeroSamples(t_sample *dst,int cnt) { SetSamples(dst,cnt,0); }   
     template<typename T> static void ZeroSamples(T *dst,int cnt) { ZeroMem(dst,sizeof(*dst)*cnt); }
+    //! Convert double to single precision samples
+    static void NarrowSamples(float *dst,const double *src,int cnt) { kernels.narrow(dst,src,cnt); }
+    //! Convert single to double precision samples
+    static void WidenSamples(double *dst,const float *src,int cnt) { kernels.widen(dst,src,cnt); }
 
 
     //! Get a 32 bit hash value from an atom
     static unsigned long AtomHash(const t_atom &a);
+    //! Get a 32 bit hash value from a list of atoms (atoms which compare equal hash equally)
+    static unsigned long AtomHash(int argc,const t_atom *argv);
 
 //!     @} FLEXT_S_UTIL
 
@@ -492,6 +901,43 @@ public:
     //! Check for symbol and get string
     static const char *GetAString(const t_symbol *s,const char *def = NULL) { return s?GetString(s):def; }
 
+    /*! \brief Make a symbol from a string of n characters, using a cache of recently made symbols
+        \note Thread-safe, for repeated symbols like in parsing
+    */
+    static const t_symbol *MakeSymbolCached(const char *s,int n);
+    //! Make a symbol from a string, using a cache of recently made symbols
+    static const t_symbol *MakeSymbolCached(const char *s) { return MakeSymbolCached(s,(int)strlen(s)); }
+
+    /*! \brief Symbol constant, made once and usable like a const t_symbol *
+        Define it at file or class scope, like
+            static const flext::StaticSymbol sym_enable("enable");
+        Symbols defined this way are made when flext is set up, later ones on first use.
+    */
+    class FLEXT_SHARE StaticSymbol
+    {
+    public:
+        explicit StaticSymbol(const char *s): str(s),sym(NULL) { nxt = statics; statics = this; }
+
+        operator const t_symbol *() const { return LIKELY(sym)?sym:Make(); }
+        const t_symbol *Symbol() const { return *this; }
+
+        //! make all symbols defined so far (done by flext::Setup)
+        static void MakeAll();
+
+    protected:
+        const t_symbol *Make() const { return sym = MakeSymbol(str); }
+
+        const char *str;
+        mutable const t_symbol *volatile sym;
+        StaticSymbol *nxt;
+
+        static StaticSymbol *statics;
+
+    private:
+        StaticSymbol(const StaticSymbol &);
+        StaticSymbol &operator =(const StaticSymbol &);
+    };
+
 // --- atom stuff ----------------------------------------
         
     //! Set atom from another atom
@@ -608,17 +1054,26 @@ public:
 
 // --- atom list stuff -------------------------------------------
 
-    //! Class representing a list of atoms
+    /*! \brief Class representing a list of atoms
+        Short lists (up to FLEXT_ATOMLIST_INLINE atoms) are stored within the object.
+        The capacity grows geometrically and is kept when the list shrinks, hence appending is amortized O(1).
+    */
     class FLEXT_SHARE AtomList
         : public flext_root
     {
     public:
         //! Construct list
-        AtomList(): cnt(0),lst(NULL) {}
+        AtomList(): cnt(0),cap(0),lst(NULL),fix(inl),fixcnt(FLEXT_ATOMLIST_INLINE) {}
         //! Construct list
-        explicit AtomList(int argc,const t_atom *argv = NULL): cnt(0),lst(NULL) { operator()(argc,argv); }
+        explicit AtomList(int argc,const t_atom *argv = NULL): cnt(0),cap(0),lst(NULL),fix(inl),fixcnt(FLEXT_ATOMLIST_INLINE) { operator()(argc,argv); }
         //! Construct list
-        AtomList(const AtomList &a): cnt(0),lst(NULL) { operator =(a); }
+        AtomList(const AtomList &a): cnt(0),cap(0),lst(NULL),fix(inl),fixcnt(FLEXT_ATOMLIST_INLINE) { operator =(a); }
+#if __cplusplus >= 201103L
+        //! Construct list, taking over the contents of a
+        AtomList(AtomList &&a): cnt(0),cap(0),lst(NULL),fix(inl),fixcnt(FLEXT_ATOMLIST_INLINE) { Take(a); }
+        //! Take over the contents of a
+        AtomList &operator =(AtomList &&a) { return Take(a); }
+#endif
         //! Destroy list
         virtual ~AtomList();
 
@@ -647,6 +1102,22 @@ public:
 
         //! Get number of atoms in the list
         int Count() const { return cnt; }
+        //! Get number of atoms the list can hold without reallocation
+        int Capacity() const { return cap; }
+        //! Make room for n atoms, keeping the contents
+        AtomList &Reserve(int n) { if(n > cap) { const int c = cnt; Alloc(n,0,c); cnt = c; } return *this; }
+
+        /*! \brief Take over the contents of another list, which is cleared
+            \note Allocated memory is passed on, without copying the atoms
+        */
+        AtomList &Take(AtomList &a);
+        //! Exchange the contents with another list
+        void Swap(AtomList &a);
+
+        /*! \brief Hand over the memory of the list, which is empty afterwards
+            \return the atoms (allocated with new t_atom[]) or NULL if the list is stored within the object
+        */
+        t_atom *Detach() { t_atom *l = NULL; if(IsAllocated()) { l = lst; lst = NULL; cnt = cap = 0; } return l; }
         //! Get a reference to an indexed atom
         t_atom &operator [](int ix) { return lst[ix]; }
         //! Get a reference to an indexed atom
@@ -701,18 +1172,25 @@ public:
         virtual void Alloc(int sz,int keepix = -1,int keeplen = -1,int keepto = 0);
         virtual void Free();
 
-        int cnt;
+        //! Is the list stored in allocated memory (rather than in the fixed buffer)?
+        bool IsAllocated() const { return lst && lst != fix; }
+
+        int cnt,cap;
         t_atom *lst;
+        // buffer within the object (or a derived one), used for short lists
+        t_atom *fix;
+        int fixcnt;
+
+    private:
+        t_atom inl[FLEXT_ATOMLIST_INLINE];
     };
 
     class FLEXT_SHARE AtomListStaticBase
         : public AtomList
     {
     protected:
-        explicit AtomListStaticBase(int pc,t_atom *dt): precnt(pc),predata(dt) {}
+        explicit AtomListStaticBase(int pc,t_atom *dt): precnt(pc),predata(dt) { if(pc > AtomList::fixcnt) AtomList::fix = dt,AtomList::fixcnt = pc; }
         virtual ~AtomListStaticBase();
-        virtual void Alloc(int sz,int keepix = -1,int keeplen = -1,int keepto = 0);
-        virtual void Free();
 
         AtomListStaticBase &operator =(const AtomList &a) { AtomList::operator =(a); return *this; }
         AtomListStaticBase &operator =(const AtomListStaticBase &a) { AtomList::operator =(a); return *this; }
@@ -785,6 +1263,256 @@ public:
         const t_symbol *hdr;
     };
 
+    /*! \brief Hash map with atom lists as keys
+        \param T value type (default constructible and assignable)
+
+        Open addressing with robin hood probing, every slot caches the hash of its key,
+        so that atoms are only compared for equal hashes.
+        The key atoms are stored one after another in an arena owned by the map, 
+        the space of removed keys is reclaimed when it grows larger than the live keys.
+        \note Pointers returned by Find or Get are valid until the next insertion or removal, iteration order is unspecified
+    */
+    template<typename T>
+    class AtomListMap
+        : public flext_root
+    {
+    public:
+        AtomListMap(): slots(NULL),mask(0),shift(0),n(0),keys(NULL),keycnt(0),keycap(0),garbage(0) {}
+        ~AtomListMap() { delete[] slots; delete[] keys; }
+
+        //! Number of entries
+        int Size() const { return n; }
+
+        //! Remove all entries
+        void Clear()
+        {
+            delete[] slots; slots = NULL;
+            delete[] keys; keys = NULL;
+            mask = 0,shift = 0,n = 0;
+            keycnt = keycap = garbage = 0;
+        }
+
+        //! Make room for cnt entries without rehashing
+        void Reserve(int cnt)
+        {
+            size_t sz = 8;
+            while(sz*3 < (size_t)cnt*4) sz *= 2;
+            if(!slots || sz > mask+1) Rehash(sz);
+        }
+
+        //! Get the value for a key, NULL if there's none
+        T *Find(int argc,const t_atom *argv) 
+        { 
+            const size_t i = Lookup(AtomHash(argc,argv),argc,argv);
+            return i == NOSLOT?NULL:&slots[i].value;
+        }
+        const T *Find(int argc,const t_atom *argv) const { return const_cast<AtomListMap *>(this)->Find(argc,argv); }
+        T *Find(const AtomList &l) { return Find(l.Count(),l.Atoms()); }
+        const T *Find(const AtomList &l) const { return Find(l.Count(),l.Atoms()); }
+
+        //! Get the value for a key, a default constructed one is inserted if there's none
+        T &Get(int argc,const t_atom *argv) 
+        { 
+            // Place may reallocate the slots
+            const size_t i = Place(AtomHash(argc,argv),argc,argv);
+            return slots[i].value; 
+        }
+        T &Get(const AtomList &l) { return Get(l.Count(),l.Atoms()); }
+        T &operator [](const AtomList &l) { return Get(l.Count(),l.Atoms()); }
+
+        //! Set the value for a key, returns true if the key is new
+        bool Insert(int argc,const t_atom *argv,const T &v)
+        {
+            const int c = n;
+            Get(argc,argv) = v;
+            return n != c;
+        }
+        bool Insert(const AtomList &l,const T &v) { return Insert(l.Count(),l.Atoms(),v); }
+
+        //! Remove a key, returns true if it's been there
+        bool Remove(int argc,const t_atom *argv)
+        {
+            size_t i = Lookup(AtomHash(argc,argv),argc,argv);
+            if(i == NOSLOT) return false;
+
+            garbage += slots[i].cnt;
+            // shift the following entries of the cluster back by one
+            for(;;) {
+                const size_t j = (i+1)&mask;
+                const Slot &s = slots[j];
+                if(s.cnt < 0 || !Dist(s.hash,j)) break;
+                slots[i] = s;
+                i = j;
+            }
+            slots[i].cnt = -1;
+            slots[i].value = T();
+            --n;
+
+            if(garbage > keycnt/2 && garbage > 64) Compact(keycap);
+            return true;
+        }
+        bool Remove(const AtomList &l) { return Remove(l.Count(),l.Atoms()); }
+
+        class iterator
+        {
+        public:
+            iterator(): map(NULL),ix(0) {}
+            iterator(AtomListMap &m): map(&m),ix(0) { skip(); }
+
+            operator bool() const { return map && map->slots && ix <= map->mask; }
+
+            // no checking here!
+            int KeyCount() const { return map->slots[ix].cnt; }
+            const t_atom *KeyAtoms() const { return map->keys+map->slots[ix].off; }
+            AtomList &Key(AtomList &l) const { return l(KeyCount(),KeyAtoms()); }
+            T &data() const { return map->slots[ix].value; }
+
+            iterator &operator ++() { ++ix; skip(); return *this; }
+
+        protected:
+            void skip() { if(map->slots) while(ix <= map->mask && map->slots[ix].cnt < 0) ++ix; }
+
+            AtomListMap *map;
+            size_t ix;
+        };
+
+    protected:
+        struct Slot {
+            Slot(): cnt(-1) {}
+            size_t hash;
+            int off,cnt; // cnt < 0 for an empty slot
+            T value;
+        };
+
+        static const size_t NOSLOT = ~(size_t)0;
+
+        //! Fibonacci hashing, the top bits of the product are the slot index
+        static size_t Mul() { return sizeof(size_t) > 4?(((size_t)0x9E3779B9UL << 16) << 16)|0x7F4A7C15UL:(size_t)0x9E3779B9UL; }
+        size_t Home(size_t h) const { return (h*Mul()) >> shift; }
+        size_t Dist(size_t h,size_t i) const { return (i-Home(h))&mask; }
+
+        static bool Equal(const t_atom *a,const t_atom *b,int cnt)
+        {
+            for(int i = 0; i < cnt; ++i) {
+                if(GetType(a[i]) != GetType(b[i])) return false;
+                switch(GetType(a[i])) {
+                    case A_FLOAT: if(GetFloat(a[i]) != GetFloat(b[i])) return false; break;
+                    case A_SYMBOL: if(GetSymbol(a[i]) != GetSymbol(b[i])) return false; break;
+#if FLEXT_SYS == FLEXT_SYS_MAX
+                    case A_INT: if(GetInt(a[i]) != GetInt(b[i])) return false; break;
+#endif
+#if FLEXT_SYS == FLEXT_SYS_PD
+                    case A_POINTER: if(GetPointer(a[i]) != GetPointer(b[i])) return false; break;
+#endif
+                    default: ;
+                }
+            }
+            return true;
+        }
+
+        size_t Lookup(size_t h,int argc,const t_atom *argv) const
+        {
+            if(!slots) return NOSLOT;
+            // robin hood: stop as soon as the slots are closer to their home than the key would be
+            for(size_t i = Home(h),d = 0;; i = (i+1)&mask,++d) {
+                const Slot &s = slots[i];
+                if(s.cnt < 0 || Dist(s.hash,i) < d) return NOSLOT;
+                if(s.hash == h && s.cnt == argc && Equal(keys+s.off,argv,argc)) return i;
+            }
+        }
+
+        //! Find or insert a key, returns the slot index
+        size_t Place(size_t h,int argc,const t_atom *argv)
+        {
+            size_t i = Lookup(h,argc,argv);
+            if(i != NOSLOT) return i;
+
+            // new key: keep the load below 3/4
+            if(!slots || (size_t)(n+1)*4 > (mask+1)*3) Rehash(slots?(mask+1)*2:8);
+
+            if(keycnt+argc > keycap) Compact(keycnt-garbage+argc);
+
+            Slot c;
+            c.hash = h,c.off = keycnt,c.cnt = argc;
+            CopyAtoms(argc,keys+keycnt,argv);
+            keycnt += argc;
+            ++n;
+
+            // the new entry ends up in the slot where the carrying stops for the first time
+            i = Home(h);
+            size_t ret = NOSLOT;
+            for(size_t d = 0;; i = (i+1)&mask,++d) {
+                Slot &s = slots[i];
+                if(s.cnt < 0) {
+                    s = c;
+                    return ret == NOSLOT?i:ret;
+                }
+                const size_t sd = Dist(s.hash,i);
+                if(sd < d) {
+                    // take the slot from the richer entry and carry that one on
+                    const Slot x = s; s = c; c = x;
+                    d = sd;
+                    if(ret == NOSLOT) ret = i;
+                }
+            }
+        }
+
+        void Rehash(size_t sz)
+        {
+            Slot *old = slots;
+            const size_t oldsz = old?mask+1:0;
+
+            slots = new Slot[sz];
+            mask = sz-1;
+            int b = 0;
+            while(((size_t)1 << b) <= mask) ++b;
+            shift = (int)sizeof(size_t)*8-b;
+
+            for(size_t k = 0; k < oldsz; ++k) {
+                Slot c = old[k];
+                if(c.cnt < 0) continue;
+                for(size_t i = Home(c.hash),d = 0;; i = (i+1)&mask,++d) {
+                    Slot &s = slots[i];
+                    if(s.cnt < 0) { s = c; break; }
+                    const size_t sd = Dist(s.hash,i);
+                    if(sd < d) { const Slot x = s; s = c; c = x; d = sd; }
+                }
+            }
+            delete[] old;
+        }
+
+        //! Copy the live keys into a fresh arena with room for at least need atoms
+        void Compact(int need)
+        {
+            int cap = keycap?keycap:64;
+            while(cap < need) cap *= 2;
+            t_atom *k = new t_atom[cap];
+            int cnt = 0;
+            for(size_t i = 0; slots && i <= mask; ++i) {
+                Slot &s = slots[i];
+                if(s.cnt < 0) continue;
+                CopyAtoms(s.cnt,k+cnt,keys+s.off);
+                s.off = cnt;
+                cnt += s.cnt;
+            }
+            delete[] keys;
+            keys = k,keycap = cap,keycnt = cnt,garbage = 0;
+        }
+
+        Slot *slots;
+        size_t mask;
+        int shift;
+        int n;
+
+        t_atom *keys;
+        int keycnt,keycap,garbage;
+
+    private:
+        // hide, so that it can't be used.....
+        AtomListMap(const AtomListMap &);
+        AtomListMap &operator =(const AtomListMap &);
+    };
+
 
     // double type - based on two floats
 
@@ -827,6 +1555,15 @@ public:
     //! Make new message bundle
     static MsgBundle *MsgNew();
 
+    /*! \brief Make new message bundle with preallocated storage
+        \param msgs number of messages to be added
+        \param atoms total number of atoms of the lists longer than 8 atoms
+        \note The storage is one block, kept with the bundle when it's recycled.
+        Worker threads adding many messages per step and sending them with ToQueueMsg 
+        thereby don't allocate once the queue's bundles have got their blocks.
+    */
+    static MsgBundle *MsgNew(int msgs,int atoms = 0);
+
     //! Destroy message bundle
     static void MsgFree(MsgBundle *mb);
 
@@ -842,6 +1579,86 @@ public:
     //! @} FLEXT_S_MSGBUNDLE
 
 
+    /*! \defgroup FLEXT_S_QUEUE Message queue arena
+        \note Queued messages are taken from a preallocated arena, so that queuing doesn't touch the system allocator.
+        @{
+    */
+
+    //! Behavior when the queue arena is exhausted
+    enum queue_overflow {
+        queue_heap = 0, //!< fall back to the system allocator
+        queue_block, //!< wait until the queue has been drained (heap for the system and queue threads)
+        queue_dropoldest //!< discard the oldest queued message
+    };
+
+    /*! \brief Set the size of the message queue arena
+        \param bundles number of preallocated message bundles (and as many bundle parts)
+        \param blocks number of atom blocks for lists longer than the in-message storage
+        \param blocksize number of atoms per block
+        \param policy behavior when the arena is exhausted
+        \return false if the queue has already been started
+        \note Must be called before the first class is set up, e.g. at the beginning of the library setup function.
+    */
+    static bool SetupQueue(int bundles,int blocks,int blocksize,queue_overflow policy = queue_heap);
+
+    //! Get the number of arena overflows (heap allocations, waits or dropped messages)
+    static unsigned long QueueOverflows();
+
+    //! Message queue lanes
+    enum queue_prio {
+        prio_control = 0, //!< control messages, always delivered completely
+        prio_bulk, //!< bulk data, subject to the queue budget
+        prio_count
+    };
+
+    /*! \brief Limit the delivery of bulk messages per queue pass
+        \param msgs maximum number of bulk messages (0 for unlimited)
+        \param secs maximum time in seconds (0 for unlimited)
+        \note Remaining bulk messages are delivered in the next scheduler tick.
+    */
+    static void SetQueueBudget(int msgs,double secs = 0);
+
+    /*! \brief Limit idle processing (flext_base::AddIdle) per queue pass
+        \param slice time in seconds a task is called repeatedly per turn (0 for a single call)
+        \param budget time in seconds for all tasks (0 for one turn per task)
+        \note Tasks take turns round-robin, a pass continues with the task after the last one run.
+    */
+    static void SetIdleBudget(double slice,double budget);
+
+    //! Statistics of the message queue, see GetQueueStats
+    struct QueueStats {
+        //! number of latency histogram bins
+        enum { LatBins = 20 };
+
+        unsigned long depth; //!< messages currently queued
+        unsigned long peak; //!< maximum depth seen by the queue at the start of a pass
+        unsigned long pushed; //!< messages queued in total
+        unsigned long delivered; //!< messages delivered and released
+        unsigned long requeued; //!< deliveries asking to be called again (idle processing)
+        unsigned long dropped; //!< messages discarded by the queue_dropoldest policy
+        unsigned long forwarded; //!< messages delivered from forwarding rings
+        unsigned long poolhits; //!< bundles taken from the arena
+        unsigned long poolmisses; //!< bundles not available from the arena
+        unsigned long overflows; //!< arena overflows of any kind (see QueueOverflows)
+        double rate; //!< delivered messages per second since the previous call
+
+        /*! \brief Histogram of the time from queuing to delivery, sampled every 16th message
+            Bin 0 counts latencies below 1 microsecond, bin i those below 2^i microseconds,
+            the last bin all longer ones.
+        */
+        unsigned long latency[LatBins];
+    };
+
+    /*! \brief Get the statistics of the message queue
+        \param reset reset peak depth and latency histogram (the totals keep counting)
+        \note The counters are always on, queuing a message only adds an atomic increment.
+        The statistics are also output by the "getqueuestats" message of every flext object.
+    */
+    static void GetQueueStats(QueueStats &stats,bool reset = false);
+
+    //! @} FLEXT_S_QUEUE
+
+
     /*! \defgroup FLEXT_S_MSG Flext message handling 
         @{ 
     */
@@ -874,6 +1691,36 @@ public:
     static bool MsgForward(MsgBundle *mb,const t_symbol *sym,const AtomList &args) { return MsgForward(mb,sym,args.Count(),args.Atoms()); }
     static bool MsgForward(MsgBundle *mb,const char *sym,const AtomList &args) { return MsgForward(mb,MakeSymbol(sym),args.Count(),args.Atoms()); }
 
+    /*! \brief Ring of preallocated message slots, for forwarding from one producer thread
+        Each thread uses its own ring, so that threads don't contend for the message queue.
+        The messages of a ring keep their order and are delivered with the queue.
+    */
+    class ForwardRing;
+
+    /*! \brief Get a ring for the calling thread
+        \param slots number of messages the ring can hold (rounded up to a power of 2)
+        \note Rings released with RingFree are reused.
+    */
+    static ForwardRing *RingNew(int slots = 256);
+
+    //! Release a ring, messages still contained are delivered
+    static void RingFree(ForwardRing *r);
+
+    /*! \brief Forward a message through a ring (or directly, if called from the system thread)
+        \note Only the thread that got the ring may use it. 
+        Lists longer than 8 atoms and messages not fitting into the full ring take a bundle of the message pool (like QueueForward),
+        they are still delivered in order.
+    */
+    static bool RingForward(ForwardRing *r,const t_symbol *sym,const t_symbol *s,int argc,const t_atom *argv);
+    static bool RingForward(ForwardRing *r,const t_symbol *sym,const AtomAnything &args) { return RingForward(r,sym,args.Header(),args.Count(),args.Atoms()); }
+    static bool RingForward(ForwardRing *r,const char *sym,const AtomAnything &args) { return RingForward(r,MakeSymbol(sym),args.Header(),args.Count(),args.Atoms()); }
+    static bool RingForward(ForwardRing *r,const t_symbol *sym,int argc,const t_atom *argv) { return RingForward(r,sym,sym_list,argc,argv); }
+    static bool RingForward(ForwardRing *r,const t_symbol *sym,const AtomList &args) { return RingForward(r,sym,args.Count(),args.Atoms()); }
+    static bool RingForward(ForwardRing *r,const char *sym,const AtomList &args) { return RingForward(r,MakeSymbol(sym),args.Count(),args.Atoms()); }
+
+    //! Forward a message through a ring, from any thread but the system thread
+    static bool QueueForward(ForwardRing *r,const t_symbol *sym,const t_symbol *s,int argc,const t_atom *argv);
+
     //! @} FLEXT_S_MSG
 
     
@@ -907,13 +1754,41 @@ public:
         @{ 
     */
 
-    //! Check if current thread is registered to be a secondary thread
+    /*! \brief Check if current thread is registered to be a secondary thread
+        \remark The result is cached per thread (where supported) until a thread is (un)registered by another one.
+    */
 #ifdef FLEXT_THREADS
-    static bool IsThreadRegistered();
+# ifdef FLEXT_THREADLOCAL
+    static bool IsThreadRegistered() { return LIKELY(thrstate.gen == thrreggen)?thrstate.reg:LookupThreadRegistered(); }
+# else
+    static bool IsThreadRegistered() { return LookupThreadRegistered(); }
+# endif
 #else
     static bool IsThreadRegistered() { return false; }
 #endif
 
+    //! Function called by ParallelFor for each index
+    typedef void (*parfor_t)(int i,void *data);
+
+#ifdef FLEXT_THREADS
+    /*! \brief Spawn helper threads for ParallelFor.
+        \param threads Number of helper threads (in addition to the calling thread)
+        \note Call at setup time (e.g. in the class setup function), not from within DSP.
+    */
+    static bool SetupParallel(int threads);
+
+    /*! \brief Call fn(i,data) for all i in [0,n) and wait for completion.
+        \remark The calling thread takes part, the helper threads run with the priority of the system thread.
+        \remark Doesn't allocate memory, so it can be used inside CbSignal (e.g. to split per-channel work).
+        \remark Runs serially if no helpers are set up or they are busy (e.g. with a nested call).
+        \note fn must only do computation, no flext system functions (outlets etc.)
+    */
+    static void ParallelFor(int n,parfor_t fn,void *data = NULL);
+#else
+    static bool SetupParallel(int) { return false; }
+    static void ParallelFor(int n,parfor_t fn,void *data = NULL) { for(int i = 0; i < n; ++i) fn(i,data); }
+#endif
+
 #ifdef FLEXT_THREADS
 
     //! thread type
@@ -945,6 +1820,17 @@ public:
     */
     static thrid_t GetSysThreadId() { return thrid; }
 
+    //! Check if the current thread is the system thread (cached per thread, where supported)
+    static bool IsSystemThread()
+    {
+#ifdef FLEXT_THREADLOCAL
+        if(UNLIKELY(!thrstate.sys)) thrstate.sys = IsThread(thrid)?1:-1;
+        return thrstate.sys > 0;
+#else
+        return IsThread(thrid);
+#endif
+    }
+
     //! Check if current thread should terminate
     static bool ShouldExit();
 
@@ -965,8 +1851,16 @@ public:
         public flext_root
     {
     public:
-        thr_params(int n = 1): cl(NULL),var(new _data[n]) {}
-        ~thr_params() { delete[] var; }
+        thr_params(int n = 1): cl(NULL),var(n <= inlcnt?inl:new _data[n]) {}
+        ~thr_params() { if(var != inl) delete[] var; }
+
+        /*! \brief Get parameters for n arguments from the pool of recycled ones
+            \note Must be given back with Free, not deleted
+        */
+        static thr_params *New(int n = 1);
+
+        //! Give parameters back to the pool
+        static void Free(thr_params *p);
 
         void set_any(const t_symbol *s,int argc,const t_atom *argv) { var[0]._any = new AtomAnything(s,argc,argv); }
         void set_list(int argc,const t_atom *argv) { var[0]._list = new AtomList(argc,argv); }
@@ -981,6 +1875,52 @@ public:
             AtomList *_list;
             void *_ext;
         } *var;
+
+    protected:
+        // enough for all FLEXT_THREAD_* callbacks
+        enum { inlcnt = 5 };
+        _data inl[inlcnt];
+
+    private:
+        // not copyable, var may point into inl
+        thr_params(const thr_params &);
+        thr_params &operator =(const thr_params &);
+    };
+
+    /*! \brief Scheduling attributes of a thread
+        \remark Launched threads with attributes don't run on the worker pool but get a thread of their own.
+        \sa LaunchThread, SetThreadAttr, SetupDSPThreads, flext_base::CbThreadAttr
+    */
+    class FLEXT_SHARE ThrAttr:
+        public flext_root
+    {
+    public:
+        enum Policy {
+            //! priority relative to the system thread (as used for all launched threads by default)
+            pol_relative = 0,
+            //! normal time-sharing scheduling (SCHED_OTHER, THREAD_PRIORITY_NORMAL)
+            pol_normal,
+            //! real-time first-in first-out scheduling with an absolute priority (SCHED_FIFO)
+            pol_fifo,
+            //! real-time round-robin scheduling with an absolute priority (SCHED_RR)
+            pol_rr,
+            /*! periodic real-time work: time-constraint policy on macOS, 
+                time-critical priority in the MMCSS "Pro Audio" class on Windows, elsewhere like pol_fifo
+            */
+            pol_realtime
+        };
+
+        ThrAttr(): policy(pol_relative),priority(-1),affinity(0),name(NULL),period(0.00145),computation(0.0005),constraint(0.00145) {}
+
+        Policy policy;
+        //! priority offset (pol_relative) or absolute priority (other policies), clamped to the valid range
+        int priority;
+        //! CPUs the thread may run on (bit i for CPU i), 0 for no restriction (ignored on macOS)
+        size_t affinity;
+        //! thread name as shown by debuggers and system tools (must stay valid)
+        const char *name;
+        //! time-constraint parameters of pol_realtime on macOS in seconds (default 64 samples at 44.1 kHz)
+        double period,computation,constraint;
     };
 
 protected:
@@ -992,6 +1932,27 @@ protected:
     //! the system's thread id
     static thrid_t thrid;  // the system thread
 
+#ifdef FLEXT_THREADLOCAL
+    //! Cached role of the current thread
+    struct thrstate_t {
+        //! system thread (0 = not yet known, 1 = yes, -1 = no)
+        int sys;
+        //! registered, valid while gen equals thrreggen
+        bool reg;
+        long gen;
+    };
+    static FLEXT_THREADLOCAL thrstate_t thrstate;
+
+    //! changed whenever a thread is (un)registered by another one
+    static volatile long thrreggen;
+
+    //! Update the cached registration state after thread id has been (un)registered
+    static void RegChanged(thrid_t id,bool reg);
+#endif
+
+    //! Look up the current thread in the registry (and cache the result)
+    static bool LookupThreadRegistered();
+
 private:
     static bool StartHelper(); // used in flext::Setup()
 
@@ -1136,6 +2097,12 @@ public:
         */
         bool TimedWait(double ftime);
 
+        //! Wait for condition, with the mutex already locked (for checking a predicate)
+        bool WaitLocked() { return pthread_cond_wait(&cond,&this->mutex) == 0; }
+
+        //! Wait for condition (for a certain time), with the mutex already locked
+        bool TimedWaitLocked(double ftime);
+
         //! Signal condition
         bool Signal() { return pthread_cond_signal(&cond) == 0; }
 
@@ -1211,9 +2178,10 @@ public:
     /*! \brief Launch a thread.
         \param meth Thread function
         \param params Parameters to pass to the thread, may be NULL if not needed.
+        \param attr Scheduling attributes, NULL for a pool worker (or a thread one priority point below the system thread)
         \return Thread id on success, NULL on failure
     */
-    static bool LaunchThread(void (*meth)(thr_params *p),thr_params *params = NULL);
+    static bool LaunchThread(void (*meth)(thr_params *p),thr_params *params = NULL,const ThrAttr *attr = NULL);
 
     /*! \brief Terminate a thread.
         \param meth Thread function
@@ -1224,6 +2192,29 @@ public:
     */
     static bool StopThread(void (*meth)(thr_params *p),thr_params *params = NULL,bool wait = false);
 
+    /*! \brief Set the number of pre-spawned worker threads.
+        \param workers Pool size, 0 to create a new thread for every launch
+        \remark Launched threads are handed to a parked pool worker. 
+        If none is free, a dedicated thread is created as usual, so launches never queue up behind each other.
+        \note The pool is spawned with the first launch, workers exceeding a reduced size are kept.
+    */
+    static bool SetupThreadPool(int workers);
+
+    /*! \brief Apply scheduling attributes to the calling thread.
+        \return false if any of the attributes couldn't be applied (e.g. real-time policies without the permission)
+    */
+    static bool SetThreadAttr(const ThrAttr &attr);
+
+    /*! \brief Set the attributes of the threads helping with DSP
+        (ParallelFor helpers, DSP island workers, asynchronous DSP processing).
+        \remark By default, ParallelFor helpers run with the priority of the system thread, the others one point below.
+        \note Call at setup time, before SetupParallel and before DSP is switched on.
+    */
+    static void SetupDSPThreads(const ThrAttr &attr);
+
+    //! Get the attributes of DSP helper threads, NULL if none have been set
+    static const ThrAttr *GetDSPThreadAttr();
+
 
     //! \brief Register current thread to be allowed to execute flext functions.
     static void RegisterThread(thrid_t id = GetThreadId());
@@ -1281,6 +2272,30 @@ public:
     /*! \brief Get operating system time since flext startup.
     */
     static double GetOSTime();
+
+    //! Unsigned 64-bit integer for time stamps
+#ifdef _MSC_VER
+    typedef unsigned __int64 t_uint64;
+#else
+    typedef unsigned long long t_uint64;
+#endif
+
+    /*! \brief Get a monotonic time stamp in nanoseconds.
+        \remark The origin is arbitrary, only differences are meaningful.
+        \note This is cheap enough for profiling in the audio thread.
+    */
+    static t_uint64 GetTimeNs();
+
+    /*! \brief Get the CPU cycle counter (TSC on x86, virtual counter on ARM64).
+        Without such a counter this is the same as GetTimeNs.
+        \remark The TSC may not be synchronized between CPU cores on old systems.
+    */
+    static t_uint64 GetCycles();
+
+    /*! \brief Get the duration of one GetCycles count in nanoseconds.
+        \note The x86 counter is calibrated against GetTimeNs on the first call, which takes a few milliseconds.
+    */
+    static double GetCycleNs();
     
     /*! \brief Sleep for an amount of time.
         \remark The OS clock is used for that.
@@ -1290,12 +2305,28 @@ public:
 
     /*! \brief Class encapsulating a timer with callback functionality.
         This class can either be used with FLEXT_ADDTIMER or used as a base class with an overloaded virtual Work function.
+        \remark All timers share one system clock, they are kept in a hierarchical timer wheel.
+        Setting or resetting a timer takes constant time, independent of the number of timers.
     */ 
     class FLEXT_SHARE Timer:
         public flext_root
     {
     public:
-        Timer(bool queued = false);
+        /*! \param queued ... Max: call Work from the low priority queue
+            \param threaded ... call Work on a worker thread (see SetupThreadPool), so that expensive work doesn't delay messages.
+            Outlet functions called from there are queued to the system thread (see ToOutFloat etc.).
+            An event is skipped if Work of the previous one hasn't returned yet (see Overruns).
+            Setting the timer from Work then needs the system lock, taken with WorkLock.
+            Without FLEXT_THREADS Work is called in the system thread.
+        */
+        Timer(bool queued = false,bool threaded = false);
+
+        /*! \brief Destroy the timer
+            \note Waits for a threaded Work that is still running, 
+            which must not use anything that has already been destroyed (e.g. members of a derived class).
+            A Work waiting in WorkLock isn't waited for, it gets false from there.
+            Threaded Work must therefore never call Lock directly, the destructor normally runs with the system lock held.
+        */
         virtual ~Timer();
 
         //! Set timer callback function.
@@ -1316,32 +2347,180 @@ public:
 
         //! Worker function, called on every timer event.
         virtual void Work();
+
+        /*! \brief Take the system lock from Work
+            \return false if the timer is being destroyed: Work must then return right away, without touching the timer or calling WorkUnlock
+            \remark Only threaded timers lock, Work of the others runs in the system thread.
+        */
+        bool WorkLock();
+
+        //! Release the system lock taken by WorkLock
+        void WorkUnlock();
+
+        /*! \brief Intended time of the current event (in seconds, see GetTime).
+            \note Only meaningful in Work() or the callback function.
+            \remark Periodic events lie on a fixed grid from the time Periodic has been called, they don't drift.
+        */
+        double Intended() const { return intended*0.001; }
+
+        /*! \brief Actual time of the current event (in seconds, see GetTime).
+            \note Only meaningful in Work() or the callback function.
+            \remark The difference to Intended() can be used to place the event inside the next signal block.
+        */
+        double Actual() const { return fired*0.001; }
+
+#ifdef FLEXT_THREADS
+        //! Number of events skipped because threaded Work was still running
+        unsigned long Overruns() const { return overruns; }
+#endif
         
     protected:
         static void callback(Timer *tmr);
+
+#ifdef FLEXT_THREADS
+        //! Thread function of threaded timers
+        static void threadfun(thr_params *p);
+
+        /*! \brief State of a threaded timer, shared with the worker thread
+            \remark It's reference counted, so that the worker can still see it after the timer is gone.
+        */
+        struct WorkState
+        {
+            enum { idle,running,locking,orphaned };
+
+            WorkState(): params(2) {}
+
+            //! var[0] is the timer, var[1] the work state
+            thr_params params;
+            //! one of the enum above, orphaned once the timer has been destroyed while Work was in WorkLock
+            volatile long state;
+            //! timer and launched worker
+            volatile long refs;
+        };
+
+        //! Drop a reference to the work state, the last one deletes it
+        static void Release(WorkState *ws);
+
+        //! NULL for timers that aren't threaded
+        WorkState *work;
+        unsigned long overruns;
+#endif
     
-#if FLEXT_SYS == FLEXT_SYS_PD
-        t_clock *clk;
-#elif FLEXT_SYS == FLEXT_SYS_MAX
+#if FLEXT_SYS == FLEXT_SYS_MAX
         static void queuefun(Timer *tmr);
-        t_clock *clk;
         t_qelem *qelem;
-#else
+#elif FLEXT_SYS != FLEXT_SYS_PD
 #error Not implemented
 #endif
 
+        //! Link in a list of the timer wheel, lev is the wheel level (-1 for due list)
+        struct Link { Link *prev,*next; Timer *tmr; int lev; };
+
+        //! State of the timer wheel, shared by all timers
+        struct Wheel
+        {
+            enum { bits0 = 8,bitsn = 6,levels = 5,slots = (1<<bits0)+(levels-1)*(1<<bitsn) };
+
+            //! slot lists of all levels, the last one holds the timers due in the current slot (sorted)
+            Link list[slots+1];
+            //! current slot number
+            unsigned long pos;
+            //! current slot number (not wrapping), system time of slot number 0
+            double tick,base;
+            //! number of timers in level 0 and in total
+            int count0,total;
+            //! system time the clock is set to
+            double next;
+            bool armed;
+            t_clock *clk;
+        };
+
+        static Wheel wheel;
+
+        //! Put timer into the wheel, due is the absolute system time in ms
+        void Schedule(double due);
+        //! Take timer out of the wheel
+        void Unschedule();
+
+        //! Insert into the wheel, relative to the current wheel position
+        static void Place(Timer *tmr);
+        //! Move wheel position up to the current time
+        static void Advance(double now);
+        //! Set the system clock to the next event
+        static void Arm();
+        //! Callback for the system clock of the wheel
+        static void Tick(void *);
+        //! Current system time in ms
+        static double SysTime();
+
+        Link link;
+        double due;
+
         const bool queued;
         void (*cback)(void *data);
         FLEXT_TEMPINST(FLEXT_CLASSDEF(flext_base)) *clss;
         void *userdata;
         double period;
+
+        //! times of the current event (ms)
+        double intended,fired;
+        //! start time (ms) and count of periodic events
+        double pstart;
+        unsigned long pcount;
     };
 
 //!     @} FLEXT_S_TIMER
 
-    //! Check if we are in DSP time
+    /*! \brief Check if we are in DSP time
+        \remark The state is kept per thread, so that hosts may call CbSignal from several threads.
+        Without compiler support for thread-local storage (or with MSVC and a flext DLL) it's shared by all threads.
+    */
     static bool InDSP() { return indsp; }
 
+// --- tracing ----------------------------------------------------------
+
+/*! \defgroup FLEXT_S_TRACE Flext event tracing
+    \note Only available if flext is compiled with FLEXT_TRACE defined (see FLEXT_TRACE_SCOPE).
+    Events (begin and duration) are written to a ring buffer per thread without locking,
+    the oldest events are overwritten.
+    Trace points are signal processing (CbSignal), message dispatch (CbMethodHandler),
+    queue passes, waits for the system lock and thread functions.
+        @{
+*/
+#ifdef FLEXT_TRACE
+    /*! \brief Record a complete event
+        \param cat category (string constant)
+        \param name event name (string constant or symbol name)
+        \param obj object name (string constant or symbol name) or NULL
+        \param start begin time (see GetTimeNs)
+        \param end end time (see GetTimeNs)
+    */
+    static void TraceEvent(const char *cat,const char *name,const char *obj,t_uint64 start,t_uint64 end);
+
+    //! Name the current thread in the trace (string constant)
+    static void TraceThread(const char *name);
+
+    /*! \brief Write the recorded events of all threads to a file in Chrome trace event format (JSON)
+        \note The file can be opened with chrome://tracing or ui.perfetto.dev
+        \return false if the file could not be written
+    */
+    static bool TraceDump(const char *filename);
+
+    //! Event lasting for the lifetime of the object
+    class TraceScope
+    {
+    public:
+        TraceScope(const char *c,const char *n,const char *o = NULL): cat(c),name(n),obj(o),start(GetTimeNs()) {}
+        ~TraceScope() { TraceEvent(cat,name,obj,start,GetTimeNs()); }
+
+    private:
+        const char *cat,*name,*obj;
+        t_uint64 start;
+    };
+#endif
+
+//!     @} FLEXT_S_TRACE
+
 // --- SIMD functionality -----------------------------------------------
 
 /*! \defgroup FLEXT_S_SIMD Cross platform SIMD support for modern CPUs 
@@ -1353,24 +2532,184 @@ public:
             simd_3dnow = 0x02,
             simd_sse = 0x04,
             simd_sse2 = 0x08,
-            simd_altivec = 0x10
+            simd_altivec = 0x10,
+            simd_avx = 0x20,
+            simd_avx2 = 0x40,
+            simd_avx512 = 0x80, //!< AVX-512 Foundation
+            simd_neon = 0x100
         };
         
         /*! Check for SIMD capabilities of the CPU */
         static unsigned long GetSIMDCapabilities();
 
 
-        static void MulSamples(t_sample *dst,const t_sample *src,t_sample mul,int cnt);
-        static void MulSamples(t_sample *dst,const t_sample *src,const t_sample *mul,int cnt);
-        static void AddSamples(t_sample *dst,const t_sample *src,t_sample add,int cnt);
-        static void AddSamples(t_sample *dst,const t_sample *src,const t_sample *add,int cnt);
-        static void ScaleSamples(t_sample *dst,const t_sample *src,t_sample mul,t_sample add,int cnt);
-        static void ScaleSamples(t_sample *dst,const t_sample *src,t_sample mul,const t_sample *add,int cnt);
-        static void ScaleSamples(t_sample *dst,const t_sample *src,const t_sample *mul,const t_sample *add,int cnt);
+        /*! \brief Table of the sample functions
+            It's filled with the best variants for the CPU by flext::Setup.
+        */
+        struct simd_kernels {
+            typedef void (*copy_t)(t_sample *dst,const t_sample *src,int cnt);
+            typedef void (*set_t)(t_sample *dst,int cnt,t_sample s);
+            typedef void (*op_t)(t_sample *dst,const t_sample *src,t_sample op,int cnt);
+            typedef void (*opv_t)(t_sample *dst,const t_sample *src,const t_sample *op,int cnt);
+            typedef void (*scale_t)(t_sample *dst,const t_sample *src,t_sample mul,t_sample add,int cnt);
+            typedef void (*scalev_t)(t_sample *dst,const t_sample *src,t_sample mul,const t_sample *add,int cnt);
+            typedef void (*scalevv_t)(t_sample *dst,const t_sample *src,const t_sample *mul,const t_sample *add,int cnt);
+            typedef t_sample (*dot_t)(const t_sample *a,const t_sample *b,int cnt);
+            typedef void (*minmax_t)(const t_sample *src,int cnt,t_sample &mn,t_sample &mx);
+            typedef void (*interleave_t)(t_sample *dst,const t_sample *src,int ch,int chns,int cnt);
+            typedef void (*ramp_t)(t_sample *dst,t_sample start,t_sample inc,int cnt);
+            typedef void (*narrow_t)(float *dst,const double *src,int cnt);
+            typedef void (*widen_t)(double *dst,const float *src,int cnt);
+
+            copy_t copy;
+            set_t set;
+            op_t mul;
+            opv_t mulv;
+            op_t add;
+            opv_t addv;
+            scale_t scale;
+            scalev_t scalev;
+            scalevv_t scalevv;
+            op_t mac;
+            opv_t macv;
+            dot_t dot;
+            scale_t clip;
+            minmax_t minmax;
+            scale_t rampmul;
+            ramp_t ramp;
+            interleave_t deinterleave;
+            interleave_t interleave;
+            narrow_t narrow;
+            widen_t widen;
+        };
+
+        //! Get the sample functions in use
+        static const simd_kernels &GetSIMDKernels() { return kernels; }
+
+        /*! \brief Replace the sample functions (e.g. for testing)
+            \param k ... new table, NULL selects the best functions for the CPU
+            \note Don't call this while DSP is running
+        */
+        static void SetSIMDKernels(const simd_kernels *k = NULL);
+
+        static void MulSamples(t_sample *dst,const t_sample *src,t_sample mul,int cnt) { kernels.mul(dst,src,mul,cnt); }
+        static void MulSamples(t_sample *dst,const t_sample *src,const t_sample *mul,int cnt) { kernels.mulv(dst,src,mul,cnt); }
+        static void AddSamples(t_sample *dst,const t_sample *src,t_sample add,int cnt) { kernels.add(dst,src,add,cnt); }
+        static void AddSamples(t_sample *dst,const t_sample *src,const t_sample *add,int cnt) { kernels.addv(dst,src,add,cnt); }
+        static void ScaleSamples(t_sample *dst,const t_sample *src,t_sample mul,t_sample add,int cnt) { kernels.scale(dst,src,mul,add,cnt); }
+        static void ScaleSamples(t_sample *dst,const t_sample *src,t_sample mul,const t_sample *add,int cnt) { kernels.scalev(dst,src,mul,add,cnt); }
+        static void ScaleSamples(t_sample *dst,const t_sample *src,const t_sample *mul,const t_sample *add,int cnt) { kernels.scalevv(dst,src,mul,add,cnt); }
+
+        //! Multiply and accumulate: dst += src*mul
+        static void MacSamples(t_sample *dst,const t_sample *src,t_sample mul,int cnt) { kernels.mac(dst,src,mul,cnt); }
+        //! Multiply and accumulate: dst += src*mul
+        static void MacSamples(t_sample *dst,const t_sample *src,const t_sample *mul,int cnt) { kernels.macv(dst,src,mul,cnt); }
+        //! Dot product of two sample arrays
+        static t_sample DotSamples(const t_sample *a,const t_sample *b,int cnt) { return kernels.dot(a,b,cnt); }
+        //! Clip samples to the range [lo,hi]
+        static void ClipSamples(t_sample *dst,const t_sample *src,t_sample lo,t_sample hi,int cnt) { kernels.clip(dst,src,lo,hi,cnt); }
+        //! Get minimum and maximum of a sample array (both are 0 for an empty one)
+        static void MinMaxSamples(const t_sample *src,int cnt,t_sample &mn,t_sample &mx) { kernels.minmax(src,cnt,mn,mx); }
+        //! Multiply with a linear gain ramp: dst[i] = src[i]*(start+i*inc)
+        static void RampMulSamples(t_sample *dst,const t_sample *src,t_sample start,t_sample inc,int cnt) { kernels.rampmul(dst,src,start,inc,cnt); }
+        //! Fill with a linear ramp: dst[i] = start+i*inc
+        static void RampSamples(t_sample *dst,t_sample start,t_sample inc,int cnt) { kernels.ramp(dst,start,inc,cnt); }
+        //! Get channel ch of cnt interleaved frames: dst[i] = src[i*chns+ch] (vectorized for 2 and 4 channels)
+        static void DeinterleaveSamples(t_sample *dst,const t_sample *src,int ch,int chns,int cnt) { kernels.deinterleave(dst,src,ch,chns,cnt); }
+        //! Set channel ch of cnt interleaved frames: dst[i*chns+ch] = src[i] (vectorized for 2 and 4 channels)
+        static void InterleaveSamples(t_sample *dst,const t_sample *src,int ch,int chns,int cnt) { kernels.interleave(dst,src,ch,chns,cnt); }
+
+        /*! \brief Read from a table with linear interpolation
+            \param table ... table data, frames samples long
+            \param pos ... read positions in samples, clipped to the table range
+        */
+        static void InterpReadSamples(t_sample *dst,const t_sample *table,int frames,const t_sample *pos,int cnt);
+
+        /*! \brief Destination of a fused sample expression
+            e.g. Samples(out,n) = (Samples(in0)*gain+Samples(in1))*mix;
+            computes the expression in one pass, see flsamples.h
+        */
+        static SampleDst Samples(t_sample *dst,int cnt) { return SampleDst(dst,cnt); }
+        //! Sample array as the operand of a fused sample expression
+        static SampleSrc Samples(const t_sample *src) { return SampleSrc(src); }
 
 //!     @} FLEXT_S_SIMD
 
-        
+// --- FFT --------------------------------------------------------------
+
+/*! \defgroup FLEXT_S_FFT Fast Fourier transform
+        @{
+*/
+    /*! \brief Plan for fast Fourier transforms of one size (see GetFFT)
+        Complex data is interleaved (re,im). The transforms are unnormalized,
+        an inverse transform after a forward transform scales by the size.
+        Sizes with factors 2, 3, 4 and 5 are fastest, other prime factors take O(n*p) operations.
+    */
+    class FLEXT_SHARE FFT:
+        public flext_root
+    {
+    public:
+        //! returns the size (complex values, or real samples for a real transform)
+        int Size() const { return n; }
+
+        //! returns true for a plan of real transforms
+        bool IsReal() const { return real; }
+
+        //! returns the number of samples of scratch memory a transform needs
+        int ScratchSize() const { return 2*n; }
+
+        /*! \brief Complex transform
+            \param dst ... Size() complex values, may be the same as src
+            \param scratch ... ScratchSize() samples, e.g. from flext_dsp::Scratch
+        */
+        void Complex(t_sample *dst,const t_sample *src,t_sample *scratch,bool inverse = false) const;
+
+        /*! \brief Real forward transform
+            \param src ... Size() samples
+            \param dst ... Size()/2+1 complex values (Size()+2 samples), may be the same as src if large enough
+            \param scratch ... ScratchSize() samples
+        */
+        void Forward(t_sample *dst,const t_sample *src,t_sample *scratch) const;
+
+        /*! \brief Real inverse transform
+            \param src ... Size()/2+1 complex values
+            \param dst ... Size() samples, may be the same as src
+            \param scratch ... ScratchSize() samples
+        */
+        void Inverse(t_sample *dst,const t_sample *src,t_sample *scratch) const;
+
+    protected:
+        FFT(int n,bool real);
+        ~FFT();
+
+        friend class FLEXT_CLASSDEF(flext);
+
+        void Stages(t_sample *dst,const t_sample *src,t_sample *scratch,bool inverse) const;
+
+        int n;
+        bool real;
+        //! radices of the stages
+        int stages,radix[32];
+        //! twiddle factors (complex) of the stages, offsets into twiddle
+        t_sample *twiddle;
+        int offset[32];
+        //! complex plan of half the size (real transforms)
+        const FFT *half;
+        //! next plan in the cache
+        FFT *nxt;
+    };
+
+    /*! \brief Get the plan for transforms of size n
+        \param real ... plan for real transforms, n must be even
+        \return plan, NULL for an invalid size
+        \note Plans are shared process-wide and never freed. The first request for a size allocates,
+        so get the plan in the constructor or CbDsp, not in CbSignal.
+    */
+    static const FFT *GetFFT(int n,bool real = false);
+
+//!     @} FLEXT_S_FFT
+
+
 //!     @} FLEXT_SUPPORT
 
 protected:
@@ -1383,6 +2722,29 @@ protected:
     static bool chktilde(const char *objname);
 
     static unsigned long simdcaps;
+    static simd_kernels kernels;
+
+    // portable implementations of the sample functions (IPP, SSE, Altivec or plain C)
+    static void CopySamplesGeneric(t_sample *dst,const t_sample *src,int cnt);
+    static void SetSamplesGeneric(t_sample *dst,int cnt,t_sample s);
+    static void MulSamplesGeneric(t_sample *dst,const t_sample *src,t_sample mul,int cnt);
+    static void MulSamplesGeneric(t_sample *dst,const t_sample *src,const t_sample *mul,int cnt);
+    static void AddSamplesGeneric(t_sample *dst,const t_sample *src,t_sample add,int cnt);
+    static void AddSamplesGeneric(t_sample *dst,const t_sample *src,const t_sample *add,int cnt);
+    static void ScaleSamplesGeneric(t_sample *dst,const t_sample *src,t_sample mul,t_sample add,int cnt);
+    static void ScaleSamplesGeneric(t_sample *dst,const t_sample *src,t_sample mul,const t_sample *add,int cnt);
+    static void ScaleSamplesGeneric(t_sample *dst,const t_sample *src,const t_sample *mul,const t_sample *add,int cnt);
+    static void MacSamplesGeneric(t_sample *dst,const t_sample *src,t_sample mul,int cnt);
+    static void MacSamplesGeneric(t_sample *dst,const t_sample *src,const t_sample *mul,int cnt);
+    static t_sample DotSamplesGeneric(const t_sample *a,const t_sample *b,int cnt);
+    static void ClipSamplesGeneric(t_sample *dst,const t_sample *src,t_sample lo,t_sample hi,int cnt);
+    static void MinMaxSamplesGeneric(const t_sample *src,int cnt,t_sample &mn,t_sample &mx);
+    static void RampMulSamplesGeneric(t_sample *dst,const t_sample *src,t_sample start,t_sample inc,int cnt);
+    static void RampSamplesGeneric(t_sample *dst,t_sample start,t_sample inc,int cnt);
+    static void DeinterleaveSamplesGeneric(t_sample *dst,const t_sample *src,int ch,int chns,int cnt);
+    static void InterleaveSamplesGeneric(t_sample *dst,const t_sample *src,int ch,int chns,int cnt);
+    static void NarrowSamplesGeneric(float *dst,const double *src,int cnt);
+    static void WidenSamplesGeneric(double *dst,const float *src,int cnt);
 
     static const t_symbol *sym_attributes;
     static const t_symbol *sym_methods;
@@ -1394,7 +2756,11 @@ protected:
 #endif
 
     //! flag if we are within DSP
+#ifdef FLEXT_THREADLOCAL
+    static FLEXT_THREADLOCAL bool indsp;
+#else
     static bool indsp;
+#endif
 };
 
 
@@ -1406,6 +2772,13 @@ inline bool operator <=(const t_atom &a,const t_atom &b) { return flext::CmpAtom
 inline bool operator >(const t_atom &a,const t_atom &b) { return flext::CmpAtom(a,b) > 0; }
 inline bool operator >=(const t_atom &a,const t_atom &b) { return flext::CmpAtom(a,b) >= 0; }
 
+//! Trace the rest of the enclosing block (see FLEXT_S_TRACE), nothing without FLEXT_TRACE
+#ifdef FLEXT_TRACE
+#define FLEXT_TRACE_SCOPE(CAT,NAME,OBJ) flext::TraceScope flext_tracescope_(CAT,NAME,OBJ)
+#else
+#define FLEXT_TRACE_SCOPE(CAT,NAME,OBJ) ((void)0)
+#endif
+
 //! @} // FLEXT_SUPPORT
 
 #include "flpopns.h"
@@ -20,10 +20,15 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 // maximum wait time for threads to finish (in ms)
 #define MAXIMUMWAIT 100
 
+#ifndef FLEXT_THRPOOL
+//! Default number of pre-spawned worker threads (0 to create a thread per launch)
+#define FLEXT_THRPOOL 4
+#endif
+
 
 #include "flinternal.h"
 #include "flcontainers.h"
-#include <set>
+#include "lockfree/atomic_int.hpp"
 #include <ctime>
 
 #if FLEXT_OSAPI == FLEXT_OSAPI_MAC_MACH || FLEXT_OSAPI == FLEXT_OSAPI_UNIX_POSIX || FLEXT_OSAPI == FLEXT_OSAPI_WIN_POSIX
@@ -33,21 +38,35 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 #include <sys/timeb.h>
 #endif
 
+#if FLEXT_THREADS == FLEXT_THR_POSIX && FLEXT_OSAPI == FLEXT_OSAPI_MAC_MACH
+#include <mach/mach.h>
+#include <mach/mach_time.h>
+#include <mach/thread_policy.h>
+#endif
+
 #if FLEXT_THREADS == FLEXT_THR_WIN32 && WINVER < 0x0500
 #error WIN32 threads need Windows SDK version >= 0x500
 #endif
 
 #include <cerrno>
+#include <cstring>
 
 #include "flpushns.h"
 
 //! Thread id of system thread - will be initialized in flext::Setup
 FLEXT_TEMPIMPL(FLEXT_TEMPINST(FLEXT_CLASSDEF(flext))::thrid_t FLEXT_CLASSDEF(flext))::thrid;
 
+#ifdef FLEXT_THREADLOCAL
+FLEXT_TEMPIMPL(FLEXT_THREADLOCAL FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext))::thrstate_t FLEXT_CLASSDEF(flext))::thrstate = { 0,false,0 };
+FLEXT_TEMPIMPL(volatile long FLEXT_CLASSDEF(flext))::thrreggen = 1;
+#endif
+
 //! Thread id of helper thread - will be initialized in flext::Setup
 FLEXT_TEMPIMPL(FLEXT_TEMPINST(FLEXT_CLASSDEF(flext))::thrid_t FLEXT_CLASSDEF(flext))::thrhelpid;
 
 
+struct ThrStopWait;
+
 //! \brief This represents an entry to the list of active method threads
 class thr_entry
     : public flext
@@ -59,6 +78,11 @@ public:
         th = p?p->cl:NULL;
         meth = m,params = p,thrid = id;
         shouldexit = false;
+        pooled = false;
+        hasattr = false;
+        bound = false;
+        idnext = mpnext = obnext = NULL;
+        waiter = NULL;
 #if FLEXT_THREADS == FLEXT_THR_MP
 	    weight = 100; // MP default weight
 #endif
@@ -74,91 +98,560 @@ public:
 	void (*meth)(thr_params *);
 	thr_params *params;
 	thrid_t thrid;
-	bool shouldexit;
+	//! set by StopThread, the running thread sees it through its ThrToken
+	volatile bool shouldexit;
+	bool pooled; //!< running on a pool worker
+	bool hasattr; //!< runs on a dedicated thread with attr
+	bool bound; //!< thrid is known and indexed
+	ThrAttr attr;
 #if FLEXT_THREADS == FLEXT_THR_MP
 	int weight;
 #endif
+
+	//! chains of the registry index (by thread id, by method parameters, by object)
+	thr_entry *idnext,*mpnext,*obnext;
+	//! StopThread(s) call waiting for the entry to be released
+	ThrStopWait *waiter;
+};
+
+/*! \brief Completion of a StopThread(s) call
+    \remark count is only changed with the registry locked.
+*/
+struct ThrStopWait
+{
+    ThrStopWait(): count(0) {}
+
+    flext::ThrCond cond;
+    //! stopped entries not yet released
+    volatile int count;
 };
 
+//! Lock-free queue of thread entries, owning the entries left on destruction
 template<class T>
-class ThrFinder:
+class ThrQueue:
     public T
 {
 public:
-    ~ThrFinder() { thr_entry *e; while((e = Pop()) != NULL) delete e; }
+    ~ThrQueue() { thr_entry *e; while((e = Pop()) != NULL) delete e; }
 
     void Push(thr_entry *e) { T::Push(e); }
     thr_entry *Pop() { return T::Pop(); }
-
-    thr_entry *Find(flext::thrid_t id,bool pop = false) 
-    {
-        TypedLifo<thr_entry> qutmp;
-        thr_entry *fnd;
-        while((fnd = Pop()) && !fnd->Is(id)) qutmp.Push(fnd);
-        // put back entries
-        for(thr_entry *ti; (ti = qutmp.Pop()) != NULL; ) Push(ti);
-        if(fnd && !pop) Push(fnd);
-        return fnd;
-    }
 };
 
+#ifndef FLEXT_ALLOCCACHE
+//! \brief Thread parameters as recycled by flext::thr_params::New/Free
+class thr_paramscell
+    : public flext::thr_params
+    , public LifoCell
+{};
+#endif
+
 FLEXT_TEMPLATE
 struct ThrRegistry
 {
-    typedef ThrFinder< PooledLifo<thr_entry,1,10> > RegPooledLifo;
-    typedef ThrFinder< TypedLifo<thr_entry> > RegFinder;
+    typedef ThrQueue< PooledLifo<thr_entry,1,10> > RegPooledLifo;
     static RegPooledLifo pending;
-    static RegFinder active,stopped;
+#ifndef FLEXT_ALLOCCACHE
+    //! spare parameters of threaded method calls
+    typedef PooledLifo<thr_paramscell,0,64> ParamsPool;
+    static ParamsPool params;
+#endif
 };
 
 FLEXT_TEMPIMPL(FLEXT_TEMPINST(ThrRegistry)::RegPooledLifo ThrRegistry)::pending;
-FLEXT_TEMPIMPL(FLEXT_TEMPINST(ThrRegistry)::RegFinder ThrRegistry)::active;
-FLEXT_TEMPIMPL(FLEXT_TEMPINST(ThrRegistry)::RegFinder ThrRegistry)::stopped;
 
+/*! \remark With the thread-caching allocator, new and delete are faster than a lock-free pool.
+    Otherwise, operator new takes the system lock, which the pool avoids.
+*/
+#ifdef FLEXT_ALLOCCACHE
+FLEXT_TEMPIMPL(FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext))::thr_params *FLEXT_CLASSDEF(flext))::thr_params::New(int n) { return new thr_params(n); }
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::thr_params::Free(thr_params *p) { delete p; }
+#else
+FLEXT_TEMPIMPL(FLEXT_TEMPINST(ThrRegistry)::ParamsPool ThrRegistry)::params;
 
-class ThrId
-	: public flext
+FLEXT_TEMPIMPL(FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext))::thr_params *FLEXT_CLASSDEF(flext))::thr_params::New(int n)
+{
+    thr_params *p = FLEXT_TEMPINST(ThrRegistry)::params.New();
+    p->cl = NULL;
+    if(UNLIKELY(n > inlcnt)) p->var = new _data[n];
+    return p;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::thr_params::Free(thr_params *p)
+{
+    if(p->var != p->inl) {
+        delete[] p->var;
+        p->var = p->inl;
+    }
+    FLEXT_TEMPINST(ThrRegistry)::params.Free(static_cast<thr_paramscell *>(p));
+}
+#endif
+
+
+#ifndef FLEXT_THRREGSIZE
+//! Number of slots in the thread registry (must be a power of 2)
+#define FLEXT_THRREGSIZE 256
+#endif
+
+/*! \brief Lock-free set of registered thread ids
+    \remark Open addressing with linear probing over a fixed table.
+    Removed slots are marked, so that probe chains stay intact, and become empty again once no chain runs through them.
+    Lookup never waits and touches at most FLEXT_THRREGSIZE slots (usually one or two).
+    \note Insert and Remove are serialized by a spin lock, registration is rare.
+*/
+class ThrRegTable
+    : public flext
 {
 public:
-	ThrId(const thrid_t &_id): id(_id) {}
-	thrid_t id;
-
-	bool operator <(const ThrId &tid) const 
-	{ 
-		if(sizeof(id) == sizeof(unsigned))
-			return (unsigned *)&id < (unsigned *)&tid;
-		else
-			return memcmp(&id,&tid,sizeof(id)) < 0;
-	}
+    enum { size = FLEXT_THRREGSIZE, mask = size-1 };
+    enum { slot_empty = 0, slot_busy, slot_used, slot_removed };
+
+    bool Insert(thrid_t id)
+    {
+        WriteLock();
+        bool ok = Find(id) >= 0;
+        const int h = Hash(id);
+        for(int i = 0; !ok && i < size; ++i) {
+            Slot &sl = slots[(h+i)&mask];
+            if(sl.state == slot_empty || sl.state == slot_removed) {
+                sl.state = slot_busy;
+                lockfree::memory_barrier();
+                sl.id = id;
+                lockfree::memory_barrier();
+                sl.state = slot_used;
+                ok = true;
+            }
+        }
+        WriteUnlock();
+        return ok;
+    }
+
+    bool Remove(thrid_t id)
+    {
+        WriteLock();
+        const int ix = Find(id);
+        if(ix >= 0) {
+            slots[ix].state = slot_removed;
+            // followed by an empty slot, no chain runs through the removed slots before
+            if(slots[(ix+1)&mask].state == slot_empty)
+                for(int i = ix; slots[i].state == slot_removed; i = (i-1)&mask) 
+                    slots[i].state = slot_empty;
+        }
+        WriteUnlock();
+        return ix >= 0;
+    }
+
+    int Find(thrid_t id) const
+    {
+        const int h = Hash(id);
+        for(int i = 0; i < size; ++i) {
+            const int ix = (h+i)&mask;
+            const Slot &sl = slots[ix];
+            long st = sl.state;
+            if(st == slot_empty) break;
+            if(st == slot_used) {
+                lockfree::memory_barrier();
+                if(IsThread(sl.id,id)) return ix;
+            }
+        }
+        return -1;
+    }
+
+    static int Hash(const thrid_t &id)
+    {
+        // fold the bytes of the (possibly opaque) id
+        const unsigned char *b = (const unsigned char *)&id;
+        unsigned long h = 0;
+        for(size_t i = 0; i < sizeof(id); ++i) h = h*31+b[i];
+        return (int)((h^(h>>7)^(h>>15))&mask);
+    }
+
+protected:
+    struct Slot {
+        volatile long state;
+        thrid_t id;
+    };
+
+    void WriteLock() { while(!lockfree::CAS(&wlock,0L,1L)) ThrYield(); }
+    void WriteUnlock() { lockfree::memory_barrier(); wlock = 0; }
+
+    // zero-initialized as a static object, i.e. all slots are empty
+    Slot slots[size];
+    volatile long wlock;
+};
+
+/*! \brief Index of started thread entries
+    \remark Chained hash tables by thread id, by method parameters and by object, 
+    so that StopThread, StopThreads and PopThread only visit the entries in question.
+    Entries are indexed by method and object when they are started and by thread id 
+    as soon as the id is known (see Bind).
+    \note Not thread-safe, all functions must be called with ThrVars::thrregmutex locked.
+*/
+class ThrIndex
+    : public flext
+{
+public:
+    enum { size = ThrRegTable::size, mask = size-1 };
+
+    void Add(thr_entry *e)
+    {
+        thr_entry *&mp = ids_mp[Hash(e->params)];
+        e->mpnext = mp; mp = e;
+        thr_entry *&ob = ids_ob[Hash(e->This())];
+        e->obnext = ob; ob = e;
+    }
+
+    void Bind(thr_entry *e,thrid_t id)
+    {
+        e->thrid = id;
+        thr_entry *&t = ids_th[ThrRegTable::Hash(id)];
+        e->idnext = t; t = e;
+        e->bound = true;
+    }
+
+    void Remove(thr_entry *e)
+    {
+        thr_entry **t;
+        for(t = &ids_mp[Hash(e->params)]; *t != e; t = &(*t)->mpnext) {}
+        *t = e->mpnext;
+        for(t = &ids_ob[Hash(e->This())]; *t != e; t = &(*t)->obnext) {}
+        *t = e->obnext;
+        if(e->bound) {
+            for(t = &ids_th[ThrRegTable::Hash(e->thrid)]; *t != e; t = &(*t)->idnext) {}
+            *t = e->idnext;
+            e->bound = false;
+        }
+    }
+
+    thr_entry *Find(thrid_t id) const
+    {
+        thr_entry *e = ids_th[ThrRegTable::Hash(id)];
+        while(e && !e->Is(id)) e = e->idnext;
+        return e;
+    }
+
+    //! Chain containing the entries with the given parameters (follow mpnext)
+    thr_entry *Methods(const thr_params *p) const { return ids_mp[Hash(p)]; }
+
+    //! Chain containing the entries of the given object (follow obnext)
+    thr_entry *Objects(const void *th) const { return ids_ob[Hash(th)]; }
+
+protected:
+    static int Hash(const void *p)
+    {
+        size_t h = (size_t)p;
+        h ^= h>>4; // allocations are aligned
+        return (int)((h^(h>>9)^(h>>17))&mask);
+    }
+
+    // zero-initialized as a static object
+    thr_entry *ids_th[size],*ids_mp[size],*ids_ob[size];
 };
 
 FLEXT_TEMPLATE
 struct ThrVars {
-    // this should _definitely_ be a hashmap....
-    // \TODO above all it should be populated immediately, otherwise it could easily happen 
-    // that the passing on to the set happens too late! We need that lockfree set!
-    static std::set<ThrId> regthreads;
+    //! Registered threads
+    static ThrRegTable regthreads;
 
-    //! Registry lock
-    static flext::ThrMutex *thrregmtx;
+    //! Started thread entries and their lock
+    static ThrIndex threads;
+    static flext::ThrMutex *thrregmutex;
 
     //! Helper thread conditional
     static flext::ThrCond *thrhelpcond;
 
+    //! Worker pool conditional
+    static flext::ThrCond *thrpoolcond;
+    //! Configured and actual number of pool workers
+    static int poolsize;
+    static lockfree::atomic_int<int> poolcnt;
+    //! Parked workers which can be claimed, and wakeups granted to them
+    static lockfree::atomic_int<int> poolidle,poolwake;
+
+    //! Attributes of DSP helper threads (see flext::SetupDSPThreads)
+    static flext::ThrAttr dspattr;
+    static bool hasdspattr;
+
     static bool initialized;
 };
 
-FLEXT_TEMPIMPL(std::set<ThrId> ThrVars)::regthreads;
-FLEXT_TEMPIMPL(flext::ThrMutex *ThrVars)::thrregmtx = NULL;
+FLEXT_TEMPIMPL(ThrRegTable ThrVars)::regthreads;
+FLEXT_TEMPIMPL(ThrIndex ThrVars)::threads;
+FLEXT_TEMPIMPL(flext::ThrMutex *ThrVars)::thrregmutex = NULL;
 FLEXT_TEMPIMPL(flext::ThrCond *ThrVars)::thrhelpcond = NULL;
+FLEXT_TEMPIMPL(flext::ThrCond *ThrVars)::thrpoolcond = NULL;
+FLEXT_TEMPIMPL(int ThrVars)::poolsize = FLEXT_THRPOOL;
+FLEXT_TEMPIMPL(lockfree::atomic_int<int> ThrVars)::poolcnt;
+FLEXT_TEMPIMPL(lockfree::atomic_int<int> ThrVars)::poolidle;
+FLEXT_TEMPIMPL(lockfree::atomic_int<int> ThrVars)::poolwake;
+FLEXT_TEMPIMPL(flext::ThrAttr ThrVars)::dspattr;
+FLEXT_TEMPIMPL(bool ThrVars)::hasdspattr = false;
 FLEXT_TEMPIMPL(bool ThrVars)::initialized = false;
 
+#if FLEXT_THREADS == FLEXT_THR_POSIX || FLEXT_THREADS == FLEXT_THR_WIN32
+#define FLEXT_THRTOKEN
+
+/*! \brief Cancellation token of the current thread
+    Points to the shouldexit flag of the entry while its method is running,
+    so that ShouldExit needn't look up the thread.
+*/
+FLEXT_TEMPLATE
+struct ThrToken
+{
+#if FLEXT_THREADS == FLEXT_THR_POSIX
+    static inline const volatile bool *Get()
+    {
+        pthread_once(&once,Init);
+        return (const volatile bool *)pthread_getspecific(key);
+    }
+
+    static inline void Set(const volatile bool *t)
+    {
+        pthread_once(&once,Init);
+        pthread_setspecific(key,(const void *)t);
+    }
+
+    static void Init() { pthread_key_create(&key,NULL); }
+
+    static pthread_once_t once;
+    static pthread_key_t key;
+#else
+    static inline const volatile bool *Get()
+    {
+        Init();
+        return (const volatile bool *)TlsGetValue(key);
+    }
+
+    static inline void Set(const volatile bool *t)
+    {
+        Init();
+        TlsSetValue(key,(LPVOID)t);
+    }
+
+    static inline void Init()
+    {
+        if(UNLIKELY(initstate != 2)) {
+            if(lockfree::CAS(&initstate,0L,1L)) {
+                key = TlsAlloc();
+                lockfree::memory_barrier();
+                initstate = 2;
+            }
+            else
+                while(initstate != 2) Sleep(0);
+        }
+    }
+
+    static volatile long initstate;
+    static DWORD key;
+#endif
+};
+
+#if FLEXT_THREADS == FLEXT_THR_POSIX
+FLEXT_TEMPIMPL(pthread_once_t ThrToken)::once = PTHREAD_ONCE_INIT;
+FLEXT_TEMPIMPL(pthread_key_t ThrToken)::key;
+#else
+FLEXT_TEMPIMPL(volatile long ThrToken)::initstate = 0;
+FLEXT_TEMPIMPL(DWORD ThrToken)::key;
+#endif
+#endif
+
+/*! \brief Run the method of a thread entry in the current thread
+    \param id the id of the current thread, the entry may be freed by the method (see PopThread)
+*/
+FLEXT_TEMPLATE void RunEntry(thr_entry *e,flext::thrid_t id)
+{
+    flext::RegisterThread(id);
+#ifdef FLEXT_THRTOKEN
+    FLEXT_TEMPINST(ThrToken)::Set(&e->shouldexit);
+#endif
+#ifdef FLEXT_TRACE
+    flext::TraceThread("flext worker");
+#endif
+    {
+        FLEXT_TRACE_SCOPE("thread","run",NULL);
+        e->meth(e->params);
+    }
+#ifdef FLEXT_THRTOKEN
+    FLEXT_TEMPINST(ThrToken)::Set(NULL);
+#endif
+    flext::UnregisterThread(id);
+}
+
+/*! \brief Take an entry out of the index and notify a StopThread(s) call waiting for it
+    \note ThrVars::thrregmutex must be locked
+*/
+FLEXT_TEMPLATE void UnlinkEntry(thr_entry *e)
+{
+    FLEXT_TEMPINST(ThrVars)::threads.Remove(e);
+
+    ThrStopWait *w = e->waiter;
+    if(w) {
+#if FLEXT_THREADS == FLEXT_THR_POSIX
+        w->cond.Lock();
+        --w->count;
+        w->cond.Signal();
+        w->cond.Unlock();
+#else
+        --w->count;
+        w->cond.Signal();
+#endif
+    }
+}
+
+/*! \brief Take the entry of a thread out of the registry
+    \return the entry, to be freed by the caller, or NULL if it has already been released
+*/
+FLEXT_TEMPLATE thr_entry *ReleaseEntry(flext::thrid_t id)
+{
+    flext::ThrMutex *mtx = FLEXT_TEMPINST(ThrVars)::thrregmutex;
+    mtx->Lock();
+    thr_entry *e = FLEXT_TEMPINST(ThrVars)::threads.Find(id);
+    if(e) FLEXT_TEMPINST(UnlinkEntry)(e);
+    mtx->Unlock();
+    return e;
+}
+
 FLEXT_TEMPLATE void LaunchHelper(thr_entry *e)
 {
-    e->thrid = flext::GetThreadId();
-    flext::RegisterThread(e->thrid);
-    e->meth(e->params);
-    flext::UnregisterThread(e->thrid);
+    const flext::thrid_t id = flext::GetThreadId();
+    flext::ThrMutex *mtx = FLEXT_TEMPINST(ThrVars)::thrregmutex;
+    mtx->Lock();
+    FLEXT_TEMPINST(ThrVars)::threads.Bind(e,id);
+    mtx->Unlock();
+
+    if(e->hasattr) flext::SetThreadAttr(e->attr);
+
+    FLEXT_TEMPINST(RunEntry)(e,id);
+
+    // the entry is normally released by PopThread, but the method needn't call it
+    thr_entry *fnd = FLEXT_TEMPINST(ReleaseEntry)(id);
+    if(fnd) FLEXT_TEMPINST(ThrRegistry)::pending.Free(fnd);
+
+    // hand back the reclamation record of the lock-free containers
+    lockfree::fifo_hazards::detach();
+}
+
+//! Create a detached thread
+FLEXT_TEMPLATE bool SpawnThread(void (*fun)(void *),void *arg)
+{
+#if FLEXT_THREADS == FLEXT_THR_POSIX
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr,PTHREAD_CREATE_DETACHED);
+    flext::thrid_t dummy;
+    bool ok = pthread_create(&dummy,&attr,(void *(*)(void *))fun,arg) == 0;
+	pthread_attr_destroy(&attr);
+    return ok;
+#elif FLEXT_THREADS == FLEXT_THR_MP
+    flext::thrid_t dummy;
+    return MPCreateTask((TaskProc)fun,arg,0,0,0,0,0,&dummy) == noErr;
+#elif FLEXT_THREADS == FLEXT_THR_WIN32
+    return _beginthread(fun,0,arg) >= 0;
+#else
+#error
+#endif
+}
+
+//! Start a thread of its own for a pending entry
+FLEXT_TEMPLATE void StartDedicated(thr_entry *e)
+{
+    // index before the thread runs, it may end (and release the entry) immediately
+    FLEXT_TEMPINST(ThrVars)::thrregmutex->Lock();
+    FLEXT_TEMPINST(ThrVars)::threads.Add(e);
+    FLEXT_TEMPINST(ThrVars)::thrregmutex->Unlock();
+
+    if(!FLEXT_TEMPINST(SpawnThread)((void (*)(void *))FLEXT_TEMPINST(LaunchHelper),e)) { 
+        error("flext - Could not launch thread!");
+        FLEXT_TEMPINST(ThrVars)::thrregmutex->Lock();
+        FLEXT_TEMPINST(UnlinkEntry)(e);
+        FLEXT_TEMPINST(ThrVars)::thrregmutex->Unlock();
+        FLEXT_TEMPINST(ThrRegistry)::pending.Free(e);
+    }
+}
+
+/*! \brief Try to reserve a parked pool worker
+    \remark Every successful claim must be followed by PoolWake.
+*/
+FLEXT_TEMPLATE bool PoolClaim()
+{
+    if(--FLEXT_TEMPINST(ThrVars)::poolidle >= 0) return true;
+    ++FLEXT_TEMPINST(ThrVars)::poolidle;
+    return false;
+}
+
+//! Wake a claimed pool worker
+FLEXT_TEMPLATE void PoolWake()
+{
+    flext::ThrCond *cond = FLEXT_TEMPINST(ThrVars)::thrpoolcond;
+#if FLEXT_THREADS == FLEXT_THR_POSIX
+    cond->Lock();
+    ++FLEXT_TEMPINST(ThrVars)::poolwake;
+    cond->Signal();
+    cond->Unlock();
+#else
+    ++FLEXT_TEMPINST(ThrVars)::poolwake;
+    cond->Signal();
+#endif
+}
+
+//! Park a pool worker until it is claimed
+FLEXT_TEMPLATE void PoolWait()
+{
+    flext::ThrCond *cond = FLEXT_TEMPINST(ThrVars)::thrpoolcond;
+#if FLEXT_THREADS == FLEXT_THR_POSIX
+    cond->Lock();
+    ++FLEXT_TEMPINST(ThrVars)::poolidle;
+    while(FLEXT_TEMPINST(ThrVars)::poolwake <= 0) cond->WaitLocked();
+    --FLEXT_TEMPINST(ThrVars)::poolwake;
+    cond->Unlock();
+#else
+    ++FLEXT_TEMPINST(ThrVars)::poolidle;
+    for(;;) {
+        if(--FLEXT_TEMPINST(ThrVars)::poolwake >= 0) break;
+        ++FLEXT_TEMPINST(ThrVars)::poolwake;
+        cond->Wait();
+    }
+    // events don't count, so pass on remaining wakeups
+    if(FLEXT_TEMPINST(ThrVars)::poolwake > 0) cond->Signal();
+#endif
+}
+
+//! Pool worker loop, picking up pending thread entries
+FLEXT_TEMPLATE void PoolWorker(void *)
+{
+    const flext::thrid_t id = flext::GetThreadId();
+	flext::RelPriority(-1);
+    const int prio = flext::GetPriority(id);
+
+    for(;;) {
+        thr_entry *e = FLEXT_TEMPINST(ThrRegistry)::pending.Pop();
+        if(!e) {
+            FLEXT_TEMPINST(PoolWait)();
+            continue;
+        }
+
+        if(e->hasattr) {
+            // the pool threads keep their scheduling
+            FLEXT_TEMPINST(StartDedicated)(e);
+            continue;
+        }
+
+        e->pooled = true;
+        FLEXT_TEMPINST(ThrVars)::thrregmutex->Lock();
+        FLEXT_TEMPINST(ThrVars)::threads.Add(e);
+        FLEXT_TEMPINST(ThrVars)::threads.Bind(e,id);
+        FLEXT_TEMPINST(ThrVars)::thrregmutex->Unlock();
+
+        FLEXT_TEMPINST(RunEntry)(e,id);
+
+        // the entry is normally released by PopThread, but the method needn't call it
+        thr_entry *fnd = FLEXT_TEMPINST(ReleaseEntry)(id);
+        if(fnd) FLEXT_TEMPINST(ThrRegistry)::pending.Free(fnd);
+
+        // the method may have changed the priority
+        if(flext::GetPriority(id) != prio) flext::SetPriority(prio,id);
+    }
 }
 
 //! Start helper thread
@@ -167,8 +660,6 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::StartHelper()
 	bool ok = false;
     FLEXT_TEMPINST(ThrVars)::initialized = false;
 
-    FLEXT_TEMPINST(ThrVars)::thrregmtx = new ThrMutex;
-
 #if FLEXT_THREADS == FLEXT_THR_POSIX
 	pthread_attr_t attr;
 	pthread_attr_init(&attr);
@@ -208,12 +699,8 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::StartHelper()
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::ThrHelper(void *)
 {
     thrhelpid = GetThreadId();
-
-#if FLEXT_THREADS == FLEXT_THR_POSIX
-	// set prototype thread attributes
-	pthread_attr_t attr;
-	pthread_attr_init(&attr);
-	pthread_attr_setdetachstate(&attr,PTHREAD_CREATE_DETACHED);
+#ifdef FLEXT_TRACE
+    TraceThread("flext helper");
 #endif
 
 	// set thread priority one point below normal
@@ -221,6 +708,11 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::ThrHelper(void *)
 	RelPriority(-1);
 
 	FLEXT_TEMPINST(ThrVars)::thrhelpcond = new ThrCond;
+	FLEXT_TEMPINST(ThrVars)::thrpoolcond = new ThrCond;
+	FLEXT_TEMPINST(ThrVars)::thrregmutex = new ThrMutex;
+
+    // entries for the first launches
+    FLEXT_TEMPINST(ThrRegistry)::pending.Prefill(FLEXT_TEMPINST(ThrVars)::poolsize);
 
     FLEXT_TEMPINST(ThrVars)::initialized = true;
 
@@ -228,30 +720,19 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::ThrHelper(void *)
 	for(;;) {
 		FLEXT_TEMPINST(ThrVars)::thrhelpcond->Wait();
 
-   		// start all inactive threads
-        thr_entry *ti;
-        while((ti = FLEXT_TEMPINST(ThrRegistry)::pending.Pop()) != NULL) {
-		    bool ok;
-    		
-    #if FLEXT_THREADS == FLEXT_THR_POSIX
-            thrid_t dummy;
-		    ok = pthread_create (&dummy,&attr,(void *(*)(void *))FLEXT_TEMPINST(LaunchHelper),ti) == 0;
-    #elif FLEXT_THREADS == FLEXT_THR_MP
-            thrid_t dummy;
-		    ok = MPCreateTask((TaskProc)FLEXT_TEMPINST(LaunchHelper),ti,0,0,0,0,0,&dummy) == noErr;
-    #elif FLEXT_THREADS == FLEXT_THR_WIN32
-		    ok = _beginthread((void (*)(void *))FLEXT_TEMPINST(LaunchHelper),0,ti) >= 0;
-    #else
-    #error
-    #endif
-		    if(!ok) { 
-			    error("flext - Could not launch thread!");
-			    FLEXT_TEMPINST(ThrRegistry)::pending.Free(ti); ti = NULL;
-		    }
-		    else
-			    // insert into queue of active threads
-                FLEXT_TEMPINST(ThrRegistry)::active.Push(ti);
+        // spawn (or replenish) the worker pool
+        while(FLEXT_TEMPINST(ThrVars)::poolcnt < FLEXT_TEMPINST(ThrVars)::poolsize) {
+            if(!FLEXT_TEMPINST(SpawnThread)(FLEXT_TEMPINST(PoolWorker),NULL)) {
+			    error("flext - Could not launch pool thread!");
+                break;
+            }
+            ++FLEXT_TEMPINST(ThrVars)::poolcnt;
         }
+
+   		// start all inactive threads (those which no pool worker could be claimed for)
+        thr_entry *ti;
+        while((ti = FLEXT_TEMPINST(ThrRegistry)::pending.Pop()) != NULL)
+            FLEXT_TEMPINST(StartDedicated)(ti);
 	}
 
     FLEXT_ASSERT(false);
@@ -260,59 +741,265 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::ThrHelper(void *)
 
 	delete thrhelpcond;
 	thrhelpcond = NULL;
-	
-#if FLEXT_THREADS == FLEXT_THR_POSIX
-	pthread_attr_destroy(&attr);
-#endif
 */
 }
 
 
-FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::LaunchThread(void (*meth)(thr_params *p),thr_params *p)
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::LaunchThread(void (*meth)(thr_params *p),thr_params *p,const ThrAttr *attr)
 {
 	FLEXT_ASSERT(FLEXT_TEMPINST(ThrVars)::thrhelpcond);
 
 	// make an entry into thread list
     thr_entry *e = FLEXT_TEMPINST(ThrRegistry)::pending.New();
     e->Set(meth,p);
+    if(attr) {
+        e->attr = *attr;
+        e->hasattr = true;
+    }
 	FLEXT_TEMPINST(ThrRegistry)::pending.Push(e);
-	// signal thread helper
-	FLEXT_TEMPINST(ThrVars)::thrhelpcond->Signal();
+
+    if(!attr && FLEXT_TEMPINST(PoolClaim)())
+        // a parked pool worker will pick it up
+        FLEXT_TEMPINST(PoolWake)();
+    else
+	    // signal thread helper to start a new thread
+	    FLEXT_TEMPINST(ThrVars)::thrhelpcond->Signal();
 
 	return true;
 }
 
-FLEXT_TEMPLATE bool waitforstopped(TypedLifo<thr_entry> &qufnd,float wait = 0)
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::SetupThreadPool(int workers)
 {
-    TypedLifo<thr_entry> qutmp;
+    if(workers < 0) return false;
+    FLEXT_TEMPINST(ThrVars)::poolsize = workers;
+    return true;
+}
 
-    double until;
-    if(wait) until = flext::GetOSTime()+wait;
 
+#ifndef FLEXT_PARSPIN
+//! Number of polls before a ParallelFor helper parks
+#define FLEXT_PARSPIN 20000
+#endif
+
+/*! \brief State of the (single) ParallelFor job
+    \remark Helpers join a job by incrementing the member count in ctl, which is only possible while the job is open.
+    The job fields are only rewritten when the job is closed and all members have left, 
+    so that late helpers can never see a half-initialized job.
+*/
+FLEXT_TEMPLATE
+struct ParVars {
+    enum { 
+        cnt_mask = 0x7fff, //!< number of helpers inside the job
+        open_bit = 0x8000, //!< job accepts helpers
+        gen_shift = 16, gen_mask = 0x7fff //!< job generation
+    };
+
+    //! job control word (generation | open | count)
+    static volatile long ctl;
+    //! caller lock
+    static volatile long busy;
+
+    static flext::parfor_t fn;
+    static void *data;
+    static int n;
+    static lockfree::atomic_int<int> next,done;
+
+    static int threads;
+    static lockfree::atomic_int<int> parked;
+    static flext::ThrCond *cond;
+
+    static long Gen(long c) { return (c>>gen_shift)&gen_mask; }
+
+    //! take and process indices of the current job
+    static void Run()
+    {
+        for(;;) {
+            int i = next++;
+            if(i >= n) break;
+            fn(i,data);
+            ++done;
+        }
+    }
+};
+
+FLEXT_TEMPIMPL(volatile long ParVars)::ctl = 0;
+FLEXT_TEMPIMPL(volatile long ParVars)::busy = 0;
+FLEXT_TEMPIMPL(flext::parfor_t ParVars)::fn = NULL;
+FLEXT_TEMPIMPL(void *ParVars)::data = NULL;
+FLEXT_TEMPIMPL(int ParVars)::n = 0;
+FLEXT_TEMPIMPL(lockfree::atomic_int<int> ParVars)::next;
+FLEXT_TEMPIMPL(lockfree::atomic_int<int> ParVars)::done;
+FLEXT_TEMPIMPL(int ParVars)::threads = 0;
+FLEXT_TEMPIMPL(lockfree::atomic_int<int> ParVars)::parked;
+FLEXT_TEMPIMPL(flext::ThrCond *ParVars)::cond = NULL;
+
+//! ParallelFor helper loop
+FLEXT_TEMPLATE void ParWorker(void *)
+{
+    typedef FLEXT_TEMPINST(ParVars) V;
+
+    // helpers take over DSP work, so they run with system thread priority
+    const flext::ThrAttr *attr = flext::GetDSPThreadAttr();
+    if(attr)
+        flext::SetThreadAttr(*attr);
+    else
+        flext::RelPriority(0);
+
+    long last = -1; // generation of the last job taken part in
+    int spins = 0;
     for(;;) {
-        thr_entry *fnd = qufnd.Pop();
-        if(!fnd) break; // no more entries -> done!
+        long c = V::ctl;
+        if(!(c&V::open_bit) || V::Gen(c) == last) {
+            if(++spins < FLEXT_PARSPIN) continue;
 
-        thr_entry *ti;
-        // search for entry
-        while((ti = FLEXT_TEMPINST(ThrRegistry)::stopped.Pop()) != NULL && ti != fnd) qutmp.Push(ti);
-        // put back entries
-        while((ti = qutmp.Pop()) != NULL) FLEXT_TEMPINST(ThrRegistry)::stopped.Push(ti);
-
-        if(ti) { 
-            // still in ThrRegistry::stopped queue
-            qufnd.Push(fnd);
-            // yield to other threads
-            flext::ThrYield();
-            
-            if(wait && flext::GetOSTime() > until) 
-                // not successful -> remaining thread are still in qufnd queue
-                return false;
+            // park until a new job is opened
+#if FLEXT_THREADS == FLEXT_THR_POSIX
+            V::cond->Lock();
+            ++V::parked;
+            while(!((c = V::ctl)&V::open_bit) || V::Gen(c) == last) V::cond->WaitLocked();
+            --V::parked;
+            V::cond->Unlock();
+#else
+            ++V::parked;
+            while(!((c = V::ctl)&V::open_bit) || V::Gen(c) == last) V::cond->Wait();
+            --V::parked;
+#endif
+            spins = 0;
+            continue;
+        }
+
+        // join the job
+        if(!lockfree::CAS(&V::ctl,c,c+1)) continue;
+        last = V::Gen(c);
+        spins = 0;
+
+        // pass on the wakeup
+        if(V::parked > 0) {
+#if FLEXT_THREADS == FLEXT_THR_POSIX
+            V::cond->Lock(); V::cond->Signal(); V::cond->Unlock();
+#else
+            V::cond->Signal();
+#endif
+        }
+
+        V::Run();
+
+        // leave the job
+        for(;;) {
+            c = V::ctl;
+            if(lockfree::CAS(&V::ctl,c,c-1)) break;
         }
     }
+}
+
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::SetupParallel(int threads)
+{
+    typedef FLEXT_TEMPINST(ParVars) V;
+
+    if(!V::cond) V::cond = new ThrCond;
+
+    while(V::threads < threads) {
+        if(!FLEXT_TEMPINST(SpawnThread)(FLEXT_TEMPINST(ParWorker),NULL)) {
+            error("flext - Could not launch parallel helper thread!");
+            return false;
+        }
+        ++V::threads;
+    }
     return true;
 }
 
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::ParallelFor(int n,parfor_t fn,void *data)
+{
+    typedef FLEXT_TEMPINST(ParVars) V;
+
+    if(n <= 1 || !V::threads || !lockfree::CAS(&V::busy,0L,1L)) {
+        // serial fallback
+        for(int i = 0; i < n; ++i) fn(i,data);
+        return;
+    }
+
+    // wait for late helpers to leave the previous job
+    while(V::ctl&V::cnt_mask) lockfree::memory_barrier();
+
+    V::fn = fn;
+    V::data = data;
+    V::n = n;
+    V::next = 0;
+    V::done = 0;
+
+    // open job with a new generation
+    lockfree::memory_barrier();
+    long c = V::ctl;
+    V::ctl = (((V::Gen(c)+1)&V::gen_mask)<<V::gen_shift)|V::open_bit;
+    lockfree::memory_barrier();
+
+    if(V::parked > 0) {
+#if FLEXT_THREADS == FLEXT_THR_POSIX
+        V::cond->Lock(); V::cond->Signal(); V::cond->Unlock();
+#else
+        V::cond->Signal();
+#endif
+    }
+
+    // take part ourselves
+    V::Run();
+
+    // wait for the helpers to finish their indices
+    for(int spins = 0; V::done < n; ++spins)
+        if(spins >= FLEXT_PARSPIN) ThrYield();
+
+    // close job, remaining members leave on their own
+    for(;;) {
+        c = V::ctl;
+        if(lockfree::CAS(&V::ctl,c,c&~(long)V::open_bit)) break;
+    }
+
+    lockfree::memory_barrier();
+    V::busy = 0;
+}
+
+/*! \brief Wait for the entries stopped on behalf of w to be released
+    \param wait maximum waiting time in seconds (0 for no limit)
+    \return true if all entries have been released
+*/
+FLEXT_TEMPLATE bool waitforstopped(ThrStopWait &w,double wait = 0)
+{
+    double until;
+    if(wait) until = flext::GetOSTime()+wait;
+
+#if FLEXT_THREADS == FLEXT_THR_POSIX
+    w.cond.Lock();
+    while(w.count > 0) {
+        if(!wait) 
+            w.cond.WaitLocked();
+        else {
+            double left = until-flext::GetOSTime();
+            if(left <= 0) break;
+            w.cond.TimedWaitLocked(left);
+        }
+    }
+    w.cond.Unlock();
+#else
+    // the events stay set, no wakeup can be missed
+    while(w.count > 0) {
+        if(!wait) 
+            w.cond.Wait();
+        else {
+            double left = until-flext::GetOSTime();
+            if(left <= 0) break;
+            w.cond.TimedWait(left);
+        }
+    }
+#endif
+
+    // releasing threads notify with the registry locked, w may only vanish after they are done
+    flext::ThrMutex *mtx = FLEXT_TEMPINST(ThrVars)::thrregmutex;
+    mtx->Lock();
+    bool ok = w.count <= 0;
+    mtx->Unlock();
+    return ok;
+}
+
 FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::StopThread(void (*meth)(thr_params *p),thr_params *p,bool wait)
 {
 	FLEXT_ASSERT(FLEXT_TEMPINST(ThrVars)::thrhelpcond);
@@ -340,42 +1027,60 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::StopThread(void (*meth)(thr_params *
         if(found) return true;
     }
 
-    // now search active queue
-    // -----------------------
+    // now look up started threads
+    // ---------------------------
 
-    TypedLifo<thr_entry> qufnd;
+    ThrStopWait w;
+    int cnt = 0;
 
-    while((ti = FLEXT_TEMPINST(ThrRegistry)::active.Pop()) != NULL)
-        if(ti->meth == meth && ti->params == p) {
-            FLEXT_TEMPINST(ThrRegistry)::stopped.Push(ti);
-            FLEXT_TEMPINST(ThrVars)::thrhelpcond->Signal();
-            qufnd.Push(ti);
+    ThrMutex *mtx = FLEXT_TEMPINST(ThrVars)::thrregmutex;
+    mtx->Lock();
+    for(ti = FLEXT_TEMPINST(ThrVars)::threads.Methods(p); ti; ti = ti->mpnext)
+        if(ti->meth == meth && ti->params == p && !ti->shouldexit) {
+            ti->shouldexit = true;
+            if(wait) {
+                ti->waiter = &w;
+                ++w.count;
+            }
+            ++cnt;
         }
-        else
-            qutmp.Push(ti);
-
-    // put back into pending queue (order doesn't matter)
-    while((ti = qutmp.Pop()) != NULL) FLEXT_TEMPINST(ThrRegistry)::active.Push(ti);
+    mtx->Unlock();
 
     // wakeup helper thread
     FLEXT_TEMPINST(ThrVars)::thrhelpcond->Signal();
 
-    // now wait for entries in qufnd to have vanished from ThrRegistry::stopped
+    // now wait for the stopped entries to be released
     if(wait) 
-        return FLEXT_TEMPINST(waitforstopped)(qufnd);
+        return FLEXT_TEMPINST(waitforstopped)(w);
     else
-        return !qufnd.Avail();
+        return !cnt;
 }
 
 FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::ShouldExit()
 {
-    return FLEXT_TEMPINST(ThrRegistry)::stopped.Find(GetThreadId()) != NULL;
+#ifdef FLEXT_THRTOKEN
+    const volatile bool *tok = FLEXT_TEMPINST(ThrToken)::Get();
+    return tok && *tok;
+#else
+    ThrMutex *mtx = FLEXT_TEMPINST(ThrVars)::thrregmutex;
+    mtx->Lock();
+    thr_entry *e = FLEXT_TEMPINST(ThrVars)::threads.Find(GetThreadId());
+    bool ret = e && e->shouldexit;
+    mtx->Unlock();
+    return ret;
+#endif
 }
 
 FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::PushThread()
 {
+    ThrMutex *mtx = FLEXT_TEMPINST(ThrVars)::thrregmutex;
+    mtx->Lock();
+    thr_entry *e = FLEXT_TEMPINST(ThrVars)::threads.Find(GetThreadId());
+    bool hasattr = e && e->hasattr;
+    mtx->Unlock();
+
 	// set priority of newly created thread one point below the system thread's
-	RelPriority(-1);
+	if(!hasattr) RelPriority(-1);
 	RegisterThread();
 	return true;
 }
@@ -384,9 +1089,11 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::PopThread()
 {
     thrid_t id = GetThreadId();
 	UnregisterThread(id);
-    thr_entry *fnd = FLEXT_TEMPINST(ThrRegistry)::stopped.Find(id,true);
-    if(!fnd) fnd = FLEXT_TEMPINST(ThrRegistry)::active.Find(id,true);
-
+#ifdef FLEXT_THRTOKEN
+    // the entry is released now
+    FLEXT_TEMPINST(ThrToken)::Set(NULL);
+#endif
+    thr_entry *fnd = FLEXT_TEMPINST(ReleaseEntry)(id);
     if(fnd) 
         FLEXT_TEMPINST(ThrRegistry)::pending.Free(fnd);
 #ifdef FLEXT_DEBUG
@@ -395,46 +1102,65 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::PopThread()
 #endif
 }
 
+#ifdef FLEXT_THREADLOCAL
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::RegChanged(thrid_t id,bool reg)
+{
+    if(IsThread(id)) {
+        // the current thread knows its new state
+        thrstate.reg = reg;
+        thrstate.gen = thrreggen;
+    }
+    else {
+        // invalidate the cached states of all threads
+        long g;
+        do g = thrreggen;
+        while(!lockfree::CAS(&thrreggen,g,g+1));
+    }
+}
+#endif
+
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::RegisterThread(thrid_t id)
 {
-#if 1
-    FLEXT_ASSERT(FLEXT_TEMPINST(ThrVars)::thrregmtx);
-    FLEXT_TEMPINST(ThrVars)::thrregmtx->Lock();
-    FLEXT_TEMPINST(ThrVars)::regthreads.insert(id);
-    FLEXT_TEMPINST(ThrVars)::thrregmtx->Unlock();
-#else
-	regqueue.Push(new ThrIdCell(id));
+    if(UNLIKELY(!FLEXT_TEMPINST(ThrVars)::regthreads.Insert(id)))
+        error("flext - Thread registry is full");
+#ifdef FLEXT_THREADLOCAL
+    else
+        RegChanged(id,true);
 #endif
 }
 
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::UnregisterThread(thrid_t id)
 {
-#if 1
-    FLEXT_ASSERT(FLEXT_TEMPINST(ThrVars)::thrregmtx);
-    FLEXT_TEMPINST(ThrVars)::thrregmtx->Lock();
-    FLEXT_TEMPINST(ThrVars)::regthreads.erase(id);
-    FLEXT_TEMPINST(ThrVars)::thrregmtx->Unlock();
-#else
-	unregqueue.Push(new ThrIdCell(id));
+    FLEXT_TEMPINST(ThrVars)::regthreads.Remove(id);
+#ifdef FLEXT_THREADLOCAL
+    RegChanged(id,false);
 #endif
 }
 
-#if 0
-FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::ThreadRegistryWorker()
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::LookupThreadRegistered()
 {
-	ThrIdCell *pid;
-	while((pid = regqueue.Pop()) != NULL) { regthreads.insert(pid->id); delete pid; }
-	while((pid = unregqueue.Pop()) != NULL) { regthreads.erase(pid->id); delete pid; }
-}
+#ifdef FLEXT_THREADLOCAL
+    // take the generation first, a change during the lookup invalidates the result
+    const long g = thrreggen;
+    lockfree::memory_barrier();
+    const bool reg = FLEXT_TEMPINST(ThrVars)::regthreads.Find(GetThreadId()) >= 0;
+    thrstate.reg = reg;
+    thrstate.gen = g;
+    return reg;
+#else
+    return FLEXT_TEMPINST(ThrVars)::regthreads.Find(GetThreadId()) >= 0;
 #endif
+}
 
-FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::IsThreadRegistered()
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::StartThread(void (*meth)(thr_params *p),thr_params *p,const char *name)
 {
-    FLEXT_ASSERT(FLEXT_TEMPINST(ThrVars)::thrregmtx);
-    FLEXT_TEMPINST(ThrVars)::thrregmtx->Lock();
-	bool fnd = FLEXT_TEMPINST(ThrVars)::regthreads.find(GetThreadId()) != FLEXT_TEMPINST(ThrVars)::regthreads.end();
-    FLEXT_TEMPINST(ThrVars)::thrregmtx->Unlock();
-    return fnd;
+    p->cl = this;
+    if(name) {
+        ThrAttr attr;
+        attr.name = name;
+        if(CbThreadAttr(name,attr)) return LaunchThread(meth,p,&attr);
+    }
+    return LaunchThread(meth,p);
 }
 
 //! Terminate all object threads
@@ -458,28 +1184,44 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::StopThreads()
     // put back into pending queue (order doesn't matter)
     while((ti = qutmp.Pop()) != NULL) FLEXT_TEMPINST(ThrRegistry)::pending.Push(ti);
 
-    // now search active queue
-    // -----------------------
+    // now look up started threads
+    // ---------------------------
 
-    TypedLifo<thr_entry> qufnd;
+    ThrStopWait w;
 
-    while((ti = FLEXT_TEMPINST(ThrRegistry)::active.Pop()) != NULL)
-        if(ti->This() == this) {
-            FLEXT_TEMPINST(ThrRegistry)::stopped.Push(ti);
-            FLEXT_TEMPINST(ThrVars)::thrhelpcond->Signal();
-            qufnd.Push(ti);
+    ThrMutex *mtx = FLEXT_TEMPINST(ThrVars)::thrregmutex;
+    mtx->Lock();
+    for(ti = FLEXT_TEMPINST(ThrVars)::threads.Objects(this); ti; ti = ti->obnext)
+        if(ti->This() == this && !ti->shouldexit) {
+            ti->shouldexit = true;
+            ti->waiter = &w;
+            ++w.count;
         }
-        else
-            qutmp.Push(ti);
-
-    // put back into pending queue (order doesn't matter)
-    while((ti = qutmp.Pop()) != NULL) FLEXT_TEMPINST(ThrRegistry)::active.Push(ti);
+    mtx->Unlock();
 
     // wakeup helper thread
     FLEXT_TEMPINST(ThrVars)::thrhelpcond->Signal();
 
-    // now wait for entries in qufnd to have vanished from ThrRegistry::stopped
-    if(!FLEXT_TEMPINST(waitforstopped)(qufnd,MAXIMUMWAIT*0.001f)) {
+    // now wait for the stopped entries to be released
+    if(FLEXT_TEMPINST(waitforstopped)(w,MAXIMUMWAIT*0.001)) return true;
+
+    // take the remaining entries out of the registry
+    TypedLifo<thr_entry> qufnd;
+    mtx->Lock();
+    for(ti = FLEXT_TEMPINST(ThrVars)::threads.Objects(this); ti; ti = ti->obnext)
+        if(ti->waiter == &w) {
+            ti->waiter = NULL;
+            // a thread which hasn't started yet will see shouldexit and release its entry
+            if(ti->bound) qutmp.Push(ti);
+        }
+    while((ti = qutmp.Pop()) != NULL) {
+        FLEXT_TEMPINST(ThrVars)::threads.Remove(ti);
+        qufnd.Push(ti);
+    }
+    mtx->Unlock();
+
+    // (some may have been released in the meantime)
+    if(qufnd.Avail()) {
 #ifdef FLEXT_DEBUG
 		post("flext - doing hard thread termination");
 #endif
@@ -499,6 +1241,11 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::StopThreads()
 #else
 # error Not implemented
 #endif
+            if(ti->pooled) {
+                // the pool has lost a worker -> let the helper replace it
+                --FLEXT_TEMPINST(ThrVars)::poolcnt;
+                FLEXT_TEMPINST(ThrVars)::thrhelpcond->Signal();
+            }
             FLEXT_TEMPINST(ThrRegistry)::pending.Free(ti);
         }
         return false;
@@ -582,11 +1329,13 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::RelPriority(int dp,thrid_t ref,thrid
     return true;
 
 #elif FLEXT_THREADS == FLEXT_THR_MP
-    thr_entry *ti = FLEXT_TEMPINST(ThrRegistry)::pending.Find(id);
-    if(!ti) ti = FLEXT_TEMPINST(ThrRegistry)::active.Find(id);
+    ThrMutex *mtx = FLEXT_TEMPINST(ThrVars)::thrregmutex;
+    mtx->Lock();
+    thr_entry *ti = FLEXT_TEMPINST(ThrVars)::threads.Find(id);
+    mtx->Unlock();
 	if(ti) {
 		// thread found in list
-		int w = GetPriority(id);
+		int w = ti->weight;
 		if(dp < 0) w /= 1<<(-dp);
 		else w *= 1<<dp;
 		if(w < 1) {
@@ -637,9 +1386,12 @@ FLEXT_TEMPIMPL(int FLEXT_CLASSDEF(flext))::GetPriority(thrid_t id)
     return pr;
 
 #elif FLEXT_THREADS == FLEXT_THR_MP
-    thr_entry *ti = FLEXT_TEMPINST(ThrRegistry)::pending.Find(id);
-    if(!ti) ti = FLEXT_TEMPINST(ThrRegistry)::active.Find(id);
-    return ti?ti->weight:-1;
+    ThrMutex *mtx = FLEXT_TEMPINST(ThrVars)::thrregmutex;
+    mtx->Lock();
+    thr_entry *ti = FLEXT_TEMPINST(ThrVars)::threads.Find(id);
+    int w = ti?ti->weight:-1;
+    mtx->Unlock();
+    return w;
 #else
 # error
 #endif
@@ -679,15 +1431,142 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::SetPriority(int p,thrid_t id)
     return true;
 
 #elif FLEXT_THREADS == FLEXT_THR_MP
-    thr_entry *ti = FLEXT_TEMPINST(ThrRegistry)::pending.Find(id);
-    if(!ti) ti = FLEXT_TEMPINST(ThrRegistry)::active.Find(id);
-    return ti && MPSetTaskWeight(id,ti->weight = p) == noErr;
+    ThrMutex *mtx = FLEXT_TEMPINST(ThrVars)::thrregmutex;
+    mtx->Lock();
+    thr_entry *ti = FLEXT_TEMPINST(ThrVars)::threads.Find(id);
+    if(ti) ti->weight = p;
+    mtx->Unlock();
+    return ti && MPSetTaskWeight(id,p) == noErr;
 #else
 # error
 #endif
 }
 
 
+#if FLEXT_THREADS == FLEXT_THR_POSIX
+//! Clamp a priority to the range of a scheduling policy
+inline int clampprio(int policy,int p)
+{
+    const int pmin = sched_get_priority_min(policy),pmax = sched_get_priority_max(policy);
+    return p < pmin?pmin:(p > pmax?pmax:p);
+}
+#endif
+
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::SetThreadAttr(const ThrAttr &attr)
+{
+    bool ok = true;
+
+    // --- scheduling ---
+    if(attr.policy == ThrAttr::pol_relative)
+        ok = RelPriority(attr.priority);
+    else {
+#if FLEXT_THREADS == FLEXT_THR_POSIX
+# if FLEXT_OSAPI == FLEXT_OSAPI_MAC_MACH
+        if(attr.policy == ThrAttr::pol_realtime) {
+            mach_timebase_info_data_t tb;
+            mach_timebase_info(&tb);
+            // seconds -> absolute time units
+            const double ns2abs = 1.e9*tb.denom/tb.numer;
+
+            thread_time_constraint_policy_data_t pol;
+            pol.period = (uint32_t)(attr.period*ns2abs);
+            pol.computation = (uint32_t)(attr.computation*ns2abs);
+            pol.constraint = (uint32_t)(attr.constraint*ns2abs);
+            pol.preemptible = 1;
+            ok = thread_policy_set(pthread_mach_thread_np(pthread_self()),THREAD_TIME_CONSTRAINT_POLICY,
+                (thread_policy_t)&pol,THREAD_TIME_CONSTRAINT_POLICY_COUNT) == KERN_SUCCESS;
+        }
+        else
+# endif
+        {
+            int policy = 
+                attr.policy == ThrAttr::pol_normal?SCHED_OTHER:
+                (attr.policy == ThrAttr::pol_rr?SCHED_RR:SCHED_FIFO);
+            sched_param parm;
+            parm.sched_priority = attr.policy == ThrAttr::pol_normal?0:clampprio(policy,attr.priority);
+            ok = pthread_setschedparam(pthread_self(),policy,&parm) == 0;
+        }
+#elif FLEXT_THREADS == FLEXT_THR_WIN32
+        HANDLE hid = GetCurrentThread();
+        int pr;
+        if(attr.policy == ThrAttr::pol_normal) 
+            pr = THREAD_PRIORITY_NORMAL;
+        else if(attr.policy == ThrAttr::pol_realtime) {
+            pr = THREAD_PRIORITY_TIME_CRITICAL;
+
+            // register with the multimedia class scheduler (Vista and later)
+            typedef HANDLE (WINAPI *avset_t)(LPCSTR,LPDWORD);
+            static HMODULE avrt = LoadLibraryA("avrt.dll");
+            avset_t avset = avrt?(avset_t)GetProcAddress(avrt,"AvSetMmThreadCharacteristicsA"):NULL;
+            DWORD task = 0;
+            if(avset && !avset("Pro Audio",&task)) ok = false;
+        }
+        else
+            pr = attr.priority < THREAD_PRIORITY_IDLE?THREAD_PRIORITY_IDLE:(attr.priority > THREAD_PRIORITY_TIME_CRITICAL?THREAD_PRIORITY_TIME_CRITICAL:attr.priority);
+        if(SetThreadPriority(hid,pr) == 0) ok = false;
+#else
+        // only relative priorities (task weights) with MP threads
+        ok = false;
+#endif
+    }
+# ifdef FLEXT_DEBUG
+    if(!ok) post("flext - failed to set thread scheduling");
+# endif
+
+    // --- CPU affinity ---
+    if(attr.affinity) {
+#if FLEXT_THREADS == FLEXT_THR_POSIX && defined(__linux__) && defined(CPU_SET)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for(size_t i = 0; i < sizeof(attr.affinity)*8 && i < CPU_SETSIZE; ++i)
+            if(attr.affinity&((size_t)1<<i)) CPU_SET(i,&set);
+        if(pthread_setaffinity_np(pthread_self(),sizeof(set),&set) != 0) ok = false;
+#elif FLEXT_THREADS == FLEXT_THR_WIN32
+        if(!SetThreadAffinityMask(GetCurrentThread(),(DWORD_PTR)attr.affinity)) ok = false;
+#else
+        // no pinning on macOS (only affinity tags) and other systems
+#endif
+    }
+
+    // --- name (best effort, not reported) ---
+    if(attr.name) {
+#if FLEXT_THREADS == FLEXT_THR_POSIX && FLEXT_OSAPI == FLEXT_OSAPI_MAC_MACH
+        pthread_setname_np(attr.name);
+#elif FLEXT_THREADS == FLEXT_THR_POSIX && defined(__linux__) && defined(__GLIBC__) && defined(_GNU_SOURCE)
+        // the name is limited to 15 characters
+        char nm[16];
+        strncpy(nm,attr.name,sizeof(nm)-1);
+        nm[sizeof(nm)-1] = 0;
+        pthread_setname_np(pthread_self(),nm);
+#elif FLEXT_THREADS == FLEXT_THR_WIN32
+        // Windows 10 and later
+        typedef HRESULT (WINAPI *setdesc_t)(HANDLE,PCWSTR);
+        setdesc_t setdesc = (setdesc_t)GetProcAddress(GetModuleHandleA("kernel32.dll"),"SetThreadDescription");
+        if(setdesc) {
+            wchar_t wnm[64];
+            if(MultiByteToWideChar(CP_UTF8,0,attr.name,-1,wnm,64) > 0) {
+                wnm[63] = 0;
+                setdesc(GetCurrentThread(),wnm);
+            }
+        }
+#endif
+    }
+
+    return ok;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::SetupDSPThreads(const ThrAttr &attr)
+{
+    FLEXT_TEMPINST(ThrVars)::dspattr = attr;
+    FLEXT_TEMPINST(ThrVars)::hasdspattr = true;
+}
+
+FLEXT_TEMPIMPL(const FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext))::ThrAttr *FLEXT_CLASSDEF(flext))::GetDSPThreadAttr()
+{
+    return FLEXT_TEMPINST(ThrVars)::hasdspattr?&FLEXT_TEMPINST(ThrVars)::dspattr:NULL;
+}
+
+
 #if FLEXT_THREADS == FLEXT_THR_POSIX
 FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::ThrCond::Wait() {
 	this->Lock(); // use this-> to avoid wrong function invocation (global Unlock)
@@ -697,6 +1576,14 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::ThrCond::Wait() {
 }
 
 FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::ThrCond::TimedWait(double ftm)
+{ 
+	this->Lock(); // use this-> to avoid wrong function invocation (global Unlock)
+    bool ret = TimedWaitLocked(ftm);
+	this->Unlock(); // use this-> to avoid wrong function invocation (global Unlock)
+	return ret;
+}
+
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::ThrCond::TimedWaitLocked(double ftm)
 { 
 	timespec tm; 
 #if FLEXT_OS == FLEXT_OS_WIN && FLEXT_OSAPI == FLEXT_OSAPI_WIN_NATIVE
@@ -725,10 +1612,7 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::ThrCond::TimedWait(double ftm)
 	tm.tv_sec += (long)ftm+(tm.tv_nsec-nns)/1000000000; 
 	tm.tv_nsec = nns;
 
-	this->Lock(); // use this-> to avoid wrong function invocation (global Unlock)
-    bool ret = pthread_cond_timedwait(&cond,&this->mutex,&tm) == 0;
-	this->Unlock(); // use this-> to avoid wrong function invocation (global Unlock)
-	return ret;
+    return pthread_cond_timedwait(&cond,&this->mutex,&tm) == 0;
 }
 #endif
 
@@ -14,32 +14,66 @@ WARRANTIES, see the file, "license.txt," in this distribution.
 #define __FLEXT_TIMER_CPP
 
 #include "flext.h"
+#include "lockfree/cas.hpp"
+#include <cmath>
 
 #if FLEXT_OS == FLEXT_OS_WIN
 #include <windows.h>
 #elif FLEXT_OS == FLEXT_OS_LINUX || FLEXT_OS == FLEXT_OS_IRIX || FLEXT_OSAPI == FLEXT_OSAPI_MAC_MACH
+#if FLEXT_OSAPI == FLEXT_OSAPI_MAC_MACH
+#include <mach/mach_time.h>
+#endif
 #include <unistd.h>
 #include <sys/time.h>
+#include <time.h>
+#include <sched.h>
+#include <errno.h>
 #elif FLEXT_OS == FLEXT_OS_MAC
 #include <Timer.h>
 #include <Threads.h>
 #endif
 
+#if defined(_MSC_VER) && (FLEXT_CPU == FLEXT_CPU_IA32 || FLEXT_CPU == FLEXT_CPU_X86_64)
+#include <intrin.h>
+#define FLEXT_CYCLES_TSC
+#elif defined(__GNUC__) && (FLEXT_CPU == FLEXT_CPU_IA32 || FLEXT_CPU == FLEXT_CPU_X86_64)
+#define FLEXT_CYCLES_TSC
+#elif defined(__GNUC__) && FLEXT_CPU == FLEXT_CPU_ARM64
+#define FLEXT_CYCLES_CNTVCT
+#endif
+
 #include "flpushns.h"
 
 FLEXT_TEMPLATE double getstarttime();
 
+// the last part of a Sleep is spent yielding, the system sleep functions are not precise enough
+#ifndef FLEXT_SLEEPSPIN
+#define FLEXT_SLEEPSPIN 0.0002 // in seconds
+#endif
+
 FLEXT_TEMPLATE
 struct TimerVars
 {
 #if FLEXT_OS == FLEXT_OS_WIN
     static double perffrq;
+    //! thread local slot for the waitable timer of a thread
+    static DWORD sleepslot;
 #endif
     static double starttime;
+    static double cyclens;
+#if FLEXT_OSAPI == FLEXT_OSAPI_MAC_MACH
+    static mach_timebase_info_data_t timebase;
+#endif
 };
 
+FLEXT_TEMPIMPL(double TimerVars)::cyclens = 0;
+#if FLEXT_OSAPI == FLEXT_OSAPI_MAC_MACH
+FLEXT_TEMPIMPL(mach_timebase_info_data_t TimerVars)::timebase;
+#endif
+
 #if FLEXT_OS == FLEXT_OS_WIN
 FLEXT_TEMPIMPL(double TimerVars)::perffrq = 0;
+FLEXT_TEMPIMPL(DWORD TimerVars)::sleepslot = TLS_OUT_OF_INDEXES;
 #endif
 FLEXT_TEMPIMPL(double TimerVars)::starttime = FLEXT_TEMPINST(getstarttime)();
 
@@ -49,6 +83,9 @@ double getstarttime()
 #if FLEXT_OS == FLEXT_OS_WIN
     LARGE_INTEGER frq;
     if(QueryPerformanceFrequency(&frq)) TimerVars::perffrq = (double)frq.QuadPart;
+    TimerVars::sleepslot = TlsAlloc();
+#elif FLEXT_OSAPI == FLEXT_OSAPI_MAC_MACH
+    mach_timebase_info(&FLEXT_TEMPINST(TimerVars)::timebase);
 #endif
 
     FLEXT_TEMPINST(TimerVars)::starttime = 0;
@@ -84,43 +121,132 @@ FLEXT_TEMPIMPL(double FLEXT_CLASSDEF(flext))::GetOSTime()
     return tm-FLEXT_TEMPINST(TimerVars)::starttime;
 }
 
-FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::Sleep(double s)
+FLEXT_TEMPIMPL(FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext))::t_uint64 FLEXT_CLASSDEF(flext))::GetTimeNs()
 {
-    if(s <= 0) return;
 #if FLEXT_OS == FLEXT_OS_WIN
-#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x400
-#if 0
-    LARGE_INTEGER liDueTime;
-    liDueTime.QuadPart = (LONGLONG)(-1.e7*s);
-
-    // Create a waitable timer.
-    HANDLE hTimer = CreateWaitableTimer(NULL,TRUE,NULL);
-    if(hTimer) {
-        if(SetWaitableTimer(hTimer,&liDueTime,0,NULL,NULL,0))
-            // Wait for the timer.
-            WaitForSingleObject(hTimer,INFINITE); // != WAIT_OBJECT_0)
-        else
-            ::Sleep((long)(s*1000.));
-        CloseHandle(hTimer);
+    LARGE_INTEGER cnt;
+    if(FLEXT_TEMPINST(TimerVars)::perffrq && QueryPerformanceCounter(&cnt)) {
+        const t_uint64 f = (t_uint64)FLEXT_TEMPINST(TimerVars)::perffrq,c = (t_uint64)cnt.QuadPart;
+        // split to prevent overflow
+        return c/f*1000000000+c%f*1000000000/f;
     }
     else
+        return (t_uint64)(GetOSTime()*1.e9);
+#elif FLEXT_OSAPI == FLEXT_OSAPI_MAC_MACH
+    const mach_timebase_info_data_t &tb = FLEXT_TEMPINST(TimerVars)::timebase;
+    return mach_absolute_time()*tb.numer/tb.denom;
+#elif FLEXT_OS == FLEXT_OS_LINUX || FLEXT_OS == FLEXT_OS_IRIX // POSIX
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (t_uint64)ts.tv_sec*1000000000+ts.tv_nsec;
+#elif FLEXT_OS == FLEXT_OS_MAC // that's just for OS9 & Carbon!
+    UnsignedWide tick;
+    Microseconds(&tick);
+    return (((t_uint64)tick.hi<<32)|tick.lo)*1000;
+#else
+    #error Not implemented
+#endif
+}
+
+FLEXT_TEMPIMPL(FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext))::t_uint64 FLEXT_CLASSDEF(flext))::GetCycles()
+{
+#if defined(FLEXT_CYCLES_TSC) && defined(_MSC_VER)
+    return __rdtsc();
+#elif defined(FLEXT_CYCLES_TSC)
+    unsigned int lo,hi;
+    __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((t_uint64)hi<<32)|lo;
+#elif defined(FLEXT_CYCLES_CNTVCT)
+    t_uint64 v;
+    __asm__ __volatile__ ("mrs %0, cntvct_el0" : "=r" (v));
+    return v;
 #else
+    return GetTimeNs();
+#endif
+}
+
+FLEXT_TEMPIMPL(double FLEXT_CLASSDEF(flext))::GetCycleNs()
+{
+    double &ns = FLEXT_TEMPINST(TimerVars)::cyclens;
+    if(!ns) {
+#if defined(FLEXT_CYCLES_TSC)
+        // measure for 5 ms
+        const t_uint64 t0 = GetTimeNs(),c0 = GetCycles();
+        t_uint64 t1;
+        do t1 = GetTimeNs(); while(t1-t0 < 5000000);
+        ns = (double)(t1-t0)/(double)(GetCycles()-c0);
+#elif defined(FLEXT_CYCLES_CNTVCT)
+        t_uint64 f;
+        __asm__ __volatile__ ("mrs %0, cntfrq_el0" : "=r" (f));
+        ns = 1.e9/f;
+#else
+        ns = 1;
+#endif
+    }
+    return ns;
+}
+
+#if FLEXT_OS == FLEXT_OS_WIN
+//! Get the waitable timer of the current thread (created on first use)
+FLEXT_TEMPLATE
+HANDLE getsleeptimer()
+{
+    const DWORD slot = FLEXT_TEMPINST(TimerVars)::sleepslot;
+    if(slot == TLS_OUT_OF_INDEXES) return NULL;
+    HANDLE h = (HANDLE)TlsGetValue(slot);
+    if(!h) {
+#ifdef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+        h = CreateWaitableTimerEx(NULL,NULL,CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,TIMER_ALL_ACCESS);
+        if(!h)
+#endif
+            h = CreateWaitableTimer(NULL,TRUE,NULL);
+        // the timer is kept for the lifetime of the thread
+        TlsSetValue(slot,h);
+    }
+    return h;
+}
+#endif
+
+/*! \remark Longer waits use the system sleep function (a waitable timer per thread on Windows), 
+    the last FLEXT_SLEEPSPIN seconds are spent yielding to other threads, which gives precise wakeups.
+*/
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::Sleep(double s)
+{
+    if(s <= 0) return;
+#if FLEXT_OS == FLEXT_OS_WIN
     LARGE_INTEGER cnt;
     if(TimerVars::perffrq && QueryPerformanceCounter(&cnt)) {
-        LONGLONG dst = (LONGLONG)(cnt.QuadPart+TimerVars::perffrq*s);
+        const LONGLONG dst = (LONGLONG)(cnt.QuadPart+TimerVars::perffrq*s);
+        if(s > FLEXT_SLEEPSPIN) {
+            HANDLE h = FLEXT_TEMPINST(getsleeptimer)();
+            LARGE_INTEGER due;
+            // relative time in 100ns units
+            due.QuadPart = (LONGLONG)(-1.e7*(s-FLEXT_SLEEPSPIN));
+            if(h && SetWaitableTimer(h,&due,0,NULL,NULL,FALSE))
+                WaitForSingleObject(h,INFINITE);
+            else
+                ::Sleep((DWORD)((s-FLEXT_SLEEPSPIN)*1000.));
+        }
         for(;;) {
-            SwitchToThread(); // while waiting switch to another thread
             QueryPerformanceCounter(&cnt);
-            if(cnt.QuadPart > dst) break;
+            if(cnt.QuadPart >= dst) break;
+            SwitchToThread(); // while waiting switch to another thread
         }
     }
     else
-#endif
-#endif
         // last resort....
         ::Sleep((long)(s*1000.));
 #elif FLEXT_OS == FLEXT_OS_LINUX || FLEXT_OS == FLEXT_OS_IRIX || FLEXT_OSAPI == FLEXT_OSAPI_MAC_MACH // POSIX
-    usleep((long)(s*1000000.));
+    const t_uint64 dst = GetTimeNs()+(t_uint64)(s*1.e9);
+    if(s > FLEXT_SLEEPSPIN) {
+        const double sl = s-FLEXT_SLEEPSPIN;
+        timespec ts,rem;
+        ts.tv_sec = (time_t)sl;
+        ts.tv_nsec = (long)((sl-ts.tv_sec)*1.e9);
+        // continue after signals
+        while(nanosleep(&ts,&rem) && errno == EINTR) ts = rem;
+    }
+    while(GetTimeNs() < dst) sched_yield();
 #elif FLEXT_OS == FLEXT_OS_MAC // that's just for OS9 & Carbon!
     UnsignedWide tick;
     Microseconds(&tick);
@@ -136,44 +262,326 @@ FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::Sleep(double s)
 #endif
 }
 
+#define TIMER_SLOT 1.   // width of the timer wheel slots in ms
+#define TIMER_EPS 1.e-6 // tolerance for due times in ms
+
+#if FLEXT_SYS == FLEXT_SYS_MAX
+// timers can be set from the scheduler and the main thread
+#define WHEEL_LOCK() critical_enter(0)
+#define WHEEL_UNLOCK() critical_exit(0)
+#else
+// Pd: clock functions must be called with the system lock anyway
+#define WHEEL_LOCK() ((void)0)
+#define WHEEL_UNLOCK() ((void)0)
+#endif
+
+FLEXT_TEMPIMPL(FLEXT_TEMPSUB(FLEXT_CLASSDEF(flext))::Timer::Wheel FLEXT_CLASSDEF(flext))::Timer::wheel;
+
 /* \param qu determines whether timed messages should be queued (low priority - only when supported by the system).
+   \param th determines whether Work is called on a worker thread
 */
-FLEXT_TEMPIMPL(FLEXT_CLASSDEF(flext))::Timer::Timer(bool qu):
+FLEXT_TEMPIMPL(FLEXT_CLASSDEF(flext))::Timer::Timer(bool qu,bool th):
+#ifdef FLEXT_THREADS
+    work(NULL),overruns(0),
+#endif
     queued(qu),
     clss(NULL),userdata(NULL),
-    period(0)
+    period(0),
+    intended(0),fired(0)
 {
-#if FLEXT_SYS == FLEXT_SYS_PD
-    clk = (t_clock *)clock_new(this,(t_method)callback);
-#elif FLEXT_SYS == FLEXT_SYS_MAX
-    clk = (t_clock *)clock_new(this,(t_method)callback);
+    link.prev = link.next = NULL;
+    link.tmr = this;
+    link.lev = -1;
+#ifdef FLEXT_THREADS
+    if(th) {
+        work = new WorkState;
+        work->params.var[0]._ext = this;
+        work->params.var[1]._ext = work;
+        work->state = WorkState::idle;
+        work->refs = 1;
+    }
+#endif
+
+#if FLEXT_SYS == FLEXT_SYS_MAX
     if(queued) qelem = (t_qelem *)qelem_new(this,(method)queuefun);
-#else
+#elif FLEXT_SYS != FLEXT_SYS_PD
     #error Not implemented
 #endif
 }
 
 FLEXT_TEMPIMPL(FLEXT_CLASSDEF(flext))::Timer::~Timer()
+{
+    WHEEL_LOCK();
+    Unschedule();
+    WHEEL_UNLOCK();
+#ifdef FLEXT_THREADS
+    if(work) {
+        // Work may still be running on the worker thread
+        for(;;) {
+            const long st = work->state;
+            if(st == WorkState::idle) break;
+            // Work is waiting for the system lock, which we may be holding: leave it behind
+            if(st == WorkState::locking && lockfree::CAS(&work->state,st,(long)WorkState::orphaned)) break;
+            Sleep(0.001);
+        }
+        Release(work);
+    }
+#endif
+#if FLEXT_SYS == FLEXT_SYS_MAX
+    if(queued) ::qelem_free(qelem);
+#elif FLEXT_SYS != FLEXT_SYS_PD
+    #error Not implemented
+#endif
+}
+
+FLEXT_TEMPIMPL(double FLEXT_CLASSDEF(flext))::Timer::SysTime()
 {
 #if FLEXT_SYS == FLEXT_SYS_PD
-    clock_free(clk);
+    return clock_gettimesince(0);
 #elif FLEXT_SYS == FLEXT_SYS_MAX
-    clock_free(clk);
-    if(queued) ::qelem_free(qelem);
+    double cur;
+    clock_getftime(&cur);
+    return cur;
 #else
     #error Not implemented
 #endif
 }
 
-FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::Timer::Reset()
+/*! \brief Insert timer into the wheel
+    Timers in the current slot go to the (sorted) due list, 
+    the others to the level where their distance from the current slot fits in.
+*/
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::Timer::Place(Timer *tmr)
 {
-#if FLEXT_SYS == FLEXT_SYS_PD
-    clock_unset(clk);
+    Wheel &w = wheel;
+    Link *l = &tmr->link,*at;
+    const double d = floor((tmr->due-w.base)/TIMER_SLOT)-w.tick;
+
+    if(d < 1) {
+        // search from the end, timers are mostly set in increasing order
+        Link *due = w.list+Wheel::slots;
+        for(at = due->prev; at != due && at->tmr->due > tmr->due; at = at->prev) {}
+        l->lev = -1;
+    }
+    else {
+        const unsigned long delta = d < 4294967295. ? (unsigned long)d : 4294967295UL;
+        const unsigned long t = w.pos+delta;
+        if(delta < (1UL<<Wheel::bits0)) {
+            at = w.list+(t&((1<<Wheel::bits0)-1));
+            l->lev = 0;
+            ++w.count0;
+        }
+        else {
+            int lev = 1,shift = Wheel::bits0;
+            while(lev < Wheel::levels-1 && delta >= (1UL<<(shift+Wheel::bitsn))) ++lev,shift += Wheel::bitsn;
+            at = w.list+(1<<Wheel::bits0)+(lev-1)*(1<<Wheel::bitsn)+((t>>shift)&((1<<Wheel::bitsn)-1));
+            l->lev = lev;
+        }
+        // append at the end of the slot
+        at = at->prev;
+    }
+
+    l->prev = at;
+    l->next = at->next;
+    at->next->prev = l;
+    at->next = l;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::Timer::Schedule(double tm)
+{
+    Wheel &w = wheel;
+    WHEEL_LOCK();
+    if(!w.clk) {
+        for(int i = 0; i <= Wheel::slots; ++i) {
+            w.list[i].prev = w.list[i].next = w.list+i;
+            w.list[i].tmr = NULL;
+        }
+        w.clk = (t_clock *)clock_new(NULL,(t_method)Tick);
+    }
+
+    Unschedule();
+    
+    if(!w.total) {
+        // wheel is empty, restart at the current time
+        w.base = SysTime();
+        w.pos = 0;
+        w.tick = 0;
+    }
+
+    due = tm;
+    Place(this);
+    ++w.total;
+
+    if(!w.armed || due < w.next) {
+        double df = due-SysTime();
+        if(df < 0) df = 0;
+#if FLEXT_SYS == FLEXT_SYS_PD 
+        clock_delay(w.clk,df);
 #elif FLEXT_SYS == FLEXT_SYS_MAX
-    clock_unset(clk);
-    if(queued) ::qelem_unset(qelem);
+        clock_fdelay(w.clk,df);
 #else
     #error Not implemented
+#endif
+        w.next = due;
+        w.armed = true;
+    }
+    WHEEL_UNLOCK();
+}
+
+//! \note The wheel must be locked
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::Timer::Unschedule()
+{
+    if(!link.next) return;
+    link.prev->next = link.next;
+    link.next->prev = link.prev;
+    link.prev = link.next = NULL;
+    if(!link.lev) --wheel.count0;
+    --wheel.total;
+    // if the clock is set for this timer, the next tick just finds nothing to do
+}
+
+/*! \brief Advance the current slot up to time now
+    Empty rotations of level 0 are skipped, higher levels are cascaded down when level 0 wraps around.
+*/
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::Timer::Advance(double now)
+{
+    Wheel &w = wheel;
+    const double nt = floor((now-w.base)/TIMER_SLOT);
+    const unsigned long mask0 = (1<<Wheel::bits0)-1;
+
+    while(w.tick < nt) {
+        if(!w.total) {
+            w.base += nt*TIMER_SLOT;
+            w.pos = 0;
+            w.tick = 0;
+            break;
+        }
+
+        if(!w.count0) {
+            // nothing in level 0, skip to the end of its rotation
+            const unsigned long skip = mask0-(w.pos&mask0);
+            if(nt-w.tick <= skip) {
+                w.pos += (unsigned long)(nt-w.tick);
+                w.tick = nt;
+                break;
+            }
+            w.pos += skip;
+            w.tick += skip;
+        }
+
+        ++w.pos;
+        ++w.tick;
+
+        if(!(w.pos&mask0)) {
+            // cascade
+            for(int lev = 1,shift = Wheel::bits0; lev < Wheel::levels; ++lev,shift += Wheel::bitsn) {
+                const int ix = (w.pos>>shift)&((1<<Wheel::bitsn)-1);
+                Link *s = w.list+(1<<Wheel::bits0)+(lev-1)*(1<<Wheel::bitsn)+ix;
+                Link *l = s->next;
+                s->prev = s->next = s;
+                while(l != s) {
+                    Link *nx = l->next;
+                    Place(l->tmr);
+                    l = nx;
+                }
+                if(ix) break;
+            }
+        }
+
+        // move current slot to due list
+        Link *s = w.list+(w.pos&mask0);
+        Link *l = s->next;
+        s->prev = s->next = s;
+        while(l != s) {
+            Link *nx = l->next;
+            --w.count0;
+            Place(l->tmr);
+            l = nx;
+        }
+    }
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::Timer::Arm()
+{
+    Wheel &w = wheel;
+
+    if(!w.total) {
+        if(w.armed) {
+            clock_unset(w.clk);
+            w.armed = false;
+        }
+        return;
+    }
+
+    const unsigned long mask0 = (1<<Wheel::bits0)-1;
+    const Link *due = w.list+Wheel::slots;
+    double nx;
+    if(due->next != due)
+        nx = due->next->tmr->due;
+    else {
+        // next cascading
+        nx = w.base+(w.tick+(mask0+1-(w.pos&mask0)))*TIMER_SLOT;
+
+        if(w.count0) {
+            // look for the next slot in level 0 before the next cascading
+            for(unsigned long p = w.pos+1; p&mask0; ++p) {
+                const Link *s = w.list+(p&mask0);
+                if(s->next != s) {
+                    nx = s->next->tmr->due;
+                    for(const Link *l = s->next->next; l != s; l = l->next)
+                        if(l->tmr->due < nx) nx = l->tmr->due;
+                    break;
+                }
+            }
+        }
+    }
+
+    double df = nx-SysTime();
+    if(df < 0) df = 0;
+#if FLEXT_SYS == FLEXT_SYS_PD 
+    clock_delay(w.clk,df);
+#elif FLEXT_SYS == FLEXT_SYS_MAX
+    clock_fdelay(w.clk,df);
+#else
+    #error Not implemented
+#endif
+    w.next = nx;
+    w.armed = true;
+}
+
+//! \brief Callback function for the system clock of the timer wheel.
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::Timer::Tick(void *)
+{
+    Wheel &w = wheel;
+    WHEEL_LOCK();
+    w.armed = false;
+
+    const double now = SysTime();
+    Advance(now);
+
+    Link *due = w.list+Wheel::slots;
+    while(due->next != due && due->next->tmr->due <= now+TIMER_EPS) {
+        Timer *tmr = due->next->tmr;
+        tmr->Unschedule();
+        WHEEL_UNLOCK();
+        callback(tmr);
+        WHEEL_LOCK();
+    }
+
+    // timers set by the callbacks may have set the clock, but the next event can be earlier
+    Arm();
+    WHEEL_UNLOCK();
+}
+
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::Timer::Reset()
+{
+    WHEEL_LOCK();
+    Unschedule();
+    WHEEL_UNLOCK();
+#if FLEXT_SYS == FLEXT_SYS_MAX
+    if(queued) ::qelem_unset(qelem);
+#elif FLEXT_SYS != FLEXT_SYS_PD
+    #error Not implemented
 #endif
     return true;
 }
@@ -187,23 +595,11 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::Timer::At(double tm,void *data,bool
 {
     userdata = data;
     period = 0;
-#if FLEXT_SYS == FLEXT_SYS_PD 
-    const double systm = clock_gettimesince(0);
-    double df = tm*1000.-systm;
-    if(dopast && df < 0) df = 0;
-    if(df >= 0)
-        clock_delay(clk,df);
-#elif FLEXT_SYS == FLEXT_SYS_MAX
-    const double ms = tm*1000.;
-    double cur;
-    clock_getftime(&cur);
+    const double ms = tm*1000.,cur = SysTime();
     if(cur <= ms)
-        clock_fdelay(clk,ms-cur);
+        Schedule(ms);
     else if(dopast) // trigger timer is past
-        clock_fdelay(clk,0);
-#else
-    #error Not implemented
-#endif
+        Schedule(cur);
     return true;
 }
 
@@ -215,13 +611,7 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::Timer::Delay(double tm,void *data)
 {
     userdata = data;
     period = 0;
-#if FLEXT_SYS == FLEXT_SYS_PD 
-    clock_delay(clk,tm*1000);
-#elif FLEXT_SYS == FLEXT_SYS_MAX
-    clock_fdelay(clk,tm*1000.);
-#else
-    #error Not implemented
-#endif
+    Schedule(SysTime()+tm*1000.);
     return true;
 }
 
@@ -229,48 +619,122 @@ FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::Timer::Delay(double tm,void *data)
     \param data user data
     \return true on success
     \note the first event will be delayed by tm
+    \remark Events are scheduled at absolute multiples of tm, so callback latencies don't accumulate.
 */
 FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::Timer::Periodic(double tm,void *data)
 {
     userdata = data;
 	period = tm;
-#if FLEXT_SYS == FLEXT_SYS_PD 
-    clock_delay(clk,tm*1000.);
-#elif FLEXT_SYS == FLEXT_SYS_MAX
-    clock_fdelay(clk,tm*1000.);
-#else
-    #error Not implemented
-#endif
+    pstart = SysTime();
+    pcount = 1;
+    Schedule(pstart+tm*1000.);
     return true;
 }
 
-//! \brief Callback function for system clock.
+//! \brief Called by the timer wheel for due timers.
 FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::Timer::callback(Timer *tmr)
 {
-#if FLEXT_SYS == FLEXT_SYS_MAX
-    if(tmr->queued) 
-        qelem_set(tmr->qelem);
+#ifdef FLEXT_THREADS
+    if(tmr->work) {
+        WorkState *ws = tmr->work;
+        if(ws->state != WorkState::idle)
+            // Work of the previous event hasn't returned, skip this one
+            ++tmr->overruns;
+        else {
+            tmr->intended = tmr->due;
+            tmr->fired = SysTime();
+            ws->state = WorkState::running;
+            // the worker's reference
+            for(long r; r = ws->refs,!lockfree::CAS(&ws->refs,r,r+1); ) {}
+            if(!LaunchThread(threadfun,&ws->params)) {
+                ws->state = WorkState::idle;
+                Release(ws);
+            }
+        }
+    }
     else
 #endif
-        tmr->Work();
+    {
+        tmr->intended = tmr->due;
+        tmr->fired = SysTime();
 
-    if(tmr->period) {
-		// reschedule
-#if FLEXT_SYS == FLEXT_SYS_PD 
-        clock_delay(tmr->clk,tmr->period*1000.);
-#elif FLEXT_SYS == FLEXT_SYS_MAX
-        clock_fdelay(tmr->clk,tmr->period*1000.);
-#else
-    #error Not implemented
+#if FLEXT_SYS == FLEXT_SYS_MAX
+        if(tmr->queued) 
+            qelem_set(tmr->qelem);
+        else
 #endif
+            tmr->Work();
+    }
+
+    // no rescheduling if the timer has been set anew in the meantime
+    if(tmr->period && !tmr->link.next) {
+		// reschedule on the grid, skip events that are already past
+        const double per = tmr->period*1000.;
+        double nx = tmr->pstart+(++tmr->pcount)*per;
+        const double now = SysTime();
+        if(nx < now) {
+            const unsigned long skip = (unsigned long)((now-nx)/per)+1;
+            tmr->pcount += skip;
+            nx = tmr->pstart+tmr->pcount*per;
+        }
+        tmr->Schedule(nx);
     }
 }
 
 #if FLEXT_SYS == FLEXT_SYS_MAX
 /*! \brief Callback function for low priority clock (for queued messages).
 */
-FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::Timer::queuefun(Timer *tmr) { tmr->Work(); }
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::Timer::queuefun(Timer *tmr) 
+{ 
+    tmr->fired = SysTime();
+    tmr->Work(); 
+}
+#endif
+
+#ifdef FLEXT_THREADS
+//! \brief Thread function for threaded timers.
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::Timer::threadfun(thr_params *p)
+{
+    WorkState *ws = static_cast<WorkState *>(p->var[1]._ext);
+    static_cast<Timer *>(p->var[0]._ext)->Work();
+    // the timer may be gone if Work has returned from a failed WorkLock
+    lockfree::memory_barrier();
+    lockfree::CAS(&ws->state,(long)WorkState::running,(long)WorkState::idle);
+    Release(ws);
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::Timer::Release(WorkState *ws)
+{
+    long r;
+    do r = ws->refs; while(!lockfree::CAS(&ws->refs,r,r-1));
+    if(r == 1) delete ws;
+}
+#endif
+
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::Timer::WorkLock()
+{
+#ifdef FLEXT_THREADS
+    if(work) {
+        WorkState *ws = work;
+        // the destructor doesn't wait for us while we are locking
+        if(!lockfree::CAS(&ws->state,(long)WorkState::running,(long)WorkState::locking)) return false;
+        Lock();
+        if(!lockfree::CAS(&ws->state,(long)WorkState::locking,(long)WorkState::running)) {
+            // orphaned, the timer is gone
+            Unlock();
+            return false;
+        }
+    }
 #endif
+    return true;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::Timer::WorkUnlock()
+{
+#ifdef FLEXT_THREADS
+    if(work) Unlock();
+#endif
+}
 
 /*! \brief Virtual worker function - by default it calls the user callback function.
     \remark The respective callback parameter format is chosen depending on whether clss is defined or not.
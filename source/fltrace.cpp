@@ -0,0 +1,201 @@
+/*
+flext - C++ layer for Max and Pure Data externals
+
+Copyright (c) 2001-2015 Thomas Grill (gr@grrrr.org)
+For information on usage and redistribution, and for a DISCLAIMER OF ALL
+WARRANTIES, see the file, "license.txt," in this distribution.
+*/
+
+/*! \file fltrace.cpp
+    \brief Event tracing into per-thread ring buffers, exported in Chrome trace event format.
+*/
+
+#ifndef __FLEXT_TRACE_CPP
+#define __FLEXT_TRACE_CPP
+
+#include "flext.h"
+#include "lockfree/cas.hpp"
+#include <cstdio>
+
+#include "flpushns.h"
+
+#ifdef FLEXT_TRACE
+
+#ifndef FLEXT_TRACE_EVENTS
+//! Number of events kept per thread (power of 2)
+#define FLEXT_TRACE_EVENTS 4096
+#endif
+
+/*! \brief Events of one thread
+    \note Only the owning thread writes, the ring is read by TraceDump while being written.
+*/
+class TraceRing
+{
+public:
+    struct Event {
+        flext::t_uint64 start,end;
+        const char *cat,*name,*obj;
+    };
+
+    TraceRing(int id,const char *n): tid(id),name(n),count(0),nxt(NULL) {}
+
+    inline void Put(const char *cat,const char *name,const char *obj,flext::t_uint64 start,flext::t_uint64 end)
+    {
+        Event &e = events[count&(FLEXT_TRACE_EVENTS-1)];
+        e.start = start,e.end = end;
+        e.cat = cat,e.name = name,e.obj = obj;
+        lockfree::memory_barrier();
+        count = count+1;
+    }
+
+    Event events[FLEXT_TRACE_EVENTS];
+    const int tid;
+    const char *volatile name;
+    //! number of events written so far
+    volatile unsigned long count;
+#ifdef FLEXT_THREADS
+    flext::thrid_t thrid;
+#endif
+    TraceRing *nxt;
+};
+
+FLEXT_TEMPLATE
+struct TraceVars {
+    //! rings of all threads, never unlinked
+    static TraceRing *volatile rings;
+    static volatile long threads;
+    //! time origin of the trace
+    static flext::t_uint64 origin;
+#ifdef FLEXT_THREADLOCAL
+    static FLEXT_THREADLOCAL TraceRing *ring;
+#endif
+};
+
+FLEXT_TEMPIMPL(TraceRing *volatile TraceVars)::rings = NULL;
+FLEXT_TEMPIMPL(volatile long TraceVars)::threads = 0;
+FLEXT_TEMPIMPL(flext::t_uint64 TraceVars)::origin = 0;
+#ifdef FLEXT_THREADLOCAL
+FLEXT_TEMPIMPL(FLEXT_THREADLOCAL TraceRing *TraceVars)::ring = NULL;
+#endif
+
+//! Get the ring of the current thread, creating it on first use
+FLEXT_TEMPLATE TraceRing *TraceGet()
+{
+    TraceRing *r;
+#ifdef FLEXT_THREADLOCAL
+    if(LIKELY((r = FLEXT_TEMPINST(TraceVars)::ring) != NULL)) return r;
+#elif defined(FLEXT_THREADS)
+    // without thread-local storage search by thread id
+    const flext::thrid_t id = flext::GetThreadId();
+    for(r = FLEXT_TEMPINST(TraceVars)::rings; r; r = r->nxt)
+        if(flext::IsThread(r->thrid,id)) return r;
+#else
+    if(LIKELY((r = FLEXT_TEMPINST(TraceVars)::rings) != NULL)) return r;
+#endif
+
+    long id;
+    do id = FLEXT_TEMPINST(TraceVars)::threads;
+    while(!lockfree::CAS(&FLEXT_TEMPINST(TraceVars)::threads,id,id+1));
+    if(!id) FLEXT_TEMPINST(TraceVars)::origin = flext::GetTimeNs();
+
+#ifdef FLEXT_THREADS
+    r = new TraceRing((int)id+1,flext::IsSystemThread()?"system":"thread");
+    r->thrid = flext::GetThreadId();
+#else
+    r = new TraceRing((int)id+1,"system");
+#endif
+    do r->nxt = FLEXT_TEMPINST(TraceVars)::rings;
+    while(!lockfree::CAS(&FLEXT_TEMPINST(TraceVars)::rings,r->nxt,r));
+#ifdef FLEXT_THREADLOCAL
+    FLEXT_TEMPINST(TraceVars)::ring = r;
+#endif
+    return r;
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::TraceEvent(const char *cat,const char *name,const char *obj,t_uint64 start,t_uint64 end)
+{
+    FLEXT_TEMPINST(TraceGet)()->Put(cat,name,obj,start,end);
+}
+
+FLEXT_TEMPIMPL(void FLEXT_CLASSDEF(flext))::TraceThread(const char *name)
+{
+    FLEXT_TEMPINST(TraceGet)()->name = name;
+}
+
+//! Write a JSON string
+static void TraceString(FILE *f,const char *s)
+{
+    fputc('"',f);
+    for(; *s; ++s) {
+        const unsigned char c = (unsigned char)*s;
+        if(c == '"' || c == '\\') fprintf(f,"\\%c",c);
+        else if(c < 0x20) fprintf(f,"\\u%04x",c);
+        else fputc(c,f);
+    }
+    fputc('"',f);
+}
+
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext))::TraceDump(const char *filename)
+{
+    FILE *f = fopen(filename,"w");
+    if(!f) return false;
+
+    const t_uint64 origin = FLEXT_TEMPINST(TraceVars)::origin;
+    TraceRing::Event *evs = new TraceRing::Event[FLEXT_TRACE_EVENTS];
+    bool first = true;
+
+    fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n",f);
+    for(TraceRing *r = FLEXT_TEMPINST(TraceVars)::rings; r; r = r->nxt) {
+        fprintf(f,"%s{\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"name\":\"thread_name\",\"args\":{\"name\":",first?"":",\n",r->tid);
+        TraceString(f,r->name);
+        fputs("}}",f);
+        first = false;
+
+        // copy the events, then skip those which have been overwritten meanwhile
+        const unsigned long end = r->count;
+        unsigned long begin = end > FLEXT_TRACE_EVENTS?end-FLEXT_TRACE_EVENTS:0;
+        lockfree::memory_barrier();
+        for(unsigned long i = begin; i < end; ++i) evs[i-begin] = r->events[i&(FLEXT_TRACE_EVENTS-1)];
+        lockfree::memory_barrier();
+        const unsigned long now = r->count;
+        const unsigned long valid = now > FLEXT_TRACE_EVENTS?now-FLEXT_TRACE_EVENTS+1:0;
+
+        for(unsigned long i = valid > begin?valid:begin; i < end; ++i) {
+            const TraceRing::Event &e = evs[i-begin];
+            // timestamps in microseconds
+            fprintf(f,",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%i,\"ts\":%.3f,\"dur\":%.3f,\"cat\":",
+                r->tid,e.start > origin?(e.start-origin)*1.e-3:0.,(e.end-e.start)*1.e-3);
+            TraceString(f,e.cat);
+            fputs(",\"name\":",f);
+            TraceString(f,e.name);
+            if(e.obj) {
+                fputs(",\"args\":{\"object\":",f);
+                TraceString(f,e.obj);
+                fputc('}',f);
+            }
+            fputc('}',f);
+        }
+    }
+    fputs("\n]}\n",f);
+
+    delete[] evs;
+    return fclose(f) == 0;
+}
+
+FLEXT_TEMPIMPL(bool FLEXT_CLASSDEF(flext_base))::cb_TraceDump(flext_base *c,int argc,const t_atom *argv)
+{
+    if(argc > 1 || (argc == 1 && !IsSymbol(argv[0]))) return false;
+
+    const char *filename = argc?GetString(argv[0]):"flext-trace.json";
+    if(TraceDump(filename))
+        post("%s - trace written to %s",c->thisName(),filename);
+    else
+        error("%s - could not write trace to %s",c->thisName(),filename);
+    return true;
+}
+
+#endif // FLEXT_TRACE
+
+#include "flpopns.h"
+
+#endif // __FLEXT_TRACE_CPP
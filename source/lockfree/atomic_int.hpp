@@ -30,7 +30,67 @@
 namespace lockfree
 {
 
-#if defined(__GNUC__) && ( (__GNUC__ > 4) || ((__GNUC__ >= 4) && (__GNUC_MINOR__ >= 1)) )
+#if LOCKFREE_ATOMIC_BUILTINS
+
+/* sequentially consistent, like std::atomic, but loads and stores don't need a locked instruction */
+template <typename T>
+class atomic_int
+{
+public:
+    explicit atomic_int(T v = 0):
+        value(v)
+    {
+    }
+
+    operator T(void) const
+    {
+        return __atomic_load_n(&value, __ATOMIC_SEQ_CST);
+    }
+
+    void operator =(T v)
+    {
+        __atomic_store_n(&value, v, __ATOMIC_SEQ_CST);
+    }
+
+    T operator +=(T v)
+    {
+        return __atomic_add_fetch(&value, v, __ATOMIC_SEQ_CST);
+    }
+
+    T operator -=(T v)
+    {
+        return __atomic_sub_fetch(&value, v, __ATOMIC_SEQ_CST);
+    }
+
+    /* prefix operator */
+    T operator ++(void)
+    {
+        return __atomic_add_fetch(&value, 1, __ATOMIC_SEQ_CST);
+    }
+
+    /* prefix operator */
+    T operator --(void)
+    {
+        return __atomic_sub_fetch(&value, 1, __ATOMIC_SEQ_CST);
+    }
+
+    /* postfix operator */
+    T operator ++(int)
+    {
+        return __atomic_fetch_add(&value, 1, __ATOMIC_SEQ_CST);
+    }
+
+    /* postfix operator */
+    T operator --(int)
+    {
+        return __atomic_fetch_sub(&value, 1, __ATOMIC_SEQ_CST);
+    }
+
+private:
+    T value;
+};
+
+#elif defined(__GNUC__) && ( (__GNUC__ > 4) || ((__GNUC__ >= 4) && (__GNUC_MINOR__ >= 1)) )
 
 template <typename T>
 class atomic_int
@@ -233,6 +293,34 @@ private:
 
 #endif
 
+struct padded_atomic_int_pad
+{
+    char pad_[LOCKFREE_CACHELINE];
+};
+
+/** atomic_int on a cache line of its own
+ *
+ *  for counters which are written by other threads than the surrounding data */
+template <typename T>
+class padded_atomic_int:
+    private padded_atomic_int_pad,
+    public atomic_int<T>
+{
+public:
+    explicit padded_atomic_int(T v = 0):
+        atomic_int<T>(v)
+    {
+    }
+
+    void operator =(T v)
+    {
+        atomic_int<T>::operator =(v);
+    }
+
+private:
+    char pad_[LOCKFREE_CACHELINE];
+};
+
 } // namespace lockfree
 
 #endif /* __LOCKFREE_ATOMIC_INT_HPP */
@@ -30,12 +30,132 @@
 
 #include <cstddef>
 
+/* On 64-bit targets with 48-bit user address space the tag is packed into the upper pointer bits,
+   so that a single-width CAS suffices (no cmpxchg16b/casp needed).
+   AArch64 targets tagging heap pointers in the top byte (Android heap tagging, MTE, HWASan)
+   use the pointer/tag pair with double-width CAS, as do all targets with LOCKFREE_DWCAS defined. */
+#if defined(__aarch64__) && (defined(__ANDROID__) || defined(__ARM_FEATURE_MEMORY_TAGGING) || defined(__SANITIZE_HWADDRESS__))
+#   define LOCKFREE_TAGGED_HEAP 1
+#elif defined(__aarch64__) && defined(__has_feature)
+#   if __has_feature(hwaddress_sanitizer)
+#       define LOCKFREE_TAGGED_HEAP 1
+#   endif
+#endif
+
+#if !defined(LOCKFREE_PACKED_PTR) && !defined(LOCKFREE_DWCAS) && !defined(LOCKFREE_TAGGED_HEAP) && \
+    (defined(__x86_64__) || defined(__aarch64__) || defined(_M_X64) || defined(_M_ARM64))
+#   define LOCKFREE_PACKED_PTR 1
+#endif
+
+/* The pointer/tag pair must be aligned to its size for the double-width CAS (cmpxchg16b, casp).
+   LOCKFREE_PTR_ALIGNED can also be applied to raw storage of structures containing an atomic_ptr,
+   LOCKFREE_PTR_ALIGN is the required alignment in bytes. */
+#if LOCKFREE_PACKED_PTR
+#   define LOCKFREE_PTR_ALIGN 8
+#   define LOCKFREE_PTR_ALIGNED
+#else
+#   if defined(__LP64__) || defined(_WIN64)
+#       define LOCKFREE_PTR_ALIGN 16
+#       ifdef _MSC_VER
+#           define LOCKFREE_PTR_ALIGNED __declspec(align(16))
+#       else
+#           define LOCKFREE_PTR_ALIGNED __attribute__((aligned(16)))
+#       endif
+#   else
+#       define LOCKFREE_PTR_ALIGN 8
+#       ifdef _MSC_VER
+#           define LOCKFREE_PTR_ALIGNED __declspec(align(8))
+#       else
+#           define LOCKFREE_PTR_ALIGNED __attribute__((aligned(8)))
+#       endif
+#   endif
+#endif
+
 namespace lockfree
 {
     using std::size_t;
 
+#if LOCKFREE_PACKED_PTR
+
+    /** pointer with a 16 bit ABA tag in the upper bits of one machine word
+     *
+     *  \note user space pointers must not use the upper 16 bits (no top-byte tagging) */
     template <class T>
     class atomic_ptr
+    {
+        enum { tag_shift = 48 };
+
+        static inline size_t pack(const T *p,size_t t)
+        {
+            assert((reinterpret_cast<size_t>(p)>>tag_shift) == 0);
+            return reinterpret_cast<size_t>(p)|(t<<tag_shift);
+        }
+
+    public:
+        atomic_ptr(): word(0) {}
+
+        atomic_ptr(const atomic_ptr &p): word(p.word) {}
+
+        atomic_ptr(T *p,size_t t = 0): word(pack(p,t)) {}
+
+        /** atomic set operation */
+        inline atomic_ptr &operator =(const atomic_ptr &p)
+        {
+            for (;;)
+            {
+                size_t current = word;
+
+                if(likely(lockfree::CAS(&word,current,p.word)))
+                    return *this;
+            }
+        }
+
+        inline atomic_ptr &operator()(T *p,size_t t)
+        {
+            return operator=(atomic_ptr(p, t) );
+        }
+
+
+        inline bool operator ==(const atomic_ptr &p) const { return word == p.word; }
+
+        inline bool operator !=(const atomic_ptr &p) const { return !operator ==(p); }
+
+
+        inline T * getPtr() const { return reinterpret_cast<T *>(word&((size_t(1)<<tag_shift)-1)); }
+
+        inline void setPtr(T * p) { word = pack(p,getTag()); }
+
+
+        inline size_t getTag() const { return word>>tag_shift; }
+
+        inline void setTag(size_t t) { word = pack(getPtr(),t&0xffff); }
+
+        inline size_t incTag() { setTag(getTag()+1); return getTag(); }
+
+
+        inline bool CAS(const atomic_ptr &oldval,const atomic_ptr &newval,memory_order order = order_seq_cst)
+        {
+            return lockfree::CAS(&word,oldval.word,newval.word,order);
+        }
+
+        inline bool CAS(const atomic_ptr &oldval,T *newptr,memory_order order = order_seq_cst)
+        {
+            return lockfree::CAS(&word,oldval.word,pack(newptr,(oldval.getTag()+1)&0xffff),order);
+        }
+
+        inline bool CAS(const T *oldptr,size_t oldtag,T *newptr,memory_order order = order_seq_cst)
+        {
+            return lockfree::CAS(&word,pack(oldptr,oldtag),pack(newptr,(oldtag+1)&0xffff),order);
+        }
+
+    protected:
+        size_t volatile word;
+    };
+
+#else
+
+    template <class T>
+    class LOCKFREE_PTR_ALIGNED atomic_ptr
     {
     public:
         atomic_ptr() {}
@@ -79,17 +199,19 @@ namespace lockfree
         inline size_t incTag() { return ++tag; }
 
 
-        inline bool CAS(const atomic_ptr &oldval,const atomic_ptr &newval)
+        /* the double-width CAS is always a full barrier */
+
+        inline bool CAS(const atomic_ptr &oldval,const atomic_ptr &newval,memory_order = order_seq_cst)
         {
             return lockfree::CAS2(this,oldval.ptr,oldval.tag,newval.ptr,newval.tag);
         }
 
-        inline bool CAS(const atomic_ptr &oldval,T *newptr)
+        inline bool CAS(const atomic_ptr &oldval,T *newptr,memory_order = order_seq_cst)
         {
             return lockfree::CAS2(this,oldval.ptr,oldval.tag,newptr,oldval.tag+1);
         }
 
-        inline bool CAS(const T *oldptr,size_t oldtag,T *newptr)
+        inline bool CAS(const T *oldptr,size_t oldtag,T *newptr,memory_order = order_seq_cst)
         {
             return lockfree::CAS2(this,oldptr,oldtag,newptr,oldtag+1);
         }
@@ -99,6 +221,8 @@ namespace lockfree
         size_t volatile tag;
     };
 
+#endif
+
 } // namespace
 
 #endif /* __LOCKFREE_ATOMIC_PTR_HPP */
@@ -34,9 +34,50 @@
 
 namespace lockfree
 {
+    /** ordering of the ordered operations, as std::memory_order
+     *
+     *  without the memory model backend (see prefix.hpp) all of them are full barriers */
+    enum memory_order
+    {
+        order_relaxed,
+        order_acquire,
+        order_release,
+        order_acq_rel,
+        order_seq_cst
+    };
+
+#if LOCKFREE_ATOMIC_BUILTINS
+    inline int builtin_order(memory_order o)
+    {
+        switch(o) {
+        case order_relaxed: return __ATOMIC_RELAXED;
+        case order_acquire: return __ATOMIC_ACQUIRE;
+        case order_release: return __ATOMIC_RELEASE;
+        case order_acq_rel: return __ATOMIC_ACQ_REL;
+        default: return __ATOMIC_SEQ_CST;
+        }
+    }
+
+    /** ordering of a failed CAS, which is only a load */
+    inline int builtin_failure_order(memory_order o)
+    {
+        switch(o) {
+        case order_relaxed:
+        case order_release: return __ATOMIC_RELAXED;
+        case order_acquire:
+        case order_acq_rel: return __ATOMIC_ACQUIRE;
+        default: return __ATOMIC_SEQ_CST;
+        }
+    }
+#endif
+
     inline void memory_barrier()
     {
-#if defined(__GNUC__) && ( (__GNUC__ > 4) || ((__GNUC__ >= 4) && (__GNUC_MINOR__ >= 1)) )
+#if LOCKFREE_STD_ATOMIC
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+#elif LOCKFREE_ATOMIC_BUILTINS
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#elif defined(__GNUC__) && ( (__GNUC__ > 4) || ((__GNUC__ >= 4) && (__GNUC_MINOR__ >= 1)) )
         __sync_synchronize();
 #elif defined(__GNUC__) && (defined(__i386__) || defined(__i686__))
 		asm("" : : : "memory");
@@ -51,14 +92,68 @@ namespace lockfree
 #endif
     }
 
+    /** barrier between preceding loads and the following loads and stores */
+    inline void acquire_barrier()
+    {
+#if LOCKFREE_STD_ATOMIC
+        std::atomic_thread_fence(std::memory_order_acquire);
+#elif LOCKFREE_ATOMIC_BUILTINS
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+#else
+        memory_barrier();
+#endif
+    }
+
+    /** barrier between preceding loads and stores and the following stores */
+    inline void release_barrier()
+    {
+#if LOCKFREE_STD_ATOMIC
+        std::atomic_thread_fence(std::memory_order_release);
+#elif LOCKFREE_ATOMIC_BUILTINS
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+#else
+        memory_barrier();
+#endif
+    }
+
+    template <class T>
+    inline T load_acquire(volatile const T * addr)
+    {
+#if LOCKFREE_ATOMIC_BUILTINS
+        return __atomic_load_n(addr,__ATOMIC_ACQUIRE);
+#else
+        T v = *addr;
+        acquire_barrier();
+        return v;
+#endif
+    }
+
+    template <class T, class D>
+    inline void store_release(volatile T * addr,D v)
+    {
+#if LOCKFREE_ATOMIC_BUILTINS
+        __atomic_store_n(addr,(T)v,__ATOMIC_RELEASE);
+#else
+        release_barrier();
+        *addr = v;
+#endif
+    }
+
     template <class C, class D>
     inline bool CAS(volatile C * addr,D old,D nw)
     {
-#if defined(__GNUC__) && ( (__GNUC__ > 4) || ((__GNUC__ >= 4) && (__GNUC_MINOR__ >= 1)) )
+#if LOCKFREE_ATOMIC_BUILTINS
+        C expected = (C)old;
+        return __atomic_compare_exchange_n(addr,&expected,(C)nw,false,__ATOMIC_SEQ_CST,__ATOMIC_SEQ_CST);
+#elif defined(__GNUC__) && ( (__GNUC__ > 4) || ((__GNUC__ >= 4) && (__GNUC_MINOR__ >= 1)) )
         return __sync_bool_compare_and_swap(addr, old, nw);
 #elif defined(_MSC_VER)
+        if(sizeof(D) == 8) {
+            assert((size_t(addr)&7) == 0);
+            return _InterlockedCompareExchange64(reinterpret_cast<volatile __int64 *>(addr),(__int64)nw,(__int64)old) == (__int64)old;
+        }
         assert((size_t(addr)&3) == 0);  // a runtime check only for debug mode is somehow insufficient....
-        return _InterlockedCompareExchange(addr,nw,old) == old;
+        return _InterlockedCompareExchange(reinterpret_cast<volatile LONG *>(addr),(LONG)nw,(LONG)old) == (LONG)old;
 #elif defined(_WIN32) || defined(_WIN64)
         assert((size_t(addr)&3) == 0);  // a runtime check only for debug mode is somehow insufficient....
         return InterlockedCompareExchange(addr,nw,old) == old;
@@ -101,11 +196,25 @@ namespace lockfree
 
     }
 
+    /** CAS with the given ordering (full barrier without the memory model backend) */
+    template <class C, class D>
+    inline bool CAS(volatile C * addr,D old,D nw,memory_order order)
+    {
+#if LOCKFREE_ATOMIC_BUILTINS
+        C expected = (C)old;
+        return __atomic_compare_exchange_n(addr,&expected,(C)nw,false,builtin_order(order),builtin_failure_order(order));
+#else
+        (void)order;
+        return CAS(addr,old,nw);
+#endif
+    }
+
 
     template <class C, class D, class E>
     inline bool CAS2(C * addr,D old1,E old2,D new1,E new2)
     {
-#if defined(__GNUC__) && ((__GNUC__ > 4) || ( (__GNUC__ >= 4) && (__GNUC_MINOR__ >= 2) ) ) && (defined(__i686__) || defined(__pentiumpro__) || defined(__nocona__) || defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_8))
+#if defined(__GNUC__) && ((__GNUC__ > 4) || ( (__GNUC__ >= 4) && (__GNUC_MINOR__ >= 2) ) ) && (defined(__i686__) || defined(__pentiumpro__) || defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_8)) && !defined(__LP64__)
+        /* 2x32 bits */
         struct packed_c
         {
             D d;
@@ -129,7 +238,8 @@ namespace lockfree
         return __sync_bool_compare_and_swap_8(reinterpret_cast<volatile long long*>(addr),
             old.l,
             nw.l);
-#elif defined(__GNUC__) && ((__GNUC__ >  4) || ( (__GNUC__ >= 4) && (__GNUC_MINOR__ >= 2) ) ) && (defined(__x86_64__) || defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16))
+#elif defined(__GNUC__) && ((__GNUC__ >  4) || ( (__GNUC__ >= 4) && (__GNUC_MINOR__ >= 2) ) ) && defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16)
+        /* 2x64 bits, needs -mcx16 on x86_64 */
         struct packed_c
         {
             D d;
@@ -139,7 +249,7 @@ namespace lockfree
         union cu
         {
             packed_c c;
-            long long l;
+            __int128 l;
         };
 
         cu old;
@@ -150,7 +260,7 @@ namespace lockfree
         nw.c.d = new1;
         nw.c.e = new2;
 
-        return __sync_bool_compare_and_swap_16(reinterpret_cast<volatile long long*>(addr),
+        return __sync_bool_compare_and_swap_16(reinterpret_cast<volatile __int128*>(addr),
             old.l,
             nw.l);
 #elif defined(_MSC_VER)
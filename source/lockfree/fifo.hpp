@@ -33,6 +33,7 @@
 
 #include "cas.hpp"
 #include "atomic_ptr.hpp"
+#include "hazard.hpp"
 #include "branch_hints.hpp"
 
 #ifdef HAVE_BOOST
@@ -57,8 +58,14 @@ namespace lockfree
     {
         intrusive_fifo_ptr_t next;
         struct fifo_node * data;
+        intrusive_fifo_node * link; /* for reclamation */
+        unsigned tag; /* set by enqueue, see dequeue_untagged */
     };
 
+    /** nodes leaving a fifo are retired there and handed out again
+     *  once no other thread can dereference them */
+    typedef hazard_domain<intrusive_fifo_node> fifo_hazards;
+
     struct fifo_node
     {
         intrusive_fifo_node *volatile node;
@@ -104,62 +111,88 @@ namespace lockfree
             return head_.getPtr() == tail_.getPtr() || (!tail_.getPtr());
         }
 
-        void enqueue(T * instance)
+        void enqueue(T * instance, unsigned tag = 0)
         {
             /* volatile */ intrusive_fifo_node * node = static_cast<fifo_node*>(instance)->node;
             node->next.setPtr(NULL);
             node->data = static_cast<fifo_node*>(instance);
+            node->tag = tag;
+
+            fifo_hazards::record * hr = fifo_hazards::get();
 
             for (;;)
             {
-                intrusive_fifo_ptr_t tail(tail_);
-                memory_barrier();
+                intrusive_fifo_ptr_t tail(fifo_hazards::protect(hr,0,tail_));
 
                 intrusive_fifo_ptr_t next(tail.getPtr()->next);
-                memory_barrier();
+                acquire_barrier();
 
                 if (likely(tail == tail_))
                 {
                     if (next.getPtr() == 0)
                     {
-                        if (tail.getPtr()->next.CAS(next,node))
+                        /* publishes the node's data */
+                        if (tail.getPtr()->next.CAS(next,node,order_acq_rel))
                         {
-                            tail_.CAS(tail,node);
+                            tail_.CAS(tail,node,order_acq_rel);
+                            fifo_hazards::clear(hr);
                             return;
                         }
                     }
                     else
-                        tail_.CAS(tail,next);
+                        tail_.CAS(tail,next,order_acq_rel);
                 }
             }
         }
 
         T* dequeue (void)
         {
+            return dequeue_untagged(0);
+        }
+
+        /** dequeue the first element unless its tag (see enqueue) has one of the given bits set
+         *
+         *  the tag is kept in the (protected) list node, the element itself is not touched
+         *  before it has been taken out */
+        T* dequeue_untagged (unsigned tags)
+        {
+            fifo_hazards::record * hr = fifo_hazards::get();
+
             T * ret;
             for (;;)
             {
-                intrusive_fifo_ptr_t head(head_);
-                memory_barrier();
+                intrusive_fifo_ptr_t head(fifo_hazards::protect(hr,0,head_));
 
                 intrusive_fifo_ptr_t tail(tail_);
                 /* volatile */ intrusive_fifo_node * next = head.getPtr()->next.getPtr();
-                memory_barrier();
+                fifo_hazards::set(hr,1,next);
 
                 if (likely(head == head_))
                 {
                     if (head.getPtr() == tail.getPtr())
                     {
                         if (next == 0)
+                        {
+                            fifo_hazards::clear(hr);
                             return 0;
-                        tail_.CAS(tail,next);
+                        }
+                        tail_.CAS(tail,next,order_acq_rel);
                     }
                     else
                     {
+                        if (next->tag & tags)
+                        {
+                            /* the first element stays */
+                            fifo_hazards::clear(hr);
+                            return 0;
+                        }
                         ret = static_cast<T*>(next->data);
-                        if (head_.CAS(head,next))
+                        if (head_.CAS(head,next,order_acq_rel))
                         {
-                            ret->node = head.getPtr();
+                            fifo_hazards::clear(hr);
+                            /* the old dummy may still be read by others, hand over a safe node instead */
+                            ret->node = fifo_hazards::alloc(hr);
+                            fifo_hazards::retire(hr,head.getPtr());
                             return ret;
                         }
                     }
@@ -167,8 +200,89 @@ namespace lockfree
             }
         }
 
+        /** detached elements, obtained from dequeue_all
+         *
+         *  the elements must be fetched completely (by the consumer only),
+         *  after that they can be reused (and enqueued again) */
+        class chain
+        {
+        public:
+            chain(void): cur(0),end(0),last(0) {}
+
+            bool empty() const
+            {
+                return cur == end;
+            }
+
+            T* next (void)
+            {
+                if (cur == end)
+                    return 0;
+                intrusive_fifo_node * n = cur->next.getPtr();
+                /* the end node is the queue's new dummy and may already be reused */
+                T * ret = n == end?last:static_cast<T*>(n->data);
+                /* same node handover as in dequeue */
+                fifo_hazards::record * hr = fifo_hazards::get();
+                ret->node = fifo_hazards::alloc(hr);
+                fifo_hazards::retire(hr,cur);
+                cur = n;
+                return ret;
+            }
+
+        private:
+            chain(intrusive_fifo_node * c,intrusive_fifo_node * e,T * l): cur(c),end(e),last(l) {}
+
+            intrusive_fifo_node * cur, * end;
+            T * last;
+
+            friend class intrusive_fifo;
+        };
+
+        /** detach all elements present with a single CAS on the head pointer */
+        chain dequeue_all (void)
+        {
+            fifo_hazards::record * hr = fifo_hazards::get();
+
+            for (;;)
+            {
+                intrusive_fifo_ptr_t head(fifo_hazards::protect(hr,0,head_));
+                intrusive_fifo_ptr_t tail(fifo_hazards::protect(hr,1,tail_));
+                /* volatile */ intrusive_fifo_node * next = head.getPtr()->next.getPtr();
+                acquire_barrier();
+
+                if (likely(head == head_))
+                {
+                    if (head.getPtr() == tail.getPtr())
+                    {
+                        if (next == 0)
+                        {
+                            fifo_hazards::clear(hr);
+                            return chain();
+                        }
+                        tail_.CAS(tail,next,order_acq_rel);
+                    }
+                    else
+                    {
+                        /* the tail node becomes the new dummy, so its data must be read before */
+                        T * last = static_cast<T*>(tail.getPtr()->data);
+                        if (head_.CAS(head,tail.getPtr(),order_acq_rel))
+                        {
+                            fifo_hazards::clear(hr);
+                            return chain(head.getPtr(),tail.getPtr(),last);
+                        }
+                    }
+                }
+            }
+        }
+
     private:
-        intrusive_fifo_ptr_t head_,tail_;
+        /* head (consumers) and tail (producers) are kept on separate cache lines,
+         * also apart from the neighbours of the fifo */
+        char pad0_[LOCKFREE_CACHELINE];
+        intrusive_fifo_ptr_t head_;
+        char pad1_[LOCKFREE_CACHELINE];
+        intrusive_fifo_ptr_t tail_;
+        char pad2_[LOCKFREE_CACHELINE];
     };
 
     template <typename T>
@@ -0,0 +1,283 @@
+//  $Id$
+//
+//  Copyright (C) 2015 Thomas Grill
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; see the file COPYING.  If not, write to
+//  the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+//  Boston, MA 02111-1307, USA.
+
+//  $Revision$
+//  $LastChangedRevision$
+//  $LastChangedDate$
+//  $LastChangedBy$
+
+#ifndef __LOCKFREE_HAZARD_HPP
+#define __LOCKFREE_HAZARD_HPP
+
+#include "cas.hpp"
+#include "branch_hints.hpp"
+
+#ifndef _WIN32
+#   include <sched.h>
+#endif
+
+#ifndef LOCKFREE_HAZARD_RECORDS
+/* maximum number of threads concurrently using a hazard domain */
+#   define LOCKFREE_HAZARD_RECORDS 256
+#endif
+
+namespace lockfree
+{
+    /** hazard pointers (M. Michael, 2004) for nodes of type Node
+     *
+     *  every thread owns a record with K slots, announcing the nodes it is about to dereference.
+     *  nodes removed from a structure are retired and only recycled (or deleted)
+     *  once no slot refers to them any more.
+     *  Node must be default constructible and provide a member Node *link, used while it is retired or spare.
+     *
+     *  records are bound to threads on first use and released at thread exit
+     *  (pthreads: automatically, otherwise call detach). */
+    template <class Node, int K = 2>
+    class hazard_domain
+    {
+    public:
+        struct record
+        {
+            Node * volatile hp[K];
+            volatile long active;
+
+            /* owned by the thread holding the record */
+            Node * retired;
+            Node * spare;
+            int nretired, nspare;
+
+            /* records are written by different threads, keep them on separate cache lines */
+            char pad[LOCKFREE_CACHELINE];
+        };
+
+        /** get the record of the current thread */
+        static inline record * get(void)
+        {
+            record * r = tls_get();
+            return likely(r != 0)?r:acquire();
+        }
+
+        /** read src into a hazard slot, until it's stable */
+        template <class P>
+        static inline P protect(record * r,int slot,const P & src)
+        {
+            for (;;)
+            {
+                P p(src);
+                r->hp[slot] = p.getPtr();
+                memory_barrier();
+                if (likely(p == src))
+                    return p;
+            }
+        }
+
+        /** announce a node which the caller validates itself */
+        static inline void set(record * r,int slot,Node * n)
+        {
+            r->hp[slot] = n;
+            memory_barrier();
+        }
+
+        static inline void clear(record * r)
+        {
+            /* the node accesses are done before the hazards are dropped */
+            release_barrier();
+            for (int i = 0; i < K; ++i)
+                r->hp[i] = 0;
+        }
+
+        /** get a node nobody else refers to (recycled if possible) */
+        static inline Node * alloc(record * r)
+        {
+            Node * n = r->spare;
+            if (likely(n != 0))
+            {
+                r->spare = n->link;
+                --r->nspare;
+                return n;
+            }
+            return new Node();
+        }
+
+        /** retire a node which has been unlinked from the structure */
+        static inline void retire(record * r,Node * n)
+        {
+            n->link = r->retired;
+            r->retired = n;
+            if (unlikely(++r->nretired >= threshold()))
+                scan(r);
+        }
+
+        /** release the record of the current thread */
+        static void detach(void)
+        {
+            record * r = tls_get();
+            if (r)
+            {
+                tls_set(0);
+                release(r);
+            }
+        }
+
+    private:
+        /* scan when there are about twice as many retired nodes as hazard slots in use */
+        static inline int threshold(void) { return 2*K*used+8; }
+
+        static void scan(record * r)
+        {
+            Node * haz[LOCKFREE_HAZARD_RECORDS*K];
+            int nhaz = 0;
+
+            memory_barrier();
+            const int u = used;
+            for (int i = 0; i < u; ++i)
+                for (int k = 0; k < K; ++k)
+                {
+                    Node * h = records[i].hp[k];
+                    if (h) haz[nhaz++] = h;
+                }
+
+            Node * keep = 0;
+            int nkeep = 0;
+            const int maxspare = 2*threshold();
+
+            for (Node * n = r->retired, * nx; n; n = nx)
+            {
+                nx = n->link;
+
+                int i = 0;
+                while (i < nhaz && haz[i] != n) ++i;
+
+                if (i < nhaz)
+                {
+                    /* still in use */
+                    n->link = keep;
+                    keep = n;
+                    ++nkeep;
+                }
+                else if (r->nspare < maxspare)
+                {
+                    n->link = r->spare;
+                    r->spare = n;
+                    ++r->nspare;
+                }
+                else
+                    delete n;
+            }
+
+            r->retired = keep;
+            r->nretired = nkeep;
+        }
+
+        static record * acquire(void)
+        {
+            for (;;)
+            {
+                for (int i = 0; i < LOCKFREE_HAZARD_RECORDS; ++i)
+                {
+                    record * r = records+i;
+                    if (!r->active && CAS(&r->active,0L,1L))
+                    {
+                        /* make the record visible to scans before it is used */
+                        for (;;)
+                        {
+                            const int u = used;
+                            if (u > i || CAS(&used,(long)u,(long)(i+1)))
+                                break;
+                        }
+                        memory_barrier();
+                        tls_set(r);
+                        return r;
+                    }
+                }
+
+                /* all records taken, wait for a thread to exit */
+#ifdef _WIN32
+                Sleep(0);
+#else
+                sched_yield();
+#endif
+            }
+        }
+
+        static void release(record * r)
+        {
+            clear(r);
+            /* retired and spare nodes are passed on to the next owner */
+            release_barrier();
+            r->active = 0;
+        }
+
+#ifdef _WIN32
+        static inline void tls_init(void)
+        {
+            if (likely(keystate == 2))
+                return;
+            if (CAS(&keystate,0L,1L))
+            {
+                key = TlsAlloc();
+                memory_barrier();
+                keystate = 2;
+            }
+            else
+                while (keystate != 2) Sleep(0);
+        }
+
+        static inline record * tls_get(void) { tls_init(); return static_cast<record *>(TlsGetValue(key)); }
+        static inline void tls_set(record * r) { tls_init(); TlsSetValue(key,r); }
+
+        static volatile long keystate;
+        static DWORD key;
+#else
+        static void tls_release(void * r) { release(static_cast<record *>(r)); }
+        static void tls_create(void) { pthread_key_create(&key,tls_release); }
+
+        static inline record * tls_get(void) { pthread_once(&once,tls_create); return static_cast<record *>(pthread_getspecific(key)); }
+        static inline void tls_set(record * r) { pthread_once(&once,tls_create); pthread_setspecific(key,r); }
+
+        static pthread_once_t once;
+        static pthread_key_t key;
+#endif
+
+        static record records[LOCKFREE_HAZARD_RECORDS];
+        static volatile long used;
+    };
+
+    template <class Node, int K>
+    typename hazard_domain<Node,K>::record hazard_domain<Node,K>::records[LOCKFREE_HAZARD_RECORDS];
+
+    template <class Node, int K>
+    volatile long hazard_domain<Node,K>::used = 0;
+
+#ifdef _WIN32
+    template <class Node, int K>
+    volatile long hazard_domain<Node,K>::keystate = 0;
+
+    template <class Node, int K>
+    DWORD hazard_domain<Node,K>::key;
+#else
+    template <class Node, int K>
+    pthread_once_t hazard_domain<Node,K>::once = PTHREAD_ONCE_INIT;
+
+    template <class Node, int K>
+    pthread_key_t hazard_domain<Node,K>::key;
+#endif
+}
+
+#endif /* __LOCKFREE_HAZARD_HPP */
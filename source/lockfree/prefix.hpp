@@ -28,6 +28,25 @@
 
 #include <cassert>
 
+#ifndef LOCKFREE_CACHELINE
+/* size of a cache line, state written by different threads is kept this far apart */
+#   define LOCKFREE_CACHELINE 64
+#endif
+
+/* C++11 memory model: the operations on plain words use the __atomic builtins (which std::atomic is built on),
+   fences come from <atomic> if the compiler is in C++11 mode.
+   Define LOCKFREE_NO_MEMORY_MODEL to use the legacy primitives with full barriers throughout. */
+#ifndef LOCKFREE_NO_MEMORY_MODEL
+#   if defined(__ATOMIC_ACQUIRE) && defined(__GNUC__)
+        /* gcc >= 4.7, clang */
+#       define LOCKFREE_ATOMIC_BUILTINS 1
+#   endif
+#   if __cplusplus >= 201103L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201103L)
+#       define LOCKFREE_STD_ATOMIC 1
+#       include <atomic>
+#   endif
+#endif
+
 #ifdef USE_ATOMIC_OPS
     #define AO_REQUIRE_CAS
     #define AO_USE_PENTIUM4_INSTRS
@@ -58,6 +77,7 @@
     extern "C" {
         void __cdecl _ReadWriteBarrier();
         LONG __cdecl _InterlockedCompareExchange(LONG volatile* Dest,LONG Exchange, LONG Comp); 
+        __int64 __cdecl _InterlockedCompareExchange64(__int64 volatile* Dest,__int64 Exchange, __int64 Comp); 
     }
 #endif
 
@@ -73,7 +73,7 @@ namespace lockfree
         void push(T *node) 
         {
             assert(!node->next.getPtr());
-            while(unlikely(!head.CAS(node->next = head,node)));
+            while(unlikely(!head.CAS(node->next = head,node,order_acq_rel)));
         }
 
         T *pop() 
@@ -81,7 +81,7 @@ namespace lockfree
             for(;;) {
                 atomic_ptr<stack_node> current(head);
                 T *node = static_cast<T *>(current.getPtr());
-                if(!node || likely(head.CAS(current,node->next.getPtr()))) {
+                if(!node || likely(head.CAS(current,node->next.getPtr(),order_acq_rel))) {
                     if(node) node->next.setPtr(NULL);
                     return node;
                 }